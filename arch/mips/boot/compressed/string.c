@@ -7,23 +7,46 @@
 
 #include <linux/types.h>
 
+/*
+ * The decompressors copy and clear large runs of output; doing that a
+ * word at a time is noticeably faster on cores without write combining.
+ */
 void *memcpy(void *dest, const void *src, size_t n)
 {
-	int i;
 	const char *s = src;
 	char *d = dest;
 
-	for (i = 0; i < n; i++)
-		d[i] = s[i];
+	if (!(((unsigned long)d | (unsigned long)s) & (sizeof(long) - 1))) {
+		for (; n >= sizeof(long); n -= sizeof(long)) {
+			*(long *)d = *(const long *)s;
+			d += sizeof(long);
+			s += sizeof(long);
+		}
+	}
+
+	while (n--)
+		*d++ = *s++;
 	return dest;
 }
 
 void *memset(void *s, int c, size_t n)
 {
-	int i;
+	unsigned long v = (unsigned char)c;
 	char *ss = s;
 
-	for (i = 0; i < n; i++)
-		ss[i] = c;
+	if (!((unsigned long)ss & (sizeof(long) - 1))) {
+		v |= v << 8;
+		v |= v << 16;
+		if (sizeof(long) > 4)
+			v |= v << (sizeof(long) * 4);
+
+		for (; n >= sizeof(long); n -= sizeof(long)) {
+			*(unsigned long *)ss = v;
+			ss += sizeof(long);
+		}
+	}
+
+	while (n--)
+		*ss++ = c;
 	return s;
 }
@@ -10,11 +10,29 @@
 #include <crypto/algapi.h>
 #include <crypto/internal/chacha.h>
 #include <crypto/internal/skcipher.h>
+#include <linux/jump_label.h>
 #include <linux/kernel.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
+#include <linux/slab.h>
 
-asmlinkage void chacha_crypt_arch(u32 *state, u8 *dst, const u8 *src,
+#define CHACHA_BENCH_BYTES	4096
+#define CHACHA_BENCH_LOOPS	16
+
+asmlinkage void chacha_crypt_mips(u32 *state, u8 *dst, const u8 *src,
 				  unsigned int bytes, int nrounds);
+
+/* Cleared at init if the C implementation turns out to be faster */
+static __ro_after_init DEFINE_STATIC_KEY_TRUE(use_mips);
+
+void chacha_crypt_arch(u32 *state, u8 *dst, const u8 *src, unsigned int bytes,
+		       int nrounds)
+{
+	if (static_branch_likely(&use_mips))
+		chacha_crypt_mips(state, dst, src, bytes, nrounds);
+	else
+		chacha_crypt_generic(state, dst, src, bytes, nrounds);
+}
 EXPORT_SYMBOL(chacha_crypt_arch);
 
 asmlinkage void hchacha_block_arch(const u32 *state, u32 *stream, int nrounds);
@@ -126,8 +144,52 @@ static struct skcipher_alg algs[] = {
 	}
 };
 
+static u64 __init chacha_bench(void (*crypt)(u32 *, u8 *, const u8 *,
+					      unsigned int, int), u8 *buf)
+{
+	u32 state[16] = {};
+	u64 t;
+	int i;
+
+	t = ktime_get_ns();
+	for (i = 0; i < CHACHA_BENCH_LOOPS; i++)
+		crypt(state, buf, buf, CHACHA_BENCH_BYTES, 20);
+
+	return max_t(u64, ktime_get_ns() - t, 1);
+}
+
+/*
+ * Whether the integer assembly beats the compiler depends on the core (no
+ * rotate instruction before R2) and the toolchain, so time both on the
+ * machine we are running on and keep whichever is faster.
+ */
+static void __init chacha_mips_select(void)
+{
+	u64 mips, generic, bytes = CHACHA_BENCH_BYTES * CHACHA_BENCH_LOOPS;
+	u8 *buf;
+
+	buf = kzalloc(CHACHA_BENCH_BYTES, GFP_KERNEL);
+	if (!buf)
+		return;
+
+	/* warm up the caches */
+	chacha_bench(chacha_crypt_mips, buf);
+	mips = chacha_bench(chacha_crypt_mips, buf);
+	generic = chacha_bench(chacha_crypt_generic, buf);
+	kfree(buf);
+
+	pr_info("chacha20: mips %llu MB/s, generic %llu MB/s, using %s\n",
+		div64_u64(bytes * 1000, mips), div64_u64(bytes * 1000, generic),
+		generic < mips ? "generic" : "mips");
+
+	if (generic < mips)
+		static_branch_disable(&use_mips);
+}
+
 static int __init chacha_simd_mod_init(void)
 {
+	chacha_mips_select();
+
 	return IS_REACHABLE(CONFIG_CRYPTO_SKCIPHER) ?
 		crypto_register_skciphers(algs, ARRAY_SIZE(algs)) : 0;
 }
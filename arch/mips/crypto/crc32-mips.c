@@ -2,6 +2,10 @@
 /*
  * crc32-mips.c - CRC32 and CRC32C using optional MIPSr6 instructions
  *
+ * Cores without the CRC ASE, such as Loongson-2F, get a slice-by-8 table
+ * implementation instead.  The tables are 8KiB per polynomial and stay in
+ * the L1 D-cache, and each step is one aligned 64-bit load.
+ *
  * Module based on arm64/crypto/crc32-arm.c
  *
  * Copyright (C) 2014 Linaro Ltd <yazen.ghannam@linaro.org>
@@ -11,6 +15,7 @@
 #include <linux/unaligned/access_ok.h>
 #include <linux/cpufeature.h>
 #include <linux/init.h>
+#include <linux/jump_label.h>
 #include <linux/kernel.h>
 #include <linux/module.h>
 #include <linux/string.h>
@@ -18,6 +23,15 @@
 
 #include <crypto/internal/hash.h>
 
+#define CRC32_POLY_LE	0xedb88320
+#define CRC32C_POLY_LE	0x82f63b78
+
+static __ro_after_init DEFINE_STATIC_KEY_FALSE(have_crc_ase);
+
+/* crc32_sb8[0] is the usual byte table, [k] advances a byte k more times */
+static u32 crc32_sb8[8][256] __ro_after_init;
+static u32 crc32c_sb8[8][256] __ro_after_init;
+
 enum crc_op_size {
 	b, h, w, d,
 };
@@ -146,6 +160,68 @@ static u32 crc32c_mips_le_hw(u32 crc_, const u8 *p, unsigned int len)
 	return crc;
 }
 
+static void __init crc32_sb8_init(u32 (*t)[256], u32 poly)
+{
+	unsigned int i, j;
+	u32 crc;
+
+	for (i = 0; i < 256; i++) {
+		crc = i;
+		for (j = 0; j < 8; j++)
+			crc = (crc >> 1) ^ ((crc & 1) ? poly : 0);
+		t[0][i] = crc;
+	}
+
+	for (i = 0; i < 256; i++)
+		for (j = 1; j < 8; j++)
+			t[j][i] = (t[j - 1][i] >> 8) ^ t[0][t[j - 1][i] & 0xff];
+}
+
+static u32 crc32_sb8_le(u32 (*t)[256], u32 crc, const u8 *p, unsigned int len)
+{
+	/* Reach 8-byte alignment, unaligned ld traps on these cores */
+	while (len && ((unsigned long)p & 7)) {
+		crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xff];
+		len--;
+	}
+
+	while (len >= 8) {
+#ifdef CONFIG_64BIT
+		u64 q = le64_to_cpu(*(const __le64 *)p) ^ crc;
+		u32 lo = q, hi = q >> 32;
+#else
+		u32 lo = le32_to_cpu(*(const __le32 *)p) ^ crc;
+		u32 hi = le32_to_cpu(*(const __le32 *)(p + 4));
+#endif
+
+		crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^
+		      t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24] ^
+		      t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff] ^
+		      t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+		p += 8;
+		len -= 8;
+	}
+
+	while (len--)
+		crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xff];
+
+	return crc;
+}
+
+static u32 crc32_mips_le(u32 crc, const u8 *p, unsigned int len)
+{
+	if (static_branch_likely(&have_crc_ase))
+		return crc32_mips_le_hw(crc, p, len);
+	return crc32_sb8_le(crc32_sb8, crc, p, len);
+}
+
+static u32 crc32c_mips_le(u32 crc, const u8 *p, unsigned int len)
+{
+	if (static_branch_likely(&have_crc_ase))
+		return crc32c_mips_le_hw(crc, p, len);
+	return crc32_sb8_le(crc32c_sb8, crc, p, len);
+}
+
 #define CHKSUM_BLOCK_SIZE	1
 #define CHKSUM_DIGEST_SIZE	4
 
@@ -188,7 +264,7 @@ static int chksum_update(struct shash_desc *desc, const u8 *data,
 {
 	struct chksum_desc_ctx *ctx = shash_desc_ctx(desc);
 
-	ctx->crc = crc32_mips_le_hw(ctx->crc, data, length);
+	ctx->crc = crc32_mips_le(ctx->crc, data, length);
 	return 0;
 }
 
@@ -197,7 +273,7 @@ static int chksumc_update(struct shash_desc *desc, const u8 *data,
 {
 	struct chksum_desc_ctx *ctx = shash_desc_ctx(desc);
 
-	ctx->crc = crc32c_mips_le_hw(ctx->crc, data, length);
+	ctx->crc = crc32c_mips_le(ctx->crc, data, length);
 	return 0;
 }
 
@@ -219,13 +295,13 @@ static int chksumc_final(struct shash_desc *desc, u8 *out)
 
 static int __chksum_finup(u32 crc, const u8 *data, unsigned int len, u8 *out)
 {
-	put_unaligned_le32(crc32_mips_le_hw(crc, data, len), out);
+	put_unaligned_le32(crc32_mips_le(crc, data, len), out);
 	return 0;
 }
 
 static int __chksumc_finup(u32 crc, const u8 *data, unsigned int len, u8 *out)
 {
-	put_unaligned_le32(~crc32c_mips_le_hw(crc, data, len), out);
+	put_unaligned_le32(~crc32c_mips_le(crc, data, len), out);
 	return 0;
 }
 
@@ -317,6 +393,21 @@ static int __init crc32_mod_init(void)
 {
 	int err;
 
+	if (cpu_have_feature(cpu_feature(MIPS_CRC32))) {
+		static_branch_enable(&have_crc_ase);
+	} else {
+		crc32_sb8_init(crc32_sb8, CRC32_POLY_LE);
+		crc32_sb8_init(crc32c_sb8, CRC32C_POLY_LE);
+
+		/* still ahead of crc32-generic and crc32c-generic */
+		strscpy(crc32_alg.base.cra_driver_name, "crc32-mips-sb8",
+			CRYPTO_MAX_ALG_NAME);
+		strscpy(crc32c_alg.base.cra_driver_name, "crc32c-mips-sb8",
+			CRYPTO_MAX_ALG_NAME);
+		crc32_alg.base.cra_priority = 150;
+		crc32c_alg.base.cra_priority = 150;
+	}
+
 	err = crypto_register_shash(&crc32_alg);
 
 	if (err)
@@ -341,6 +432,8 @@ static void __exit crc32_mod_exit(void)
 MODULE_AUTHOR("Marcin Nowakowski <marcin.nowakowski@mips.com");
 MODULE_DESCRIPTION("CRC32 and CRC32C using optional MIPS instructions");
 MODULE_LICENSE("GPL v2");
+MODULE_ALIAS_CRYPTO("crc32");
+MODULE_ALIAS_CRYPTO("crc32c");
 
-module_cpu_feature_match(MIPS_CRC32, crc32_mod_init);
+module_init(crc32_mod_init);
 module_exit(crc32_mod_exit);
@@ -11,14 +11,28 @@
 #include <crypto/internal/poly1305.h>
 #include <linux/cpufeature.h>
 #include <linux/crypto.h>
+#include <linux/jump_label.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
+#include <linux/slab.h>
+
+#define POLY1305_BENCH_BYTES	4096
+#define POLY1305_BENCH_LOOPS	16
 
 asmlinkage void poly1305_init_mips(void *state, const u8 *key);
 asmlinkage void poly1305_blocks_mips(void *state, const u8 *src, u32 len, u32 hibit);
 asmlinkage void poly1305_emit_mips(void *state, u8 *digest, const u32 *nonce);
 
+/* Cleared at init if poly1305-donna turns out to be faster */
+static __ro_after_init DEFINE_STATIC_KEY_TRUE(use_mips);
+
 void poly1305_init_arch(struct poly1305_desc_ctx *dctx, const u8 *key)
 {
+	if (!static_branch_likely(&use_mips)) {
+		poly1305_init_generic(dctx, key);
+		return;
+	}
+
 	poly1305_init_mips(&dctx->h, key);
 	dctx->s[0] = get_unaligned_le32(key + 16);
 	dctx->s[1] = get_unaligned_le32(key + 20);
@@ -102,6 +116,11 @@ static int mips_poly1305_update(struct shash_desc *desc, const u8 *src,
 void poly1305_update_arch(struct poly1305_desc_ctx *dctx, const u8 *src,
 			  unsigned int nbytes)
 {
+	if (!static_branch_likely(&use_mips)) {
+		poly1305_update_generic(dctx, src, nbytes);
+		return;
+	}
+
 	if (unlikely(dctx->buflen)) {
 		u32 bytes = min(nbytes, POLY1305_BLOCK_SIZE - dctx->buflen);
 
@@ -132,7 +151,7 @@ void poly1305_update_arch(struct poly1305_desc_ctx *dctx, const u8 *src,
 }
 EXPORT_SYMBOL(poly1305_update_arch);
 
-void poly1305_final_arch(struct poly1305_desc_ctx *dctx, u8 *dst)
+static void __mips_poly1305_final(struct poly1305_desc_ctx *dctx, u8 *dst)
 {
 	if (unlikely(dctx->buflen)) {
 		dctx->buf[dctx->buflen++] = 1;
@@ -144,8 +163,22 @@ void poly1305_final_arch(struct poly1305_desc_ctx *dctx, u8 *dst)
 	poly1305_emit_mips(&dctx->h, dst, dctx->s);
 	*dctx = (struct poly1305_desc_ctx){};
 }
+
+void poly1305_final_arch(struct poly1305_desc_ctx *dctx, u8 *dst)
+{
+	if (!static_branch_likely(&use_mips)) {
+		poly1305_final_generic(dctx, dst);
+		return;
+	}
+
+	__mips_poly1305_final(dctx, dst);
+}
 EXPORT_SYMBOL(poly1305_final_arch);
 
+/*
+ * The shash always keeps its state in the assembly's format, whatever
+ * use_mips says, so it has to finish with the assembly too.
+ */
 static int mips_poly1305_final(struct shash_desc *desc, u8 *dst)
 {
 	struct poly1305_desc_ctx *dctx = shash_desc_ctx(desc);
@@ -153,7 +186,7 @@ static int mips_poly1305_final(struct shash_desc *desc, u8 *dst)
 	if (unlikely(!dctx->sset))
 		return -ENOKEY;
 
-	poly1305_final_arch(dctx, dst);
+	__mips_poly1305_final(dctx, dst);
 	return 0;
 }
 
@@ -171,8 +204,67 @@ static struct shash_alg mips_poly1305_alg = {
 	.base.cra_module	= THIS_MODULE,
 };
 
+static u64 __init mips_poly1305_bench(const u8 *buf, bool mips)
+{
+	struct poly1305_desc_ctx dctx;
+	u64 t;
+	int i;
+
+	if (mips) {
+		poly1305_init_mips(&dctx.h, buf);
+	} else {
+		poly1305_core_setkey(&dctx.core_r, buf);
+		poly1305_core_init(&dctx.h);
+	}
+
+	t = ktime_get_ns();
+	for (i = 0; i < POLY1305_BENCH_LOOPS; i++) {
+		if (mips)
+			poly1305_blocks_mips(&dctx.h, buf, POLY1305_BENCH_BYTES, 1);
+		else
+			poly1305_core_blocks(&dctx.h, &dctx.core_r, buf,
+					     POLY1305_BENCH_BYTES / POLY1305_BLOCK_SIZE, 1);
+	}
+
+	memzero_explicit(&dctx, sizeof(dctx));
+
+	return max_t(u64, ktime_get_ns() - t, 1);
+}
+
+/*
+ * The 64-bit assembly relies on dmultu, which is slow on some MIPS III
+ * cores, so time it against poly1305-donna before committing to it.
+ */
+static void __init mips_poly1305_select(void)
+{
+	u64 mips, generic, bytes = POLY1305_BENCH_BYTES * POLY1305_BENCH_LOOPS;
+	u8 *buf;
+
+	buf = kzalloc(POLY1305_BENCH_BYTES, GFP_KERNEL);
+	if (!buf)
+		return;
+
+	/* the all-zero key is fine for timing, and warms up the caches */
+	mips_poly1305_bench(buf, true);
+	mips = mips_poly1305_bench(buf, true);
+	generic = mips_poly1305_bench(buf, false);
+	kfree(buf);
+
+	pr_info("poly1305: mips %llu MB/s, generic %llu MB/s, using %s\n",
+		div64_u64(bytes * 1000, mips), div64_u64(bytes * 1000, generic),
+		generic < mips ? "generic" : "mips");
+
+	if (generic < mips) {
+		static_branch_disable(&use_mips);
+		/* let poly1305-generic win the shash lookup */
+		mips_poly1305_alg.base.cra_priority = 50;
+	}
+}
+
 static int __init mips_poly1305_mod_init(void)
 {
+	mips_poly1305_select();
+
 	return IS_REACHABLE(CONFIG_CRYPTO_HASH) ?
 		crypto_register_shash(&mips_poly1305_alg) : 0;
 }
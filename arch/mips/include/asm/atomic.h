@@ -40,16 +40,45 @@ static __always_inline type pfx##_cmpxchg(pfx##_t *v, type o, type n)	\
 	return cmpxchg(&v->counter, o, n);				\
 }									\
 									\
+static __always_inline type pfx##_cmpxchg_relaxed(pfx##_t *v, type o,	\
+						   type n)		\
+{									\
+	return cmpxchg_relaxed(&v->counter, o, n);			\
+}									\
+									\
+static __always_inline type pfx##_cmpxchg_acquire(pfx##_t *v, type o,	\
+						   type n)		\
+{									\
+	return cmpxchg_acquire(&v->counter, o, n);			\
+}									\
+									\
 static __always_inline type pfx##_xchg(pfx##_t *v, type n)		\
 {									\
 	return xchg(&v->counter, n);					\
+}									\
+									\
+static __always_inline type pfx##_xchg_relaxed(pfx##_t *v, type n)	\
+{									\
+	return xchg_relaxed(&v->counter, n);				\
 }
 
 ATOMIC_OPS(atomic, int)
 
+#define atomic_cmpxchg			atomic_cmpxchg
+#define atomic_cmpxchg_relaxed		atomic_cmpxchg_relaxed
+#define atomic_cmpxchg_acquire		atomic_cmpxchg_acquire
+#define atomic_xchg			atomic_xchg
+#define atomic_xchg_relaxed		atomic_xchg_relaxed
+
 #ifdef CONFIG_64BIT
 # define ATOMIC64_INIT(i)	{ (i) }
 ATOMIC_OPS(atomic64, s64)
+
+# define atomic64_cmpxchg		atomic64_cmpxchg
+# define atomic64_cmpxchg_relaxed	atomic64_cmpxchg_relaxed
+# define atomic64_cmpxchg_acquire	atomic64_cmpxchg_acquire
+# define atomic64_xchg			atomic64_xchg
+# define atomic64_xchg_relaxed		atomic64_xchg_relaxed
 #endif
 
 #define ATOMIC_OP(pfx, op, type, c_op, asm_op, ll, sc)			\
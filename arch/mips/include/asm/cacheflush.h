@@ -85,6 +85,30 @@ extern void (*__flush_icache_user_range)(unsigned long start,
 extern void (*__local_flush_icache_user_range)(unsigned long start,
 					       unsigned long end);
 
+/*
+ * Batched icache flushing for code patchers that update many small ranges
+ * in a row (jump labels, JITs): ranges are merged into their hull and
+ * flushed once by flush_icache_batch_finish().  The cache implementations
+ * fall back to a full blast once a range exceeds the icache size, so a
+ * sparse hull never costs more than one blast.
+ */
+struct flush_icache_batch {
+	unsigned long start;
+	unsigned long end;
+};
+
+#define FLUSH_ICACHE_BATCH_INIT	{ .start = ULONG_MAX, .end = 0 }
+
+static inline void flush_icache_batch_init(struct flush_icache_batch *b)
+{
+	b->start = ULONG_MAX;
+	b->end = 0;
+}
+
+extern void flush_icache_batch_add(struct flush_icache_batch *b,
+				   unsigned long start, unsigned long end);
+extern void flush_icache_batch_finish(struct flush_icache_batch *b);
+
 extern void (*__flush_cache_vmap)(void);
 
 static inline void flush_cache_vmap(unsigned long start, unsigned long end)
@@ -110,6 +110,15 @@ unsigned long __xchg(volatile void *ptr, unsigned long x, int size)
 	__res;								\
 })
 
+/*
+ * The LL/SC loop alone, for the acquire and release variants built by
+ * <linux/atomic-fallback.h>.  The syncs of the Loongson3 workaround are part
+ * of the loop and are still emitted.
+ */
+#define xchg_relaxed(ptr, x)						\
+	((__typeof__(*(ptr)))						\
+		__xchg((ptr), (unsigned long)(x), sizeof(*(ptr))))
+
 #define __cmpxchg_asm(ld, st, m, old, new)				\
 ({									\
 	__typeof(*(m)) __ret;						\
@@ -182,6 +191,23 @@ unsigned long __cmpxchg(volatile void *ptr, unsigned long old,
 			  (unsigned long)(__typeof__(*(ptr)))(new),	\
 			  sizeof(*(ptr))))
 
+#define cmpxchg_relaxed		cmpxchg_local
+
+/*
+ * Acquire only needs the barrier after the SC, and in the Loongson3
+ * workaround case the loop already ends with one.
+ */
+#define cmpxchg_acquire(ptr, old, new)					\
+({									\
+	__typeof__(*(ptr)) __res;					\
+									\
+	__res = cmpxchg_local((ptr), (old), (new));			\
+	if (!__SYNC_loongson3_war)					\
+		smp_llsc_mb();						\
+									\
+	__res;								\
+})
+
 #define cmpxchg(ptr, old, new)						\
 ({									\
 	__typeof__(*(ptr)) __res;					\
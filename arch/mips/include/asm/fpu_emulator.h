@@ -35,6 +35,7 @@ struct mips_fpu_emulator_stats {
 	unsigned long ieee754_zerodiv;
 	unsigned long ieee754_invalidop;
 	unsigned long ds_emul;
+	unsigned long burst;
 
 	unsigned long abs_s;
 	unsigned long abs_d;
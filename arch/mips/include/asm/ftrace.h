@@ -15,6 +15,11 @@
 #define MCOUNT_ADDR ((unsigned long)(_mcount))
 #define MCOUNT_INSN_SIZE 4		/* sizeof mcount call */
 
+#ifdef CONFIG_DYNAMIC_FTRACE_WITH_REGS
+/* ftrace_caller and ftrace_regs_caller pass the ops and pt_regs along */
+#define ARCH_SUPPORTS_FTRACE_OPS 1
+#endif
+
 #ifndef __ASSEMBLY__
 extern void _mcount(void);
 #define mcount _mcount
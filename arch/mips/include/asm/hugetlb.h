@@ -11,6 +11,9 @@
 
 #include <asm/page.h>
 
+extern int mips_has_huge_tlb(void);
+#define hugepages_supported() mips_has_huge_tlb()
+
 #define __HAVE_ARCH_PREPARE_HUGEPAGE_RANGE
 static inline int prepare_hugepage_range(struct file *file,
 					 unsigned long addr,
@@ -49,6 +49,8 @@ extern struct irq_domain *__init_i8259_irqs(struct device_node *node);
  */
 extern void i8259_set_poll(int (*poll)(void));
 
+extern unsigned int i8259_cached_mask(void);
+
 /*
  * Do the traditional i8259 interrupt polling thing.  This is for the few
  * cases where no better interrupt acknowledge method is available and we
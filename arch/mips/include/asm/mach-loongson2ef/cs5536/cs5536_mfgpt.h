@@ -13,6 +13,7 @@
 extern void setup_mfgpt0_timer(void);
 extern void disable_mfgpt0_counter(void);
 extern void enable_mfgpt0_counter(void);
+extern u16 cs5536_mfgpt1_read(void);
 #else
 static inline void __maybe_unused setup_mfgpt0_timer(void)
 {
@@ -23,14 +24,40 @@ static inline void __maybe_unused disable_mfgpt0_counter(void)
 static inline void __maybe_unused enable_mfgpt0_counter(void)
 {
 }
+static inline u16 __maybe_unused cs5536_mfgpt1_read(void)
+{
+	return 0;
+}
 #endif
 
 #define MFGPT_TICK_RATE 14318000
-#define COMPARE	 ((MFGPT_TICK_RATE + HZ/2) / HZ)
+
+/*
+ * MFGPT0 drives the clock event, MFGPT1 free runs as the clocksource.  The
+ * counters are 16 bits wide, so both are prescaled to reach useful tickless
+ * idle periods: 1/8 (36ms range) and 1/16 (73ms wrap) of the 14.318MHz
+ * clock.  Both rates are exact integers.
+ */
+#define MFGPT0_SCALE	3
+#define MFGPT1_SCALE	4
+#define MFGPT0_RATE	(MFGPT_TICK_RATE >> MFGPT0_SCALE)
+#define MFGPT1_RATE	(MFGPT_TICK_RATE >> MFGPT1_SCALE)
+#define COMPARE	 ((MFGPT0_RATE + HZ/2) / HZ)
 
 #define MFGPT_BASE	mfgpt_base
 #define MFGPT0_CMP2	(MFGPT_BASE + 2)
 #define MFGPT0_CNT	(MFGPT_BASE + 4)
 #define MFGPT0_SETUP	(MFGPT_BASE + 6)
+#define MFGPT1_CMP2	(MFGPT_BASE + 10)
+#define MFGPT1_CNT	(MFGPT_BASE + 12)
+#define MFGPT1_SETUP	(MFGPT_BASE + 14)
+
+/* MFGPTx_SETUP */
+#define MFGPT_SETUP_CNTEN	(1 << 15)
+#define MFGPT_SETUP_CMP2	(1 << 14)	/* comparator 2 event, w1c */
+#define MFGPT_SETUP_CMP1	(1 << 13)	/* comparator 1 event, w1c */
+#define MFGPT_SETUP_SETUP	(1 << 12)	/* low 12 bits written, locked */
+#define MFGPT_SETUP_CMP2EVT	(3 << 8)	/* comparator 2 interrupt mode */
+#define MFGPT_SETUP_CLKSEL	(1 << 4)	/* 14.318MHz rather than 32kHz */
 
 #endif /*!_CS5536_MFGPT_H */
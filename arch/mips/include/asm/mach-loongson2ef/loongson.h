@@ -11,6 +11,8 @@
 #include <linux/init.h>
 #include <linux/irq.h>
 
+#include <asm/time.h>
+
 /* loongson internal northbridge initialization */
 extern void bonito_irq_init(void);
 
@@ -61,11 +63,30 @@ extern int mach_i8259_irq(void);
 #include <linux/interrupt.h>
 static inline void do_perfcnt_IRQ(void)
 {
-#if IS_ENABLED(CONFIG_OPROFILE)
+#if IS_ENABLED(CONFIG_OPROFILE) || IS_ENABLED(CONFIG_HW_PERF_EVENTS)
 	do_IRQ(LOONGSON2_PERFCNT_IRQ);
 #endif
 }
 
+/*
+ * Performance counters: two 32-bit counters share the 64-bit PerfCnt
+ * register (counter 0 in the low word) and a single PerfCtrl register.
+ */
+#define LOONGSON2_PERFCNT_OVERFLOW		(1ULL	<< 31)
+
+#define LOONGSON2_PERFCTRL_EXL			(1UL	<<  0)
+#define LOONGSON2_PERFCTRL_KERNEL		(1UL	<<  1)
+#define LOONGSON2_PERFCTRL_SUPERVISOR		(1UL	<<  2)
+#define LOONGSON2_PERFCTRL_USER			(1UL	<<  3)
+#define LOONGSON2_PERFCTRL_ENABLE		(1UL	<<  4)
+#define LOONGSON2_PERFCTRL_EVENT(idx, event) \
+	(((event) & 0x0f) << ((idx) ? 9 : 5))
+
+#define read_c0_perfctrl() __read_64bit_c0_register($24, 0)
+#define write_c0_perfctrl(val) __write_64bit_c0_register($24, 0, val)
+#define read_c0_perfcnt() __read_64bit_c0_register($25, 0)
+#define write_c0_perfcnt(val) __write_64bit_c0_register($25, 0, val)
+
 #define LOONGSON_FLASH_BASE	0x1c000000
 #define LOONGSON_FLASH_SIZE	0x02000000	/* 32M */
 #define LOONGSON_FLASH_TOP	(LOONGSON_FLASH_BASE+LOONGSON_FLASH_SIZE-1)
@@ -229,6 +250,19 @@ static inline void do_perfcnt_IRQ(void)
 /* Chip Config registor of each physical cpu package, PRid >= Loongson-2F */
 #define LOONGSON_CHIPCFG	(void __iomem *)TO_UNCAC(0x1fc00180)
 
+/*
+ * CHIPCFG[2:0] selects (n + 1) / 8 of the nominal core clock, n == 0
+ * stopping it.  Count runs from the core clock, so every write that may
+ * change the divider goes through the Count clocksource.
+ */
+static inline void loongson2_chipcfg_write(u32 cfg)
+{
+	unsigned int n = cfg & 0x7;
+
+	r4k_clocksource_writel_rate(cfg, LOONGSON_CHIPCFG,
+				    n ? cpu_clock_freq / 1000 * (n + 1) / 8 : 0);
+}
+
 /* pcimap */
 
 #define LOONGSON_PCIMAP_PCIMAP_LO0	0x0000003f
@@ -32,6 +32,15 @@ extern struct pci_ops loongson_pci_ops;
 #define MMAP_CPUTOPCI_SIZE	(LOONGSON_PCI_MEM_END - \
 					LOONGSON_PCI_MEM_START + 1)
 
+/*
+ * PCI DMA window: pci [2G, 2G + size] -> ddr [0, size], where size covers
+ * all of memory (low memory and the high memory behind 2G + 256M) rounded up
+ * to a power of two, with the original 256M as the lower bound.
+ */
+#define LOONGSON_PCIDMA_BASE	0x80000000ul		/* 2G */
+#define LOONGSON_PCIDMA_MIN_SIZE	0x10000000ul		/* 256M */
+#define LOONGSON_PCIDMA_MAX_SIZE	0x80000000ul		/* 2G */
+
 #else	/* loongson2f/32bit & loongson2e */
 
 /* this pci memory space is mapped by pcimap in pci.c */
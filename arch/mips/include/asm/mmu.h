@@ -20,6 +20,14 @@ typedef struct {
 	unsigned long *bd_emupage_allocmap;
 	/* wait queue for threads requiring an emuframe */
 	wait_queue_head_t bd_emupage_queue;
+
+#ifndef CONFIG_SMP
+	/* TLB flush deferred until the next switch to this mm */
+	unsigned long tlb_flush_start;
+	unsigned long tlb_flush_end;
+	unsigned long tlb_flush_pairs;
+	u64 tlb_flush_asid;
+#endif
 } mm_context_t;
 
 #endif /* __ASM_MMU_H */
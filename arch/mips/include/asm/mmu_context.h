@@ -152,6 +152,10 @@ init_new_context(struct task_struct *tsk, struct mm_struct *mm)
 	spin_lock_init(&mm->context.bd_emupage_lock);
 	init_waitqueue_head(&mm->context.bd_emupage_queue);
 
+#ifndef CONFIG_SMP
+	mm->context.tlb_flush_end = 0;
+#endif
+
 	return 0;
 }
 
@@ -584,6 +584,12 @@ int io_remap_pfn_range(struct vm_area_struct *vma, unsigned long vaddr,
 #define has_transparent_hugepage has_transparent_hugepage
 extern int has_transparent_hugepage(void);
 
+#ifndef CONFIG_SMP
+#define __HAVE_ARCH_FLUSH_PMD_TLB_RANGE
+#define flush_pmd_tlb_range(vma, addr, end)	\
+	local_flush_pmd_tlb_range(vma, addr, end)
+#endif
+
 static inline int pmd_trans_huge(pmd_t pmd)
 {
 	return !!(pmd_val(pmd) & _PAGE_HUGE);
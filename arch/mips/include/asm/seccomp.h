@@ -2,6 +2,7 @@
 #ifndef __ASM_SECCOMP_H
 
 #include <linux/unistd.h>
+#include <uapi/linux/audit.h>
 
 #ifdef CONFIG_COMPAT
 static inline const int *get_compat_mode1_syscalls(void)
@@ -30,6 +31,23 @@ static inline const int *get_compat_mode1_syscalls(void)
 
 #endif /* CONFIG_COMPAT */
 
+#ifdef __MIPSEB__
+#define __SECCOMP_ARCH_LE		0
+#else
+#define __SECCOMP_ARCH_LE		__AUDIT_ARCH_LE
+#endif
+#ifdef CONFIG_64BIT
+# define SECCOMP_ARCH_NATIVE		(AUDIT_ARCH_MIPS64 | __SECCOMP_ARCH_LE)
+# define SECCOMP_ARCH_NATIVE_NR		NR_syscalls
+# ifdef CONFIG_MIPS32_O32
+#  define SECCOMP_ARCH_COMPAT		(AUDIT_ARCH_MIPS | __SECCOMP_ARCH_LE)
+#  define SECCOMP_ARCH_COMPAT_NR	NR_syscalls
+# endif
+#else /* !CONFIG_64BIT */
+# define SECCOMP_ARCH_NATIVE		(AUDIT_ARCH_MIPS | __SECCOMP_ARCH_LE)
+# define SECCOMP_ARCH_NATIVE_NR		NR_syscalls
+#endif
+
 #include <asm-generic/seccomp.h>
 
 #endif /* __ASM_SECCOMP_H */
@@ -55,6 +55,28 @@ static inline int mips_clockevent_init(void)
  */
 extern int init_r4k_clocksource(void);
 
+#if defined(CONFIG_CSRC_R4K) && defined(CONFIG_CPU_FREQ)
+extern void r4k_clocksource_scale_with_cpufreq(unsigned int nominal_khz);
+extern void r4k_clocksource_cpufreq_transition(unsigned long val,
+					       unsigned int khz);
+extern void r4k_clocksource_writel_rate(u32 val, void __iomem *reg,
+					unsigned int khz);
+extern bool r4k_clocksource_scaled(void);
+#else
+static inline void r4k_clocksource_scale_with_cpufreq(unsigned int nominal_khz)
+{
+}
+static inline void r4k_clocksource_cpufreq_transition(unsigned long val,
+						      unsigned int khz)
+{
+}
+#define r4k_clocksource_writel_rate(val, reg, khz)	writel(val, reg)
+static inline bool r4k_clocksource_scaled(void)
+{
+	return false;
+}
+#endif
+
 static inline int init_mips_clocksource(void)
 {
 #ifdef CONFIG_CSRC_R4K
@@ -21,6 +21,8 @@ extern void local_flush_tlb_kernel_range(unsigned long start,
 extern void local_flush_tlb_page(struct vm_area_struct *vma,
 	unsigned long page);
 extern void local_flush_tlb_one(unsigned long vaddr);
+extern void local_flush_pmd_tlb_range(struct vm_area_struct *vma,
+	unsigned long start, unsigned long end);
 
 #include <asm/mmu_context.h>
 
@@ -46,4 +48,13 @@ extern void flush_tlb_one(unsigned long vaddr);
 
 #endif /* CONFIG_SMP */
 
+#if defined(CONFIG_CPU_R4K_CACHE_TLB) && !defined(CONFIG_SMP)
+/* Flushes of inactive mms are batched until they are switched to */
+extern void local_flush_tlb_pending(struct mm_struct *mm);
+#else
+static inline void local_flush_tlb_pending(struct mm_struct *mm)
+{
+}
+#endif
+
 #endif /* __ASM_TLBFLUSH_H */
@@ -18,4 +18,11 @@
 #define topology_sibling_cpumask(cpu)		(&cpu_sibling_map[cpu])
 #endif
 
+#ifdef CONFIG_CPU_FREQ
+#include <linux/arch_topology.h>
+
+/* Updated by cpufreq drivers through arch_set_freq_scale() */
+#define arch_scale_freq_capacity topology_get_freq_scale
+#endif
+
 #endif /* __ASM_TOPOLOGY_H */
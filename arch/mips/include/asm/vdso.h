@@ -50,8 +50,30 @@ extern struct mips_vdso_image vdso_image_o32;
 extern struct mips_vdso_image vdso_image_n32;
 #endif
 
+/**
+ * struct mips_vdso_r4k_scaled - Epoch of the cpufreq-rescaled R4K counter.
+ * @seq:	Sequence count, odd while the kernel updates the epoch.
+ * @count:	Raw CP0 Count value at the epoch.
+ * @mult:	Multiplier converting current-rate Count ticks to nominal ticks.
+ * @shift:	Shift applied after @mult.
+ * @cyc:	Nominal-rate cycle count at the epoch.
+ *
+ * Mirrors the kernel side state in csrc-r4k.c so that the VDSO can rebuild
+ * the same 64-bit cycle count when VDSO_CLOCKMODE_R4K_SCALED is in use.
+ */
+struct mips_vdso_r4k_scaled {
+	u32 seq;
+	u32 count;
+	u32 mult;
+	u32 shift;
+	u64 cyc;
+};
+
 union mips_vdso_data {
-	struct vdso_data data[CS_BASES];
+	struct {
+		struct vdso_data data[CS_BASES];
+		struct mips_vdso_r4k_scaled r4k_scaled;
+	};
 	u8 page[PAGE_SIZE];
 };
 
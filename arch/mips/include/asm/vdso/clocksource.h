@@ -4,6 +4,7 @@
 
 #define VDSO_ARCH_CLOCKMODES	\
 	VDSO_CLOCKMODE_R4K,	\
+	VDSO_CLOCKMODE_R4K_SCALED,	\
 	VDSO_CLOCKMODE_GIC
 
 #endif /* __ASM_VDSOCLOCKSOURCE_H */
@@ -147,6 +147,48 @@ static __always_inline u64 read_r4k_count(void)
 	return count;
 }
 
+#ifdef CONFIG_CPU_FREQ
+
+/*
+ * Pre-R2 cores trap on RDHWR; the RI handler has a fast path for exactly
+ * "rdhwr v1, $2", so the destination register must be pinned to v1.
+ */
+static __always_inline u32 read_r4k_count_v1(void)
+{
+	register unsigned int count asm("$3");
+
+	__asm__ __volatile__(
+	"	.set push\n"
+	"	.set mips32r2\n"
+	"	rdhwr	$3, $2\n"
+	"	.set pop\n"
+	: "=r" (count)
+	:
+	: "memory");
+
+	return count;
+}
+
+static __always_inline u64 read_r4k_scaled_count(const struct vdso_data *data)
+{
+	const struct mips_vdso_r4k_scaled *e =
+		&((const union mips_vdso_data *)data)->r4k_scaled;
+	u32 seq, count;
+	u64 cyc;
+
+	do {
+		seq = READ_ONCE(e->seq);
+		smp_rmb();
+		count = read_r4k_count_v1();
+		cyc = e->cyc + (((u64)(count - e->count) * e->mult) >> e->shift);
+		smp_rmb();
+	} while (unlikely((seq & 1) || seq != READ_ONCE(e->seq)));
+
+	return cyc;
+}
+
+#endif /* CONFIG_CPU_FREQ */
+
 #endif
 
 #ifdef CONFIG_CLKSRC_MIPS_GIC
@@ -172,6 +214,10 @@ static __always_inline u64 __arch_get_hw_counter(s32 clock_mode)
 #ifdef CONFIG_CSRC_R4K
 	if (clock_mode == VDSO_CLOCKMODE_R4K)
 		return read_r4k_count();
+#ifdef CONFIG_CPU_FREQ
+	if (clock_mode == VDSO_CLOCKMODE_R4K_SCALED)
+		return read_r4k_scaled_count(get_vdso_data());
+#endif
 #endif
 #ifdef CONFIG_CLKSRC_MIPS_GIC
 	if (clock_mode == VDSO_CLOCKMODE_GIC)
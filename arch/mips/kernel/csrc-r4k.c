@@ -7,10 +7,18 @@
  */
 #include <linux/clocksource.h>
 #include <linux/cpufreq.h>
+#include <linux/export.h>
 #include <linux/init.h>
+#include <linux/io.h>
+#include <linux/math64.h>
 #include <linux/sched_clock.h>
+#include <linux/seqlock.h>
+#include <linux/spinlock.h>
+#include <linux/timer.h>
 
 #include <asm/time.h>
+#include <asm/vdso.h>
+#include <asm/vdso/vsyscall.h>
 
 static u64 c0_hpt_read(struct clocksource *cs)
 {
@@ -82,11 +90,242 @@ static void r4k_clocksource_unstable(char *reason)
 	clocksource_mark_unstable(&clocksource_mips);
 }
 
+/*
+ * Some cores (e.g. Loongson-2F) clock the Count register from the scaled
+ * pipeline clock, so its rate follows every cpufreq transition.  Platforms
+ * where the Count rate is strictly proportional to the cpufreq frequency can
+ * opt in with r4k_clocksource_scale_with_cpufreq().  Instead of marking the
+ * clocksource unstable, Count deltas are then rescaled to the nominal
+ * mips_hpt_frequency and accumulated into a 64-bit counter.
+ *
+ * Readers are lock free: the epoch is published through a seqcount latch so
+ * clocksource, sched_clock and NMI context reads never spin on the writer.
+ * Writers (cpufreq transitions and the wrap timer) are serialized by
+ * r4k_scaled_lock.
+ */
+#define R4K_SCALED_SHIFT	24
+
+struct r4k_scaled_epoch {
+	u64	cyc;		/* nominal-rate cycles at epoch */
+	u32	count;		/* raw Count value at epoch */
+	u32	mult;		/* current rate -> nominal rate */
+};
+
+static struct {
+	seqcount_t		seq;
+	struct r4k_scaled_epoch	epoch[2];
+} r4k_scaled ____cacheline_aligned;
+
+static DEFINE_RAW_SPINLOCK(r4k_scaled_lock);
+static unsigned int r4k_scaled_nominal_khz;
+static unsigned int r4k_scaled_cur_khz;
+static bool __read_mostly r4k_count_scaled;
+static struct timer_list r4k_scaled_timer;
+
+static inline u64 notrace r4k_scaled_cyc(const struct r4k_scaled_epoch *e,
+					 u32 count)
+{
+	return e->cyc + (((u64)(count - e->count) * e->mult) >> R4K_SCALED_SHIFT);
+}
+
+static u64 notrace r4k_scaled_read_count(void)
+{
+	const struct r4k_scaled_epoch *e;
+	unsigned int seq;
+	u64 cyc;
+
+	do {
+		seq = raw_read_seqcount_latch(&r4k_scaled.seq);
+		e = &r4k_scaled.epoch[seq & 1];
+		cyc = r4k_scaled_cyc(e, read_c0_count());
+	} while (read_seqcount_retry(&r4k_scaled.seq, seq));
+
+	return cyc;
+}
+
+static u64 r4k_scaled_read(struct clocksource *cs)
+{
+	return r4k_scaled_read_count();
+}
+
+/*
+ * The VDSO cannot use the latch, so its copy of the epoch is published
+ * with a plain sequence count that user space retries on.
+ */
+static void r4k_scaled_update_vdso(const struct r4k_scaled_epoch *e)
+{
+	struct mips_vdso_r4k_scaled *v =
+		&((union mips_vdso_data *)vdso_data)->r4k_scaled;
+
+	WRITE_ONCE(v->seq, v->seq + 1);
+	smp_wmb();
+	v->cyc = e->cyc;
+	v->count = e->count;
+	v->mult = e->mult;
+	v->shift = R4K_SCALED_SHIFT;
+	smp_wmb();
+	WRITE_ONCE(v->seq, v->seq + 1);
+}
+
+/* Fold the elapsed Count into a new epoch.  Called with r4k_scaled_lock. */
+static void r4k_scaled_update(unsigned int cur_khz)
+{
+	struct r4k_scaled_epoch e;
+	u32 count;
+
+	count = read_c0_count();
+	e.cyc = r4k_scaled_cyc(&r4k_scaled.epoch[0], count);
+	e.count = count;
+	e.mult = div_u64((u64)r4k_scaled_nominal_khz << R4K_SCALED_SHIFT,
+			 cur_khz);
+
+	raw_write_seqcount_latch(&r4k_scaled.seq);
+	r4k_scaled.epoch[0] = e;
+	raw_write_seqcount_latch(&r4k_scaled.seq);
+	r4k_scaled.epoch[1] = e;
+
+	r4k_scaled_update_vdso(&e);
+	r4k_scaled_cur_khz = cur_khz;
+}
+
+/*
+ * The raw Count is only 32 bits wide, so the epoch has to be refreshed well
+ * before Count wraps, even if the frequency never changes.
+ */
+static unsigned long r4k_scaled_period(void)
+{
+	return max_t(unsigned long, HZ,
+		     div_u64((u64)HZ << 31, mips_hpt_frequency));
+}
+
+static void r4k_scaled_timer_fn(struct timer_list *t)
+{
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(&r4k_scaled_lock, flags);
+	r4k_scaled_update(r4k_scaled_cur_khz);
+	raw_spin_unlock_irqrestore(&r4k_scaled_lock, flags);
+
+	mod_timer(t, jiffies + r4k_scaled_period());
+}
+
+/**
+ * r4k_clocksource_scale_with_cpufreq() - let Count survive cpufreq changes
+ * @nominal_khz: CPU frequency at which Count runs at mips_hpt_frequency
+ *
+ * Must be called from plat_time_init(), before the clocksource registers.
+ */
+void __init r4k_clocksource_scale_with_cpufreq(unsigned int nominal_khz)
+{
+	struct r4k_scaled_epoch *e;
+
+	if (!nominal_khz)
+		return;
+
+	r4k_scaled_nominal_khz = nominal_khz;
+	r4k_scaled_cur_khz = nominal_khz;
+
+	seqcount_init(&r4k_scaled.seq);
+	e = &r4k_scaled.epoch[0];
+	e->cyc = 0;
+	e->count = read_c0_count();
+	e->mult = 1U << R4K_SCALED_SHIFT;
+	r4k_scaled.epoch[1] = *e;
+	r4k_scaled_update_vdso(e);
+
+	r4k_count_scaled = true;
+}
+
+/**
+ * r4k_clocksource_cpufreq_transition() - report a frequency change
+ * @val: CPUFREQ_PRECHANGE or CPUFREQ_POSTCHANGE
+ * @khz: frequency before (PRECHANGE) or after (POSTCHANGE) the change
+ *
+ * In scaled mode the transition notifier is not registered, so that the
+ * platform cpufreq driver can switch from scheduler context (fast_switch
+ * is refused while transition notifiers exist).  The driver has to call
+ * this around every change of the core clock instead, or better write the
+ * clock register through r4k_clocksource_writel_rate().
+ */
+void r4k_clocksource_cpufreq_transition(unsigned long val, unsigned int khz)
+{
+	unsigned long flags;
+
+	if (!r4k_count_scaled) {
+		if (val == CPUFREQ_POSTCHANGE)
+			r4k_clocksource_unstable("CPU frequency change");
+		return;
+	}
+
+	/*
+	 * Fold at the old rate before the switch, then again at the new rate
+	 * once it has taken effect; only the ticks in between are mis-scaled.
+	 */
+	raw_spin_lock_irqsave(&r4k_scaled_lock, flags);
+	if (val == CPUFREQ_PRECHANGE || val == CPUFREQ_POSTCHANGE)
+		r4k_scaled_update(khz);
+	raw_spin_unlock_irqrestore(&r4k_scaled_lock, flags);
+}
+EXPORT_SYMBOL_GPL(r4k_clocksource_cpufreq_transition);
+
+/**
+ * r4k_clocksource_writel_rate() - write a core clock register
+ * @val: value to write
+ * @reg: register that sets the core clock, and with it the Count rate
+ * @khz: core frequency once @val is in effect, 0 if it stops the clock
+ *
+ * The elapsed Count is folded at the old rate, the register is written and
+ * the new epoch starts at @khz, all under r4k_scaled_lock, so no tick is
+ * accounted at the wrong rate.  Every write to @reg that changes the clock
+ * has to go through here, also the short ones done by the idle loop.  A
+ * stopped clock does not advance Count, so the next write folds nothing
+ * at the old rate.
+ */
+void r4k_clocksource_writel_rate(u32 val, void __iomem *reg, unsigned int khz)
+{
+	unsigned long flags;
+
+	if (!r4k_count_scaled) {
+		writel(val, reg);
+		readl(reg);
+		r4k_clocksource_unstable("core clock change");
+		return;
+	}
+
+	raw_spin_lock_irqsave(&r4k_scaled_lock, flags);
+	r4k_scaled_update(r4k_scaled_cur_khz);
+	writel(val, reg);
+	/* the new rate is in effect once the write has reached the register */
+	readl(reg);
+	if (khz)
+		r4k_scaled_update(khz);
+	raw_spin_unlock_irqrestore(&r4k_scaled_lock, flags);
+}
+EXPORT_SYMBOL_GPL(r4k_clocksource_writel_rate);
+
+/**
+ * r4k_clocksource_scaled() - is Count rescaled with the core clock
+ *
+ * Returns true once Count is in scaled mode.  Count does not advance while
+ * the core clock is stopped, and nothing accounts for that time, so the
+ * clock must not be stopped then.  Outside scaled mode any clock change
+ * has Count marked unstable, and timekeeping moves to another clocksource.
+ */
+bool r4k_clocksource_scaled(void)
+{
+	return r4k_count_scaled;
+}
+EXPORT_SYMBOL_GPL(r4k_clocksource_scaled);
+
 static int r4k_cpufreq_callback(struct notifier_block *nb,
 				unsigned long val, void *data)
 {
-	if (val == CPUFREQ_POSTCHANGE)
-		r4k_clocksource_unstable("CPU frequency change");
+	struct cpufreq_freqs *freqs = data;
+
+	if (val == CPUFREQ_PRECHANGE)
+		r4k_clocksource_cpufreq_transition(val, freqs->old);
+	else if (val == CPUFREQ_POSTCHANGE)
+		r4k_clocksource_cpufreq_transition(val, freqs->new);
 
 	return 0;
 }
@@ -97,6 +336,10 @@ static struct notifier_block r4k_cpufreq_notifier = {
 
 static int __init r4k_register_cpufreq_notifier(void)
 {
+	/* the platform driver reports transitions itself, see above */
+	if (r4k_count_scaled)
+		return 0;
+
 	return cpufreq_register_notifier(&r4k_cpufreq_notifier,
 					 CPUFREQ_TRANSITION_NOTIFIER);
 
@@ -120,10 +363,30 @@ int __init init_r4k_clocksource(void)
 	if (cpu_has_mips_r2_r6 && rdhwr_count_usable())
 		clocksource_mips.vdso_clock_mode = VDSO_CLOCKMODE_R4K;
 
+#ifdef CONFIG_CPU_FREQ
+	if (r4k_count_scaled) {
+		clocksource_mips.read = r4k_scaled_read;
+		clocksource_mips.mask = CLOCKSOURCE_MASK(64);
+		/*
+		 * Pre-R2 cores emulate RDHWR $2 through a short fast path in
+		 * the RI exception handler, still far cheaper than a syscall.
+		 */
+		clocksource_mips.vdso_clock_mode = VDSO_CLOCKMODE_R4K_SCALED;
+	}
+#endif
+
 	clocksource_register_hz(&clocksource_mips, mips_hpt_frequency);
 
 #ifndef CONFIG_CPU_FREQ
 	sched_clock_register(r4k_read_sched_clock, 32, mips_hpt_frequency);
+#else
+	if (r4k_count_scaled) {
+		sched_clock_register(r4k_scaled_read_count, 64,
+				     mips_hpt_frequency);
+
+		timer_setup(&r4k_scaled_timer, r4k_scaled_timer_fn, 0);
+		mod_timer(&r4k_scaled_timer, jiffies + r4k_scaled_period());
+	}
 #endif
 
 	return 0;
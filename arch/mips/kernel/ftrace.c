@@ -31,6 +31,21 @@
 
 #ifdef CONFIG_DYNAMIC_FTRACE
 
+/*
+ * The sites are patched live on every CPU, and a call site may be two
+ * instructions, so each one is flushed before the next is patched: another
+ * CPU must never see half of a site from its icache.
+ */
+static void ftrace_flush_icache(unsigned long ip)
+{
+	mm_segment_t old_fs;
+
+	old_fs = get_fs();
+	set_fs(KERNEL_DS);
+	flush_icache_range(ip, ip + 8);
+	set_fs(old_fs);
+}
+
 /* Arch override because MIPS doesn't need to run this from stop_machine() */
 void arch_ftrace_update_code(int command)
 {
@@ -52,32 +67,64 @@ void arch_ftrace_update_code(int command)
 static unsigned int insn_jal_ftrace_caller __read_mostly;
 static unsigned int insn_la_mcount[2] __read_mostly;
 static unsigned int insn_j_ftrace_graph_caller __maybe_unused __read_mostly;
+#ifdef CONFIG_DYNAMIC_FTRACE_WITH_REGS
+static unsigned int insn_jal_ftrace_regs_caller __read_mostly;
+static unsigned int insn_la_ftrace_regs_caller[2] __read_mostly;
+static unsigned int insn_j_ftrace_regs_graph_caller __maybe_unused __read_mostly;
+#endif
+
+/*
+ * Always a lui/addiu pair, even when the low half is zero: module call
+ * sites are patched one instruction at a time.
+ */
+static void ftrace_uasm_la_v1(unsigned int *insns, unsigned long addr)
+{
+	u32 *buf = (u32 *)insns;
+	unsigned int v1 = 3;
+
+	uasm_i_lui(&buf, v1, uasm_rel_hi(addr));
+	UASM_i_ADDIU(&buf, v1, v1, uasm_rel_lo(addr));
+}
+
+#if defined(CONFIG_DYNAMIC_FTRACE_WITH_REGS) && \
+	defined(CONFIG_FUNCTION_GRAPH_TRACER)
+extern void ftrace_regs_graph_caller(void);
+#endif
 
 static inline void ftrace_dyn_arch_init_insns(void)
 {
 	u32 *buf;
-	unsigned int v1;
 
 	/* la v1, _mcount */
-	v1 = 3;
-	buf = (u32 *)&insn_la_mcount[0];
-	UASM_i_LA(&buf, v1, MCOUNT_ADDR);
+	ftrace_uasm_la_v1(insn_la_mcount, MCOUNT_ADDR);
 
 	/* jal (ftrace_caller + 8), jump over the first two instruction */
 	buf = (u32 *)&insn_jal_ftrace_caller;
 	uasm_i_jal(&buf, (FTRACE_ADDR + 8) & JUMP_RANGE_MASK);
 
+#ifdef CONFIG_DYNAMIC_FTRACE_WITH_REGS
+	ftrace_uasm_la_v1(insn_la_ftrace_regs_caller, FTRACE_REGS_ADDR);
+
+	buf = (u32 *)&insn_jal_ftrace_regs_caller;
+	uasm_i_jal(&buf, (FTRACE_REGS_ADDR + 8) & JUMP_RANGE_MASK);
+#endif
+
 #ifdef CONFIG_FUNCTION_GRAPH_TRACER
 	/* j ftrace_graph_caller */
 	buf = (u32 *)&insn_j_ftrace_graph_caller;
 	uasm_i_j(&buf, (unsigned long)ftrace_graph_caller & JUMP_RANGE_MASK);
+#ifdef CONFIG_DYNAMIC_FTRACE_WITH_REGS
+	/* j ftrace_regs_graph_caller */
+	buf = (u32 *)&insn_j_ftrace_regs_graph_caller;
+	uasm_i_j(&buf,
+		 (unsigned long)ftrace_regs_graph_caller & JUMP_RANGE_MASK);
+#endif
 #endif
 }
 
 static int ftrace_modify_code(unsigned long ip, unsigned int new_code)
 {
 	int faulted;
-	mm_segment_t old_fs;
 
 	/* *(unsigned int *)ip = new_code; */
 	safe_store_code(new_code, ip, faulted);
@@ -85,10 +132,7 @@ static int ftrace_modify_code(unsigned long ip, unsigned int new_code)
 	if (unlikely(faulted))
 		return -EFAULT;
 
-	old_fs = get_fs();
-	set_fs(KERNEL_DS);
-	flush_icache_range(ip, ip + 8);
-	set_fs(old_fs);
+	ftrace_flush_icache(ip);
 
 	return 0;
 }
@@ -98,7 +142,6 @@ static int ftrace_modify_code_2(unsigned long ip, unsigned int new_code1,
 				unsigned int new_code2)
 {
 	int faulted;
-	mm_segment_t old_fs;
 
 	safe_store_code(new_code1, ip, faulted);
 	if (unlikely(faulted))
@@ -110,19 +153,16 @@ static int ftrace_modify_code_2(unsigned long ip, unsigned int new_code1,
 		return -EFAULT;
 
 	ip -= 4;
-	old_fs = get_fs();
-	set_fs(KERNEL_DS);
-	flush_icache_range(ip, ip + 8);
-	set_fs(old_fs);
+	ftrace_flush_icache(ip);
 
 	return 0;
 }
+#endif
 
 static int ftrace_modify_code_2r(unsigned long ip, unsigned int new_code1,
 				 unsigned int new_code2)
 {
 	int faulted;
-	mm_segment_t old_fs;
 
 	ip += 4;
 	safe_store_code(new_code2, ip, faulted);
@@ -134,14 +174,10 @@ static int ftrace_modify_code_2r(unsigned long ip, unsigned int new_code1,
 	if (unlikely(faulted))
 		return -EFAULT;
 
-	old_fs = get_fs();
-	set_fs(KERNEL_DS);
-	flush_icache_range(ip, ip + 8);
-	set_fs(old_fs);
+	ftrace_flush_icache(ip);
 
 	return 0;
 }
-#endif
 
 /*
  * The details about the calling site of mcount on MIPS
@@ -202,28 +238,71 @@ int ftrace_make_nop(struct module *mod,
 
 int ftrace_make_call(struct dyn_ftrace *rec, unsigned long addr)
 {
-	unsigned int new;
+	unsigned int *la = insn_la_mcount;
+	unsigned int new = insn_jal_ftrace_caller;
 	unsigned long ip = rec->ip;
 
-	new = core_kernel_text(ip) ? insn_jal_ftrace_caller : insn_la_mcount[0];
+#ifdef CONFIG_DYNAMIC_FTRACE_WITH_REGS
+	if (addr == FTRACE_REGS_ADDR) {
+		la = insn_la_ftrace_regs_caller;
+		new = insn_jal_ftrace_regs_caller;
+	}
+#endif
+
+	/*
+	 * Modules: the lui is currently a branch over the sequence, so the
+	 * addiu can be rewritten first and the lui re-enables the call.
+	 */
+	if (!core_kernel_text(ip))
+		return ftrace_modify_code_2r(ip, la[0], la[1]);
 
 #ifdef CONFIG_64BIT
 	return ftrace_modify_code(ip, new);
 #else
-	return ftrace_modify_code_2r(ip, new, core_kernel_text(ip) ?
-						INSN_NOP : insn_la_mcount[1]);
+	return ftrace_modify_code_2r(ip, new, INSN_NOP);
 #endif
 }
 
+#ifdef CONFIG_DYNAMIC_FTRACE_WITH_REGS
+int ftrace_modify_call(struct dyn_ftrace *rec, unsigned long old_addr,
+		       unsigned long addr)
+{
+	unsigned long ip = rec->ip;
+	int err;
+
+	/* A single jal swap for the kernel proper */
+	if (core_kernel_text(ip))
+		return ftrace_modify_code(ip, addr == FTRACE_REGS_ADDR ?
+					  insn_jal_ftrace_regs_caller :
+					  insn_jal_ftrace_caller);
+
+	/*
+	 * Module sites load the trampoline address with two instructions;
+	 * disable the site while the pair is inconsistent.
+	 */
+	err = ftrace_make_nop(NULL, rec, old_addr);
+	if (err)
+		return err;
+
+	return ftrace_make_call(rec, addr);
+}
+#endif
+
 #define FTRACE_CALL_IP ((unsigned long)(&ftrace_call))
 
 int ftrace_update_ftrace_func(ftrace_func_t func)
 {
 	unsigned int new;
+	int err;
 
 	new = INSN_JAL((unsigned long)func);
 
-	return ftrace_modify_code(FTRACE_CALL_IP, new);
+	err = ftrace_modify_code(FTRACE_CALL_IP, new);
+#ifdef CONFIG_DYNAMIC_FTRACE_WITH_REGS
+	if (!err)
+		err = ftrace_modify_code((unsigned long)&ftrace_regs_call, new);
+#endif
+	return err;
 }
 
 int __init ftrace_dyn_arch_init(void)
@@ -245,15 +324,34 @@ int __init ftrace_dyn_arch_init(void)
 extern void ftrace_graph_call(void);
 #define FTRACE_GRAPH_CALL_IP	((unsigned long)(&ftrace_graph_call))
 
+#ifdef CONFIG_DYNAMIC_FTRACE_WITH_REGS
+extern void ftrace_regs_graph_call(void);
+#endif
+
+/* ftrace_regs_caller has its own graph caller, which reloads all GPRs */
+static int ftrace_modify_graph_caller(bool enable)
+{
+	int err;
+
+	err = ftrace_modify_code(FTRACE_GRAPH_CALL_IP,
+				 enable ? insn_j_ftrace_graph_caller : INSN_NOP);
+#ifdef CONFIG_DYNAMIC_FTRACE_WITH_REGS
+	if (!err)
+		err = ftrace_modify_code((unsigned long)&ftrace_regs_graph_call,
+					 enable ? insn_j_ftrace_regs_graph_caller :
+						  INSN_NOP);
+#endif
+	return err;
+}
+
 int ftrace_enable_ftrace_graph_caller(void)
 {
-	return ftrace_modify_code(FTRACE_GRAPH_CALL_IP,
-			insn_j_ftrace_graph_caller);
+	return ftrace_modify_graph_caller(true);
 }
 
 int ftrace_disable_ftrace_graph_caller(void)
 {
-	return ftrace_modify_code(FTRACE_GRAPH_CALL_IP, INSN_NOP);
+	return ftrace_modify_graph_caller(false);
 }
 
 #endif	/* CONFIG_DYNAMIC_FTRACE */
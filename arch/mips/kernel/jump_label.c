@@ -35,8 +35,16 @@
 #define J_RANGE_MASK	((1ul << (26 + J_RANGE_SHIFT)) - 1)
 #define J_ALIGN_MASK	((1ul << J_RANGE_SHIFT) - 1)
 
-void arch_jump_label_transform(struct jump_entry *e,
-			       enum jump_label_type type)
+/*
+ * Static key updates patch every site of the key in a row, so the icache
+ * maintenance is batched and done once in arch_jump_label_transform_apply().
+ * Serialized by jump_label_mutex.
+ */
+static struct flush_icache_batch jump_label_flush = FLUSH_ICACHE_BATCH_INIT;
+
+/* Patch the site, the caller holds text_mutex and flushes the icache */
+static union mips_instruction *__jump_label_transform(struct jump_entry *e,
+						      enum jump_label_type type)
 {
 	union mips_instruction *insn_p;
 	union mips_instruction insn;
@@ -76,15 +84,44 @@ void arch_jump_label_transform(struct jump_entry *e,
 		insn.word = 0; /* nop */
 	}
 
-	mutex_lock(&text_mutex);
 	if (IS_ENABLED(CONFIG_CPU_MICROMIPS)) {
 		insn_p->halfword[0] = insn.word >> 16;
 		insn_p->halfword[1] = insn.word;
 	} else
 		*insn_p = insn;
 
+	return insn_p;
+}
+
+void arch_jump_label_transform(struct jump_entry *e,
+			       enum jump_label_type type)
+{
+	union mips_instruction *insn_p;
+
+	mutex_lock(&text_mutex);
+	insn_p = __jump_label_transform(e, type);
 	flush_icache_range((unsigned long)insn_p,
 			   (unsigned long)insn_p + sizeof(*insn_p));
+	mutex_unlock(&text_mutex);
+}
 
+bool arch_jump_label_transform_queue(struct jump_entry *e,
+				     enum jump_label_type type)
+{
+	union mips_instruction *insn_p;
+
+	mutex_lock(&text_mutex);
+	insn_p = __jump_label_transform(e, type);
+	flush_icache_batch_add(&jump_label_flush, (unsigned long)insn_p,
+			       (unsigned long)insn_p + sizeof(*insn_p));
+	mutex_unlock(&text_mutex);
+
+	return true;
+}
+
+void arch_jump_label_transform_apply(void)
+{
+	mutex_lock(&text_mutex);
+	flush_icache_batch_finish(&jump_label_flush);
 	mutex_unlock(&text_mutex);
 }
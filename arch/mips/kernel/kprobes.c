@@ -242,7 +242,24 @@ static void prepare_singlestep(struct kprobe *p, struct pt_regs *regs,
 			pr_notice("Kprobes: Error in evaluating branch\n");
 			return;
 		}
+	} else {
+		kcb->flags &= ~SKIP_DELAYSLOT;
 	}
+
+	/*
+	 * Simple instructions (the usual addiu/daddiu sp of a function
+	 * entry, for instance) are applied directly; the caller then
+	 * resumes as it does for a skipped delay slot, without taking the
+	 * single-step breakpoint.
+	 */
+	if (!(kcb->flags & SKIP_DELAYSLOT) &&
+	    p->opcode.word != breakpoint_insn.word &&
+	    p->opcode.word != breakpoint2_insn.word &&
+	    __insn_simulate(p->ainsn.insn[0], regs)) {
+		kcb->flags |= SKIP_DELAYSLOT;
+		return;
+	}
+
 	regs->cp0_epc = (unsigned long)&p->ainsn.insn[0];
 }
 
@@ -310,6 +327,7 @@ static int __kprobes kprobe_handler(struct pt_regs *regs)
 			kcb->kprobe_status = KPROBE_REENTER;
 			if (kcb->flags & SKIP_DELAYSLOT) {
 				resume_execution(p, regs, kcb);
+				regs->cp0_status |= kcb->kprobe_saved_SR;
 				restore_previous_kprobe(kcb);
 				preempt_enable_no_resched();
 			}
@@ -357,6 +375,8 @@ static int __kprobes kprobe_handler(struct pt_regs *regs)
 		if (p->post_handler)
 			p->post_handler(p, regs, 0);
 		resume_execution(p, regs, kcb);
+		regs->cp0_status |= kcb->kprobe_saved_SR;
+		reset_current_kprobe();
 		preempt_enable_no_resched();
 	} else
 		kcb->kprobe_status = KPROBE_HIT_SS;
@@ -42,6 +42,7 @@
 #include <linux/uaccess.h>
 #include <asm/mmu_context.h>
 #include <asm/mman.h>
+#include <asm/unistd.h>
 
 #ifdef __MIPSEB__
 #define merge_64(r1, r2) ((((r1) & 0xffffffffUL) << 32) + ((r2) & 0xffffffffUL))
@@ -131,3 +132,57 @@ asmlinkage long sys32_fallocate(int fd, int mode, unsigned offset_a2,
 	return ksys_fallocate(fd, mode, merge_64(offset_a2, offset_a3),
 			      merge_64(len_a4, len_a5));
 }
+
+#ifdef CONFIG_MIPS32_O32
+/*
+ * o32 syscalls known to take at most four arguments, for which handle_sys
+ * skips copying arguments 5-8 from the user stack.  Indexed by syscall
+ * number minus __NR_O32_Linux; anything not listed takes the slow path,
+ * so only add entries whose prototype has been checked.
+ */
+const u8 sys32_regargs[__NR_O32_Linux_syscalls] = {
+	[3]	= 1,	/* read */
+	[4]	= 1,	/* write */
+	[5]	= 1,	/* open */
+	[6]	= 1,	/* close */
+	[19]	= 1,	/* lseek */
+	[20]	= 1,	/* getpid */
+	[24]	= 1,	/* getuid */
+	[33]	= 1,	/* access */
+	[41]	= 1,	/* dup */
+	[45]	= 1,	/* brk */
+	[47]	= 1,	/* getgid */
+	[49]	= 1,	/* geteuid */
+	[50]	= 1,	/* getegid */
+	[54]	= 1,	/* ioctl */
+	[63]	= 1,	/* dup2 */
+	[64]	= 1,	/* getppid */
+	[78]	= 1,	/* gettimeofday */
+	[91]	= 1,	/* munmap */
+	[125]	= 1,	/* mprotect */
+	[145]	= 1,	/* readv */
+	[146]	= 1,	/* writev */
+	[162]	= 1,	/* sched_yield */
+	[166]	= 1,	/* nanosleep */
+	[168]	= 1,	/* accept */
+	[170]	= 1,	/* connect */
+	[177]	= 1,	/* recvmsg */
+	[179]	= 1,	/* sendmsg */
+	[183]	= 1,	/* socket */
+	[188]	= 1,	/* poll */
+	[195]	= 1,	/* rt_sigprocmask */
+	[213]	= 1,	/* stat64 */
+	[214]	= 1,	/* lstat64 */
+	[215]	= 1,	/* fstat64 */
+	[218]	= 1,	/* madvise */
+	[219]	= 1,	/* getdents64 */
+	[220]	= 1,	/* fcntl64 */
+	[222]	= 1,	/* gettid */
+	[246]	= 1,	/* exit_group */
+	[249]	= 1,	/* epoll_ctl */
+	[250]	= 1,	/* epoll_wait */
+	[263]	= 1,	/* clock_gettime */
+	[288]	= 1,	/* openat */
+	[403]	= 1,	/* clock_gettime64 */
+};
+#endif /* CONFIG_MIPS32_O32 */
@@ -0,0 +1,551 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Linux performance counter support for the Loongson-2F processor.
+ *
+ * The 2F does not implement the MIPS32/64 performance counter layout
+ * handled by perf_event_mipsxx.c.  It has two 32-bit counters packed into
+ * the 64-bit PerfCnt register and a single PerfCtrl register carrying both
+ * event selectors plus one set of mode and enable bits.  Each counter has
+ * its own sixteen events: raw events 0x00-0x0f select counter 0 and
+ * 0x10-0x1f counter 1, the numbering used by oprofile.  A counter
+ * overflows into bit 31 and interrupts through LOONGSON2_PERFCNT_IRQ.
+ *
+ * Because the mode bits are shared, both counters can only be in use at
+ * the same time by events with the same exclusion settings; an event that
+ * does not match is left for the core to multiplex.  A counter cannot be
+ * stopped on its own either, so an idle counter keeps counting and is
+ * simply reset should it overflow.
+ *
+ * Based on perf_event_mipsxx.c.
+ */
+
+#include <linux/interrupt.h>
+#include <linux/kernel.h>
+#include <linux/perf_event.h>
+
+#include <asm/cpu-type.h>
+#include <asm/irq_regs.h>
+
+#include <loongson.h>
+
+#define LOONGSON2_MAX_HWEVENTS	2
+#define LOONGSON2_MAX_PERIOD	(LOONGSON2_PERFCNT_OVERFLOW - 1)
+
+/* hwc->config holds the raw event number, bit 4 selects the counter */
+#define LOONGSON2_EVENT_CNTR(config)	(((config) >> 4) & 1)
+#define LOONGSON2_EVENT_SEL(config)	((config) & 0x0f)
+#define LOONGSON2_EVENT_NONE		0xff
+
+struct loongson2_hw_events {
+	struct perf_event	*events[LOONGSON2_MAX_HWEVENTS];
+	/* mode bits shared by the events in use */
+	unsigned int		mode;
+	/* set between pmu_enable and pmu_disable */
+	bool			enabled;
+};
+
+/* The 2F is uniprocessor, so there is only one set of counters. */
+static struct loongson2_hw_events loongson2_hw;
+
+static const u8 loongson2_event_map[PERF_COUNT_HW_MAX] = {
+	[0 ... PERF_COUNT_HW_MAX - 1]		= LOONGSON2_EVENT_NONE,
+	[PERF_COUNT_HW_CPU_CYCLES]		= 0x00,
+	[PERF_COUNT_HW_INSTRUCTIONS]		= 0x10,
+	[PERF_COUNT_HW_BRANCH_INSTRUCTIONS]	= 0x01,
+	[PERF_COUNT_HW_BRANCH_MISSES]		= 0x11,
+};
+
+#define C(x) PERF_COUNT_HW_CACHE_##x
+
+static const u8 loongson2_cache_map
+				[PERF_COUNT_HW_CACHE_MAX]
+				[PERF_COUNT_HW_CACHE_OP_MAX]
+				[PERF_COUNT_HW_CACHE_RESULT_MAX] = {
+[0 ... C(MAX) - 1] = {
+	[0 ... C(OP_MAX) - 1] = {
+		[0 ... C(RESULT_MAX) - 1] = LOONGSON2_EVENT_NONE,
+	},
+},
+[C(L1D)] = {
+	/* the data cache miss event counts loads and stores alike */
+	[C(OP_READ)] = {
+		[C(RESULT_MISS)]	= 0x14,
+	},
+	[C(OP_WRITE)] = {
+		[C(RESULT_MISS)]	= 0x14,
+	},
+},
+[C(L1I)] = {
+	[C(OP_READ)] = {
+		[C(RESULT_MISS)]	= 0x04,
+	},
+},
+[C(DTLB)] = {
+	/* JTLB refill exceptions, a miss in the unified JTLB */
+	[C(OP_READ)] = {
+		[C(RESULT_MISS)]	= 0x0d,
+	},
+	[C(OP_WRITE)] = {
+		[C(RESULT_MISS)]	= 0x0d,
+	},
+},
+[C(ITLB)] = {
+	[C(OP_READ)] = {
+		[C(RESULT_MISS)]	= 0x1c,
+	},
+},
+[C(BPU)] = {
+	[C(OP_READ)] = {
+		[C(RESULT_ACCESS)]	= 0x08,
+		[C(RESULT_MISS)]	= 0x18,
+	},
+},
+};
+
+static u64 loongson2_pmu_read_counter(unsigned int idx)
+{
+	u64 cnt = read_c0_perfcnt();
+
+	return idx ? cnt >> 32 : cnt & 0xffffffff;
+}
+
+static void loongson2_pmu_write_counter(unsigned int idx, u64 val)
+{
+	u64 cnt = read_c0_perfcnt();
+
+	if (idx)
+		cnt = (cnt & 0xffffffff) | (val << 32);
+	else
+		cnt = (cnt & ~0xffffffffULL) | (val & 0xffffffff);
+	write_c0_perfcnt(cnt);
+}
+
+/* Recompute PerfCtrl from the running events, must be called irqs off */
+static void loongson2_pmu_write_ctrl(void)
+{
+	struct perf_event *event;
+	u64 ctrl = 0;
+	int idx;
+
+	for (idx = 0; idx < LOONGSON2_MAX_HWEVENTS; idx++) {
+		event = loongson2_hw.events[idx];
+		if (!event || (event->hw.state & PERF_HES_STOPPED))
+			continue;
+		ctrl |= LOONGSON2_PERFCTRL_EVENT(idx,
+				LOONGSON2_EVENT_SEL(event->hw.config));
+		ctrl |= LOONGSON2_PERFCTRL_ENABLE;
+	}
+
+	if (ctrl && loongson2_hw.enabled)
+		ctrl |= loongson2_hw.mode;
+	else
+		ctrl = 0;
+
+	write_c0_perfctrl(ctrl);
+}
+
+static int loongson2_pmu_event_set_period(struct perf_event *event)
+{
+	struct hw_perf_event *hwc = &event->hw;
+	s64 left = local64_read(&hwc->period_left);
+	s64 period = hwc->sample_period;
+	int ret = 0;
+
+	if (unlikely(left <= -period)) {
+		left = period;
+		local64_set(&hwc->period_left, left);
+		hwc->last_period = period;
+		ret = 1;
+	} else if (unlikely(left <= 0)) {
+		left += period;
+		local64_set(&hwc->period_left, left);
+		hwc->last_period = period;
+		ret = 1;
+	}
+
+	if (left > LOONGSON2_MAX_PERIOD) {
+		left = LOONGSON2_MAX_PERIOD;
+		local64_set(&hwc->period_left, left);
+	}
+
+	local64_set(&hwc->prev_count, LOONGSON2_PERFCNT_OVERFLOW - left);
+	loongson2_pmu_write_counter(hwc->idx,
+				    LOONGSON2_PERFCNT_OVERFLOW - left);
+
+	perf_event_update_userpage(event);
+
+	return ret;
+}
+
+static void loongson2_pmu_event_update(struct perf_event *event)
+{
+	struct hw_perf_event *hwc = &event->hw;
+	u64 prev_raw_count, new_raw_count;
+	u64 delta;
+
+again:
+	prev_raw_count = local64_read(&hwc->prev_count);
+	new_raw_count = loongson2_pmu_read_counter(hwc->idx);
+
+	if (local64_cmpxchg(&hwc->prev_count, prev_raw_count,
+				new_raw_count) != prev_raw_count)
+		goto again;
+
+	delta = (new_raw_count - prev_raw_count) & 0xffffffff;
+
+	local64_add(delta, &event->count);
+	local64_sub(delta, &hwc->period_left);
+}
+
+static void loongson2_pmu_start(struct perf_event *event, int flags)
+{
+	struct hw_perf_event *hwc = &event->hw;
+	unsigned long irqflags;
+
+	if (flags & PERF_EF_RELOAD)
+		WARN_ON_ONCE(!(hwc->state & PERF_HES_UPTODATE));
+
+	local_irq_save(irqflags);
+	hwc->state = 0;
+	loongson2_pmu_event_set_period(event);
+	loongson2_pmu_write_ctrl();
+	local_irq_restore(irqflags);
+}
+
+static void loongson2_pmu_stop(struct perf_event *event, int flags)
+{
+	struct hw_perf_event *hwc = &event->hw;
+	unsigned long irqflags;
+
+	if (hwc->state & PERF_HES_STOPPED)
+		return;
+
+	local_irq_save(irqflags);
+	hwc->state |= PERF_HES_STOPPED;
+	loongson2_pmu_write_ctrl();
+	loongson2_pmu_event_update(event);
+	hwc->state |= PERF_HES_UPTODATE;
+	local_irq_restore(irqflags);
+}
+
+/* Can the event go on its counter next to the events already in hw? */
+static int loongson2_pmu_can_schedule(struct loongson2_hw_events *hw,
+				      struct perf_event *event)
+{
+	struct hw_perf_event *hwc = &event->hw;
+	int idx = LOONGSON2_EVENT_CNTR(hwc->config);
+	struct perf_event *other = hw->events[!idx];
+
+	if (hw->events[idx])
+		return -EAGAIN;
+	if (other && other->hw.config_base != hwc->config_base)
+		return -EAGAIN;
+
+	return idx;
+}
+
+static int loongson2_pmu_add(struct perf_event *event, int flags)
+{
+	struct hw_perf_event *hwc = &event->hw;
+	int idx;
+	int err = 0;
+
+	perf_pmu_disable(event->pmu);
+
+	idx = loongson2_pmu_can_schedule(&loongson2_hw, event);
+	if (idx < 0) {
+		err = idx;
+		goto out;
+	}
+
+	hwc->idx = idx;
+	hwc->state = PERF_HES_STOPPED | PERF_HES_UPTODATE;
+	loongson2_hw.events[idx] = event;
+	loongson2_hw.mode = hwc->config_base;
+
+	if (flags & PERF_EF_START)
+		loongson2_pmu_start(event, PERF_EF_RELOAD);
+
+	/* Propagate our changes to the userspace mapping. */
+	perf_event_update_userpage(event);
+
+out:
+	perf_pmu_enable(event->pmu);
+	return err;
+}
+
+static void loongson2_pmu_del(struct perf_event *event, int flags)
+{
+	struct hw_perf_event *hwc = &event->hw;
+
+	loongson2_pmu_stop(event, PERF_EF_UPDATE);
+	loongson2_hw.events[hwc->idx] = NULL;
+	hwc->idx = -1;
+
+	perf_event_update_userpage(event);
+}
+
+static void loongson2_pmu_read(struct perf_event *event)
+{
+	/* Don't read disabled counters! */
+	if (event->hw.idx < 0)
+		return;
+
+	loongson2_pmu_event_update(event);
+}
+
+static void loongson2_pmu_enable(struct pmu *pmu)
+{
+	unsigned long flags;
+
+	local_irq_save(flags);
+	loongson2_hw.enabled = true;
+	loongson2_pmu_write_ctrl();
+	local_irq_restore(flags);
+}
+
+static void loongson2_pmu_disable(struct pmu *pmu)
+{
+	unsigned long flags;
+
+	local_irq_save(flags);
+	loongson2_hw.enabled = false;
+	write_c0_perfctrl(0);
+	local_irq_restore(flags);
+}
+
+static irqreturn_t loongson2_pmu_handle_irq(int irq, void *dev)
+{
+	struct perf_sample_data data;
+	struct pt_regs *regs = get_irq_regs();
+	struct perf_event *event;
+	irqreturn_t handled = IRQ_NONE;
+	u64 counter;
+	int idx;
+
+	if (!(read_c0_perfctrl() & LOONGSON2_PERFCTRL_ENABLE))
+		return IRQ_NONE;
+
+	/* pause both counters while we look at them */
+	write_c0_perfctrl(0);
+
+	for (idx = 0; idx < LOONGSON2_MAX_HWEVENTS; idx++) {
+		counter = loongson2_pmu_read_counter(idx);
+		if (!(counter & LOONGSON2_PERFCNT_OVERFLOW))
+			continue;
+		handled = IRQ_HANDLED;
+
+		event = loongson2_hw.events[idx];
+		if (!event || (event->hw.state & PERF_HES_STOPPED)) {
+			/* an idle counter still counts, keep it quiet */
+			loongson2_pmu_write_counter(idx, 0);
+			continue;
+		}
+
+		loongson2_pmu_event_update(event);
+		perf_sample_data_init(&data, 0, event->hw.last_period);
+		if (!loongson2_pmu_event_set_period(event))
+			continue;
+
+		if (perf_event_overflow(event, &data, regs))
+			loongson2_pmu_stop(event, 0);
+	}
+
+	loongson2_pmu_write_ctrl();
+
+	/*
+	 * Do all the work for the pending perf events. We can do this
+	 * in here because the performance counter interrupt is a regular
+	 * interrupt, not NMI.
+	 */
+	if (handled == IRQ_HANDLED)
+		irq_work_run();
+
+	return handled;
+}
+
+static atomic_t active_events = ATOMIC_INIT(0);
+static DEFINE_MUTEX(pmu_reserve_mutex);
+
+static void loongson2_pmu_reset(void)
+{
+	write_c0_perfctrl(0);
+	write_c0_perfcnt(0);
+}
+
+static void hw_perf_event_destroy(struct perf_event *event)
+{
+	if (atomic_dec_and_mutex_lock(&active_events, &pmu_reserve_mutex)) {
+		loongson2_pmu_reset();
+		free_irq(LOONGSON2_PERFCNT_IRQ, &loongson2_hw);
+		mutex_unlock(&pmu_reserve_mutex);
+	}
+}
+
+static int loongson2_pmu_get_irq(void)
+{
+	int err;
+
+	err = request_irq(LOONGSON2_PERFCNT_IRQ, loongson2_pmu_handle_irq,
+			  IRQF_PERCPU | IRQF_NOBALANCING | IRQF_NO_THREAD |
+			  IRQF_NO_SUSPEND | IRQF_SHARED,
+			  "loongson2_perf_pmu", &loongson2_hw);
+	if (err)
+		pr_warn("Unable to request IRQ%d for Loongson-2F performance counters!\n",
+			LOONGSON2_PERFCNT_IRQ);
+
+	return err;
+}
+
+static int loongson2_pmu_map_event(struct perf_event *event)
+{
+	unsigned int cache_type, cache_op, cache_result;
+	u64 config = event->attr.config;
+	unsigned int ev;
+
+	switch (event->attr.type) {
+	case PERF_TYPE_HARDWARE:
+		if (config >= PERF_COUNT_HW_MAX)
+			return -EINVAL;
+		ev = loongson2_event_map[config];
+		break;
+	case PERF_TYPE_HW_CACHE:
+		cache_type = (config >> 0) & 0xff;
+		cache_op = (config >> 8) & 0xff;
+		cache_result = (config >> 16) & 0xff;
+		if (cache_type >= PERF_COUNT_HW_CACHE_MAX ||
+		    cache_op >= PERF_COUNT_HW_CACHE_OP_MAX ||
+		    cache_result >= PERF_COUNT_HW_CACHE_RESULT_MAX)
+			return -EINVAL;
+		ev = loongson2_cache_map[cache_type][cache_op][cache_result];
+		break;
+	case PERF_TYPE_RAW:
+		if (config > 0x1f)
+			return -EINVAL;
+		ev = config;
+		break;
+	default:
+		return -ENOENT;
+	}
+
+	if (ev == LOONGSON2_EVENT_NONE)
+		return -EOPNOTSUPP;
+
+	return ev;
+}
+
+static int validate_group(struct perf_event *event)
+{
+	struct perf_event *sibling, *leader = event->group_leader;
+	struct loongson2_hw_events fake_hw;
+	int idx;
+
+	memset(&fake_hw, 0, sizeof(fake_hw));
+
+	/* a software leader takes no counter */
+	if (leader->pmu == event->pmu) {
+		idx = loongson2_pmu_can_schedule(&fake_hw, leader);
+		if (idx < 0)
+			return -EINVAL;
+		fake_hw.events[idx] = leader;
+	}
+
+	for_each_sibling_event(sibling, leader) {
+		if (sibling->pmu != event->pmu)
+			continue;
+		idx = loongson2_pmu_can_schedule(&fake_hw, sibling);
+		if (idx < 0)
+			return -EINVAL;
+		fake_hw.events[idx] = sibling;
+	}
+
+	if (loongson2_pmu_can_schedule(&fake_hw, event) < 0)
+		return -EINVAL;
+
+	return 0;
+}
+
+static int loongson2_pmu_event_init(struct perf_event *event)
+{
+	struct perf_event_attr *attr = &event->attr;
+	struct hw_perf_event *hwc = &event->hw;
+	int ev, err = 0;
+
+	/* does not support taken branch sampling */
+	if (has_branch_stack(event))
+		return -EOPNOTSUPP;
+
+	ev = loongson2_pmu_map_event(event);
+	if (ev < 0)
+		return ev;
+
+	if (event->cpu >= 0 && !cpu_online(event->cpu))
+		return -ENODEV;
+
+	hwc->config = ev;
+	hwc->config_base = 0;
+	if (!attr->exclude_user)
+		hwc->config_base |= LOONGSON2_PERFCTRL_USER;
+	if (!attr->exclude_kernel) {
+		hwc->config_base |= LOONGSON2_PERFCTRL_KERNEL;
+		/* MIPS kernel mode: KSU == 00b || EXL == 1 || ERL == 1 */
+		hwc->config_base |= LOONGSON2_PERFCTRL_EXL;
+	}
+	if (!attr->exclude_hv)
+		hwc->config_base |= LOONGSON2_PERFCTRL_SUPERVISOR;
+	hwc->idx = -1;
+
+	if (!hwc->sample_period) {
+		hwc->sample_period  = LOONGSON2_MAX_PERIOD;
+		hwc->last_period    = hwc->sample_period;
+		local64_set(&hwc->period_left, hwc->sample_period);
+	}
+
+	if (event->group_leader != event) {
+		err = validate_group(event);
+		if (err)
+			return err;
+	}
+
+	if (!atomic_inc_not_zero(&active_events)) {
+		mutex_lock(&pmu_reserve_mutex);
+		if (atomic_read(&active_events) == 0)
+			err = loongson2_pmu_get_irq();
+
+		if (!err)
+			atomic_inc(&active_events);
+		mutex_unlock(&pmu_reserve_mutex);
+	}
+
+	if (err)
+		return err;
+
+	event->destroy = hw_perf_event_destroy;
+
+	return 0;
+}
+
+static struct pmu pmu = {
+	.pmu_enable	= loongson2_pmu_enable,
+	.pmu_disable	= loongson2_pmu_disable,
+	.event_init	= loongson2_pmu_event_init,
+	.add		= loongson2_pmu_add,
+	.del		= loongson2_pmu_del,
+	.start		= loongson2_pmu_start,
+	.stop		= loongson2_pmu_stop,
+	.read		= loongson2_pmu_read,
+};
+
+static int __init init_hw_perf_events(void)
+{
+	if (current_cpu_type() != CPU_LOONGSON2EF)
+		return -ENODEV;
+
+	loongson2_pmu_reset();
+
+	pr_info("Performance counters: loongson2 PMU enabled, %d 32-bit counters, irq %d\n",
+		LOONGSON2_MAX_HWEVENTS, LOONGSON2_PERFCNT_IRQ);
+
+	return perf_pmu_register(&pmu, "cpu", PERF_TYPE_RAW);
+}
+early_initcall(init_hw_perf_events);
@@ -8,6 +8,7 @@
 #define __PROBES_COMMON_H
 
 #include <asm/inst.h>
+#include <asm/ptrace.h>
 
 int __insn_is_compact_branch(union mips_instruction insn);
 
@@ -76,4 +77,118 @@ static inline int __insn_has_delay_slot(const union mips_instruction insn)
 	return 0;
 }
 
+/*
+ * Branch-likely instructions, whose delay slot is nullified when the
+ * branch is not taken.  R6 reuses their encodings for compact branches.
+ */
+static inline int __insn_is_branch_likely(union mips_instruction insn)
+{
+#ifndef CONFIG_CPU_MIPSR6
+	switch (insn.i_format.opcode) {
+	case beql_op:
+	case bnel_op:
+	case blezl_op:
+	case bgtzl_op:
+		return 1;
+	case bcond_op:
+		switch (insn.i_format.rt) {
+		case bltzl_op:
+		case bgezl_op:
+		case bltzall_op:
+		case bgezall_op:
+			return 1;
+		}
+		break;
+	case cop1_op:
+		/* bc1fl and bc1tl have the nd bit set */
+		if (insn.i_format.rs == bc_op)
+			return !!(insn.i_format.rt & 2);
+		break;
+	}
+#endif
+	return 0;
+}
+
+/*
+ * Emulate the handful of simple ALU instructions that make up most probed
+ * sites (stack frame setup, constant loads, register moves) so the probe
+ * can resume without a second exception.  Returns 1 if @insn has been
+ * applied to @regs, 0 if it has to be single-stepped.  With a NULL @regs
+ * this only checks whether @insn could be emulated.
+ */
+static inline int __insn_simulate(const union mips_instruction insn,
+				  struct pt_regs *regs)
+{
+	static const unsigned long none[32];
+	const unsigned long *r = regs ? regs->regs : none;
+	unsigned long val;
+	unsigned int dst;
+
+	switch (insn.i_format.opcode) {
+	case addiu_op:
+		dst = insn.i_format.rt;
+		val = (s32)((u32)r[insn.i_format.rs] + insn.i_format.simmediate);
+		break;
+#ifdef CONFIG_64BIT
+	case daddiu_op:
+		dst = insn.i_format.rt;
+		val = r[insn.i_format.rs] + insn.i_format.simmediate;
+		break;
+#endif
+	case lui_op:
+		/* rs != 0 is aui on R6 */
+		if (insn.u_format.rs)
+			return 0;
+		dst = insn.u_format.rt;
+		val = (s32)(insn.u_format.uimmediate << 16);
+		break;
+	case ori_op:
+		dst = insn.u_format.rt;
+		val = r[insn.u_format.rs] | insn.u_format.uimmediate;
+		break;
+	case andi_op:
+		dst = insn.u_format.rt;
+		val = r[insn.u_format.rs] & insn.u_format.uimmediate;
+		break;
+	case spec_op:
+		dst = insn.r_format.rd;
+		switch (insn.r_format.func) {
+		case sll_op:
+			/* includes nop, ssnop and ehb */
+			if (insn.r_format.rs)
+				return 0;
+			val = (s32)((u32)r[insn.r_format.rt] << insn.r_format.re);
+			break;
+		case addu_op:
+			if (insn.r_format.re)
+				return 0;
+			val = (s32)((u32)r[insn.r_format.rs] +
+				    (u32)r[insn.r_format.rt]);
+			break;
+#ifdef CONFIG_64BIT
+		case daddu_op:
+			if (insn.r_format.re)
+				return 0;
+			val = r[insn.r_format.rs] + r[insn.r_format.rt];
+			break;
+#endif
+		case or_op:
+			if (insn.r_format.re)
+				return 0;
+			val = r[insn.r_format.rs] | r[insn.r_format.rt];
+			break;
+		default:
+			return 0;
+		}
+		break;
+	default:
+		return 0;
+	}
+
+	if (regs && dst)
+		regs->regs[dst] = val;
+
+	return 1;
+}
+
 #endif  /* __PROBES_COMMON_H */
@@ -182,6 +182,9 @@ int copy_thread(unsigned long clone_flags, unsigned long usp,
 	atomic_set(&p->thread.bd_emu_frame, BD_EMUFRAME_NONE);
 #endif
 
+	p->thread.unaligned_fixups = 0;
+	p->thread.unaligned_fast_fixups = 0;
+
 	if (clone_flags & CLONE_SETTLS)
 		ti->tp_value = tls;
 
@@ -11,6 +11,8 @@
 #include <asm/bootinfo.h>
 #include <asm/cacheflush.h>
 #include <asm/fw/fw.h>
+#include <asm/isa-rev.h>
+#include <asm/r4kcache.h>
 #include <asm/sections.h>
 #include <asm/setup.h>
 #include <asm/timex.h>
@@ -43,6 +45,7 @@ int __weak plat_post_relocation(long offset)
 	return 0;
 }
 
+#if MIPS_ISA_REV >= 2
 static inline u32 __init get_synci_step(void)
 {
 	u32 res;
@@ -69,6 +72,33 @@ static void __init sync_icache(void *kbase, unsigned long kernel_length)
 	/* Completion barrier */
 	__sync();
 }
+#else
+/*
+ * There is no synci before R2, so write back the D-cache and invalidate
+ * the I-cache line by line.  cpu_probe() has not run yet: step by the
+ * smallest line size the configured CPUs can have.
+ */
+#ifdef CONFIG_CPU_LOONGSON2EF
+#define RELOC_CACHE_STEP	32
+#define RELOC_HIT_INV_I		Hit_Invalidate_I_Loongson2
+#else
+#define RELOC_CACHE_STEP	16
+#define RELOC_HIT_INV_I		Hit_Invalidate_I
+#endif
+
+static void __init sync_icache(void *kbase, unsigned long kernel_length)
+{
+	unsigned long addr = (unsigned long)kbase & ~(RELOC_CACHE_STEP - 1);
+	unsigned long kend = (unsigned long)kbase + kernel_length;
+
+	for (; addr < kend; addr += RELOC_CACHE_STEP) {
+		cache_op(Hit_Writeback_Inv_D, addr);
+		cache_op(RELOC_HIT_INV_I, addr);
+	}
+
+	__sync();
+}
+#endif /* MIPS_ISA_REV >= 2 */
 
 static int __init apply_r_mips_64_rel(u32 *loc_orig, u32 *loc_new, long offset)
 {
@@ -1,13 +1,38 @@
 // SPDX-License-Identifier: GPL-2.0
 #include <linux/cpu.h>
+#include <linux/cpufreq.h>
 #include <linux/cpumask.h>
 #include <linux/init.h>
 #include <linux/node.h>
 #include <linux/nodemask.h>
 #include <linux/percpu.h>
+#include <linux/sched.h>
 
 static DEFINE_PER_CPU(struct cpu, cpu_devices);
 
+#if defined(CONFIG_CPU_FREQ) && !defined(CONFIG_GENERIC_ARCH_TOPOLOGY)
+DEFINE_PER_CPU(unsigned long, freq_scale) = SCHED_CAPACITY_SCALE;
+
+/*
+ * Frequency invariance for PELT: cpufreq drivers report every change of
+ * the current frequency, the scheduler scales utilization accordingly.
+ */
+void arch_set_freq_scale(struct cpumask *cpus, unsigned long cur_freq,
+			 unsigned long max_freq)
+{
+	unsigned long scale;
+	int i;
+
+	if (!max_freq)
+		return;
+
+	scale = (cur_freq << SCHED_CAPACITY_SHIFT) / max_freq;
+
+	for_each_cpu(i, cpus)
+		per_cpu(freq_scale, i) = scale;
+}
+#endif
+
 static int __init topology_init(void)
 {
 	int i, ret;
@@ -79,7 +79,10 @@
 #include <linux/smp.h>
 #include <linux/sched.h>
 #include <linux/debugfs.h>
+#include <linux/percpu.h>
 #include <linux/perf_event.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
 
 #include <asm/asm.h>
 #include <asm/branch.h>
@@ -100,12 +103,173 @@ enum {
 };
 #ifdef CONFIG_DEBUG_FS
 static u32 unaligned_instructions;
+static u32 unaligned_fast_instructions;
 static u32 unaligned_action;
 #else
 #define unaligned_action UNALIGNED_ACTION_QUIET
 #endif
 extern void show_registers(struct pt_regs *regs);
 
+/*
+ * Programs built for CPUs that handle unaligned accesses in hardware
+ * tend to fault on the same few loads and stores over and over again.
+ * Each CPU remembers the last faulting user instructions, keyed by EPC
+ * and mm, along with whether they are plain integer loads or stores that
+ * emulate_unaligned_fast() can handle without the full decoder, branch
+ * emulation and set_fs() dance.  The instruction word is re-read and
+ * compared on every hit, so a remapped or rewritten text page simply
+ * misses.  The hit counts show where the offenders are, see
+ * unaligned_hot in debugfs.
+ */
+#define UNALIGNED_CACHE_SIZE	16
+
+struct unaligned_cache_entry {
+	unsigned long epc;
+	struct mm_struct *mm;
+	pid_t pid;
+	u32 word;
+	u32 hits;
+	bool fast;
+};
+
+static DEFINE_PER_CPU(struct unaligned_cache_entry [UNALIGNED_CACHE_SIZE],
+		      unaligned_cache);
+
+static bool unaligned_insn_is_fast(union mips_instruction insn)
+{
+	switch (insn.i_format.opcode) {
+	case lh_op:
+	case lhu_op:
+	case lw_op:
+	case sh_op:
+	case sw_op:
+		return true;
+#ifdef CONFIG_64BIT
+	case lwu_op:
+	case ld_op:
+	case sd_op:
+		return true;
+#endif
+	default:
+		return false;
+	}
+}
+
+/* Returns false to leave the fault, including any signal, to the slow path */
+static bool emulate_unaligned_fast(struct pt_regs *regs)
+{
+	unsigned int __user *pc = (unsigned int __user *)regs->cp0_epc;
+	void __user *addr = (void __user *)regs->cp0_badvaddr;
+	struct unaligned_cache_entry *e;
+	union mips_instruction insn;
+	unsigned long value;
+	unsigned int res;
+	int rt, size;
+	bool fast;
+
+	/* EVA needs the E variants and branch delay slots need branch emulation */
+	if (IS_ENABLED(CONFIG_EVA) || delay_slot(regs))
+		return false;
+
+	if (__get_user(insn.word, pc))
+		return false;
+
+	e = &get_cpu_var(unaligned_cache)[(regs->cp0_epc >> 2) %
+					  UNALIGNED_CACHE_SIZE];
+	if (e->epc == regs->cp0_epc && e->mm == current->mm &&
+	    e->word == insn.word) {
+		e->hits++;
+	} else {
+		e->epc = regs->cp0_epc;
+		e->mm = current->mm;
+		e->pid = task_pid_nr(current);
+		e->word = insn.word;
+		e->hits = 1;
+		e->fast = unaligned_insn_is_fast(insn);
+	}
+	fast = e->fast;
+	put_cpu_var(unaligned_cache);
+
+	if (!fast)
+		return false;
+
+	rt = insn.i_format.rt;
+	switch (insn.i_format.opcode) {
+	case lh_op:
+	case lhu_op:
+	case sh_op:
+		size = 2;
+		break;
+	case ld_op:
+	case sd_op:
+		size = 8;
+		break;
+	default:
+		size = 4;
+		break;
+	}
+	if (!access_ok(addr, size))
+		return false;
+
+	perf_sw_event(PERF_COUNT_SW_EMULATION_FAULTS, 1, regs, 0);
+
+	switch (insn.i_format.opcode) {
+	case lh_op:
+		LoadHW(addr, value, res);
+		break;
+	case lhu_op:
+		LoadHWU(addr, value, res);
+		break;
+	case lw_op:
+		LoadW(addr, value, res);
+		break;
+	case sh_op:
+		value = regs->regs[rt];
+		StoreHW(addr, value, res);
+		break;
+	case sw_op:
+		value = regs->regs[rt];
+		StoreW(addr, value, res);
+		break;
+#ifdef CONFIG_64BIT
+	case lwu_op:
+		LoadWU(addr, value, res);
+		break;
+	case ld_op:
+		LoadDW(addr, value, res);
+		break;
+	case sd_op:
+		value = regs->regs[rt];
+		StoreDW(addr, value, res);
+		break;
+#endif
+	default:
+		return false;
+	}
+	if (res)
+		return false;
+
+	switch (insn.i_format.opcode) {
+	case sh_op:
+	case sw_op:
+	case sd_op:
+		break;
+	default:
+		regs->regs[rt] = value;
+		break;
+	}
+	regs->cp0_epc += 4;
+
+#ifdef CONFIG_DEBUG_FS
+	unaligned_instructions++;
+	unaligned_fast_instructions++;
+#endif
+	current->thread.unaligned_fixups++;
+	current->thread.unaligned_fast_fixups++;
+
+	return true;
+}
+
 static void emulate_load_store_insn(struct pt_regs *regs,
 	void __user *addr, unsigned int __user *pc)
 {
@@ -579,6 +743,7 @@ static void emulate_load_store_insn(struct pt_regs *regs,
 #ifdef CONFIG_DEBUG_FS
 	unaligned_instructions++;
 #endif
+	current->thread.unaligned_fixups++;
 
 	return;
 
@@ -1206,6 +1371,7 @@ static void emulate_load_store_microMIPS(struct pt_regs *regs,
 #ifdef CONFIG_DEBUG_FS
 	unaligned_instructions++;
 #endif
+	current->thread.unaligned_fixups++;
 	return;
 
 fault:
@@ -1485,6 +1651,7 @@ static void emulate_load_store_MIPS16e(struct pt_regs *regs, void __user * addr)
 #ifdef CONFIG_DEBUG_FS
 	unaligned_instructions++;
 #endif
+	current->thread.unaligned_fixups++;
 
 	return;
 
@@ -1576,6 +1743,10 @@ asmlinkage void do_ade(struct pt_regs *regs)
 		goto sigbus;
 	}
 
+	if (unaligned_action == UNALIGNED_ACTION_QUIET && user_mode(regs) &&
+	    emulate_unaligned_fast(regs))
+		return;
+
 	if (unaligned_action == UNALIGNED_ACTION_SHOW)
 		show_registers(regs);
 	pc = (unsigned int __user *)exception_epc(regs);
@@ -1598,11 +1769,48 @@ asmlinkage void do_ade(struct pt_regs *regs)
 	exception_exit(prev_state);
 }
 
+#ifdef CONFIG_PROC_PID_ARCH_STATUS
+/* /proc/<pid>/arch_status */
+int proc_pid_arch_status(struct seq_file *m, struct pid_namespace *ns,
+			 struct pid *pid, struct task_struct *task)
+{
+	seq_printf(m, "UnalignedFixups:\t%lu\n",
+		   task->thread.unaligned_fixups);
+	seq_printf(m, "UnalignedFastFixups:\t%lu\n",
+		   task->thread.unaligned_fast_fixups);
+	return 0;
+}
+#endif
+
 #ifdef CONFIG_DEBUG_FS
+static int unaligned_hot_show(struct seq_file *s, void *unused)
+{
+	struct unaligned_cache_entry *e;
+	int cpu, i;
+
+	seq_puts(s, "cpu pid epc insn hits\n");
+	for_each_online_cpu(cpu) {
+		e = per_cpu(unaligned_cache, cpu);
+		for (i = 0; i < UNALIGNED_CACHE_SIZE; i++, e++) {
+			if (!e->hits)
+				continue;
+			seq_printf(s, "%d %d %0*lx %08x %u\n", cpu, e->pid,
+				   2 * (int)sizeof(long), e->epc, e->word,
+				   e->hits);
+		}
+	}
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(unaligned_hot);
+
 static int __init debugfs_unaligned(void)
 {
 	debugfs_create_u32("unaligned_instructions", S_IRUGO, mips_debugfs_dir,
 			   &unaligned_instructions);
+	debugfs_create_u32("unaligned_fast_instructions", S_IRUGO,
+			   mips_debugfs_dir, &unaligned_fast_instructions);
+	debugfs_create_file("unaligned_hot", S_IRUGO, mips_debugfs_dir, NULL,
+			    &unaligned_hot_fops);
 	debugfs_create_u32("unaligned_action", S_IRUGO | S_IWUSR,
 			   mips_debugfs_dir, &unaligned_action);
 	return 0;
@@ -254,9 +254,37 @@ unsigned long uprobe_get_swbp_addr(struct pt_regs *regs)
  * See if the instruction can be emulated.
  * Returns true if instruction was emulated, false otherwise.
  *
- * For now we always emulate so this function just returns 0.
+ * Simple ALU instructions, on their own or in the delay slot of a branch,
+ * are applied to @regs directly: this saves the trip through the XOL slot
+ * and the second breakpoint exception.
  */
 bool arch_uprobe_skip_sstep(struct arch_uprobe *auprobe, struct pt_regs *regs)
 {
-	return 0;
+	union mips_instruction insn = { .word = auprobe->insn[0] };
+	union mips_instruction ds = { .word = auprobe->insn[1] };
+	int ret;
+
+	if (!insn_has_delay_slot(insn)) {
+		if (!__insn_simulate(insn, regs))
+			return false;
+		regs->cp0_epc += 4;
+		return true;
+	}
+
+	/* Check the delay slot first, the branch evaluation updates regs */
+	if (!__insn_simulate(ds, NULL))
+		return false;
+
+	ret = __compute_return_epc_for_insn(regs, insn);
+	if (ret < 0)
+		return true;	/* signal already queued */
+
+	/*
+	 * The delay slot runs, except after a branch-likely that is not
+	 * taken, which nullifies it.
+	 */
+	if (!__insn_is_branch_likely(insn) || ret == BRANCH_LIKELY_TAKEN)
+		__insn_simulate(ds, regs);
+
+	return true;
 }
@@ -14,7 +14,6 @@
 #include <linux/io.h>
 #include <linux/init.h>
 #include <linux/export.h>
-#include <linux/jiffies.h>
 #include <linux/spinlock.h>
 #include <linux/interrupt.h>
 #include <linux/clockchips.h>
@@ -40,10 +39,17 @@ void disable_mfgpt0_counter(void)
 }
 EXPORT_SYMBOL(disable_mfgpt0_counter);
 
-/* enable counter, comparator2 to event mode, 14.318MHz clock */
+/*
+ * enable counter, comparator2 to event mode, 14.318MHz clock / 8
+ *
+ * The low 12 bits of the setup register are write once after reset, so
+ * only the first call after a reset selects the clock.
+ */
 void enable_mfgpt0_counter(void)
 {
-	outw(0xe310, MFGPT0_SETUP);
+	outw(MFGPT_SETUP_CNTEN | MFGPT_SETUP_CMP2 | MFGPT_SETUP_CMP1 |
+	     MFGPT_SETUP_CMP2EVT | MFGPT_SETUP_CLKSEL | MFGPT0_SCALE,
+	     MFGPT0_SETUP);
 }
 EXPORT_SYMBOL(enable_mfgpt0_counter);
 
@@ -59,6 +65,34 @@ static int mfgpt_timer_set_periodic(struct clock_event_device *evt)
 	return 0;
 }
 
+static int mfgpt_timer_set_oneshot(struct clock_event_device *evt)
+{
+	raw_spin_lock(&mfgpt_lock);
+	disable_mfgpt0_counter();
+	raw_spin_unlock(&mfgpt_lock);
+
+	return 0;
+}
+
+/*
+ * The counter restarts from zero when it matches comparator 2, so a one
+ * shot event is a fresh count up to delta.  timer_interrupt() stops the
+ * counter again once the event has fired.
+ */
+static int mfgpt_next_event(unsigned long delta,
+			    struct clock_event_device *evt)
+{
+	raw_spin_lock(&mfgpt_lock);
+
+	disable_mfgpt0_counter();
+	outw(delta, MFGPT0_CMP2);
+	outw(0, MFGPT0_CNT);
+	enable_mfgpt0_counter();
+
+	raw_spin_unlock(&mfgpt_lock);
+	return 0;
+}
+
 static int mfgpt_timer_shutdown(struct clock_event_device *evt)
 {
 	if (clockevent_state_periodic(evt) || clockevent_state_oneshot(evt)) {
@@ -72,11 +106,12 @@ static int mfgpt_timer_shutdown(struct clock_event_device *evt)
 
 static struct clock_event_device mfgpt_clockevent = {
 	.name = "mfgpt",
-	.features = CLOCK_EVT_FEAT_PERIODIC,
+	.features = CLOCK_EVT_FEAT_PERIODIC | CLOCK_EVT_FEAT_ONESHOT,
 
-	/* The oneshot mode have very high deviation, don't use it! */
 	.set_state_shutdown = mfgpt_timer_shutdown,
 	.set_state_periodic = mfgpt_timer_set_periodic,
+	.set_state_oneshot = mfgpt_timer_set_oneshot,
+	.set_next_event = mfgpt_next_event,
 	.irq = CS5536_MFGPT_INTR,
 };
 
@@ -92,8 +127,14 @@ static irqreturn_t timer_interrupt(int irq, void *dev_id)
 	 */
 	_rdmsr(DIVIL_MSR_REG(DIVIL_LBAR_MFGPT), &basehi, &mfgpt_base);
 
-	/* ack */
-	outw(inw(MFGPT0_SETUP) | 0x4000, MFGPT0_SETUP);
+	/* ack, and stop the counter if this was a one shot event */
+	raw_spin_lock(&mfgpt_lock);
+	if (clockevent_state_oneshot(&mfgpt_clockevent))
+		outw((inw(MFGPT0_SETUP) & ~MFGPT_SETUP_CNTEN) |
+		     MFGPT_SETUP_CMP2, MFGPT0_SETUP);
+	else
+		outw(inw(MFGPT0_SETUP) | MFGPT_SETUP_CMP2, MFGPT0_SETUP);
+	raw_spin_unlock(&mfgpt_lock);
 
 	mfgpt_clockevent.event_handler(&mfgpt_clockevent);
 
@@ -111,7 +152,7 @@ void __init setup_mfgpt0_timer(void)
 	unsigned int cpu = smp_processor_id();
 
 	cd->cpumask = cpumask_of(cpu);
-	clockevent_set_clock(cd, MFGPT_TICK_RATE);
+	clockevent_set_clock(cd, MFGPT0_RATE);
 	cd->max_delta_ns = clockevent_delta2ns(0xffff, cd);
 	cd->max_delta_ticks = 0xffff;
 	cd->min_delta_ns = clockevent_delta2ns(0xf, cd);
@@ -134,62 +175,46 @@ void __init setup_mfgpt0_timer(void)
 }
 
 /*
- * Since the MFGPT overflows every tick, its not very useful
- * to just read by itself. So use jiffies to emulate a free
- * running counter:
+ * MFGPT1 free runs through its whole 16-bit range and is the clocksource,
+ * so the tick no longer has to run for the clock to advance.
  */
-static u64 mfgpt_read(struct clocksource *cs)
+static void mfgpt1_counter_enable(void)
 {
-	unsigned long flags;
-	int count;
-	u32 jifs;
-	static int old_count;
-	static u32 old_jifs;
-
-	raw_spin_lock_irqsave(&mfgpt_lock, flags);
-	/*
-	 * Although our caller may have the read side of xtime_lock,
-	 * this is now a seqlock, and we are cheating in this routine
-	 * by having side effects on state that we cannot undo if
-	 * there is a collision on the seqlock and our caller has to
-	 * retry.  (Namely, old_jifs and old_count.)  So we must treat
-	 * jiffies as volatile despite the lock.  We read jiffies
-	 * before latching the timer count to guarantee that although
-	 * the jiffies value might be older than the count (that is,
-	 * the counter may underflow between the last point where
-	 * jiffies was incremented and the point where we latch the
-	 * count), it cannot be newer.
-	 */
-	jifs = jiffies;
-	/* read the count */
-	count = inw(MFGPT0_CNT);
-
-	/*
-	 * It's possible for count to appear to go the wrong way for this
-	 * reason:
-	 *
-	 *  The timer counter underflows, but we haven't handled the resulting
-	 *  interrupt and incremented jiffies yet.
-	 *
-	 * Previous attempts to handle these cases intelligently were buggy, so
-	 * we just do the simple thing now.
-	 */
-	if (count < old_count && jifs == old_jifs)
-		count = old_count;
+	outw(0xffff, MFGPT1_CMP2);
+	outw(0, MFGPT1_CNT);
+	outw(MFGPT_SETUP_CNTEN | MFGPT_SETUP_CLKSEL | MFGPT1_SCALE,
+	     MFGPT1_SETUP);
+}
 
-	old_count = count;
-	old_jifs = jifs;
+/* the clocksource read, also timed by the platform benchmarks */
+u16 cs5536_mfgpt1_read(void)
+{
+	return inw(MFGPT1_CNT);
+}
+EXPORT_SYMBOL_GPL(cs5536_mfgpt1_read);
 
-	raw_spin_unlock_irqrestore(&mfgpt_lock, flags);
+static u64 mfgpt_read(struct clocksource *cs)
+{
+	return cs5536_mfgpt1_read();
+}
 
-	return (u64) (jifs * COMPARE) + count;
+/*
+ * The setup register is write once, so it can only be programmed again if
+ * the suspend reset the MFGPT.  Otherwise MFGPT1 kept counting.
+ */
+static void mfgpt_resume(struct clocksource *cs)
+{
+	if (!(inw(MFGPT1_SETUP) & MFGPT_SETUP_SETUP))
+		mfgpt1_counter_enable();
 }
 
 static struct clocksource clocksource_mfgpt = {
 	.name = "mfgpt",
 	.rating = 120, /* Functional for real use, but not desired */
 	.read = mfgpt_read,
-	.mask = CLOCKSOURCE_MASK(32),
+	.resume = mfgpt_resume,
+	.mask = CLOCKSOURCE_MASK(16),
+	.flags = CLOCK_SOURCE_IS_CONTINUOUS,
 };
 
 int __init init_mfgpt_clocksource(void)
@@ -197,7 +222,9 @@ int __init init_mfgpt_clocksource(void)
 	if (num_possible_cpus() > 1)	/* MFGPT does not scale! */
 		return 0;
 
-	return clocksource_register_hz(&clocksource_mfgpt, MFGPT_TICK_RATE);
+	mfgpt1_counter_enable();
+
+	return clocksource_register_hz(&clocksource_mfgpt, MFGPT1_RATE);
 }
 
 arch_initcall(init_mfgpt_clocksource);
@@ -16,6 +16,7 @@
  *	the PCI-2.2 spec.
  */
 
+#include <linux/bitmap.h>
 #include <linux/types.h>
 #include <cs5536/cs5536_pci.h>
 #include <cs5536/cs5536_vsm.h>
@@ -49,18 +50,93 @@ static const cs5536_pci_vsm_read vsm_conf_read[] = {
 	[CS5536_EHCI_FUNC]	= pci_ehci_read_reg,
 };
 
+/*
+ * Shadow of the emulated headers.  Every register read costs one or more
+ * MSR transactions through the PCI MSR gateway, so the values that only
+ * change through config writes are kept here.  Several registers of
+ * different functions are backed by the same MSRs (SB_CTRL, GLIU_PAE, the
+ * USB controller MSRs), so any write drops the whole shadow.  A write to a
+ * register that merely mirrors an MSR is skipped when the register
+ * already holds the value, which is the common case for the IDE timings.
+ *
+ * All accesses come from loongson_pcibios_config_access() and are
+ * serialised by pci_lock.
+ */
+#define CS5536_CONF_REGS	(0x100 / 4 + 1)
+
+static struct cs5536_conf_shadow {
+	u32 val[CS5536_CONF_REGS];
+	DECLARE_BITMAP(valid, CS5536_CONF_REGS);
+} conf_shadow[CS5536_FUNC_END];
+
+/* registers whose value can change under us or whose read has side effects */
+static bool cs5536_conf_volatile(int function, int reg)
+{
+	switch (reg) {
+	case PCI_STATUS:			/* hardware error flags */
+	case PCI_BAR0_REG ... PCI_BAR5_REG:	/* BAR sizing handshake */
+		return true;
+	case PCI_EHCI_LEGSMISTS_REG:
+		return function == CS5536_EHCI_FUNC;
+	default:
+		return false;
+	}
+}
+
+/* registers that read back exactly what was written, without side effects */
+static bool cs5536_conf_mirror(int function, int reg)
+{
+	if (function != CS5536_IDE_FUNC)
+		return false;
+
+	switch (reg) {
+	case PCI_IDE_DTC_REG:
+	case PCI_IDE_CAST_REG:
+	case PCI_IDE_ETC_REG:
+	case PCI_IDE_PM_REG:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static void cs5536_conf_invalidate(void)
+{
+	int function;
+
+	for (function = 0; function < CS5536_FUNC_END; function++)
+		bitmap_zero(conf_shadow[function].valid, CS5536_CONF_REGS);
+}
+
 /*
  * write to PCI config space and transfer it to MSR write.
  */
 void cs5536_pci_conf_write4(int function, int reg, u32 value)
 {
+	struct cs5536_conf_shadow *shadow;
+	bool mirror;
+
 	if ((function <= CS5536_FUNC_START) || (function >= CS5536_FUNC_END))
 		return;
 	if ((reg < 0) || (reg > 0x100) || ((reg & 0x03) != 0))
 		return;
 
-	if (vsm_conf_write[function] != NULL)
-		vsm_conf_write[function](reg, value);
+	if (vsm_conf_write[function] == NULL)
+		return;
+
+	shadow = &conf_shadow[function];
+	mirror = cs5536_conf_mirror(function, reg);
+	if (mirror && test_bit(reg >> 2, shadow->valid) &&
+	    shadow->val[reg >> 2] == value)
+		return;
+
+	vsm_conf_write[function](reg, value);
+
+	cs5536_conf_invalidate();
+	if (mirror) {
+		shadow->val[reg >> 2] = value;
+		__set_bit(reg >> 2, shadow->valid);
+	}
 }
 
 /*
@@ -68,6 +144,7 @@ void cs5536_pci_conf_write4(int function, int reg, u32 value)
  */
 u32 cs5536_pci_conf_read4(int function, int reg)
 {
+	struct cs5536_conf_shadow *shadow;
 	u32 data = 0;
 
 	if ((function <= CS5536_FUNC_START) || (function >= CS5536_FUNC_END))
@@ -77,8 +154,19 @@ u32 cs5536_pci_conf_read4(int function, int reg)
 	if (reg > 0x100)
 		return 0xffffffff;
 
-	if (vsm_conf_read[function] != NULL)
-		data = vsm_conf_read[function](reg);
+	if (vsm_conf_read[function] == NULL)
+		return data;
+
+	shadow = &conf_shadow[function];
+	if (test_bit(reg >> 2, shadow->valid))
+		return shadow->val[reg >> 2];
+
+	data = vsm_conf_read[function](reg);
+
+	if (!cs5536_conf_volatile(function, reg)) {
+		shadow->val[reg >> 2] = data;
+		__set_bit(reg >> 2, shadow->valid);
+	}
 
 	return data;
 }
@@ -3,23 +3,137 @@
  * Copyright (C) 2007 Lemote Inc. & Institute of Computing Technology
  * Author: Fuxin Zhang, zhangfx@lemote.com
  */
+#include <linux/debugfs.h>
 #include <linux/delay.h>
+#include <linux/init.h>
 #include <linux/interrupt.h>
+#include <linux/irq.h>
+#include <linux/seq_file.h>
+#include <linux/workqueue.h>
+
+#include <asm/debug.h>
 
 #include <loongson.h>
+
+#define BONITO_INT_DMA_BUSY	(1 << 10)
+
+/*
+ * Give up polling from the worker after this long and look again on the
+ * next tick, so a stuck DMA cannot keep the CPU busy.
+ */
+#define BONITO_DMA_POLL_US	100
+
+/*
+ * The IO DMA workaround used to spin in hard-IRQ context until the DMA busy
+ * bit clears.  With "bonito_dma_wait=defer" the pending bonito sources are
+ * masked instead and a worker waits for the DMA to finish before unmasking
+ * them again; being level triggered, they then re-raise the interrupt.
+ */
+static bool bonito_dma_defer;
+
+static struct {
+	unsigned long	triggered;	/* dispatches that found DMA busy */
+	unsigned long	deferred;	/* ... and were handed to the worker */
+	unsigned long	polls;		/* udelay(1) iterations, both modes */
+	unsigned long	max_polls;	/* longest single wait */
+	unsigned long	hardirq_polls;	/* iterations spent in hard-IRQ */
+} bonito_dma_stats;
+
+static u32 bonito_dma_deferred;
+
+static int __init bonito_dma_wait_setup(char *str)
+{
+	if (!strcmp(str, "defer"))
+		bonito_dma_defer = true;
+	else if (!strcmp(str, "spin"))
+		bonito_dma_defer = false;
+	else
+		return -EINVAL;
+
+	return 0;
+}
+early_param("bonito_dma_wait", bonito_dma_wait_setup);
+
+static void bonito_dma_account(unsigned long polls)
+{
+	bonito_dma_stats.polls += polls;
+	if (polls > bonito_dma_stats.max_polls)
+		bonito_dma_stats.max_polls = polls;
+}
+
+static void bonito_dma_work_fn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(bonito_dma_work, bonito_dma_work_fn);
+
+static void bonito_dma_work_fn(struct work_struct *work)
+{
+	unsigned long polls = 0, flags;
+	u32 deferred;
+	int i;
+
+	while (LOONGSON_INTISR & BONITO_INT_DMA_BUSY) {
+		if (polls++ == BONITO_DMA_POLL_US) {
+			local_irq_save(flags);
+			bonito_dma_account(polls);
+			local_irq_restore(flags);
+			schedule_delayed_work(&bonito_dma_work, 1);
+			return;
+		}
+		udelay(1);
+	}
+
+	local_irq_save(flags);
+	bonito_dma_account(polls);
+	deferred = bonito_dma_deferred;
+	bonito_dma_deferred = 0;
+
+	/* Leave alone whatever the irq core masked in the meantime */
+	while (deferred) {
+		i = __ffs(deferred);
+		deferred &= ~(1 << i);
+		if (irqd_irq_masked(irq_get_irq_data(LOONGSON_IRQ_BASE + i)))
+			continue;
+		LOONGSON_INTENSET = 1 << i;
+	}
+	mmiowb();
+	local_irq_restore(flags);
+}
+
 /*
  * the first level int-handler will jump here if it is a bonito irq
  */
 void bonito_irqdispatch(void)
 {
+	unsigned long polls = 0;
 	u32 int_status;
 	int i;
 
-	/* workaround the IO dma problem: let cpu looping to allow DMA finish */
 	int_status = LOONGSON_INTISR;
-	while (int_status & (1 << 10)) {
-		udelay(1);
-		int_status = LOONGSON_INTISR;
+	if (int_status & BONITO_INT_DMA_BUSY) {
+		bonito_dma_stats.triggered++;
+
+		if (bonito_dma_defer) {
+			int_status &= LOONGSON_INTEN & ~BONITO_INT_DMA_BUSY;
+			if (int_status) {
+				bonito_dma_stats.deferred++;
+				bonito_dma_deferred |= int_status;
+				LOONGSON_INTENCLR = int_status;
+				mmiowb();
+				schedule_delayed_work(&bonito_dma_work, 0);
+				return;
+			}
+		}
+
+		/*
+		 * workaround the IO dma problem: let cpu looping to allow DMA
+		 * finish
+		 */
+		while (int_status & BONITO_INT_DMA_BUSY) {
+			udelay(1);
+			polls++;
+			int_status = LOONGSON_INTISR;
+		}
+		bonito_dma_stats.hardirq_polls += polls;
+		bonito_dma_account(polls);
 	}
 
 	/* Get pending sources, masked by current enables */
@@ -61,3 +175,28 @@ void __init arch_init_irq(void)
 	/* machine specific irq init */
 	mach_init_irq();
 }
+
+static int bonito_dma_stats_show(struct seq_file *m, void *v)
+{
+	seq_printf(m, "mode:\t\t%s\n", bonito_dma_defer ? "defer" : "spin");
+	seq_printf(m, "triggered:\t%lu\n", bonito_dma_stats.triggered);
+	seq_printf(m, "deferred:\t%lu\n", bonito_dma_stats.deferred);
+	seq_printf(m, "wait_us:\t%lu\n", bonito_dma_stats.polls);
+	seq_printf(m, "hardirq_us:\t%lu\n", bonito_dma_stats.hardirq_polls);
+	seq_printf(m, "max_wait_us:\t%lu\n", bonito_dma_stats.max_polls);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(bonito_dma_stats);
+
+static int __init bonito_dma_debugfs_init(void)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("bonito_dma", mips_debugfs_dir);
+	debugfs_create_bool("defer", S_IRUGO | S_IWUSR, dir, &bonito_dma_defer);
+	debugfs_create_file("stats", S_IRUGO, dir, NULL,
+			    &bonito_dma_stats_fops);
+	return 0;
+}
+late_initcall(bonito_dma_debugfs_init);
@@ -0,0 +1,244 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Micro benchmarks of the platform paths that dominate on Loongson-2F
+ * machines: MFGPT clock reads, bonito interrupt dispatch, CS5536 emulated
+ * PCI config access, DMA mapping through swiotlb and uncached stores.
+ *
+ * Loading the module runs every benchmark once and prints a line per
+ * benchmark in cycles per operation, which
+ * tools/testing/selftests/mips/loongson2ef_bench.sh collects.
+ *
+ * The CP0 Count register advances every other pipeline clock on the
+ * Loongson-2F, so Count deltas are doubled to give cycles.
+ */
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/dma-direct.h>
+#include <linux/dma-mapping.h>
+#include <linux/gfp.h>
+#include <linux/interrupt.h>
+#include <linux/irq.h>
+#include <linux/module.h>
+#include <linux/pci.h>
+#include <linux/slab.h>
+
+#include <asm/addrspace.h>
+#include <asm/cacheflush.h>
+#include <asm/mipsregs.h>
+
+#include <loongson.h>
+#include <cs5536/cs5536_mfgpt.h>
+
+static unsigned int loops = 10000;
+module_param(loops, uint, 0444);
+MODULE_PARM_DESC(loops, "Iterations of each benchmark");
+
+/* 64KB, the size of a few framebuffer lines on the Lemote machines */
+#define BENCH_STORE_ORDER	4
+#define BENCH_STORE_SIZE	(PAGE_SIZE << BENCH_STORE_ORDER)
+
+static void bench_report(const char *name, u32 count, unsigned long ops)
+{
+	pr_info("%-24s %8llu cycles/op\n", name,
+		div64_ul(2ULL * count, ops ? ops : 1));
+}
+
+static void bench_count(void)
+{
+	unsigned long flags;
+	unsigned int i;
+	u32 start;
+
+	local_irq_save(flags);
+	start = read_c0_count();
+	for (i = 0; i < loops; i++)
+		(void)read_c0_count();
+	bench_report("c0_count_read", read_c0_count() - start, loops);
+	local_irq_restore(flags);
+}
+
+static void bench_mfgpt(void)
+{
+	unsigned long flags;
+	unsigned int i;
+	u32 start;
+
+	if (!IS_ENABLED(CONFIG_CS5536_MFGPT))
+		return;
+
+	local_irq_save(flags);
+	start = read_c0_count();
+	for (i = 0; i < loops; i++)
+		(void)cs5536_mfgpt1_read();
+	bench_report("mfgpt_read", read_c0_count() - start, loops);
+	local_irq_restore(flags);
+}
+
+static irqreturn_t bench_irq_handler(int irq, void *dev_id)
+{
+	return IRQ_HANDLED;
+}
+
+/*
+ * The bonito status and enable reads of bonito_irqdispatch(), followed by
+ * the generic flow handling of a line with one action.
+ */
+static void bench_bonito_dispatch(void)
+{
+	unsigned long flags;
+	unsigned int i;
+	u32 start;
+	int irq;
+
+	irq = irq_alloc_desc(NUMA_NO_NODE);
+	if (irq < 0)
+		return;
+	irq_set_chip_and_handler(irq, &dummy_irq_chip, handle_simple_irq);
+	if (request_irq(irq, bench_irq_handler, 0, KBUILD_MODNAME, NULL))
+		goto out_free;
+
+	local_irq_save(flags);
+	start = read_c0_count();
+	for (i = 0; i < loops; i++) {
+		u32 int_status = LOONGSON_INTISR & LOONGSON_INTEN;
+
+		(void)int_status;
+		generic_handle_irq(irq);
+	}
+	bench_report("bonito_dispatch", read_c0_count() - start, loops);
+	local_irq_restore(flags);
+
+	free_irq(irq, NULL);
+out_free:
+	irq_free_desc(irq);
+}
+
+/* PCI_COMMAND is served from the header cache, BAR0 always goes to the VSM */
+static void bench_cs5536_conf(struct pci_dev *pdev)
+{
+	unsigned int i;
+	u32 start, val;
+
+	start = read_c0_count();
+	for (i = 0; i < loops; i++)
+		pci_read_config_dword(pdev, PCI_COMMAND, &val);
+	bench_report("cs5536_conf_cached", read_c0_count() - start, loops);
+
+	start = read_c0_count();
+	for (i = 0; i < loops; i++)
+		pci_read_config_dword(pdev, PCI_BASE_ADDRESS_0, &val);
+	bench_report("cs5536_conf_msr", read_c0_count() - start, loops);
+}
+
+static void bench_dma_map(struct pci_dev *pdev)
+{
+	unsigned long bounced = 0;
+	unsigned int i;
+	dma_addr_t dma;
+	u32 start, elapsed = 0;
+	void *buf;
+
+	buf = kmalloc(PAGE_SIZE, GFP_KERNEL);
+	if (!buf)
+		return;
+
+	for (i = 0; i < loops; i++) {
+		start = read_c0_count();
+		dma = dma_map_single(&pdev->dev, buf, PAGE_SIZE, DMA_TO_DEVICE);
+		if (dma_mapping_error(&pdev->dev, dma)) {
+			pr_err("dma_map_unmap_4k failed after %u maps\n", i);
+			break;
+		}
+		dma_unmap_single(&pdev->dev, dma, PAGE_SIZE, DMA_TO_DEVICE);
+		elapsed += read_c0_count() - start;
+
+		if (dma != phys_to_dma(&pdev->dev, virt_to_phys(buf)))
+			bounced++;
+	}
+	bench_report("dma_map_unmap_4k", elapsed, i);
+	pr_info("%-24s %8lu of %u\n", "dma_map_bounced", bounced, i);
+
+	kfree(buf);
+}
+
+static void bench_store_loop(const char *name, volatile u64 *p)
+{
+	unsigned long flags, n = BENCH_STORE_SIZE / sizeof(u64);
+	unsigned int i, rounds = max(loops / 1000, 1U);
+	unsigned long j;
+	u32 start;
+
+	local_irq_save(flags);
+	start = read_c0_count();
+	for (i = 0; i < rounds; i++)
+		for (j = 0; j < n; j++)
+			p[j] = j;
+	bench_report(name, read_c0_count() - start, rounds * n);
+	local_irq_restore(flags);
+}
+
+/*
+ * Doubleword stores through the cached, uncached and uncached accelerated
+ * views of the same memory, the latter two being how framebuffer writes
+ * reach the video memory.
+ */
+static void bench_stores(void)
+{
+	struct page *page;
+	unsigned long va;
+	phys_addr_t pa;
+
+	page = alloc_pages(GFP_KERNEL, BENCH_STORE_ORDER);
+	if (!page)
+		return;
+	va = (unsigned long)page_address(page);
+	pa = page_to_phys(page);
+
+	bench_store_loop("store_cached", (u64 *)va);
+
+#ifdef CONFIG_64BIT
+	/* no dirty cached lines may be written back over the uncached stores */
+	dma_cache_wback_inv(va, BENCH_STORE_SIZE);
+	bench_store_loop("store_uncached",
+			 (u64 *)PHYS_TO_XKPHYS(K_CALG_UNCACHED, pa));
+	bench_store_loop("store_uncached_accel",
+			 (u64 *)PHYS_TO_XKPHYS(K_CALG_UNCACHED_ACCEL, pa));
+	dma_cache_inv(va, BENCH_STORE_SIZE);
+#endif
+
+	__free_pages(page, BENCH_STORE_ORDER);
+}
+
+static int __init loongson2ef_bench_init(void)
+{
+	struct pci_dev *pdev;
+
+	if (!loops)
+		return -EINVAL;
+
+	bench_count();
+	bench_mfgpt();
+	bench_bonito_dispatch();
+
+	pdev = pci_get_device(PCI_VENDOR_ID_AMD, PCI_DEVICE_ID_AMD_CS5536_IDE,
+			      NULL);
+	if (pdev) {
+		bench_cs5536_conf(pdev);
+		bench_dma_map(pdev);
+		pci_dev_put(pdev);
+	}
+
+	bench_stores();
+	pr_info("done\n");
+
+	return 0;
+}
+
+static void __exit loongson2ef_bench_exit(void)
+{
+}
+
+module_init(loongson2ef_bench_init);
+module_exit(loongson2ef_bench_exit);
+MODULE_DESCRIPTION("Loongson-2F platform micro benchmarks");
+MODULE_LICENSE("GPL");
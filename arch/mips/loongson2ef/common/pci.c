@@ -3,6 +3,7 @@
  * Copyright (C) 2007 Lemote, Inc. & Institute of Computing Technology
  * Author: Fuxin Zhang, zhangfx@lemote.com
  */
+#include <linux/log2.h>
 #include <linux/pci.h>
 
 #include <pci.h>
@@ -30,6 +31,25 @@ static struct pci_controller  loongson_pci_controller = {
 	.io_offset	= 0x00000000UL,
 };
 
+#ifdef CONFIG_CPU_SUPPORTS_ADDRWINCFG
+static unsigned long loongson_pcidma_size = LOONGSON_PCIDMA_MIN_SIZE;
+
+static unsigned long __init loongson_pcidma_window_size(void)
+{
+	unsigned long size = (unsigned long)(memsize + highmemsize) << 20;
+
+	size = roundup_pow_of_two(size);
+	return clamp(size, LOONGSON_PCIDMA_MIN_SIZE, LOONGSON_PCIDMA_MAX_SIZE);
+}
+
+/* Tell dma-direct which bus addresses the window can actually reach */
+static void loongson_pci_dma_limit(struct pci_dev *pdev)
+{
+	pdev->dev.bus_dma_limit = LOONGSON_PCIDMA_BASE + loongson_pcidma_size - 1;
+}
+DECLARE_PCI_FIXUP_EARLY(PCI_ANY_ID, PCI_ANY_ID, loongson_pci_dma_limit);
+#endif
+
 static void __init setup_pcimap(void)
 {
 	/*
@@ -45,12 +65,27 @@ static void __init setup_pcimap(void)
 		LOONGSON_PCIMAP_WIN(1, LOONGSON_PCILO1_BASE) |
 		LOONGSON_PCIMAP_WIN(0, 0);
 
+#ifdef CONFIG_CPU_SUPPORTS_ADDRWINCFG
+	/*
+	 * PCI-DMA to local mapping: [2G,2G+size] -> [0M,size], so that high
+	 * memory does not need to be bounced
+	 */
+	loongson_pcidma_size = loongson_pcidma_window_size();
+	LOONGSON_PCIBASE0 = LOONGSON_PCIDMA_BASE;   /* base: 2G -> mmap: 0M */
+	/*
+	 * size: at least 1G, burst transmission, pre-fetch enable, 64bit; the
+	 * DDR side of the window is set up by PCIDMA window0 below
+	 */
+	LOONGSON_PCI_HIT0_SEL_L = (~(max(loongson_pcidma_size, 0x40000000ul) -
+				     1) & 0xfffffff0ul) | 0xcul;
+#else
 	/*
 	 * PCI-DMA to local mapping: [2G,2G+256M] -> [0M,256M]
 	 */
 	LOONGSON_PCIBASE0 = 0x80000000ul;   /* base: 2G -> mmap: 0M */
 	/* size: 256M, burst transmission, pre-fetch enable, 64bit */
 	LOONGSON_PCI_HIT0_SEL_L = 0xc000000cul;
+#endif
 	LOONGSON_PCI_HIT0_SEL_H = 0xfffffffful;
 	LOONGSON_PCI_HIT1_SEL_L = 0x00000006ul; /* set this BAR as invalid */
 	LOONGSON_PCI_HIT1_SEL_H = 0x00000000ul;
@@ -70,6 +105,16 @@ static void __init setup_pcimap(void)
 	 */
 	LOONGSON_ADDRWIN_CPUTOPCI(ADDRWIN_WIN2, LOONGSON_CPU_MEM_SRC,
 		LOONGSON_PCI_MEM_DST, MMAP_CPUTOPCI_SIZE);
+
+	/*
+	 * set pcidma addr window0 to map the PCI DMA window to DDR
+	 */
+	LOONGSON_ADDRWIN_PCITODDR(ADDRWIN_WIN0, LOONGSON_PCIDMA_BASE,
+		0x0ul, loongson_pcidma_size);
+	mmiowb();
+
+	pr_info("PCI DMA window: %#lx-%#lx\n", LOONGSON_PCIDMA_BASE,
+		LOONGSON_PCIDMA_BASE + loongson_pcidma_size - 1);
 #endif
 }
 
@@ -18,6 +18,10 @@ void __init plat_time_init(void)
 	/* setup mips r4k timer */
 	mips_hpt_frequency = cpu_clock_freq / 2;
 
+	/* Count follows the cpufreq-scaled pipeline clock on the 2F */
+	if (IS_ENABLED(CONFIG_CPU_LOONGSON2F))
+		r4k_clocksource_scale_with_cpufreq(cpu_clock_freq / 1000);
+
 	setup_mfgpt0_timer();
 }
 
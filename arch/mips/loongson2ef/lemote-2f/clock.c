@@ -44,7 +44,7 @@ int loongson2_cpu_set_rate(unsigned long rate_khz)
 
 	regval = readl(LOONGSON_CHIPCFG);
 	regval = (regval & ~0x7) | (pos->driver_data - 1);
-	writel(regval, LOONGSON_CHIPCFG);
+	loongson2_chipcfg_write(regval);
 
 	return 0;
 }
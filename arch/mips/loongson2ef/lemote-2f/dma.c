@@ -6,6 +6,11 @@ dma_addr_t __phys_to_dma(struct device *dev, phys_addr_t paddr)
 	return paddr | 0x80000000;
 }
 
+/*
+ * Low memory [0, 256M] is seen by PCI at 2G; high memory lives at 2G + 256M
+ * in the CPU physical space as well, so it is already its own bus address.
+ * How far up the bus window reaches is set by setup_pcimap().
+ */
 phys_addr_t __dma_to_phys(struct device *dev, dma_addr_t dma_addr)
 {
 	if (dma_addr > 0x8fffffff)
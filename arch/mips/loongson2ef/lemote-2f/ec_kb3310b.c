@@ -10,7 +10,11 @@
 #include <linux/export.h>
 #include <linux/spinlock.h>
 #include <linux/delay.h>
+#include <linux/jiffies.h>
+#include <linux/list.h>
+#include <linux/mutex.h>
 #include <linux/platform_device.h>
+#include <linux/workqueue.h>
 
 #include <asm/bootinfo.h>
 
@@ -18,6 +22,8 @@
 
 static DEFINE_SPINLOCK(index_access_lock);
 static DEFINE_SPINLOCK(port_access_lock);
+/* set under port_access_lock while ec_query_event() owns the EC ports */
+static bool ec_query_busy;
 
 #define EC_VER_LEN 64
 char ec_kb3310b_ver[EC_VER_LEN];
@@ -40,47 +46,210 @@ int __init ec_ver_probe(void)
 	return 0;
 }
 
+/*
+ * Small direct mapped cache of EC register values for slowly changing
+ * state such as the battery and thermal registers, which userspace polls
+ * far more often than the EC updates them.  Protected by
+ * index_access_lock.
+ */
+#define EC_CACHE_SIZE	32
+
+static struct {
+	unsigned short addr;
+	unsigned char val;
+	bool valid;
+	unsigned long stamp;
+} ec_cache[EC_CACHE_SIZE];
+
+static inline unsigned int ec_cache_slot(unsigned short addr)
+{
+	return (addr ^ (addr >> 5)) & (EC_CACHE_SIZE - 1);
+}
+
+static inline void ec_cache_update(unsigned short addr, unsigned char val)
+{
+	unsigned int slot = ec_cache_slot(addr);
+
+	ec_cache[slot].addr = addr;
+	ec_cache[slot].val = val;
+	ec_cache[slot].valid = true;
+	ec_cache[slot].stamp = jiffies;
+}
+
+static unsigned char __ec_read(unsigned short addr)
+{
+	outb((addr & 0xff00) >> 8, EC_IO_PORT_HIGH);
+	outb((addr & 0x00ff), EC_IO_PORT_LOW);
+	return inb(EC_IO_PORT_DATA);
+}
+
+static void __ec_write(unsigned short addr, unsigned char val)
+{
+	outb((addr & 0xff00) >> 8, EC_IO_PORT_HIGH);
+	outb((addr & 0x00ff), EC_IO_PORT_LOW);
+	outb(val, EC_IO_PORT_DATA);
+	/*  flush the write action */
+	inb(EC_IO_PORT_DATA);
+	ec_cache_update(addr, val);
+}
+
 unsigned char ec_read(unsigned short addr)
 {
 	unsigned char value;
 	unsigned long flags;
 
 	spin_lock_irqsave(&index_access_lock, flags);
-	outb((addr & 0xff00) >> 8, EC_IO_PORT_HIGH);
-	outb((addr & 0x00ff), EC_IO_PORT_LOW);
-	value = inb(EC_IO_PORT_DATA);
+	value = __ec_read(addr);
+	ec_cache_update(addr, value);
 	spin_unlock_irqrestore(&index_access_lock, flags);
 
 	return value;
 }
 EXPORT_SYMBOL_GPL(ec_read);
 
+/*
+ * Read an EC register, returning the last value seen if it is no older
+ * than max_age jiffies.  ec_write() and completed requests keep the cache
+ * coherent with the kernel's own updates; ec_cache_invalidate() drops
+ * values the EC itself has changed.
+ */
+unsigned char ec_read_cached(unsigned short addr, unsigned long max_age)
+{
+	unsigned int slot = ec_cache_slot(addr);
+	unsigned char value;
+	unsigned long flags;
+
+	spin_lock_irqsave(&index_access_lock, flags);
+	if (ec_cache[slot].valid && ec_cache[slot].addr == addr &&
+	    time_before_eq(jiffies, ec_cache[slot].stamp + max_age)) {
+		value = ec_cache[slot].val;
+	} else {
+		value = __ec_read(addr);
+		ec_cache_update(addr, value);
+	}
+	spin_unlock_irqrestore(&index_access_lock, flags);
+
+	return value;
+}
+EXPORT_SYMBOL_GPL(ec_read_cached);
+
+void ec_cache_invalidate(void)
+{
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&index_access_lock, flags);
+	for (i = 0; i < EC_CACHE_SIZE; i++)
+		ec_cache[i].valid = false;
+	spin_unlock_irqrestore(&index_access_lock, flags);
+}
+EXPORT_SYMBOL_GPL(ec_cache_invalidate);
+
 void ec_write(unsigned short addr, unsigned char val)
 {
 	unsigned long flags;
 
 	spin_lock_irqsave(&index_access_lock, flags);
-	outb((addr & 0xff00) >> 8, EC_IO_PORT_HIGH);
-	outb((addr & 0x00ff), EC_IO_PORT_LOW);
-	outb(val, EC_IO_PORT_DATA);
-	/*  flush the write action */
-	inb(EC_IO_PORT_DATA);
+	__ec_write(addr, val);
 	spin_unlock_irqrestore(&index_access_lock, flags);
 }
 EXPORT_SYMBOL_GPL(ec_write);
 
+/*
+ * Asynchronous transactions
+ *
+ * Requests are queued from any context and completed in batches from a
+ * work item, so callers that do not need the result straight away do not
+ * spin on the index ports.  Interrupts are only disabled for the
+ * individual index port accesses, never across the whole batch.
+ */
+static LIST_HEAD(ec_request_list);
+static DEFINE_SPINLOCK(ec_request_lock);
+
+static void ec_request_work(struct work_struct *work)
+{
+	struct ec_request *req, *tmp;
+	unsigned long flags;
+	LIST_HEAD(batch);
+
+	spin_lock_irqsave(&ec_request_lock, flags);
+	list_splice_init(&ec_request_list, &batch);
+	spin_unlock_irqrestore(&ec_request_lock, flags);
+
+	list_for_each_entry_safe(req, tmp, &batch, node) {
+		spin_lock_irqsave(&index_access_lock, flags);
+		if (req->write)
+			__ec_write(req->addr, req->val);
+		else {
+			req->val = __ec_read(req->addr);
+			ec_cache_update(req->addr, req->val);
+		}
+		spin_unlock_irqrestore(&index_access_lock, flags);
+
+		list_del(&req->node);
+		if (req->complete)
+			req->complete(req);
+	}
+}
+
+static DECLARE_WORK(ec_work, ec_request_work);
+
+/*
+ * Queue @req.  The request must stay allocated until its completion
+ * callback has run, or until ec_flush() returns if it has none.
+ */
+void ec_submit(struct ec_request *req)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&ec_request_lock, flags);
+	list_add_tail(&req->node, &ec_request_list);
+	spin_unlock_irqrestore(&ec_request_lock, flags);
+
+	schedule_work(&ec_work);
+}
+EXPORT_SYMBOL_GPL(ec_submit);
+
+/* Wait until all the requests submitted so far have completed. */
+void ec_flush(void)
+{
+	flush_work(&ec_work);
+}
+EXPORT_SYMBOL_GPL(ec_flush);
+
+static int ec_query_done(int timeout, unsigned char cmd, unsigned char status)
+{
+	if (timeout <= 0) {
+		printk(KERN_ERR "%s: deadable error : timeout...\n", __func__);
+		return -EINVAL;
+	}
+
+	pr_debug("(%x/%d)ec issued command %d status : 0x%x\n",
+		 timeout, EC_CMD_TIMEOUT - timeout, cmd, status);
+	return 0;
+}
+
 /*
  * This function is used for EC command writes and corresponding status queries.
+ *
+ * It busy waits with interrupts disabled and is only meant for atomic
+ * callers such as the suspend wakeup check; process context should use
+ * ec_query_event() instead.
  */
 int ec_query_seq(unsigned char cmd)
 {
 	int timeout;
 	unsigned char status;
 	unsigned long flags;
-	int ret = 0;
 
 	spin_lock_irqsave(&port_access_lock, flags);
 
+	/* don't cut into a query ec_query_event() is sleeping in */
+	if (ec_query_busy) {
+		spin_unlock_irqrestore(&port_access_lock, flags);
+		return -EBUSY;
+	}
+
 	/* make chip goto reset mode */
 	udelay(EC_REG_DELAY);
 	outb(cmd, EC_CMD_PORT);
@@ -96,17 +265,66 @@ int ec_query_seq(unsigned char cmd)
 
 	spin_unlock_irqrestore(&port_access_lock, flags);
 
+	return ec_query_done(timeout, cmd, status);
+}
+EXPORT_SYMBOL_GPL(ec_query_seq);
+
+/*
+ * Sleeping version of ec_query_event_num() + ec_get_event_num() for
+ * process context and threaded interrupt handlers.  The EC takes several
+ * milliseconds to answer, which the busy waiting version spends with
+ * interrupts off.  It sleeps with the ports marked busy, rather than
+ * with port_access_lock held, so ec_query_seq() backs off meanwhile.
+ */
+static DEFINE_MUTEX(ec_query_mutex);
+
+int ec_query_event(void)
+{
+	unsigned long flags;
+	int timeout;
+	unsigned char status;
+	int ret;
+
+	mutex_lock(&ec_query_mutex);
+	spin_lock_irqsave(&port_access_lock, flags);
+	ec_query_busy = true;
+	spin_unlock_irqrestore(&port_access_lock, flags);
+
+	usleep_range(EC_REG_DELAY, 2 * EC_REG_DELAY);
+	outb(CMD_GET_EVENT_NUM, EC_CMD_PORT);
+	usleep_range(EC_REG_DELAY, 2 * EC_REG_DELAY);
+
+	timeout = EC_CMD_TIMEOUT;
+	status = inb(EC_STS_PORT);
+	while (timeout-- && (status & (1 << 1))) {
+		usleep_range(EC_REG_DELAY, 2 * EC_REG_DELAY);
+		status = inb(EC_STS_PORT);
+	}
+
+	ret = ec_query_done(timeout, CMD_GET_EVENT_NUM, status);
+	if (ret)
+		goto out;
+
+	timeout = 100;
+	while (timeout-- && !(status & (1 << 0))) {
+		usleep_range(EC_REG_DELAY, 2 * EC_REG_DELAY);
+		status = inb(EC_STS_PORT);
+	}
 	if (timeout <= 0) {
-		printk(KERN_ERR "%s: deadable error : timeout...\n", __func__);
+		pr_info("%s: get event number timeout.\n", __func__);
 		ret = -EINVAL;
-	} else
-		printk(KERN_INFO
-			   "(%x/%d)ec issued command %d status : 0x%x\n",
-			   timeout, EC_CMD_TIMEOUT - timeout, cmd, status);
+		goto out;
+	}
+	ret = inb(EC_DAT_PORT);
 
+out:
+	spin_lock_irqsave(&port_access_lock, flags);
+	ec_query_busy = false;
+	spin_unlock_irqrestore(&port_access_lock, flags);
+	mutex_unlock(&ec_query_mutex);
 	return ret;
 }
-EXPORT_SYMBOL_GPL(ec_query_seq);
+EXPORT_SYMBOL_GPL(ec_query_event);
 
 /*
  * Send query command to EC to get the proper event number
@@ -9,11 +9,26 @@
 #ifndef _EC_KB3310B_H
 #define _EC_KB3310B_H
 
+#include <linux/list.h>
+
+struct ec_request {
+	struct list_head node;
+	unsigned short addr;
+	unsigned char val;	/* written value, or result of a read */
+	bool write;
+	void (*complete)(struct ec_request *req);
+};
+
 extern unsigned char ec_read(unsigned short addr);
+extern unsigned char ec_read_cached(unsigned short addr, unsigned long max_age);
+extern void ec_cache_invalidate(void);
 extern void ec_write(unsigned short addr, unsigned char val);
+extern void ec_submit(struct ec_request *req);
+extern void ec_flush(void);
 extern int ec_query_seq(unsigned char cmd);
 extern int ec_query_event_num(void);
 extern int ec_get_event_num(void);
+extern int ec_query_event(void);
 extern char ec_kb3310b_ver[];
 
 typedef int (*sci_handler) (int status);
@@ -23,6 +23,32 @@
 #define LOONGSON_INT_BIT_INT0		(1 << 11)
 #define LOONGSON_INT_BIT_INT1		(1 << 12)
 
+/*
+ * Maximum number of south bridge interrupts handled per CPU exception, set
+ * with "i8259_batch=".  The default of 0 keeps the one-shot dispatch.
+ */
+static unsigned int i8259_batch;
+
+static int __init i8259_batch_setup(char *str)
+{
+	return kstrtouint(str, 0, &i8259_batch);
+}
+early_param("i8259_batch", i8259_batch_setup);
+
+/* Called with i8259A_lock held */
+static bool mach_i8259_spurious(void)
+{
+	/*
+	 * This may be a spurious interrupt.
+	 *
+	 * Read the interrupt status register (ISR). If the most
+	 * significant bit is not set then there is no valid
+	 * interrupt.
+	 */
+	outb(0x0B, PIC_MASTER_ISR);	/* ISR register */
+	return ~inb(PIC_MASTER_ISR) & 0x80;
+}
+
 /*
  * The generic i8259_irq() make the kernel hang on booting.  Since we cannot
  * get the irq via the IRR directly, we access the ISR instead.
@@ -40,18 +66,8 @@ int mach_i8259_irq(void)
 		if (!isr)
 			isr = (inb(PIC_SLAVE_CMD) & ~inb(PIC_SLAVE_IMR)) << 8;
 		irq = ffs(isr) - 1;
-		if (unlikely(irq == 7)) {
-			/*
-			 * This may be a spurious interrupt.
-			 *
-			 * Read the interrupt status register (ISR). If the most
-			 * significant bit is not set then there is no valid
-			 * interrupt.
-			 */
-			outb(0x0B, PIC_MASTER_ISR);	/* ISR register */
-			if (~inb(PIC_MASTER_ISR) & 0x80)
-				irq = -1;
-		}
+		if (unlikely(irq == 7) && mach_i8259_spurious())
+			irq = -1;
 		raw_spin_unlock(&i8259A_lock);
 	}
 
@@ -59,10 +75,65 @@ int mach_i8259_irq(void)
 }
 EXPORT_SYMBOL(mach_i8259_irq);
 
+/*
+ * Like mach_i8259_irq(), but return every pending interrupt at once and take
+ * the IMRs from the i8259 driver's shadow instead of reading them back.
+ */
+static unsigned int mach_i8259_pending(void)
+{
+	unsigned int mask, isr;
+
+	if (!((LOONGSON_INTISR & LOONGSON_INTEN) & LOONGSON_INT_BIT_INT0))
+		return 0;
+
+	raw_spin_lock(&i8259A_lock);
+	mask = i8259_cached_mask() | (1 << PIC_CASCADE_IR);
+	isr = inb(PIC_MASTER_CMD);
+	if (!(isr & ~mask & 0xff) || (isr & (1 << PIC_CASCADE_IR)))
+		isr |= inb(PIC_SLAVE_CMD) << 8;
+	isr &= ~mask & 0xffff;
+	if (unlikely(isr & (1 << 7)) && mach_i8259_spurious())
+		isr &= ~(1 << 7);
+	raw_spin_unlock(&i8259A_lock);
+
+	return isr;
+}
+
+/*
+ * Handle each snapshot of pending interrupts to completion before polling
+ * the controllers again, so that a burst from the NIC, IDE and USB costs a
+ * single exception and one ISR read per round.
+ */
+static void i8259_irqdispatch_batch(void)
+{
+	unsigned int budget = i8259_batch;
+	unsigned int pending;
+
+	while (budget) {
+		pending = mach_i8259_pending();
+		if (!pending)
+			break;
+
+		do {
+			do_IRQ(__ffs(pending));
+			pending &= pending - 1;
+			budget--;
+		} while (pending && budget);
+	}
+
+	if (budget == i8259_batch)
+		spurious_interrupt();
+}
+
 static void i8259_irqdispatch(void)
 {
 	int irq;
 
+	if (i8259_batch) {
+		i8259_irqdispatch_batch();
+		return;
+	}
+
 	irq = mach_i8259_irq();
 	if (irq >= 0)
 		do_IRQ(irq);
@@ -2805,13 +2805,48 @@ static int fpu_emu(struct pt_regs *xcp, struct mips_fpu_struct *ctx,
 	return 0;
 }
 
+/*
+ * Denormal heavy code tends to raise an unimplemented operation exception
+ * on most of a run of FPU instructions, so with FPU hardware carry on
+ * emulating up to this many straight-line FPU instructions rather than
+ * taking a fresh trap, and a full FPU context save and restore, for each.
+ */
+#define FPU_EMU_BURST	32
+
+/* Non-branch FPU instruction that is worth emulating in a burst? */
+static inline bool fpu_emu_burst_insn(mips_instruction ir)
+{
+	union mips_instruction insn = { .word = ir };
+
+	switch (insn.i_format.opcode) {
+	case cop1_op:
+		switch (insn.r_format.rs) {
+		case bc_op:
+		case bc1eqz_op:
+		case bc1nez_op:
+			return false;
+		default:
+			return true;
+		}
+	case cop1x_op:
+	case lwc1_op:
+	case ldc1_op:
+	case swc1_op:
+	case sdc1_op:
+		return true;
+	default:
+		return false;
+	}
+}
+
 /*
  * Emulate FPU instructions.
  *
  * If we use FPU hardware, then we have been typically called to handle
  * an unimplemented operation, such as where an operand is a NaN or
- * denormalized.  In that case exit the emulation loop after a single
- * iteration so as to let hardware execute any subsequent instructions.
+ * denormalized.  In that case exit the emulation loop as soon as the next
+ * instruction is not a plain FPU one, or after FPU_EMU_BURST of them, so
+ * as to let hardware execute any subsequent instructions.
  *
  * If we have no FPU hardware or it has been disabled, then continue
  * emulating floating-point instructions until one of these conditions
@@ -2841,6 +2876,7 @@ int fpu_emulator_cop1Handler(struct pt_regs *xcp, struct mips_fpu_struct *ctx,
 	struct mm_decoded_insn dec_insn;
 	u16 instr[4];
 	u16 *instr_ptr;
+	int burst = 0;
 	int sig = 0;
 
 	/*
@@ -2922,10 +2958,16 @@ int fpu_emulator_cop1Handler(struct pt_regs *xcp, struct mips_fpu_struct *ctx,
 			sig = cop1Emulate(xcp, ctx, dec_insn, fault_addr);
 		}
 
-		if (has_fpu)
-			break;
 		if (sig)
 			break;
+		if (has_fpu) {
+			if (++burst >= FPU_EMU_BURST ||
+			    dec_insn.micro_mips_mode ||
+			    xcp->cp0_epc != prevepc + 4 ||
+			    !fpu_emu_burst_insn(dec_insn.next_insn))
+				break;
+			MIPS_FPU_EMU_INC_STATS(burst);
+		}
 		/*
 		 * We have to check for the ISA bit explicitly here,
 		 * because `get_isa16_mode' may return 0 if support
@@ -54,6 +54,38 @@ EXPORT_SYMBOL_GPL(local_flush_data_cache_page);
 EXPORT_SYMBOL(flush_data_cache_page);
 EXPORT_SYMBOL(flush_icache_all);
 
+/**
+ * flush_icache_batch_add() - queue a range for a batched icache flush
+ * @b: batch, initialised with FLUSH_ICACHE_BATCH_INIT
+ * @start: start of the modified range
+ * @end: end of the modified range
+ *
+ * The caller must not execute the new code before the batch is finished.
+ */
+void flush_icache_batch_add(struct flush_icache_batch *b,
+			    unsigned long start, unsigned long end)
+{
+	if (start >= end)
+		return;
+
+	b->start = min(b->start, start);
+	b->end = max(b->end, end);
+}
+EXPORT_SYMBOL_GPL(flush_icache_batch_add);
+
+/**
+ * flush_icache_batch_finish() - flush all ranges queued in a batch
+ * @b: batch to flush, reinitialised for reuse
+ */
+void flush_icache_batch_finish(struct flush_icache_batch *b)
+{
+	if (b->start < b->end)
+		flush_icache_range(b->start, b->end);
+
+	flush_icache_batch_init(b);
+}
+EXPORT_SYMBOL_GPL(flush_icache_batch_finish);
+
 #ifdef CONFIG_DMA_NONCOHERENT
 
 /* DMA cache operations. */
@@ -4,6 +4,8 @@
 #include <linux/percpu.h>
 #include <linux/spinlock.h>
 
+#include <asm/tlbflush.h>
+
 static DEFINE_RAW_SPINLOCK(cpu_mmid_lock);
 
 static atomic64_t mmid_version;
@@ -185,6 +187,7 @@ void check_switch_mmu_context(struct mm_struct *mm)
 	if (!cpu_has_mmid) {
 		check_mmu_context(mm);
 		write_c0_entryhi(cpu_asid(cpu, mm));
+		local_flush_tlb_pending(mm);
 		goto setup_pgd;
 	}
 
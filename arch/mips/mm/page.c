@@ -10,11 +10,17 @@
  */
 #include <linux/kernel.h>
 #include <linux/sched.h>
+#include <linux/sched/clock.h>
 #include <linux/smp.h>
 #include <linux/mm.h>
+#include <linux/mutex.h>
+#include <linux/slab.h>
 #include <linux/proc_fs.h>
+#include <linux/debugfs.h>
+#include <linux/uaccess.h>
 
 #include <asm/bugs.h>
+#include <asm/cacheflush.h>
 #include <asm/cacheops.h>
 #include <asm/cpu-type.h>
 #include <asm/inst.h>
@@ -25,6 +31,7 @@
 #include <asm/mipsregs.h>
 #include <asm/mmu_context.h>
 #include <asm/cpu.h>
+#include <asm/debug.h>
 #include <asm/war.h>
 
 #ifdef CONFIG_SIBYTE_DMA_PAGEOPS
@@ -91,6 +98,13 @@ static int pref_bias_copy_store;
 static u32 pref_src_mode;
 static u32 pref_dst_mode;
 
+/* Prefetch with loads to $zero instead of pref */
+static bool pref_load_zero;
+#ifdef CONFIG_CPU_LOONGSON2EF
+static int loongson2_clear_pref_bias = 128;
+static int loongson2_copy_pref_bias = 256;
+#endif
+
 static int clear_word_size;
 static int copy_word_size;
 
@@ -211,6 +225,18 @@ static void set_prefetch_parameters(void)
 				pref_dst_mode = Pref_PrepareForStore;
 			break;
 		}
+#ifdef CONFIG_CPU_LOONGSON2EF
+	} else if (current_cpu_type() == CPU_LOONGSON2EF) {
+		/*
+		 * Loongson-2E/2F have no pref, but a load to $zero does not
+		 * stall the pipeline and works as a prefetch.  The biases
+		 * are tuned at boot by loongson2_page_funcs_select().
+		 */
+		cache_line_size = cpu_dcache_line_size();
+		pref_bias_clear_store = loongson2_clear_pref_bias;
+		pref_bias_copy_load = loongson2_copy_pref_bias;
+		pref_load_zero = true;
+#endif
 	} else {
 		if (cpu_has_cache_cdex_s)
 			cache_line_size = cpu_scache_line_size();
@@ -227,6 +253,17 @@ static void set_prefetch_parameters(void)
 	half_copy_loop_size = min(16 * copy_word_size,
 				  max(cache_line_size >> 1,
 				      4 * copy_word_size));
+
+	/*
+	 * The 32-byte lines of the Loongson-2 D-cache make the default loop
+	 * a single line per half; do two to halve the loop overhead.
+	 */
+	if (pref_load_zero) {
+		half_clear_loop_size = min(16 * clear_word_size,
+					   2 * cache_line_size);
+		half_copy_loop_size = min(16 * copy_word_size,
+					  2 * cache_line_size);
+	}
 }
 
 static void build_clear_store(u32 **buf, int off)
@@ -243,7 +280,13 @@ static inline void build_clear_pref(u32 **buf, int off)
 	if (off & cache_line_mask())
 		return;
 
-	if (pref_bias_clear_store) {
+	if (pref_bias_clear_store && pref_load_zero) {
+		/* pull the line in ahead of the stores, see above */
+		if (cpu_has_64bit_gp_regs)
+			uasm_i_ld(buf, ZERO, pref_bias_clear_store + off, A0);
+		else
+			uasm_i_lw(buf, ZERO, pref_bias_clear_store + off, A0);
+	} else if (pref_bias_clear_store) {
 		_uasm_i_pref(buf, pref_dst_mode, pref_bias_clear_store + off,
 			    A0);
 	} else if (cache_line_size == (half_clear_loop_size << 1)) {
@@ -270,18 +313,13 @@ extern u32 __clear_page_end;
 extern u32 __copy_page_start;
 extern u32 __copy_page_end;
 
-void build_clear_page(void)
+static void __build_clear_page(u32 *start, u32 *end)
 {
 	int off;
-	u32 *buf = &__clear_page_start;
+	u32 *buf = start;
 	struct uasm_label *l = labels;
 	struct uasm_reloc *r = relocs;
 	int i;
-	static atomic_t run_once = ATOMIC_INIT(0);
-
-	if (atomic_xchg(&run_once, 1)) {
-		return;
-	}
 
 	memset(labels, 0, sizeof(labels));
 	memset(relocs, 0, sizeof(relocs));
@@ -349,20 +387,31 @@ void build_clear_page(void)
 	uasm_i_jr(&buf, RA);
 	uasm_i_nop(&buf);
 
-	BUG_ON(buf > &__clear_page_end);
+	BUG_ON(buf > end);
 
 	uasm_resolve_relocs(relocs, labels);
 
 	pr_debug("Synthesized clear page handler (%u instructions).\n",
-		 (u32)(buf - &__clear_page_start));
+		 (u32)(buf - start));
 
 	pr_debug("\t.set push\n");
 	pr_debug("\t.set noreorder\n");
-	for (i = 0; i < (buf - &__clear_page_start); i++)
-		pr_debug("\t.word 0x%08x\n", (&__clear_page_start)[i]);
+	for (i = 0; i < (buf - start); i++)
+		pr_debug("\t.word 0x%08x\n", start[i]);
 	pr_debug("\t.set pop\n");
 }
 
+void build_clear_page(void)
+{
+	static atomic_t run_once = ATOMIC_INIT(0);
+
+	if (atomic_xchg(&run_once, 1)) {
+		return;
+	}
+
+	__build_clear_page(&__clear_page_start, &__clear_page_end);
+}
+
 static void build_copy_load(u32 **buf, int reg, int off)
 {
 	if (cpu_has_64bit_gp_regs) {
@@ -386,7 +435,12 @@ static inline void build_copy_load_pref(u32 **buf, int off)
 	if (off & cache_line_mask())
 		return;
 
-	if (pref_bias_copy_load)
+	if (!pref_bias_copy_load)
+		return;
+
+	if (pref_load_zero)
+		build_copy_load(buf, ZERO, pref_bias_copy_load + off);
+	else
 		_uasm_i_pref(buf, pref_src_mode, pref_bias_copy_load + off, A1);
 }
 
@@ -417,18 +471,13 @@ static inline void build_copy_store_pref(u32 **buf, int off)
 	}
 }
 
-void build_copy_page(void)
+static void __build_copy_page(u32 *start, u32 *end)
 {
 	int off;
-	u32 *buf = &__copy_page_start;
+	u32 *buf = start;
 	struct uasm_label *l = labels;
 	struct uasm_reloc *r = relocs;
 	int i;
-	static atomic_t run_once = ATOMIC_INIT(0);
-
-	if (atomic_xchg(&run_once, 1)) {
-		return;
-	}
 
 	memset(labels, 0, sizeof(labels));
 	memset(relocs, 0, sizeof(relocs));
@@ -593,20 +642,328 @@ void build_copy_page(void)
 	uasm_i_jr(&buf, RA);
 	uasm_i_nop(&buf);
 
-	BUG_ON(buf > &__copy_page_end);
+	BUG_ON(buf > end);
 
 	uasm_resolve_relocs(relocs, labels);
 
 	pr_debug("Synthesized copy page handler (%u instructions).\n",
-		 (u32)(buf - &__copy_page_start));
+		 (u32)(buf - start));
 
 	pr_debug("\t.set push\n");
 	pr_debug("\t.set noreorder\n");
-	for (i = 0; i < (buf - &__copy_page_start); i++)
-		pr_debug("\t.word 0x%08x\n", (&__copy_page_start)[i]);
+	for (i = 0; i < (buf - start); i++)
+		pr_debug("\t.word 0x%08x\n", start[i]);
 	pr_debug("\t.set pop\n");
 }
 
+void build_copy_page(void)
+{
+	static atomic_t run_once = ATOMIC_INIT(0);
+
+	if (atomic_xchg(&run_once, 1)) {
+		return;
+	}
+
+	__build_copy_page(&__copy_page_start, &__copy_page_end);
+}
+
+#ifdef CONFIG_CPU_LOONGSON2EF
+/*
+ * The best prefetch distances depend on the memory controller and DDR
+ * timing of the board, so time clearing and copying 64KiB (twice the L1
+ * D-cache) with each candidate and keep the fastest ones.  The candidates
+ * are generated and timed in a scratch buffer, the live routines are only
+ * rewritten once with the winners.  The choice can be forced with
+ * loongson2_pref_bias=<clear>,<copy> and revisited through debugfs.
+ */
+#define LOONGSON2_BENCH_ORDER	4
+#define LOONGSON2_BENCH_ROUNDS	4
+#define LOONGSON2_MAX_PREF_BIAS	512
+
+static const int loongson2_pref_biases[] __initconst = {
+	0, 64, 128, 256, 512
+};
+
+/* Serializes the generators, which share labels, relocs and the biases */
+static DEFINE_MUTEX(loongson2_page_mutex);
+static bool loongson2_pref_bias_fixed;
+
+/* __build_copy_page() wants multiples of 8 doublewords */
+static inline bool loongson2_pref_bias_valid(int bias)
+{
+	return bias >= 0 && bias <= LOONGSON2_MAX_PREF_BIAS &&
+	       !(bias % (8 * sizeof(u64)));
+}
+
+static int __init loongson2_pref_bias_setup(char *str)
+{
+	int clear_bias, copy_bias;
+
+	if (!str || sscanf(str, "%d,%d", &clear_bias, &copy_bias) != 2 ||
+	    !loongson2_pref_bias_valid(clear_bias) ||
+	    !loongson2_pref_bias_valid(copy_bias))
+		return -EINVAL;
+
+	loongson2_clear_pref_bias = clear_bias;
+	loongson2_copy_pref_bias = copy_bias;
+	loongson2_pref_bias_fixed = true;
+
+	return 0;
+}
+early_param("loongson2_pref_bias", loongson2_pref_bias_setup);
+
+/*
+ * Nothing may be running the old code while clear_page() and copy_page()
+ * are rewritten.  With interrupts off that only holds on a uniprocessor
+ * without kernel preemption, where no task can have been switched out
+ * half way through one of them.  Elsewhere the biases can only be chosen
+ * on the command line, before the routines are first generated.
+ */
+static bool loongson2_page_funcs_rewritable(void)
+{
+	return num_possible_cpus() == 1 && !IS_ENABLED(CONFIG_PREEMPTION);
+}
+
+/* Regenerate clear_page and copy_page in place, with the mutex held */
+static void loongson2_rebuild_page_funcs(int clear_bias, int copy_bias)
+{
+	unsigned long flags;
+
+	local_irq_save(flags);
+	loongson2_clear_pref_bias = clear_bias;
+	loongson2_copy_pref_bias = copy_bias;
+	__build_clear_page(&__clear_page_start, &__clear_page_end);
+	__build_copy_page(&__copy_page_start, &__copy_page_end);
+	local_flush_icache_range((unsigned long)&__clear_page_start,
+				 (unsigned long)&__clear_page_end);
+	local_flush_icache_range((unsigned long)&__copy_page_start,
+				 (unsigned long)&__copy_page_end);
+	local_irq_restore(flags);
+}
+
+/*
+ * Best of several rounds over the buffer, in ns.  @fn is a clear_page()
+ * like routine when @src is NULL and a copy_page() like one otherwise.
+ */
+static u64 loongson2_time_page_func(void *fn, void *dst, void *src)
+{
+	void (*clear)(void *) = fn;
+	void (*copy)(void *, void *) = fn;
+	u64 t, best = U64_MAX;
+	int r, i;
+
+	for (r = 0; r < LOONGSON2_BENCH_ROUNDS; r++) {
+		t = local_clock();
+		for (i = 0; i < 1 << LOONGSON2_BENCH_ORDER; i++) {
+			if (src)
+				copy(dst + i * PAGE_SIZE, src + i * PAGE_SIZE);
+			else
+				clear(dst + i * PAGE_SIZE);
+		}
+		best = min(best, local_clock() - t);
+	}
+
+	return best;
+}
+
+static unsigned int loongson2_bench_mbps(u64 ns)
+{
+	return div64_u64((u64)PAGE_SIZE << LOONGSON2_BENCH_ORDER,
+			 max_t(u64, ns / 1000, 1));
+}
+
+static int __init loongson2_page_funcs_select(void)
+{
+	size_t clear_len = (void *)&__clear_page_end - (void *)&__clear_page_start;
+	size_t copy_len = (void *)&__copy_page_end - (void *)&__copy_page_start;
+	int def_clear = loongson2_clear_pref_bias;
+	int def_copy = loongson2_copy_pref_bias;
+	int i, clear_best = 0, copy_best = 0, clear_bias, copy_bias;
+	u64 t, clear_t = U64_MAX, copy_t = U64_MAX;
+	u32 *clear = NULL, *copy = NULL;
+	struct page *src, *dst;
+
+	if (current_cpu_type() != CPU_LOONGSON2EF || loongson2_pref_bias_fixed)
+		return 0;
+
+	src = alloc_pages(GFP_KERNEL, LOONGSON2_BENCH_ORDER);
+	dst = alloc_pages(GFP_KERNEL, LOONGSON2_BENCH_ORDER);
+	clear = kmalloc(clear_len, GFP_KERNEL);
+	copy = kmalloc(copy_len, GFP_KERNEL);
+	if (!src || !dst || !clear || !copy)
+		goto out;
+
+	mutex_lock(&loongson2_page_mutex);
+	for (i = 0; i < ARRAY_SIZE(loongson2_pref_biases); i++) {
+		loongson2_clear_pref_bias = loongson2_pref_biases[i];
+		loongson2_copy_pref_bias = loongson2_pref_biases[i];
+		__build_clear_page(clear, (void *)clear + clear_len);
+		__build_copy_page(copy, (void *)copy + copy_len);
+		local_flush_icache_range((unsigned long)clear,
+					 (unsigned long)clear + clear_len);
+		local_flush_icache_range((unsigned long)copy,
+					 (unsigned long)copy + copy_len);
+
+		t = loongson2_time_page_func(clear, page_address(dst), NULL);
+		pr_debug("clear_page: prefetch bias %d: %llu ns\n",
+			 loongson2_pref_biases[i], t);
+		if (t < clear_t) {
+			clear_t = t;
+			clear_best = i;
+		}
+
+		t = loongson2_time_page_func(copy, page_address(dst),
+					     page_address(src));
+		pr_debug("copy_page: prefetch bias %d: %llu ns\n",
+			 loongson2_pref_biases[i], t);
+		if (t < copy_t) {
+			copy_t = t;
+			copy_best = i;
+		}
+	}
+
+	clear_bias = loongson2_pref_biases[clear_best];
+	copy_bias = loongson2_pref_biases[copy_best];
+	if (loongson2_page_funcs_rewritable()) {
+		loongson2_rebuild_page_funcs(clear_bias, copy_bias);
+		pr_info("clear_page: using store prefetch bias %d (%u MB/s)\n",
+			clear_bias, loongson2_bench_mbps(clear_t));
+		pr_info("copy_page: using load prefetch bias %d (%u MB/s)\n",
+			copy_bias, loongson2_bench_mbps(copy_t));
+	} else {
+		loongson2_clear_pref_bias = def_clear;
+		loongson2_copy_pref_bias = def_copy;
+		pr_info("page: boot with loongson2_pref_bias=%d,%d for %u/%u MB/s clear/copy\n",
+			clear_bias, copy_bias, loongson2_bench_mbps(clear_t),
+			loongson2_bench_mbps(copy_t));
+	}
+	mutex_unlock(&loongson2_page_mutex);
+out:
+	kfree(clear);
+	kfree(copy);
+	if (src)
+		__free_pages(src, LOONGSON2_BENCH_ORDER);
+	if (dst)
+		__free_pages(dst, LOONGSON2_BENCH_ORDER);
+	return 0;
+}
+late_initcall(loongson2_page_funcs_select);
+
+#ifdef CONFIG_DEBUG_FS
+/*
+ * mips/page/{clear,copy}_pref_bias select the prefetch distance and
+ * regenerate the routine, where loongson2_page_funcs_rewritable() allows
+ * it; reading mips/page/bench times both with the current settings.
+ */
+static ssize_t pref_bias_read(struct file *file, char __user *user_buf,
+			      size_t count, loff_t *ppos)
+{
+	int *bias = file->private_data;
+	char buf[16];
+	int len;
+
+	len = scnprintf(buf, sizeof(buf), "%d\n", *bias);
+	return simple_read_from_buffer(user_buf, count, ppos, buf, len);
+}
+
+static ssize_t pref_bias_write(struct file *file, const char __user *user_buf,
+			       size_t count, loff_t *ppos)
+{
+	int *bias = file->private_data;
+	int clear_bias, copy_bias;
+	unsigned int val;
+	int err;
+
+	err = kstrtouint_from_user(user_buf, count, 0, &val);
+	if (err)
+		return err;
+
+	if (!loongson2_pref_bias_valid(val))
+		return -EINVAL;
+
+	/* same constraint as the boot time selection */
+	if (!loongson2_page_funcs_rewritable())
+		return -EBUSY;
+
+	mutex_lock(&loongson2_page_mutex);
+	clear_bias = loongson2_clear_pref_bias;
+	copy_bias = loongson2_copy_pref_bias;
+	if (bias == &loongson2_clear_pref_bias)
+		clear_bias = val;
+	else
+		copy_bias = val;
+
+	loongson2_rebuild_page_funcs(clear_bias, copy_bias);
+	mutex_unlock(&loongson2_page_mutex);
+
+	return count;
+}
+
+static const struct file_operations pref_bias_fops = {
+	.open = simple_open,
+	.llseek = default_llseek,
+	.read = pref_bias_read,
+	.write = pref_bias_write,
+};
+
+static ssize_t page_bench_read(struct file *file, char __user *user_buf,
+			       size_t count, loff_t *ppos)
+{
+	struct page *src, *dst;
+	u64 clear_t, copy_t;
+	char buf[64];
+	int len;
+
+	if (*ppos)
+		return 0;
+
+	src = alloc_pages(GFP_KERNEL, LOONGSON2_BENCH_ORDER);
+	dst = alloc_pages(GFP_KERNEL, LOONGSON2_BENCH_ORDER);
+	if (!src || !dst) {
+		len = -ENOMEM;
+		goto out;
+	}
+
+	clear_t = loongson2_time_page_func(clear_page, page_address(dst), NULL);
+	copy_t = loongson2_time_page_func(copy_page, page_address(dst),
+					  page_address(src));
+
+	len = scnprintf(buf, sizeof(buf), "clear_page %u MB/s\ncopy_page %u MB/s\n",
+			loongson2_bench_mbps(clear_t),
+			loongson2_bench_mbps(copy_t));
+	len = simple_read_from_buffer(user_buf, count, ppos, buf, len);
+out:
+	if (src)
+		__free_pages(src, LOONGSON2_BENCH_ORDER);
+	if (dst)
+		__free_pages(dst, LOONGSON2_BENCH_ORDER);
+	return len;
+}
+
+static const struct file_operations page_bench_fops = {
+	.open = simple_open,
+	.read = page_bench_read,
+};
+
+static int __init loongson2_page_debugfs_init(void)
+{
+	struct dentry *dir;
+
+	if (current_cpu_type() != CPU_LOONGSON2EF)
+		return 0;
+
+	dir = debugfs_create_dir("page", mips_debugfs_dir);
+	debugfs_create_file("clear_pref_bias", S_IRUGO | S_IWUSR, dir,
+			    &loongson2_clear_pref_bias, &pref_bias_fops);
+	debugfs_create_file("copy_pref_bias", S_IRUGO | S_IWUSR, dir,
+			    &loongson2_copy_pref_bias, &pref_bias_fops);
+	debugfs_create_file("bench", S_IRUSR, dir, NULL, &page_bench_fops);
+	return 0;
+}
+late_initcall(loongson2_page_debugfs_init);
+#endif /* CONFIG_DEBUG_FS */
+#endif /* CONFIG_CPU_LOONGSON2EF */
+
 #ifdef CONFIG_SIBYTE_DMA_PAGEOPS
 extern void clear_page_cpu(void *page);
 extern void copy_page_cpu(void *to, void *from);
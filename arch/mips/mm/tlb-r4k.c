@@ -9,6 +9,7 @@
  * Copyright (C) 2002 MIPS Technologies, Inc.  All rights reserved.
  */
 #include <linux/cpu_pm.h>
+#include <linux/debugfs.h>
 #include <linux/init.h>
 #include <linux/sched.h>
 #include <linux/smp.h>
@@ -19,6 +20,7 @@
 #include <asm/cpu.h>
 #include <asm/cpu-type.h>
 #include <asm/bootinfo.h>
+#include <asm/debug.h>
 #include <asm/hazards.h>
 #include <asm/mmu_context.h>
 #include <asm/tlb.h>
@@ -103,6 +105,172 @@ void local_flush_tlb_all(void)
 }
 EXPORT_SYMBOL(local_flush_tlb_all);
 
+/* Page pairs up to which probing beats starting over with a new ASID */
+static inline unsigned long tlb_range_flush_limit(void)
+{
+	return current_cpu_data.tlbsizeftlbsets ?
+	       current_cpu_data.tlbsize / 8 :
+	       current_cpu_data.tlbsize / 2;
+}
+
+/*
+ * Probe for and invalidate the entries of mm in [start, end), which must
+ * be page pair aligned.  Interrupts must be disabled.  Returns the number
+ * of probes.
+ */
+static unsigned long __flush_tlb_mm_range(int cpu, struct mm_struct *mm,
+					  unsigned long start,
+					  unsigned long end)
+{
+	unsigned long old_entryhi, old_mmid;
+	unsigned long probes = 0;
+	int newpid = cpu_asid(cpu, mm);
+
+	old_entryhi = read_c0_entryhi();
+	if (cpu_has_mmid) {
+		old_mmid = read_c0_memorymapid();
+		write_c0_memorymapid(newpid);
+	}
+
+	htw_stop();
+	while (start < end) {
+		int idx;
+
+		if (cpu_has_mmid)
+			write_c0_entryhi(start);
+		else
+			write_c0_entryhi(start | newpid);
+		start += (PAGE_SIZE << 1);
+		probes++;
+		mtc0_tlbw_hazard();
+		tlb_probe();
+		tlb_probe_hazard();
+		idx = read_c0_index();
+		write_c0_entrylo0(0);
+		write_c0_entrylo1(0);
+		if (idx < 0)
+			continue;
+		/* Make sure all entries differ. */
+		write_c0_entryhi(UNIQUE_ENTRYHI(idx));
+		mtc0_tlbw_hazard();
+		tlb_write_indexed();
+	}
+	tlbw_use_hazard();
+	write_c0_entryhi(old_entryhi);
+	if (cpu_has_mmid)
+		write_c0_memorymapid(old_mmid);
+	htw_start();
+
+	return probes;
+}
+
+#if defined(CONFIG_CPU_R4K_CACHE_TLB) && !defined(CONFIG_SMP)
+
+static struct {
+	u64 deferred;		/* range and page flushes deferred */
+	u64 flushed;		/* pending flushes applied at switch_mm() */
+	u64 dropped;		/* pending flushes replaced by a new ASID */
+	u64 saved_probes;	/* TLB probes avoided by merging or dropping */
+} tlb_batch_stats;
+
+/*
+ * The entries of an mm that is not live on this CPU cannot be hit before
+ * the next switch_mm() to it.  On UP kernels, rather than probing for
+ * them right away, merge the range into the mm's pending flush, which
+ * local_flush_tlb_pending() applies from check_switch_mmu_context().
+ * Reclaim, migration and munmap() on a process that is not running then
+ * cost one probe per page pair of the merged range, or nothing at all if
+ * the mm exits or loses its ASID first.
+ *
+ * Must be called with interrupts disabled.
+ */
+static bool tlb_defer_flush(int cpu, struct mm_struct *mm,
+			    unsigned long start, unsigned long end)
+{
+	mm_context_t *ctx = &mm->context;
+	unsigned long pairs = (end - start) >> (PAGE_SHIFT + 1);
+
+	if (cpu_has_mmid || cpumask_test_cpu(cpu, mm_cpumask(mm)))
+		return false;
+
+	tlb_batch_stats.deferred++;
+
+	if (ctx->tlb_flush_end &&
+	    ctx->tlb_flush_asid == cpu_context(cpu, mm)) {
+		start = min(start, ctx->tlb_flush_start);
+		end = max(end, ctx->tlb_flush_end);
+		pairs += ctx->tlb_flush_pairs;
+	} else if (ctx->tlb_flush_end) {
+		/* the old ASID went away along with what was pending */
+		tlb_batch_stats.saved_probes += ctx->tlb_flush_pairs;
+	}
+
+	if (((end - start) >> (PAGE_SHIFT + 1)) > tlb_range_flush_limit()) {
+		/* will get a new context next time */
+		set_cpu_context(cpu, mm, 0);
+		ctx->tlb_flush_end = 0;
+		tlb_batch_stats.dropped++;
+		tlb_batch_stats.saved_probes += pairs;
+		return true;
+	}
+
+	ctx->tlb_flush_start = start;
+	ctx->tlb_flush_end = end;
+	ctx->tlb_flush_pairs = pairs;
+	ctx->tlb_flush_asid = cpu_context(cpu, mm);
+	return true;
+}
+
+/* Apply the deferred flush of mm, which is being switched to. */
+void local_flush_tlb_pending(struct mm_struct *mm)
+{
+	mm_context_t *ctx = &mm->context;
+	int cpu = smp_processor_id();
+	unsigned long probes = 0;
+
+	if (likely(!ctx->tlb_flush_end))
+		return;
+
+	/*
+	 * If the mm got a new ASID in the meantime the stale entries are
+	 * unreachable, and gone by the time the old ASID is reused.
+	 */
+	if (ctx->tlb_flush_asid == cpu_context(cpu, mm)) {
+		probes = __flush_tlb_mm_range(cpu, mm, ctx->tlb_flush_start,
+					      ctx->tlb_flush_end);
+		flush_micro_tlb();
+		tlb_batch_stats.flushed++;
+	}
+	tlb_batch_stats.saved_probes += ctx->tlb_flush_pairs - probes;
+	ctx->tlb_flush_end = 0;
+}
+
+#ifdef CONFIG_DEBUG_FS
+static int __init tlb_batch_debugfs_init(void)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("tlb_batch", mips_debugfs_dir);
+	debugfs_create_u64("deferred", S_IRUGO, dir, &tlb_batch_stats.deferred);
+	debugfs_create_u64("flushed", S_IRUGO, dir, &tlb_batch_stats.flushed);
+	debugfs_create_u64("dropped", S_IRUGO, dir, &tlb_batch_stats.dropped);
+	debugfs_create_u64("saved_probes", S_IRUGO, dir,
+			   &tlb_batch_stats.saved_probes);
+	return 0;
+}
+late_initcall(tlb_batch_debugfs_init);
+#endif
+
+#else
+
+static inline bool tlb_defer_flush(int cpu, struct mm_struct *mm,
+				   unsigned long start, unsigned long end)
+{
+	return false;
+}
+
+#endif
+
 void local_flush_tlb_range(struct vm_area_struct *vma, unsigned long start,
 	unsigned long end)
 {
@@ -116,48 +284,14 @@ void local_flush_tlb_range(struct vm_area_struct *vma, unsigned long start,
 		start = round_down(start, PAGE_SIZE << 1);
 		end = round_up(end, PAGE_SIZE << 1);
 		size = (end - start) >> (PAGE_SHIFT + 1);
-		if (size <= (current_cpu_data.tlbsizeftlbsets ?
-			     current_cpu_data.tlbsize / 8 :
-			     current_cpu_data.tlbsize / 2)) {
-			unsigned long old_entryhi, old_mmid;
-			int newpid = cpu_asid(cpu, mm);
-
-			old_entryhi = read_c0_entryhi();
-			if (cpu_has_mmid) {
-				old_mmid = read_c0_memorymapid();
-				write_c0_memorymapid(newpid);
-			}
-
-			htw_stop();
-			while (start < end) {
-				int idx;
-
-				if (cpu_has_mmid)
-					write_c0_entryhi(start);
-				else
-					write_c0_entryhi(start | newpid);
-				start += (PAGE_SIZE << 1);
-				mtc0_tlbw_hazard();
-				tlb_probe();
-				tlb_probe_hazard();
-				idx = read_c0_index();
-				write_c0_entrylo0(0);
-				write_c0_entrylo1(0);
-				if (idx < 0)
-					continue;
-				/* Make sure all entries differ. */
-				write_c0_entryhi(UNIQUE_ENTRYHI(idx));
-				mtc0_tlbw_hazard();
-				tlb_write_indexed();
-			}
-			tlbw_use_hazard();
-			write_c0_entryhi(old_entryhi);
-			if (cpu_has_mmid)
-				write_c0_memorymapid(old_mmid);
-			htw_start();
-		} else {
-			drop_mmu_context(mm);
+		if (tlb_defer_flush(cpu, mm, start, end)) {
+			local_irq_restore(flags);
+			return;
 		}
+		if (size <= tlb_range_flush_limit())
+			__flush_tlb_mm_range(cpu, mm, start, end);
+		else
+			drop_mmu_context(mm);
 		flush_micro_tlb();
 		local_irq_restore(flags);
 	}
@@ -170,9 +304,7 @@ void local_flush_tlb_kernel_range(unsigned long start, unsigned long end)
 	local_irq_save(flags);
 	size = (end - start + (PAGE_SIZE - 1)) >> PAGE_SHIFT;
 	size = (size + 1) >> 1;
-	if (size <= (current_cpu_data.tlbsizeftlbsets ?
-		     current_cpu_data.tlbsize / 8 :
-		     current_cpu_data.tlbsize / 2)) {
+	if (size <= tlb_range_flush_limit()) {
 		int pid = read_c0_entryhi();
 
 		start &= (PAGE_MASK << 1);
@@ -219,6 +351,11 @@ void local_flush_tlb_page(struct vm_area_struct *vma, unsigned long page)
 
 		page &= (PAGE_MASK << 1);
 		local_irq_save(flags);
+		if (tlb_defer_flush(cpu, vma->vm_mm, page,
+				    page + (PAGE_SIZE << 1))) {
+			local_irq_restore(flags);
+			return;
+		}
 		old_entryhi = read_c0_entryhi();
 		htw_stop();
 		if (cpu_has_mmid) {
@@ -420,9 +557,14 @@ void add_wired_entry(unsigned long entrylo0, unsigned long entrylo1,
 #endif
 }
 
-#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+#ifdef CONFIG_MIPS_HUGE_TLB_SUPPORT
 
-int has_transparent_hugepage(void)
+/*
+ * Not every CPU implements the huge page size of every base page size,
+ * e.g. Loongson-2F stops at 16MB pages so there is no huge TLB entry to
+ * go with 64KB base pages.  Check that PageMask takes PM_HUGE_MASK.
+ */
+int mips_has_huge_tlb(void)
 {
 	static unsigned int mask = -1;
 
@@ -439,6 +581,70 @@ int has_transparent_hugepage(void)
 	return mask == PM_HUGE_MASK;
 }
 
+#endif /* CONFIG_MIPS_HUGE_TLB_SUPPORT */
+
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+
+int has_transparent_hugepage(void)
+{
+	return mips_has_huge_tlb();
+}
+
+/*
+ * A huge PMD is mapped by a single TLB entry, so probe for just that
+ * entry.  The generic flush_tlb_range() would see HPAGE_SIZE as a few
+ * hundred pages and drop the whole context, costing every other mapping
+ * of the mm its TLB entries on each THP split, migration or protection
+ * change.
+ */
+void local_flush_pmd_tlb_range(struct vm_area_struct *vma,
+	unsigned long start, unsigned long end)
+{
+	struct mm_struct *mm = vma->vm_mm;
+	int cpu = smp_processor_id();
+	unsigned long flags, old_entryhi, old_mmid;
+	int idx, newpid;
+
+	if (cpu_context(cpu, mm) == 0)
+		return;
+
+	local_irq_save(flags);
+	start &= HPAGE_MASK;
+	newpid = cpu_asid(cpu, mm);
+	old_entryhi = read_c0_entryhi();
+	if (cpu_has_mmid) {
+		old_mmid = read_c0_memorymapid();
+		write_c0_memorymapid(newpid);
+	}
+
+	htw_stop();
+	for (; start < end; start += HPAGE_SIZE) {
+		if (cpu_has_mmid)
+			write_c0_entryhi(start);
+		else
+			write_c0_entryhi(start | newpid);
+		mtc0_tlbw_hazard();
+		tlb_probe();
+		tlb_probe_hazard();
+		idx = read_c0_index();
+		if (idx < 0)
+			continue;
+		write_c0_entrylo0(0);
+		write_c0_entrylo1(0);
+		/* Make sure all entries differ. */
+		write_c0_entryhi(UNIQUE_ENTRYHI(idx));
+		mtc0_tlbw_hazard();
+		tlb_write_indexed();
+	}
+	tlbw_use_hazard();
+	write_c0_entryhi(old_entryhi);
+	if (cpu_has_mmid)
+		write_c0_memorymapid(old_mmid);
+	htw_start();
+	flush_micro_tlb_vm(vma);
+	local_irq_restore(flags);
+}
+
 #endif /* CONFIG_TRANSPARENT_HUGEPAGE  */
 
 /*
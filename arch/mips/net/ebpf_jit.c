@@ -138,6 +138,59 @@ do {								\
 #define emit_instr(ctx, func, ...)				\
 	emit_instr_long(ctx, func, func, ##__VA_ARGS__)
 
+#ifdef CONFIG_CPU_NOP_WORKAROUNDS
+/*
+ * The rest of a Loongson-2F kernel is built with -mfix-loongson2f-nop,
+ * emit the same replacement for the canonical nop.
+ */
+#undef uasm_i_nop
+#define uasm_i_nop(buf) uasm_i_or(buf, MIPS_R_AT, MIPS_R_AT, MIPS_R_ZERO)
+#endif
+
+/* Zero extend a 32-bit value, dinsu is not available before MIPS64r2. */
+static void emit_zext_32(struct jit_ctx *ctx, int reg)
+{
+	if (MIPS_ISA_REV >= 2) {
+		emit_instr(ctx, dinsu, reg, MIPS_R_ZERO, 32, 32);
+	} else {
+		emit_instr(ctx, dsll32, reg, reg, 0);
+		emit_instr(ctx, dsrl32, reg, reg, 0);
+	}
+}
+
+/*
+ * Loongson-2F may speculatively fetch from the target of an indirect
+ * jump, which can hang the machine if it points into I/O space.  Mask
+ * the target the same way -mfix-loongson2f-jump does for compiled code.
+ * Clobbers AT.
+ */
+static void emit_jump_fixup(struct jit_ctx *ctx, int reg)
+{
+	if (!IS_ENABLED(CONFIG_CPU_JUMP_WORKAROUNDS))
+		return;
+
+	emit_instr(ctx, lui, MIPS_R_AT, (s16)0xcfff);
+	emit_instr(ctx, ori, MIPS_R_AT, MIPS_R_AT, 0xffff);
+	emit_instr(ctx, and, reg, reg, MIPS_R_AT);
+}
+
+/*
+ * Swap the bytes of the sign extended 32-bit value in reg without the
+ * MIPS32r2 wsbh/rotr, leaving it sign extended.  Clobbers t1 and t2.
+ */
+static void emit_bswap_32(struct jit_ctx *ctx, int reg, int t1, int t2)
+{
+	emit_instr(ctx, sll, t1, reg, 24);
+	emit_instr(ctx, srl, t2, reg, 24);
+	emit_instr(ctx, or, t1, t1, t2);
+	emit_instr(ctx, andi, t2, reg, 0xff00);
+	emit_instr(ctx, sll, t2, t2, 8);
+	emit_instr(ctx, or, t1, t1, t2);
+	emit_instr(ctx, srl, t2, reg, 8);
+	emit_instr(ctx, andi, t2, t2, 0xff00);
+	emit_instr(ctx, or, reg, t1, t2);
+}
+
 static unsigned int j_target(struct jit_ctx *ctx, int target_idx)
 {
 	unsigned long target_va, base_va;
@@ -394,6 +447,7 @@ static int build_int_epilogue(struct jit_ctx *ctx, int dest_reg)
 					MIPS_R_S4, store_offset, MIPS_R_SP);
 		store_offset -= sizeof(long);
 	}
+	emit_jump_fixup(ctx, dest_reg);
 	emit_instr(ctx, jr, dest_reg);
 
 	if (stack_adjust)
@@ -462,7 +516,7 @@ static int gen_imm_insn(const struct bpf_insn *insn, struct jit_ctx *ctx,
 	if (BPF_CLASS(insn->code) == BPF_ALU64 &&
 	    BPF_OP(insn->code) != BPF_MOV &&
 	    get_reg_val_type(ctx, idx, insn->dst_reg) == REG_32BIT)
-		emit_instr(ctx, dinsu, dst, MIPS_R_ZERO, 32, 32);
+		emit_zext_32(ctx, dst);
 	/* BPF_ALU | BPF_LSH doesn't need separate sign extension */
 	if (BPF_CLASS(insn->code) == BPF_ALU &&
 	    BPF_OP(insn->code) != BPF_LSH &&
@@ -698,7 +752,7 @@ static int build_one_insn(const struct bpf_insn *insn, struct jit_ctx *ctx,
 		if (dst < 0)
 			return dst;
 		if (get_reg_val_type(ctx, this_idx, insn->dst_reg) == REG_32BIT)
-			emit_instr(ctx, dinsu, dst, MIPS_R_ZERO, 32, 32);
+			emit_zext_32(ctx, dst);
 		if (insn->imm == 1) /* Mult by 1 is a nop */
 			break;
 		gen_imm_to_reg(insn, MIPS_R_AT, ctx);
@@ -714,7 +768,7 @@ static int build_one_insn(const struct bpf_insn *insn, struct jit_ctx *ctx,
 		if (dst < 0)
 			return dst;
 		if (get_reg_val_type(ctx, this_idx, insn->dst_reg) == REG_32BIT)
-			emit_instr(ctx, dinsu, dst, MIPS_R_ZERO, 32, 32);
+			emit_zext_32(ctx, dst);
 		emit_instr(ctx, dsubu, dst, MIPS_R_ZERO, dst);
 		break;
 	case BPF_ALU | BPF_MUL | BPF_K: /* ALU_IMM */
@@ -786,7 +840,7 @@ static int build_one_insn(const struct bpf_insn *insn, struct jit_ctx *ctx,
 		if (dst < 0)
 			return dst;
 		if (get_reg_val_type(ctx, this_idx, insn->dst_reg) == REG_32BIT)
-			emit_instr(ctx, dinsu, dst, MIPS_R_ZERO, 32, 32);
+			emit_zext_32(ctx, dst);
 		if (insn->imm == 1) {
 			/* div by 1 is a nop, mod by 1 is zero */
 			if (bpf_op == BPF_MOD)
@@ -824,7 +878,7 @@ static int build_one_insn(const struct bpf_insn *insn, struct jit_ctx *ctx,
 		if (src < 0 || dst < 0)
 			return -EINVAL;
 		if (get_reg_val_type(ctx, this_idx, insn->dst_reg) == REG_32BIT)
-			emit_instr(ctx, dinsu, dst, MIPS_R_ZERO, 32, 32);
+			emit_zext_32(ctx, dst);
 		did_move = false;
 		if (insn->src_reg == BPF_REG_10) {
 			if (bpf_op == BPF_MOV) {
@@ -842,7 +896,7 @@ static int build_one_insn(const struct bpf_insn *insn, struct jit_ctx *ctx,
 				did_move = true;
 			}
 			emit_instr(ctx, daddu, tmp_reg, src, MIPS_R_ZERO);
-			emit_instr(ctx, dinsu, tmp_reg, MIPS_R_ZERO, 32, 32);
+			emit_zext_32(ctx, tmp_reg);
 			src = MIPS_R_AT;
 		}
 		switch (bpf_op) {
@@ -958,7 +1012,12 @@ static int build_one_insn(const struct bpf_insn *insn, struct jit_ctx *ctx,
 			emit_instr(ctx, and, dst, dst, src);
 			break;
 		case BPF_MUL:
-			emit_instr(ctx, mul, dst, dst, src);
+			if (MIPS_ISA_REV >= 1) {
+				emit_instr(ctx, mul, dst, dst, src);
+			} else {
+				emit_instr(ctx, multu, dst, src);
+				emit_instr(ctx, mflo, dst);
+			}
 			break;
 		case BPF_DIV:
 		case BPF_MOD:
@@ -1075,6 +1134,9 @@ static int build_one_insn(const struct bpf_insn *insn, struct jit_ctx *ctx,
 			if (MIPS_ISA_REV >= 6) {
 				emit_instr(ctx, seleqz, MIPS_R_T9,
 						MIPS_R_SP, MIPS_R_T8);
+			} else if (MIPS_ISA_REV < 1) {
+				/* no movz/movn on MIPS III */
+				emit_instr(ctx, sltiu, MIPS_R_T9, MIPS_R_T8, 1);
 			} else {
 				emit_instr(ctx, movz, MIPS_R_T9,
 						MIPS_R_SP, MIPS_R_T8);
@@ -1309,6 +1371,7 @@ static int build_one_insn(const struct bpf_insn *insn, struct jit_ctx *ctx,
 		ctx->flags |= EBPF_SAVE_RA;
 		t64s = (s64)insn->imm + (long)__bpf_call_base;
 		emit_const_to_reg(ctx, MIPS_R_T9, (u64)t64s);
+		emit_jump_fixup(ctx, MIPS_R_T9);
 		emit_instr(ctx, jalr, MIPS_R_RA, MIPS_R_T9);
 		/* delay slot */
 		emit_instr(ctx, nop);
@@ -1326,7 +1389,7 @@ static int build_one_insn(const struct bpf_insn *insn, struct jit_ctx *ctx,
 			return dst;
 		td = get_reg_val_type(ctx, this_idx, insn->dst_reg);
 		if (insn->imm == 64 && td == REG_32BIT)
-			emit_instr(ctx, dinsu, dst, MIPS_R_ZERO, 32, 32);
+			emit_zext_32(ctx, dst);
 
 		if (insn->imm != 64 && td == REG_64BIT) {
 			/* sign extend */
@@ -1339,18 +1402,36 @@ static int build_one_insn(const struct bpf_insn *insn, struct jit_ctx *ctx,
 		need_swap = (BPF_SRC(insn->code) == BPF_FROM_BE);
 #endif
 		if (insn->imm == 16) {
-			if (need_swap)
+			if (need_swap && MIPS_ISA_REV >= 2) {
 				emit_instr(ctx, wsbh, dst, dst);
+			} else if (need_swap) {
+				emit_instr(ctx, andi, MIPS_R_AT, dst, 0xff);
+				emit_instr(ctx, sll, MIPS_R_AT, MIPS_R_AT, 8);
+				emit_instr(ctx, srl, dst, dst, 8);
+				emit_instr(ctx, andi, dst, dst, 0xff);
+				emit_instr(ctx, or, dst, dst, MIPS_R_AT);
+			}
 			emit_instr(ctx, andi, dst, dst, 0xffff);
 		} else if (insn->imm == 32) {
-			if (need_swap) {
+			if (need_swap && MIPS_ISA_REV >= 2) {
 				emit_instr(ctx, wsbh, dst, dst);
 				emit_instr(ctx, rotr, dst, dst, 16);
+			} else if (need_swap) {
+				emit_bswap_32(ctx, dst, MIPS_R_AT, MIPS_R_T9);
 			}
 		} else { /* 64-bit*/
-			if (need_swap) {
+			if (need_swap && MIPS_ISA_REV >= 2) {
 				emit_instr(ctx, dsbh, dst, dst);
 				emit_instr(ctx, dshd, dst, dst);
+			} else if (need_swap) {
+				/* swap each word, then exchange the words */
+				emit_instr(ctx, sll, MIPS_R_T8, dst, 0);
+				emit_instr(ctx, dsra32, dst, dst, 0);
+				emit_bswap_32(ctx, MIPS_R_T8, MIPS_R_AT, MIPS_R_T9);
+				emit_bswap_32(ctx, dst, MIPS_R_AT, MIPS_R_T9);
+				emit_instr(ctx, dsll32, MIPS_R_T8, MIPS_R_T8, 0);
+				emit_zext_32(ctx, dst);
+				emit_instr(ctx, or, dst, dst, MIPS_R_T8);
 			}
 		}
 		break;
@@ -1469,7 +1550,7 @@ static int build_one_insn(const struct bpf_insn *insn, struct jit_ctx *ctx,
 			case BPF_DW:
 				if (get_reg_val_type(ctx, this_idx, insn->src_reg) == REG_32BIT) {
 					emit_instr(ctx, daddu, MIPS_R_AT, src, MIPS_R_ZERO);
-					emit_instr(ctx, dinsu, MIPS_R_AT, MIPS_R_ZERO, 32, 32);
+					emit_zext_32(ctx, MIPS_R_AT);
 					src = MIPS_R_AT;
 				}
 				emit_instr(ctx, lld, MIPS_R_T8, mem_off, dst);
@@ -1493,7 +1574,7 @@ static int build_one_insn(const struct bpf_insn *insn, struct jit_ctx *ctx,
 			case BPF_DW:
 				if (get_reg_val_type(ctx, this_idx, insn->src_reg) == REG_32BIT) {
 					emit_instr(ctx, daddu, MIPS_R_AT, src, MIPS_R_ZERO);
-					emit_instr(ctx, dinsu, MIPS_R_AT, MIPS_R_ZERO, 32, 32);
+					emit_zext_32(ctx, MIPS_R_AT);
 					src = MIPS_R_AT;
 				}
 				emit_instr(ctx, sd, src, mem_off, dst);
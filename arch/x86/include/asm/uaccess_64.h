@@ -9,6 +9,7 @@
 #include <linux/lockdep.h>
 #include <linux/kasan-checks.h>
 #include <asm/alternative.h>
+#include <asm/barrier.h>
 #include <asm/cpufeatures.h>
 #include <asm/page.h>
 
@@ -96,6 +97,24 @@ __copy_from_user_inatomic_nocache(void *dst, const void __user *src,
 	return __copy_user_nocache(dst, src, size, 0);
 }
 
+/*
+ * Non-temporal copy out, for large reads whose data is not going to be
+ * touched again by this CPU.  __copy_user_nocache() handles faults on the
+ * stores as well as on the loads, so it works in this direction too.
+ */
+static inline unsigned long
+raw_copy_to_user_nocache(void __user *dst, const void *src, unsigned size)
+{
+	long ret = __copy_user_nocache((__force void *)dst,
+				       (__force const void __user *)src,
+				       size, 0);
+
+	/* Order the weakly ordered stores before anything that follows */
+	wmb();
+	return ret;
+}
+#define raw_copy_to_user_nocache raw_copy_to_user_nocache
+
 static inline int
 __copy_from_user_flushcache(void *dst, const void __user *src, unsigned size)
 {
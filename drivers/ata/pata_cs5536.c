@@ -24,6 +24,8 @@
 #include <linux/blkdev.h>
 #include <linux/delay.h>
 #include <linux/libata.h>
+#include <linux/ktime.h>
+#include <linux/log2.h>
 #include <scsi/scsi_host.h>
 #include <linux/dmi.h>
 
@@ -41,7 +43,25 @@ MODULE_PARM_DESC(msr, "Force using MSR to configure IDE function (Default: 0)");
 #endif
 
 #define DRV_NAME	"pata_cs5536"
-#define DRV_VERSION	"0.0.8"
+#define DRV_VERSION	"0.0.9"
+
+/* log2(usec) buckets, the last one collects everything slower */
+#define CS5536_LAT_BUCKETS	20
+
+/*
+ * Per-port DMA command statistics.  PATA has no command queueing, so there
+ * is at most one DMA command in flight and exactly one completion interrupt
+ * per command; the only way to lower the interrupt rate is larger commands,
+ * which is what these numbers help to tune (max_sectors, read-ahead).
+ */
+struct cs5536_port_stats {
+	u64		issue_ns;	/* start of the command in flight */
+	u64		cmds[2];	/* [0] = reads, [1] = writes */
+	u64		bytes[2];
+	u64		total_us;
+	u64		max_us;
+	u64		lat[CS5536_LAT_BUCKETS];
+};
 
 enum {
 	MSR_IDE_CFG		= 0x51300010,
@@ -217,8 +237,123 @@ static void cs5536_set_dmamode(struct ata_port *ap, struct ata_device *adev)
 	cs5536_write(pdev, ETC, etc);
 }
 
+/**
+ *	cs5536_qc_issue		-	command issue
+ *	@qc: command pending
+ *
+ *	Timestamp DMA commands for the latency statistics.
+ */
+
+static unsigned int cs5536_qc_issue(struct ata_queued_cmd *qc)
+{
+	struct cs5536_port_stats *st = qc->ap->private_data;
+
+	if (ata_is_dma(qc->tf.protocol))
+		st->issue_ns = ktime_get_ns();
+
+	return ata_bmdma_qc_issue(qc);
+}
+
+/**
+ *	cs5536_bmdma_stop	-	DMA completion
+ *	@qc: command completing
+ *
+ *	Called once per DMA command from the interrupt and error handlers;
+ *	account the command before handing over to the generic code.
+ */
+
+static void cs5536_bmdma_stop(struct ata_queued_cmd *qc)
+{
+	struct cs5536_port_stats *st = qc->ap->private_data;
+	int dir = !!(qc->tf.flags & ATA_TFLAG_WRITE);
+	u64 us;
+
+	ata_bmdma_stop(qc);
+
+	if (!st->issue_ns)
+		return;
+
+	us = div_u64(ktime_get_ns() - st->issue_ns, NSEC_PER_USEC);
+	st->issue_ns = 0;
+
+	st->cmds[dir]++;
+	st->bytes[dir] += qc->nbytes;
+	st->total_us += us;
+	if (us > st->max_us)
+		st->max_us = us;
+	st->lat[min_t(unsigned int, us ? ilog2(us) + 1 : 0,
+		      CS5536_LAT_BUCKETS - 1)]++;
+}
+
+static int cs5536_port_start(struct ata_port *ap)
+{
+	ap->private_data = devm_kzalloc(ap->host->dev,
+					sizeof(struct cs5536_port_stats),
+					GFP_KERNEL);
+	if (!ap->private_data)
+		return -ENOMEM;
+
+	return ata_bmdma_port_start32(ap);
+}
+
+static ssize_t cs5536_show_udma_stats(struct device *dev,
+				      struct device_attribute *attr, char *buf)
+{
+	struct ata_port *ap = ata_shost_to_port(class_to_shost(dev));
+	struct cs5536_port_stats st;
+	unsigned long flags;
+	ssize_t len;
+	int i;
+
+	if (!ap->private_data)
+		return -ENODEV;
+
+	spin_lock_irqsave(ap->lock, flags);
+	st = *(struct cs5536_port_stats *)ap->private_data;
+	spin_unlock_irqrestore(ap->lock, flags);
+
+	len = sprintf(buf, "reads %llu %llu\nwrites %llu %llu\n",
+		      st.cmds[0], st.bytes[0], st.cmds[1], st.bytes[1]);
+	len += sprintf(buf + len, "total_us %llu\nmax_us %llu\nlatency_us",
+		       st.total_us, st.max_us);
+	for (i = 0; i < CS5536_LAT_BUCKETS; i++)
+		len += sprintf(buf + len, " %llu", st.lat[i]);
+	len += sprintf(buf + len, "\n");
+
+	return len;
+}
+
+static ssize_t cs5536_store_udma_stats(struct device *dev,
+				       struct device_attribute *attr,
+				       const char *buf, size_t count)
+{
+	struct ata_port *ap = ata_shost_to_port(class_to_shost(dev));
+	struct cs5536_port_stats *st = ap->private_data;
+	unsigned long flags;
+
+	if (!st)
+		return -ENODEV;
+
+	/* any write resets the counters, keeping the command in flight */
+	spin_lock_irqsave(ap->lock, flags);
+	memset(st->cmds, 0, sizeof(*st) - offsetof(struct cs5536_port_stats,
+						   cmds));
+	spin_unlock_irqrestore(ap->lock, flags);
+
+	return count;
+}
+
+static DEVICE_ATTR(udma_stats, S_IRUGO | S_IWUSR,
+		   cs5536_show_udma_stats, cs5536_store_udma_stats);
+
+static struct device_attribute *cs5536_shost_attrs[] = {
+	&dev_attr_udma_stats,
+	NULL
+};
+
 static struct scsi_host_template cs5536_sht = {
 	ATA_BMDMA_SHT(DRV_NAME),
+	.shost_attrs		= cs5536_shost_attrs,
 };
 
 static struct ata_port_operations cs5536_port_ops = {
@@ -226,6 +361,9 @@ static struct ata_port_operations cs5536_port_ops = {
 	.cable_detect		= cs5536_cable_detect,
 	.set_piomode		= cs5536_set_piomode,
 	.set_dmamode		= cs5536_set_dmamode,
+	.qc_issue		= cs5536_qc_issue,
+	.bmdma_stop		= cs5536_bmdma_stop,
+	.port_start		= cs5536_port_start,
 };
 
 /**
@@ -61,6 +61,10 @@ static bool initcalls_done;
 /* Save the async probe drivers' name from kernel cmdline */
 #define ASYNC_DRV_NAMES_MAX_LEN	256
 static char async_probe_drv_names[ASYNC_DRV_NAMES_MAX_LEN];
+/* "driver_async_probe=*" probes every driver asynchronously by default */
+static bool async_probe_default;
+
+static void probe_report_show(void *data, async_cookie_t cookie);
 
 /*
  * In some cases, like suspend to RAM or hibernation, It might be reasonable
@@ -330,6 +334,9 @@ static int deferred_probe_initcall(void)
 		schedule_delayed_work(&deferred_probe_timeout_work,
 			driver_deferred_probe_timeout * HZ);
 	}
+
+	if (initcall_debug)
+		async_schedule(probe_report_show, NULL);
 	return 0;
 }
 late_initcall(deferred_probe_initcall);
@@ -653,6 +660,64 @@ static int really_probe(struct device *dev, struct device_driver *drv)
 	return ret;
 }
 
+/*
+ * For initcall_debug, the slowest probes seen during boot, reported once
+ * the initcalls and the asynchronous probes they started are done.
+ */
+#define PROBE_REPORT_MAX	10
+
+struct probe_report_entry {
+	char dev_name[32];
+	char drv_name[32];
+	s64 usecs;
+};
+
+static DEFINE_SPINLOCK(probe_report_lock);
+static struct probe_report_entry probe_report[PROBE_REPORT_MAX];
+static bool probe_report_done;
+
+static void probe_report_add(struct device *dev, struct device_driver *drv,
+			     s64 usecs)
+{
+	struct probe_report_entry *e;
+	int i;
+
+	spin_lock(&probe_report_lock);
+	if (probe_report_done ||
+	    usecs <= probe_report[PROBE_REPORT_MAX - 1].usecs)
+		goto out;
+
+	/* Keep the table sorted, slowest first */
+	for (i = PROBE_REPORT_MAX - 1; i > 0; i--) {
+		if (probe_report[i - 1].usecs >= usecs)
+			break;
+		probe_report[i] = probe_report[i - 1];
+	}
+	e = &probe_report[i];
+	strscpy(e->dev_name, dev_name(dev), sizeof(e->dev_name));
+	strscpy(e->drv_name, drv->name, sizeof(e->drv_name));
+	e->usecs = usecs;
+out:
+	spin_unlock(&probe_report_lock);
+}
+
+static void probe_report_show(void *data, async_cookie_t cookie)
+{
+	int i;
+
+	/* Wait for the asynchronous probes scheduled so far */
+	async_synchronize_cookie(cookie);
+
+	spin_lock(&probe_report_lock);
+	probe_report_done = true;
+	spin_unlock(&probe_report_lock);
+
+	for (i = 0; i < PROBE_REPORT_MAX && probe_report[i].usecs; i++)
+		pr_info("slow probe: %s (%s) took %lld usecs\n",
+			probe_report[i].dev_name, probe_report[i].drv_name,
+			probe_report[i].usecs);
+}
+
 /*
  * For initcall_debug, show the driver probe time.
  */
@@ -667,6 +732,7 @@ static int really_probe_debug(struct device *dev, struct device_driver *drv)
 	delta = ktime_sub(rettime, calltime);
 	pr_debug("probe of %s returned %d after %lld usecs\n",
 		 dev_name(dev), ret, (s64) ktime_to_us(delta));
+	probe_report_add(dev, drv, ktime_to_us(delta));
 	return ret;
 }
 
@@ -757,6 +823,7 @@ static int __init save_async_options(char *buf)
 		pr_warn("Too long list of driver names for 'driver_async_probe'!\n");
 
 	strlcpy(async_probe_drv_names, buf, ASYNC_DRV_NAMES_MAX_LEN);
+	async_probe_default = parse_option_str(async_probe_drv_names, "*");
 	return 0;
 }
 __setup("driver_async_probe=", save_async_options);
@@ -771,7 +838,8 @@ bool driver_allows_async_probing(struct device_driver *drv)
 		return false;
 
 	default:
-		if (cmdline_requested_async_probing(drv->name))
+		if (async_probe_default ||
+		    cmdline_requested_async_probing(drv->name))
 			return true;
 
 		if (module_requested_async_probing(drv->owner))
@@ -18,10 +18,11 @@
 #include <linux/bio.h>
 #include <linux/highmem.h>
 #include <linux/mutex.h>
-#include <linux/radix-tree.h>
 #include <linux/fs.h>
+#include <linux/sizes.h>
 #include <linux/slab.h>
 #include <linux/backing-dev.h>
+#include <linux/xarray.h>
 
 #include <linux/uaccess.h>
 
@@ -29,11 +30,13 @@
 #define PAGE_SECTORS		(1 << PAGE_SECTORS_SHIFT)
 
 /*
- * Each block ramdisk device has a radix_tree brd_pages of pages that stores
- * the pages containing the block device's contents. A brd page's ->index is
- * its offset in PAGE_SIZE units. This is similar to, but in no way connected
- * with, the kernel's pagecache or buffer cache (which sit above our block
- * device).
+ * Each block ramdisk device has an xarray brd_pages of pages that stores
+ * the pages containing the block device's contents. The pages are
+ * allocated in chunks of 1 << brd_order pages, a chunk is stored at its
+ * offset in units of its size. When a huge chunk can't be allocated, the
+ * entry is instead an array of single pages, allocated as they are first
+ * written. This is similar to, but in no way connected with, the kernel's
+ * pagecache or buffer cache (which sit above our block device).
  */
 struct brd_device {
 	int		brd_number;
@@ -43,128 +46,160 @@ struct brd_device {
 	struct list_head	brd_list;
 
 	/*
-	 * Backing store of pages and lock to protect it. This is the contents
-	 * of the block device.
+	 * Backing store of pages. This is the contents of the block device.
 	 */
-	spinlock_t		brd_lock;
-	struct radix_tree_root	brd_pages;
+	struct xarray		brd_pages;
+	unsigned int		brd_order;	/* order of each chunk */
 };
 
+/* Tag of the entries which are an array of single pages */
+#define BRD_SPLIT_CHUNK		1
+
+static inline pgoff_t brd_chunk_idx(struct brd_device *brd, sector_t sector)
+{
+	return sector >> (PAGE_SECTORS_SHIFT + brd->brd_order);
+}
+
+/* Index within its chunk of the page which holds @sector */
+static inline pgoff_t brd_chunk_off(struct brd_device *brd, sector_t sector)
+{
+	return (sector >> PAGE_SECTORS_SHIFT) & ((1UL << brd->brd_order) - 1);
+}
+
+/* The page of the chunk in @entry which holds @sector, may be NULL */
+static inline struct page *brd_chunk_page(struct brd_device *brd,
+					  void *entry, sector_t sector)
+{
+	pgoff_t idx = brd_chunk_off(brd, sector);
+	struct page **pages;
+
+	if (xa_pointer_tag(entry) == BRD_SPLIT_CHUNK) {
+		pages = xa_untag_pointer(entry);
+		return READ_ONCE(pages[idx]);
+	}
+	return nth_page((struct page *)entry, idx);
+}
+
+static void brd_free_chunk(struct brd_device *brd, void *entry)
+{
+	struct page **pages;
+	unsigned long i;
+
+	if (xa_pointer_tag(entry) != BRD_SPLIT_CHUNK) {
+		__free_pages(entry, brd->brd_order);
+		return;
+	}
+
+	pages = xa_untag_pointer(entry);
+	for (i = 0; i < (1UL << brd->brd_order); i++)
+		if (pages[i])
+			__free_page(pages[i]);
+	kfree(pages);
+}
+
 /*
  * Look up and return a brd's page for a given sector.
  */
 static struct page *brd_lookup_page(struct brd_device *brd, sector_t sector)
 {
-	pgoff_t idx;
-	struct page *page;
+	void *entry;
 
 	/*
 	 * The page lifetime is protected by the fact that we have opened the
 	 * device node -- brd pages will never be deleted under us, so we
 	 * don't need any further locking or refcounting.
-	 *
-	 * This is strictly true for the radix-tree nodes as well (ie. we
-	 * don't actually need the rcu_read_lock()), however that is not a
-	 * documented feature of the radix-tree API so it is better to be
-	 * safe here (we don't have total exclusion from radix tree updates
-	 * here, only deletes).
 	 */
-	rcu_read_lock();
-	idx = sector >> PAGE_SECTORS_SHIFT; /* sector to page index */
-	page = radix_tree_lookup(&brd->brd_pages, idx);
-	rcu_read_unlock();
+	entry = xa_load(&brd->brd_pages, brd_chunk_idx(brd, sector));
 
-	BUG_ON(page && page->index != idx);
-
-	return page;
+	return entry ? brd_chunk_page(brd, entry, sector) : NULL;
 }
 
 /*
  * Look up and return a brd's page for a given sector.
- * If one does not exist, allocate an empty page, and insert that. Then
- * return it.
+ * If one does not exist, allocate an empty chunk, and insert that. Then
+ * return the page.
  */
 static struct page *brd_insert_page(struct brd_device *brd, sector_t sector)
 {
-	pgoff_t idx;
-	struct page *page;
+	struct page **pages;
+	struct page *page, *cur_page;
+	void *entry, *cur;
 	gfp_t gfp_flags;
 
-	page = brd_lookup_page(brd, sector);
-	if (page)
-		return page;
-
 	/*
 	 * Must use NOIO because we don't want to recurse back into the
 	 * block or filesystem layers from page reclaim.
 	 */
 	gfp_flags = GFP_NOIO | __GFP_ZERO | __GFP_HIGHMEM;
+
+	entry = xa_load(&brd->brd_pages, brd_chunk_idx(brd, sector));
+	if (!entry) {
+		if (brd->brd_order) {
+			entry = alloc_pages(gfp_flags | __GFP_COMP |
+					    __GFP_NOWARN | __GFP_NORETRY,
+					    brd->brd_order);
+			/* Fall back to single pages instead of failing */
+			if (!entry) {
+				pages = kcalloc(1UL << brd->brd_order,
+						sizeof(*pages), GFP_NOIO);
+				if (!pages)
+					return NULL;
+				entry = xa_tag_pointer(pages, BRD_SPLIT_CHUNK);
+			}
+		} else {
+			entry = alloc_page(gfp_flags);
+			if (!entry)
+				return NULL;
+		}
+
+		cur = xa_cmpxchg(&brd->brd_pages, brd_chunk_idx(brd, sector),
+				 NULL, entry, GFP_NOIO);
+		if (unlikely(cur)) {
+			brd_free_chunk(brd, entry);
+			if (xa_is_err(cur))
+				return NULL;
+			entry = cur;
+		}
+	}
+
+	page = brd_chunk_page(brd, entry, sector);
+	if (page)
+		return page;
+
+	/* A split chunk gets its pages one at a time */
 	page = alloc_page(gfp_flags);
 	if (!page)
 		return NULL;
 
-	if (radix_tree_preload(GFP_NOIO)) {
+	pages = xa_untag_pointer(entry);
+	cur_page = cmpxchg(&pages[brd_chunk_off(brd, sector)], NULL, page);
+	if (unlikely(cur_page)) {
 		__free_page(page);
-		return NULL;
+		page = cur_page;
 	}
 
-	spin_lock(&brd->brd_lock);
-	idx = sector >> PAGE_SECTORS_SHIFT;
-	page->index = idx;
-	if (radix_tree_insert(&brd->brd_pages, idx, page)) {
-		__free_page(page);
-		page = radix_tree_lookup(&brd->brd_pages, idx);
-		BUG_ON(!page);
-		BUG_ON(page->index != idx);
-	}
-	spin_unlock(&brd->brd_lock);
-
-	radix_tree_preload_end();
-
 	return page;
 }
 
 /*
- * Free all backing store pages and radix tree. This must only be called when
- * there are no other users of the device.
+ * Free all backing store pages and the xarray. This must only be called
+ * when there are no other users of the device.
  */
-#define FREE_BATCH 16
 static void brd_free_pages(struct brd_device *brd)
 {
-	unsigned long pos = 0;
-	struct page *pages[FREE_BATCH];
-	int nr_pages;
-
-	do {
-		int i;
-
-		nr_pages = radix_tree_gang_lookup(&brd->brd_pages,
-				(void **)pages, pos, FREE_BATCH);
-
-		for (i = 0; i < nr_pages; i++) {
-			void *ret;
-
-			BUG_ON(pages[i]->index < pos);
-			pos = pages[i]->index;
-			ret = radix_tree_delete(&brd->brd_pages, pos);
-			BUG_ON(!ret || ret != pages[i]);
-			__free_page(pages[i]);
-		}
-
-		pos++;
+	unsigned long idx;
+	void *entry;
 
+	xa_for_each(&brd->brd_pages, idx, entry) {
+		brd_free_chunk(brd, entry);
 		/*
 		 * It takes 3.4 seconds to remove 80GiB ramdisk.
 		 * So, we need cond_resched to avoid stalling the CPU.
 		 */
 		cond_resched();
+	}
 
-		/*
-		 * This assumes radix_tree_gang_lookup always returns as
-		 * many pages as possible. If the radix-tree code changes,
-		 * so will this have to.
-		 */
-	} while (nr_pages == FREE_BATCH);
+	xa_destroy(&brd->brd_pages);
 }
 
 /*
@@ -349,6 +384,10 @@ static int max_part = 1;
 module_param(max_part, int, 0444);
 MODULE_PARM_DESC(max_part, "Num Minors to reserve between devices");
 
+static bool rd_huge;
+module_param(rd_huge, bool, 0444);
+MODULE_PARM_DESC(rd_huge, "Allocate the backing store in 2MB chunks");
+
 MODULE_LICENSE("GPL");
 MODULE_ALIAS_BLOCKDEV_MAJOR(RAMDISK_MAJOR);
 MODULE_ALIAS("rd");
@@ -379,8 +418,10 @@ static struct brd_device *brd_alloc(int i)
 	if (!brd)
 		goto out;
 	brd->brd_number		= i;
-	spin_lock_init(&brd->brd_lock);
-	INIT_RADIX_TREE(&brd->brd_pages, GFP_ATOMIC);
+	xa_init(&brd->brd_pages);
+	if (rd_huge)
+		brd->brd_order = min_t(unsigned int, get_order(SZ_2M),
+				       MAX_ORDER - 1);
 
 	brd->brd_queue = blk_alloc_queue(NUMA_NO_NODE);
 	if (!brd->brd_queue)
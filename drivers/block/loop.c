@@ -78,6 +78,7 @@
 #include <linux/uio.h>
 #include <linux/ioprio.h>
 #include <linux/blk-cgroup.h>
+#include <linux/sched/mm.h>
 
 #include "loop.h"
 
@@ -517,8 +518,6 @@ static void lo_rw_aio_complete(struct kiocb *iocb, long ret, long ret2)
 {
 	struct loop_cmd *cmd = container_of(iocb, struct loop_cmd, iocb);
 
-	if (cmd->css)
-		css_put(cmd->css);
 	cmd->ret = ret;
 	lo_rw_aio_do_completion(cmd);
 }
@@ -579,8 +578,6 @@ static int lo_rw_aio(struct loop_device *lo, struct loop_cmd *cmd,
 	cmd->iocb.ki_complete = lo_rw_aio_complete;
 	cmd->iocb.ki_flags = IOCB_DIRECT;
 	cmd->iocb.ki_ioprio = IOPRIO_PRIO_VALUE(IOPRIO_CLASS_NONE, 0);
-	if (cmd->css)
-		kthread_associate_blkcg(cmd->css);
 
 	if (rw == WRITE)
 		ret = call_write_iter(file, &cmd->iocb, &iter);
@@ -588,13 +585,57 @@ static int lo_rw_aio(struct loop_device *lo, struct loop_cmd *cmd,
 		ret = call_read_iter(file, &cmd->iocb, &iter);
 
 	lo_rw_aio_do_completion(cmd);
-	kthread_associate_blkcg(NULL);
 
 	if (ret != -EIOCBQUEUED)
 		cmd->iocb.ki_complete(&cmd->iocb, ret, 0);
 	return 0;
 }
 
+/*
+ * Try to serve a buffered read from the page cache in the submitter's
+ * context.  Returns false if the data is not all cached, or the request
+ * cannot be tried this way, and it has to go to the worker.
+ */
+static bool lo_read_nowait(struct loop_device *lo, struct request *rq)
+{
+	struct file *file = lo->lo_backing_file;
+	struct bio *bio = rq->bio;
+	struct req_iterator rq_iter;
+	struct bio_vec bvec;
+	struct iov_iter iter;
+	struct kiocb kiocb;
+	unsigned int noio_flag;
+	int nr_bvec = 0;
+	ssize_t ret;
+
+	/* Multi bio requests would need a bvec array allocated */
+	if (!(file->f_mode & FMODE_NOWAIT) || bio != rq->biotail)
+		return false;
+
+	rq_for_each_bvec(bvec, rq, rq_iter)
+		nr_bvec++;
+
+	iov_iter_bvec(&iter, READ, __bvec_iter_bvec(bio->bi_io_vec, bio->bi_iter),
+		      nr_bvec, blk_rq_bytes(rq));
+	iter.iov_offset = bio->bi_iter.bi_bvec_done;
+
+	init_sync_kiocb(&kiocb, file);
+	kiocb.ki_pos = ((loff_t) blk_rq_pos(rq) << 9) + lo->lo_offset;
+	kiocb.ki_flags |= IOCB_NOWAIT;
+
+	noio_flag = memalloc_noio_save();
+	ret = call_read_iter(file, &kiocb, &iter);
+	memalloc_noio_restore(noio_flag);
+
+	/* A short read is redone by the worker, which handles EOF */
+	if (ret != blk_rq_bytes(rq))
+		return false;
+
+	rq_for_each_segment(bvec, rq, rq_iter)
+		flush_dcache_page(bvec.bv_page);
+	return true;
+}
+
 static int do_req_filebacked(struct loop_device *lo, struct request *rq)
 {
 	struct loop_cmd *cmd = blk_mq_rq_to_pdu(rq);
@@ -922,26 +963,205 @@ static void loop_config_discard(struct loop_device *lo)
 		blk_queue_flag_clear(QUEUE_FLAG_DISCARD, q);
 }
 
-static void loop_unprepare_queue(struct loop_device *lo)
+/*
+ * Each blkcg issuing I/O to the device gets its own worker, so that
+ * cgroups do not wait behind each other and the backing file sees their
+ * requests in parallel.  Workers idle for LOOP_IDLE_WORKER_TIMEOUT are
+ * freed.
+ */
+struct loop_worker {
+	struct rb_node rb_node;
+	struct work_struct work;
+	struct list_head cmd_list;
+	struct list_head idle_list;
+	struct loop_device *lo;
+	struct cgroup_subsys_state *css;
+	unsigned long last_ran_at;
+};
+
+#define LOOP_IDLE_WORKER_TIMEOUT (60 * HZ)
+
+static void loop_free_worker(struct loop_device *lo, struct loop_worker *worker)
+{
+	rb_erase(&worker->rb_node, &lo->worker_tree);
+	css_put(worker->css);
+	kfree(worker);
+}
+
+static void loop_set_timer(struct loop_device *lo)
+{
+	timer_reduce(&lo->timer, jiffies + LOOP_IDLE_WORKER_TIMEOUT);
+}
+
+static void loop_free_idle_workers(struct timer_list *timer)
 {
-	kthread_flush_worker(&lo->worker);
-	kthread_stop(lo->worker_task);
+	struct loop_device *lo = container_of(timer, struct loop_device, timer);
+	struct loop_worker *pos, *worker;
+
+	spin_lock_irq(&lo->lo_work_lock);
+	list_for_each_entry_safe(worker, pos, &lo->idle_worker_list,
+				 idle_list) {
+		if (time_is_after_jiffies(worker->last_ran_at +
+					  LOOP_IDLE_WORKER_TIMEOUT))
+			break;
+		list_del(&worker->idle_list);
+		loop_free_worker(lo, worker);
+	}
+	if (!list_empty(&lo->idle_worker_list))
+		loop_set_timer(lo);
+	spin_unlock_irq(&lo->lo_work_lock);
 }
 
-static int loop_kthread_worker_fn(void *worker_ptr)
+static void loop_handle_cmd(struct loop_cmd *cmd);
+
+static void loop_process_work(struct loop_worker *worker,
+			      struct list_head *cmd_list,
+			      struct loop_device *lo)
 {
+	unsigned int orig_flags = current->flags;
+	struct loop_cmd *cmd;
+
 	current->flags |= PF_LOCAL_THROTTLE | PF_MEMALLOC_NOIO;
-	return kthread_worker_fn(worker_ptr);
+	spin_lock_irq(&lo->lo_work_lock);
+	while (!list_empty(cmd_list)) {
+		cmd = list_first_entry(cmd_list, struct loop_cmd, list_entry);
+		list_del(&cmd->list_entry);
+		spin_unlock_irq(&lo->lo_work_lock);
+
+		loop_handle_cmd(cmd);
+		cond_resched();
+
+		spin_lock_irq(&lo->lo_work_lock);
+	}
+
+	/*
+	 * Only a worker with nothing queued which will not run again goes
+	 * on the idle list, so anything on it is safe to free.
+	 */
+	if (worker && !work_pending(&worker->work)) {
+		worker->last_ran_at = jiffies;
+		list_add_tail(&worker->idle_list, &lo->idle_worker_list);
+		loop_set_timer(lo);
+	}
+	spin_unlock_irq(&lo->lo_work_lock);
+	current->flags = orig_flags;
+}
+
+static void loop_workfn(struct work_struct *work)
+{
+	struct loop_worker *worker =
+		container_of(work, struct loop_worker, work);
+
+	loop_process_work(worker, &worker->cmd_list, worker->lo);
+}
+
+static void loop_rootcg_workfn(struct work_struct *work)
+{
+	struct loop_device *lo =
+		container_of(work, struct loop_device, rootcg_work);
+
+	loop_process_work(NULL, &lo->rootcg_cmd_list, lo);
+}
+
+#ifdef CONFIG_BLK_CGROUP
+static inline bool queue_on_root_worker(struct cgroup_subsys_state *css)
+{
+	return !css || css == blkcg_root_css;
+}
+#else
+static inline bool queue_on_root_worker(struct cgroup_subsys_state *css)
+{
+	return !css;
+}
+#endif
+
+static void loop_queue_work(struct loop_device *lo, struct loop_cmd *cmd)
+{
+	struct rb_node **node = &lo->worker_tree.rb_node, *parent = NULL;
+	struct loop_worker *cur_worker, *worker = NULL;
+	struct work_struct *work;
+	struct list_head *cmd_list;
+
+	spin_lock_irq(&lo->lo_work_lock);
+
+	if (queue_on_root_worker(cmd->css))
+		goto queue_work;
+
+	while (*node) {
+		parent = *node;
+		cur_worker = rb_entry(parent, struct loop_worker, rb_node);
+		if (cur_worker->css == cmd->css) {
+			worker = cur_worker;
+			goto queue_work;
+		}
+		if ((unsigned long)cur_worker->css < (unsigned long)cmd->css)
+			node = &parent->rb_left;
+		else
+			node = &parent->rb_right;
+	}
+
+	/* Without a worker of its own, the request is issued as the root */
+	worker = kzalloc(sizeof(*worker), GFP_NOWAIT | __GFP_NOWARN);
+	if (!worker) {
+		cmd->css = NULL;
+		goto queue_work;
+	}
+
+	worker->css = cmd->css;
+	css_get(worker->css);
+	INIT_WORK(&worker->work, loop_workfn);
+	INIT_LIST_HEAD(&worker->cmd_list);
+	INIT_LIST_HEAD(&worker->idle_list);
+	worker->lo = lo;
+	rb_link_node(&worker->rb_node, parent, node);
+	rb_insert_color(&worker->rb_node, &lo->worker_tree);
+queue_work:
+	if (worker) {
+		/* Keep the idle timer from freeing the worker */
+		list_del_init(&worker->idle_list);
+		work = &worker->work;
+		cmd_list = &worker->cmd_list;
+	} else {
+		work = &lo->rootcg_work;
+		cmd_list = &lo->rootcg_cmd_list;
+	}
+	list_add_tail(&cmd->list_entry, cmd_list);
+	queue_work(lo->workqueue, work);
+	spin_unlock_irq(&lo->lo_work_lock);
+}
+
+static void loop_unprepare_queue(struct loop_device *lo)
+{
+	struct loop_worker *worker, *pos;
+
+	destroy_workqueue(lo->workqueue);
+	del_timer_sync(&lo->timer);
+
+	spin_lock_irq(&lo->lo_work_lock);
+	rbtree_postorder_for_each_entry_safe(worker, pos, &lo->worker_tree,
+					     rb_node) {
+		css_put(worker->css);
+		kfree(worker);
+	}
+	lo->worker_tree = RB_ROOT;
+	INIT_LIST_HEAD(&lo->idle_worker_list);
+	spin_unlock_irq(&lo->lo_work_lock);
 }
 
 static int loop_prepare_queue(struct loop_device *lo)
 {
-	kthread_init_worker(&lo->worker);
-	lo->worker_task = kthread_run(loop_kthread_worker_fn,
-			&lo->worker, "loop%d", lo->lo_number);
-	if (IS_ERR(lo->worker_task))
+	lo->workqueue = alloc_workqueue("loop%d",
+					WQ_UNBOUND | WQ_FREEZABLE |
+					WQ_MEM_RECLAIM | WQ_HIGHPRI,
+					0, lo->lo_number);
+	if (!lo->workqueue)
 		return -ENOMEM;
-	set_user_nice(lo->worker_task, MIN_NICE);
+
+	INIT_WORK(&lo->rootcg_work, loop_rootcg_workfn);
+	INIT_LIST_HEAD(&lo->rootcg_cmd_list);
+	INIT_LIST_HEAD(&lo->idle_worker_list);
+	lo->worker_tree = RB_ROOT;
+	timer_setup(&lo->timer, loop_free_idle_workers, TIMER_DEFERRABLE);
 	return 0;
 }
 
@@ -2015,15 +2235,29 @@ static blk_status_t loop_queue_rq(struct blk_mq_hw_ctx *hctx,
 		break;
 	}
 
-	/* always use the first bio's css */
+	/*
+	 * Buffered reads of cached data complete right here, the queue is
+	 * BLK_MQ_F_BLOCKING so this may sleep.
+	 */
+	if (req_op(rq) == REQ_OP_READ && !lo->transfer && !cmd->use_aio &&
+	    lo_read_nowait(lo, rq)) {
+		cmd->ret = 0;
+		if (likely(!blk_should_fake_timeout(rq->q)))
+			blk_mq_complete_request(rq);
+		return BLK_STS_OK;
+	}
+
+	/*
+	 * always use the first bio's css, the bio holds a reference to it
+	 * until the request completes
+	 */
 #ifdef CONFIG_BLK_CGROUP
-	if (cmd->use_aio && rq->bio && rq->bio->bi_blkg) {
+	if (rq->bio && rq->bio->bi_blkg)
 		cmd->css = &bio_blkcg(rq->bio)->css;
-		css_get(cmd->css);
-	} else
+	else
 #endif
 		cmd->css = NULL;
-	kthread_queue_work(&lo->worker, &cmd->work);
+	loop_queue_work(lo, cmd);
 
 	return BLK_STS_OK;
 }
@@ -2040,7 +2274,11 @@ static void loop_handle_cmd(struct loop_cmd *cmd)
 		goto failed;
 	}
 
+	if (cmd->css)
+		kthread_associate_blkcg(cmd->css);
 	ret = do_req_filebacked(lo, rq);
+	if (cmd->css)
+		kthread_associate_blkcg(NULL);
  failed:
 	/* complete non-aio request */
 	if (!cmd->use_aio || ret) {
@@ -2053,26 +2291,8 @@ static void loop_handle_cmd(struct loop_cmd *cmd)
 	}
 }
 
-static void loop_queue_work(struct kthread_work *work)
-{
-	struct loop_cmd *cmd =
-		container_of(work, struct loop_cmd, work);
-
-	loop_handle_cmd(cmd);
-}
-
-static int loop_init_request(struct blk_mq_tag_set *set, struct request *rq,
-		unsigned int hctx_idx, unsigned int numa_node)
-{
-	struct loop_cmd *cmd = blk_mq_rq_to_pdu(rq);
-
-	kthread_init_work(&cmd->work, loop_queue_work);
-	return 0;
-}
-
 static const struct blk_mq_ops loop_mq_ops = {
 	.queue_rq       = loop_queue_rq,
-	.init_request	= loop_init_request,
 	.complete	= lo_complete_rq,
 };
 
@@ -2107,7 +2327,8 @@ static int loop_add(struct loop_device **l, int i)
 	lo->tag_set.queue_depth = 128;
 	lo->tag_set.numa_node = NUMA_NO_NODE;
 	lo->tag_set.cmd_size = sizeof(struct loop_cmd);
-	lo->tag_set.flags = BLK_MQ_F_SHOULD_MERGE | BLK_MQ_F_STACKING;
+	lo->tag_set.flags = BLK_MQ_F_SHOULD_MERGE | BLK_MQ_F_STACKING |
+			    BLK_MQ_F_BLOCKING;
 	lo->tag_set.driver_data = lo;
 
 	err = blk_mq_alloc_tag_set(&lo->tag_set);
@@ -2160,6 +2381,7 @@ static int loop_add(struct loop_device **l, int i)
 	atomic_set(&lo->lo_refcnt, 0);
 	lo->lo_number		= i;
 	spin_lock_init(&lo->lo_lock);
+	spin_lock_init(&lo->lo_work_lock);
 	disk->major		= LOOP_MAJOR;
 	disk->first_minor	= i << part_shift;
 	disk->fops		= &lo_fops;
@@ -15,6 +15,9 @@
 #include <linux/spinlock.h>
 #include <linux/mutex.h>
 #include <linux/kthread.h>
+#include <linux/rbtree.h>
+#include <linux/timer.h>
+#include <linux/workqueue.h>
 #include <uapi/linux/loop.h>
 
 /* Possible states of device */
@@ -54,8 +57,14 @@ struct loop_device {
 
 	spinlock_t		lo_lock;
 	int			lo_state;
-	struct kthread_worker	worker;
-	struct task_struct	*worker_task;
+	/* Requests are handled by one worker per blkcg */
+	struct workqueue_struct	*workqueue;
+	struct work_struct	rootcg_work;
+	struct list_head	rootcg_cmd_list;
+	struct list_head	idle_worker_list;
+	struct rb_root		worker_tree;
+	struct timer_list	timer;
+	spinlock_t		lo_work_lock;	/* protects the above */
 	bool			use_dio;
 	bool			sysfs_inited;
 
@@ -65,7 +74,7 @@ struct loop_device {
 };
 
 struct loop_cmd {
-	struct kthread_work work;
+	struct list_head list_entry;
 	bool use_aio; /* use AIO interface to handle I/O */
 	atomic_t ref; /* only for aio */
 	long ret;
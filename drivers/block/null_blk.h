@@ -28,6 +28,7 @@ struct nullb_queue {
 	unsigned int queue_depth;
 	struct nullb_device *dev;
 	unsigned int requeue_selection;
+	atomic_t timer_inflight; /* commands waiting for their timer */
 
 	struct nullb_cmd *cmds;
 };
@@ -50,6 +51,13 @@ struct nullb_device {
 	unsigned long cache_size; /* disk cache size in MB */
 	unsigned long zone_size; /* zone size in MB if device is zoned */
 	unsigned long zone_capacity; /* zone capacity in MB if device is zoned */
+	unsigned long read_nsec; /* completion time of reads, 0 for completion_nsec */
+	unsigned long write_nsec; /* completion time of writes, 0 for completion_nsec */
+	unsigned long latency_spread_nsec; /* stddev or tail scale of the model */
+	unsigned long latency_slow_nsec; /* slow mode completion time (bimodal) */
+	unsigned long queue_depth_nsec; /* extra time per command in flight */
+	unsigned int latency_model; /* timer completion latency distribution */
+	unsigned int latency_slow_permille; /* share of slow completions */
 	unsigned int zone_nr_conv; /* number of conventional zones */
 	unsigned int submit_queues; /* number of submission queues */
 	unsigned int home_node; /* home node for the device */
@@ -9,6 +9,7 @@
 #include <linux/sched.h>
 #include <linux/fs.h>
 #include <linux/init.h>
+#include <linux/random.h>
 #include "null_blk.h"
 
 #define PAGE_SECTORS_SHIFT	(PAGE_SHIFT - SECTOR_SHIFT)
@@ -76,6 +77,11 @@ enum {
 	NULL_IRQ_NONE		= 0,
 	NULL_IRQ_SOFTIRQ	= 1,
 	NULL_IRQ_TIMER		= 2,
+
+	NULL_LAT_FIXED		= 0,
+	NULL_LAT_NORMAL		= 1,
+	NULL_LAT_BIMODAL	= 2,
+	NULL_LAT_HEAVY_TAIL	= 3,
 };
 
 enum {
@@ -347,6 +353,13 @@ NULLB_DEVICE_ATTR(zoned, bool, NULL);
 NULLB_DEVICE_ATTR(zone_size, ulong, NULL);
 NULLB_DEVICE_ATTR(zone_capacity, ulong, NULL);
 NULLB_DEVICE_ATTR(zone_nr_conv, uint, NULL);
+NULLB_DEVICE_ATTR(read_nsec, ulong, NULL);
+NULLB_DEVICE_ATTR(write_nsec, ulong, NULL);
+NULLB_DEVICE_ATTR(latency_model, uint, NULL);
+NULLB_DEVICE_ATTR(latency_spread_nsec, ulong, NULL);
+NULLB_DEVICE_ATTR(latency_slow_nsec, ulong, NULL);
+NULLB_DEVICE_ATTR(latency_slow_permille, uint, NULL);
+NULLB_DEVICE_ATTR(queue_depth_nsec, ulong, NULL);
 
 static ssize_t nullb_device_power_show(struct config_item *item, char *page)
 {
@@ -464,6 +477,13 @@ static struct configfs_attribute *nullb_device_attrs[] = {
 	&nullb_device_attr_zone_size,
 	&nullb_device_attr_zone_capacity,
 	&nullb_device_attr_zone_nr_conv,
+	&nullb_device_attr_read_nsec,
+	&nullb_device_attr_write_nsec,
+	&nullb_device_attr_latency_model,
+	&nullb_device_attr_latency_spread_nsec,
+	&nullb_device_attr_latency_slow_nsec,
+	&nullb_device_attr_latency_slow_permille,
+	&nullb_device_attr_queue_depth_nsec,
 	NULL,
 };
 
@@ -517,7 +537,7 @@ nullb_group_drop_item(struct config_group *group, struct config_item *item)
 static ssize_t memb_group_features_show(struct config_item *item, char *page)
 {
 	return snprintf(page, PAGE_SIZE,
-			"memory_backed,discard,bandwidth,cache,badblocks,zoned,zone_size,zone_capacity,zone_nr_conv\n");
+			"memory_backed,discard,bandwidth,cache,badblocks,zoned,zone_size,zone_capacity,zone_nr_conv,latency_model\n");
 }
 
 CONFIGFS_ATTR_RO(memb_group_, features);
@@ -684,14 +704,73 @@ static void end_cmd(struct nullb_cmd *cmd)
 
 static enum hrtimer_restart null_cmd_timer_expired(struct hrtimer *timer)
 {
-	end_cmd(container_of(timer, struct nullb_cmd, timer));
+	struct nullb_cmd *cmd = container_of(timer, struct nullb_cmd, timer);
+
+	atomic_dec(&cmd->nq->timer_inflight);
+	end_cmd(cmd);
 
 	return HRTIMER_NORESTART;
 }
 
+/* Uniformly distributed in [0, 65536) */
+static inline u64 null_rand16(void)
+{
+	return prandom_u32() >> 16;
+}
+
+/*
+ * Completion time of @cmd in irqmode=timer:
+ *
+ * fixed:	completion_nsec (or read_nsec/write_nsec)
+ * normal:	normally distributed around it, with latency_spread_nsec as
+ *		standard deviation (sum of 12 uniforms, cut off at zero)
+ * bimodal:	latency_slow_permille of the commands take latency_slow_nsec
+ * heavy tail:	one in 2^k commands, k up to 10, takes an extra
+ *		(2^k - 1) * latency_spread_nsec or more, a power law tail
+ *
+ * plus queue_depth_nsec for every other command already waiting on the
+ * queue, to model a device serving a deeper queue more slowly.
+ */
+static u64 null_cmd_latency(struct nullb_cmd *cmd, unsigned int inflight)
+{
+	struct nullb_device *dev = cmd->nq->dev;
+	bool write = op_is_write(dev->queue_mode == NULL_Q_MQ ?
+				 req_op(cmd->rq) : bio_op(cmd->bio));
+	u64 spread = dev->latency_spread_nsec;
+	u64 nsec = dev->completion_nsec;
+	s64 sum;
+	int i;
+
+	if (write && dev->write_nsec)
+		nsec = dev->write_nsec;
+	else if (!write && dev->read_nsec)
+		nsec = dev->read_nsec;
+
+	switch (dev->latency_model) {
+	case NULL_LAT_NORMAL:
+		for (sum = 0, i = 0; i < 12; i++)
+			sum += null_rand16();
+		sum = (s64)nsec + div_s64((sum - 6 * 65536) * (s64)spread,
+					  65536);
+		nsec = max_t(s64, sum, 0);
+		break;
+	case NULL_LAT_BIMODAL:
+		if (prandom_u32_max(1000) < dev->latency_slow_permille)
+			nsec = dev->latency_slow_nsec;
+		break;
+	case NULL_LAT_HEAVY_TAIL:
+		i = __ffs(prandom_u32() | BIT(10));
+		nsec += spread * ((1U << i) - 1);
+		break;
+	}
+
+	return nsec + (u64)inflight * dev->queue_depth_nsec;
+}
+
 static void null_cmd_end_timer(struct nullb_cmd *cmd)
 {
-	ktime_t kt = cmd->nq->dev->completion_nsec;
+	unsigned int inflight = atomic_inc_return(&cmd->nq->timer_inflight) - 1;
+	ktime_t kt = null_cmd_latency(cmd, inflight);
 
 	hrtimer_start(&cmd->timer, kt, HRTIMER_MODE_REL);
 }
@@ -1715,6 +1794,10 @@ static int null_validate_conf(struct nullb_device *dev)
 
 	dev->queue_mode = min_t(unsigned int, dev->queue_mode, NULL_Q_MQ);
 	dev->irqmode = min_t(unsigned int, dev->irqmode, NULL_IRQ_TIMER);
+	dev->latency_model = min_t(unsigned int, dev->latency_model,
+				   NULL_LAT_HEAVY_TAIL);
+	dev->latency_slow_permille = min_t(unsigned int,
+					   dev->latency_slow_permille, 1000);
 
 	/* Do memory allocation, so set blocking */
 	if (dev->memory_backed)
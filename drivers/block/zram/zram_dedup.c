@@ -0,0 +1,195 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Deduplication of compressed zram objects.
+ *
+ * Written pages are hashed with xxh32 before compression.  Objects are
+ * kept in per bucket rb-trees sorted by that checksum, and a new page
+ * whose compressed form matches an existing object byte for byte takes
+ * a reference to it instead of allocating a new one.  This relies on the
+ * compressor producing the same output for the same input, which holds
+ * for the crypto compressors zram uses.
+ */
+
+#define KMSG_COMPONENT "zram"
+#define pr_fmt(fmt) KMSG_COMPONENT ": " fmt
+
+#include <linux/rbtree.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/xxhash.h>
+
+#include "zram_drv.h"
+
+/* One hash bucket per this many pages of disk size */
+#define ZRAM_HASH_SHIFT		10
+#define ZRAM_HASH_SIZE_MIN	(1 << 10)
+#define ZRAM_HASH_SIZE_MAX	(1 << 20)
+
+u32 zram_dedup_checksum(const void *mem)
+{
+	return xxh32(mem, PAGE_SIZE, 0);
+}
+
+static struct zram_hash *zram_dedup_bucket(struct zram *zram, u32 checksum)
+{
+	return &zram->hash[checksum % zram->hash_size];
+}
+
+static bool zram_dedup_match(struct zram *zram, struct zram_entry *entry,
+			     const void *src, unsigned int len)
+{
+	bool match;
+	void *mem;
+
+	if (entry->len != len)
+		return false;
+
+	mem = zs_map_object(zram->mem_pool, entry->handle, ZS_MM_RO);
+	match = !memcmp(mem, src, len);
+	zs_unmap_object(zram->mem_pool, entry->handle);
+
+	return match;
+}
+
+/**
+ * zram_dedup_find - look up an object identical to a compressed page
+ * @zram:	zram device
+ * @checksum:	zram_dedup_checksum() of the uncompressed page
+ * @src:	compressed page, or the page itself for huge objects
+ * @len:	length of @src
+ *
+ * Return: the matching entry with a reference taken, or NULL.
+ */
+struct zram_entry *zram_dedup_find(struct zram *zram, u32 checksum,
+				   const void *src, unsigned int len)
+{
+	struct zram_hash *hash = zram_dedup_bucket(zram, checksum);
+	struct zram_entry *entry, *found = NULL;
+	struct rb_node *node;
+
+	spin_lock(&hash->lock);
+	/* Find the leftmost entry with this checksum */
+	node = hash->rb_root.rb_node;
+	while (node) {
+		entry = rb_entry(node, struct zram_entry, rb_node);
+		if (checksum == entry->checksum)
+			found = entry;
+		node = checksum <= entry->checksum ? node->rb_left :
+						      node->rb_right;
+	}
+
+	for (entry = found; entry && entry->checksum == checksum;
+	     entry = rb_entry_safe(rb_next(&entry->rb_node),
+				   struct zram_entry, rb_node)) {
+		if (zram_dedup_match(zram, entry, src, len)) {
+			entry->refcount++;
+			spin_unlock(&hash->lock);
+			atomic64_add(len, &zram->stats.dup_data_size);
+			return entry;
+		}
+	}
+	spin_unlock(&hash->lock);
+
+	return NULL;
+}
+
+/**
+ * zram_dedup_insert - make a newly stored object available for sharing
+ * @zram:	zram device
+ * @checksum:	zram_dedup_checksum() of the uncompressed page
+ * @handle:	zsmalloc handle of the object
+ * @len:	length of the object
+ *
+ * Return: the new entry holding one reference, or NULL if it could not be
+ * allocated, in which case the caller keeps @handle to itself.
+ */
+struct zram_entry *zram_dedup_insert(struct zram *zram, u32 checksum,
+				     unsigned long handle, unsigned int len)
+{
+	struct zram_hash *hash = zram_dedup_bucket(zram, checksum);
+	struct rb_node **link, *parent = NULL;
+	struct zram_entry *entry;
+
+	entry = kmalloc(sizeof(*entry), GFP_NOIO | __GFP_NOWARN);
+	if (!entry)
+		return NULL;
+
+	entry->handle = handle;
+	entry->len = len;
+	entry->checksum = checksum;
+	entry->refcount = 1;
+
+	spin_lock(&hash->lock);
+	link = &hash->rb_root.rb_node;
+	while (*link) {
+		struct zram_entry *e;
+
+		parent = *link;
+		e = rb_entry(parent, struct zram_entry, rb_node);
+		link = checksum < e->checksum ? &parent->rb_left :
+						&parent->rb_right;
+	}
+	rb_link_node(&entry->rb_node, parent, link);
+	rb_insert_color(&entry->rb_node, &hash->rb_root);
+	spin_unlock(&hash->lock);
+
+	atomic64_add(sizeof(*entry), &zram->stats.meta_data_size);
+	return entry;
+}
+
+/* Drop a reference, freeing the object with the last one */
+void zram_dedup_put(struct zram *zram, struct zram_entry *entry)
+{
+	struct zram_hash *hash = zram_dedup_bucket(zram, entry->checksum);
+	unsigned long refcount;
+	u32 len;
+
+	spin_lock(&hash->lock);
+	/* once unlocked a shared entry may be freed by the last put */
+	len = entry->len;
+	refcount = --entry->refcount;
+	if (!refcount)
+		rb_erase(&entry->rb_node, &hash->rb_root);
+	spin_unlock(&hash->lock);
+
+	if (refcount) {
+		atomic64_sub(len, &zram->stats.dup_data_size);
+		return;
+	}
+
+	zs_free(zram->mem_pool, entry->handle);
+	atomic64_sub(len, &zram->stats.compr_data_size);
+	atomic64_sub(sizeof(*entry), &zram->stats.meta_data_size);
+	kfree(entry);
+}
+
+int zram_dedup_init(struct zram *zram, size_t num_pages)
+{
+	size_t i;
+
+	if (!zram->use_dedup)
+		return 0;
+
+	zram->hash_size = clamp_t(size_t, num_pages >> ZRAM_HASH_SHIFT,
+				  ZRAM_HASH_SIZE_MIN, ZRAM_HASH_SIZE_MAX);
+	zram->hash = vzalloc(array_size(zram->hash_size, sizeof(*zram->hash)));
+	if (!zram->hash) {
+		pr_err("Error allocating zram entry hash\n");
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < zram->hash_size; i++) {
+		spin_lock_init(&zram->hash[i].lock);
+		zram->hash[i].rb_root = RB_ROOT;
+	}
+
+	return 0;
+}
+
+/* Called once all slots are freed */
+void zram_dedup_fini(struct zram *zram)
+{
+	vfree(zram->hash);
+	zram->hash = NULL;
+	zram->hash_size = 0;
+}
@@ -0,0 +1,25 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _ZRAM_DEDUP_H_
+#define _ZRAM_DEDUP_H_
+
+struct zram;
+struct zram_entry;
+
+#ifdef CONFIG_ZRAM_DEDUP
+u32 zram_dedup_checksum(const void *mem);
+struct zram_entry *zram_dedup_find(struct zram *zram, u32 checksum,
+				   const void *src, unsigned int len);
+struct zram_entry *zram_dedup_insert(struct zram *zram, u32 checksum,
+				     unsigned long handle, unsigned int len);
+void zram_dedup_put(struct zram *zram, struct zram_entry *entry);
+int zram_dedup_init(struct zram *zram, size_t num_pages);
+void zram_dedup_fini(struct zram *zram);
+#else
+static inline int zram_dedup_init(struct zram *zram, size_t num_pages)
+{
+	return 0;
+}
+static inline void zram_dedup_fini(struct zram *zram) { }
+#endif
+
+#endif /* _ZRAM_DEDUP_H_ */
@@ -327,6 +327,7 @@
 #include <linux/spinlock.h>
 #include <linux/kthread.h>
 #include <linux/percpu.h>
+#include <linux/local_lock.h>
 #include <linux/fips.h>
 #include <linux/ptrace.h>
 #include <linux/workqueue.h>
@@ -2172,10 +2173,36 @@ struct batched_entropy {
 		u64 entropy_u64[CHACHA_BLOCK_SIZE / sizeof(u64)];
 		u32 entropy_u32[CHACHA_BLOCK_SIZE / sizeof(u32)];
 	};
+	local_lock_t lock;
+	unsigned int generation;
 	unsigned int position;
-	spinlock_t batch_lock;
 };
 
+/*
+ * Bumped to make every CPU throw away its batch on the next use, see
+ * invalidate_batched_entropy().  The batches themselves are only ever
+ * touched by their own CPU, under the local lock.  It starts at 1, so
+ * that the never filled batches, which are at generation 0, are stale.
+ */
+static atomic_t batched_entropy_generation = ATOMIC_INIT(1);
+
+/*
+ * Returns true if @batch has to be refilled before taking a word from it,
+ * @nr being the number of words it holds.
+ */
+static bool batched_entropy_stale(struct batched_entropy *batch,
+				  unsigned int nr)
+{
+	unsigned int generation = atomic_read(&batched_entropy_generation);
+
+	if (batch->position < nr && batch->generation == generation)
+		return false;
+
+	batch->position = 0;
+	batch->generation = generation;
+	return true;
+}
+
 /*
  * Get a random word for internal kernel use only. The quality of the random
  * number is good as /dev/urandom, but there is no backtrack protection, with
@@ -2185,7 +2212,7 @@ struct batched_entropy {
  * point prior.
  */
 static DEFINE_PER_CPU(struct batched_entropy, batched_entropy_u64) = {
-	.batch_lock	= __SPIN_LOCK_UNLOCKED(batched_entropy_u64.lock),
+	.lock	= INIT_LOCAL_LOCK(batched_entropy_u64.lock),
 };
 
 u64 get_random_u64(void)
@@ -2197,20 +2224,20 @@ u64 get_random_u64(void)
 
 	warn_unseeded_randomness(&previous);
 
-	batch = raw_cpu_ptr(&batched_entropy_u64);
-	spin_lock_irqsave(&batch->batch_lock, flags);
-	if (batch->position % ARRAY_SIZE(batch->entropy_u64) == 0) {
+	local_lock_irqsave(&batched_entropy_u64.lock, flags);
+	batch = this_cpu_ptr(&batched_entropy_u64);
+	if (batched_entropy_stale(batch, ARRAY_SIZE(batch->entropy_u64)))
 		extract_crng((u8 *)batch->entropy_u64);
-		batch->position = 0;
-	}
-	ret = batch->entropy_u64[batch->position++];
-	spin_unlock_irqrestore(&batch->batch_lock, flags);
+	ret = batch->entropy_u64[batch->position];
+	/* Do not leave handed out words behind for a later memory leak */
+	batch->entropy_u64[batch->position++] = 0;
+	local_unlock_irqrestore(&batched_entropy_u64.lock, flags);
 	return ret;
 }
 EXPORT_SYMBOL(get_random_u64);
 
 static DEFINE_PER_CPU(struct batched_entropy, batched_entropy_u32) = {
-	.batch_lock	= __SPIN_LOCK_UNLOCKED(batched_entropy_u32.lock),
+	.lock	= INIT_LOCAL_LOCK(batched_entropy_u32.lock),
 };
 u32 get_random_u32(void)
 {
@@ -2221,40 +2248,24 @@ u32 get_random_u32(void)
 
 	warn_unseeded_randomness(&previous);
 
-	batch = raw_cpu_ptr(&batched_entropy_u32);
-	spin_lock_irqsave(&batch->batch_lock, flags);
-	if (batch->position % ARRAY_SIZE(batch->entropy_u32) == 0) {
+	local_lock_irqsave(&batched_entropy_u32.lock, flags);
+	batch = this_cpu_ptr(&batched_entropy_u32);
+	if (batched_entropy_stale(batch, ARRAY_SIZE(batch->entropy_u32)))
 		extract_crng((u8 *)batch->entropy_u32);
-		batch->position = 0;
-	}
-	ret = batch->entropy_u32[batch->position++];
-	spin_unlock_irqrestore(&batch->batch_lock, flags);
+	ret = batch->entropy_u32[batch->position];
+	batch->entropy_u32[batch->position++] = 0;
+	local_unlock_irqrestore(&batched_entropy_u32.lock, flags);
 	return ret;
 }
 EXPORT_SYMBOL(get_random_u32);
 
 /* It's important to invalidate all potential batched entropy that might
  * be stored before the crng is initialized, which we can do lazily by
- * simply resetting the counter to zero so that it's re-extracted on the
- * next usage. */
+ * bumping the generation so that it's re-extracted on the next usage
+ * on each CPU. */
 static void invalidate_batched_entropy(void)
 {
-	int cpu;
-	unsigned long flags;
-
-	for_each_possible_cpu (cpu) {
-		struct batched_entropy *batched_entropy;
-
-		batched_entropy = per_cpu_ptr(&batched_entropy_u32, cpu);
-		spin_lock_irqsave(&batched_entropy->batch_lock, flags);
-		batched_entropy->position = 0;
-		spin_unlock(&batched_entropy->batch_lock);
-
-		batched_entropy = per_cpu_ptr(&batched_entropy_u64, cpu);
-		spin_lock(&batched_entropy->batch_lock);
-		batched_entropy->position = 0;
-		spin_unlock_irqrestore(&batched_entropy->batch_lock, flags);
-	}
+	atomic_inc(&batched_entropy_generation);
 }
 
 /**
@@ -13,35 +13,109 @@
 
 #define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
 
+#include <linux/cpu.h>
 #include <linux/cpufreq.h>
+#include <linux/energy_model.h>
 #include <linux/module.h>
 #include <linux/err.h>
 #include <linux/sched.h>	/* set_cpus_allowed() */
 #include <linux/delay.h>
 #include <linux/platform_device.h>
+#include <linux/pm_qos.h>
 
 #include <asm/idle.h>
+#include <asm/time.h>
 
 #include <asm/mach-loongson2ef/loongson.h>
 
 static uint nowait;
 
+/*
+ * CPU latency QoS limit (us) below which the core is kept at its nominal
+ * clock.  Interrupt entry and exit run at the core clock, so at 1/8 clock
+ * they take eight times as long.
+ */
+static uint qos_latency_us = 100;
+
+/* Exit latency (us) of the clock stop done by loongson2_cpu_wait() */
+#define LOONGSON2_WAIT_LATENCY_US	5
+
 static void (*saved_cpu_wait) (void);
 
-static int loongson2_cpu_freq_notifier(struct notifier_block *nb,
-					unsigned long val, void *data);
+/* loops_per_jiffy at the nominal clock, for rescaling udelay */
+static unsigned long loongson2_ref_lpj;
+
+static struct freq_qos_request loongson2_qos_req;
+static unsigned int loongson2_max_freq;
+
+static s32 loongson2_qos_min_freq(s32 latency)
+{
+	return latency < qos_latency_us ? loongson2_max_freq :
+					  FREQ_QOS_MIN_DEFAULT_VALUE;
+}
+
+/* Raise the policy minimum to the nominal clock while latency is tight */
+static int loongson2_qos_notify(struct notifier_block *nb,
+				unsigned long latency, void *unused)
+{
+	freq_qos_update_request(&loongson2_qos_req,
+				loongson2_qos_min_freq(latency));
+	return NOTIFY_OK;
+}
 
-static struct notifier_block loongson2_cpufreq_notifier_block = {
-	.notifier_call = loongson2_cpu_freq_notifier
+static struct notifier_block loongson2_qos_nb = {
+	.notifier_call = loongson2_qos_notify,
 };
 
-static int loongson2_cpu_freq_notifier(struct notifier_block *nb,
-					unsigned long val, void *data)
+/*
+ * Approximate core power (mW) at the nominal clock, split into the part
+ * that scales with the clock and the part that does not.  The 2F has no
+ * voltage scaling, so only the first one goes down with the divider.
+ */
+#define LOONGSON2_POWER_DYN_MW		3000
+#define LOONGSON2_POWER_STATIC_MW	1000
+
+static int loongson2_get_power(unsigned long *power, unsigned long *freq,
+			       struct device *cpu_dev)
 {
-	if (val == CPUFREQ_POSTCHANGE)
-		current_cpu_data.udelay_val = loops_per_jiffy;
+	struct cpufreq_frequency_table *pos;
 
-	return 0;
+	cpufreq_for_each_valid_entry(pos, loongson2_clockmod_table) {
+		if (pos->frequency < *freq)
+			continue;
+
+		*freq = pos->frequency;
+		*power = LOONGSON2_POWER_STATIC_MW +
+			 (unsigned long)LOONGSON2_POWER_DYN_MW * pos->frequency /
+			 loongson2_max_freq;
+		return 0;
+	}
+
+	return -EINVAL;
+}
+
+/*
+ * Switch the core clock.  This runs from the scheduler when schedutil fast
+ * switches, so the transition notifier chain is not available: the delay
+ * loop calibration and the scheduler's frequency invariance are updated
+ * from here instead, and loongson2_cpu_set_rate() folds the Count
+ * clocksource epoch around the divider write.
+ */
+static unsigned int loongson2_cpufreq_set(struct cpufreq_policy *policy,
+					  unsigned int index)
+{
+	unsigned int freq = policy->freq_table[index].frequency;
+
+	loongson2_cpu_set_rate(freq);
+
+	loops_per_jiffy = cpufreq_scale(loongson2_ref_lpj,
+					policy->cpuinfo.max_freq, freq);
+	current_cpu_data.udelay_val = loops_per_jiffy;
+
+	arch_set_freq_scale(policy->related_cpus, freq,
+			    policy->cpuinfo.max_freq);
+
+	return freq;
 }
 
 /*
@@ -50,20 +124,20 @@ static int loongson2_cpu_freq_notifier(struct notifier_block *nb,
 static int loongson2_cpufreq_target(struct cpufreq_policy *policy,
 				     unsigned int index)
 {
-	unsigned int freq;
-
-	freq =
-	    ((cpu_clock_freq / 1000) *
-	     loongson2_clockmod_table[index].driver_data) / 8;
-
-	/* setting the cpu frequency */
-	loongson2_cpu_set_rate(freq);
+	loongson2_cpufreq_set(policy, index);
 
 	return 0;
 }
 
+static unsigned int loongson2_cpufreq_fast_switch(struct cpufreq_policy *policy,
+						  unsigned int target_freq)
+{
+	return loongson2_cpufreq_set(policy, policy->cached_resolved_idx);
+}
+
 static int loongson2_cpufreq_cpu_init(struct cpufreq_policy *policy)
 {
+	struct em_data_callback em_cb = EM_DATA_CB(loongson2_get_power);
 	int i;
 	unsigned long rate;
 	int ret;
@@ -82,12 +156,39 @@ static int loongson2_cpufreq_cpu_init(struct cpufreq_policy *policy)
 	if (ret)
 		return ret;
 
+	loongson2_ref_lpj = loops_per_jiffy;
+
 	cpufreq_generic_init(policy, &loongson2_clockmod_table[0], 0);
+	policy->fast_switch_possible = true;
+	arch_set_freq_scale(policy->related_cpus, rate, rate);
+
+	loongson2_max_freq = policy->cpuinfo.max_freq;
+	ret = freq_qos_add_request(&policy->constraints, &loongson2_qos_req,
+				   FREQ_QOS_MIN,
+				   loongson2_qos_min_freq(cpu_latency_qos_limit()));
+	if (ret < 0)
+		return ret;
+
+	cpu_latency_qos_add_notifier(&loongson2_qos_nb);
+
+	/*
+	 * The energy model is optional, so only warn if it cannot be set
+	 * up.  The EM of a CPU device outlives the driver, so it may still
+	 * be there from an earlier load: its power values do not change.
+	 */
+	ret = em_dev_register_perf_domain(get_cpu_device(policy->cpu), i - 2,
+					  &em_cb, policy->cpus);
+	if (ret && ret != -EEXIST)
+		pr_warn("failed to register the energy model: %d\n", ret);
+
 	return 0;
 }
 
 static int loongson2_cpufreq_exit(struct cpufreq_policy *policy)
 {
+	em_dev_unregister_perf_domain(get_cpu_device(policy->cpu));
+	cpu_latency_qos_remove_notifier(&loongson2_qos_nb);
+	freq_qos_remove_request(&loongson2_qos_req);
 	return 0;
 }
 
@@ -96,6 +197,7 @@ static struct cpufreq_driver loongson2_cpufreq_driver = {
 	.init = loongson2_cpufreq_cpu_init,
 	.verify = cpufreq_generic_frequency_table_verify,
 	.target_index = loongson2_cpufreq_target,
+	.fast_switch = loongson2_cpufreq_fast_switch,
 	.get = cpufreq_generic_get,
 	.exit = loongson2_cpufreq_exit,
 	.attr = cpufreq_generic_attr,
@@ -118,24 +220,26 @@ static struct platform_driver platform_driver = {
 };
 
 /*
- * This is the simple version of Loongson-2 wait, Maybe we need do this in
- * interrupt disabled context.
+ * This is the simple version of Loongson-2 wait, used when the cpuidle
+ * driver is not built.  It is entered with interrupts disabled and the 2F
+ * is uniprocessor, so the divider can be saved and restored without a lock.
  */
 
-static DEFINE_SPINLOCK(loongson2_wait_lock);
-
 static void loongson2_cpu_wait(void)
 {
-	unsigned long flags;
 	u32 cpu_freq;
 
-	spin_lock_irqsave(&loongson2_wait_lock, flags);
+	/* let the idle loop spin when the clock stop wakes up too slowly */
+	if (cpu_latency_qos_limit() < LOONGSON2_WAIT_LATENCY_US) {
+		local_irq_enable();
+		return;
+	}
+
 	cpu_freq = readl(LOONGSON_CHIPCFG);
 	/* Put CPU into wait mode */
-	writel(readl(LOONGSON_CHIPCFG) & ~0x7, LOONGSON_CHIPCFG);
+	loongson2_chipcfg_write(cpu_freq & ~0x7);
 	/* Restore CPU state */
-	writel(cpu_freq, LOONGSON_CHIPCFG);
-	spin_unlock_irqrestore(&loongson2_wait_lock, flags);
+	loongson2_chipcfg_write(cpu_freq);
 	local_irq_enable();
 }
 
@@ -150,12 +254,9 @@ static int __init cpufreq_init(void)
 
 	pr_info("Loongson-2F CPU frequency driver\n");
 
-	cpufreq_register_notifier(&loongson2_cpufreq_notifier_block,
-				  CPUFREQ_TRANSITION_NOTIFIER);
-
 	ret = cpufreq_register_driver(&loongson2_cpufreq_driver);
 
-	if (!ret && !nowait) {
+	if (!ret && !nowait && !IS_ENABLED(CONFIG_LOONGSON2_CPUIDLE)) {
 		saved_cpu_wait = cpu_wait;
 		cpu_wait = loongson2_cpu_wait;
 	}
@@ -168,8 +269,6 @@ static void __exit cpufreq_exit(void)
 	if (!nowait && saved_cpu_wait)
 		cpu_wait = saved_cpu_wait;
 	cpufreq_unregister_driver(&loongson2_cpufreq_driver);
-	cpufreq_unregister_notifier(&loongson2_cpufreq_notifier_block,
-				    CPUFREQ_TRANSITION_NOTIFIER);
 
 	platform_driver_unregister(&platform_driver);
 }
@@ -180,6 +279,9 @@ module_exit(cpufreq_exit);
 module_param(nowait, uint, 0644);
 MODULE_PARM_DESC(nowait, "Disable Loongson-2F specific wait");
 
+module_param(qos_latency_us, uint, 0644);
+MODULE_PARM_DESC(qos_latency_us, "CPU latency QoS limit (us) below which the nominal clock is kept");
+
 MODULE_AUTHOR("Yanhua <yanh@lemote.com>");
 MODULE_DESCRIPTION("cpufreq driver for Loongson2F");
 MODULE_LICENSE("GPL");
@@ -0,0 +1,185 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * CPU idle driver for the Loongson-2F processor
+ *
+ * The 2F has no WAIT instruction.  Its only power saving knob is the core
+ * clock divider in LOONGSON_CHIPCFG[2:0], which selects (n + 1) / 8 of the
+ * nominal clock, with n == 0 stopping the core until an interrupt line is
+ * asserted.  This gives three idle states:
+ *
+ * #0 poll   - spin at the current clock with interrupts enabled
+ * #1 slow   - drop to 1/4 of the nominal clock and poll for a pending
+ *             interrupt with interrupts disabled
+ * #2 gated  - stop the core clock until an interrupt is asserted
+ *
+ * The divider is shared with the cpufreq driver.  The 2F is uniprocessor and
+ * the idle task cannot run while loongson2_cpu_set_rate() is in progress, so
+ * no lock is needed to save and restore it around the idle period.  The
+ * writes go through loongson2_chipcfg_write(), which keeps the Count
+ * clocksource in step with the reduced clock.  Count stops with the core
+ * clock though, so while it keeps the time the gated state falls back to
+ * the slow one.
+ */
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/cpuidle.h>
+#include <linux/init.h>
+#include <linux/io.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/module.h>
+#include <linux/sched.h>
+
+#include <asm/idle.h>
+#include <asm/mipsregs.h>
+#include <asm/time.h>
+
+#include <asm/mach-loongson2ef/loongson.h>
+
+#define LOONGSON2_CLK_MASK	0x7
+#define LOONGSON2_CLK_STOP	0
+#define LOONGSON2_CLK_SLOW	1	/* 2/8 of the nominal clock */
+
+#define LOONGSON2_STATE_SLOW	1	/* index of the slow state */
+
+/* number of divider round trips timed to estimate the exit latency */
+#define LOONGSON2_CAL_LOOPS	16
+
+static inline bool loongson2_irq_pending(void)
+{
+	return read_c0_cause() & read_c0_status() & CAUSEF_IP;
+}
+
+static inline u32 loongson2_set_clk(u32 cfg, u32 clk)
+{
+	loongson2_chipcfg_write((cfg & ~LOONGSON2_CLK_MASK) | clk);
+	return cfg;
+}
+
+static inline void loongson2_restore_clk(u32 cfg)
+{
+	loongson2_chipcfg_write(cfg);
+	/* make sure the full clock is back before we return to the scheduler */
+	readl(LOONGSON_CHIPCFG);
+}
+
+static int loongson2_enter_poll(struct cpuidle_device *dev,
+				struct cpuidle_driver *drv, int index)
+{
+	local_irq_enable();
+	while (!need_resched())
+		cpu_relax();
+
+	return index;
+}
+
+static int loongson2_enter_slow(struct cpuidle_device *dev,
+				struct cpuidle_driver *drv, int index)
+{
+	u32 cfg = loongson2_set_clk(readl(LOONGSON_CHIPCFG),
+				    LOONGSON2_CLK_SLOW);
+
+	while (!loongson2_irq_pending() && !need_resched())
+		cpu_relax();
+
+	loongson2_restore_clk(cfg);
+
+	return index;
+}
+
+static int loongson2_enter_gated(struct cpuidle_device *dev,
+				 struct cpuidle_driver *drv, int index)
+{
+	u32 cfg;
+
+	/* the time spent with Count stopped would be lost */
+	if (r4k_clocksource_scaled())
+		return loongson2_enter_slow(dev, drv, LOONGSON2_STATE_SLOW);
+
+	cfg = loongson2_set_clk(readl(LOONGSON_CHIPCFG), LOONGSON2_CLK_STOP);
+
+	/* the clock restarts as soon as an interrupt is asserted */
+	loongson2_restore_clk(cfg);
+
+	return index;
+}
+
+static struct cpuidle_driver loongson2_idle_driver = {
+	.name			= "loongson2_idle",
+	.owner			= THIS_MODULE,
+	.states[0]		= {
+		.enter			= loongson2_enter_poll,
+		.exit_latency		= 0,
+		.target_residency	= 0,
+		.power_usage		= UINT_MAX,
+		.name			= "poll",
+		.desc			= "Loongson-2F busy poll",
+	},
+	.states[1]		= {
+		.enter			= loongson2_enter_slow,
+		.exit_latency		= 2,
+		.target_residency	= 20,
+		.power_usage		= 250,
+		.name			= "slow",
+		.desc			= "Loongson-2F 1/4 clock poll",
+	},
+	.states[2]		= {
+		.enter			= loongson2_enter_gated,
+		.exit_latency		= 5,
+		.target_residency	= 100,
+		.power_usage		= 0,
+		.flags			= CPUIDLE_FLAG_TIMER_STOP,
+		.name			= "gated",
+		.desc			= "Loongson-2F core clock stopped",
+	},
+	.state_count		= 3,
+};
+
+/*
+ * The exit path of the slow and gated states is a divider write followed
+ * by a read back through the uncached north bridge window, and that is
+ * what dominates their wakeup latency.  Time a few reduced clock round
+ * trips at boot and raise the static figures when the board is slower.
+ */
+static void __init loongson2_idle_calibrate(void)
+{
+	struct cpuidle_state *slow = &loongson2_idle_driver.states[1];
+	struct cpuidle_state *gated = &loongson2_idle_driver.states[2];
+	unsigned long flags;
+	u64 t0, ns;
+	u32 cfg;
+	int i;
+
+	local_irq_save(flags);
+	cfg = readl(LOONGSON_CHIPCFG);
+	t0 = ktime_get_mono_fast_ns();
+	for (i = 0; i < LOONGSON2_CAL_LOOPS; i++) {
+		loongson2_set_clk(cfg, LOONGSON2_CLK_SLOW);
+		loongson2_restore_clk(cfg);
+	}
+	ns = ktime_get_mono_fast_ns() - t0;
+	local_irq_restore(flags);
+
+	ns = DIV_ROUND_UP_ULL(ns, LOONGSON2_CAL_LOOPS);
+	slow->exit_latency = max_t(unsigned int, slow->exit_latency,
+				   DIV_ROUND_UP_ULL(ns, NSEC_PER_USEC));
+	gated->exit_latency = max(gated->exit_latency, 2 * slow->exit_latency);
+	gated->target_residency = max(gated->target_residency,
+				      20 * gated->exit_latency);
+
+	pr_info("divider round trip %llu ns, exit latency %u/%u us\n",
+		ns, slow->exit_latency, gated->exit_latency);
+}
+
+static int __init loongson2_idle_init(void)
+{
+	if (current_cpu_type() != CPU_LOONGSON2EF ||
+	    (read_c0_prid() & PRID_REV_MASK) != PRID_REV_LOONGSON2F)
+		return -ENODEV;
+
+	loongson2_idle_calibrate();
+
+	return cpuidle_register(&loongson2_idle_driver, NULL);
+}
+device_initcall(loongson2_idle_init);
@@ -98,6 +98,16 @@ int dma_fence_chain_find_seqno(struct dma_fence **pfence, uint64_t seqno)
 	if (!chain || chain->base.seqno < seqno)
 		return -EINVAL;
 
+	/*
+	 * A chain node only signals once everything before it did, so a
+	 * signaled node covers any earlier sequence number as well. This
+	 * spares waits on old timeline points the walk over the chain.
+	 * Only test the cached flag: dma_fence_is_signaled() would ask
+	 * dma_fence_chain_signaled(), which walks the chain itself.
+	 */
+	if (test_bit(DMA_FENCE_FLAG_SIGNALED_BIT, &chain->base.flags))
+		return 0;
+
 	dma_fence_chain_for_each(*pfence, &chain->base) {
 		if ((*pfence)->context != chain->base.context ||
 		    to_dma_fence_chain(*pfence)->prev_seqno < seqno)
@@ -298,6 +298,91 @@ static int find_signaled(void *arg)
 	return err;
 }
 
+static int find_completed(void *arg)
+{
+	struct fence_chains fc;
+	struct dma_fence *fence;
+	int err, i;
+
+	err = fence_chains_init(&fc, 64, seqno_inc);
+	if (err)
+		return err;
+
+	for (i = 0; i < fc.chain_length; i++)
+		dma_fence_signal(fc.fences[i]);
+
+	/* Latch the signaled state of the tail for the lookup to find */
+	if (!dma_fence_is_signaled(fc.tail)) {
+		pr_err("Completed chain not reported as signaled\n");
+		err = -EINVAL;
+		goto err;
+	}
+
+	fence = dma_fence_get(fc.tail);
+	err = dma_fence_chain_find_seqno(&fence, 1);
+	dma_fence_put(fence);
+	if (err) {
+		pr_err("Reported %d for find_seqno()!\n", err);
+		goto err;
+	}
+
+	if (fence != fc.tail) {
+		pr_err("Chain walked for seqno:1 of completed chain, got %s:%lld\n",
+		       fence ? "chain-fence.seqno" : "NULL",
+		       fence ? fence->seqno : 0);
+		err = -EINVAL;
+	}
+
+err:
+	fence_chains_fini(&fc);
+	return err;
+}
+
+static int find_unsignaled_tail(void *arg)
+{
+	struct fence_chains fc;
+	struct dma_fence *fence;
+	int err, i;
+
+	err = fence_chains_init(&fc, 64, seqno_inc);
+	if (err)
+		return err;
+
+	for (i = 0; i < fc.chain_length - 1; i++)
+		dma_fence_signal(fc.fences[i]);
+
+	fence = dma_fence_get(fc.tail);
+	err = dma_fence_chain_find_seqno(&fence, fc.chain_length);
+	dma_fence_put(fence);
+	if (err) {
+		pr_err("Reported %d for find_seqno(tail)!\n", err);
+		goto err;
+	}
+	if (fence != fc.tail) {
+		pr_err("Incorrect fence reported for the unsignaled tail\n");
+		err = -EINVAL;
+		goto err;
+	}
+
+	/* Everything before the tail is done, so seqno:1 is complete */
+	fence = dma_fence_get(fc.tail);
+	err = dma_fence_chain_find_seqno(&fence, 1);
+	dma_fence_put(fence);
+	if (err) {
+		pr_err("Reported %d for find_seqno()!\n", err);
+		goto err;
+	}
+	if (fence && !dma_fence_is_signaled(fence)) {
+		pr_err("Unsignaled chain-fence.seqno:%lld reported for completed seqno:1\n",
+		       fence->seqno);
+		err = -EINVAL;
+	}
+
+err:
+	fence_chains_fini(&fc);
+	return err;
+}
+
 static int find_out_of_order(void *arg)
 {
 	struct fence_chains fc;
@@ -687,6 +772,8 @@ int dma_fence_chain(void)
 		SUBTEST(sanitycheck),
 		SUBTEST(find_seqno),
 		SUBTEST(find_signaled),
+		SUBTEST(find_completed),
+		SUBTEST(find_unsignaled_tail),
 		SUBTEST(find_out_of_order),
 		SUBTEST(find_gap),
 		SUBTEST(find_race),
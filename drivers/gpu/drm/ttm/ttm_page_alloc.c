@@ -92,6 +92,25 @@ struct ttm_pool_opts {
 
 #define NUM_POOLS 6
 
+/**
+ * struct ttm_pool_node - The pools holding the pages of one NUMA node.
+ *
+ * @pools: All pool objects of the node.
+ */
+struct ttm_pool_node {
+	union {
+		struct ttm_page_pool	pools[NUM_POOLS];
+		struct {
+			struct ttm_page_pool	wc_pool;
+			struct ttm_page_pool	uc_pool;
+			struct ttm_page_pool	wc_pool_dma32;
+			struct ttm_page_pool	uc_pool_dma32;
+			struct ttm_page_pool	wc_pool_huge;
+			struct ttm_page_pool	uc_pool_huge;
+		} ;
+	};
+};
+
 /**
  * struct ttm_pool_manager - Holds memory pools for fst allocation
  *
@@ -103,24 +122,15 @@ struct ttm_pool_opts {
  * some pages to free.
  * @small_allocation: Limit in number of pages what is small allocation.
  *
- * @pools: All pool objects in use.
+ * @nodes: The pools of each NUMA node; pages are pooled on the node they
+ * belong to and handed out to allocations running on that node.
  **/
 struct ttm_pool_manager {
 	struct kobject		kobj;
 	struct shrinker		mm_shrink;
 	struct ttm_pool_opts	options;
 
-	union {
-		struct ttm_page_pool	pools[NUM_POOLS];
-		struct {
-			struct ttm_page_pool	wc_pool;
-			struct ttm_page_pool	uc_pool;
-			struct ttm_page_pool	wc_pool_dma32;
-			struct ttm_page_pool	uc_pool_dma32;
-			struct ttm_page_pool	wc_pool_huge;
-			struct ttm_page_pool	uc_pool_huge;
-		} ;
-	};
+	struct ttm_pool_node	nodes[];
 };
 
 static struct attribute ttm_page_pool_max = {
@@ -217,9 +227,10 @@ static struct kobj_type ttm_pool_kobj_type = {
 static struct ttm_pool_manager *_manager;
 
 /**
- * Select the right pool or requested caching state and ttm flags. */
+ * Select the right pool or requested caching state, ttm flags and node. */
 static struct ttm_page_pool *ttm_get_pool(int flags, bool huge,
-					  enum ttm_caching_state cstate)
+					  enum ttm_caching_state cstate,
+					  int nid)
 {
 	int pool_index;
 
@@ -240,7 +251,7 @@ static struct ttm_page_pool *ttm_get_pool(int flags, bool huge,
 		pool_index |= 0x4;
 	}
 
-	return &_manager->pools[pool_index];
+	return &_manager->nodes[nid].pools[pool_index];
 }
 
 /* set memory back to wb and free the pages. */
@@ -396,7 +407,7 @@ ttm_pool_shrink_scan(struct shrinker *shrink, struct shrink_control *sc)
 		if (shrink_pages == 0)
 			break;
 
-		pool = &_manager->pools[(i + pool_offset)%NUM_POOLS];
+		pool = &_manager->nodes[sc->nid].pools[(i + pool_offset)%NUM_POOLS];
 		page_nr = (1 << pool->order);
 		/* OK to use static buffer since global mutex is held. */
 		nr_free_pool = roundup(nr_free, page_nr) >> pool->order;
@@ -419,7 +430,7 @@ ttm_pool_shrink_count(struct shrinker *shrink, struct shrink_control *sc)
 	struct ttm_page_pool *pool;
 
 	for (i = 0; i < NUM_POOLS; ++i) {
-		pool = &_manager->pools[i];
+		pool = &_manager->nodes[sc->nid].pools[i];
 		count += (pool->npages << pool->order);
 	}
 
@@ -431,6 +442,7 @@ static int ttm_pool_mm_shrink_init(struct ttm_pool_manager *manager)
 	manager->mm_shrink.count_objects = ttm_pool_shrink_count;
 	manager->mm_shrink.scan_objects = ttm_pool_shrink_scan;
 	manager->mm_shrink.seeks = 1;
+	manager->mm_shrink.flags = SHRINKER_NUMA_AWARE;
 	return register_shrinker(&manager->mm_shrink);
 }
 
@@ -704,14 +716,55 @@ static int ttm_page_pool_get_pages(struct ttm_page_pool *pool,
 	return r;
 }
 
-/* Put all pages in pages list to correct pool to wait for reuse */
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+/**
+ * Return the number of physically consecutive pages pages starts with, at
+ * most HPAGE_PMD_NR. A huge page occupies HPAGE_PMD_NR such entries.
+ */
+static unsigned ttm_huge_run(struct page **pages, unsigned npages)
+{
+	struct page *p = pages[0];
+	unsigned j;
+
+	if (!p || npages < HPAGE_PMD_NR)
+		return 0;
+
+	for (j = 1; j < HPAGE_PMD_NR; ++j)
+		if (++p != pages[j])
+			break;
+	return j;
+}
+#endif
+
+/**
+ * Drop the pool lock and make sure the pool doesn't go over its limit.
+ */
+static void ttm_page_pool_unlock_trim(struct ttm_page_pool *pool,
+				      unsigned long irq_flags)
+{
+	unsigned npages = 0;
+
+	if (pool->npages > _manager->options.max_size) {
+		npages = pool->npages - _manager->options.max_size;
+		/* free at least NUM_PAGES_TO_ALLOC number of pages
+		 * to reduce calls to set_memory_wb */
+		if (npages < NUM_PAGES_TO_ALLOC)
+			npages = NUM_PAGES_TO_ALLOC;
+	}
+	spin_unlock_irqrestore(&pool->lock, irq_flags);
+	if (npages)
+		ttm_page_pool_free(pool, npages, false);
+}
+
+/**
+ * Put all pages in pages list to correct pool to wait for reuse. The huge
+ * pages leading the list go to the huge pools, the rest to the small ones;
+ * pages go to the pools of the node they belong to.
+ */
 static void ttm_put_pages(struct page **pages, unsigned npages, int flags,
 			  enum ttm_caching_state cstate)
 {
-	struct ttm_page_pool *pool = ttm_get_pool(flags, false, cstate);
-#ifdef CONFIG_TRANSPARENT_HUGEPAGE
-	struct ttm_page_pool *huge = ttm_get_pool(flags, true, cstate);
-#endif
+	struct ttm_page_pool *pool = ttm_get_pool(flags, false, cstate, 0);
 	unsigned long irq_flags;
 	unsigned i;
 
@@ -754,69 +807,68 @@ static void ttm_put_pages(struct page **pages, unsigned npages, int flags,
 		return;
 	}
 
-	i = 0;
 #ifdef CONFIG_TRANSPARENT_HUGEPAGE
-	if (huge) {
-		unsigned max_size, n2free;
-
-		spin_lock_irqsave(&huge->lock, irq_flags);
-		while ((npages - i) >= HPAGE_PMD_NR) {
-			struct page *p = pages[i];
-			unsigned j;
-
-			if (!p)
-				break;
-
-			for (j = 1; j < HPAGE_PMD_NR; ++j)
-				if (++p != pages[i + j])
-				    break;
+	if (!(flags & TTM_PAGE_FLAG_DMA32)) {
+		unsigned max_size = _manager->options.max_size / HPAGE_PMD_NR;
+
+		/*
+		 * ttm_get_pages() puts the huge pages at the start of the
+		 * array, so they end with the first run that isn't one.
+		 * Huge pages aren't compound, so small pages further on that
+		 * happen to be physically consecutive must not be mistaken
+		 * for one.
+		 */
+		i = 0;
+		while (i < npages) {
+			struct ttm_page_pool *huge;
+			unsigned j, n2free = 0;
 
+			j = ttm_huge_run(pages + i, npages - i);
 			if (j != HPAGE_PMD_NR)
 				break;
 
+			huge = ttm_get_pool(flags, true, cstate,
+					    page_to_nid(pages[i]));
+			spin_lock_irqsave(&huge->lock, irq_flags);
 			list_add_tail(&pages[i]->lru, &huge->list);
+			huge->npages++;
+			/* Check that we don't go over the pool limit */
+			if (huge->npages > max_size)
+				n2free = huge->npages - max_size;
+			spin_unlock_irqrestore(&huge->lock, irq_flags);
+			if (n2free)
+				ttm_page_pool_free(huge, n2free, false);
 
 			for (j = 0; j < HPAGE_PMD_NR; ++j)
 				pages[i++] = NULL;
-			huge->npages++;
 		}
-
-		/* Check that we don't go over the pool limit */
-		max_size = _manager->options.max_size;
-		max_size /= HPAGE_PMD_NR;
-		if (huge->npages > max_size)
-			n2free = huge->npages - max_size;
-		else
-			n2free = 0;
-		spin_unlock_irqrestore(&huge->lock, irq_flags);
-		if (n2free)
-			ttm_page_pool_free(huge, n2free, false);
 	}
 #endif
 
-	spin_lock_irqsave(&pool->lock, irq_flags);
-	while (i < npages) {
-		if (pages[i]) {
-			if (page_count(pages[i]) != 1)
-				pr_err("Erroneous page count. Leaking pages.\n");
-			list_add_tail(&pages[i]->lru, &pool->list);
-			pages[i] = NULL;
-			pool->npages++;
+	pool = NULL;
+	for (i = 0; i < npages; ++i) {
+		struct ttm_page_pool *node_pool;
+
+		if (!pages[i])
+			continue;
+
+		if (page_count(pages[i]) != 1)
+			pr_err("Erroneous page count. Leaking pages.\n");
+
+		node_pool = ttm_get_pool(flags, false, cstate,
+					 page_to_nid(pages[i]));
+		if (node_pool != pool) {
+			if (pool)
+				ttm_page_pool_unlock_trim(pool, irq_flags);
+			pool = node_pool;
+			spin_lock_irqsave(&pool->lock, irq_flags);
 		}
-		++i;
-	}
-	/* Check that we don't go over the pool limit */
-	npages = 0;
-	if (pool->npages > _manager->options.max_size) {
-		npages = pool->npages - _manager->options.max_size;
-		/* free at least NUM_PAGES_TO_ALLOC number of pages
-		 * to reduce calls to set_memory_wb */
-		if (npages < NUM_PAGES_TO_ALLOC)
-			npages = NUM_PAGES_TO_ALLOC;
+		list_add_tail(&pages[i]->lru, &pool->list);
+		pages[i] = NULL;
+		pool->npages++;
 	}
-	spin_unlock_irqrestore(&pool->lock, irq_flags);
-	if (npages)
-		ttm_page_pool_free(pool, npages, false);
+	if (pool)
+		ttm_page_pool_unlock_trim(pool, irq_flags);
 }
 
 /*
@@ -826,9 +878,10 @@ static void ttm_put_pages(struct page **pages, unsigned npages, int flags,
 static int ttm_get_pages(struct page **pages, unsigned npages, int flags,
 			 enum ttm_caching_state cstate)
 {
-	struct ttm_page_pool *pool = ttm_get_pool(flags, false, cstate);
+	int nid = numa_node_id();
+	struct ttm_page_pool *pool = ttm_get_pool(flags, false, cstate, nid);
 #ifdef CONFIG_TRANSPARENT_HUGEPAGE
-	struct ttm_page_pool *huge = ttm_get_pool(flags, true, cstate);
+	struct ttm_page_pool *huge = ttm_get_pool(flags, true, cstate, nid);
 #endif
 	struct list_head plist;
 	struct page *p = NULL;
@@ -951,44 +1004,52 @@ static void ttm_page_pool_init_locked(struct ttm_page_pool *pool, gfp_t flags,
 	pool->order = order;
 }
 
-int ttm_page_alloc_init(struct ttm_mem_global *glob, unsigned max_pages)
+static void ttm_pool_node_init(struct ttm_pool_node *node)
 {
-	int ret;
 #ifdef CONFIG_TRANSPARENT_HUGEPAGE
 	unsigned order = HPAGE_PMD_ORDER;
 #else
 	unsigned order = 0;
 #endif
 
-	WARN_ON(_manager);
-
-	pr_info("Initializing pool allocator\n");
+	ttm_page_pool_init_locked(&node->wc_pool, GFP_HIGHUSER, "wc", 0);
 
-	_manager = kzalloc(sizeof(*_manager), GFP_KERNEL);
-	if (!_manager)
-		return -ENOMEM;
+	ttm_page_pool_init_locked(&node->uc_pool, GFP_HIGHUSER, "uc", 0);
 
-	ttm_page_pool_init_locked(&_manager->wc_pool, GFP_HIGHUSER, "wc", 0);
-
-	ttm_page_pool_init_locked(&_manager->uc_pool, GFP_HIGHUSER, "uc", 0);
-
-	ttm_page_pool_init_locked(&_manager->wc_pool_dma32,
+	ttm_page_pool_init_locked(&node->wc_pool_dma32,
 				  GFP_USER | GFP_DMA32, "wc dma", 0);
 
-	ttm_page_pool_init_locked(&_manager->uc_pool_dma32,
+	ttm_page_pool_init_locked(&node->uc_pool_dma32,
 				  GFP_USER | GFP_DMA32, "uc dma", 0);
 
-	ttm_page_pool_init_locked(&_manager->wc_pool_huge,
+	ttm_page_pool_init_locked(&node->wc_pool_huge,
 				  (GFP_TRANSHUGE_LIGHT | __GFP_NORETRY |
 				   __GFP_KSWAPD_RECLAIM) &
 				  ~(__GFP_MOVABLE | __GFP_COMP),
 				  "wc huge", order);
 
-	ttm_page_pool_init_locked(&_manager->uc_pool_huge,
+	ttm_page_pool_init_locked(&node->uc_pool_huge,
 				  (GFP_TRANSHUGE_LIGHT | __GFP_NORETRY |
 				   __GFP_KSWAPD_RECLAIM) &
 				  ~(__GFP_MOVABLE | __GFP_COMP)
 				  , "uc huge", order);
+}
+
+int ttm_page_alloc_init(struct ttm_mem_global *glob, unsigned max_pages)
+{
+	int ret, nid;
+
+	WARN_ON(_manager);
+
+	pr_info("Initializing pool allocator\n");
+
+	_manager = kzalloc(struct_size(_manager, nodes, nr_node_ids),
+			   GFP_KERNEL);
+	if (!_manager)
+		return -ENOMEM;
+
+	for (nid = 0; nid < nr_node_ids; ++nid)
+		ttm_pool_node_init(&_manager->nodes[nid]);
 
 	_manager->options.max_size = max_pages;
 	_manager->options.small = SMALL_ALLOCATION;
@@ -1012,14 +1073,16 @@ int ttm_page_alloc_init(struct ttm_mem_global *glob, unsigned max_pages)
 
 void ttm_page_alloc_fini(void)
 {
-	int i;
+	int i, nid;
 
 	pr_info("Finalizing pool allocator\n");
 	ttm_pool_mm_shrink_fini(_manager);
 
 	/* OK to use static buffer since global mutex is no longer used. */
-	for (i = 0; i < NUM_POOLS; ++i)
-		ttm_page_pool_free(&_manager->pools[i], FREE_ALL_PAGES, true);
+	for (nid = 0; nid < nr_node_ids; ++nid)
+		for (i = 0; i < NUM_POOLS; ++i)
+			ttm_page_pool_free(&_manager->nodes[nid].pools[i],
+					   FREE_ALL_PAGES, true);
 
 	kobject_put(&_manager->kobj);
 	_manager = NULL;
@@ -1170,19 +1233,22 @@ int ttm_page_alloc_debugfs(struct seq_file *m, void *data)
 {
 	struct ttm_page_pool *p;
 	unsigned i;
-	char *h[] = {"pool", "refills", "pages freed", "size"};
+	int nid;
+	char *h[] = {"pool", "node", "refills", "pages freed", "size"};
 	if (!_manager) {
 		seq_printf(m, "No pool allocator running.\n");
 		return 0;
 	}
-	seq_printf(m, "%7s %12s %13s %8s\n",
-			h[0], h[1], h[2], h[3]);
-	for (i = 0; i < NUM_POOLS; ++i) {
-		p = &_manager->pools[i];
-
-		seq_printf(m, "%7s %12ld %13ld %8d\n",
-				p->name, p->nrefills,
-				p->nfrees, p->npages);
+	seq_printf(m, "%7s %4s %12s %13s %8s\n",
+			h[0], h[1], h[2], h[3], h[4]);
+	for (nid = 0; nid < nr_node_ids; ++nid) {
+		for (i = 0; i < NUM_POOLS; ++i) {
+			p = &_manager->nodes[nid].pools[i];
+
+			seq_printf(m, "%7s %4d %12ld %13ld %8d\n",
+					p->name, nid, p->nrefills,
+					p->nfrees, p->npages);
+		}
 	}
 	return 0;
 }
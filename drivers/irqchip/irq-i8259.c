@@ -65,6 +65,18 @@ static unsigned int cached_irq_mask = 0xffff;
 #define cached_master_mask	(cached_irq_mask)
 #define cached_slave_mask	(cached_irq_mask >> 8)
 
+/*
+ * Return the shadowed IMR contents of both controllers, so that platform
+ * polling functions need not read them back over slow port I/O.  Must be
+ * called with i8259A_lock held.
+ */
+unsigned int i8259_cached_mask(void)
+{
+	lockdep_assert_held(&i8259A_lock);
+
+	return cached_irq_mask;
+}
+
 static void disable_8259A_irq(struct irq_data *d)
 {
 	unsigned int mask, irq = d->irq - I8259A_IRQ_BASE;
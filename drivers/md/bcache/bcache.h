@@ -387,6 +387,19 @@ struct cached_dev {
 	unsigned int		writeback_rate_p_term_inverse;
 	unsigned int		writeback_rate_minimum;
 
+	/*
+	 * Backing device write latency seen by writeback: summed up by the
+	 * write completions, averaged every rate update. When the average
+	 * exceeds writeback_latency_target the rate is scaled down.
+	 */
+	atomic64_t		writeback_latency_sum;
+	atomic_t		writeback_latency_nr;
+	uint64_t		writeback_latency;
+	unsigned int		writeback_latency_target;
+
+	/* Largest hole skipped over to keep a writeback run going, bytes */
+	unsigned int		writeback_run_gap;
+
 	enum stop_on_failure	stop_when_cache_set_failed;
 #define DEFAULT_CACHED_DEV_ERROR_LIMIT	64
 	atomic_t		io_errors;
@@ -589,6 +602,12 @@ struct cache_set {
 	struct task_struct	*btree_cache_alloc_lock;
 	spinlock_t		btree_cannibalize_lock;
 
+	/*
+	 * Sibling nodes being read ahead by btree_node_prefetch_async(),
+	 * cache_set_flush() waits for this to drop to zero.
+	 */
+	atomic_t		btree_prefetch_inflight;
+
 	/*
 	 * When we free a btree node, we increment the gen of the bucket the
 	 * node is in - but we can't rewrite the prios and gens until we
@@ -1040,6 +1059,7 @@ void bch_cache_set_stop(struct cache_set *c);
 
 struct cache_set *bch_cache_set_alloc(struct cache_sb *sb);
 void bch_btree_cache_free(struct cache_set *c);
+void bch_btree_prefetch_wait(struct cache_set *c);
 int bch_btree_cache_alloc(struct cache_set *c);
 void bch_moving_init_cache_set(struct cache_set *c);
 int bch_open_buckets_alloc(struct cache_set *c);
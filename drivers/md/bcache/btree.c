@@ -143,7 +143,7 @@ static uint64_t btree_csum_set(struct btree *b, struct bset *i)
 	return crc ^ 0xffffffffffffffffULL;
 }
 
-void bch_btree_node_read_done(struct btree *b)
+static void __bch_btree_node_read_done(struct btree *b, bool report)
 {
 	const char *err = "bad btree header";
 	struct bset *i = btree_bset_first(b);
@@ -225,12 +225,19 @@ void bch_btree_node_read_done(struct btree *b)
 	return;
 err:
 	set_btree_node_io_error(b);
-	bch_cache_set_error(b->c, "%s at bucket %zu, block %u, %u keys",
-			    err, PTR_BUCKET_NR(b->c, &b->key, 0),
-			    bset_block_offset(b, i), i->keys);
+	if (report)
+		bch_cache_set_error(b->c,
+				    "%s at bucket %zu, block %u, %u keys",
+				    err, PTR_BUCKET_NR(b->c, &b->key, 0),
+				    bset_block_offset(b, i), i->keys);
 	goto out;
 }
 
+void bch_btree_node_read_done(struct btree *b)
+{
+	__bch_btree_node_read_done(b, true);
+}
+
 static void btree_node_read_endio(struct bio *bio)
 {
 	struct closure *cl = bio->bi_private;
@@ -238,7 +245,11 @@ static void btree_node_read_endio(struct bio *bio)
 	closure_put(cl);
 }
 
-static void bch_btree_node_read(struct btree *b)
+/*
+ * With @report false a bad node only gets its io error flag set, readahead
+ * guesses at what will be needed and mustn't take the cache set down.
+ */
+static void __bch_btree_node_read(struct btree *b, bool report)
 {
 	uint64_t start_time = local_clock();
 	struct closure cl;
@@ -267,13 +278,19 @@ static void bch_btree_node_read(struct btree *b)
 	if (btree_node_io_error(b))
 		goto err;
 
-	bch_btree_node_read_done(b);
+	__bch_btree_node_read_done(b, report);
 	bch_time_stats_update(&b->c->btree_read_time, start_time);
 
 	return;
 err:
-	bch_cache_set_error(b->c, "io error reading bucket %zu",
-			    PTR_BUCKET_NR(b->c, &b->key, 0));
+	if (report)
+		bch_cache_set_error(b->c, "io error reading bucket %zu",
+				    PTR_BUCKET_NR(b->c, &b->key, 0));
+}
+
+static void bch_btree_node_read(struct btree *b)
+{
+	__bch_btree_node_read(b, true);
 }
 
 static void btree_complete_write(struct btree *b, struct btree_write *w)
@@ -1044,6 +1061,113 @@ static void btree_node_prefetch(struct btree *parent, struct bkey *k)
 	}
 }
 
+/*
+ * Map traversals walk the children of a node in key order, so while one child
+ * is being processed the next one is read ahead from a worker. The worker
+ * takes and drops the write lock of the new node itself, a btree lock can't be
+ * handed over to another task.
+ */
+#define BTREE_PREFETCH_MAX	16
+
+struct btree_prefetch {
+	struct work_struct	work;
+	struct cache_set	*c;
+	int			level;
+	BKEY_PADDED(key);
+};
+
+static void btree_node_prefetch_work(struct work_struct *work)
+{
+	struct btree_prefetch *p = container_of(work, struct btree_prefetch,
+						work);
+	struct cache_set *c = p->c;
+	struct btree *b;
+
+	if (!test_bit(CACHE_SET_IO_DISABLE, &c->flags)) {
+		/*
+		 * The parent isn't locked here, the node may have been freed
+		 * and its bucket reused since the key was copied.
+		 */
+		mutex_lock(&c->bucket_lock);
+		b = ptr_stale(c, &p->key, 0)
+			? NULL
+			: mca_alloc(c, NULL, &p->key, p->level);
+		mutex_unlock(&c->bucket_lock);
+		bch_cannibalize_unlock(c);
+
+		if (!IS_ERR_OR_NULL(b)) {
+			__bch_btree_node_read(b, false);
+
+			/*
+			 * Drop a node that didn't read back, whoever really
+			 * needs it reads it again and reports the error.
+			 */
+			if (btree_node_io_error(b)) {
+				mutex_lock(&c->bucket_lock);
+				mca_bucket_free(b);
+				mutex_unlock(&c->bucket_lock);
+			}
+			rw_unlock(true, b);
+		}
+	}
+
+	kfree(p);
+	if (atomic_dec_and_test(&c->btree_prefetch_inflight))
+		wake_up_var(&c->btree_prefetch_inflight);
+}
+
+static void btree_node_prefetch_async(struct btree *parent, struct bkey *k)
+{
+	struct cache_set *c = parent->c;
+	struct btree_prefetch *p;
+
+	if (mca_find(c, k))
+		return;
+
+	if (atomic_inc_return(&c->btree_prefetch_inflight) >
+	    BTREE_PREFETCH_MAX ||
+	    test_bit(CACHE_SET_STOPPING, &c->flags))
+		goto out;
+
+	p = kmalloc(sizeof(*p), GFP_NOWAIT|__GFP_NOWARN);
+	if (!p)
+		goto out;
+
+	INIT_WORK(&p->work, btree_node_prefetch_work);
+	p->c = c;
+	p->level = parent->level - 1;
+	bkey_copy(&p->key, k);
+	queue_work(bcache_wq, &p->work);
+	return;
+out:
+	if (atomic_dec_and_test(&c->btree_prefetch_inflight))
+		wake_up_var(&c->btree_prefetch_inflight);
+}
+
+/*
+ * Read ahead the child after the one @iter is about to return. The iterator is
+ * copied so nothing points into @b once the caller recurses and possibly
+ * modifies it.
+ */
+static void btree_node_prefetch_next(struct btree *b, struct btree_iter *iter)
+{
+	struct btree_iter next = *iter;
+	struct bkey *k;
+
+	if (!b->level)
+		return;
+
+	k = bch_btree_iter_next_filter(&next, &b->keys, bch_ptr_bad);
+	if (k)
+		btree_node_prefetch_async(b, k);
+}
+
+void bch_btree_prefetch_wait(struct cache_set *c)
+{
+	wait_var_event(&c->btree_prefetch_inflight,
+		       !atomic_read(&c->btree_prefetch_inflight));
+}
+
 /* Btree alloc */
 
 static void btree_node_free(struct btree *b)
@@ -2516,6 +2640,7 @@ static int bch_btree_map_nodes_recurse(struct btree *b, struct btree_op *op,
 
 		while ((k = bch_btree_iter_next_filter(&iter, &b->keys,
 						       bch_ptr_bad))) {
+			btree_node_prefetch_next(b, &iter);
 			ret = bcache_btree(map_nodes_recurse, k, b,
 				    op, from, fn, flags);
 			from = NULL;
@@ -2548,6 +2673,7 @@ int bch_btree_map_keys_recurse(struct btree *b, struct btree_op *op,
 	bch_btree_iter_init(&b->keys, &iter, from);
 
 	while ((k = bch_btree_iter_next_filter(&iter, &b->keys, bch_ptr_bad))) {
+		btree_node_prefetch_next(b, &iter);
 		ret = !b->level
 			? fn(op, b, k)
 			: bcache_btree(map_keys_recurse, k,
@@ -1715,6 +1715,9 @@ static void cache_set_flush(struct closure *cl)
 	if (!IS_ERR_OR_NULL(c->gc_thread))
 		kthread_stop(c->gc_thread);
 
+	/* CACHE_SET_STOPPING is set, no new read ahead gets queued */
+	bch_btree_prefetch_wait(c);
+
 	if (!IS_ERR_OR_NULL(c->root))
 		list_add(&c->root->list, &c->btree_cache);
 
@@ -122,6 +122,8 @@ rw_attribute(writeback_rate_update_seconds);
 rw_attribute(writeback_rate_i_term_inverse);
 rw_attribute(writeback_rate_p_term_inverse);
 rw_attribute(writeback_rate_minimum);
+rw_attribute(writeback_latency_target);
+rw_attribute(writeback_run_gap);
 read_attribute(writeback_rate_debug);
 
 read_attribute(stripe_size);
@@ -206,6 +208,8 @@ SHOW(__bch_cached_dev)
 	var_print(writeback_rate_i_term_inverse);
 	var_print(writeback_rate_p_term_inverse);
 	var_print(writeback_rate_minimum);
+	var_print(writeback_latency_target);
+	var_hprint(writeback_run_gap);
 
 	if (attr == &sysfs_writeback_rate_debug) {
 		char rate[20];
@@ -240,9 +244,11 @@ SHOW(__bch_cached_dev)
 			       "proportional:\t%s\n"
 			       "integral:\t%s\n"
 			       "change:\t\t%s/sec\n"
-			       "next io:\t%llims\n",
+			       "next io:\t%llims\n"
+			       "latency:\t%lluus\n",
 			       rate, dirty, target, proportional,
-			       integral, change, next_io);
+			       integral, change, next_io,
+			       wb ? dc->writeback_latency : 0);
 	}
 
 	sysfs_hprint(dirty_data,
@@ -334,6 +340,10 @@ STORE(__cached_dev)
 	sysfs_strtoul_clamp(writeback_rate_minimum,
 			    dc->writeback_rate_minimum,
 			    1, UINT_MAX);
+	sysfs_strtoul_clamp(writeback_latency_target,
+			    dc->writeback_latency_target,
+			    0, UINT_MAX);
+	d_strtoi_h(writeback_run_gap);
 
 	sysfs_strtoul_clamp(io_error_limit, dc->error_limit, 0, INT_MAX);
 
@@ -503,6 +513,8 @@ static struct attribute *bch_cached_dev_files[] = {
 	&sysfs_writeback_rate_i_term_inverse,
 	&sysfs_writeback_rate_p_term_inverse,
 	&sysfs_writeback_rate_minimum,
+	&sysfs_writeback_latency_target,
+	&sysfs_writeback_run_gap,
 	&sysfs_writeback_rate_debug,
 	&sysfs_io_errors,
 	&sysfs_io_error_limit,
@@ -87,14 +87,19 @@ static void __update_writeback_rate(struct cached_dev *dc)
 		div_s64(error, dc->writeback_rate_p_term_inverse);
 	int64_t integral_scaled;
 	uint32_t new_rate;
+	bool latency_bound = dc->writeback_latency_target &&
+		dc->writeback_latency > dc->writeback_latency_target;
 
 	if ((error < 0 && dc->writeback_rate_integral > 0) ||
-	    (error > 0 && time_before64(local_clock(),
-			 dc->writeback_rate.next + NSEC_PER_MSEC))) {
+	    (error > 0 && !latency_bound &&
+	     time_before64(local_clock(),
+			   dc->writeback_rate.next + NSEC_PER_MSEC))) {
 		/*
 		 * Only decrease the integral term if it's more than
 		 * zero.  Only increase the integral term if the device
-		 * is keeping up.  (Don't wind up the integral
+		 * is keeping up, and the rate is not held down by the
+		 * latency target below: the device then keeps up with
+		 * the lower rate only.  (Don't wind up the integral
 		 * ineffectively in either case).
 		 *
 		 * It's necessary to scale this by
@@ -111,6 +116,18 @@ static void __update_writeback_rate(struct cached_dev *dc)
 	new_rate = clamp_t(int32_t, (proportional_scaled + integral_scaled),
 			dc->writeback_rate_minimum, NSEC_PER_SEC);
 
+	/*
+	 * The dirty target says how fast we would like to write, the backing
+	 * device says how fast it can take it: back off in proportion to how
+	 * far the write latency is over target, so that writeback doesn't
+	 * keep a seeking disk busy past the point of foreground I/O starving.
+	 */
+	if (latency_bound)
+		new_rate = max_t(uint32_t, dc->writeback_rate_minimum,
+				 div64_u64((uint64_t)new_rate *
+					   dc->writeback_latency_target,
+					   dc->writeback_latency));
+
 	dc->writeback_rate_proportional = proportional_scaled;
 	dc->writeback_rate_integral_scaled = integral_scaled;
 	dc->writeback_rate_change = new_rate -
@@ -119,6 +136,16 @@ static void __update_writeback_rate(struct cached_dev *dc)
 	dc->writeback_rate_target = target;
 }
 
+static void update_writeback_latency(struct cached_dev *dc)
+{
+	int nr = atomic_xchg(&dc->writeback_latency_nr, 0);
+	uint64_t sum = atomic64_xchg(&dc->writeback_latency_sum, 0);
+
+	/* Keep the last average if nothing was written this period */
+	if (nr)
+		dc->writeback_latency = div_u64(sum, nr * NSEC_PER_USEC);
+}
+
 static bool set_at_max_writeback_rate(struct cache_set *c,
 				       struct cached_dev *dc)
 {
@@ -197,6 +224,8 @@ static void update_writeback_rate(struct work_struct *work)
 		return;
 	}
 
+	update_writeback_latency(dc);
+
 	if (atomic_read(&dc->has_dirty) && dc->writeback_percent) {
 		/*
 		 * If the whole cache set is idle, set_at_max_writeback_rate()
@@ -246,6 +275,7 @@ struct dirty_io {
 	struct closure		cl;
 	struct cached_dev	*dc;
 	uint16_t		sequence;
+	u64			start_time;
 	struct bio		bio;
 };
 
@@ -318,6 +348,10 @@ static void dirty_endio(struct bio *bio)
 	if (bio->bi_status) {
 		SET_KEY_DIRTY(&w->key, false);
 		bch_count_backing_io_errors(io->dc, bio);
+	} else if (bio_op(bio) == REQ_OP_WRITE) {
+		atomic64_add(local_clock() - io->start_time,
+			     &io->dc->writeback_latency_sum);
+		atomic_inc(&io->dc->writeback_latency_nr);
 	}
 
 	closure_put(&io->cl);
@@ -361,6 +395,7 @@ static void write_dirty(struct closure *cl)
 		io->bio.bi_iter.bi_sector = KEY_START(&w->key);
 		bio_set_dev(&io->bio, io->dc->bdev);
 		io->bio.bi_end_io	= dirty_endio;
+		io->start_time		= local_clock();
 
 		/* I/O request sent to backing device */
 		closure_bio_submit(io->dc->disk.c, &io->bio, cl);
@@ -394,6 +429,28 @@ static void read_dirty_submit(struct closure *cl)
 	continue_at(cl, write_dirty, io->dc->writeback_write_wq);
 }
 
+/*
+ * Keys come out of the keybuf in backing device order, and the writes of a
+ * pass are issued in that order too (see write_dirty()). So a pass is one
+ * forward sweep over the backing device; it may step over small holes, which
+ * a disk covers in rotational latency rather than a seek, but it stops at the
+ * end of a stripe, where the next write would start another full stripe
+ * cycle on a RAID backing device.
+ */
+static bool writeback_run_continues(struct cached_dev *dc, struct bkey *prev,
+				    struct bkey *next)
+{
+	uint64_t end = KEY_OFFSET(prev), start = KEY_START(next);
+
+	if (KEY_INODE(prev) != KEY_INODE(next) || start < end)
+		return false;
+	if (offset_to_stripe(&dc->disk, end - 1) !=
+	    offset_to_stripe(&dc->disk, start))
+		return false;
+
+	return (start - end) << 9 <= dc->writeback_run_gap;
+}
+
 static void read_dirty(struct cached_dev *dc)
 {
 	unsigned int delay = 0;
@@ -438,24 +495,16 @@ static void read_dirty(struct cached_dev *dc)
 			if (size >= MAX_WRITESIZE_IN_PASS)
 				break;
 
-			/*
-			 * Operations are only eligible to be combined
-			 * if they are contiguous.
-			 *
-			 * TODO: add a heuristic willing to fire a
-			 * certain amount of non-contiguous IO per pass,
-			 * so that we can benefit from backing device
-			 * command queueing.
-			 */
-			if ((nk != 0) && bkey_cmp(&keys[nk-1]->key,
-						&START_KEY(&next->key)))
+			if (nk != 0 &&
+			    !writeback_run_continues(dc, &keys[nk-1]->key,
+						     &next->key))
 				break;
 
 			size += KEY_SIZE(&next->key);
 			keys[nk++] = next;
 		} while ((next = bch_keybuf_next(&dc->writeback_keys)));
 
-		/* Now we have gathered a set of 1..5 keys to write back. */
+		/* Now we have gathered a run of 1..16 keys to write back. */
 		for (i = 0; i < nk; i++) {
 			w = keys[i];
 
@@ -976,6 +1025,7 @@ void bch_cached_dev_writeback_init(struct cached_dev *dc)
 	dc->writeback_rate_update_seconds = WRITEBACK_RATE_UPDATE_SECS_DEFAULT;
 	dc->writeback_rate_p_term_inverse = 40;
 	dc->writeback_rate_i_term_inverse = 10000;
+	dc->writeback_run_gap		= 1 << 20;
 
 	WARN_ON(test_and_clear_bit(BCACHE_DEV_WB_RUNNING, &dc->disk.flags));
 	INIT_DELAYED_WORK(&dc->writeback_rate_update, update_writeback_rate);
@@ -113,6 +113,9 @@
 #include <linux/uaccess.h>
 #include <linux/gfp.h>
 #include <linux/if_vlan.h>
+#include <linux/bpf.h>
+#include <linux/bpf_trace.h>
+#include <net/xdp.h>
 #include <asm/irq.h>
 
 #define RTL8139_DRIVER_NAME   DRV_NAME " Fast Ethernet driver " DRV_VERSION
@@ -587,13 +590,19 @@ struct rtl8139_private {
 	unsigned char		*rx_ring;
 	unsigned int		cur_rx;	/* RX buf index of next pkt */
 	struct rtl8139_stats	rx_stats;
+	struct ethtool_lat_hist	napi_lat;
 	dma_addr_t		rx_ring_dma;
 
+	struct bpf_prog		*xdp_prog;
+	struct xdp_rxq_info	xdp_rxq;
+	struct page		*xdp_page;	/* spare page for the next XDP frame */
+
 	unsigned int		tx_flag;
 	unsigned long		cur_tx;
 	unsigned long		dirty_tx;
 	struct rtl8139_stats	tx_stats;
 	unsigned char		*tx_buf[NUM_TX_DESC];	/* Tx bounce buffers */
+	unsigned int		tx_len[NUM_TX_DESC];	/* queued bytes, for BQL */
 	unsigned char		*tx_bufs;	/* Tx bounce buffer region. */
 	dma_addr_t		tx_bufs_dma;
 
@@ -684,9 +693,9 @@ static const u16 rtl8139_intr_mask =
 	PCIErr | PCSTimeout | RxUnderrun | RxOverflow | RxFIFOOver |
 	TxErr | TxOK | RxErr | RxOK;
 
-static const u16 rtl8139_norx_intr_mask =
-	PCIErr | PCSTimeout | RxUnderrun |
-	TxErr | TxOK | RxErr ;
+/* Rx and Tx completion are handled by NAPI while it is scheduled */
+static const u16 rtl8139_napi_intr_mask =
+	PCIErr | PCSTimeout | RxUnderrun | RxErr;
 
 #if RX_BUF_IDX == 0
 static const unsigned int rtl8139_rx_config =
@@ -924,6 +933,29 @@ static int rtl8139_set_features(struct net_device *dev, netdev_features_t featur
 	return 0;
 }
 
+static int rtl8139_xdp_setup(struct net_device *dev, struct bpf_prog *prog)
+{
+	struct rtl8139_private *tp = netdev_priv(dev);
+	struct bpf_prog *old_prog;
+
+	/* rtl8139_rx() samples the program once per NAPI poll */
+	old_prog = xchg(&tp->xdp_prog, prog);
+	if (old_prog)
+		bpf_prog_put(old_prog);
+
+	return 0;
+}
+
+static int rtl8139_xdp(struct net_device *dev, struct netdev_bpf *xdp)
+{
+	switch (xdp->command) {
+	case XDP_SETUP_PROG:
+		return rtl8139_xdp_setup(dev, xdp->prog);
+	default:
+		return -EINVAL;
+	}
+}
+
 static const struct net_device_ops rtl8139_netdev_ops = {
 	.ndo_open		= rtl8139_open,
 	.ndo_stop		= rtl8139_close,
@@ -938,6 +970,7 @@ static const struct net_device_ops rtl8139_netdev_ops = {
 	.ndo_poll_controller	= rtl8139_poll_controller,
 #endif
 	.ndo_set_features	= rtl8139_set_features,
+	.ndo_bpf		= rtl8139_xdp,
 };
 
 static int rtl8139_init_one(struct pci_dev *pdev,
@@ -1010,6 +1043,10 @@ static int rtl8139_init_one(struct pci_dev *pdev,
 	dev->features |= NETIF_F_SG | NETIF_F_HW_CSUM | NETIF_F_HIGHDMA;
 	dev->vlan_features = dev->features;
 
+	/* likewise Rx frames are summed while copied out of the ring */
+	dev->features |= NETIF_F_RXCSUM;
+	dev->hw_features |= NETIF_F_RXCSUM;
+
 	dev->hw_features |= NETIF_F_RXALL;
 	dev->hw_features |= NETIF_F_RXFCS;
 
@@ -1345,6 +1382,22 @@ static int rtl8139_open (struct net_device *dev)
 
 	}
 
+	retval = xdp_rxq_info_reg(&tp->xdp_rxq, dev, 0);
+	if (!retval) {
+		retval = xdp_rxq_info_reg_mem_model(&tp->xdp_rxq,
+						    MEM_TYPE_PAGE_ORDER0, NULL);
+		if (retval)
+			xdp_rxq_info_unreg(&tp->xdp_rxq);
+	}
+	if (retval) {
+		free_irq(irq, dev);
+		dma_free_coherent(&tp->pci_dev->dev, TX_BUF_TOT_LEN,
+				  tp->tx_bufs, tp->tx_bufs_dma);
+		dma_free_coherent(&tp->pci_dev->dev, RX_BUF_TOT_LEN,
+				  tp->rx_ring, tp->rx_ring_dma);
+		return retval;
+	}
+
 	napi_enable(&tp->napi);
 
 	tp->mii.full_duplex = tp->mii.force_media;
@@ -1452,6 +1505,7 @@ static void rtl8139_init_ring (struct net_device *dev)
 	tp->cur_rx = 0;
 	tp->cur_tx = 0;
 	tp->dirty_tx = 0;
+	netdev_reset_queue(dev);
 
 	for (i = 0; i < NUM_TX_DESC; i++)
 		tp->tx_buf[i] = &tp->tx_bufs[i * TX_BUF_SIZE];
@@ -1647,6 +1701,7 @@ static inline void rtl8139_tx_clear (struct rtl8139_private *tp)
 {
 	tp->cur_tx = 0;
 	tp->dirty_tx = 0;
+	netdev_reset_queue(tp->dev);
 
 	/* XXX account for unsent Tx packets in tp->stats.tx_dropped */
 }
@@ -1736,19 +1791,27 @@ static netdev_tx_t rtl8139_start_xmit (struct sk_buff *skb,
 	}
 
 	spin_lock_irqsave(&tp->lock, flags);
+	tp->tx_len[entry] = len;
 	/*
 	 * Writing to TxStatus triggers a DMA transfer of the data
 	 * copied to tp->tx_buf[entry] above. Use a memory barrier
 	 * to make sure that the device sees the updated data.
 	 */
 	wmb();
-	RTL_W32_F (TxStatus0 + (entry * sizeof (u32)),
-		   tp->tx_flag | max(len, (unsigned int)ETH_ZLEN));
+	RTL_W32 (TxStatus0 + (entry * sizeof (u32)),
+		 tp->tx_flag | max(len, (unsigned int)ETH_ZLEN));
 
 	tp->cur_tx++;
 
 	if ((tp->cur_tx - NUM_TX_DESC) == tp->dirty_tx)
 		netif_stop_queue (dev);
+
+	/* Flush the posted write only at the end of a burst, the read
+	 * flushes the writes for the earlier frames along with it.
+	 */
+	if (__netdev_tx_sent_queue(netdev_get_tx_queue(dev, 0), len,
+				   netdev_xmit_more()))
+		RTL_R32 (TxStatus0 + (entry * sizeof (u32)));
 	spin_unlock_irqrestore(&tp->lock, flags);
 
 	netif_dbg(tp, tx_queued, dev, "Queued Tx packet size %u to slot %d\n",
@@ -1763,6 +1826,7 @@ static void rtl8139_tx_interrupt (struct net_device *dev,
 				  void __iomem *ioaddr)
 {
 	unsigned long dirty_tx, tx_left;
+	unsigned int pkts_compl = 0, bytes_compl = 0;
 
 	assert (dev != NULL);
 	assert (ioaddr != NULL);
@@ -1808,6 +1872,8 @@ static void rtl8139_tx_interrupt (struct net_device *dev,
 			u64_stats_update_end(&tp->tx_stats.syncp);
 		}
 
+		pkts_compl++;
+		bytes_compl += tp->tx_len[entry];
 		dirty_tx++;
 		tx_left--;
 	}
@@ -1824,6 +1890,7 @@ static void rtl8139_tx_interrupt (struct net_device *dev,
 	if (tp->dirty_tx != dirty_tx) {
 		tp->dirty_tx = dirty_tx;
 		mb();
+		netdev_completed_queue(dev, pkts_compl, bytes_compl);
 		netif_wake_queue (dev);
 	}
 }
@@ -1925,6 +1992,166 @@ static inline void wrap_copy(struct sk_buff *skb, const unsigned char *ring,
 }
 #endif
 
+#define RTL8139_XDP_PASS	0
+#define RTL8139_XDP_CONSUMED	BIT(0)
+#define RTL8139_XDP_TX		BIT(1)
+#define RTL8139_XDP_REDIR	BIT(2)
+
+static void rtl8139_copy_frame(void *dst, const unsigned char *ring,
+			       u32 offset, unsigned int size)
+{
+#if RX_BUF_IDX == 3
+	u32 left = RX_BUF_LEN - offset;
+
+	if (size > left) {
+		memcpy(dst, ring + offset, left);
+		memcpy(dst + left, ring, size - left);
+		return;
+	}
+#endif
+	memcpy(dst, ring + offset, size);
+}
+
+/*
+ * Copy a frame out of the Rx ring like rtl8139_copy_frame(), summing
+ * everything behind the Ethernet header on the way.  The result is the
+ * CHECKSUM_COMPLETE value, so the stack needs no second pass over the data.
+ */
+static __wsum rtl8139_copy_frame_csum(void *dst, const unsigned char *ring,
+				      u32 offset, unsigned int size)
+{
+	rtl8139_copy_frame(dst, ring, offset, ETH_HLEN);
+	dst += ETH_HLEN;
+	size -= ETH_HLEN;
+	offset += ETH_HLEN;
+#if RX_BUF_IDX == 3
+	if (offset >= RX_BUF_LEN)
+		offset -= RX_BUF_LEN;
+	if (size > RX_BUF_LEN - offset) {
+		u32 left = RX_BUF_LEN - offset;
+		__wsum csum;
+
+		csum = csum_partial_copy_nocheck(ring + offset, dst, left, 0);
+		return csum_block_add(csum,
+				      csum_partial_copy_nocheck(ring, dst + left,
+								size - left, 0),
+				      left);
+	}
+#endif
+	return csum_partial_copy_nocheck(ring + offset, dst, size, 0);
+}
+
+/*
+ * Queue an XDP_TX frame into the next Tx bounce buffer.  The frame is
+ * copied there just like rtl8139_start_xmit() does, so the Tx queue lock
+ * is taken to serialize against it.
+ */
+static bool rtl8139_xdp_xmit_back(struct rtl8139_private *tp,
+				  struct xdp_buff *xdp)
+{
+	struct net_device *dev = tp->dev;
+	struct netdev_queue *txq = netdev_get_tx_queue(dev, 0);
+	void __iomem *ioaddr = tp->mmio_addr;
+	unsigned int len = xdp->data_end - xdp->data;
+	unsigned int entry;
+	unsigned long flags;
+	bool sent = false;
+
+	if (unlikely(len >= TX_BUF_SIZE))
+		return false;
+
+	__netif_tx_lock(txq, smp_processor_id());
+	if (tp->cur_tx - tp->dirty_tx >= NUM_TX_DESC)
+		goto out;
+
+	entry = tp->cur_tx % NUM_TX_DESC;
+	if (len < ETH_ZLEN)
+		memset(tp->tx_buf[entry], 0, ETH_ZLEN);
+	memcpy(tp->tx_buf[entry], xdp->data, len);
+
+	spin_lock_irqsave(&tp->lock, flags);
+	tp->tx_len[entry] = len;
+	/* See rtl8139_start_xmit() */
+	wmb();
+	RTL_W32_F (TxStatus0 + (entry * sizeof (u32)),
+		   tp->tx_flag | max(len, (unsigned int)ETH_ZLEN));
+
+	tp->cur_tx++;
+
+	if ((tp->cur_tx - NUM_TX_DESC) == tp->dirty_tx)
+		netif_tx_stop_queue(txq);
+	netdev_tx_sent_queue(txq, len);
+	spin_unlock_irqrestore(&tp->lock, flags);
+	sent = true;
+out:
+	__netif_tx_unlock(txq);
+	return sent;
+}
+
+/*
+ * Run @prog on the frame at @offset in the Rx ring.  The ring is reused by
+ * the chip as soon as RxBufPtr moves past the frame, so the frame is copied
+ * into a page first; that page becomes the skb head on XDP_PASS and is
+ * handed over on XDP_REDIRECT, which lets AF_XDP sockets and devmaps take
+ * frames without an skb being built.  Running out of memory returns
+ * RTL8139_XDP_PASS without an skb, which the caller counts as a drop.
+ */
+static u32 rtl8139_run_xdp(struct rtl8139_private *tp, struct bpf_prog *prog,
+			   u32 offset, unsigned int pkt_size,
+			   struct sk_buff **pskb)
+{
+	struct net_device *dev = tp->dev;
+	struct page *page = tp->xdp_page;
+	struct xdp_buff xdp;
+	u32 act;
+
+	*pskb = NULL;
+	if (!page) {
+		page = dev_alloc_page();
+		if (unlikely(!page))
+			return RTL8139_XDP_PASS;
+		tp->xdp_page = page;
+	}
+
+	xdp.data_hard_start = page_address(page);
+	xdp.data = xdp.data_hard_start + XDP_PACKET_HEADROOM;
+	xdp_set_data_meta_invalid(&xdp);
+	xdp.data_end = xdp.data + pkt_size;
+	xdp.rxq = &tp->xdp_rxq;
+	xdp.frame_sz = PAGE_SIZE;
+	rtl8139_copy_frame(xdp.data, tp->rx_ring, offset, pkt_size);
+
+	act = bpf_prog_run_xdp(prog, &xdp);
+	switch (act) {
+	case XDP_PASS:
+		*pskb = build_skb(xdp.data_hard_start, PAGE_SIZE);
+		if (unlikely(!*pskb))
+			return RTL8139_XDP_PASS;
+		tp->xdp_page = NULL;
+		skb_reserve(*pskb, xdp.data - xdp.data_hard_start);
+		skb_put(*pskb, xdp.data_end - xdp.data);
+		return RTL8139_XDP_PASS;
+	case XDP_TX:
+		if (unlikely(!rtl8139_xdp_xmit_back(tp, &xdp)))
+			goto out_failure;
+		return RTL8139_XDP_TX;
+	case XDP_REDIRECT:
+		if (unlikely(xdp_do_redirect(dev, &xdp, prog)))
+			goto out_failure;
+		tp->xdp_page = NULL;
+		return RTL8139_XDP_REDIR;
+	default:
+		bpf_warn_invalid_xdp_action(act);
+		fallthrough;
+	case XDP_ABORTED:
+out_failure:
+		trace_xdp_exception(dev, prog, act);
+		fallthrough;
+	case XDP_DROP:
+		return RTL8139_XDP_CONSUMED;
+	}
+}
+
 static void rtl8139_isr_ack(struct rtl8139_private *tp)
 {
 	void __iomem *ioaddr = tp->mmio_addr;
@@ -1951,6 +2178,8 @@ static int rtl8139_rx(struct net_device *dev, struct rtl8139_private *tp,
 	unsigned char *rx_ring = tp->rx_ring;
 	unsigned int cur_rx = tp->cur_rx;
 	unsigned int rx_size = 0;
+	struct bpf_prog *xdp_prog = READ_ONCE(tp->xdp_prog);
+	u32 xdp_act = 0, xdp_res;
 
 	netdev_dbg(dev, "In %s(), current %04x BufAddr %04x, free to %04x, Cmd %02x\n",
 		   __func__, (u16)cur_rx,
@@ -2036,15 +2265,33 @@ static int rtl8139_rx(struct net_device *dev, struct rtl8139_private *tp,
 		/* Malloc up new buffer, compatible with net-2e. */
 		/* Omit the four octet CRC from the length. */
 
-		skb = napi_alloc_skb(&tp->napi, pkt_size);
-		if (likely(skb)) {
+		if (xdp_prog) {
+			xdp_res = rtl8139_run_xdp(tp, xdp_prog, ring_offset + 4,
+						  pkt_size, &skb);
+			xdp_act |= xdp_res;
+		} else {
+			xdp_res = RTL8139_XDP_PASS;
+			skb = napi_alloc_skb(&tp->napi, pkt_size);
+			if (likely(skb)) {
+				if ((dev->features & NETIF_F_RXCSUM) &&
+				    pkt_size > ETH_HLEN) {
+					skb->csum = rtl8139_copy_frame_csum(skb->data,
+									    rx_ring,
+									    ring_offset + 4,
+									    pkt_size);
+					skb->ip_summed = CHECKSUM_COMPLETE;
+				} else {
 #if RX_BUF_IDX == 3
-			wrap_copy(skb, rx_ring, ring_offset+4, pkt_size);
+					wrap_copy(skb, rx_ring, ring_offset+4, pkt_size);
 #else
-			skb_copy_to_linear_data (skb, &rx_ring[ring_offset + 4], pkt_size);
+					skb_copy_to_linear_data (skb, &rx_ring[ring_offset + 4], pkt_size);
 #endif
-			skb_put (skb, pkt_size);
+				}
+				skb_put (skb, pkt_size);
+			}
+		}
 
+		if (likely(skb)) {
 			skb->protocol = eth_type_trans (skb, dev);
 
 			u64_stats_update_begin(&tp->rx_stats.syncp);
@@ -2052,9 +2299,14 @@ static int rtl8139_rx(struct net_device *dev, struct rtl8139_private *tp,
 			tp->rx_stats.bytes += pkt_size;
 			u64_stats_update_end(&tp->rx_stats.syncp);
 
-			netif_receive_skb (skb);
-		} else {
+			napi_gro_receive(&tp->napi, skb);
+		} else if (xdp_res == RTL8139_XDP_PASS) {
 			dev->stats.rx_dropped++;
+		} else {
+			u64_stats_update_begin(&tp->rx_stats.syncp);
+			tp->rx_stats.packets++;
+			tp->rx_stats.bytes += pkt_size;
+			u64_stats_update_end(&tp->rx_stats.syncp);
 		}
 		received++;
 
@@ -2081,6 +2333,8 @@ static int rtl8139_rx(struct net_device *dev, struct rtl8139_private *tp,
 		received = budget;
 
 out:
+	if (xdp_act & RTL8139_XDP_REDIR)
+		xdp_do_flush();
 	return received;
 }
 
@@ -2127,16 +2381,28 @@ static int rtl8139_poll(struct napi_struct *napi, int budget)
 	struct rtl8139_private *tp = container_of(napi, struct rtl8139_private, napi);
 	struct net_device *dev = tp->dev;
 	void __iomem *ioaddr = tp->mmio_addr;
+	unsigned long flags;
+	u16 status;
 	int work_done;
 
+	ethtool_lat_hist_poll(&tp->napi_lat);
+
 	spin_lock(&tp->rx_lock);
 	work_done = 0;
 	if (likely(RTL_R16(IntrStatus) & RxAckBits))
 		work_done += rtl8139_rx(dev, tp, budget);
 
-	if (work_done < budget) {
-		unsigned long flags;
+	/* Ack Tx events before reaping: those raised meanwhile interrupt
+	 * again once the poll is done, all earlier ones are covered here.
+	 */
+	spin_lock_irqsave(&tp->lock, flags);
+	status = RTL_R16(IntrStatus) & (TxOK | TxErr);
+	if (status)
+		RTL_W16(IntrStatus, status);
+	rtl8139_tx_interrupt(dev, tp, ioaddr);
+	spin_unlock_irqrestore(&tp->lock, flags);
 
+	if (work_done < budget) {
 		spin_lock_irqsave(&tp->lock, flags);
 		if (napi_complete_done(napi, work_done))
 			RTL_W16_F(IntrMask, rtl8139_intr_mask);
@@ -2147,8 +2413,8 @@ static int rtl8139_poll(struct napi_struct *napi, int budget)
 	return work_done;
 }
 
-/* The interrupt handler does all of the Rx thread work and cleans up
-   after the Tx thread. */
+/* The interrupt handler hands Rx and Tx completion work to the poll
+   routine and deals with the uncommon events itself. */
 static irqreturn_t rtl8139_interrupt (int irq, void *dev_instance)
 {
 	struct net_device *dev = (struct net_device *) dev_instance;
@@ -2186,11 +2452,12 @@ static irqreturn_t rtl8139_interrupt (int irq, void *dev_instance)
 	if (ackstat)
 		RTL_W16 (IntrStatus, ackstat);
 
-	/* Receive packets are processed by poll routine.
-	   If not running start it now. */
-	if (status & RxAckBits){
+	/* Receive packets and Tx completions are processed by poll
+	   routine. If not running start it now. */
+	if (status & (RxAckBits | TxOK | TxErr)) {
 		if (napi_schedule_prep(&tp->napi)) {
-			RTL_W16_F (IntrMask, rtl8139_norx_intr_mask);
+			RTL_W16_F (IntrMask, rtl8139_napi_intr_mask);
+			ethtool_lat_hist_irq(&tp->napi_lat);
 			__napi_schedule(&tp->napi);
 		}
 	}
@@ -2199,12 +2466,6 @@ static irqreturn_t rtl8139_interrupt (int irq, void *dev_instance)
 	if (unlikely(status & (PCIErr | PCSTimeout | RxUnderrun | RxErr)))
 		rtl8139_weird_interrupt (dev, tp, ioaddr,
 					 status, link_changed);
-
-	if (status & (TxOK | TxErr)) {
-		rtl8139_tx_interrupt (dev, tp, ioaddr);
-		if (status & TxErr)
-			RTL_W16 (IntrStatus, TxErr);
-	}
  out:
 	spin_unlock (&tp->lock);
 
@@ -2289,6 +2550,12 @@ static int rtl8139_close (struct net_device *dev)
 	tp->rx_ring = NULL;
 	tp->tx_bufs = NULL;
 
+	xdp_rxq_info_unreg(&tp->xdp_rxq);
+	if (tp->xdp_page) {
+		put_page(tp->xdp_page);
+		tp->xdp_page = NULL;
+	}
+
 	/* Green! Put the chip in low-power mode. */
 	RTL_W8 (Cfg9346, Cfg9346_Unlock);
 
@@ -2480,6 +2747,32 @@ static void rtl8139_get_strings(struct net_device *dev, u32 stringset, u8 *data)
 	memcpy(data, ethtool_stats_keys, sizeof(ethtool_stats_keys));
 }
 
+static void rtl8139_get_queue_stats(struct net_device *dev, bool tx,
+				    unsigned int queue,
+				    struct ethtool_queue_stats *qstats)
+{
+	struct rtl8139_private *tp = netdev_priv(dev);
+	struct rtl8139_stats *stats = tx ? &tp->tx_stats : &tp->rx_stats;
+	unsigned int start;
+
+	do {
+		start = u64_stats_fetch_begin_irq(&stats->syncp);
+		qstats->packets = stats->packets;
+		qstats->bytes = stats->bytes;
+	} while (u64_stats_fetch_retry_irq(&stats->syncp, start));
+
+	qstats->drops = tx ? dev->stats.tx_dropped : dev->stats.rx_dropped;
+}
+
+static int rtl8139_get_napi_lat_hist(struct net_device *dev,
+				     unsigned int queue, u64 *buckets)
+{
+	struct rtl8139_private *tp = netdev_priv(dev);
+
+	memcpy(buckets, tp->napi_lat.buckets, sizeof(tp->napi_lat.buckets));
+	return 0;
+}
+
 static const struct ethtool_ops rtl8139_ethtool_ops = {
 	.get_drvinfo		= rtl8139_get_drvinfo,
 	.get_regs_len		= rtl8139_get_regs_len,
@@ -2495,6 +2788,8 @@ static const struct ethtool_ops rtl8139_ethtool_ops = {
 	.get_ethtool_stats	= rtl8139_get_ethtool_stats,
 	.get_link_ksettings	= rtl8139_get_link_ksettings,
 	.set_link_ksettings	= rtl8139_set_link_ksettings,
+	.get_queue_stats	= rtl8139_get_queue_stats,
+	.get_napi_lat_hist	= rtl8139_get_napi_lat_hist,
 };
 
 static int netdev_ioctl(struct net_device *dev, struct ifreq *rq, int cmd)
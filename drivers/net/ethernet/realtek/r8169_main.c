@@ -15,6 +15,7 @@
 #include <linux/etherdevice.h>
 #include <linux/clk.h>
 #include <linux/delay.h>
+#include <linux/dim.h>
 #include <linux/ethtool.h>
 #include <linux/phy.h>
 #include <linux/if_vlan.h>
@@ -620,6 +621,11 @@ struct rtl8169_private {
 	unsigned irq_enabled:1;
 	unsigned supports_gmii:1;
 	unsigned aspm_manageable:1;
+
+	bool rx_dim_enabled;
+	struct dim rx_dim;
+	u16 rx_dim_events;
+
 	dma_addr_t counters_phys_addr;
 	struct rtl8169_counters *counters;
 	struct rtl8169_tc_offsets tc_offset;
@@ -1769,6 +1775,8 @@ static int rtl_get_coalesce(struct net_device *dev, struct ethtool_coalesce *ec)
 	c_fr = FIELD_GET(RTL_COALESCE_RX_FRAMES, intrmit);
 	ec->rx_max_coalesced_frames = (c_us || c_fr) ? c_fr * 4 : 1;
 
+	ec->use_adaptive_rx_coalesce = tp->rx_dim_enabled;
+
 	return 0;
 }
 
@@ -1793,7 +1801,8 @@ static int rtl_coalesce_choose_scale(struct rtl8169_private *tp, u32 usec,
 	return -ERANGE;
 }
 
-static int rtl_set_coalesce(struct net_device *dev, struct ethtool_coalesce *ec)
+static int __rtl_set_coalesce(struct net_device *dev,
+			      struct ethtool_coalesce *ec)
 {
 	struct rtl8169_private *tp = netdev_priv(dev);
 	u32 tx_fr = ec->tx_max_coalesced_frames;
@@ -1859,6 +1868,52 @@ static int rtl_set_coalesce(struct net_device *dev, struct ethtool_coalesce *ec)
 	return 0;
 }
 
+static int rtl_set_coalesce(struct net_device *dev, struct ethtool_coalesce *ec)
+{
+	struct rtl8169_private *tp = netdev_priv(dev);
+	int ret;
+
+	ret = __rtl_set_coalesce(dev, ec);
+	if (ret)
+		return ret;
+
+	/* With adaptive rx coalescing the rx values above are only the
+	 * starting point, net_dim moves them according to the traffic.
+	 */
+	if (ec->use_adaptive_rx_coalesce && !tp->rx_dim_enabled)
+		tp->rx_dim.state = DIM_START_MEASURE;
+	WRITE_ONCE(tp->rx_dim_enabled, !!ec->use_adaptive_rx_coalesce);
+
+	return 0;
+}
+
+static void rtl_rx_dim_work(struct work_struct *work)
+{
+	struct dim *dim = container_of(work, struct dim, work);
+	struct rtl8169_private *tp = container_of(dim, struct rtl8169_private,
+						  rx_dim);
+	struct dim_cq_moder moder;
+	struct ethtool_coalesce ec;
+
+	moder = net_dim_get_rx_moderation(dim->mode, dim->profile_ix);
+
+	/* ethtool changes the coalescing under RTNL as well, but don't wait
+	 * for it: rtl8169_close() cancels this work with RTNL held.
+	 */
+	if (rtnl_trylock()) {
+		if (netif_running(tp->dev) && tp->rx_dim_enabled &&
+		    !rtl_get_coalesce(tp->dev, &ec)) {
+			ec.rx_coalesce_usecs = moder.usec;
+			ec.rx_max_coalesced_frames = min_t(u32, moder.pkts,
+							   RTL_COALESCE_FRAME_MAX);
+			__rtl_set_coalesce(tp->dev, &ec);
+		}
+		rtnl_unlock();
+	}
+
+	dim->state = DIM_START_MEASURE;
+}
+
 static int rtl8169_get_eee(struct net_device *dev, struct ethtool_eee *data)
 {
 	struct rtl8169_private *tp = netdev_priv(dev);
@@ -1887,7 +1942,8 @@ static int rtl8169_set_eee(struct net_device *dev, struct ethtool_eee *data)
 
 static const struct ethtool_ops rtl8169_ethtool_ops = {
 	.supported_coalesce_params = ETHTOOL_COALESCE_USECS |
-				     ETHTOOL_COALESCE_MAX_FRAMES,
+				     ETHTOOL_COALESCE_MAX_FRAMES |
+				     ETHTOOL_COALESCE_USE_ADAPTIVE_RX,
 	.get_drvinfo		= rtl8169_get_drvinfo,
 	.get_regs_len		= rtl8169_get_regs_len,
 	.get_link		= ethtool_op_get_link,
@@ -4560,6 +4616,7 @@ static irqreturn_t rtl8169_interrupt(int irq, void *dev_instance)
 	}
 
 	rtl_irq_disable(tp);
+	tp->rx_dim_events++;
 	napi_schedule_irqoff(&tp->napi);
 out:
 	rtl_ack_events(tp, status);
@@ -4597,6 +4654,14 @@ static int rtl8169_poll(struct napi_struct *napi, int budget)
 	rtl_tx(dev, tp, budget);
 
 	if (work_done < budget) {
+		if (READ_ONCE(tp->rx_dim_enabled)) {
+			struct dim_sample sample;
+
+			dim_update_sample(tp->rx_dim_events,
+					  tp->rx_stats.packets,
+					  tp->rx_stats.bytes, &sample);
+			net_dim(&tp->rx_dim, sample);
+		}
 		napi_complete_done(napi, work_done);
 		rtl_irq_enable(tp);
 	}
@@ -4680,6 +4745,7 @@ static int rtl8169_close(struct net_device *dev)
 	rtl8169_rx_clear(tp);
 
 	cancel_work_sync(&tp->wk.work);
+	cancel_work_sync(&tp->rx_dim.work);
 
 	phy_disconnect(tp->phydev);
 
@@ -5325,6 +5391,8 @@ static int rtl_init_one(struct pci_dev *pdev, const struct pci_device_id *ent)
 	}
 
 	INIT_WORK(&tp->wk.work, rtl_task);
+	INIT_WORK(&tp->rx_dim.work, rtl_rx_dim_work);
+	tp->rx_dim.mode = DIM_CQ_PERIOD_MODE_START_FROM_EQE;
 	u64_stats_init(&tp->rx_stats.syncp);
 	u64_stats_init(&tp->tx_stats.syncp);
 
@@ -935,7 +935,8 @@ static inline struct blk_mq_tags *nvme_queue_tagset(struct nvme_queue *nvmeq)
 	return nvmeq->dev->tagset.tags[nvmeq->qid - 1];
 }
 
-static inline void nvme_handle_cqe(struct nvme_queue *nvmeq, u16 idx)
+static inline void nvme_handle_cqe(struct nvme_queue *nvmeq, u16 idx,
+				   struct list_head *done)
 {
 	struct nvme_completion *cqe = &nvmeq->cqes[idx];
 	struct request *req;
@@ -962,7 +963,7 @@ static inline void nvme_handle_cqe(struct nvme_queue *nvmeq, u16 idx)
 	req = blk_mq_tag_to_rq(nvme_queue_tagset(nvmeq), cqe->command_id);
 	trace_nvme_sq(req, cqe->sq_head, nvmeq->sq_tail);
 	if (!nvme_end_request(req, cqe->status, cqe->result))
-		nvme_pci_complete_rq(req);
+		list_add_tail(&req->queuelist, done);
 }
 
 static inline void nvme_update_cq_head(struct nvme_queue *nvmeq)
@@ -977,8 +978,16 @@ static inline void nvme_update_cq_head(struct nvme_queue *nvmeq)
 	}
 }
 
+/*
+ * Requests completing on this CPU are gathered while the CQ is walked and
+ * only completed once the doorbell has handed the entries back, so the
+ * controller can reuse them while we unmap and end the requests, and the
+ * walk itself stays within the CQ cache lines.
+ */
 static inline int nvme_process_cq(struct nvme_queue *nvmeq)
 {
+	struct request *req, *next;
+	LIST_HEAD(done);
 	int found = 0;
 
 	while (nvme_cqe_pending(nvmeq)) {
@@ -988,12 +997,18 @@ static inline int nvme_process_cq(struct nvme_queue *nvmeq)
 		 * the cqe requires a full read memory barrier
 		 */
 		dma_rmb();
-		nvme_handle_cqe(nvmeq, nvmeq->cq_head);
+		nvme_handle_cqe(nvmeq, nvmeq->cq_head, &done);
 		nvme_update_cq_head(nvmeq);
 	}
 
 	if (found)
 		nvme_ring_cq_doorbell(nvmeq);
+
+	list_for_each_entry_safe(req, next, &done, queuelist) {
+		/* a requeue puts the request on the requeue list */
+		list_del_init(&req->queuelist);
+		nvme_pci_complete_rq(req);
+	}
 	return found;
 }
 
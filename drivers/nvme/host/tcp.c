@@ -30,6 +30,14 @@ static int so_priority;
 module_param(so_priority, int, 0644);
 MODULE_PARM_DESC(so_priority, "nvme tcp socket optimize priority");
 
+/* Run the io_work of a queue on the CPU the NIC steers its receive flow to,
+ * so that the softirq and the PDU processing share the socket's cache lines
+ * rather than bouncing them between two CPUs on every completion.
+ */
+static bool rss_io_cpu;
+module_param(rss_io_cpu, bool, 0644);
+MODULE_PARM_DESC(rss_io_cpu, "run queue io_work on the CPU receiving its flow");
+
 enum nvme_tcp_send_state {
 	NVME_TCP_SEND_CMD_PDU = 0,
 	NVME_TCP_SEND_H2C_PDU,
@@ -1097,6 +1105,14 @@ static int nvme_tcp_try_recv(struct nvme_tcp_queue *queue)
 	read_descriptor_t rd_desc;
 	int consumed;
 
+	/*
+	 * Nothing to read, spare the socket lock. Segments on the backlog are
+	 * processed by whoever owns the socket and end up calling
+	 * nvme_tcp_data_ready(), which requeues us.
+	 */
+	if (skb_queue_empty_lockless(&sk->sk_receive_queue))
+		return 0;
+
 	rd_desc.arg.data = queue;
 	rd_desc.count = 1;
 	lock_sock(sk);
@@ -1364,6 +1380,21 @@ static void nvme_tcp_set_queue_io_cpu(struct nvme_tcp_queue *queue)
 	queue->io_cpu = cpumask_next_wrap(n - 1, cpu_online_mask, -1, false);
 }
 
+/*
+ * Once the connection is up the receive softirq has run at least for the
+ * ICResp, so sk_incoming_cpu tells where RSS places this flow.
+ */
+static void nvme_tcp_set_queue_rss_cpu(struct nvme_tcp_queue *queue)
+{
+	int cpu = READ_ONCE(queue->sock->sk->sk_incoming_cpu);
+
+	if (!rss_io_cpu || nvme_tcp_poll_queue(queue))
+		return;
+
+	if (cpu >= 0 && cpu < nr_cpu_ids && cpu_online(cpu))
+		queue->io_cpu = cpu;
+}
+
 static int nvme_tcp_alloc_queue(struct nvme_ctrl *nctrl,
 		int qid, size_t queue_size)
 {
@@ -1469,6 +1500,8 @@ static int nvme_tcp_alloc_queue(struct nvme_ctrl *nctrl,
 	if (ret)
 		goto err_init_connect;
 
+	nvme_tcp_set_queue_rss_cpu(queue);
+
 	queue->rd_enabled = true;
 	set_bit(NVME_TCP_Q_ALLOCATED, &queue->flags);
 	nvme_tcp_init_recv_ctx(queue);
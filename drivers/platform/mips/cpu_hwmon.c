@@ -1,10 +1,14 @@
 // SPDX-License-Identifier: GPL-2.0-only
+#include <linux/cpu_cooling.h>
+#include <linux/cpufreq.h>
 #include <linux/err.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
 #include <linux/reboot.h>
 #include <linux/jiffies.h>
 #include <linux/hwmon.h>
 #include <linux/hwmon-sysfs.h>
+#include <linux/thermal.h>
 
 #include <loongson.h>
 #include <boot_param.h>
@@ -140,6 +144,7 @@ static void remove_sysfs_cputemp_files(struct kobject *kobj)
 }
 
 #define CPU_THERMAL_THRESHOLD 90000
+#define CPU_THERMAL_PASSIVE 80000
 static struct delayed_work thermal_work;
 
 static void do_thermal_timer(struct work_struct *work)
@@ -157,6 +162,235 @@ static void do_thermal_timer(struct work_struct *work)
 	schedule_delayed_work(&thermal_work, msecs_to_jiffies(5000));
 }
 
+/*
+ * Each package is also a thermal zone, throttled through the cpufreq
+ * cooling device of its policy from CPU_THERMAL_PASSIVE on and shut down
+ * by the thermal core at CPU_THERMAL_THRESHOLD.  The fixed shutdown timer
+ * above is only used if the zones cannot be registered.  Policies may come
+ * and go after probe, so the cooling devices follow the cpufreq policy
+ * notifications, under cpu_thermal_lock.
+ */
+enum {
+	CPU_TRIP_PASSIVE,
+	CPU_TRIP_CRITICAL,
+	CPU_TRIP_NUM,
+};
+
+struct cpu_thermal {
+	struct thermal_zone_device *tz;
+	struct thermal_cooling_device *cdev;
+	int package;
+	int cpu;
+};
+
+static struct cpu_thermal cpu_thermal[4];
+static DEFINE_MUTEX(cpu_thermal_lock);
+
+static int cpu_thermal_get_temp(struct thermal_zone_device *tz, int *temp)
+{
+	struct cpu_thermal *ct = tz->devdata;
+
+	*temp = loongson3_cpu_temp(ct->package);
+	return 0;
+}
+
+static int cpu_thermal_get_trip_type(struct thermal_zone_device *tz, int trip,
+				     enum thermal_trip_type *type)
+{
+	*type = trip == CPU_TRIP_PASSIVE ? THERMAL_TRIP_PASSIVE :
+					   THERMAL_TRIP_CRITICAL;
+	return 0;
+}
+
+static int cpu_thermal_get_trip_temp(struct thermal_zone_device *tz, int trip,
+				     int *temp)
+{
+	*temp = trip == CPU_TRIP_PASSIVE ? CPU_THERMAL_PASSIVE :
+					   CPU_THERMAL_THRESHOLD;
+	return 0;
+}
+
+static int cpu_thermal_get_crit_temp(struct thermal_zone_device *tz,
+				     int *temp)
+{
+	*temp = CPU_THERMAL_THRESHOLD;
+	return 0;
+}
+
+static int cpu_thermal_bind(struct thermal_zone_device *tz,
+			    struct thermal_cooling_device *cdev)
+{
+	struct cpu_thermal *ct = tz->devdata;
+
+	if (cdev != ct->cdev)
+		return 0;
+
+	return thermal_zone_bind_cooling_device(tz, CPU_TRIP_PASSIVE, cdev,
+						THERMAL_NO_LIMIT,
+						THERMAL_NO_LIMIT,
+						THERMAL_WEIGHT_DEFAULT);
+}
+
+static int cpu_thermal_unbind(struct thermal_zone_device *tz,
+			      struct thermal_cooling_device *cdev)
+{
+	struct cpu_thermal *ct = tz->devdata;
+
+	if (cdev != ct->cdev)
+		return 0;
+
+	return thermal_zone_unbind_cooling_device(tz, CPU_TRIP_PASSIVE, cdev);
+}
+
+static struct thermal_zone_device_ops cpu_thermal_ops = {
+	.bind = cpu_thermal_bind,
+	.unbind = cpu_thermal_unbind,
+	.get_temp = cpu_thermal_get_temp,
+	.get_trip_type = cpu_thermal_get_trip_type,
+	.get_trip_temp = cpu_thermal_get_trip_temp,
+	.get_crit_temp = cpu_thermal_get_crit_temp,
+};
+
+/* Called with cpu_thermal_lock held */
+static void cpu_thermal_add_cdev(struct cpu_thermal *ct,
+				 struct cpufreq_policy *policy)
+{
+	struct thermal_cooling_device *cdev;
+
+	if (ct->cdev || !ct->tz)
+		return;
+
+	cdev = cpufreq_cooling_register(policy);
+	if (IS_ERR(cdev))
+		return;
+
+	/*
+	 * The zone was registered first, and the bind op only knows the
+	 * device once ct->cdev is set, so bind it here.
+	 */
+	ct->cdev = cdev;
+	if (thermal_zone_bind_cooling_device(ct->tz, CPU_TRIP_PASSIVE, cdev,
+					     THERMAL_NO_LIMIT,
+					     THERMAL_NO_LIMIT,
+					     THERMAL_WEIGHT_DEFAULT)) {
+		cpufreq_cooling_unregister(cdev);
+		ct->cdev = NULL;
+	}
+}
+
+/* Called with cpu_thermal_lock held */
+static void cpu_thermal_remove_cdev(struct cpu_thermal *ct)
+{
+	if (!ct->cdev)
+		return;
+
+	/* the unbind op needs ct->cdev while the device goes away */
+	cpufreq_cooling_unregister(ct->cdev);
+	ct->cdev = NULL;
+}
+
+static int cpu_thermal_policy_notify(struct notifier_block *nb,
+				     unsigned long event, void *data)
+{
+	struct cpufreq_policy *policy = data;
+	int i;
+
+	mutex_lock(&cpu_thermal_lock);
+	for (i = 0; i < nr_packages; i++) {
+		struct cpu_thermal *ct = &cpu_thermal[i];
+
+		if (!cpumask_test_cpu(ct->cpu, policy->related_cpus))
+			continue;
+
+		if (event == CPUFREQ_CREATE_POLICY)
+			cpu_thermal_add_cdev(ct, policy);
+		else if (event == CPUFREQ_REMOVE_POLICY)
+			cpu_thermal_remove_cdev(ct);
+	}
+	mutex_unlock(&cpu_thermal_lock);
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block cpu_thermal_policy_nb = {
+	.notifier_call = cpu_thermal_policy_notify,
+};
+
+static void remove_cpu_thermal_zones(void)
+{
+	int i;
+
+	cpufreq_unregister_notifier(&cpu_thermal_policy_nb,
+				    CPUFREQ_POLICY_NOTIFIER);
+
+	mutex_lock(&cpu_thermal_lock);
+	for (i = 0; i < nr_packages; i++) {
+		struct cpu_thermal *ct = &cpu_thermal[i];
+
+		cpu_thermal_remove_cdev(ct);
+		if (ct->tz)
+			thermal_zone_device_unregister(ct->tz);
+		ct->tz = NULL;
+	}
+	mutex_unlock(&cpu_thermal_lock);
+}
+
+static int create_cpu_thermal_zones(void)
+{
+	struct cpufreq_policy *policy;
+	struct thermal_zone_device *tz;
+	struct cpu_thermal *ct;
+	int i, ret;
+
+	for (i = 0; i < nr_packages; i++) {
+		ct = &cpu_thermal[i];
+		ct->package = i;
+		ct->cpu = i * loongson_sysconf.cores_per_package;
+
+		tz = thermal_zone_device_register("loongson3-cpu",
+						  CPU_TRIP_NUM, 0, ct,
+						  &cpu_thermal_ops, NULL,
+						  1000, 5000);
+		if (IS_ERR(tz)) {
+			ret = PTR_ERR(tz);
+			goto fail;
+		}
+		ct->tz = tz;
+
+		ret = thermal_zone_device_enable(tz);
+		if (ret)
+			goto fail;
+	}
+
+	/*
+	 * Packages whose policy shows up later get their cooling device
+	 * from the notifier, the ones that already have one get it here.
+	 * A package without a policy still gets its critical trip.
+	 */
+	ret = cpufreq_register_notifier(&cpu_thermal_policy_nb,
+					CPUFREQ_POLICY_NOTIFIER);
+	if (ret)
+		goto fail;
+
+	mutex_lock(&cpu_thermal_lock);
+	for (i = 0; i < nr_packages; i++) {
+		ct = &cpu_thermal[i];
+
+		policy = cpufreq_cpu_get(ct->cpu);
+		if (policy) {
+			cpu_thermal_add_cdev(ct, policy);
+			cpufreq_cpu_put(policy);
+		}
+	}
+	mutex_unlock(&cpu_thermal_lock);
+
+	return 0;
+
+fail:
+	remove_cpu_thermal_zones();
+	return ret;
+}
+
 static int __init loongson_hwmon_init(void)
 {
 	int ret;
@@ -184,7 +418,8 @@ static int __init loongson_hwmon_init(void)
 	}
 
 	INIT_DEFERRABLE_WORK(&thermal_work, do_thermal_timer);
-	schedule_delayed_work(&thermal_work, msecs_to_jiffies(20000));
+	if (create_cpu_thermal_zones())
+		schedule_delayed_work(&thermal_work, msecs_to_jiffies(20000));
 
 	return ret;
 
@@ -200,6 +435,7 @@ static int __init loongson_hwmon_init(void)
 static void __exit loongson_hwmon_exit(void)
 {
 	cancel_delayed_work_sync(&thermal_work);
+	remove_cpu_thermal_zones();
 	remove_sysfs_cputemp_files(&cpu_hwmon_dev->kobj);
 	sysfs_remove_group(&cpu_hwmon_dev->kobj,
 				&cpu_hwmon_attribute_group);
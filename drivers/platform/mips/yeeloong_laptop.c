@@ -33,6 +33,13 @@
 #define ON	1
 #define OFF	0
 
+/*
+ * The battery and thermal registers change slowly, but upower and
+ * sensors applets read each of them several times a second.  Serve
+ * those from the EC cache; the AC/battery SCI event drops it.
+ */
+#define EC_CACHE_AGE	HZ
+
 /* backlight subdriver */
 #define MAX_BRIGHTNESS	8
 
@@ -149,17 +156,18 @@ static const struct power_supply_desc yeeloong_ac_desc = {
 #define BAT_CAP_HIGH     95
 
 #define get_bat_info(type) \
-	((ec_read(REG_BAT_##type##_HIGH) << 8) | \
-	 (ec_read(REG_BAT_##type##_LOW)))
+	((ec_read_cached(REG_BAT_##type##_HIGH, EC_CACHE_AGE) << 8) | \
+	 (ec_read_cached(REG_BAT_##type##_LOW, EC_CACHE_AGE)))
 
 static inline bool is_bat_in(void)
 {
-	return !!(ec_read(REG_BAT_STATUS) & BIT_BAT_STATUS_IN);
+	return !!(ec_read_cached(REG_BAT_STATUS, EC_CACHE_AGE) &
+		  BIT_BAT_STATUS_IN);
 }
 
 static inline int get_bat_status(void)
 {
-	return ec_read(REG_BAT_STATUS);
+	return ec_read_cached(REG_BAT_STATUS, EC_CACHE_AGE);
 }
 
 static int get_battery_temp(void)
@@ -436,8 +444,8 @@ static int get_fan_rpm(void)
 	int value;
 
 	value = FAN_SPEED_DIVIDER /
-	    (((ec_read(REG_FAN_SPEED_HIGH) & 0x0f) << 8) |
-	     ec_read(REG_FAN_SPEED_LOW));
+	    (((ec_read_cached(REG_FAN_SPEED_HIGH, EC_CACHE_AGE) & 0x0f) << 8) |
+	     ec_read_cached(REG_FAN_SPEED_LOW, EC_CACHE_AGE));
 
 	return value;
 }
@@ -446,7 +454,7 @@ static int get_cpu_temp(void)
 {
 	s8 value;
 
-	value = ec_read(REG_TEMPERATURE_VALUE);
+	value = ec_read_cached(REG_TEMPERATURE_VALUE, EC_CACHE_AGE);
 
 	return value * 1000;
 }
@@ -764,6 +772,7 @@ static int usb0_handler(int status)
 
 static int ac_bat_handler(int status)
 {
+	ec_cache_invalidate();
 	if (ac_bat_initialized) {
 		power_supply_changed(yeeloong_ac);
 		power_supply_changed(yeeloong_bat);
@@ -851,17 +860,13 @@ static void do_event_action(int event)
  */
 static irqreturn_t sci_irq_handler(int irq, void *dev_id)
 {
-	int ret, event;
+	int event;
 
 	if (irq != SCI_IRQ_NUM)
 		return IRQ_NONE;
 
-	/* Query the event number */
-	ret = ec_query_event_num();
-	if (ret < 0)
-		return IRQ_NONE;
-
-	event = ec_get_event_num();
+	/* Query the event number, sleeping while the EC answers */
+	event = ec_query_event();
 	if (event < EVENT_START || event > EVENT_END)
 		return IRQ_NONE;
 
@@ -891,7 +896,7 @@ static int sci_irq_init(void)
 		return ret;
 
 	/* For filtering next number interrupt */
-	mdelay(10000);
+	msleep(10000);
 
 	/* Set gpio native registers and msrs for GPIO27 SCI EVENT PIN
 	 * gpio :
@@ -1012,13 +1017,24 @@ static void yeeloong_hotkey_exit(void)
 }
 
 #ifdef CONFIG_PM
+static struct ec_request usb_port_reqs[] = {
+	{ .addr = REG_USB0_FLAG, .write = true },
+	{ .addr = REG_USB1_FLAG, .write = true },
+	{ .addr = REG_USB2_FLAG, .write = true },
+};
+
+/* Queue the port switches as one EC batch, see ec_submit() */
 static void usb_ports_set(int status)
 {
-	status = !!status;
+	int i;
 
-	ec_write(REG_USB0_FLAG, status);
-	ec_write(REG_USB1_FLAG, status);
-	ec_write(REG_USB2_FLAG, status);
+	/* the requests may still be queued from the last call */
+	ec_flush();
+
+	for (i = 0; i < ARRAY_SIZE(usb_port_reqs); i++) {
+		usb_port_reqs[i].val = !!status;
+		ec_submit(&usb_port_reqs[i]);
+	}
 }
 
 static int yeeloong_suspend(struct device *dev)
@@ -1029,6 +1045,7 @@ static int yeeloong_suspend(struct device *dev)
 	display_vo_set(CRT, OFF);
 	usb_ports_set(OFF);
 	wlan_set(OFF);
+	ec_flush();
 
 	return 0;
 }
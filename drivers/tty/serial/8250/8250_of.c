@@ -21,6 +21,7 @@
 struct of_serial_info {
 	struct clk *clk;
 	struct reset_control *rst;
+	struct uart_8250_dma dma;
 	int type;
 	int line;
 };
@@ -225,6 +226,17 @@ static int of_platform_serial_probe(struct platform_device *ofdev)
 			&port8250.overrun_backoff_time_ms) != 0)
 		port8250.overrun_backoff_time_ms = 0;
 
+	/*
+	 * Use the generic 8250 DMA support only when the node asks for it:
+	 * "dmas" alone is also found on UARTs whose DMA handshake the
+	 * generic code doesn't drive. Startup falls back to PIO if the
+	 * channels can't be requested.
+	 */
+	if (IS_ENABLED(CONFIG_SERIAL_8250_DMA) &&
+	    of_property_read_bool(ofdev->dev.of_node, "use-dma") &&
+	    of_property_read_bool(ofdev->dev.of_node, "dmas"))
+		port8250.dma = &info->dma;
+
 	ret = serial8250_register_8250_port(&port8250);
 	if (ret < 0)
 		goto err_dispose;
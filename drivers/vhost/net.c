@@ -40,6 +40,11 @@ module_param(experimental_zcopytx, int, 0444);
 MODULE_PARM_DESC(experimental_zcopytx, "Enable Zero Copy TX;"
 		                       " 1 -Enable; 0 - Disable");
 
+static bool adaptive_busyloop;
+module_param(adaptive_busyloop, bool, 0644);
+MODULE_PARM_DESC(adaptive_busyloop, "Tune the busy polling time from observed "
+		 "arrival gaps, up to the configured busyloop timeout");
+
 /* Max number of bytes transferred before requeueing the job.
  * Using this limit prevents one virtqueue from starving others. */
 #define VHOST_NET_WEIGHT 0x80000
@@ -77,7 +82,8 @@ enum {
 };
 
 enum {
-	VHOST_NET_BACKEND_FEATURES = (1ULL << VHOST_BACKEND_F_IOTLB_MSG_V2)
+	VHOST_NET_BACKEND_FEATURES = (1ULL << VHOST_BACKEND_F_IOTLB_MSG_V2) |
+				     (1ULL << VHOST_BACKEND_F_IOTLB_BATCH)
 };
 
 enum {
@@ -126,6 +132,12 @@ struct vhost_net_virtqueue {
 	struct vhost_net_buf rxq;
 	/* Batched XDP buffs */
 	struct xdp_buff *xdp;
+	/* Adaptive busy polling: current poll time, average arrival gap and
+	 * time of the last arrival seen by a poll, in busy_clock() units.
+	 * Protected by vq mutex. */
+	unsigned long busyloop_cur;
+	unsigned long busyloop_gap;
+	unsigned long busyloop_last;
 };
 
 struct vhost_net {
@@ -418,6 +430,50 @@ static bool vhost_can_busy_poll(unsigned long endtime)
 		      !signal_pending(current));
 }
 
+/*
+ * Each arrival a poll sees is timestamped; the time since the previous one
+ * is the gap at which the peer produces work, so poll for twice the average
+ * gap. A poll that runs out burns the CPU for nothing, so poll a quarter
+ * less next time, and don't measure a gap across it. The configured timeout
+ * is the upper bound, 1/32 of it the lower one so that shorter gaps can
+ * still be noticed.
+ */
+static unsigned long vhost_net_busyloop_timeout(struct vhost_net_virtqueue *nvq)
+{
+	unsigned long limit = nvq->vq.busyloop_timeout;
+
+	if (!adaptive_busyloop)
+		return limit;
+
+	if (!nvq->busyloop_cur || nvq->busyloop_cur > limit)
+		nvq->busyloop_cur = limit;
+	return nvq->busyloop_cur;
+}
+
+static void vhost_net_busyloop_update(struct vhost_net_virtqueue *nvq,
+				      bool hit, unsigned long now)
+{
+	unsigned long limit = nvq->vq.busyloop_timeout;
+	unsigned long floor = max(limit / 32, 1UL);
+	unsigned long last = nvq->busyloop_last;
+
+	if (!adaptive_busyloop)
+		return;
+
+	if (!hit) {
+		nvq->busyloop_last = 0;
+		nvq->busyloop_cur = max(nvq->busyloop_cur -
+					nvq->busyloop_cur / 4, floor);
+		return;
+	}
+
+	nvq->busyloop_last = now;
+	if (!last)
+		return;
+	nvq->busyloop_gap = (3 * nvq->busyloop_gap + (now - last)) / 4;
+	nvq->busyloop_cur = clamp(2 * nvq->busyloop_gap, floor, limit);
+}
+
 static void vhost_net_disable_vq(struct vhost_net *n,
 				 struct vhost_virtqueue *vq)
 {
@@ -511,10 +567,13 @@ static void vhost_net_busy_poll(struct vhost_net *net,
 				bool *busyloop_intr,
 				bool poll_rx)
 {
+	struct vhost_net_virtqueue *nvq =
+		container_of(poll_rx ? rvq : tvq, struct vhost_net_virtqueue, vq);
 	unsigned long busyloop_timeout;
-	unsigned long endtime;
+	unsigned long endtime, now;
 	struct socket *sock;
 	struct vhost_virtqueue *vq = poll_rx ? tvq : rvq;
+	bool hit = false;
 
 	/* Try to hold the vq mutex of the paired virtqueue. We can't
 	 * use mutex_lock() here since we could not guarantee a
@@ -526,8 +585,7 @@ static void vhost_net_busy_poll(struct vhost_net *net,
 	vhost_disable_notify(&net->dev, vq);
 	sock = vhost_vq_get_backend(rvq);
 
-	busyloop_timeout = poll_rx ? rvq->busyloop_timeout:
-				     tvq->busyloop_timeout;
+	busyloop_timeout = vhost_net_busyloop_timeout(nvq);
 
 	preempt_disable();
 	endtime = busy_clock() + busyloop_timeout;
@@ -540,12 +598,19 @@ static void vhost_net_busy_poll(struct vhost_net *net,
 
 		if ((sock_has_rx_data(sock) &&
 		     !vhost_vq_avail_empty(&net->dev, rvq)) ||
-		    !vhost_vq_avail_empty(&net->dev, tvq))
+		    !vhost_vq_avail_empty(&net->dev, tvq)) {
+			hit = true;
 			break;
+		}
 
 		cpu_relax();
 	}
 
+	/* Polls cut short by other work or rescheduling tell us nothing */
+	now = busy_clock();
+	if (hit || time_after(now, endtime))
+		vhost_net_busyloop_update(nvq, hit, now);
+
 	preempt_enable();
 
 	if (poll_rx || sock_has_rx_data(sock))
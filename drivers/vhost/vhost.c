@@ -288,6 +288,9 @@ static void __vhost_vq_meta_reset(struct vhost_virtqueue *vq)
 
 	for (j = 0; j < VHOST_NUM_ADDRS; j++)
 		vq->meta_iotlb[j] = NULL;
+	for (j = 0; j < VHOST_IOTLB_CACHE_SIZE; j++)
+		vq->iotlb_cache[j] = NULL;
+	vq->iotlb_cache_next = 0;
 }
 
 static void vhost_vq_meta_reset(struct vhost_dev *d)
@@ -487,6 +490,7 @@ void vhost_dev_init(struct vhost_dev *dev,
 	INIT_LIST_HEAD(&dev->read_list);
 	INIT_LIST_HEAD(&dev->pending_list);
 	spin_lock_init(&dev->iotlb_lock);
+	dev->iotlb_batch = false;
 
 
 	for (i = 0; i < dev->nvqs; ++i) {
@@ -706,6 +710,8 @@ void vhost_dev_cleanup(struct vhost_dev *dev)
 	vhost_iotlb_free(dev->iotlb);
 	dev->iotlb = NULL;
 	vhost_clear_msg(dev);
+	/* vhost_dev_reset_owner() goes through here too */
+	dev->iotlb_batch = false;
 	wake_up_interruptible_poll(&dev->wait, EPOLLIN | EPOLLRDNORM);
 	WARN_ON(!llist_empty(&dev->work_list));
 	if (dev->worker) {
@@ -1062,6 +1068,28 @@ static void vhost_iotlb_notify_vq(struct vhost_dev *d,
 	spin_unlock(&d->iotlb_lock);
 }
 
+/*
+ * Kick the virtqueues of all misses pending when a batch ends. Misses the
+ * batch didn't resolve are dropped as well, so that the retry reports them
+ * again instead of waiting for an answer that isn't coming.
+ */
+static void vhost_iotlb_notify_batch(struct vhost_dev *d)
+{
+	struct vhost_msg_node *node, *n;
+
+	spin_lock(&d->iotlb_lock);
+
+	list_for_each_entry_safe(node, n, &d->pending_list, node) {
+		if (node->msg.iotlb.type == VHOST_IOTLB_MISS) {
+			vhost_poll_queue(&node->vq->poll);
+			list_del(&node->node);
+			kfree(node);
+		}
+	}
+
+	spin_unlock(&d->iotlb_lock);
+}
+
 static bool umem_access_ok(u64 uaddr, u64 size, int access)
 {
 	unsigned long a = uaddr;
@@ -1103,7 +1131,14 @@ static int vhost_process_iotlb_msg(struct vhost_dev *dev,
 			ret = -ENOMEM;
 			break;
 		}
-		vhost_iotlb_notify_vq(dev, msg);
+		/*
+		 * Inside a batch the vqs are kicked once, at the end. A batch
+		 * that is never ended must not stall them for good, though.
+		 */
+		if (!dev->iotlb_batch ||
+		    time_after(jiffies, dev->iotlb_batch_start +
+				       VHOST_IOTLB_MISS_TIMEOUT))
+			vhost_iotlb_notify_vq(dev, msg);
 		break;
 	case VHOST_IOTLB_INVALIDATE:
 		if (!dev->iotlb) {
@@ -1114,6 +1149,15 @@ static int vhost_process_iotlb_msg(struct vhost_dev *dev,
 		vhost_iotlb_del_range(dev->iotlb, msg->iova,
 				      msg->iova + msg->size - 1);
 		break;
+	case VHOST_IOTLB_BATCH_BEGIN:
+		dev->iotlb_batch = true;
+		dev->iotlb_batch_start = jiffies;
+		break;
+	case VHOST_IOTLB_BATCH_END:
+		if (dev->iotlb_batch && dev->iotlb)
+			vhost_iotlb_notify_batch(dev);
+		dev->iotlb_batch = false;
+		break;
 	default:
 		ret = -EINVAL;
 		break;
@@ -1250,6 +1294,7 @@ ssize_t vhost_chr_read_iter(struct vhost_dev *dev, struct iov_iter *to,
 			kfree(node);
 			return ret;
 		}
+		node->read_time = jiffies;
 		vhost_enqueue_msg(dev, &dev->pending_list, node);
 	}
 
@@ -1257,6 +1302,46 @@ ssize_t vhost_chr_read_iter(struct vhost_dev *dev, struct iov_iter *to,
 }
 EXPORT_SYMBOL_GPL(vhost_chr_read_iter);
 
+/*
+ * A miss that was reported and not answered yet is resolved by the same
+ * update, so don't make userspace look up the same address again. A miss
+ * userspace read but left unanswered for too long is dropped and reported
+ * anew.
+ */
+static bool vhost_iotlb_miss_queued(struct vhost_virtqueue *vq, u64 iova,
+				    int access)
+{
+	struct vhost_dev *dev = vq->dev;
+	struct list_head *lists[] = { &dev->read_list, &dev->pending_list };
+	struct vhost_msg_node *node, *n;
+	bool found = false;
+	int i;
+
+	spin_lock(&dev->iotlb_lock);
+	for (i = 0; i < ARRAY_SIZE(lists) && !found; i++) {
+		list_for_each_entry_safe(node, n, lists[i], node) {
+			struct vhost_iotlb_msg *msg = &node->msg.iotlb;
+
+			if (node->vq != vq || msg->type != VHOST_IOTLB_MISS ||
+			    msg->iova != iova || msg->perm != access)
+				continue;
+
+			if (lists[i] == &dev->pending_list &&
+			    time_after(jiffies, node->read_time +
+					       VHOST_IOTLB_MISS_TIMEOUT)) {
+				list_del(&node->node);
+				kfree(node);
+				break;
+			}
+			found = true;
+			break;
+		}
+	}
+	spin_unlock(&dev->iotlb_lock);
+
+	return found;
+}
+
 static int vhost_iotlb_miss(struct vhost_virtqueue *vq, u64 iova, int access)
 {
 	struct vhost_dev *dev = vq->dev;
@@ -1264,6 +1349,9 @@ static int vhost_iotlb_miss(struct vhost_virtqueue *vq, u64 iova, int access)
 	struct vhost_iotlb_msg *msg;
 	bool v2 = vhost_backend_has_feature(vq, VHOST_BACKEND_F_IOTLB_MSG_V2);
 
+	if (vhost_iotlb_miss_queued(vq, iova, access))
+		return 0;
+
 	node = vhost_new_msg(vq, v2 ? VHOST_IOTLB_MSG_V2 : VHOST_IOTLB_MSG);
 	if (!node)
 		return -ENOMEM;
@@ -1445,6 +1533,7 @@ static long vhost_set_memory(struct vhost_dev *d, struct vhost_memory __user *m)
 	for (i = 0; i < d->nvqs; ++i) {
 		mutex_lock(&d->vqs[i]->mutex);
 		d->vqs[i]->umem = newumem;
+		__vhost_vq_meta_reset(d->vqs[i]);
 		mutex_unlock(&d->vqs[i]->mutex);
 	}
 
@@ -2012,6 +2101,29 @@ int vhost_vq_init_access(struct vhost_virtqueue *vq)
 }
 EXPORT_SYMBOL_GPL(vhost_vq_init_access);
 
+static const struct vhost_iotlb_map *
+vhost_iotlb_cache_lookup(struct vhost_virtqueue *vq, struct vhost_iotlb *umem,
+			 u64 addr, u64 last)
+{
+	const struct vhost_iotlb_map *map;
+	int i;
+
+	for (i = 0; i < VHOST_IOTLB_CACHE_SIZE; i++) {
+		map = vq->iotlb_cache[i];
+		if (map && map->start <= addr && map->last >= addr)
+			return map;
+	}
+
+	map = vhost_iotlb_itree_first(umem, addr, last);
+	if (map && map->start <= addr) {
+		vq->iotlb_cache[vq->iotlb_cache_next] = map;
+		vq->iotlb_cache_next = (vq->iotlb_cache_next + 1) %
+				       VHOST_IOTLB_CACHE_SIZE;
+	}
+
+	return map;
+}
+
 static int translate_desc(struct vhost_virtqueue *vq, u64 addr, u32 len,
 			  struct iovec iov[], int iov_size, int access)
 {
@@ -2029,7 +2141,7 @@ static int translate_desc(struct vhost_virtqueue *vq, u64 addr, u32 len,
 			break;
 		}
 
-		map = vhost_iotlb_itree_first(umem, addr, addr + len - 1);
+		map = vhost_iotlb_cache_lookup(vq, umem, addr, addr + len - 1);
 		if (map == NULL || map->start > addr) {
 			if (umem != dev->iotlb) {
 				ret = -EFAULT;
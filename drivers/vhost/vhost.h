@@ -67,6 +67,10 @@ struct vhost_vring_call {
 	spinlock_t ctx_lock;
 };
 
+#define VHOST_IOTLB_CACHE_SIZE 4
+/* How long a reported IOTLB miss or an open batch may hold up a vq */
+#define VHOST_IOTLB_MISS_TIMEOUT HZ
+
 /* The virtqueue structure describes a queue attached to a device. */
 struct vhost_virtqueue {
 	struct vhost_dev *dev;
@@ -78,6 +82,9 @@ struct vhost_virtqueue {
 	vring_avail_t __user *avail;
 	vring_used_t __user *used;
 	const struct vhost_iotlb_map *meta_iotlb[VHOST_NUM_ADDRS];
+	/* Recently used translations for descriptor buffers */
+	const struct vhost_iotlb_map *iotlb_cache[VHOST_IOTLB_CACHE_SIZE];
+	unsigned int iotlb_cache_next;
 	struct file *kick;
 	struct vhost_vring_call call_ctx;
 	struct eventfd_ctx *error_ctx;
@@ -141,6 +148,8 @@ struct vhost_msg_node {
   };
   struct vhost_virtqueue *vq;
   struct list_head node;
+  /* jiffies when userspace read the miss */
+  unsigned long read_time;
 };
 
 struct vhost_dev {
@@ -156,6 +165,8 @@ struct vhost_dev {
 	spinlock_t iotlb_lock;
 	struct list_head read_list;
 	struct list_head pending_list;
+	bool iotlb_batch;
+	unsigned long iotlb_batch_start;
 	wait_queue_head_t wait;
 	int iov_limit;
 	int weight;
@@ -28,6 +28,41 @@ extern void __iomem *smtc_regbaseaddress;
 
 #define smtc_mmiorb(reg)	readb(smtc_regbaseaddress + reg)
 
+/* Drawing engine (DPR) registers, relative to dp_regs */
+#define DPR_SRC_COORDS		0x00
+#define DPR_DST_COORDS		0x04
+#define DPR_SPAN_COORDS		0x08
+#define DPR_DE_CTRL		0x0c
+#define DPR_PITCH		0x10
+#define DPR_FG_COLOR		0x14
+#define DPR_BG_COLOR		0x18
+#define DPR_DATA_FORMAT		0x1c
+#define DPR_COLOR_COMPARE	0x20
+#define DPR_COLOR_COMPARE_MASK	0x24
+#define DPR_BYTE_BIT_MASK	0x28
+#define DPR_CROP_TOPLEFT_COORDS	0x2c
+#define DPR_CROP_BOTRIGHT_COORDS 0x30
+#define DPR_MONO_PATTERN_LO32	0x34
+#define DPR_MONO_PATTERN_HI32	0x38
+#define DPR_SRC_WINDOW		0x3c
+#define DPR_SRC_BASE		0x40
+#define DPR_DST_BASE		0x44
+
+#define DE_CTRL_START		0x80000000
+#define DE_CTRL_RTOL		0x08000000
+#define DE_CTRL_COMMAND_BITBLT	0x00000000
+#define DE_CTRL_ROP_SRC		0x000000cc	/* copy source */
+#define DE_CTRL_ROP_PAT		0x000000f0	/* copy pattern */
+#define DE_CTRL_ROP_PAT_XOR	0x0000005a	/* pattern xor destination */
+
+#define DE_DATA_FORMAT_8BPP	0x00000000
+#define DE_DATA_FORMAT_16BPP	0x00100000
+#define DE_DATA_FORMAT_32BPP	0x00200000
+
+/* SR16: drawing engine status */
+#define SR16_DE_FIFO_EMPTY	0x10
+#define SR16_DE_BUSY		0x08
+
 #define SIZE_SR00_SR04      (0x04 - 0x00 + 1)
 #define SIZE_SR10_SR24      (0x24 - 0x10 + 1)
 #define SIZE_SR30_SR75      (0x75 - 0x30 + 1)
@@ -20,6 +20,7 @@
 
 #include <linux/io.h>
 #include <linux/fb.h>
+#include <linux/delay.h>
 #include <linux/pci.h>
 #include <linux/init.h>
 #include <linux/slab.h>
@@ -51,6 +52,17 @@ struct smtcfb_info {
 	u_int height;
 	u_int hz;
 
+	/*
+	 * Drawing engine fence: set once a command has been queued, cleared
+	 * by smtcfb_sync() after the engine has gone idle.  CPU accesses to
+	 * the framebuffer must not overtake an unsignalled fence.
+	 */
+	bool accel;
+	bool accel_pending;
+
+	/* screen_base is a separate write-combining mapping of the VRAM */
+	bool screen_wc;
+
 	u32 colreg[17];
 };
 
@@ -832,6 +844,14 @@ static struct screen_info smtc_scr_info;
 
 static char *mode_option;
 
+static bool noaccel;
+module_param(noaccel, bool, 0444);
+MODULE_PARM_DESC(noaccel, "Disable the 2D drawing engine (default: enabled)");
+
+static bool nowc;
+module_param(nowc, bool, 0444);
+MODULE_PARM_DESC(nowc, "Map the framebuffer uncached instead of write-combining (default: write-combining)");
+
 /* process command line options, get vga parameter */
 static void __init sm7xx_vga_setup(char *options)
 {
@@ -1017,6 +1037,77 @@ static int smtc_setcolreg(unsigned int regno, unsigned int red,
 	return 0;
 }
 
+#ifdef __BIG_ENDIAN
+static u32 __iomem *smtcfb_read_chunk(u32 *dst, u32 __iomem *src, int c)
+{
+	int i;
+
+	for (i = c >> 2; i--;) {
+		*dst = fb_readl(src++);
+		*dst = big_swap(*dst);
+		dst++;
+	}
+	if (c & 3) {
+		u8 *dst8 = (u8 *)dst;
+		u8 __iomem *src8 = (u8 __iomem *)src;
+
+		for (i = c & 3; i--;) {
+			if (i & 1) {
+				*dst8++ = fb_readb(++src8);
+			} else {
+				*dst8++ = fb_readb(--src8);
+				src8 += 2;
+			}
+		}
+		src = (u32 __iomem *)src8;
+	}
+
+	return src;
+}
+
+static u32 __iomem *smtcfb_write_chunk(u32 __iomem *dst, u32 *src, int c)
+{
+	int i;
+
+	for (i = c >> 2; i--;) {
+		fb_writel(big_swap(*src), dst++);
+		src++;
+	}
+	if (c & 3) {
+		u8 *src8 = (u8 *)src;
+		u8 __iomem *dst8 = (u8 __iomem *)dst;
+
+		for (i = c & 3; i--;) {
+			if (i & 1) {
+				fb_writeb(*src8++, ++dst8);
+			} else {
+				fb_writeb(*src8++, --dst8);
+				dst8 += 2;
+			}
+		}
+		dst = (u32 __iomem *)dst8;
+	}
+
+	return dst;
+}
+#else
+/*
+ * No byte swapping needed: copy in 64-bit bursts, which a write-combining
+ * mapping merges into full bus transactions.
+ */
+static u32 __iomem *smtcfb_read_chunk(u32 *dst, u32 __iomem *src, int c)
+{
+	memcpy_fromio(dst, src, c);
+	return (u32 __iomem *)((u8 __iomem *)src + c);
+}
+
+static u32 __iomem *smtcfb_write_chunk(u32 __iomem *dst, u32 *src, int c)
+{
+	memcpy_toio(dst, src, c);
+	return (u32 __iomem *)((u8 __iomem *)dst + c);
+}
+#endif
+
 static ssize_t smtcfb_read(struct fb_info *info, char __user *buf,
 			   size_t count, loff_t *ppos)
 {
@@ -1024,7 +1115,7 @@ static ssize_t smtcfb_read(struct fb_info *info, char __user *buf,
 
 	u32 *buffer, *dst;
 	u32 __iomem *src;
-	int c, i, cnt = 0, err = 0;
+	int c, cnt = 0, err = 0;
 	unsigned long total_size;
 
 	if (!info || !info->screen_base)
@@ -1059,25 +1150,7 @@ static ssize_t smtcfb_read(struct fb_info *info, char __user *buf,
 	while (count) {
 		c = (count > PAGE_SIZE) ? PAGE_SIZE : count;
 		dst = buffer;
-		for (i = c >> 2; i--;) {
-			*dst = fb_readl(src++);
-			*dst = big_swap(*dst);
-			dst++;
-		}
-		if (c & 3) {
-			u8 *dst8 = (u8 *)dst;
-			u8 __iomem *src8 = (u8 __iomem *)src;
-
-			for (i = c & 3; i--;) {
-				if (i & 1) {
-					*dst8++ = fb_readb(++src8);
-				} else {
-					*dst8++ = fb_readb(--src8);
-					src8 += 2;
-				}
-			}
-			src = (u32 __iomem *)src8;
-		}
+		src = smtcfb_read_chunk(dst, src, c);
 
 		if (copy_to_user(buf, buffer, c)) {
 			err = -EFAULT;
@@ -1101,7 +1174,7 @@ static ssize_t smtcfb_write(struct fb_info *info, const char __user *buf,
 
 	u32 *buffer, *src;
 	u32 __iomem *dst;
-	int c, i, cnt = 0, err = 0;
+	int c, cnt = 0, err = 0;
 	unsigned long total_size;
 
 	if (!info || !info->screen_base)
@@ -1148,24 +1221,7 @@ static ssize_t smtcfb_write(struct fb_info *info, const char __user *buf,
 			break;
 		}
 
-		for (i = c >> 2; i--;) {
-			fb_writel(big_swap(*src), dst++);
-			src++;
-		}
-		if (c & 3) {
-			u8 *src8 = (u8 *)src;
-			u8 __iomem *dst8 = (u8 __iomem *)dst;
-
-			for (i = c & 3; i--;) {
-				if (i & 1) {
-					fb_writeb(*src8++, ++dst8);
-				} else {
-					fb_writeb(*src8++, --dst8);
-					dst8 += 2;
-				}
-			}
-			dst = (u32 __iomem *)dst8;
-		}
+		dst = smtcfb_write_chunk(dst, src, c);
 
 		*ppos += c;
 		buf += c;
@@ -1293,6 +1349,196 @@ static void smtc_set_timing(struct smtcfb_info *sfb)
 	}
 }
 
+/*
+ * 2D drawing engine
+ *
+ * Only solid fills and screen to screen copies are offloaded, which is what
+ * the console needs for clearing and scrolling; glyph expansion stays with
+ * cfb_imageblit().
+ */
+static inline void smtc_dpr_write(struct smtcfb_info *sfb, int reg, u32 val)
+{
+	writel(val, sfb->dp_regs + reg);
+}
+
+/*
+ * Kick the engine.  Pixels the CPU wrote through the write-combining
+ * mapping may still sit in the write buffer, so drain it first or the
+ * engine can read stale VRAM.
+ */
+static inline void smtc_de_start(struct smtcfb_info *sfb, u32 ctrl)
+{
+	wmb();
+	smtc_dpr_write(sfb, DPR_DE_CTRL, ctrl);
+}
+
+static int smtc_de_wait(bool idle)
+{
+	u8 mask = idle ? SR16_DE_FIFO_EMPTY | SR16_DE_BUSY : SR16_DE_FIFO_EMPTY;
+	int i;
+
+	for (i = 0; i < 1000000; i++) {
+		if ((smtc_seqr(0x16) & mask) == SR16_DE_FIFO_EMPTY)
+			return 0;
+		cpu_relax();
+	}
+
+	return -EBUSY;
+}
+
+static int smtcfb_sync(struct fb_info *info)
+{
+	struct smtcfb_info *sfb = info->par;
+
+	if (!sfb->accel_pending)
+		return 0;
+
+	sfb->accel_pending = false;
+	if (smtc_de_wait(true)) {
+		dev_err(&sfb->pdev->dev, "drawing engine timeout\n");
+		return -EBUSY;
+	}
+
+	return 0;
+}
+
+static bool smtc_accel_supported(struct smtcfb_info *sfb)
+{
+#ifdef __BIG_ENDIAN
+	/* the word swapped 32bpp aperture and pixel formats are untested */
+	return false;
+#else
+	if (sfb->chip_id != 0x710 && sfb->chip_id != 0x712)
+		return false;
+
+	return sfb->fb->var.bits_per_pixel == 8 ||
+	       sfb->fb->var.bits_per_pixel == 16 ||
+	       sfb->fb->var.bits_per_pixel == 32;
+#endif
+}
+
+static void smtc_de_init(struct smtcfb_info *sfb)
+{
+	struct fb_info *info = sfb->fb;
+	u32 pitch, fmt;
+
+	sfb->accel = !noaccel && smtc_accel_supported(sfb);
+	if (!sfb->accel) {
+		info->flags &= ~(FBINFO_HWACCEL_COPYAREA |
+				 FBINFO_HWACCEL_FILLRECT);
+		info->fix.accel = FB_ACCEL_NONE;
+		return;
+	}
+
+	switch (info->var.bits_per_pixel) {
+	case 8:
+		fmt = DE_DATA_FORMAT_8BPP;
+		break;
+	case 32:
+		fmt = DE_DATA_FORMAT_32BPP;
+		break;
+	case 16:
+	default:
+		fmt = DE_DATA_FORMAT_16BPP;
+		break;
+	}
+
+	/* pitch and window width are in pixels */
+	pitch = info->fix.line_length / (info->var.bits_per_pixel >> 3);
+
+	smtc_de_wait(true);
+	smtc_dpr_write(sfb, DPR_PITCH, (pitch << 16) | pitch);
+	smtc_dpr_write(sfb, DPR_SRC_WINDOW, (pitch << 16) | pitch);
+	smtc_dpr_write(sfb, DPR_DATA_FORMAT, fmt);
+	smtc_dpr_write(sfb, DPR_COLOR_COMPARE_MASK, 0);
+	smtc_dpr_write(sfb, DPR_BYTE_BIT_MASK, 0xffffffff);
+	smtc_dpr_write(sfb, DPR_CROP_TOPLEFT_COORDS, 0);
+	smtc_dpr_write(sfb, DPR_SRC_BASE, 0);
+	smtc_dpr_write(sfb, DPR_DST_BASE, 0);
+	sfb->accel_pending = false;
+
+	info->flags |= FBINFO_HWACCEL_COPYAREA | FBINFO_HWACCEL_FILLRECT;
+	info->fix.accel = FB_ACCEL_SMI_LYNX;
+}
+
+static void smtcfb_fillrect(struct fb_info *info,
+			    const struct fb_fillrect *rect)
+{
+	struct smtcfb_info *sfb = info->par;
+	u32 color, rop;
+
+	if (!sfb->accel || info->state != FBINFO_STATE_RUNNING) {
+		smtcfb_sync(info);
+		cfb_fillrect(info, rect);
+		return;
+	}
+
+	if (info->fix.visual == FB_VISUAL_TRUECOLOR ||
+	    info->fix.visual == FB_VISUAL_DIRECTCOLOR)
+		color = ((u32 *)info->pseudo_palette)[rect->color];
+	else
+		color = rect->color;
+
+	rop = rect->rop == ROP_XOR ? DE_CTRL_ROP_PAT_XOR : DE_CTRL_ROP_PAT;
+
+	if (smtc_de_wait(false)) {
+		smtcfb_sync(info);
+		cfb_fillrect(info, rect);
+		return;
+	}
+
+	/* an all-ones mono pattern in the foreground colour */
+	smtc_dpr_write(sfb, DPR_FG_COLOR, color);
+	smtc_dpr_write(sfb, DPR_MONO_PATTERN_LO32, 0xffffffff);
+	smtc_dpr_write(sfb, DPR_MONO_PATTERN_HI32, 0xffffffff);
+	smtc_dpr_write(sfb, DPR_DST_COORDS, (rect->dx << 16) | rect->dy);
+	smtc_dpr_write(sfb, DPR_SPAN_COORDS,
+		       (rect->width << 16) | rect->height);
+	smtc_de_start(sfb, DE_CTRL_START | DE_CTRL_COMMAND_BITBLT | rop);
+	sfb->accel_pending = true;
+}
+
+static void smtcfb_copyarea(struct fb_info *info,
+			    const struct fb_copyarea *area)
+{
+	struct smtcfb_info *sfb = info->par;
+	u32 sx = area->sx, sy = area->sy, dx = area->dx, dy = area->dy;
+	u32 ctrl = DE_CTRL_START | DE_CTRL_COMMAND_BITBLT | DE_CTRL_ROP_SRC;
+
+	if (!sfb->accel || info->state != FBINFO_STATE_RUNNING ||
+	    smtc_de_wait(false)) {
+		smtcfb_sync(info);
+		cfb_copyarea(info, area);
+		return;
+	}
+
+	/*
+	 * Overlapping copies towards higher addresses have to run from the
+	 * bottom right corner backwards.
+	 */
+	if (sy < dy || (sy == dy && sx < dx)) {
+		ctrl |= DE_CTRL_RTOL;
+		sx += area->width - 1;
+		sy += area->height - 1;
+		dx += area->width - 1;
+		dy += area->height - 1;
+	}
+
+	smtc_dpr_write(sfb, DPR_SRC_COORDS, (sx << 16) | sy);
+	smtc_dpr_write(sfb, DPR_DST_COORDS, (dx << 16) | dy);
+	smtc_dpr_write(sfb, DPR_SPAN_COORDS,
+		       (area->width << 16) | area->height);
+	smtc_de_start(sfb, ctrl);
+	sfb->accel_pending = true;
+}
+
+static void smtcfb_imageblit(struct fb_info *info, const struct fb_image *image)
+{
+	/* the CPU must not race the engine on the same pixels */
+	smtcfb_sync(info);
+	cfb_imageblit(info, image);
+}
+
 static void smtcfb_setmode(struct smtcfb_info *sfb)
 {
 	switch (sfb->fb->var.bits_per_pixel) {
@@ -1343,6 +1589,7 @@ static void smtcfb_setmode(struct smtcfb_info *sfb)
 	sfb->height = sfb->fb->var.yres;
 	sfb->hz = 60;
 	smtc_set_timing(sfb);
+	smtc_de_init(sfb);
 }
 
 static int smtc_check_var(struct fb_var_screeninfo *var, struct fb_info *info)
@@ -1375,9 +1622,10 @@ static const struct fb_ops smtcfb_ops = {
 	.fb_set_par   = smtc_set_par,
 	.fb_setcolreg = smtc_setcolreg,
 	.fb_blank     = smtc_blank,
-	.fb_fillrect  = cfb_fillrect,
-	.fb_imageblit = cfb_imageblit,
-	.fb_copyarea  = cfb_copyarea,
+	.fb_fillrect  = smtcfb_fillrect,
+	.fb_imageblit = smtcfb_imageblit,
+	.fb_copyarea  = smtcfb_copyarea,
+	.fb_sync      = smtcfb_sync,
 	.fb_read      = smtcfb_read,
 	.fb_write     = smtcfb_write,
 };
@@ -1411,6 +1659,21 @@ static int smtc_map_smem(struct smtcfb_info *sfb,
 
 	sfb->fb->fix.smem_len = smem_len;
 
+	/*
+	 * Writes to VRAM are much faster through a write-combining (on
+	 * Loongson: uncached accelerated) mapping; the registers stay behind
+	 * the uncached sfb->lfb mapping.
+	 */
+	sfb->screen_wc = false;
+	if (!nowc && sfb->chip_id != 0x720) {
+		sfb->fb->screen_base = ioremap_wc(sfb->fb->fix.smem_start,
+						  smem_len);
+		if (sfb->fb->screen_base) {
+			sfb->screen_wc = true;
+			return 0;
+		}
+	}
+
 	sfb->fb->screen_base = sfb->lfb;
 
 	if (!sfb->fb->screen_base) {
@@ -1429,6 +1692,11 @@ static int smtc_map_smem(struct smtcfb_info *sfb,
 static void smtc_unmap_smem(struct smtcfb_info *sfb)
 {
 	if (sfb && sfb->fb->screen_base) {
+		if (sfb->screen_wc) {
+			iounmap(sfb->fb->screen_base);
+			sfb->fb->screen_base = sfb->lfb;
+			sfb->screen_wc = false;
+		}
 		if (sfb->chip_id == 0x720)
 			sfb->fb->screen_base -= 0x00200000;
 		iounmap(sfb->fb->screen_base);
@@ -1637,7 +1905,7 @@ static int smtcfb_pci_probe(struct pci_dev *pdev,
 	 * The screen would be temporarily garbled when sm712fb takes over
 	 * vesafb or VGA text mode. Zero the framebuffer.
 	 */
-	memset_io(sfb->lfb, 0, sfb->fb->fix.smem_len);
+	memset_io(sfb->fb->screen_base, 0, sfb->fb->fix.smem_len);
 
 	err = register_framebuffer(info);
 	if (err < 0)
@@ -68,6 +68,7 @@
 struct vring_desc_state_split {
 	void *data;			/* Data for callback. */
 	struct vring_desc *indir_desc;	/* Indirect descriptor, if any. */
+	u32 in_len;			/* Device writable length, in order. */
 };
 
 struct vring_desc_state_packed {
@@ -105,6 +106,9 @@ struct vring_virtqueue {
 	/* Host publishes avail event idx */
 	bool event;
 
+	/* Host uses buffers in the order they were made available */
+	bool in_order;
+
 	/* Head of free buffer list. */
 	unsigned int free_head;
 	/* Number we've added since last sync. */
@@ -131,6 +135,14 @@ struct vring_virtqueue {
 			/* Per-descriptor state. */
 			struct vring_desc_state_split *desc_state;
 
+			/*
+			 * With VIRTIO_F_IN_ORDER, the used entry that ends
+			 * the batch being reclaimed, batch_id is vring.num
+			 * if there is none.
+			 */
+			u32 batch_id;
+			u32 batch_len;
+
 			/* DMA address and size information */
 			dma_addr_t queue_dma_addr;
 			size_t queue_size_in_bytes;
@@ -425,6 +437,7 @@ static inline int virtqueue_add_split(struct virtqueue *_vq,
 	struct scatterlist *sg;
 	struct vring_desc *desc;
 	unsigned int i, n, avail, descs_used, prev, err_idx;
+	u32 in_len = 0;
 	int head;
 	bool indirect;
 
@@ -500,6 +513,7 @@ static inline int virtqueue_add_split(struct virtqueue *_vq,
 			desc[i].flags = cpu_to_virtio16(_vq->vdev, VRING_DESC_F_NEXT | VRING_DESC_F_WRITE);
 			desc[i].addr = cpu_to_virtio64(_vq->vdev, addr);
 			desc[i].len = cpu_to_virtio32(_vq->vdev, sg->length);
+			in_len += sg->length;
 			prev = i;
 			i = virtio16_to_cpu(_vq->vdev, desc[i].next);
 		}
@@ -536,6 +550,7 @@ static inline int virtqueue_add_split(struct virtqueue *_vq,
 
 	/* Store token and indirect buffer state. */
 	vq->split.desc_state[head].data = data;
+	vq->split.desc_state[head].in_len = in_len;
 	if (indirect)
 		vq->split.desc_state[head].indir_desc = desc;
 	else
@@ -636,9 +651,17 @@ static void detach_buf_split(struct vring_virtqueue *vq, unsigned int head,
 	}
 
 	vring_unmap_one_split(vq, &vq->split.vring.desc[i]);
-	vq->split.vring.desc[i].next = cpu_to_virtio16(vq->vq.vdev,
-						vq->free_head);
-	vq->free_head = head;
+	/*
+	 * In order, the free descriptors stay in table order and buffers
+	 * come back oldest first, so this chain already follows the last
+	 * free descriptor: leave the links alone to keep handing out
+	 * descriptors sequentially.
+	 */
+	if (!vq->in_order) {
+		vq->split.vring.desc[i].next = cpu_to_virtio16(vq->vq.vdev,
+							vq->free_head);
+		vq->free_head = head;
+	}
 
 	/* Plus final descriptor */
 	vq->vq.num_free++;
@@ -659,8 +682,9 @@ static void detach_buf_split(struct vring_virtqueue *vq, unsigned int head,
 			 cpu_to_virtio16(vq->vq.vdev, VRING_DESC_F_INDIRECT)));
 		BUG_ON(len == 0 || len % sizeof(struct vring_desc));
 
-		for (j = 0; j < len / sizeof(struct vring_desc); j++)
-			vring_unmap_one_split(vq, &indir_desc[j]);
+		if (vq->use_dma_api)
+			for (j = 0; j < len / sizeof(struct vring_desc); j++)
+				vring_unmap_one_split(vq, &indir_desc[j]);
 
 		kfree(indir_desc);
 		vq->split.desc_state[head].indir_desc = NULL;
@@ -675,6 +699,41 @@ static inline bool more_used_split(const struct vring_virtqueue *vq)
 			vq->split.vring.used->idx);
 }
 
+/*
+ * With VIRTIO_F_IN_ORDER the device may write a single used entry for a
+ * whole batch: the entry lands at the first slot of the batch, carries the
+ * id of its last buffer, and used->idx moves past all of them. Buffers are
+ * used in the order they were made available, so the next one is read back
+ * from our own avail ring, and the buffers before the batch end are reported
+ * as completely written.
+ */
+static unsigned int get_buf_in_order_split(struct vring_virtqueue *vq,
+					   u16 last_used, unsigned int *len)
+{
+	struct virtio_device *vdev = vq->vq.vdev;
+	unsigned int head;
+
+	head = virtio16_to_cpu(vdev, vq->split.vring.avail->ring[last_used]);
+	if (unlikely(head >= vq->split.vring.num))
+		return head;
+
+	if (vq->split.batch_id == vq->split.vring.num) {
+		vq->split.batch_id = virtio32_to_cpu(vdev,
+				vq->split.vring.used->ring[last_used].id);
+		vq->split.batch_len = virtio32_to_cpu(vdev,
+				vq->split.vring.used->ring[last_used].len);
+	}
+
+	if (head == vq->split.batch_id) {
+		vq->split.batch_id = vq->split.vring.num;
+		*len = vq->split.batch_len;
+	} else {
+		*len = vq->split.desc_state[head].in_len;
+	}
+
+	return head;
+}
+
 static void *virtqueue_get_buf_ctx_split(struct virtqueue *_vq,
 					 unsigned int *len,
 					 void **ctx)
@@ -701,10 +760,14 @@ static void *virtqueue_get_buf_ctx_split(struct virtqueue *_vq,
 	virtio_rmb(vq->weak_barriers);
 
 	last_used = (vq->last_used_idx & (vq->split.vring.num - 1));
-	i = virtio32_to_cpu(_vq->vdev,
-			vq->split.vring.used->ring[last_used].id);
-	*len = virtio32_to_cpu(_vq->vdev,
-			vq->split.vring.used->ring[last_used].len);
+	if (vq->in_order) {
+		i = get_buf_in_order_split(vq, last_used, len);
+	} else {
+		i = virtio32_to_cpu(_vq->vdev,
+				vq->split.vring.used->ring[last_used].id);
+		*len = virtio32_to_cpu(_vq->vdev,
+				vq->split.vring.used->ring[last_used].len);
+	}
 
 	if (unlikely(i >= vq->split.vring.num)) {
 		BAD_RING(vq, "id %u out of range\n", i);
@@ -1617,6 +1680,7 @@ static struct virtqueue *vring_create_virtqueue_packed(
 	vq->indirect = virtio_has_feature(vdev, VIRTIO_RING_F_INDIRECT_DESC) &&
 		!context;
 	vq->event = virtio_has_feature(vdev, VIRTIO_RING_F_EVENT_IDX);
+	vq->in_order = false;
 
 	if (virtio_has_feature(vdev, VIRTIO_F_ORDER_PLATFORM))
 		vq->weak_barriers = false;
@@ -2094,11 +2158,13 @@ struct virtqueue *__vring_new_virtqueue(unsigned int index,
 	vq->indirect = virtio_has_feature(vdev, VIRTIO_RING_F_INDIRECT_DESC) &&
 		!context;
 	vq->event = virtio_has_feature(vdev, VIRTIO_RING_F_EVENT_IDX);
+	vq->in_order = virtio_has_feature(vdev, VIRTIO_F_IN_ORDER);
 
 	if (virtio_has_feature(vdev, VIRTIO_F_ORDER_PLATFORM))
 		vq->weak_barriers = false;
 
 	vq->split.queue_dma_addr = 0;
+	vq->split.batch_id = vring.num;
 	vq->split.queue_size_in_bytes = 0;
 
 	vq->split.vring = vring;
@@ -2120,10 +2186,15 @@ struct virtqueue *__vring_new_virtqueue(unsigned int index,
 		return NULL;
 	}
 
-	/* Put everything in free lists. */
+	/*
+	 * Put everything in free lists. The list wraps around, so that with
+	 * VIRTIO_F_IN_ORDER descriptors are used in ring order, see
+	 * detach_buf_split().
+	 */
 	vq->free_head = 0;
-	for (i = 0; i < vring.num-1; i++)
-		vq->split.vring.desc[i].next = cpu_to_virtio16(vdev, i + 1);
+	for (i = 0; i < vring.num; i++)
+		vq->split.vring.desc[i].next = cpu_to_virtio16(vdev,
+					(i + 1) & (vring.num - 1));
 	memset(vq->split.desc_state, 0, vring.num *
 			sizeof(struct vring_desc_state_split));
 
@@ -2234,11 +2305,17 @@ void vring_transport_features(struct virtio_device *vdev)
 			break;
 		case VIRTIO_F_ORDER_PLATFORM:
 			break;
+		case VIRTIO_F_IN_ORDER:
+			break;
 		default:
 			/* We don't understand this bit. */
 			__virtio_clear_bit(vdev, i);
 		}
 	}
+
+	/* In order use is only implemented for the split ring */
+	if (__virtio_test_bit(vdev, VIRTIO_F_RING_PACKED))
+		__virtio_clear_bit(vdev, VIRTIO_F_IN_ORDER);
 }
 EXPORT_SYMBOL_GPL(vring_transport_features);
 
@@ -20,6 +20,7 @@
 #include <linux/sched.h>
 #include <linux/uio.h>
 #include <linux/bvec.h>
+#include <linux/writeback.h>
 #include <net/9p/9p.h>
 #include <net/9p/client.h>
 
@@ -28,6 +29,13 @@
 #include "cache.h"
 #include "fid.h"
 
+/*
+ * Number of contiguous pages covered by one batched read or write.  The
+ * client splits the request into msize sized RPCs, and transports that
+ * can do zero copy map the pages directly.
+ */
+#define V9FS_BATCH_PAGES	16
+
 /**
  * v9fs_fid_readpage - read an entire page in from 9P
  *
@@ -85,6 +93,55 @@ static int v9fs_vfs_readpage(struct file *filp, struct page *page)
 	return v9fs_fid_readpage(filp->private_data, page);
 }
 
+/**
+ * v9fs_read_batch - read a run of contiguous locked pages with one request
+ *
+ * @fid: fid being read
+ * @pages: the pages, in index order, locked and in the page cache
+ * @nr: number of pages
+ *
+ * Unlocks and drops the pages.  Returns 0 or the error of the read.
+ */
+
+static int v9fs_read_batch(struct p9_fid *fid, struct page **pages,
+			   unsigned int nr)
+{
+	struct inode *inode = pages[0]->mapping->host;
+	struct bio_vec bvec[V9FS_BATCH_PAGES];
+	struct iov_iter to;
+	unsigned int i, done;
+	int retval, err = 0;
+
+	for (i = 0; i < nr; i++) {
+		bvec[i].bv_page = pages[i];
+		bvec[i].bv_offset = 0;
+		bvec[i].bv_len = PAGE_SIZE;
+	}
+	iov_iter_bvec(&to, READ, bvec, nr, nr * PAGE_SIZE);
+
+	retval = p9_client_read(fid, page_offset(pages[0]), &to, &err);
+
+	for (i = 0; i < nr; i++) {
+		struct page *page = pages[i];
+
+		/* A short read without error is EOF, the rest is a hole */
+		done = 0;
+		if (retval > i * PAGE_SIZE)
+			done = min_t(size_t, retval - i * PAGE_SIZE, PAGE_SIZE);
+		if (err && done < PAGE_SIZE) {
+			v9fs_uncache_page(inode, page);
+		} else {
+			zero_user(page, done, PAGE_SIZE - done);
+			flush_dcache_page(page);
+			SetPageUptodate(page);
+			v9fs_readpage_to_fscache(inode, page);
+		}
+		unlock_page(page);
+		put_page(page);
+	}
+	return err;
+}
+
 /**
  * v9fs_vfs_readpages - read a set of pages from 9P
  *
@@ -93,12 +150,16 @@ static int v9fs_vfs_readpage(struct file *filp, struct page *page)
  * @pages: list of pages to read
  * @nr_pages: count of pages to read
  *
+ * Pages missing from fscache are read in runs of up to V9FS_BATCH_PAGES
+ * contiguous pages, rather than with one Tread each.
  */
 
 static int v9fs_vfs_readpages(struct file *filp, struct address_space *mapping,
 			     struct list_head *pages, unsigned nr_pages)
 {
-	int ret = 0;
+	struct page *batch[V9FS_BATCH_PAGES];
+	unsigned int nr = 0;
+	int ret = 0, err;
 	struct inode *inode;
 
 	inode = mapping->host;
@@ -108,8 +169,32 @@ static int v9fs_vfs_readpages(struct file *filp, struct address_space *mapping,
 	if (ret == 0)
 		return ret;
 
-	ret = read_cache_pages(mapping, pages, v9fs_fid_readpage,
-			filp->private_data);
+	ret = 0;
+	while (!list_empty(pages)) {
+		struct page *page = lru_to_page(pages);
+
+		list_del(&page->lru);
+		if (add_to_page_cache_lru(page, mapping, page->index,
+				readahead_gfp_mask(mapping))) {
+			put_page(page);
+			continue;
+		}
+
+		if (nr && (nr == V9FS_BATCH_PAGES ||
+			   batch[nr - 1]->index + 1 != page->index)) {
+			err = v9fs_read_batch(filp->private_data, batch, nr);
+			if (err && !ret)
+				ret = err;
+			nr = 0;
+		}
+		batch[nr++] = page;
+	}
+	if (nr) {
+		err = v9fs_read_batch(filp->private_data, batch, nr);
+		if (err && !ret)
+			ret = err;
+	}
+
 	p9_debug(P9_DEBUG_VFS, "  = %d\n", ret);
 	return ret;
 }
@@ -197,6 +282,103 @@ static int v9fs_vfs_writepage(struct page *page, struct writeback_control *wbc)
 	return retval;
 }
 
+/* Contiguous pages under writeback, waiting to be sent in one request */
+struct v9fs_writeback {
+	struct writeback_control *wbc;
+	struct page *pages[V9FS_BATCH_PAGES];
+	struct bio_vec bvec[V9FS_BATCH_PAGES];
+	unsigned int nr;
+	size_t len;
+};
+
+static int v9fs_writeback_flush(struct address_space *mapping,
+				struct v9fs_writeback *wb)
+{
+	struct v9fs_inode *v9inode = V9FS_I(mapping->host);
+	struct iov_iter from;
+	unsigned int i;
+	int err = 0;
+
+	if (!wb->nr)
+		return 0;
+
+	/* We should have writeback_fid always set */
+	BUG_ON(!v9inode->writeback_fid);
+
+	iov_iter_bvec(&from, WRITE, wb->bvec, wb->nr, wb->len);
+	p9_client_write(v9inode->writeback_fid, page_offset(wb->pages[0]),
+			&from, &err);
+
+	for (i = 0; i < wb->nr; i++) {
+		struct page *page = wb->pages[i];
+
+		if (err == -EAGAIN) {
+			redirty_page_for_writepage(wb->wbc, page);
+		} else if (err) {
+			SetPageError(page);
+			mapping_set_error(mapping, err);
+		}
+		end_page_writeback(page);
+		put_page(page);
+	}
+	wb->nr = 0;
+	wb->len = 0;
+	return err == -EAGAIN ? 0 : err;
+}
+
+static int v9fs_writepages_add(struct page *page, struct writeback_control *wbc,
+			       void *data)
+{
+	struct address_space *mapping = page->mapping;
+	struct v9fs_writeback *wb = data;
+	loff_t size = i_size_read(mapping->host);
+	unsigned int len;
+	int err = 0;
+
+	if (page->index == size >> PAGE_SHIFT)
+		len = size & ~PAGE_MASK;
+	else
+		len = PAGE_SIZE;
+
+	/* Only a full page may be followed by another in the same request */
+	if (wb->nr && (wb->nr == V9FS_BATCH_PAGES ||
+		       wb->pages[wb->nr - 1]->index + 1 != page->index ||
+		       wb->bvec[wb->nr - 1].bv_len != PAGE_SIZE))
+		err = v9fs_writeback_flush(mapping, wb);
+
+	set_page_writeback(page);
+	get_page(page);
+	unlock_page(page);
+
+	wb->pages[wb->nr] = page;
+	wb->bvec[wb->nr].bv_page = page;
+	wb->bvec[wb->nr].bv_offset = 0;
+	wb->bvec[wb->nr].bv_len = len;
+	wb->nr++;
+	wb->len += len;
+	return err;
+}
+
+/**
+ * v9fs_vfs_writepages - write back dirty pages in runs
+ * @mapping: the address space
+ * @wbc: writeback control
+ *
+ * Contiguous dirty pages are sent with one Twrite covering up to
+ * V9FS_BATCH_PAGES pages, instead of one per page as ->writepage does.
+ */
+
+static int v9fs_vfs_writepages(struct address_space *mapping,
+			       struct writeback_control *wbc)
+{
+	struct v9fs_writeback wb = { .wbc = wbc };
+	int ret, err;
+
+	ret = write_cache_pages(mapping, wbc, v9fs_writepages_add, &wb);
+	err = v9fs_writeback_flush(mapping, &wb);
+	return ret ? ret : err;
+}
+
 /**
  * v9fs_launder_page - Writeback a dirty page
  * Returns 0 on success.
@@ -327,6 +509,7 @@ const struct address_space_operations v9fs_addr_operations = {
 	.readpages = v9fs_vfs_readpages,
 	.set_page_dirty = __set_page_dirty_nobuffers,
 	.writepage = v9fs_vfs_writepage,
+	.writepages = v9fs_vfs_writepages,
 	.write_begin = v9fs_write_begin,
 	.write_end = v9fs_write_end,
 	.releasepage = v9fs_release_page,
@@ -459,6 +459,38 @@ int cachefiles_read_or_alloc_page(struct fscache_retrieval *op,
 	return -ENOBUFS;
 }
 
+/*
+ * start reading the span of the backing file covered by a set of pages as a
+ * single readahead, so that the backing fs can build large bios for it
+ * rather than being fed one ->readpage() at a time below
+ * - the monitors then find the pages present and wait on them as usual
+ * - sparse sets are left alone rather than reading the holes in between
+ */
+static void cachefiles_read_backing_ahead(struct address_space *bmapping,
+					  struct list_head *list)
+{
+	loff_t isize = i_size_read(bmapping->host);
+	pgoff_t first = ULONG_MAX, last = 0;
+	unsigned long nr = 0;
+	struct page *page;
+
+	if (!isize)
+		return;
+
+	list_for_each_entry(page, list, lru) {
+		first = min(first, page->index);
+		last = max(last, page->index);
+		nr++;
+	}
+
+	last = min_t(pgoff_t, last, (isize - 1) >> PAGE_SHIFT);
+	if (nr < 2 || last < first || last - first >= 2 * nr)
+		return;
+
+	page_cache_readahead_unbounded(bmapping, NULL, first,
+				       last - first + 1, 0);
+}
+
 /*
  * read the corresponding pages to the given set from the backing file
  * - any uncertain pages are simply discarded, to be tried again another time
@@ -474,6 +506,8 @@ static int cachefiles_read_backing_file(struct cachefiles_object *object,
 
 	_enter("");
 
+	cachefiles_read_backing_ahead(bmapping, list);
+
 	list_for_each_entry_safe(netpage, _n, list, lru) {
 		list_del(&netpage->lru);
 
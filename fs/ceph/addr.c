@@ -353,8 +353,8 @@ static void finish_read(struct ceph_osd_request *req)
  * start an async read(ahead) operation.  return nr_pages we submitted
  * a read for on success, or negative error code.
  */
-static int start_read(struct inode *inode, struct ceph_rw_context *rw_ctx,
-		      struct list_head *page_list, int max)
+static int start_read(struct inode *inode, struct list_head *page_list,
+		      int max)
 {
 	struct ceph_osd_client *osdc =
 		&ceph_inode_to_client(inode)->client->osdc;
@@ -368,35 +368,18 @@ static int start_read(struct inode *inode, struct ceph_rw_context *rw_ctx,
 	struct page **pages;
 	pgoff_t next_index;
 	int nr_pages = 0;
-	int got = 0;
 	int ret = 0;
 
-	if (!rw_ctx) {
-		/* caller of readpages does not hold buffer and read caps
-		 * (fadvise, madvise and readahead cases) */
-		int want = CEPH_CAP_FILE_CACHE;
-		ret = ceph_try_get_caps(inode, CEPH_CAP_FILE_RD, want,
-					true, &got);
-		if (ret < 0) {
-			dout("start_read %p, error getting cap\n", inode);
-		} else if (!(got & want)) {
-			dout("start_read %p, no cache cap\n", inode);
-			ret = 0;
-		}
-		if (ret <= 0) {
-			if (got)
-				ceph_put_cap_refs(ci, got);
-			while (!list_empty(page_list)) {
-				page = lru_to_page(page_list);
-				list_del(&page->lru);
-				put_page(page);
-			}
-			return ret;
-		}
-	}
-
 	off = (u64) page_offset(page);
 
+	/*
+	 * If @max divides the stripe unit, end the read on a multiple of
+	 * @max so that a run starting mid-object is not split by the OSD
+	 * client into a short tail read at the object boundary.
+	 */
+	if (max && !(ci->i_layout.stripe_unit % ((u32)max << PAGE_SHIFT)))
+		max -= page->index % max;
+
 	/* count pages */
 	next_index = page->index;
 	list_for_each_entry_reverse(page, page_list, lru) {
@@ -460,12 +443,6 @@ static int start_read(struct inode *inode, struct ceph_rw_context *rw_ctx,
 	if (ret < 0)
 		goto out_pages;
 	ceph_osdc_put_request(req);
-
-	/* After adding locked pages to page cache, the inode holds cache cap.
-	 * So we can drop our cap refs. */
-	if (got)
-		ceph_put_cap_refs(ci, got);
-
 	return nr_pages;
 
 out_pages:
@@ -477,8 +454,6 @@ static int start_read(struct inode *inode, struct ceph_rw_context *rw_ctx,
 out_put:
 	ceph_osdc_put_request(req);
 out:
-	if (got)
-		ceph_put_cap_refs(ci, got);
 	return ret;
 }
 
@@ -486,6 +461,10 @@ static int start_read(struct inode *inode, struct ceph_rw_context *rw_ctx,
 /*
  * Read multiple pages.  Leave pages we don't read + unlock in page_list;
  * the caller (VM) cleans them up.
+ *
+ * The reads of a batch are all sent before any of them completes, so a
+ * readahead window spanning several objects keeps one read in flight per
+ * object.
  */
 static int ceph_readpages(struct file *file, struct address_space *mapping,
 			  struct list_head *page_list, unsigned nr_pages)
@@ -496,6 +475,7 @@ static int ceph_readpages(struct file *file, struct address_space *mapping,
 	struct ceph_rw_context *rw_ctx;
 	int rc = 0;
 	int max = 0;
+	int got = 0;
 
 	if (ceph_inode(inode)->i_inline_version != CEPH_INLINE_NONE)
 		return -EINVAL;
@@ -507,15 +487,36 @@ static int ceph_readpages(struct file *file, struct address_space *mapping,
 		goto out;
 
 	rw_ctx = ceph_find_rw_context(fi);
+	if (!rw_ctx) {
+		/* caller of readpages does not hold buffer and read caps
+		 * (fadvise, madvise and readahead cases), take them once
+		 * for the whole batch */
+		int want = CEPH_CAP_FILE_CACHE;
+		rc = ceph_try_get_caps(inode, CEPH_CAP_FILE_RD, want,
+					true, &got);
+		if (rc < 0) {
+			dout("readpages %p, error getting cap\n", inode);
+		} else if (!(got & want)) {
+			dout("readpages %p, no cache cap\n", inode);
+			rc = 0;
+		}
+		if (rc <= 0)
+			goto out;
+	}
+
 	max = fsc->mount_options->rsize >> PAGE_SHIFT;
 	dout("readpages %p file %p ctx %p nr_pages %d max %d\n",
 	     inode, file, rw_ctx, nr_pages, max);
 	while (!list_empty(page_list)) {
-		rc = start_read(inode, rw_ctx, page_list, max);
+		rc = start_read(inode, page_list, max);
 		if (rc < 0)
-			goto out;
+			break;
 	}
 out:
+	/* After adding locked pages to page cache, the inode holds cache cap.
+	 * So we can drop our cap refs. */
+	if (got)
+		ceph_put_cap_refs(ceph_inode(inode), got);
 	ceph_fscache_readpages_cancel(inode, page_list);
 
 	dout("readpages %p file %p ret %d\n", inode, file, rc);
@@ -24,20 +24,30 @@
 #include <linux/module.h>
 #include <linux/bio.h>
 #include <linux/namei.h>
+#include <crypto/skcipher.h>
 #include "fscrypt_private.h"
 
 void fscrypt_decrypt_bio(struct bio *bio)
 {
 	struct bio_vec *bv;
 	struct bvec_iter_all iter_all;
+	struct skcipher_request *req;
+	DECLARE_CRYPTO_WAIT(wait);
+
+	/* All pages of a read bio belong to the same file */
+	req = fscrypt_alloc_crypt_req(bio_first_page_all(bio)->mapping->host,
+				      &wait, GFP_NOFS);
 
 	bio_for_each_segment_all(bv, bio, iter_all) {
 		struct page *page = bv->bv_page;
-		int ret = fscrypt_decrypt_pagecache_blocks(page, bv->bv_len,
-							   bv->bv_offset);
+		int ret = req ? fscrypt_decrypt_pagecache_blocks_req(page,
+						bv->bv_len, bv->bv_offset,
+						req, &wait) : -ENOMEM;
 		if (ret)
 			SetPageError(page);
 	}
+
+	skcipher_request_free(req);
 }
 EXPORT_SYMBOL(fscrypt_decrypt_bio);
 
@@ -116,6 +126,8 @@ int fscrypt_zeroout_range(const struct inode *inode, pgoff_t lblk,
 	unsigned int nr_pages;
 	unsigned int i;
 	unsigned int offset;
+	struct skcipher_request *req;
+	DECLARE_CRYPTO_WAIT(wait);
 	struct bio *bio;
 	int ret, err;
 
@@ -147,6 +159,12 @@ int fscrypt_zeroout_range(const struct inode *inode, pgoff_t lblk,
 	if (WARN_ON(nr_pages <= 0))
 		return -EINVAL;
 
+	req = fscrypt_alloc_crypt_req(inode, &wait, GFP_NOFS);
+	if (!req) {
+		err = -ENOMEM;
+		goto out_free_pages;
+	}
+
 	/* This always succeeds since __GFP_DIRECT_RECLAIM is set. */
 	bio = bio_alloc(GFP_NOFS, nr_pages);
 
@@ -158,9 +176,10 @@ int fscrypt_zeroout_range(const struct inode *inode, pgoff_t lblk,
 		i = 0;
 		offset = 0;
 		do {
-			err = fscrypt_crypt_block(inode, FS_ENCRYPT, lblk,
-						  ZERO_PAGE(0), pages[i],
-						  blocksize, offset, GFP_NOFS);
+			err = fscrypt_crypt_block_req(inode, req, &wait,
+						      FS_ENCRYPT, lblk,
+						      ZERO_PAGE(0), pages[i],
+						      blocksize, offset);
 			if (err)
 				goto out;
 			lblk++;
@@ -185,6 +204,8 @@ int fscrypt_zeroout_range(const struct inode *inode, pgoff_t lblk,
 	err = 0;
 out:
 	bio_put(bio);
+	skcipher_request_free(req);
+out_free_pages:
 	for (i = 0; i < nr_pages; i++)
 		fscrypt_free_bounce_page(pages[i]);
 	return err;
@@ -89,34 +89,46 @@ void fscrypt_generate_iv(union fscrypt_iv *iv, u64 lblk_num,
 	iv->lblk_num = cpu_to_le64(lblk_num);
 }
 
-/* Encrypt or decrypt a single filesystem block of file contents */
-int fscrypt_crypt_block(const struct inode *inode, fscrypt_direction_t rw,
-			u64 lblk_num, struct page *src_page,
-			struct page *dest_page, unsigned int len,
-			unsigned int offs, gfp_t gfp_flags)
+/*
+ * Allocate a request for the contents key of @inode.  It can be used for
+ * any number of fscrypt_crypt_block_req() calls, one after the other, so
+ * that a run of blocks costs one allocation and setup instead of one each.
+ */
+struct skcipher_request *fscrypt_alloc_crypt_req(const struct inode *inode,
+						 struct crypto_wait *wait,
+						 gfp_t gfp_flags)
+{
+	struct skcipher_request *req;
+
+	req = skcipher_request_alloc(inode->i_crypt_info->ci_enc_key.tfm,
+				     gfp_flags);
+	if (!req)
+		return NULL;
+
+	skcipher_request_set_callback(
+		req, CRYPTO_TFM_REQ_MAY_BACKLOG | CRYPTO_TFM_REQ_MAY_SLEEP,
+		crypto_req_done, wait);
+	return req;
+}
+
+/* Encrypt or decrypt a single filesystem block using a prepared request */
+int fscrypt_crypt_block_req(const struct inode *inode,
+			    struct skcipher_request *req,
+			    struct crypto_wait *wait, fscrypt_direction_t rw,
+			    u64 lblk_num, struct page *src_page,
+			    struct page *dest_page, unsigned int len,
+			    unsigned int offs)
 {
 	union fscrypt_iv iv;
-	struct skcipher_request *req = NULL;
-	DECLARE_CRYPTO_WAIT(wait);
 	struct scatterlist dst, src;
-	struct fscrypt_info *ci = inode->i_crypt_info;
-	struct crypto_skcipher *tfm = ci->ci_enc_key.tfm;
-	int res = 0;
+	int res;
 
 	if (WARN_ON_ONCE(len <= 0))
 		return -EINVAL;
 	if (WARN_ON_ONCE(len % FS_CRYPTO_BLOCK_SIZE != 0))
 		return -EINVAL;
 
-	fscrypt_generate_iv(&iv, lblk_num, ci);
-
-	req = skcipher_request_alloc(tfm, gfp_flags);
-	if (!req)
-		return -ENOMEM;
-
-	skcipher_request_set_callback(
-		req, CRYPTO_TFM_REQ_MAY_BACKLOG | CRYPTO_TFM_REQ_MAY_SLEEP,
-		crypto_req_done, &wait);
+	fscrypt_generate_iv(&iv, lblk_num, inode->i_crypt_info);
 
 	sg_init_table(&dst, 1);
 	sg_set_page(&dst, dest_page, len, offs);
@@ -124,10 +136,9 @@ int fscrypt_crypt_block(const struct inode *inode, fscrypt_direction_t rw,
 	sg_set_page(&src, src_page, len, offs);
 	skcipher_request_set_crypt(req, &src, &dst, len, &iv);
 	if (rw == FS_DECRYPT)
-		res = crypto_wait_req(crypto_skcipher_decrypt(req), &wait);
+		res = crypto_wait_req(crypto_skcipher_decrypt(req), wait);
 	else
-		res = crypto_wait_req(crypto_skcipher_encrypt(req), &wait);
-	skcipher_request_free(req);
+		res = crypto_wait_req(crypto_skcipher_encrypt(req), wait);
 	if (res) {
 		fscrypt_err(inode, "%scryption failed for block %llu: %d",
 			    (rw == FS_DECRYPT ? "De" : "En"), lblk_num, res);
@@ -136,6 +147,26 @@ int fscrypt_crypt_block(const struct inode *inode, fscrypt_direction_t rw,
 	return 0;
 }
 
+/* Encrypt or decrypt a single filesystem block of file contents */
+int fscrypt_crypt_block(const struct inode *inode, fscrypt_direction_t rw,
+			u64 lblk_num, struct page *src_page,
+			struct page *dest_page, unsigned int len,
+			unsigned int offs, gfp_t gfp_flags)
+{
+	struct skcipher_request *req;
+	DECLARE_CRYPTO_WAIT(wait);
+	int res;
+
+	req = fscrypt_alloc_crypt_req(inode, &wait, gfp_flags);
+	if (!req)
+		return -ENOMEM;
+
+	res = fscrypt_crypt_block_req(inode, req, &wait, rw, lblk_num,
+				      src_page, dest_page, len, offs);
+	skcipher_request_free(req);
+	return res;
+}
+
 /**
  * fscrypt_encrypt_pagecache_blocks() - Encrypt filesystem blocks from a
  *					pagecache page
@@ -173,8 +204,10 @@ struct page *fscrypt_encrypt_pagecache_blocks(struct page *page,
 	struct page *ciphertext_page;
 	u64 lblk_num = ((u64)page->index << (PAGE_SHIFT - blockbits)) +
 		       (offs >> blockbits);
+	struct skcipher_request *req;
+	DECLARE_CRYPTO_WAIT(wait);
 	unsigned int i;
-	int err;
+	int err = 0;
 
 	if (WARN_ON_ONCE(!PageLocked(page)))
 		return ERR_PTR(-EINVAL);
@@ -186,14 +219,23 @@ struct page *fscrypt_encrypt_pagecache_blocks(struct page *page,
 	if (!ciphertext_page)
 		return ERR_PTR(-ENOMEM);
 
+	req = fscrypt_alloc_crypt_req(inode, &wait, gfp_flags);
+	if (!req) {
+		fscrypt_free_bounce_page(ciphertext_page);
+		return ERR_PTR(-ENOMEM);
+	}
+
 	for (i = offs; i < offs + len; i += blocksize, lblk_num++) {
-		err = fscrypt_crypt_block(inode, FS_ENCRYPT, lblk_num,
-					  page, ciphertext_page,
-					  blocksize, i, gfp_flags);
-		if (err) {
-			fscrypt_free_bounce_page(ciphertext_page);
-			return ERR_PTR(err);
-		}
+		err = fscrypt_crypt_block_req(inode, req, &wait, FS_ENCRYPT,
+					      lblk_num, page, ciphertext_page,
+					      blocksize, i);
+		if (err)
+			break;
+	}
+	skcipher_request_free(req);
+	if (err) {
+		fscrypt_free_bounce_page(ciphertext_page);
+		return ERR_PTR(err);
 	}
 	SetPagePrivate(ciphertext_page);
 	set_page_private(ciphertext_page, (unsigned long)page);
@@ -246,6 +288,29 @@ EXPORT_SYMBOL(fscrypt_encrypt_block_inplace);
  */
 int fscrypt_decrypt_pagecache_blocks(struct page *page, unsigned int len,
 				     unsigned int offs)
+{
+	struct skcipher_request *req;
+	DECLARE_CRYPTO_WAIT(wait);
+	int err;
+
+	req = fscrypt_alloc_crypt_req(page->mapping->host, &wait, GFP_NOFS);
+	if (!req)
+		return -ENOMEM;
+
+	err = fscrypt_decrypt_pagecache_blocks_req(page, len, offs, req, &wait);
+	skcipher_request_free(req);
+	return err;
+}
+EXPORT_SYMBOL(fscrypt_decrypt_pagecache_blocks);
+
+/*
+ * fscrypt_decrypt_pagecache_blocks() with a request from
+ * fscrypt_alloc_crypt_req(), so that the pages of a bio can share one.
+ */
+int fscrypt_decrypt_pagecache_blocks_req(struct page *page, unsigned int len,
+					 unsigned int offs,
+					 struct skcipher_request *req,
+					 struct crypto_wait *wait)
 {
 	const struct inode *inode = page->mapping->host;
 	const unsigned int blockbits = inode->i_blkbits;
@@ -262,14 +327,14 @@ int fscrypt_decrypt_pagecache_blocks(struct page *page, unsigned int len,
 		return -EINVAL;
 
 	for (i = offs; i < offs + len; i += blocksize, lblk_num++) {
-		err = fscrypt_crypt_block(inode, FS_DECRYPT, lblk_num, page,
-					  page, blocksize, i, GFP_NOFS);
+		err = fscrypt_crypt_block_req(inode, req, wait, FS_DECRYPT,
+					      lblk_num, page, page, blocksize,
+					      i);
 		if (err)
 			return err;
 	}
 	return 0;
 }
-EXPORT_SYMBOL(fscrypt_decrypt_pagecache_blocks);
 
 /**
  * fscrypt_decrypt_block_inplace() - Decrypt a filesystem block in-place
@@ -258,10 +258,23 @@ typedef enum {
 /* crypto.c */
 extern struct kmem_cache *fscrypt_info_cachep;
 int fscrypt_initialize(unsigned int cop_flags);
+struct skcipher_request *fscrypt_alloc_crypt_req(const struct inode *inode,
+						 struct crypto_wait *wait,
+						 gfp_t gfp_flags);
+int fscrypt_crypt_block_req(const struct inode *inode,
+			    struct skcipher_request *req,
+			    struct crypto_wait *wait, fscrypt_direction_t rw,
+			    u64 lblk_num, struct page *src_page,
+			    struct page *dest_page, unsigned int len,
+			    unsigned int offs);
 int fscrypt_crypt_block(const struct inode *inode, fscrypt_direction_t rw,
 			u64 lblk_num, struct page *src_page,
 			struct page *dest_page, unsigned int len,
 			unsigned int offs, gfp_t gfp_flags);
+int fscrypt_decrypt_pagecache_blocks_req(struct page *page, unsigned int len,
+					 unsigned int offs,
+					 struct skcipher_request *req,
+					 struct crypto_wait *wait);
 struct page *fscrypt_alloc_bounce_page(gfp_t gfp_flags);
 
 void __printf(3, 4) __cold
@@ -107,7 +107,7 @@ do { \
 struct dlm_rsbtable {
 	struct rb_root		keep;
 	struct rb_root		toss;
-	spinlock_t		lock;
+	rwlock_t		lock;
 	uint32_t		flags;
 };
 
@@ -512,7 +512,7 @@ static int new_lockspace(const char *name, const char *cluster,
 	for (i = 0; i < size; i++) {
 		ls->ls_rsbtbl[i].keep.rb_node = NULL;
 		ls->ls_rsbtbl[i].toss.rb_node = NULL;
-		spin_lock_init(&ls->ls_rsbtbl[i].lock);
+		rwlock_init(&ls->ls_rsbtbl[i].lock);
 	}
 
 	spin_lock_init(&ls->ls_remove_spin);
@@ -1415,7 +1415,7 @@ static void send_to_sock(struct connection *con)
 	int ret = 0;
 	const int msg_flags = MSG_DONTWAIT | MSG_NOSIGNAL;
 	struct writequeue_entry *e;
-	int len, offset;
+	int len, offset, flags;
 	int count = 0;
 
 	mutex_lock(&con->sock_mutex);
@@ -1432,12 +1432,21 @@ static void send_to_sock(struct connection *con)
 		len = e->len;
 		offset = e->offset;
 		BUG_ON(len == 0 && e->users == 0);
+
+		/*
+		 * Let the socket coalesce the messages of several pages into
+		 * full segments when more committed data is queued behind.
+		 */
+		flags = msg_flags;
+		if (!list_is_last(&e->list, &con->writequeue) &&
+		    list_next_entry(e, list)->len)
+			flags |= MSG_MORE;
 		spin_unlock(&con->writequeue_lock);
 
 		ret = 0;
 		if (len) {
 			ret = kernel_sendpage(con->sock, e->page, offset, len,
-					      msg_flags);
+					      flags);
 			if (ret == -EAGAIN || ret == 0) {
 				if (ret == -EAGAIN &&
 				    test_bit(SOCKWQ_ASYNC_NOSPACE, &con->sock->flags) &&
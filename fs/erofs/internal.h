@@ -245,6 +245,7 @@ struct erofs_inode {
 			unsigned char  z_algorithmtype[2];
 			unsigned char  z_logical_clusterbits;
 			unsigned char  z_physical_clusterbits[2];
+			pgoff_t        z_nextpage;
 		};
 #endif	/* CONFIG_EROFS_FS_ZIP */
 	};
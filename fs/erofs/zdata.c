@@ -34,10 +34,24 @@ typedef tagptr1_t compressed_page_t;
 static struct workqueue_struct *z_erofs_workqueue __read_mostly;
 static struct kmem_cache *pcluster_cachep __read_mostly;
 
+/*
+ * page arrays for pclusters too large for the stack, one per CPU so that
+ * queues decompressed in parallel do not contend on the global one.
+ */
+struct z_erofs_pagemap {
+	struct mutex lock;
+	struct page *pages[Z_EROFS_VMAP_GLOBAL_PAGES];
+};
+static struct z_erofs_pagemap *z_pagemap_pcpu[NR_CPUS];
+
 void z_erofs_exit_zip_subsystem(void)
 {
+	unsigned int cpu;
+
 	destroy_workqueue(z_erofs_workqueue);
 	kmem_cache_destroy(pcluster_cachep);
+	for (cpu = 0; cpu < NR_CPUS; ++cpu)
+		kvfree(z_pagemap_pcpu[cpu]);
 }
 
 static inline int z_erofs_init_workqueue(void)
@@ -137,6 +151,7 @@ struct z_erofs_decompress_frontend {
 
 	/* used for applying cache strategy on the fly */
 	bool backmost;
+	bool random;
 	erofs_off_t headoffset;
 };
 
@@ -151,6 +166,26 @@ struct z_erofs_decompress_frontend {
 static struct page *z_pagemap_global[Z_EROFS_VMAP_GLOBAL_PAGES];
 static DEFINE_MUTEX(z_pagemap_global_lock);
 
+/* lock the page array of this CPU, allocating it on first use */
+static struct z_erofs_pagemap *z_erofs_pagemap_trylock(void)
+{
+	const unsigned int cpu = raw_smp_processor_id();
+	struct z_erofs_pagemap *map = READ_ONCE(z_pagemap_pcpu[cpu]);
+
+	if (!map) {
+		map = kvmalloc(sizeof(*map), GFP_KERNEL | __GFP_NOWARN);
+		if (!map)
+			return NULL;
+
+		mutex_init(&map->lock);
+		if (cmpxchg(&z_pagemap_pcpu[cpu], NULL, map)) {
+			kvfree(map);
+			map = READ_ONCE(z_pagemap_pcpu[cpu]);
+		}
+	}
+	return mutex_trylock(&map->lock) ? map : NULL;
+}
+
 static void preload_compressed_pages(struct z_erofs_collector *clt,
 				     struct address_space *mc,
 				     enum z_erofs_cache_alloctype type,
@@ -557,8 +592,13 @@ static bool should_alloc_managed_pages(struct z_erofs_decompress_frontend *fe,
 	if (fe->backmost)
 		return true;
 
+	/*
+	 * random readers come back to pclusters whose decompressed pages
+	 * may have been reclaimed meanwhile, keep the smaller compressed
+	 * copy around for them.
+	 */
 	return cachestrategy >= EROFS_ZIP_CACHE_READAROUND &&
-		la < fe->headoffset;
+		(fe->random || la < fe->headoffset);
 }
 
 static int z_erofs_do_read_page(struct z_erofs_decompress_frontend *fe,
@@ -694,6 +734,7 @@ static int z_erofs_do_read_page(struct z_erofs_decompress_frontend *fe,
 	goto out;
 }
 
+static void z_erofs_decompressqueue_work(struct work_struct *work);
 static void z_erofs_decompress_kickoff(struct z_erofs_decompressqueue *io,
 				       bool sync, int bios)
 {
@@ -708,8 +749,19 @@ static void z_erofs_decompress_kickoff(struct z_erofs_decompressqueue *io,
 		return;
 	}
 
-	if (!atomic_add_return(bios, &io->pending_bios))
+	if (atomic_add_return(bios, &io->pending_bios))
+		return;
+
+	/*
+	 * decompression may sleep, so it is done right here only if the
+	 * last bio completed in process context (e.g. a stacked driver's
+	 * workqueue), which saves a round trip through erofs_unzipd.
+	 */
+	if (in_atomic() || irqs_disabled()) {
 		queue_work(z_erofs_workqueue, &io->u.work);
+		return;
+	}
+	z_erofs_decompressqueue_work(&io->u.work);
 }
 
 static void z_erofs_decompressqueue_endio(struct bio *bio)
@@ -749,6 +801,7 @@ static int z_erofs_decompress_pcluster(struct super_block *sb,
 	unsigned int i, outputsize, llen, nr_pages;
 	struct page *pages_onstack[Z_EROFS_VMAP_ONSTACK_PAGES];
 	struct page **pages, **compressed_pages, *page;
+	struct z_erofs_pagemap *pagemap = NULL;
 
 	enum z_erofs_page_type page_type;
 	bool overlapped, partial;
@@ -764,6 +817,9 @@ static int z_erofs_decompress_pcluster(struct super_block *sb,
 
 	if (nr_pages <= Z_EROFS_VMAP_ONSTACK_PAGES) {
 		pages = pages_onstack;
+	} else if (nr_pages <= Z_EROFS_VMAP_GLOBAL_PAGES &&
+		   (pagemap = z_erofs_pagemap_trylock())) {
+		pages = pagemap->pages;
 	} else if (nr_pages <= Z_EROFS_VMAP_GLOBAL_PAGES &&
 		   mutex_trylock(&z_pagemap_global_lock)) {
 		pages = z_pagemap_global;
@@ -922,7 +978,9 @@ static int z_erofs_decompress_pcluster(struct super_block *sb,
 		z_erofs_onlinepage_endio(page);
 	}
 
-	if (pages == z_pagemap_global)
+	if (pagemap)
+		mutex_unlock(&pagemap->lock);
+	else if (pages == z_pagemap_global)
 		mutex_unlock(&z_pagemap_global_lock);
 	else if (pages != pages_onstack)
 		kvfree(pages);
@@ -940,11 +998,105 @@ static int z_erofs_decompress_pcluster(struct super_block *sb,
 	return err;
 }
 
+/*
+ * A queue of several pclusters is shared out among helper work items, one
+ * per other online CPU at most.  The caller and the helpers take the next
+ * pcluster from the chain until none are left.
+ */
+struct z_erofs_decompress_helper {
+	struct work_struct work;
+	struct z_erofs_decompress_fanout *fo;
+};
+
+struct z_erofs_decompress_fanout {
+	struct super_block *sb;
+	spinlock_t lock;
+	z_erofs_next_pcluster_t owned;
+	unsigned int nr_helpers;
+	struct z_erofs_decompress_helper helpers[];
+};
+
+static void z_erofs_fanout_drain(struct z_erofs_decompress_fanout *fo,
+				 struct list_head *pagepool)
+{
+	struct z_erofs_pcluster *pcl;
+
+	while (1) {
+		spin_lock(&fo->lock);
+		if (fo->owned == Z_EROFS_PCLUSTER_TAIL_CLOSED) {
+			spin_unlock(&fo->lock);
+			break;
+		}
+		pcl = container_of(fo->owned, struct z_erofs_pcluster, next);
+		fo->owned = READ_ONCE(pcl->next);
+		spin_unlock(&fo->lock);
+
+		z_erofs_decompress_pcluster(fo->sb, pcl, pagepool);
+	}
+}
+
+static void z_erofs_fanout_work(struct work_struct *work)
+{
+	struct z_erofs_decompress_helper *h =
+		container_of(work, struct z_erofs_decompress_helper, work);
+	LIST_HEAD(pagepool);
+
+	z_erofs_fanout_drain(h->fo, &pagepool);
+	put_pages_list(&pagepool);
+}
+
+static bool z_erofs_decompress_fanout(const struct z_erofs_decompressqueue *io,
+				      struct list_head *pagepool)
+{
+	const unsigned int maxhelpers = num_online_cpus() - 1;
+	z_erofs_next_pcluster_t owned = io->head;
+	struct z_erofs_decompress_fanout *fo;
+	unsigned int i, nr = 0;
+
+	/* the chain is stable until its pclusters are decompressed */
+	while (owned != Z_EROFS_PCLUSTER_TAIL_CLOSED && nr <= maxhelpers) {
+		owned = READ_ONCE(container_of(owned, struct z_erofs_pcluster,
+					       next)->next);
+		++nr;
+	}
+	if (nr < 2)
+		return false;
+
+	fo = kmalloc(struct_size(fo, helpers, nr - 1),
+		     GFP_NOIO | __GFP_NOWARN);
+	if (!fo)
+		return false;
+
+	fo->sb = io->sb;
+	spin_lock_init(&fo->lock);
+	fo->owned = io->head;
+	fo->nr_helpers = nr - 1;
+	for (i = 0; i < fo->nr_helpers; ++i) {
+		fo->helpers[i].fo = fo;
+		INIT_WORK(&fo->helpers[i].work, z_erofs_fanout_work);
+		queue_work(z_erofs_workqueue, &fo->helpers[i].work);
+	}
+
+	z_erofs_fanout_drain(fo, pagepool);
+
+	/*
+	 * nothing is left to take, so helpers which have not started yet
+	 * can be dropped and only running ones need to be waited for.
+	 */
+	for (i = 0; i < fo->nr_helpers; ++i)
+		cancel_work_sync(&fo->helpers[i].work);
+	kfree(fo);
+	return true;
+}
+
 static void z_erofs_decompress_queue(const struct z_erofs_decompressqueue *io,
 				     struct list_head *pagepool)
 {
 	z_erofs_next_pcluster_t owned = io->head;
 
+	if (z_erofs_decompress_fanout(io, pagepool))
+		return;
+
 	while (owned != Z_EROFS_PCLUSTER_TAIL_CLOSED) {
 		struct z_erofs_pcluster *pcl;
 
@@ -1271,10 +1423,119 @@ static void z_erofs_runqueue(struct super_block *sb,
 	z_erofs_decompress_queue(&io[JQ_SUBMIT], pagepool);
 }
 
+/*
+ * Return the end of the extent containing @pos, capped at i_size, or @pos
+ * itself if it is not mapped.  An extent can span several lclusters, all
+ * of which map to the same pcluster.
+ */
+static erofs_off_t z_erofs_extent_end(struct inode *inode, erofs_off_t pos)
+{
+	struct erofs_map_blocks map = { .m_la = pos };
+	erofs_off_t end = pos;
+	erofs_off_t pa;
+
+	if (z_erofs_map_blocks_iter(inode, &map, 0) ||
+	    !(map.m_flags & EROFS_MAP_MAPPED))
+		goto out;
+
+	pa = map.m_pa;
+	end = map.m_la + map.m_llen;
+	while (end < inode->i_size) {
+		map.m_la = end;
+		map.m_llen = 0;
+		if (z_erofs_map_blocks_iter(inode, &map, 0) ||
+		    !(map.m_flags & EROFS_MAP_MAPPED) || map.m_pa != pa)
+			break;
+		end = map.m_la + map.m_llen;
+	}
+out:
+	if (map.mpage)
+		put_page(map.mpage);
+	return min_t(erofs_off_t, end, inode->i_size);
+}
+
+/*
+ * Also read pages [@start, @end] which the request does not cover but
+ * which decompress from the same pclusters, so that the compressed data
+ * fetched once fills every page it expands to.  Pages must be handed to
+ * z_erofs_do_read_page() in descending order; cached or locked ones are
+ * skipped.
+ */
+static void z_erofs_readmore(struct z_erofs_decompress_frontend *f,
+			     pgoff_t start, pgoff_t end,
+			     struct list_head *pagepool)
+{
+	struct inode *const inode = f->inode;
+	pgoff_t index;
+	int err;
+
+	for (index = end + 1; index-- > start; ) {
+		struct page *page = grab_cache_page_nowait(inode->i_mapping,
+							   index);
+
+		if (!page)
+			continue;
+
+		if (PageUptodate(page)) {
+			unlock_page(page);
+		} else {
+			err = z_erofs_do_read_page(f, page, pagepool);
+			if (err)
+				erofs_err(inode->i_sb,
+					  "readmore error at page %lu @ nid %llu",
+					  index, EROFS_I(inode)->nid);
+		}
+		put_page(page);
+	}
+}
+
+/* read the tail of the extent following page @last */
+static pgoff_t z_erofs_readmore_tail(struct z_erofs_decompress_frontend *f,
+				     pgoff_t last, struct list_head *pagepool)
+{
+	erofs_off_t end = z_erofs_extent_end(f->inode,
+			((erofs_off_t)last << PAGE_SHIFT) + PAGE_SIZE - 1);
+	pgoff_t endpage = DIV_ROUND_UP(end, PAGE_SIZE);
+
+	if (endpage <= last + 1)
+		return last;
+
+	z_erofs_readmore(f, last + 1, endpage - 1, pagepool);
+	return endpage - 1;
+}
+
+/* read the head of the extent preceding page @first */
+static void z_erofs_readmore_head(struct z_erofs_decompress_frontend *f,
+				  pgoff_t first, struct list_head *pagepool)
+{
+	struct erofs_map_blocks *const map = &f->map;
+
+	if (!first || !(map->m_flags & EROFS_MAP_MAPPED) ||
+	    map->m_la >= ((erofs_off_t)first << PAGE_SHIFT))
+		return;
+
+	z_erofs_readmore(f, map->m_la >> PAGE_SHIFT, first - 1, pagepool);
+}
+
+/*
+ * A read is random if it does not start where the previous read of the
+ * inode, including its readmore pages, ended.
+ */
+static bool z_erofs_note_access(struct inode *inode, pgoff_t first,
+				pgoff_t last)
+{
+	struct erofs_inode *const vi = EROFS_I(inode);
+	pgoff_t next = READ_ONCE(vi->z_nextpage);
+
+	WRITE_ONCE(vi->z_nextpage, last + 1);
+	return first != next;
+}
+
 static int z_erofs_readpage(struct file *file, struct page *page)
 {
 	struct inode *const inode = page->mapping->host;
 	struct z_erofs_decompress_frontend f = DECOMPRESS_FRONTEND_INIT(inode);
+	pgoff_t last;
 	int err;
 	LIST_HEAD(pagepool);
 
@@ -1282,7 +1543,11 @@ static int z_erofs_readpage(struct file *file, struct page *page)
 
 	f.headoffset = (erofs_off_t)page->index << PAGE_SHIFT;
 
+	last = z_erofs_readmore_tail(&f, page->index, &pagepool);
+	f.random = z_erofs_note_access(inode, page->index, last);
+
 	err = z_erofs_do_read_page(&f, page, &pagepool);
+	z_erofs_readmore_head(&f, page->index, &pagepool);
 	(void)z_erofs_collector_end(&f.clt);
 
 	/* if some compressed cluster ready, need submit them anyway */
@@ -1313,6 +1578,8 @@ static void z_erofs_readahead(struct readahead_control *rac)
 	bool sync = should_decompress_synchronously(sbi, readahead_count(rac));
 	struct z_erofs_decompress_frontend f = DECOMPRESS_FRONTEND_INIT(inode);
 	struct page *page, *head = NULL;
+	pgoff_t first = readahead_index(rac);
+	pgoff_t last = first + readahead_count(rac) - 1;
 	LIST_HEAD(pagepool);
 
 	trace_erofs_readpages(inode, readahead_index(rac),
@@ -1334,6 +1601,10 @@ static void z_erofs_readahead(struct readahead_control *rac)
 		head = page;
 	}
 
+	/* the readahead pages are locked, grab the tail first */
+	last = z_erofs_readmore_tail(&f, last, &pagepool);
+	f.random = z_erofs_note_access(inode, first, last);
+
 	while (head) {
 		struct page *page = head;
 		int err;
@@ -1349,6 +1620,7 @@ static void z_erofs_readahead(struct readahead_control *rac)
 		put_page(page);
 	}
 
+	z_erofs_readmore_head(&f, first, &pagepool);
 	(void)z_erofs_collector_end(&f.clt);
 
 	z_erofs_runqueue(inode->i_sb, &f.clt, &pagepool, sync);
@@ -10,6 +10,8 @@
  *  Copyright (C) 2012-2013 Samsung Electronics Co., Ltd.
  */
 
+#include <linux/rbtree.h>
+#include <linux/shrinker.h>
 #include <linux/slab.h>
 #include <asm/unaligned.h>
 #include <linux/buffer_head.h>
@@ -18,10 +20,16 @@
 #include "exfat_fs.h"
 
 #define EXFAT_CACHE_VALID	0
-#define EXFAT_MAX_CACHE		16
 
+/*
+ * As in fs/fat/cache.c: the cluster runs of an inode are kept in an rbtree
+ * ordered by file cluster, without a per-inode limit, and the shrinker
+ * drops all the runs of the inodes which gained one least recently.
+ *
+ * Lock order: exfat_cache_inodes_lock, then ei->cache_lru_lock.
+ */
 struct exfat_cache {
-	struct list_head cache_list;
+	struct rb_node rb_node;
 	unsigned int nr_contig;	/* number of contiguous clusters */
 	unsigned int fcluster;	/* cluster number in the file. */
 	unsigned int dcluster;	/* cluster number on disk. */
@@ -36,28 +44,70 @@ struct exfat_cache_id {
 
 static struct kmem_cache *exfat_cachep;
 
-static void exfat_cache_init_once(void *c)
+static LIST_HEAD(exfat_cache_inodes);
+static DEFINE_SPINLOCK(exfat_cache_inodes_lock);
+static atomic_long_t exfat_cache_count = ATOMIC_LONG_INIT(0);
+
+static void __exfat_cache_free_all(struct exfat_inode_info *ei);
+
+static unsigned long exfat_cache_shrink_count(struct shrinker *shrink,
+		struct shrink_control *sc)
+{
+	return atomic_long_read(&exfat_cache_count) ?: SHRINK_EMPTY;
+}
+
+static unsigned long exfat_cache_shrink_scan(struct shrinker *shrink,
+		struct shrink_control *sc)
 {
-	struct exfat_cache *cache = (struct exfat_cache *)c;
+	struct exfat_inode_info *ei;
+	unsigned long freed = 0;
+
+	spin_lock(&exfat_cache_inodes_lock);
+	while (freed < sc->nr_to_scan && !list_empty(&exfat_cache_inodes)) {
+		ei = list_first_entry(&exfat_cache_inodes,
+				struct exfat_inode_info, cache_inode_list);
+		list_del_init(&ei->cache_inode_list);
+
+		spin_lock(&ei->cache_lru_lock);
+		freed += ei->nr_caches;
+		__exfat_cache_free_all(ei);
+		spin_unlock(&ei->cache_lru_lock);
+	}
+	spin_unlock(&exfat_cache_inodes_lock);
 
-	INIT_LIST_HEAD(&cache->cache_list);
+	return freed;
 }
 
+static struct shrinker exfat_cache_shrinker = {
+	.count_objects	= exfat_cache_shrink_count,
+	.scan_objects	= exfat_cache_shrink_scan,
+	.seeks		= DEFAULT_SEEKS,
+};
+
 int exfat_cache_init(void)
 {
+	int err;
+
 	exfat_cachep = kmem_cache_create("exfat_cache",
 				sizeof(struct exfat_cache),
 				0, SLAB_RECLAIM_ACCOUNT|SLAB_MEM_SPREAD,
-				exfat_cache_init_once);
+				NULL);
 	if (!exfat_cachep)
 		return -ENOMEM;
-	return 0;
+
+	err = register_shrinker(&exfat_cache_shrinker);
+	if (err) {
+		kmem_cache_destroy(exfat_cachep);
+		exfat_cachep = NULL;
+	}
+	return err;
 }
 
 void exfat_cache_shutdown(void)
 {
 	if (!exfat_cachep)
 		return;
+	unregister_shrinker(&exfat_cache_shrinker);
 	kmem_cache_destroy(exfat_cachep);
 }
 
@@ -68,7 +118,7 @@ void exfat_cache_init_inode(struct inode *inode)
 	spin_lock_init(&ei->cache_lru_lock);
 	ei->nr_caches = 0;
 	ei->cache_valid_id = EXFAT_CACHE_VALID + 1;
-	INIT_LIST_HEAD(&ei->cache_lru);
+	ei->cache_tree = RB_ROOT;
 }
 
 static inline struct exfat_cache *exfat_cache_alloc(void)
@@ -78,17 +128,30 @@ static inline struct exfat_cache *exfat_cache_alloc(void)
 
 static inline void exfat_cache_free(struct exfat_cache *cache)
 {
-	WARN_ON(!list_empty(&cache->cache_list));
 	kmem_cache_free(exfat_cachep, cache);
 }
 
-static inline void exfat_cache_update_lru(struct inode *inode,
-		struct exfat_cache *cache)
+/* Caller must hold cache_lru_lock; the ids handed out stay valid */
+static void __exfat_cache_free_all(struct exfat_inode_info *ei)
+{
+	struct exfat_cache *cache, *n;
+
+	rbtree_postorder_for_each_entry_safe(cache, n, &ei->cache_tree,
+			rb_node)
+		exfat_cache_free(cache);
+	ei->cache_tree = RB_ROOT;
+	atomic_long_sub(ei->nr_caches, &exfat_cache_count);
+	ei->nr_caches = 0;
+}
+
+/* Put @inode at the tail of the shrinker list, it just gained a run */
+static void exfat_cache_touch_inode(struct inode *inode)
 {
 	struct exfat_inode_info *ei = EXFAT_I(inode);
 
-	if (ei->cache_lru.next != &cache->cache_list)
-		list_move(&cache->cache_list, &ei->cache_lru);
+	spin_lock(&exfat_cache_inodes_lock);
+	list_move_tail(&ei->cache_inode_list, &exfat_cache_inodes);
+	spin_unlock(&exfat_cache_inodes_lock);
 }
 
 static unsigned int exfat_cache_lookup(struct inode *inode,
@@ -96,25 +159,29 @@ static unsigned int exfat_cache_lookup(struct inode *inode,
 		unsigned int *cached_fclus, unsigned int *cached_dclus)
 {
 	struct exfat_inode_info *ei = EXFAT_I(inode);
-	static struct exfat_cache nohit = { .fcluster = 0, };
-	struct exfat_cache *hit = &nohit, *p;
+	struct exfat_cache *hit = NULL, *p;
 	unsigned int offset = EXFAT_EOF_CLUSTER;
+	struct rb_node *node;
 
 	spin_lock(&ei->cache_lru_lock);
-	list_for_each_entry(p, &ei->cache_lru, cache_list) {
-		/* Find the cache of "fclus" or nearest cache. */
-		if (p->fcluster <= fclus && hit->fcluster < p->fcluster) {
+	/* Find the run with the last start not beyond "fclus". */
+	node = ei->cache_tree.rb_node;
+	while (node) {
+		p = rb_entry(node, struct exfat_cache, rb_node);
+		if (p->fcluster > fclus) {
+			node = node->rb_left;
+		} else {
 			hit = p;
-			if (hit->fcluster + hit->nr_contig < fclus) {
-				offset = hit->nr_contig;
-			} else {
-				offset = fclus - hit->fcluster;
+			if (p->fcluster == fclus)
 				break;
-			}
+			node = node->rb_right;
 		}
 	}
-	if (hit != &nohit) {
-		exfat_cache_update_lru(inode, hit);
+	if (hit) {
+		if (hit->fcluster + hit->nr_contig < fclus)
+			offset = hit->nr_contig;
+		else
+			offset = fclus - hit->fcluster;
 
 		cid->id = ei->cache_valid_id;
 		cid->nr_contig = hit->nr_contig;
@@ -128,15 +195,27 @@ static unsigned int exfat_cache_lookup(struct inode *inode,
 	return offset;
 }
 
+/*
+ * Find the run starting at the same place as "new" and extend it, or
+ * return where a new run has to be linked.
+ */
 static struct exfat_cache *exfat_cache_merge(struct inode *inode,
-		struct exfat_cache_id *new)
+		struct exfat_cache_id *new, struct rb_node ***link,
+		struct rb_node **parent)
 {
 	struct exfat_inode_info *ei = EXFAT_I(inode);
 	struct exfat_cache *p;
 
-	list_for_each_entry(p, &ei->cache_lru, cache_list) {
-		/* Find the same part as "new" in cluster-chain. */
-		if (p->fcluster == new->fcluster) {
+	*link = &ei->cache_tree.rb_node;
+	*parent = NULL;
+	while (**link) {
+		*parent = **link;
+		p = rb_entry(*parent, struct exfat_cache, rb_node);
+		if (new->fcluster < p->fcluster) {
+			*link = &(*parent)->rb_left;
+		} else if (new->fcluster > p->fcluster) {
+			*link = &(*parent)->rb_right;
+		} else {
 			if (new->nr_contig > p->nr_contig)
 				p->nr_contig = new->nr_contig;
 			return p;
@@ -149,7 +228,8 @@ static void exfat_cache_add(struct inode *inode,
 		struct exfat_cache_id *new)
 {
 	struct exfat_inode_info *ei = EXFAT_I(inode);
-	struct exfat_cache *cache, *tmp;
+	struct rb_node **link, *parent;
+	struct exfat_cache *cache;
 
 	if (new->fcluster == EXFAT_EOF_CLUSTER) /* dummy cache */
 		return;
@@ -158,61 +238,42 @@ static void exfat_cache_add(struct inode *inode,
 	if (new->id != EXFAT_CACHE_VALID &&
 	    new->id != ei->cache_valid_id)
 		goto unlock;	/* this cache was invalidated */
+	if (exfat_cache_merge(inode, new, &link, &parent))
+		goto unlock;
+	spin_unlock(&ei->cache_lru_lock);
 
-	cache = exfat_cache_merge(inode, new);
-	if (cache == NULL) {
-		if (ei->nr_caches < EXFAT_MAX_CACHE) {
-			ei->nr_caches++;
-			spin_unlock(&ei->cache_lru_lock);
-
-			tmp = exfat_cache_alloc();
-			if (!tmp) {
-				spin_lock(&ei->cache_lru_lock);
-				ei->nr_caches--;
-				spin_unlock(&ei->cache_lru_lock);
-				return;
-			}
-
-			spin_lock(&ei->cache_lru_lock);
-			cache = exfat_cache_merge(inode, new);
-			if (cache != NULL) {
-				ei->nr_caches--;
-				exfat_cache_free(tmp);
-				goto out_update_lru;
-			}
-			cache = tmp;
-		} else {
-			struct list_head *p = ei->cache_lru.prev;
+	cache = exfat_cache_alloc();
+	if (!cache)
+		return;
+	cache->fcluster = new->fcluster;
+	cache->dcluster = new->dcluster;
+	cache->nr_contig = new->nr_contig;
 
-			cache = list_entry(p,
-					struct exfat_cache, cache_list);
-		}
-		cache->fcluster = new->fcluster;
-		cache->dcluster = new->dcluster;
-		cache->nr_contig = new->nr_contig;
+	spin_lock(&ei->cache_lru_lock);
+	if ((new->id != EXFAT_CACHE_VALID &&
+	     new->id != ei->cache_valid_id) ||
+	    exfat_cache_merge(inode, new, &link, &parent)) {
+		spin_unlock(&ei->cache_lru_lock);
+		exfat_cache_free(cache);
+		return;
 	}
-out_update_lru:
-	exfat_cache_update_lru(inode, cache);
+	rb_link_node(&cache->rb_node, parent, link);
+	rb_insert_color(&cache->rb_node, &ei->cache_tree);
+	ei->nr_caches++;
+	atomic_long_inc(&exfat_cache_count);
+	spin_unlock(&ei->cache_lru_lock);
+
+	exfat_cache_touch_inode(inode);
+	return;
 unlock:
 	spin_unlock(&ei->cache_lru_lock);
 }
 
-/*
- * Cache invalidation occurs rarely, thus the LRU chain is not updated. It
- * fixes itself after a while.
- */
 static void __exfat_cache_inval_inode(struct inode *inode)
 {
 	struct exfat_inode_info *ei = EXFAT_I(inode);
-	struct exfat_cache *cache;
 
-	while (!list_empty(&ei->cache_lru)) {
-		cache = list_entry(ei->cache_lru.next,
-				   struct exfat_cache, cache_list);
-		list_del_init(&cache->cache_list);
-		ei->nr_caches--;
-		exfat_cache_free(cache);
-	}
+	__exfat_cache_free_all(ei);
 	/* Update. The copy of caches before this id is discarded. */
 	ei->cache_valid_id++;
 	if (ei->cache_valid_id == EXFAT_CACHE_VALID)
@@ -226,6 +287,11 @@ void exfat_cache_inval_inode(struct inode *inode)
 	spin_lock(&ei->cache_lru_lock);
 	__exfat_cache_inval_inode(inode);
 	spin_unlock(&ei->cache_lru_lock);
+
+	/* Also called from ->evict_inode, the shrinker must not see it */
+	spin_lock(&exfat_cache_inodes_lock);
+	list_del_init(&ei->cache_inode_list);
+	spin_unlock(&exfat_cache_inodes_lock);
 }
 
 static inline int cache_contiguous(struct exfat_cache_id *cid,
@@ -316,8 +382,12 @@ int exfat_get_cluster(struct inode *inode, unsigned int cluster,
 			break;
 		}
 
-		if (!cache_contiguous(&cid, *dclus))
+		if (!cache_contiguous(&cid, *dclus)) {
+			/* Keep the run just left for later seeks into it */
+			cid.nr_contig--;
+			exfat_cache_add(inode, &cid);
 			cache_init(&cid, *fclus, *dclus);
+		}
 	}
 
 	exfat_cache_add(inode, &cid);
@@ -276,7 +276,10 @@ struct exfat_inode_info {
 	struct exfat_hint_femp hint_femp;
 
 	spinlock_t cache_lru_lock;
-	struct list_head cache_lru;
+	/* cluster runs, by file cluster */
+	struct rb_root cache_tree;
+	/* on the cache shrinker list */
+	struct list_head cache_inode_list;
 	int nr_caches;
 	/* for avoiding the race between alloc and free */
 	unsigned int cache_valid_id;
@@ -748,6 +748,7 @@ static void exfat_inode_init_once(void *foo)
 	struct exfat_inode_info *ei = (struct exfat_inode_info *)foo;
 
 	INIT_HLIST_NODE(&ei->i_hash_fat);
+	INIT_LIST_HEAD(&ei->cache_inode_list);
 	inode_init_once(&ei->vfs_inode);
 }
 
@@ -171,11 +171,77 @@ static void group_adjust_blocks(struct super_block *sb, int group_no,
 		spin_lock(sb_bgl_lock(sbi, group_no));
 		free_blocks = le16_to_cpu(desc->bg_free_blocks_count);
 		desc->bg_free_blocks_count = cpu_to_le16(free_blocks + count);
+		/* freed blocks may join runs, the bound no longer holds */
+		if (count > 0)
+			sbi->s_free_runs[group_no] = EXT2_FREE_RUN_UNKNOWN;
 		spin_unlock(sb_bgl_lock(sbi, group_no));
 		mark_buffer_dirty(bh);
 	}
 }
 
+/*
+ * Free run summary
+ * ----------------
+ * s_free_runs[] holds, per group, an upper bound on the longest run of free
+ * blocks in its bitmap.  It is computed when the allocator reads the bitmap
+ * of a group whose bound is unknown; allocations can only shorten runs so
+ * the bound stays valid, and frees reset it to unknown.  A scan marks the
+ * group EXT2_FREE_RUN_SCANNING first and only stores its result if no free
+ * came in meanwhile.  The allocator uses the bound to pass over groups
+ * which cannot hold the reservation window it wants without reading their
+ * bitmaps.
+ */
+static ext2_grpblk_t ext2_longest_free_run(struct buffer_head *bh,
+					    ext2_grpblk_t maxblocks)
+{
+	ext2_grpblk_t start = 0, end, best = 0;
+
+	while (start < maxblocks) {
+		start = ext2_find_next_zero_bit(bh->b_data, maxblocks, start);
+		if (start >= maxblocks)
+			break;
+		end = ext2_find_next_bit(bh->b_data, maxblocks, start);
+		if (end - start > best)
+			best = end - start;
+		start = end;
+	}
+	return best;
+}
+
+static void ext2_note_free_run(struct super_block *sb, int group,
+			       struct buffer_head *bitmap_bh)
+{
+	struct ext2_sb_info *sbi = EXT2_SB(sb);
+	ext2_grpblk_t run;
+
+	if (READ_ONCE(sbi->s_free_runs[group]) != EXT2_FREE_RUN_UNKNOWN)
+		return;
+
+	spin_lock(sb_bgl_lock(sbi, group));
+	if (sbi->s_free_runs[group] != EXT2_FREE_RUN_UNKNOWN) {
+		spin_unlock(sb_bgl_lock(sbi, group));
+		return;
+	}
+	sbi->s_free_runs[group] = EXT2_FREE_RUN_SCANNING;
+	spin_unlock(sb_bgl_lock(sbi, group));
+
+	run = ext2_longest_free_run(bitmap_bh, EXT2_BLOCKS_PER_GROUP(sb));
+
+	spin_lock(sb_bgl_lock(sbi, group));
+	if (sbi->s_free_runs[group] == EXT2_FREE_RUN_SCANNING)
+		sbi->s_free_runs[group] = run;
+	spin_unlock(sb_bgl_lock(sbi, group));
+}
+
+/* Can @group hold a free run of @len blocks, as far as we know? */
+static bool ext2_may_have_free_run(struct ext2_sb_info *sbi, int group,
+				   unsigned int len)
+{
+	unsigned int run = READ_ONCE(sbi->s_free_runs[group]);
+
+	return run >= EXT2_FREE_RUN_SCANNING || run >= len;
+}
+
 /*
  * The reservation window structure operations
  * --------------------------------------------
@@ -1300,6 +1366,7 @@ ext2_fsblk_t ext2_new_blocks(struct inode *inode, ext2_fsblk_t goal,
 		bitmap_bh = read_block_bitmap(sb, group_no);
 		if (!bitmap_bh)
 			goto io_error;
+		ext2_note_free_run(sb, group_no, bitmap_bh);
 		grp_alloc_blk = ext2_try_to_allocate_with_rsv(sb, group_no,
 					bitmap_bh, grp_target_blk,
 					my_rsv, &num);
@@ -1336,11 +1403,19 @@ ext2_fsblk_t ext2_new_blocks(struct inode *inode, ext2_fsblk_t goal,
 		 */
 		if (my_rsv && (free_blocks <= (windowsz/2)))
 			continue;
+		/*
+		 * likewise if its free space is known to be too fragmented
+		 * for that, without reading the bitmap.
+		 */
+		if (my_rsv && !ext2_may_have_free_run(sbi, group_no,
+						      windowsz / 2))
+			continue;
 
 		brelse(bitmap_bh);
 		bitmap_bh = read_block_bitmap(sb, group_no);
 		if (!bitmap_bh)
 			goto io_error;
+		ext2_note_free_run(sb, group_no, bitmap_bh);
 		/*
 		 * try to allocate block(s) from this group, without a goal(-1).
 		 */
@@ -97,6 +97,8 @@ struct ext2_sb_info {
 	u32 s_next_generation;
 	unsigned long s_dir_count;
 	u8 *s_debts;
+	/* per group upper bound on the longest free run, see balloc.c */
+	unsigned int *s_free_runs;
 	struct percpu_counter s_freeblocks_counter;
 	struct percpu_counter s_freeinodes_counter;
 	struct percpu_counter s_dirs_counter;
@@ -136,6 +138,9 @@ sb_bgl_lock(struct ext2_sb_info *sbi, unsigned int block_group)
 /*max window size: 1024(direct blocks) + 3([t,d]indirect blocks) */
 #define EXT2_MAX_RESERVE_BLOCKS         1027
 #define EXT2_RESERVE_WINDOW_NOT_ALLOCATED 0
+/* s_free_runs[] values for groups whose longest free run is not known */
+#define EXT2_FREE_RUN_UNKNOWN		UINT_MAX
+#define EXT2_FREE_RUN_SCANNING		(UINT_MAX - 1)
 /*
  * The second extended file system version
  */
@@ -830,3 +835,4 @@ ext2_group_last_block_no(struct super_block *sb, unsigned long group_no)
 #define ext2_test_bit	test_bit_le
 #define ext2_find_first_zero_bit	find_first_zero_bit_le
 #define ext2_find_next_zero_bit		find_next_zero_bit_le
+#define ext2_find_next_bit		find_next_bit_le
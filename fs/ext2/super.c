@@ -165,6 +165,7 @@ static void ext2_put_super (struct super_block * sb)
 		brelse(sbi->s_group_desc[i]);
 	kfree(sbi->s_group_desc);
 	kfree(sbi->s_debts);
+	kfree(sbi->s_free_runs);
 	percpu_counter_destroy(&sbi->s_freeblocks_counter);
 	percpu_counter_destroy(&sbi->s_freeinodes_counter);
 	percpu_counter_destroy(&sbi->s_dirs_counter);
@@ -1085,6 +1086,15 @@ static int ext2_fill_super(struct super_block *sb, void *data, int silent)
 		ext2_msg(sb, KERN_ERR, "error: not enough memory");
 		goto failed_mount_group_desc;
 	}
+	sbi->s_free_runs = kmalloc_array(sbi->s_groups_count,
+					 sizeof(*sbi->s_free_runs), GFP_KERNEL);
+	if (!sbi->s_free_runs) {
+		ret = -ENOMEM;
+		ext2_msg(sb, KERN_ERR, "error: not enough memory");
+		goto failed_mount_group_desc;
+	}
+	for (i = 0; i < sbi->s_groups_count; i++)
+		sbi->s_free_runs[i] = EXT2_FREE_RUN_UNKNOWN;
 	for (i = 0; i < db_count; i++) {
 		block = descriptor_loc(sb, logic_sb_block, i);
 		sbi->s_group_desc[i] = sb_bread(sb, block);
@@ -1198,6 +1208,7 @@ static int ext2_fill_super(struct super_block *sb, void *data, int silent)
 failed_mount_group_desc:
 	kfree(sbi->s_group_desc);
 	kfree(sbi->s_debts);
+	kfree(sbi->s_free_runs);
 failed_mount:
 	brelse(bh);
 failed_sbi:
@@ -9,14 +9,23 @@
  *  May 1999. AV. Fixed the bogosity with FAT32 (read "FAT28"). Fscking lusers.
  */
 
+#include <linux/rbtree.h>
+#include <linux/shrinker.h>
 #include <linux/slab.h>
 #include "fat.h"
 
-/* this must be > 0. */
-#define FAT_MAX_CACHE	8
-
+/*
+ * Each inode keeps the contiguous runs of its cluster chain found so far in
+ * an rbtree ordered by file cluster, so that a lookup anywhere in a large
+ * file costs O(log n) plus the walk from the nearest preceding run.  There
+ * is no limit on the number of runs per inode; instead inodes holding runs
+ * sit on a global list, oldest first, and the shrinker drops all the runs
+ * of the inodes at its head.
+ *
+ * Lock order: fat_cache_inodes_lock, then i->cache_lru_lock.
+ */
 struct fat_cache {
-	struct list_head cache_list;
+	struct rb_node rb_node;
 	int nr_contig;	/* number of contiguous clusters */
 	int fcluster;	/* cluster number in the file. */
 	int dcluster;	/* cluster number on disk. */
@@ -29,33 +38,68 @@ struct fat_cache_id {
 	int dcluster;
 };
 
-static inline int fat_max_cache(struct inode *inode)
+static struct kmem_cache *fat_cache_cachep;
+
+static LIST_HEAD(fat_cache_inodes);
+static DEFINE_SPINLOCK(fat_cache_inodes_lock);
+static atomic_long_t fat_cache_count = ATOMIC_LONG_INIT(0);
+
+static void __fat_cache_free_all(struct msdos_inode_info *i);
+
+static unsigned long fat_cache_shrink_count(struct shrinker *shrink,
+					    struct shrink_control *sc)
 {
-	return FAT_MAX_CACHE;
+	return atomic_long_read(&fat_cache_count) ?: SHRINK_EMPTY;
 }
 
-static struct kmem_cache *fat_cache_cachep;
-
-static void init_once(void *foo)
+static unsigned long fat_cache_shrink_scan(struct shrinker *shrink,
+					   struct shrink_control *sc)
 {
-	struct fat_cache *cache = (struct fat_cache *)foo;
+	struct msdos_inode_info *i;
+	unsigned long freed = 0;
+
+	spin_lock(&fat_cache_inodes_lock);
+	while (freed < sc->nr_to_scan && !list_empty(&fat_cache_inodes)) {
+		i = list_first_entry(&fat_cache_inodes, struct msdos_inode_info,
+				     cache_inode_list);
+		list_del_init(&i->cache_inode_list);
+
+		spin_lock(&i->cache_lru_lock);
+		freed += i->nr_caches;
+		__fat_cache_free_all(i);
+		spin_unlock(&i->cache_lru_lock);
+	}
+	spin_unlock(&fat_cache_inodes_lock);
 
-	INIT_LIST_HEAD(&cache->cache_list);
+	return freed;
 }
 
+static struct shrinker fat_cache_shrinker = {
+	.count_objects	= fat_cache_shrink_count,
+	.scan_objects	= fat_cache_shrink_scan,
+	.seeks		= DEFAULT_SEEKS,
+};
+
 int __init fat_cache_init(void)
 {
+	int err;
+
 	fat_cache_cachep = kmem_cache_create("fat_cache",
 				sizeof(struct fat_cache),
 				0, SLAB_RECLAIM_ACCOUNT|SLAB_MEM_SPREAD,
-				init_once);
+				NULL);
 	if (fat_cache_cachep == NULL)
 		return -ENOMEM;
-	return 0;
+
+	err = register_shrinker(&fat_cache_shrinker);
+	if (err)
+		kmem_cache_destroy(fat_cache_cachep);
+	return err;
 }
 
 void fat_cache_destroy(void)
 {
+	unregister_shrinker(&fat_cache_shrinker);
 	kmem_cache_destroy(fat_cache_cachep);
 }
 
@@ -66,41 +110,58 @@ static inline struct fat_cache *fat_cache_alloc(struct inode *inode)
 
 static inline void fat_cache_free(struct fat_cache *cache)
 {
-	BUG_ON(!list_empty(&cache->cache_list));
 	kmem_cache_free(fat_cache_cachep, cache);
 }
 
-static inline void fat_cache_update_lru(struct inode *inode,
-					struct fat_cache *cache)
+/* Caller must hold cache_lru_lock; the ids handed out stay valid */
+static void __fat_cache_free_all(struct msdos_inode_info *i)
+{
+	struct fat_cache *cache, *n;
+
+	rbtree_postorder_for_each_entry_safe(cache, n, &i->cache_tree, rb_node)
+		fat_cache_free(cache);
+	i->cache_tree = RB_ROOT;
+	atomic_long_sub(i->nr_caches, &fat_cache_count);
+	i->nr_caches = 0;
+}
+
+/* Put @inode at the tail of the shrinker list, it just gained a run */
+static void fat_cache_touch_inode(struct inode *inode)
 {
-	if (MSDOS_I(inode)->cache_lru.next != &cache->cache_list)
-		list_move(&cache->cache_list, &MSDOS_I(inode)->cache_lru);
+	struct msdos_inode_info *i = MSDOS_I(inode);
+
+	spin_lock(&fat_cache_inodes_lock);
+	list_move_tail(&i->cache_inode_list, &fat_cache_inodes);
+	spin_unlock(&fat_cache_inodes_lock);
 }
 
 static int fat_cache_lookup(struct inode *inode, int fclus,
 			    struct fat_cache_id *cid,
 			    int *cached_fclus, int *cached_dclus)
 {
-	static struct fat_cache nohit = { .fcluster = 0, };
-
-	struct fat_cache *hit = &nohit, *p;
+	struct fat_cache *hit = NULL, *p;
+	struct rb_node *node;
 	int offset = -1;
 
 	spin_lock(&MSDOS_I(inode)->cache_lru_lock);
-	list_for_each_entry(p, &MSDOS_I(inode)->cache_lru, cache_list) {
-		/* Find the cache of "fclus" or nearest cache. */
-		if (p->fcluster <= fclus && hit->fcluster < p->fcluster) {
+	/* Find the run with the last start not beyond "fclus". */
+	node = MSDOS_I(inode)->cache_tree.rb_node;
+	while (node) {
+		p = rb_entry(node, struct fat_cache, rb_node);
+		if (p->fcluster > fclus) {
+			node = node->rb_left;
+		} else {
 			hit = p;
-			if ((hit->fcluster + hit->nr_contig) < fclus) {
-				offset = hit->nr_contig;
-			} else {
-				offset = fclus - hit->fcluster;
+			if (p->fcluster == fclus)
 				break;
-			}
+			node = node->rb_right;
 		}
 	}
-	if (hit != &nohit) {
-		fat_cache_update_lru(inode, hit);
+	if (hit) {
+		if ((hit->fcluster + hit->nr_contig) < fclus)
+			offset = hit->nr_contig;
+		else
+			offset = fclus - hit->fcluster;
 
 		cid->id = MSDOS_I(inode)->cache_valid_id;
 		cid->nr_contig = hit->nr_contig;
@@ -114,14 +175,27 @@ static int fat_cache_lookup(struct inode *inode, int fclus,
 	return offset;
 }
 
+/*
+ * Find the run starting at the same place as "new" and extend it, or
+ * return where a new run has to be linked.
+ */
 static struct fat_cache *fat_cache_merge(struct inode *inode,
-					 struct fat_cache_id *new)
+					 struct fat_cache_id *new,
+					 struct rb_node ***link,
+					 struct rb_node **parent)
 {
 	struct fat_cache *p;
 
-	list_for_each_entry(p, &MSDOS_I(inode)->cache_lru, cache_list) {
-		/* Find the same part as "new" in cluster-chain. */
-		if (p->fcluster == new->fcluster) {
+	*link = &MSDOS_I(inode)->cache_tree.rb_node;
+	*parent = NULL;
+	while (**link) {
+		*parent = **link;
+		p = rb_entry(*parent, struct fat_cache, rb_node);
+		if (new->fcluster < p->fcluster) {
+			*link = &(*parent)->rb_left;
+		} else if (new->fcluster > p->fcluster) {
+			*link = &(*parent)->rb_right;
+		} else {
 			BUG_ON(p->dcluster != new->dcluster);
 			if (new->nr_contig > p->nr_contig)
 				p->nr_contig = new->nr_contig;
@@ -133,68 +207,51 @@ static struct fat_cache *fat_cache_merge(struct inode *inode,
 
 static void fat_cache_add(struct inode *inode, struct fat_cache_id *new)
 {
-	struct fat_cache *cache, *tmp;
+	struct msdos_inode_info *i = MSDOS_I(inode);
+	struct rb_node **link, *parent;
+	struct fat_cache *cache;
 
 	if (new->fcluster == -1) /* dummy cache */
 		return;
 
-	spin_lock(&MSDOS_I(inode)->cache_lru_lock);
-	if (new->id != FAT_CACHE_VALID &&
-	    new->id != MSDOS_I(inode)->cache_valid_id)
+	spin_lock(&i->cache_lru_lock);
+	if (new->id != FAT_CACHE_VALID && new->id != i->cache_valid_id)
 		goto out;	/* this cache was invalidated */
+	if (fat_cache_merge(inode, new, &link, &parent))
+		goto out;
+	spin_unlock(&i->cache_lru_lock);
 
-	cache = fat_cache_merge(inode, new);
-	if (cache == NULL) {
-		if (MSDOS_I(inode)->nr_caches < fat_max_cache(inode)) {
-			MSDOS_I(inode)->nr_caches++;
-			spin_unlock(&MSDOS_I(inode)->cache_lru_lock);
-
-			tmp = fat_cache_alloc(inode);
-			if (!tmp) {
-				spin_lock(&MSDOS_I(inode)->cache_lru_lock);
-				MSDOS_I(inode)->nr_caches--;
-				spin_unlock(&MSDOS_I(inode)->cache_lru_lock);
-				return;
-			}
-
-			spin_lock(&MSDOS_I(inode)->cache_lru_lock);
-			cache = fat_cache_merge(inode, new);
-			if (cache != NULL) {
-				MSDOS_I(inode)->nr_caches--;
-				fat_cache_free(tmp);
-				goto out_update_lru;
-			}
-			cache = tmp;
-		} else {
-			struct list_head *p = MSDOS_I(inode)->cache_lru.prev;
-			cache = list_entry(p, struct fat_cache, cache_list);
-		}
-		cache->fcluster = new->fcluster;
-		cache->dcluster = new->dcluster;
-		cache->nr_contig = new->nr_contig;
+	cache = fat_cache_alloc(inode);
+	if (!cache)
+		return;
+	cache->fcluster = new->fcluster;
+	cache->dcluster = new->dcluster;
+	cache->nr_contig = new->nr_contig;
+
+	spin_lock(&i->cache_lru_lock);
+	if ((new->id != FAT_CACHE_VALID && new->id != i->cache_valid_id) ||
+	    fat_cache_merge(inode, new, &link, &parent)) {
+		spin_unlock(&i->cache_lru_lock);
+		fat_cache_free(cache);
+		return;
 	}
-out_update_lru:
-	fat_cache_update_lru(inode, cache);
+	rb_link_node(&cache->rb_node, parent, link);
+	rb_insert_color(&cache->rb_node, &i->cache_tree);
+	i->nr_caches++;
+	atomic_long_inc(&fat_cache_count);
+	spin_unlock(&i->cache_lru_lock);
+
+	fat_cache_touch_inode(inode);
+	return;
 out:
-	spin_unlock(&MSDOS_I(inode)->cache_lru_lock);
+	spin_unlock(&i->cache_lru_lock);
 }
 
-/*
- * Cache invalidation occurs rarely, thus the LRU chain is not updated. It
- * fixes itself after a while.
- */
 static void __fat_cache_inval_inode(struct inode *inode)
 {
 	struct msdos_inode_info *i = MSDOS_I(inode);
-	struct fat_cache *cache;
 
-	while (!list_empty(&i->cache_lru)) {
-		cache = list_entry(i->cache_lru.next,
-				   struct fat_cache, cache_list);
-		list_del_init(&cache->cache_list);
-		i->nr_caches--;
-		fat_cache_free(cache);
-	}
+	__fat_cache_free_all(i);
 	/* Update. The copy of caches before this id is discarded. */
 	i->cache_valid_id++;
 	if (i->cache_valid_id == FAT_CACHE_VALID)
@@ -203,9 +260,16 @@ static void __fat_cache_inval_inode(struct inode *inode)
 
 void fat_cache_inval_inode(struct inode *inode)
 {
-	spin_lock(&MSDOS_I(inode)->cache_lru_lock);
+	struct msdos_inode_info *i = MSDOS_I(inode);
+
+	spin_lock(&i->cache_lru_lock);
 	__fat_cache_inval_inode(inode);
-	spin_unlock(&MSDOS_I(inode)->cache_lru_lock);
+	spin_unlock(&i->cache_lru_lock);
+
+	/* Also called from ->evict_inode, the shrinker must not see it */
+	spin_lock(&fat_cache_inodes_lock);
+	list_del_init(&i->cache_inode_list);
+	spin_unlock(&fat_cache_inodes_lock);
 }
 
 static inline int cache_contiguous(struct fat_cache_id *cid, int dclus)
@@ -278,8 +342,12 @@ int fat_get_cluster(struct inode *inode, int cluster, int *fclus, int *dclus)
 		}
 		(*fclus)++;
 		*dclus = nr;
-		if (!cache_contiguous(&cid, *dclus))
+		if (!cache_contiguous(&cid, *dclus)) {
+			/* Keep the run just left for later seeks into it */
+			cid.nr_contig--;
+			fat_cache_add(inode, &cid);
 			cache_init(&cid, *fclus, *dclus);
+		}
 	}
 	nr = 0;
 	fat_cache_add(inode, &cid);
@@ -111,7 +111,8 @@ struct msdos_sb_info {
  */
 struct msdos_inode_info {
 	spinlock_t cache_lru_lock;
-	struct list_head cache_lru;
+	struct rb_root cache_tree;	/* cluster runs, by file cluster */
+	struct list_head cache_inode_list; /* on the cache shrinker list */
 	int nr_caches;
 	/* for avoiding the race between fat_free() and fat_get_cluster() */
 	unsigned int cache_valid_id;
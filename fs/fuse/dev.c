@@ -12,6 +12,7 @@
 #include <linux/module.h>
 #include <linux/poll.h>
 #include <linux/sched/signal.h>
+#include <linux/sched/mm.h>
 #include <linux/uio.h>
 #include <linux/miscdevice.h>
 #include <linux/pagemap.h>
@@ -21,6 +22,8 @@
 #include <linux/swap.h>
 #include <linux/splice.h>
 #include <linux/sched.h>
+#include <linux/vmalloc.h>
+#include <linux/log2.h>
 
 MODULE_ALIAS_MISCDEV(FUSE_MINOR);
 MODULE_ALIAS("devname:fuse");
@@ -200,21 +203,64 @@ static unsigned int fuse_req_hash(u64 unique)
 	return hash_long(unique & ~FUSE_INT_REQ_BIT, FUSE_PQ_HASH_BITS);
 }
 
+/* Per-CPU queue requests issued on this CPU go to, called with fiq->lock */
+static struct fuse_iqueue_cpu *fuse_iqueue_target(struct fuse_iqueue *fiq)
+{
+	return fiq->cpuq ? this_cpu_ptr(fiq->cpuq)->target : NULL;
+}
+
 /**
  * A new request is available, wake fiq->waitq
  */
 static void fuse_dev_wake_and_unlock(struct fuse_iqueue *fiq)
 __releases(fiq->lock)
 {
+	struct fuse_iqueue_cpu *q = fuse_iqueue_target(fiq);
+
 	wake_up(&fiq->waitq);
+	/* bound readers serve forgets and interrupts too */
+	if (q)
+		wake_up(&q->waitq);
 	kill_fasync(&fiq->fasync, SIGIO, POLL_IN);
 	spin_unlock(&fiq->lock);
 }
 
+/**
+ * Move the request just queued on fiq->pending to the per-CPU queue of
+ * the issuing CPU, if devices are bound, and wake a reader there
+ */
+static void fuse_dev_wake_pending_and_unlock(struct fuse_iqueue *fiq)
+__releases(fiq->lock)
+{
+	struct fuse_iqueue_cpu *q = fuse_iqueue_target(fiq);
+	struct fuse_req *req;
+
+	if (!q) {
+		fuse_dev_wake_and_unlock(fiq);
+		return;
+	}
+
+	req = list_last_entry(&fiq->pending, struct fuse_req, list);
+	spin_lock(&q->lock);
+	list_move_tail(&req->list, &q->pending);
+	req->iq_cpu = q;
+	spin_unlock(&q->lock);
+	spin_unlock(&fiq->lock);
+
+	wake_up(&q->waitq);
+	kill_fasync(&fiq->fasync, SIGIO, POLL_IN);
+}
+
+static void fuse_dev_fiq_release(struct fuse_iqueue *fiq)
+{
+	free_percpu(fiq->cpuq);
+}
+
 const struct fuse_iqueue_ops fuse_dev_fiq_ops = {
 	.wake_forget_and_unlock		= fuse_dev_wake_and_unlock,
 	.wake_interrupt_and_unlock	= fuse_dev_wake_and_unlock,
-	.wake_pending_and_unlock	= fuse_dev_wake_and_unlock,
+	.wake_pending_and_unlock	= fuse_dev_wake_pending_and_unlock,
+	.release			= fuse_dev_fiq_release,
 };
 EXPORT_SYMBOL_GPL(fuse_dev_fiq_ops);
 
@@ -357,6 +403,25 @@ static int queue_interrupt(struct fuse_iqueue *fiq, struct fuse_req *req)
 	return 0;
 }
 
+/*
+ * Take a request which has not been read yet off its input queue, called
+ * with fiq->lock held.  Returns false if it was already read.
+ */
+static bool fuse_iqueue_unlink(struct fuse_iqueue *fiq, struct fuse_req *req)
+{
+	struct fuse_iqueue_cpu *q = req->iq_cpu;
+	bool pending;
+
+	if (q)
+		spin_lock(&q->lock);
+	pending = test_bit(FR_PENDING, &req->flags);
+	if (pending)
+		list_del(&req->list);
+	if (q)
+		spin_unlock(&q->lock);
+	return pending;
+}
+
 static void request_wait_answer(struct fuse_conn *fc, struct fuse_req *req)
 {
 	struct fuse_iqueue *fiq = &fc->iq;
@@ -385,8 +450,7 @@ static void request_wait_answer(struct fuse_conn *fc, struct fuse_req *req)
 
 		spin_lock(&fiq->lock);
 		/* Request is not yet in userspace, bail out */
-		if (test_bit(FR_PENDING, &req->flags)) {
-			list_del(&req->list);
+		if (fuse_iqueue_unlink(fiq, req)) {
 			spin_unlock(&fiq->lock);
 			__fuse_put_request(req);
 			req->out.h.error = -EINTR;
@@ -1172,12 +1236,25 @@ __releases(fiq->lock)
  * fuse_request_end().  Otherwise add it to the processing list, and set
  * the 'sent' flag.
  */
-static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
+/* Wait until fuse_dev_do_read() may find something to do for @fud */
+static int fuse_dev_wait_read(struct fuse_dev *fud)
+{
+	struct fuse_iqueue *fiq = &fud->fc->iq;
+	struct fuse_iqueue_cpu *q = READ_ONCE(fud->iq_cpu);
+
+	return wait_event_interruptible_exclusive(q ? q->waitq : fiq->waitq,
+			!fiq->connected || request_pending(fiq) ||
+			(q && !list_empty(&q->pending)) ||
+			READ_ONCE(fud->iq_cpu) != q);
+}
+
+static ssize_t fuse_dev_do_read(struct fuse_dev *fud, bool nonblock,
 				struct fuse_copy_state *cs, size_t nbytes)
 {
 	ssize_t err;
 	struct fuse_conn *fc = fud->fc;
 	struct fuse_iqueue *fiq = &fc->iq;
+	struct fuse_iqueue_cpu *q;
 	struct fuse_pqueue *fpq = &fud->pq;
 	struct fuse_req *req;
 	struct fuse_args *args;
@@ -1204,15 +1281,34 @@ static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
 
  restart:
 	for (;;) {
+		/*
+		 * A bound device serves its own CPU queue first, but not
+		 * ahead of interrupts, which only ever queue on the shared
+		 * queue and must not wait behind a busy CPU.
+		 */
+		q = READ_ONCE(fud->iq_cpu);
+		if (q && !list_empty(&q->pending) &&
+		    list_empty_careful(&fiq->interrupts)) {
+			spin_lock(&q->lock);
+			if (!list_empty(&q->pending)) {
+				req = list_first_entry(&q->pending,
+						       struct fuse_req, list);
+				clear_bit(FR_PENDING, &req->flags);
+				list_del_init(&req->list);
+				spin_unlock(&q->lock);
+				goto found;
+			}
+			spin_unlock(&q->lock);
+		}
+
 		spin_lock(&fiq->lock);
 		if (!fiq->connected || request_pending(fiq))
 			break;
 		spin_unlock(&fiq->lock);
 
-		if (file->f_flags & O_NONBLOCK)
+		if (nonblock)
 			return -EAGAIN;
-		err = wait_event_interruptible_exclusive(fiq->waitq,
-				!fiq->connected || request_pending(fiq));
+		err = fuse_dev_wait_read(fud);
 		if (err)
 			return err;
 	}
@@ -1241,6 +1337,7 @@ static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
 	list_del_init(&req->list);
 	spin_unlock(&fiq->lock);
 
+found:
 	args = req->args;
 	reqsize = req->in.h.len;
 
@@ -1326,7 +1423,8 @@ static ssize_t fuse_dev_read(struct kiocb *iocb, struct iov_iter *to)
 
 	fuse_copy_init(&cs, 1, to);
 
-	return fuse_dev_do_read(fud, file, &cs, iov_iter_count(to));
+	return fuse_dev_do_read(fud, file->f_flags & O_NONBLOCK, &cs,
+				iov_iter_count(to));
 }
 
 static ssize_t fuse_dev_splice_read(struct file *in, loff_t *ppos,
@@ -1350,7 +1448,7 @@ static ssize_t fuse_dev_splice_read(struct file *in, loff_t *ppos,
 	fuse_copy_init(&cs, 1, NULL);
 	cs.pipebufs = bufs;
 	cs.pipe = pipe;
-	ret = fuse_dev_do_read(fud, in, &cs, len);
+	ret = fuse_dev_do_read(fud, in->f_flags & O_NONBLOCK, &cs, len);
 	if (ret < 0)
 		goto out;
 
@@ -2033,11 +2131,14 @@ static __poll_t fuse_dev_poll(struct file *file, poll_table *wait)
 
 	fiq = &fud->fc->iq;
 	poll_wait(file, &fiq->waitq, wait);
+	if (fud->iq_cpu)
+		poll_wait(file, &fud->iq_cpu->waitq, wait);
 
 	spin_lock(&fiq->lock);
 	if (!fiq->connected)
 		mask = EPOLLERR;
-	else if (request_pending(fiq))
+	else if (request_pending(fiq) ||
+		 (fud->iq_cpu && !list_empty(&fud->iq_cpu->pending)))
 		mask |= EPOLLIN | EPOLLRDNORM;
 	spin_unlock(&fiq->lock);
 
@@ -2139,6 +2240,21 @@ void fuse_abort_conn(struct fuse_conn *fc)
 		list_for_each_entry(req, &fiq->pending, list)
 			clear_bit(FR_PENDING, &req->flags);
 		list_splice_tail_init(&fiq->pending, &to_end);
+		if (fiq->cpuq) {
+			int cpu;
+
+			for_each_possible_cpu(cpu) {
+				struct fuse_iqueue_cpu *q =
+					per_cpu_ptr(fiq->cpuq, cpu);
+
+				spin_lock(&q->lock);
+				list_for_each_entry(req, &q->pending, list)
+					clear_bit(FR_PENDING, &req->flags);
+				list_splice_tail_init(&q->pending, &to_end);
+				spin_unlock(&q->lock);
+				wake_up_all(&q->waitq);
+			}
+		}
 		while (forget_pending(fiq))
 			kfree(fuse_dequeue_forget(fiq, 1, NULL));
 		wake_up_all(&fiq->waitq);
@@ -2162,6 +2278,129 @@ void fuse_wait_aborted(struct fuse_conn *fc)
 	wait_event(fc->blocked_waitq, atomic_read(&fc->num_waiting) == 0);
 }
 
+static void fuse_ring_free(struct fuse_ring *ring);
+
+/*
+ * Point every CPU at the queue its requests should go to: its own if a
+ * device is bound to it, else that of a bound CPU on the same node, else
+ * that of any bound CPU.  Called with fiq->lock held.
+ */
+static void fuse_iqueue_retarget(struct fuse_iqueue *fiq)
+{
+	int cpu, other;
+
+	for_each_possible_cpu(cpu) {
+		struct fuse_iqueue_cpu *q = per_cpu_ptr(fiq->cpuq, cpu);
+
+		q->target = NULL;
+		if (q->readers) {
+			q->target = q;
+			continue;
+		}
+		for_each_cpu(other, cpumask_of_node(cpu_to_node(cpu))) {
+			if (per_cpu_ptr(fiq->cpuq, other)->readers) {
+				q->target = per_cpu_ptr(fiq->cpuq, other);
+				break;
+			}
+		}
+		if (q->target)
+			continue;
+		for_each_possible_cpu(other) {
+			if (per_cpu_ptr(fiq->cpuq, other)->readers) {
+				q->target = per_cpu_ptr(fiq->cpuq, other);
+				break;
+			}
+		}
+	}
+}
+
+static int fuse_dev_bind_cpu(struct fuse_dev *fud, u32 cpu)
+{
+	struct fuse_iqueue *fiq = &fud->fc->iq;
+	struct fuse_iqueue_cpu __percpu *cpuq;
+	struct fuse_iqueue_cpu *q;
+	int i, err = 0;
+
+	if (fiq->ops != &fuse_dev_fiq_ops)
+		return -EOPNOTSUPP;
+	if (cpu >= nr_cpu_ids || !cpu_possible(cpu))
+		return -EINVAL;
+
+	if (!READ_ONCE(fiq->cpuq)) {
+		cpuq = alloc_percpu(struct fuse_iqueue_cpu);
+		if (!cpuq)
+			return -ENOMEM;
+		for_each_possible_cpu(i) {
+			q = per_cpu_ptr(cpuq, i);
+			spin_lock_init(&q->lock);
+			INIT_LIST_HEAD(&q->pending);
+			init_waitqueue_head(&q->waitq);
+		}
+
+		spin_lock(&fiq->lock);
+		if (!fiq->cpuq) {
+			fiq->cpuq = cpuq;
+			cpuq = NULL;
+		}
+		spin_unlock(&fiq->lock);
+		free_percpu(cpuq);
+	}
+
+	spin_lock(&fiq->lock);
+	if (fud->iq_cpu) {
+		err = -EBUSY;
+	} else {
+		q = per_cpu_ptr(fiq->cpuq, cpu);
+		q->readers++;
+		WRITE_ONCE(fud->iq_cpu, q);
+		fuse_iqueue_retarget(fiq);
+		/*
+		 * Readers of this device already asleep wait on fiq->waitq,
+		 * but new requests now wake q->waitq.  Kick them over.
+		 */
+		wake_up_all(&fiq->waitq);
+	}
+	spin_unlock(&fiq->lock);
+	return err;
+}
+
+/* Hand the requests left on the queue of @fud to whoever serves it now */
+static void fuse_dev_unbind_cpu(struct fuse_dev *fud)
+{
+	struct fuse_iqueue *fiq = &fud->fc->iq;
+	struct fuse_iqueue_cpu *q = fud->iq_cpu;
+	struct fuse_iqueue_cpu *target;
+	struct fuse_req *req;
+
+	if (!q)
+		return;
+
+	spin_lock(&fiq->lock);
+	WRITE_ONCE(fud->iq_cpu, NULL);
+	q->readers--;
+	fuse_iqueue_retarget(fiq);
+
+	target = q->target;
+	if (target != q) {
+		spin_lock(&q->lock);
+		if (target) {
+			spin_lock_nested(&target->lock, SINGLE_DEPTH_NESTING);
+			list_for_each_entry(req, &q->pending, list)
+				req->iq_cpu = target;
+			list_splice_tail_init(&q->pending, &target->pending);
+			spin_unlock(&target->lock);
+			wake_up_all(&target->waitq);
+		} else {
+			list_for_each_entry(req, &q->pending, list)
+				req->iq_cpu = NULL;
+			list_splice_tail_init(&q->pending, &fiq->pending);
+			wake_up_all(&fiq->waitq);
+		}
+		spin_unlock(&q->lock);
+	}
+	spin_unlock(&fiq->lock);
+}
+
 int fuse_dev_release(struct inode *inode, struct file *file)
 {
 	struct fuse_dev *fud = fuse_get_dev(file);
@@ -2179,6 +2418,8 @@ int fuse_dev_release(struct inode *inode, struct file *file)
 		spin_unlock(&fpq->lock);
 
 		end_requests(fc, &to_end);
+		fuse_ring_free(fud->ring);
+		fuse_dev_unbind_cpu(fud);
 
 		/* Are we the last open device? */
 		if (atomic_dec_and_test(&fc->dev_count)) {
@@ -2219,11 +2460,278 @@ static int fuse_device_clone(struct fuse_conn *fc, struct file *new)
 	return 0;
 }
 
+/*
+ * Shared request ring.  The mapping holds a fuse_ring_hdr followed by the
+ * request and completion rings of slot numbers, and from slots_off on the
+ * slots themselves, each starting on a page boundary.  Requests and
+ * replies are copied straight into and out of the slots with the regular
+ * read and write paths, going through a bvec iterator over the pages of
+ * the slot instead of a user buffer.
+ */
+#define FUSE_RING_MAX_ENTRIES	256
+#define FUSE_RING_MAX_SIZE	(64 << 20)
+
+struct fuse_ring {
+	struct mutex lock;
+	void *mem;
+	size_t size;
+	/* charged for size against RLIMIT_MEMLOCK */
+	struct mm_struct *mm;
+	unsigned int entries;
+	unsigned int entry_size;
+	unsigned int slot_stride;
+	struct fuse_ring_hdr *hdr;
+	u32 *req;
+	u32 *cmp;
+	void *slots;
+	/* kernel copies of the indexes only it advances */
+	u32 req_tail;
+	u32 cmp_head;
+	unsigned long *busy;
+	struct bio_vec *bvec;
+};
+
+static void fuse_ring_free(struct fuse_ring *ring)
+{
+	if (!ring)
+		return;
+	if (ring->mm) {
+		account_locked_vm(ring->mm, ring->size >> PAGE_SHIFT, false);
+		mmdrop(ring->mm);
+	}
+	vfree(ring->mem);
+	bitmap_free(ring->busy);
+	kfree(ring->bvec);
+	kfree(ring);
+}
+
+static int fuse_ring_setup(struct fuse_dev *fud,
+			   struct fuse_ring_setup __user *argp)
+{
+	struct fuse_ring_setup setup;
+	struct fuse_ring *ring;
+	size_t rings, size;
+	int err;
+
+	if (copy_from_user(&setup, argp, sizeof(setup)))
+		return -EFAULT;
+
+	/* every slot must take any request, like a read buffer does */
+	if (!setup.entries || setup.entries > FUSE_RING_MAX_ENTRIES ||
+	    !is_power_of_2(setup.entries) ||
+	    setup.entry_size < max_t(size_t, FUSE_MIN_READ_BUFFER,
+				     sizeof(struct fuse_in_header) +
+				     sizeof(struct fuse_write_in) +
+				     fud->fc->max_write))
+		return -EINVAL;
+
+	rings = PAGE_ALIGN(sizeof(struct fuse_ring_hdr) +
+			   2 * setup.entries * sizeof(u32));
+	if (setup.entry_size > FUSE_RING_MAX_SIZE / setup.entries)
+		return -EINVAL;
+	size = rings + setup.entries * PAGE_ALIGN(setup.entry_size);
+	if (size > FUSE_RING_MAX_SIZE)
+		return -EINVAL;
+
+	ring = kzalloc(sizeof(*ring), GFP_KERNEL);
+	if (!ring)
+		return -ENOMEM;
+
+	/* The ring stays pinned for as long as the device is open */
+	err = account_locked_vm(current->mm, size >> PAGE_SHIFT, true);
+	if (err) {
+		kfree(ring);
+		return err;
+	}
+	mmgrab(current->mm);
+	ring->mm = current->mm;
+
+	mutex_init(&ring->lock);
+	ring->size = size;
+	ring->entries = setup.entries;
+	ring->entry_size = setup.entry_size;
+	ring->slot_stride = PAGE_ALIGN(setup.entry_size);
+	ring->mem = vmalloc_user(size);
+	ring->busy = bitmap_zalloc(setup.entries, GFP_KERNEL);
+	ring->bvec = kcalloc(ring->slot_stride >> PAGE_SHIFT,
+			     sizeof(*ring->bvec), GFP_KERNEL);
+	if (!ring->mem || !ring->busy || !ring->bvec) {
+		fuse_ring_free(ring);
+		return -ENOMEM;
+	}
+	ring->hdr = ring->mem;
+	ring->req = ring->mem + sizeof(struct fuse_ring_hdr);
+	ring->cmp = ring->req + setup.entries;
+	ring->slots = ring->mem + rings;
+
+	setup.req_off = sizeof(struct fuse_ring_hdr);
+	setup.cmp_off = setup.req_off + setup.entries * sizeof(u32);
+	setup.slots_off = rings;
+	setup.slot_stride = ring->slot_stride;
+	setup.size = size;
+	if (copy_to_user(argp, &setup, sizeof(setup))) {
+		fuse_ring_free(ring);
+		return -EFAULT;
+	}
+
+	if (cmpxchg(&fud->ring, NULL, ring)) {
+		fuse_ring_free(ring);
+		return -EBUSY;
+	}
+	return 0;
+}
+
+/* Point @iter at the first @len bytes of @slot */
+static void fuse_ring_iter(struct fuse_ring *ring, unsigned int slot,
+			   unsigned int dir, size_t len, struct iov_iter *iter)
+{
+	void *addr = ring->slots + (size_t)slot * ring->slot_stride;
+	unsigned int i, nr = DIV_ROUND_UP(len, PAGE_SIZE);
+
+	for (i = 0; i < nr; i++) {
+		ring->bvec[i].bv_page = vmalloc_to_page(addr + i * PAGE_SIZE);
+		ring->bvec[i].bv_offset = 0;
+		ring->bvec[i].bv_len = PAGE_SIZE;
+	}
+	iov_iter_bvec(iter, dir, ring->bvec, nr, len);
+}
+
+/* Take back the slots queued on the completion ring */
+static void fuse_ring_complete(struct fuse_dev *fud, struct fuse_ring *ring)
+{
+	const u32 mask = ring->entries - 1;
+	u32 tail = smp_load_acquire(&ring->hdr->cmp_tail);
+	u32 head = ring->cmp_head;
+
+	if (tail - head > ring->entries)
+		tail = head + ring->entries;
+
+	for (; head != tail; head++) {
+		struct fuse_out_header *oh;
+		struct fuse_copy_state cs;
+		struct iov_iter iter;
+		u32 slot = READ_ONCE(ring->cmp[head & mask]);
+		u32 len;
+
+		if (slot >= ring->entries || !test_bit(slot, ring->busy))
+			continue;
+		clear_bit(slot, ring->busy);
+
+		oh = ring->slots + (size_t)slot * ring->slot_stride;
+		len = READ_ONCE(oh->len);
+		if (!len || len > ring->entry_size)
+			continue;
+
+		fuse_ring_iter(ring, slot, WRITE, len, &iter);
+		fuse_copy_init(&cs, 0, &iter);
+		fuse_dev_do_write(fud, &cs, len);
+	}
+
+	ring->cmp_head = head;
+	smp_store_release(&ring->hdr->cmp_head, head);
+}
+
+static long fuse_ring_enter(struct fuse_dev *fud, unsigned long flags)
+{
+	struct fuse_ring *ring = READ_ONCE(fud->ring);
+	u32 head;
+	long nr = 0;
+	ssize_t ret = 0;
+
+	if (!ring)
+		return -ENODEV;
+	if (flags & ~FUSE_RING_ENTER_WAIT)
+		return -EINVAL;
+
+	mutex_lock(&ring->lock);
+retry:
+	fuse_ring_complete(fud, ring);
+
+	head = READ_ONCE(ring->hdr->req_head);
+	while (ring->req_tail - head < ring->entries) {
+		struct fuse_copy_state cs;
+		struct iov_iter iter;
+		unsigned int slot;
+
+		slot = find_first_zero_bit(ring->busy, ring->entries);
+		if (slot >= ring->entries)
+			break;
+
+		fuse_ring_iter(ring, slot, READ, ring->entry_size, &iter);
+		fuse_copy_init(&cs, 1, &iter);
+		ret = fuse_dev_do_read(fud, true, &cs, ring->entry_size);
+		if (ret < 0)
+			break;
+
+		set_bit(slot, ring->busy);
+		WRITE_ONCE(ring->req[ring->req_tail & (ring->entries - 1)],
+			   slot);
+		ring->req_tail++;
+		nr++;
+	}
+	smp_store_release(&ring->hdr->req_tail, ring->req_tail);
+
+	/*
+	 * Wait without the lock: the daemon may complete requests or enter
+	 * the ring from other threads meanwhile.
+	 */
+	if (!nr && ret == -EAGAIN && (flags & FUSE_RING_ENTER_WAIT)) {
+		mutex_unlock(&ring->lock);
+		ret = fuse_dev_wait_read(fud);
+		if (ret)
+			return ret;
+		mutex_lock(&ring->lock);
+		goto retry;
+	}
+	mutex_unlock(&ring->lock);
+
+	if (nr || ret == -EAGAIN)
+		return nr;
+	return ret;
+}
+
+static int fuse_dev_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct fuse_dev *fud = fuse_get_dev(file);
+	struct fuse_ring *ring;
+
+	if (!fud)
+		return -EPERM;
+
+	ring = READ_ONCE(fud->ring);
+	if (!ring)
+		return -ENODEV;
+
+	return remap_vmalloc_range(vma, ring->mem, vma->vm_pgoff);
+}
+
 static long fuse_dev_ioctl(struct file *file, unsigned int cmd,
 			   unsigned long arg)
 {
 	int err = -ENOTTY;
 
+	if (cmd == FUSE_DEV_IOC_RING_SETUP || cmd == FUSE_DEV_IOC_RING_ENTER) {
+		struct fuse_dev *fud = fuse_get_dev(file);
+
+		/* CUSE shares this handler but not the mmap() */
+		if (!fud || file->f_op != &fuse_dev_operations)
+			return -EPERM;
+		if (cmd == FUSE_DEV_IOC_RING_SETUP)
+			return fuse_ring_setup(fud, (void __user *)arg);
+		return fuse_ring_enter(fud, arg);
+	}
+
+	if (cmd == FUSE_DEV_IOC_BIND_CPU) {
+		struct fuse_dev *fud = fuse_get_dev(file);
+		u32 cpu;
+
+		if (!fud)
+			return -EPERM;
+		if (get_user(cpu, (__u32 __user *)arg))
+			return -EFAULT;
+		return fuse_dev_bind_cpu(fud, cpu);
+	}
+
 	if (cmd == FUSE_DEV_IOC_CLONE) {
 		int oldfd;
 
@@ -2266,6 +2774,7 @@ const struct file_operations fuse_dev_operations = {
 	.poll		= fuse_dev_poll,
 	.release	= fuse_dev_release,
 	.fasync		= fuse_dev_fasync,
+	.mmap		= fuse_dev_mmap,
 	.unlocked_ioctl = fuse_dev_ioctl,
 	.compat_ioctl   = compat_ptr_ioctl,
 };
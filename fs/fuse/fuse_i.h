@@ -206,6 +206,9 @@ struct fuse_file {
 		/* Version of cache we are reading */
 		u64 version;
 
+		/* Size of the next READDIR(PLUS) reply, adapted per stream */
+		unsigned int bufsize;
+
 	} readdir;
 
 	/** RB node to be linked on fuse_conn->polled_files */
@@ -340,6 +343,9 @@ struct fuse_req {
 	/** refcount */
 	refcount_t count;
 
+	/** Per-CPU input queue the request is pending on, if any */
+	struct fuse_iqueue_cpu *iq_cpu;
+
 	/* Request flags, updated with test/set/clear_bit() */
 	unsigned long flags;
 
@@ -400,6 +406,26 @@ struct fuse_iqueue_ops {
 /** /dev/fuse input queue operations */
 extern const struct fuse_iqueue_ops fuse_dev_fiq_ops;
 
+/**
+ * Per-CPU input queue, served by the devices bound to the CPU
+ */
+struct fuse_iqueue_cpu {
+	/** Lock protecting pending, nests inside fiq->lock */
+	spinlock_t lock;
+
+	/** Requests issued on CPUs routed here */
+	struct list_head pending;
+
+	/** Readers bound to this CPU are waiting on this */
+	wait_queue_head_t waitq;
+
+	/** Number of devices bound to this CPU, under fiq->lock */
+	unsigned int readers;
+
+	/** Queue requests issued on this CPU go to, under fiq->lock */
+	struct fuse_iqueue_cpu *target;
+};
+
 struct fuse_iqueue {
 	/** Connection established */
 	unsigned connected;
@@ -434,6 +460,9 @@ struct fuse_iqueue {
 
 	/** Device-specific state */
 	void *priv;
+
+	/** Per-CPU queues, allocated when a device is first bound */
+	struct fuse_iqueue_cpu __percpu *cpuq;
 };
 
 #define FUSE_PQ_HASH_BITS 8
@@ -465,6 +494,12 @@ struct fuse_dev {
 
 	/** list entry on fc->devices */
 	struct list_head entry;
+
+	/** Shared request ring, if set up */
+	struct fuse_ring *ring;
+
+	/** Per-CPU input queue this device is bound to */
+	struct fuse_iqueue_cpu *iq_cpu;
 };
 
 struct fuse_fs_context {
@@ -13,6 +13,9 @@
 #include <linux/pagemap.h>
 #include <linux/highmem.h>
 
+/* Largest READDIR(PLUS) reply asked for, further bounded by max_pages */
+#define FUSE_READDIR_MAX_SIZE	(1 << 20)
+
 static bool fuse_use_readdirplus(struct inode *dir, struct dir_context *ctx)
 {
 	struct fuse_conn *fc = get_fuse_conn(dir);
@@ -121,9 +124,26 @@ static bool fuse_emit(struct file *file, struct dir_context *ctx,
 			dirent->type);
 }
 
+/*
+ * Entries which did not fit into the caller's buffer still go into the
+ * readdir cache, so that a large reply is not thrown away.
+ */
+static void fuse_cache_dirent(struct file *file, struct fuse_dirent *dirent,
+			      loff_t pos)
+{
+	struct fuse_file *ff = file->private_data;
+
+	if (ff->open_flags & FOPEN_CACHE_DIR)
+		fuse_add_dirent_to_cache(file, dirent, pos);
+}
+
+/* Return 1 if the caller's buffer filled up before the reply was used up */
 static int parse_dirfile(char *buf, size_t nbytes, struct file *file,
 			 struct dir_context *ctx)
 {
+	loff_t pos = ctx->pos;
+	int over = 0;
+
 	while (nbytes >= FUSE_NAME_OFFSET) {
 		struct fuse_dirent *dirent = (struct fuse_dirent *) buf;
 		size_t reclen = FUSE_DIRENT_SIZE(dirent);
@@ -134,15 +154,19 @@ static int parse_dirfile(char *buf, size_t nbytes, struct file *file,
 		if (memchr(dirent->name, '/', dirent->namelen) != NULL)
 			return -EIO;
 
-		if (!fuse_emit(file, ctx, dirent))
-			break;
+		if (over)
+			fuse_cache_dirent(file, dirent, pos);
+		else
+			over = !fuse_emit(file, ctx, dirent);
+		if (!over)
+			ctx->pos = dirent->off;
 
 		buf += reclen;
 		nbytes -= reclen;
-		ctx->pos = dirent->off;
+		pos = dirent->off;
 	}
 
-	return 0;
+	return over;
 }
 
 static int fuse_direntplus_link(struct file *file,
@@ -275,6 +299,7 @@ static int parse_dirplusfile(char *buf, size_t nbytes, struct file *file,
 {
 	struct fuse_direntplus *direntplus;
 	struct fuse_dirent *dirent;
+	loff_t pos = ctx->pos;
 	size_t reclen;
 	int over = 0;
 	int ret;
@@ -301,17 +326,42 @@ static int parse_dirplusfile(char *buf, size_t nbytes, struct file *file,
 			over = !fuse_emit(file, ctx, dirent);
 			if (!over)
 				ctx->pos = dirent->off;
+		} else {
+			fuse_cache_dirent(file, dirent, pos);
 		}
 
 		buf += reclen;
 		nbytes -= reclen;
+		pos = dirent->off;
 
 		ret = fuse_direntplus_link(file, direntplus, attr_version);
 		if (ret)
 			fuse_force_forget(file, direntplus->entry_out.nodeid);
 	}
 
-	return 0;
+	return over;
+}
+
+/*
+ * Allocate a physically contiguous reply buffer of up to *size bytes,
+ * settling for less when memory is fragmented.
+ */
+static struct page *fuse_readdir_alloc(unsigned int *size)
+{
+	unsigned int order = get_order(*size);
+	struct page *page;
+
+	for (;; order--) {
+		gfp_t gfp = GFP_KERNEL;
+
+		if (order)
+			gfp |= __GFP_NOWARN | __GFP_NORETRY;
+		page = alloc_pages(gfp, order);
+		if (page || !order)
+			break;
+	}
+	*size = min_t(unsigned int, *size, PAGE_SIZE << order);
+	return page;
 }
 
 static int fuse_readdir_uncached(struct file *file, struct dir_context *ctx)
@@ -321,36 +371,68 @@ static int fuse_readdir_uncached(struct file *file, struct dir_context *ctx)
 	struct page *page;
 	struct inode *inode = file_inode(file);
 	struct fuse_conn *fc = get_fuse_conn(inode);
+	struct fuse_file *ff = file->private_data;
 	struct fuse_io_args ia = {};
 	struct fuse_args_pages *ap = &ia.ap;
-	struct fuse_page_desc desc = { .length = PAGE_SIZE };
+	struct fuse_page_desc desc_onstack;
+	struct page *page_onstack;
+	struct fuse_page_desc *descs = &desc_onstack;
+	struct page **pages = &page_onstack;
+	unsigned int maxsize, bufsize, i, nr;
 	u64 attr_version = 0;
 	bool locked;
 
-	page = alloc_page(GFP_KERNEL);
+	/*
+	 * Start a stream with a single page and double the reply size for
+	 * as long as replies come back well filled and are used up, so that
+	 * scans of huge directories take few round trips while a short
+	 * getdents of a small one does not pull in more than it needs.
+	 */
+	maxsize = min_t(unsigned int, fc->max_pages << PAGE_SHIFT,
+			FUSE_READDIR_MAX_SIZE);
+	bufsize = clamp_t(unsigned int, ff->readdir.bufsize, PAGE_SIZE,
+			  maxsize);
+
+	page = fuse_readdir_alloc(&bufsize);
 	if (!page)
 		return -ENOMEM;
 
+	nr = bufsize >> PAGE_SHIFT;
+	if (nr > 1) {
+		pages = kcalloc(nr, sizeof(*pages) + sizeof(*descs),
+				GFP_KERNEL);
+		if (!pages) {
+			__free_pages(page, get_order(bufsize));
+			return -ENOMEM;
+		}
+		descs = (void *)(pages + nr);
+	}
+	for (i = 0; i < nr; i++) {
+		pages[i] = page + i;
+		descs[i].offset = 0;
+		descs[i].length = PAGE_SIZE;
+	}
+
 	plus = fuse_use_readdirplus(inode, ctx);
 	ap->args.out_pages = true;
-	ap->num_pages = 1;
-	ap->pages = &page;
-	ap->descs = &desc;
+	ap->num_pages = nr;
+	ap->pages = pages;
+	ap->descs = descs;
 	if (plus) {
 		attr_version = fuse_get_attr_version(fc);
-		fuse_read_args_fill(&ia, file, ctx->pos, PAGE_SIZE,
+		fuse_read_args_fill(&ia, file, ctx->pos, bufsize,
 				    FUSE_READDIRPLUS);
 	} else {
-		fuse_read_args_fill(&ia, file, ctx->pos, PAGE_SIZE,
+		fuse_read_args_fill(&ia, file, ctx->pos, bufsize,
 				    FUSE_READDIR);
 	}
 	locked = fuse_lock_inode(inode);
 	res = fuse_simple_request(fc, &ap->args);
 	fuse_unlock_inode(inode, locked);
 	if (res >= 0) {
-		if (!res) {
-			struct fuse_file *ff = file->private_data;
+		ssize_t len = res;
 
+		if (!res) {
 			if (ff->open_flags & FOPEN_CACHE_DIR)
 				fuse_readdir_cache_end(file, ctx->pos);
 		} else if (plus) {
@@ -360,9 +442,24 @@ static int fuse_readdir_uncached(struct file *file, struct dir_context *ctx)
 			res = parse_dirfile(page_address(page), res, file,
 					    ctx);
 		}
+
+		/*
+		 * Entries beyond the caller's buffer are kept in the readdir
+		 * cache, or linked into the dcache for READDIRPLUS, and are
+		 * only lost for plain uncached READDIR.
+		 */
+		if (res > 0 && !plus && !(ff->open_flags & FOPEN_CACHE_DIR))
+			ff->readdir.bufsize = max_t(unsigned int, bufsize / 2,
+						    PAGE_SIZE);
+		else if (res >= 0 && len > bufsize / 2)
+			ff->readdir.bufsize = min(bufsize * 2, maxsize);
+		if (res > 0)
+			res = 0;
 	}
 
-	__free_page(page);
+	if (pages != &page_onstack)
+		kfree(pages);
+	__free_pages(page, get_order(bufsize));
 	fuse_invalidate_atime(inode);
 	return res;
 }
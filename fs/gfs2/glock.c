@@ -30,7 +30,7 @@
 #include <linux/rculist_bl.h>
 #include <linux/bit_spinlock.h>
 #include <linux/percpu.h>
-#include <linux/list_sort.h>
+#include <linux/list_lru.h>
 #include <linux/lockref.h>
 #include <linux/rhashtable.h>
 
@@ -62,9 +62,7 @@ static void do_xmote(struct gfs2_glock *gl, struct gfs2_holder *gh, unsigned int
 static struct dentry *gfs2_root;
 static struct workqueue_struct *glock_workqueue;
 struct workqueue_struct *gfs2_delete_workqueue;
-static LIST_HEAD(lru_list);
-static atomic_t lru_count = ATOMIC_INIT(0);
-static DEFINE_SPINLOCK(lru_lock);
+static struct list_lru gfs2_glock_lru;
 
 #define GFS2_GL_HASH_SHIFT      15
 #define GFS2_GL_HASH_SIZE       BIT(GFS2_GL_HASH_SHIFT)
@@ -204,23 +202,19 @@ static int demote_ok(const struct gfs2_glock *gl)
 	return 1;
 }
 
-
+/*
+ * Must be called with gl_lockref.lock held, which keeps gfs2_glock_isolate()
+ * from taking the glock off the list before GLF_LRU is set.
+ */
 void gfs2_glock_add_to_lru(struct gfs2_glock *gl)
 {
 	if (!(gl->gl_ops->go_flags & GLOF_LRU))
 		return;
 
-	spin_lock(&lru_lock);
-
-	list_del(&gl->gl_lru);
-	list_add_tail(&gl->gl_lru, &lru_list);
-
-	if (!test_bit(GLF_LRU, &gl->gl_flags)) {
+	/* Move to the tail of its node's list */
+	list_lru_del(&gfs2_glock_lru, &gl->gl_lru);
+	if (list_lru_add(&gfs2_glock_lru, &gl->gl_lru))
 		set_bit(GLF_LRU, &gl->gl_flags);
-		atomic_inc(&lru_count);
-	}
-
-	spin_unlock(&lru_lock);
 }
 
 static void gfs2_glock_remove_from_lru(struct gfs2_glock *gl)
@@ -228,13 +222,8 @@ static void gfs2_glock_remove_from_lru(struct gfs2_glock *gl)
 	if (!(gl->gl_ops->go_flags & GLOF_LRU))
 		return;
 
-	spin_lock(&lru_lock);
-	if (test_bit(GLF_LRU, &gl->gl_flags)) {
-		list_del_init(&gl->gl_lru);
-		atomic_dec(&lru_count);
+	if (list_lru_del(&gfs2_glock_lru, &gl->gl_lru))
 		clear_bit(GLF_LRU, &gl->gl_flags);
-	}
-	spin_unlock(&lru_lock);
 }
 
 /*
@@ -1721,104 +1710,40 @@ void gfs2_glock_complete(struct gfs2_glock *gl, int ret)
 	spin_unlock(&gl->gl_lockref.lock);
 }
 
-static int glock_cmp(void *priv, struct list_head *a, struct list_head *b)
-{
-	struct gfs2_glock *gla, *glb;
-
-	gla = list_entry(a, struct gfs2_glock, gl_lru);
-	glb = list_entry(b, struct gfs2_glock, gl_lru);
-
-	if (gla->gl_name.ln_number > glb->gl_name.ln_number)
-		return 1;
-	if (gla->gl_name.ln_number < glb->gl_name.ln_number)
-		return -1;
-
-	return 0;
-}
-
 /**
- * gfs2_dispose_glock_lru - Demote a list of glocks
- * @list: The list to dispose of
- *
- * Disposing of glocks may involve disk accesses, so that here we sort
- * the glocks by number (i.e. disk location of the inodes) so that if
- * there are any such accesses, they'll be sent in order (mostly).
+ * gfs2_glock_isolate - Demote a glock found on the LRU
+ * @item: The glock's LRU list entry
+ * @lru: The per-node list it is on
+ * @lru_lock: The lock of @lru, held
+ * @arg: Unused
  *
- * Must be called under the lru_lock, but may drop and retake this
- * lock. While the lru_lock is dropped, entries may vanish from the
- * list, but no new entries will appear on the list (since it is
- * private)
+ * Only the demote request is made here; the glock state machine does the
+ * actual unlocking, and any disk access that involves, from the glock
+ * workqueue.  So the shrinker never waits for a demotion to complete, and
+ * each node's list is only locked while its own glocks are scanned.
  */
 
-static void gfs2_dispose_glock_lru(struct list_head *list)
-__releases(&lru_lock)
-__acquires(&lru_lock)
+static enum lru_status gfs2_glock_isolate(struct list_head *item,
+		struct list_lru_one *lru, spinlock_t *lru_lock, void *arg)
 {
-	struct gfs2_glock *gl;
+	struct gfs2_glock *gl = list_entry(item, struct gfs2_glock, gl_lru);
 
-	list_sort(NULL, list, glock_cmp);
-
-	while(!list_empty(list)) {
-		gl = list_first_entry(list, struct gfs2_glock, gl_lru);
-		list_del_init(&gl->gl_lru);
-		if (!spin_trylock(&gl->gl_lockref.lock)) {
-add_back_to_lru:
-			list_add(&gl->gl_lru, &lru_list);
-			set_bit(GLF_LRU, &gl->gl_flags);
-			atomic_inc(&lru_count);
-			continue;
-		}
-		if (test_and_set_bit(GLF_LOCK, &gl->gl_flags)) {
-			spin_unlock(&gl->gl_lockref.lock);
-			goto add_back_to_lru;
-		}
-		gl->gl_lockref.count++;
-		if (demote_ok(gl))
-			handle_callback(gl, LM_ST_UNLOCKED, 0, false);
-		WARN_ON(!test_and_clear_bit(GLF_LOCK, &gl->gl_flags));
-		__gfs2_glock_queue_work(gl, 0);
+	if (!spin_trylock(&gl->gl_lockref.lock))
+		return LRU_SKIP;
+	if (test_and_set_bit(GLF_LOCK, &gl->gl_flags)) {
 		spin_unlock(&gl->gl_lockref.lock);
-		cond_resched_lock(&lru_lock);
-	}
-}
-
-/**
- * gfs2_scan_glock_lru - Scan the LRU looking for locks to demote
- * @nr: The number of entries to scan
- *
- * This function selects the entries on the LRU which are able to
- * be demoted, and then kicks off the process by calling
- * gfs2_dispose_glock_lru() above.
- */
-
-static long gfs2_scan_glock_lru(int nr)
-{
-	struct gfs2_glock *gl;
-	LIST_HEAD(skipped);
-	LIST_HEAD(dispose);
-	long freed = 0;
-
-	spin_lock(&lru_lock);
-	while ((nr-- >= 0) && !list_empty(&lru_list)) {
-		gl = list_first_entry(&lru_list, struct gfs2_glock, gl_lru);
-
-		/* Test for being demotable */
-		if (!test_bit(GLF_LOCK, &gl->gl_flags)) {
-			list_move(&gl->gl_lru, &dispose);
-			atomic_dec(&lru_count);
-			clear_bit(GLF_LRU, &gl->gl_flags);
-			freed++;
-			continue;
-		}
-
-		list_move(&gl->gl_lru, &skipped);
+		return LRU_ROTATE;
 	}
-	list_splice(&skipped, &lru_list);
-	if (!list_empty(&dispose))
-		gfs2_dispose_glock_lru(&dispose);
-	spin_unlock(&lru_lock);
 
-	return freed;
+	list_lru_isolate(lru, &gl->gl_lru);
+	clear_bit(GLF_LRU, &gl->gl_flags);
+	gl->gl_lockref.count++;
+	if (demote_ok(gl))
+		handle_callback(gl, LM_ST_UNLOCKED, 0, false);
+	WARN_ON(!test_and_clear_bit(GLF_LOCK, &gl->gl_flags));
+	__gfs2_glock_queue_work(gl, 0);
+	spin_unlock(&gl->gl_lockref.lock);
+	return LRU_REMOVED;
 }
 
 static unsigned long gfs2_glock_shrink_scan(struct shrinker *shrink,
@@ -1826,16 +1751,18 @@ static unsigned long gfs2_glock_shrink_scan(struct shrinker *shrink,
 {
 	if (!(sc->gfp_mask & __GFP_FS))
 		return SHRINK_STOP;
-	return gfs2_scan_glock_lru(sc->nr_to_scan);
+	return list_lru_shrink_walk(&gfs2_glock_lru, sc, gfs2_glock_isolate,
+				    NULL);
 }
 
 static unsigned long gfs2_glock_shrink_count(struct shrinker *shrink,
 					     struct shrink_control *sc)
 {
-	return vfs_pressure_ratio(atomic_read(&lru_count));
+	return vfs_pressure_ratio(list_lru_shrink_count(&gfs2_glock_lru, sc));
 }
 
 static struct shrinker glock_shrinker = {
+	.flags = SHRINKER_NUMA_AWARE,
 	.seeks = DEFAULT_SEEKS,
 	.count_objects = gfs2_glock_shrink_count,
 	.scan_objects = gfs2_glock_shrink_scan,
@@ -2272,8 +2199,17 @@ int __init gfs2_glock_init(void)
 		return -ENOMEM;
 	}
 
+	ret = list_lru_init(&gfs2_glock_lru);
+	if (ret) {
+		destroy_workqueue(gfs2_delete_workqueue);
+		destroy_workqueue(glock_workqueue);
+		rhashtable_destroy(&gl_hash_table);
+		return ret;
+	}
+
 	ret = register_shrinker(&glock_shrinker);
 	if (ret) {
+		list_lru_destroy(&gfs2_glock_lru);
 		destroy_workqueue(gfs2_delete_workqueue);
 		destroy_workqueue(glock_workqueue);
 		rhashtable_destroy(&gl_hash_table);
@@ -2289,6 +2225,7 @@ int __init gfs2_glock_init(void)
 void gfs2_glock_exit(void)
 {
 	unregister_shrinker(&glock_shrinker);
+	list_lru_destroy(&gfs2_glock_lru);
 	rhashtable_destroy(&gl_hash_table);
 	destroy_workqueue(glock_workqueue);
 	destroy_workqueue(gfs2_delete_workqueue);
@@ -1463,7 +1463,9 @@ static void gfs2_evict_inode(struct inode *inode)
 	if (ip->i_gl) {
 		glock_clear_object(ip->i_gl, ip);
 		wait_on_bit_io(&ip->i_flags, GIF_GLOP_PENDING, TASK_UNINTERRUPTIBLE);
+		spin_lock(&ip->i_gl->gl_lockref.lock);
 		gfs2_glock_add_to_lru(ip->i_gl);
+		spin_unlock(&ip->i_gl->gl_lockref.lock);
 		gfs2_glock_put_eventually(ip->i_gl);
 		ip->i_gl = NULL;
 	}
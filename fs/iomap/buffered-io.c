@@ -241,6 +241,39 @@ static inline bool iomap_block_needs_zeroing(struct inode *inode,
 		pos >= i_size_read(inode);
 }
 
+/*
+ * Submit the bio under construction, if any, and start a new one at @sector
+ * sized for the @length bytes left in the mapping.
+ */
+static void
+iomap_read_bio_alloc(struct iomap_readpage_ctx *ctx, struct iomap *iomap,
+		struct address_space *mapping, sector_t sector, loff_t length)
+{
+	gfp_t gfp = mapping_gfp_constraint(mapping, GFP_KERNEL);
+	gfp_t orig_gfp = gfp;
+	int nr_vecs = (length + PAGE_SIZE - 1) >> PAGE_SHIFT;
+
+	if (ctx->bio)
+		submit_bio(ctx->bio);
+
+	if (ctx->rac) /* same as readahead_gfp_mask */
+		gfp |= __GFP_NORETRY | __GFP_NOWARN;
+	ctx->bio = bio_alloc(gfp, min(BIO_MAX_PAGES, nr_vecs));
+	/*
+	 * If the bio_alloc fails, try it again for a single page to
+	 * avoid having to deal with partial page reads.  This emulates
+	 * what do_mpage_readpage does.
+	 */
+	if (!ctx->bio)
+		ctx->bio = bio_alloc(orig_gfp, 1);
+	ctx->bio->bi_opf = REQ_OP_READ;
+	if (ctx->rac)
+		ctx->bio->bi_opf |= REQ_RAHEAD;
+	ctx->bio->bi_iter.bi_sector = sector;
+	bio_set_dev(ctx->bio, iomap->bdev);
+	ctx->bio->bi_end_io = iomap_read_end_io;
+}
+
 static loff_t
 iomap_readpage_actor(struct inode *inode, loff_t pos, loff_t length, void *data,
 		struct iomap *iomap, struct iomap *srcmap)
@@ -294,31 +327,8 @@ iomap_readpage_actor(struct inode *inode, loff_t pos, loff_t length, void *data,
 	if (iop)
 		atomic_inc(&iop->read_count);
 
-	if (!ctx->bio || !is_contig || bio_full(ctx->bio, plen)) {
-		gfp_t gfp = mapping_gfp_constraint(page->mapping, GFP_KERNEL);
-		gfp_t orig_gfp = gfp;
-		int nr_vecs = (length + PAGE_SIZE - 1) >> PAGE_SHIFT;
-
-		if (ctx->bio)
-			submit_bio(ctx->bio);
-
-		if (ctx->rac) /* same as readahead_gfp_mask */
-			gfp |= __GFP_NORETRY | __GFP_NOWARN;
-		ctx->bio = bio_alloc(gfp, min(BIO_MAX_PAGES, nr_vecs));
-		/*
-		 * If the bio_alloc fails, try it again for a single page to
-		 * avoid having to deal with partial page reads.  This emulates
-		 * what do_mpage_readpage does.
-		 */
-		if (!ctx->bio)
-			ctx->bio = bio_alloc(orig_gfp, 1);
-		ctx->bio->bi_opf = REQ_OP_READ;
-		if (ctx->rac)
-			ctx->bio->bi_opf |= REQ_RAHEAD;
-		ctx->bio->bi_iter.bi_sector = sector;
-		bio_set_dev(ctx->bio, iomap->bdev);
-		ctx->bio->bi_end_io = iomap_read_end_io;
-	}
+	if (!ctx->bio || !is_contig || bio_full(ctx->bio, plen))
+		iomap_read_bio_alloc(ctx, iomap, page->mapping, sector, length);
 
 	bio_add_page(ctx->bio, page, plen, poff);
 done:
@@ -369,6 +379,57 @@ iomap_readpage(struct page *page, const struct iomap_ops *ops)
 }
 EXPORT_SYMBOL_GPL(iomap_readpage);
 
+/* Pages taken from the readahead control at once by iomap_readahead_batch */
+#define IOMAP_READ_BATCH	16
+
+/*
+ * Fast path for readahead of a mapped extent when blocks are page sized:
+ * every page below EOF is read in full and needs no iomap_page, so whole
+ * batches of pages are added to the bio without going through
+ * iomap_readpage_actor one page at a time.  Returns the number of bytes
+ * queued for I/O, 0 if the range has to take the slow path.
+ */
+static loff_t
+iomap_readahead_batch(struct inode *inode, loff_t pos, loff_t length,
+		struct iomap_readpage_ctx *ctx, struct iomap *iomap)
+{
+	struct page *pages[IOMAP_READ_BATCH];
+	loff_t isize = i_size_read(inode);
+	loff_t done = 0;
+	unsigned int nr, i;
+	sector_t sector;
+
+	if (i_blocksize(inode) != PAGE_SIZE || offset_in_page(pos) ||
+	    pos >= isize || iomap->type != IOMAP_MAPPED ||
+	    (iomap->flags & IOMAP_F_NEW))
+		return 0;
+
+	/* a partial page at EOF needs zeroing, leave it to the slow path */
+	length = min(length, isize - pos) & PAGE_MASK;
+
+	while (done < length) {
+		nr = __readahead_batch(ctx->rac, pages,
+				min_t(loff_t, IOMAP_READ_BATCH,
+				      (length - done) >> PAGE_SHIFT));
+		if (!nr)
+			break;
+
+		sector = iomap_sector(iomap, pos + done);
+		for (i = 0; i < nr; i++) {
+			if (!ctx->bio || bio_end_sector(ctx->bio) != sector ||
+			    bio_full(ctx->bio, PAGE_SIZE))
+				iomap_read_bio_alloc(ctx, iomap, pages[i]->mapping,
+						sector, length - done);
+			bio_add_page(ctx->bio, pages[i], PAGE_SIZE, 0);
+			put_page(pages[i]);
+			sector += PAGE_SIZE >> SECTOR_SHIFT;
+			done += PAGE_SIZE;
+		}
+	}
+
+	return done;
+}
+
 static loff_t
 iomap_readahead_actor(struct inode *inode, loff_t pos, loff_t length,
 		void *data, struct iomap *iomap, struct iomap *srcmap)
@@ -384,6 +445,10 @@ iomap_readahead_actor(struct inode *inode, loff_t pos, loff_t length,
 			ctx->cur_page = NULL;
 		}
 		if (!ctx->cur_page) {
+			ret = iomap_readahead_batch(inode, pos + done,
+					length - done, ctx, iomap);
+			if (ret)
+				continue;
 			ctx->cur_page = readahead_page(ctx->rac);
 			ctx->cur_page_in_bio = false;
 		}
@@ -26,11 +26,61 @@
 static char zisofs_sink_page[PAGE_SIZE];
 
 /*
- * This contains the zlib memory allocation and the mutex for the
- * allocation; this avoids failures at block-decompression time.
+ * zlib workspaces.  The first one is allocated at init time, which avoids
+ * failures at block-decompression time; more are added on demand, up to one
+ * per online CPU, so that readers of different files do not wait for each
+ * other.  When none is idle and no more can be added, wait for one.
  */
-static void *zisofs_zlib_workspace;
-static DEFINE_MUTEX(zisofs_zlib_lock);
+struct zisofs_workspace {
+	struct list_head list;
+	char mem[];
+};
+
+static LIST_HEAD(zisofs_idle_ws);
+static DEFINE_SPINLOCK(zisofs_ws_lock);
+static DECLARE_WAIT_QUEUE_HEAD(zisofs_ws_wait);
+static unsigned int zisofs_nr_ws;
+
+static struct zisofs_workspace *zisofs_alloc_ws(void)
+{
+	return vmalloc(sizeof(struct zisofs_workspace) +
+		       zlib_inflate_workspacesize());
+}
+
+static struct zisofs_workspace *zisofs_get_ws(void)
+{
+	struct zisofs_workspace *ws;
+
+	for (;;) {
+		spin_lock(&zisofs_ws_lock);
+		ws = list_first_entry_or_null(&zisofs_idle_ws,
+					      struct zisofs_workspace, list);
+		if (ws) {
+			list_del(&ws->list);
+			spin_unlock(&zisofs_ws_lock);
+			return ws;
+		}
+		if (zisofs_nr_ws < num_online_cpus()) {
+			zisofs_nr_ws++;
+			spin_unlock(&zisofs_ws_lock);
+			ws = zisofs_alloc_ws();
+			if (ws)
+				return ws;
+			spin_lock(&zisofs_ws_lock);
+			zisofs_nr_ws--;
+		}
+		spin_unlock(&zisofs_ws_lock);
+		wait_event(zisofs_ws_wait, !list_empty(&zisofs_idle_ws));
+	}
+}
+
+static void zisofs_put_ws(struct zisofs_workspace *ws)
+{
+	spin_lock(&zisofs_ws_lock);
+	list_add(&ws->list, &zisofs_idle_ws);
+	spin_unlock(&zisofs_ws_lock);
+	wake_up(&zisofs_ws_wait);
+}
 
 /*
  * Read data of @inode from @block_start to @block_end and uncompress
@@ -56,6 +106,7 @@ static loff_t zisofs_uncompress_block(struct inode *inode, loff_t block_start,
 	int haveblocks;
 	blkcnt_t blocknum;
 	struct buffer_head **bhs;
+	struct zisofs_workspace *ws;
 	int curbh, curpage;
 
 	if (block_size > deflateBound(1UL << zisofs_block_shift)) {
@@ -88,9 +139,9 @@ static loff_t zisofs_uncompress_block(struct inode *inode, loff_t block_start,
 	curpage = 0;
 	/*
 	 * First block is special since it may be fractional.  We also wait for
-	 * it before grabbing the zlib mutex; odds are that the subsequent
-	 * blocks are going to come in in short order so we don't hold the zlib
-	 * mutex longer than necessary.
+	 * it before grabbing a zlib workspace; odds are that the subsequent
+	 * blocks are going to come in in short order so we don't hold the
+	 * workspace longer than necessary.
 	 */
 
 	if (!bhs[0])
@@ -102,9 +153,9 @@ static loff_t zisofs_uncompress_block(struct inode *inode, loff_t block_start,
 		goto b_eio;
 	}
 
-	stream.workspace = zisofs_zlib_workspace;
-	mutex_lock(&zisofs_zlib_lock);
-		
+	ws = zisofs_get_ws();
+	stream.workspace = ws->mem;
+
 	zerr = zlib_inflateInit(&stream);
 	if (zerr != Z_OK) {
 		if (zerr == Z_MEM_ERROR)
@@ -185,7 +236,7 @@ static loff_t zisofs_uncompress_block(struct inode *inode, loff_t block_start,
 	zlib_inflateEnd(&stream);
 
 z_eio:
-	mutex_unlock(&zisofs_zlib_lock);
+	zisofs_put_ws(ws);
 
 b_eio:
 	for (i = 0; i < haveblocks; i++)
@@ -375,14 +426,22 @@ const struct address_space_operations zisofs_aops = {
 
 int __init zisofs_init(void)
 {
-	zisofs_zlib_workspace = vmalloc(zlib_inflate_workspacesize());
-	if ( !zisofs_zlib_workspace )
+	struct zisofs_workspace *ws = zisofs_alloc_ws();
+
+	if (!ws)
 		return -ENOMEM;
+	list_add(&ws->list, &zisofs_idle_ws);
+	zisofs_nr_ws = 1;
 
 	return 0;
 }
 
 void zisofs_cleanup(void)
 {
-	vfree(zisofs_zlib_workspace);
+	struct zisofs_workspace *ws, *next;
+
+	list_for_each_entry_safe(ws, next, &zisofs_idle_ws, list)
+		vfree(ws);
+	INIT_LIST_HEAD(&zisofs_idle_ws);
+	zisofs_nr_ws = 0;
 }
@@ -248,6 +248,60 @@ static int journal_submit_data_buffers(journal_t *journal,
 	return ret;
 }
 
+/*
+ * Start writeback of the ordered data of the running transaction while
+ * the commit record of @commit_transaction is in flight, so that the
+ * data phase of the next commit finds most of its pages already written.
+ * Only done when that commit has already been requested, typically by
+ * fsync() waiting behind us.
+ *
+ * The running transaction cannot be committed under us since we are the
+ * commit thread, and inodes refiled from @commit_transaction were moved
+ * over by journal_finish_inode_data_buffers() already.  New inodes may
+ * be added to the list meanwhile, which is fine as they go at its head.
+ * Pages already under writeback are skipped; the data phase of the next
+ * commit writes and waits for everything with WB_SYNC_ALL as usual.
+ */
+static void journal_prewrite_next_data(journal_t *journal,
+		transaction_t *commit_transaction)
+{
+	transaction_t *transaction;
+	struct jbd2_inode *jinode;
+
+	read_lock(&journal->j_state_lock);
+	transaction = journal->j_running_transaction;
+	if (transaction && !tid_gt(journal->j_commit_request,
+				   commit_transaction->t_tid))
+		transaction = NULL;
+	read_unlock(&journal->j_state_lock);
+	if (!transaction || is_journal_aborted(journal))
+		return;
+
+	spin_lock(&journal->j_list_lock);
+	list_for_each_entry(jinode, &transaction->t_inode_list, i_list) {
+		struct writeback_control wbc = {
+			.sync_mode = WB_SYNC_NONE,
+			.nr_to_write = LONG_MAX,
+			.range_start = jinode->i_dirty_start,
+			.range_end = jinode->i_dirty_end,
+		};
+
+		if (!(jinode->i_flags & JI_WRITE_DATA) ||
+		    (jinode->i_flags & JI_COMMIT_RUNNING))
+			continue;
+		jinode->i_flags |= JI_COMMIT_RUNNING;
+		spin_unlock(&journal->j_list_lock);
+		/* writepage only, as in journal_submit_inode_data_buffers() */
+		trace_jbd2_submit_inode_data(jinode->i_vfs_inode);
+		generic_writepages(jinode->i_vfs_inode->i_mapping, &wbc);
+		spin_lock(&journal->j_list_lock);
+		jinode->i_flags &= ~JI_COMMIT_RUNNING;
+		smp_mb();
+		wake_up_bit(&jinode->i_flags, __JI_COMMIT_RUNNING);
+	}
+	spin_unlock(&journal->j_list_lock);
+}
+
 /*
  * Wait for data submitted for writeout, refile inodes to proper
  * transaction if needed.
@@ -877,8 +931,10 @@ void jbd2_journal_commit_transaction(journal_t *journal)
 		if (err)
 			jbd2_journal_abort(journal, err);
 	}
-	if (cbh)
+	if (cbh) {
+		journal_prewrite_next_data(journal, commit_transaction);
 		err = journal_wait_on_commit_record(journal, cbh);
+	}
 	stats.run.rs_blocks_logged++;
 	if (jbd2_has_feature_async_commit(journal) &&
 	    journal->j_flags & JBD2_BARRIER) {
@@ -18,6 +18,8 @@
 #include <linux/pagemap.h>
 #include <linux/crc32.h>
 #include <linux/compiler.h>
+#include <linux/cpumask.h>
+#include <linux/workqueue.h>
 #include "nodelist.h"
 #include "summary.h"
 #include "debug.h"
@@ -88,8 +90,130 @@ static int file_dirty(struct jffs2_sb_info *c, struct jffs2_eraseblock *jeb)
 	return 0;
 }
 
+/*
+ * When the scan goes through a read buffer rather than pointing at the
+ * flash, the next eraseblock is read into a spare buffer by a worker
+ * while the current one is parsed.  A block read in full that way is
+ * then scanned as if it was pointed at (buf_size == 0).  The worker stops
+ * after the first EMPTY_SCAN_SIZE bytes of an erased block and, with
+ * summaries, after finding the summary marker, since the scan itself
+ * reads no more than that of such blocks; those, and blocks the worker
+ * failed to read, go through the normal buffered scan.
+ */
+struct jffs2_scan_prefetch {
+	struct work_struct work;
+	struct jffs2_sb_info *c;
+	struct jffs2_eraseblock *jeb;
+	unsigned char *buf;
+	bool full;
+};
+
+static int jffs2_fill_scan_buf(struct jffs2_sb_info *c, void *buf,
+			       uint32_t ofs, uint32_t len);
+
+static void jffs2_scan_prefetch_work(struct work_struct *work)
+{
+	struct jffs2_scan_prefetch *pf = container_of(work,
+					struct jffs2_scan_prefetch, work);
+	struct jffs2_sb_info *c = pf->c;
+	uint32_t ofs = pf->jeb->offset;
+	uint32_t len = EMPTY_SCAN_SIZE(c->sector_size);
+	uint32_t i;
+
+	pf->full = false;
+	if (mtd_block_isbad(c->mtd, ofs))
+		return;
+
+	if (jffs2_fill_scan_buf(c, pf->buf, ofs, len))
+		return;
+	for (i = 0; i < len && *(uint32_t *)&pf->buf[i] == 0xFFFFFFFF; i += 4)
+		;
+	if (i == len)
+		return;
+
+	if (jffs2_sum_active()) {
+		struct jffs2_sum_marker *sm;
+
+		sm = (void *)pf->buf + c->sector_size - sizeof(*sm);
+		if (jffs2_fill_scan_buf(c, sm, ofs + c->sector_size - sizeof(*sm),
+					sizeof(*sm)))
+			return;
+		if (je32_to_cpu(sm->magic) == JFFS2_SUM_MAGIC)
+			return;
+	}
+
+	if (!jffs2_fill_scan_buf(c, pf->buf + len, ofs + len,
+				 c->sector_size - len))
+		pf->full = true;
+}
+
+static bool jffs2_scan_prefetch_init(struct jffs2_sb_info *c,
+				     struct jffs2_scan_prefetch *pf)
+{
+	size_t size;
+	int i;
+
+	if (c->nr_blocks < 2 || num_online_cpus() < 2)
+		return false;
+
+	for (i = 0; i < 2; i++) {
+		size = c->sector_size;
+		pf[i].buf = mtd_kmalloc_up_to(c->mtd, &size);
+		if (pf[i].buf && size < c->sector_size) {
+			kfree(pf[i].buf);
+			pf[i].buf = NULL;
+		}
+		if (!pf[i].buf) {
+			if (i)
+				kfree(pf[0].buf);
+			return false;
+		}
+		INIT_WORK(&pf[i].work, jffs2_scan_prefetch_work);
+		pf[i].c = c;
+		pf[i].full = false;
+	}
+	return true;
+}
+
+static void jffs2_scan_prefetch_free(struct jffs2_scan_prefetch *pf)
+{
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		flush_work(&pf[i].work);
+		kfree(pf[i].buf);
+	}
+}
+
+/*
+ * Wait for block @i to be read and start on block @i + 1.  Returns the
+ * buffer holding the whole of block @i, or NULL if it has to be scanned
+ * through the normal read buffer.
+ */
+static unsigned char *jffs2_scan_prefetch_next(struct jffs2_sb_info *c,
+					       struct jffs2_scan_prefetch *pf,
+					       int i)
+{
+	struct jffs2_scan_prefetch *cur = &pf[i & 1];
+	struct jffs2_scan_prefetch *next = &pf[(i + 1) & 1];
+
+	if (!i) {
+		cur->jeb = &c->blocks[0];
+		queue_work(system_unbound_wq, &cur->work);
+	}
+	flush_work(&cur->work);
+
+	if (i + 1 < c->nr_blocks) {
+		next->jeb = &c->blocks[i + 1];
+		queue_work(system_unbound_wq, &next->work);
+	}
+	return cur->full ? cur->buf : NULL;
+}
+
 int jffs2_scan_medium(struct jffs2_sb_info *c)
 {
+	struct jffs2_scan_prefetch pf[2];
+	bool prefetch = false;
 	int i, ret;
 	uint32_t empty_blocks = 0, bad_blocks = 0;
 	unsigned char *flashbuf = NULL;
@@ -140,16 +264,25 @@ int jffs2_scan_medium(struct jffs2_sb_info *c)
 		}
 	}
 
+	if (buf_size)
+		prefetch = jffs2_scan_prefetch_init(c, pf);
+
 	for (i=0; i<c->nr_blocks; i++) {
 		struct jffs2_eraseblock *jeb = &c->blocks[i];
+		unsigned char *blockbuf = NULL;
 
 		cond_resched();
 
 		/* reset summary info for next eraseblock scan */
 		jffs2_sum_reset_collected(s);
 
-		ret = jffs2_scan_eraseblock(c, jeb, buf_size?flashbuf:(flashbuf+jeb->offset),
-						buf_size, s);
+		if (prefetch)
+			blockbuf = jffs2_scan_prefetch_next(c, pf, i);
+		if (blockbuf)
+			ret = jffs2_scan_eraseblock(c, jeb, blockbuf, 0, s);
+		else
+			ret = jffs2_scan_eraseblock(c, jeb, buf_size?flashbuf:(flashbuf+jeb->offset),
+							buf_size, s);
 
 		if (ret < 0)
 			goto out;
@@ -275,6 +408,8 @@ int jffs2_scan_medium(struct jffs2_sb_info *c)
 	}
 	ret = 0;
  out:
+	if (prefetch)
+		jffs2_scan_prefetch_free(pf);
 	if (buf_size)
 		kfree(flashbuf);
 #ifndef __ECOS
@@ -1,5 +1,6 @@
 /* SPDX-License-Identifier: GPL-2.0 */
 #include <linux/fsnotify_backend.h>
+#include <linux/hash.h>
 #include <linux/path.h>
 #include <linux/slab.h>
 #include <linux/exportfs.h>
@@ -137,8 +138,13 @@ enum fanotify_event_type {
 	FANOTIFY_EVENT_TYPE_OVERFLOW, /* struct fanotify_event */
 };
 
+/* Buckets of the per group hash of queued events that may be merged */
+#define FANOTIFY_HTABLE_BITS	7
+#define FANOTIFY_HTABLE_SIZE	(1 << FANOTIFY_HTABLE_BITS)
+
 struct fanotify_event {
 	struct fsnotify_event fse;
+	struct hlist_node merge_list;	/* member of group merge_hash */
 	u32 mask;
 	enum fanotify_event_type type;
 	struct pid *pid;
@@ -148,6 +154,7 @@ static inline void fanotify_init_event(struct fanotify_event *event,
 				       unsigned long id, u32 mask)
 {
 	fsnotify_init_event(&event->fse, id);
+	INIT_HLIST_NODE(&event->merge_list);
 	event->mask = mask;
 	event->pid = NULL;
 }
@@ -269,6 +276,20 @@ static inline struct fanotify_event *FANOTIFY_E(struct fsnotify_event *fse)
 	return container_of(fse, struct fanotify_event, fse);
 }
 
+static inline struct hlist_head *fanotify_event_hash_bucket(
+						struct fsnotify_group *group,
+						struct fanotify_event *event)
+{
+	return &group->fanotify_data.merge_hash[hash_long(event->fse.objectid,
+						FANOTIFY_HTABLE_BITS)];
+}
+
+/* Called with notification_lock held when an event leaves the queue */
+static inline void fanotify_unhash_event(struct fanotify_event *event)
+{
+	hlist_del_init(&event->merge_list);
+}
+
 static inline bool fanotify_event_has_path(struct fanotify_event *event)
 {
 	return event->type == FANOTIFY_EVENT_TYPE_PATH ||
@@ -118,6 +118,7 @@ static struct fanotify_event *get_one_event(struct fsnotify_group *group,
 		goto out;
 	}
 	event = FANOTIFY_E(fsnotify_remove_first_event(group));
+	fanotify_unhash_event(event);
 	if (fanotify_is_perm_event(event->mask))
 		FANOTIFY_PERM(event)->state = FAN_EVENT_REPORTED;
 out:
@@ -605,6 +606,7 @@ static int fanotify_release(struct inode *ignored, struct file *file)
 		struct fanotify_event *event;
 
 		event = FANOTIFY_E(fsnotify_remove_first_event(group));
+		fanotify_unhash_event(event);
 		if (!(event->mask & FANOTIFY_PERM_EVENTS)) {
 			spin_unlock(&group->notification_lock);
 			fsnotify_destroy_event(group, &event->fse);
@@ -923,7 +925,7 @@ static struct fsnotify_event *fanotify_alloc_overflow_event(void)
 SYSCALL_DEFINE2(fanotify_init, unsigned int, flags, unsigned int, event_f_flags)
 {
 	struct fsnotify_group *group;
-	int f_flags, fd;
+	int f_flags, fd, i;
 	struct user_struct *user;
 	unsigned int fid_mode = flags & FANOTIFY_FID_BITS;
 	unsigned int class = flags & FANOTIFY_CLASS_BITS;
@@ -993,6 +995,15 @@ SYSCALL_DEFINE2(fanotify_init, unsigned int, flags, unsigned int, event_f_flags)
 		goto out_destroy_group;
 	}
 
+	group->fanotify_data.merge_hash = kmalloc_array(FANOTIFY_HTABLE_SIZE,
+				sizeof(struct hlist_head), GFP_KERNEL_ACCOUNT);
+	if (!group->fanotify_data.merge_hash) {
+		fd = -ENOMEM;
+		goto out_destroy_group;
+	}
+	for (i = 0; i < FANOTIFY_HTABLE_SIZE; i++)
+		INIT_HLIST_HEAD(&group->fanotify_data.merge_hash[i]);
+
 	if (force_o_largefile())
 		event_f_flags |= O_LARGEFILE;
 	group->fanotify_data.f_flags = event_f_flags;
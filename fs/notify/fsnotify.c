@@ -448,6 +448,13 @@ int fsnotify(__u32 mask, const void *data, int data_type, struct inode *dir,
 	}
 	sb = inode->i_sb;
 
+	/*
+	 * Every mark that could match is attached to an object of @sb, so
+	 * a filesystem without any is skipped without looking further.
+	 */
+	if (!fsnotify_sb_has_watchers(sb))
+		return 0;
+
 	/*
 	 * Optimization: srcu_read_lock() has a memory barrier which can
 	 * be expensive.  It protects walking the *_fsnotify_marks lists.
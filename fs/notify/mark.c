@@ -189,6 +189,7 @@ static void *fsnotify_detach_connector_from_object(
 		fsnotify_conn_sb(conn)->s_fsnotify_mask = 0;
 	}
 
+	atomic_long_dec(&fsnotify_connector_sb(conn)->s_fsnotify_connectors);
 	rcu_assign_pointer(*(conn->obj), NULL);
 	conn->obj = NULL;
 	conn->type = FSNOTIFY_OBJ_TYPE_DETACHED;
@@ -506,6 +507,8 @@ static int fsnotify_attach_connector_to_object(fsnotify_connp_t *connp,
 		if (inode)
 			iput(inode);
 		kmem_cache_free(fsnotify_mark_connector_cachep, conn);
+	} else {
+		atomic_long_inc(&fsnotify_connector_sb(conn)->s_fsnotify_connectors);
 	}
 
 	return 0;
@@ -13,8 +13,28 @@
 #include <linux/security.h>
 #include <linux/mm.h>
 #include <linux/fs.h>
+#include <linux/module.h>
 #include "overlayfs.h"
 
+static bool ovl_lazy_copy_up;
+module_param_named(lazy_copy_up, ovl_lazy_copy_up, bool, 0644);
+MODULE_PARM_DESC(lazy_copy_up,
+		 "With metacopy, copy up the data of a file opened for write on its first modification instead of on open");
+
+/*
+ * @realfile is the real file I/O goes to.  With lazy copy up, a file
+ * opened for write before its data was copied up has the lower data file
+ * opened read-only in @realfile and @lazy set.  The first operation that
+ * modifies the data copies it up and switches @realfile to the upper file;
+ * the lower file stays open in @lowerfile until release, since others
+ * may still be using it.
+ */
+struct ovl_file {
+	struct file *realfile;
+	struct file *lowerfile;
+	bool lazy;
+};
+
 struct ovl_aio_req {
 	struct kiocb iocb;
 	struct kiocb *orig_iocb;
@@ -37,15 +57,16 @@ static char ovl_whatisit(struct inode *inode, struct inode *realinode)
 #define OVL_OPEN_FLAGS (O_NOATIME | FMODE_NONOTIFY)
 
 static struct file *ovl_open_realfile(const struct file *file,
-				      struct inode *realinode)
+				      struct inode *realinode, int flags)
 {
 	struct inode *inode = file_inode(file);
 	struct file *realfile;
 	const struct cred *old_cred;
-	int flags = file->f_flags | OVL_OPEN_FLAGS;
-	int acc_mode = ACC_MODE(flags);
+	int acc_mode;
 	int err;
 
+	flags |= OVL_OPEN_FLAGS;
+	acc_mode = ACC_MODE(flags);
 	if (flags & O_APPEND)
 		acc_mode |= MAY_APPEND;
 
@@ -77,8 +98,11 @@ static int ovl_change_flags(struct file *file, unsigned int flags)
 
 	flags |= OVL_OPEN_FLAGS;
 
-	/* If some flag changed that cannot be changed then something's amiss */
-	if (WARN_ON((file->f_flags ^ flags) & ~OVL_SETFL_MASK))
+	/*
+	 * If some flag changed that cannot be changed then something's amiss.
+	 * The access mode differs for a lazily copied up lower file.
+	 */
+	if (WARN_ON((file->f_flags ^ flags) & ~(OVL_SETFL_MASK | O_ACCMODE)))
 		return -EIO;
 
 	flags &= OVL_SETFL_MASK;
@@ -108,11 +132,12 @@ static int ovl_change_flags(struct file *file, unsigned int flags)
 static int ovl_real_fdget_meta(const struct file *file, struct fd *real,
 			       bool allow_meta)
 {
+	struct ovl_file *of = file->private_data;
 	struct inode *inode = file_inode(file);
 	struct inode *realinode;
 
 	real->flags = 0;
-	real->file = file->private_data;
+	real->file = READ_ONCE(of->realfile);
 
 	if (allow_meta)
 		realinode = ovl_inode_real(inode);
@@ -122,13 +147,14 @@ static int ovl_real_fdget_meta(const struct file *file, struct fd *real,
 	/* Has it been copied up since we'd opened it? */
 	if (unlikely(file_inode(real->file) != realinode)) {
 		real->flags = FDPUT_FPUT;
-		real->file = ovl_open_realfile(file, realinode);
+		real->file = ovl_open_realfile(file, realinode, file->f_flags);
 
 		return PTR_ERR_OR_ZERO(real->file);
 	}
 
 	/* Did the flags change since open? */
-	if (unlikely((file->f_flags ^ real->file->f_flags) & ~OVL_OPEN_FLAGS))
+	if (unlikely((file->f_flags ^ real->file->f_flags) &
+		     ~(OVL_OPEN_FLAGS | O_ACCMODE)))
 		return ovl_change_flags(real->file, file->f_flags);
 
 	return 0;
@@ -139,30 +165,121 @@ static int ovl_real_fdget(const struct file *file, struct fd *real)
 	return ovl_real_fdget_meta(file, real, false);
 }
 
-static int ovl_open(struct inode *inode, struct file *file)
+/* Copy up the data of a lazily opened file and switch it to upper */
+static int ovl_file_copy_up_data(struct file *file)
 {
+	struct ovl_file *of = file->private_data;
 	struct file *realfile;
 	int err;
 
-	err = ovl_maybe_copy_up(file_dentry(file), file->f_flags);
+	err = ovl_maybe_copy_up(file_dentry(file), O_WRONLY);
 	if (err)
 		return err;
 
+	realfile = ovl_open_realfile(file, ovl_inode_realdata(file_inode(file)),
+				     file->f_flags);
+	if (IS_ERR(realfile))
+		return PTR_ERR(realfile);
+
+	spin_lock(&file->f_lock);
+	if (of->lazy) {
+		of->lowerfile = of->realfile;
+		WRITE_ONCE(of->realfile, realfile);
+		WRITE_ONCE(of->lazy, false);
+		realfile = NULL;
+	}
+	spin_unlock(&file->f_lock);
+
+	if (realfile)
+		fput(realfile);
+	return 0;
+}
+
+/* Like ovl_real_fdget() for operations which modify the data */
+static int ovl_real_fdget_write(struct file *file, struct fd *real)
+{
+	struct ovl_file *of = file->private_data;
+
+	if (unlikely(READ_ONCE(of->lazy))) {
+		int err = ovl_file_copy_up_data(file);
+
+		if (err)
+			return err;
+	}
+	return ovl_real_fdget(file, real);
+}
+
+/*
+ * Leave the data of a regular file opened for write in the lower layer
+ * until it is modified, copying up only the metadata now.  Not with
+ * O_TRUNC, which copies up no data anyway.
+ */
+static bool ovl_open_lazy(struct file *file)
+{
+	struct inode *inode = file_inode(file);
+
+	return ovl_lazy_copy_up && OVL_FS(inode->i_sb)->config.metacopy &&
+	       S_ISREG(inode->i_mode) && (file->f_mode & FMODE_WRITE) &&
+	       !(file->f_flags & O_TRUNC) && !ovl_has_upperdata(inode);
+}
+
+static int ovl_open(struct inode *inode, struct file *file)
+{
+	struct dentry *dentry = file_dentry(file);
+	struct ovl_file *of;
+	struct file *realfile;
+	bool lazy = ovl_open_lazy(file);
+	int flags, err;
+
+	of = kzalloc(sizeof(*of), GFP_KERNEL);
+	if (!of)
+		return -ENOMEM;
+
+	if (lazy) {
+		err = ovl_want_write(dentry);
+		if (!err) {
+			err = ovl_copy_up(dentry);
+			ovl_drop_write(dentry);
+		}
+		/* metacopy may not have been possible for this one */
+		lazy = !ovl_has_upperdata(inode);
+	} else {
+		err = ovl_maybe_copy_up(dentry, file->f_flags);
+	}
+	if (err)
+		goto out_free;
+
 	/* No longer need these flags, so don't pass them on to underlying fs */
 	file->f_flags &= ~(O_CREAT | O_EXCL | O_NOCTTY | O_TRUNC);
 
-	realfile = ovl_open_realfile(file, ovl_inode_realdata(inode));
-	if (IS_ERR(realfile))
-		return PTR_ERR(realfile);
+	flags = file->f_flags;
+	if (lazy)
+		flags = (flags & ~O_ACCMODE) | O_RDONLY;
+	realfile = ovl_open_realfile(file, ovl_inode_realdata(inode), flags);
+	if (IS_ERR(realfile)) {
+		err = PTR_ERR(realfile);
+		goto out_free;
+	}
 
-	file->private_data = realfile;
+	of->realfile = realfile;
+	of->lazy = lazy;
+	file->private_data = of;
 
 	return 0;
+
+out_free:
+	kfree(of);
+	return err;
 }
 
 static int ovl_release(struct inode *inode, struct file *file)
 {
-	fput(file->private_data);
+	struct ovl_file *of = file->private_data;
+
+	fput(of->realfile);
+	if (of->lowerfile)
+		fput(of->lowerfile);
+	kfree(of);
 
 	return 0;
 }
@@ -342,7 +459,7 @@ static ssize_t ovl_write_iter(struct kiocb *iocb, struct iov_iter *iter)
 	if (ret)
 		goto out_unlock;
 
-	ret = ovl_real_fdget(file, &real);
+	ret = ovl_real_fdget_write(file, &real);
 	if (ret)
 		goto out_unlock;
 
@@ -414,7 +531,7 @@ ovl_splice_write(struct pipe_inode_info *pipe, struct file *out,
 	const struct cred *old_cred;
 	ssize_t ret;
 
-	ret = ovl_real_fdget(out, &real);
+	ret = ovl_real_fdget_write(out, &real);
 	if (ret)
 		return ret;
 
@@ -451,10 +568,22 @@ static int ovl_fsync(struct file *file, loff_t start, loff_t end, int datasync)
 
 static int ovl_mmap(struct file *file, struct vm_area_struct *vma)
 {
-	struct file *realfile = file->private_data;
+	struct ovl_file *of = file->private_data;
+	struct file *realfile = READ_ONCE(of->realfile);
 	const struct cred *old_cred;
 	int ret;
 
+	/*
+	 * Copy up takes directory locks, which cannot be taken under
+	 * mmap_lock, so the data of a lazily opened file cannot be copied
+	 * up here.  Refuse shared writable mappings until it has been.
+	 */
+	if (READ_ONCE(of->lazy) && (vma->vm_flags & VM_SHARED)) {
+		if (vma->vm_flags & VM_WRITE)
+			return -EACCES;
+		vma->vm_flags &= ~VM_MAYWRITE;
+	}
+
 	if (!realfile->f_op->mmap)
 		return -ENODEV;
 
@@ -487,7 +616,7 @@ static long ovl_fallocate(struct file *file, int mode, loff_t offset, loff_t len
 	const struct cred *old_cred;
 	int ret;
 
-	ret = ovl_real_fdget(file, &real);
+	ret = ovl_real_fdget_write(file, &real);
 	if (ret)
 		return ret;
 
@@ -699,7 +828,7 @@ static loff_t ovl_copyfile(struct file *file_in, loff_t pos_in,
 	const struct cred *old_cred;
 	loff_t ret;
 
-	ret = ovl_real_fdget(file_out, &real_out);
+	ret = ovl_real_fdget_write(file_out, &real_out);
 	if (ret)
 		return ret;
 
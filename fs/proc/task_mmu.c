@@ -931,6 +931,115 @@ static int smaps_rollup_release(struct inode *inode, struct file *file)
 	return single_release(inode, file);
 }
 
+static int smaps_rollup_class(struct vm_area_struct *vma)
+{
+	if (!vma->vm_file)
+		return SMAPS_ROLLUP_ANON;
+	if (shmem_mapping(vma->vm_file->f_mapping))
+		return SMAPS_ROLLUP_SHMEM;
+	return SMAPS_ROLLUP_FILE;
+}
+
+static void smaps_rollup_account(struct smaps_rollup_stats *st,
+				 struct vm_area_struct *vma,
+				 const struct mem_size_stats *mss)
+{
+	st->vmas++;
+	st->size += vma->vm_end - vma->vm_start;
+	st->rss += mss->resident;
+	st->pss += mss->pss >> PSS_SHIFT;
+	st->shared_clean += mss->shared_clean;
+	st->shared_dirty += mss->shared_dirty;
+	st->private_clean += mss->private_clean;
+	st->private_dirty += mss->private_dirty;
+	st->referenced += mss->referenced;
+	st->anonymous += mss->anonymous;
+	st->lazyfree += mss->lazyfree;
+	st->swap += mss->swap;
+	st->swap_pss += mss->swap_pss >> PSS_SHIFT;
+	st->locked += mss->pss_locked >> PSS_SHIFT;
+}
+
+/*
+ * SMAPS_ROLLUP_QUERY: the same page table walk as reading smaps_rollup,
+ * handed back as numbers instead of text, and split by the kind of
+ * mapping, which the text form cannot do for anything but Pss.
+ */
+/* Called with the seq_file lock held */
+static long smaps_rollup_query(struct proc_maps_private *priv,
+			       struct smaps_rollup_query __user *uq)
+{
+	struct smaps_rollup_query q;
+	struct mem_size_stats mss;
+	struct vm_area_struct *vma;
+	struct mm_struct *mm;
+	u64 usize, reserved;
+	int ret;
+
+	if (get_user(usize, &uq->size) || get_user(reserved, &uq->reserved))
+		return -EFAULT;
+	if (usize < sizeof(q) || reserved)
+		return -EINVAL;
+
+	priv->task = get_proc_task(priv->inode);
+	if (!priv->task)
+		return -ESRCH;
+
+	mm = priv->mm;
+	if (!mm || !mmget_not_zero(mm)) {
+		ret = -ESRCH;
+		goto out_put_task;
+	}
+
+	memset(&q, 0, sizeof(q));
+	q.size = sizeof(q);
+
+	ret = mmap_read_lock_killable(mm);
+	if (ret)
+		goto out_put_mm;
+
+	hold_task_mempolicy(priv);
+
+	for (vma = mm->mmap; vma; vma = vma->vm_next) {
+		memset(&mss, 0, sizeof(mss));
+		smap_gather_stats(vma, &mss);
+		smaps_rollup_account(&q.stats[smaps_rollup_class(vma)],
+				     vma, &mss);
+	}
+
+	release_task_mempolicy(priv);
+	mmap_read_unlock(mm);
+
+	if (copy_to_user(uq, &q, sizeof(q)))
+		ret = -EFAULT;
+
+out_put_mm:
+	mmput(mm);
+out_put_task:
+	put_task_struct(priv->task);
+	priv->task = NULL;
+
+	return ret;
+}
+
+static long smaps_rollup_ioctl(struct file *file, unsigned int cmd,
+			       unsigned long arg)
+{
+	struct seq_file *seq = file->private_data;
+	long ret;
+
+	switch (cmd) {
+	case SMAPS_ROLLUP_QUERY:
+		/* priv->task and the held mempolicy are shared with seq_read() */
+		mutex_lock(&seq->lock);
+		ret = smaps_rollup_query(seq->private, (void __user *)arg);
+		mutex_unlock(&seq->lock);
+		return ret;
+	default:
+		return -ENOTTY;
+	}
+}
+
 const struct file_operations proc_pid_smaps_operations = {
 	.open		= pid_smaps_open,
 	.read		= seq_read,
@@ -942,6 +1051,8 @@ const struct file_operations proc_pid_smaps_rollup_operations = {
 	.open		= smaps_rollup_open,
 	.read		= seq_read,
 	.llseek		= seq_lseek,
+	.unlocked_ioctl	= smaps_rollup_ioctl,
+	.compat_ioctl	= compat_ptr_ioctl,
 	.release	= smaps_rollup_release,
 };
 
@@ -93,6 +93,7 @@ struct pstore_zone {
  * @ppsz: pmsg storage zone
  * @cpsz: console storage zone
  * @fpszs: ftrace storage zones
+ * @kmsg_spare: spare dmesg zone buffer, swapped in by each dmesg write
  * @kmsg_max_cnt: max count of @kpszs
  * @kmsg_read_cnt: counter of total read kmsg dumps
  * @kmsg_write_cnt: counter of total kmsg dump writes
@@ -113,6 +114,7 @@ struct psz_context {
 	struct pstore_zone *ppsz;
 	struct pstore_zone *cpsz;
 	struct pstore_zone **fpszs;
+	struct psz_buffer *kmsg_spare;
 	unsigned int kmsg_max_cnt;
 	unsigned int kmsg_read_cnt;
 	unsigned int kmsg_write_cnt;
@@ -758,14 +760,18 @@ static inline int notrace psz_kmsg_write_record(struct psz_context *cxt,
 		if (unlikely(!zone))
 			return -ENOSPC;
 
-		/* avoid destroying old data, allocate a new one */
+		/*
+		 * Avoid destroying old data, write to the spare buffer. It is
+		 * preallocated as oops and panic dumps may run in atomic
+		 * context, and the one of the zone becomes the next spare.
+		 */
+		if (unlikely(!cxt->kmsg_spare))
+			return -ENOMEM;
 		len = zone->buffer_size + sizeof(*zone->buffer);
 		zone->oldbuf = zone->buffer;
-		zone->buffer = kzalloc(len, GFP_KERNEL);
-		if (!zone->buffer) {
-			zone->buffer = zone->oldbuf;
-			return -ENOMEM;
-		}
+		zone->buffer = cxt->kmsg_spare;
+		cxt->kmsg_spare = NULL;
+		memset(zone->buffer, 0, len);
 		zone->buffer->sig = zone->oldbuf->sig;
 
 		pr_debug("write %s to zone id %d\n", zone->name, zonenum);
@@ -776,15 +782,15 @@ static inline int notrace psz_kmsg_write_record(struct psz_context *cxt,
 		if (likely(!ret || ret != -ENOMSG)) {
 			cxt->kmsg_write_cnt = zonenum + 1;
 			cxt->kmsg_write_cnt %= cxt->kmsg_max_cnt;
-			/* no need to try next zone, free last zone buffer */
-			kfree(zone->oldbuf);
+			/* no need to try next zone, keep last zone buffer */
+			cxt->kmsg_spare = zone->oldbuf;
 			zone->oldbuf = NULL;
 			return ret;
 		}
 
 		pr_debug("zone %u may be broken, try next dmesg zone\n",
 				zonenum);
-		kfree(zone->buffer);
+		cxt->kmsg_spare = zone->buffer;
 		zone->buffer = zone->oldbuf;
 		zone->oldbuf = NULL;
 	}
@@ -1138,6 +1144,8 @@ static void psz_free_zones(struct pstore_zone ***pszones, unsigned int *cnt)
 
 static void psz_free_all_zones(struct psz_context *cxt)
 {
+	kfree(cxt->kmsg_spare);
+	cxt->kmsg_spare = NULL;
 	if (cxt->kpszs)
 		psz_free_zones(&cxt->kpszs, &cxt->kmsg_max_cnt);
 	if (cxt->ppsz)
@@ -1276,6 +1284,15 @@ static int psz_alloc_zones(struct psz_context *cxt)
 		goto free_out;
 	}
 
+	if (cxt->kpszs) {
+		cxt->kmsg_spare = kzalloc(cxt->kpszs[0]->buffer_size +
+				sizeof(struct psz_buffer), GFP_KERNEL);
+		if (!cxt->kmsg_spare) {
+			err = -ENOMEM;
+			goto free_out;
+		}
+	}
+
 	return 0;
 free_out:
 	psz_free_all_zones(cxt);
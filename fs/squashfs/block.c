@@ -73,8 +73,8 @@ static int copy_bio_to_actor(struct bio *bio,
 	return copied_bytes;
 }
 
-static int squashfs_bio_read(struct super_block *sb, u64 index, int length,
-			     struct bio **biop, int *block_offset)
+static int squashfs_bio_alloc(struct super_block *sb, u64 index, int length,
+			      struct bio **biop, int *block_offset)
 {
 	struct squashfs_sb_info *msblk = sb->s_fs_info;
 	const u64 read_start = round_down(index, msblk->devblksize);
@@ -112,10 +112,6 @@ static int squashfs_bio_read(struct super_block *sb, u64 index, int length,
 		total_len -= len;
 	}
 
-	error = submit_bio_wait(bio);
-	if (error)
-		goto out_free_bio;
-
 	*biop = bio;
 	*block_offset = index & ((1 << msblk->devblksize_log2) - 1);
 	return 0;
@@ -126,6 +122,34 @@ static int squashfs_bio_read(struct super_block *sb, u64 index, int length,
 	return error;
 }
 
+static int squashfs_bio_read(struct super_block *sb, u64 index, int length,
+			     struct bio **biop, int *block_offset)
+{
+	int error = squashfs_bio_alloc(sb, index, length, biop, block_offset);
+
+	if (error)
+		return error;
+
+	error = submit_bio_wait(*biop);
+	if (error) {
+		bio_free_pages(*biop);
+		bio_put(*biop);
+	}
+	return error;
+}
+
+/* Decompress or copy the data read into @bio to @output */
+static int squashfs_bio_decode(struct squashfs_sb_info *msblk,
+			       struct bio *bio, int compressed, int offset,
+			       int length, struct squashfs_page_actor *output)
+{
+	if (!compressed)
+		return copy_bio_to_actor(bio, output, offset, length);
+	if (!msblk->stream)
+		return -EIO;
+	return squashfs_decompress(msblk, bio, offset, length, output);
+}
+
 /*
  * Read and decompress a metadata block or datablock.  Length is non-zero
  * if a datablock is being read (the size is stored elsewhere in the
@@ -202,15 +226,8 @@ int squashfs_read_data(struct super_block *sb, u64 index, int length,
 	if (res)
 		goto out;
 
-	if (compressed) {
-		if (!msblk->stream) {
-			res = -EIO;
-			goto out_free_bio;
-		}
-		res = squashfs_decompress(msblk, bio, offset, length, output);
-	} else {
-		res = copy_bio_to_actor(bio, output, offset, length);
-	}
+	res = squashfs_bio_decode(msblk, bio, compressed, offset, length,
+				  output);
 
 out_free_bio:
 	bio_free_pages(bio);
@@ -221,3 +238,69 @@ int squashfs_read_data(struct super_block *sb, u64 index, int length,
 
 	return res;
 }
+
+static void squashfs_bio_end_io(struct bio *bio)
+{
+	complete(bio->bi_private);
+}
+
+/*
+ * Start reading the datablock at @index with on-disk length @length
+ * (including the compressed bit) without waiting for it, so several
+ * datablocks can be in flight while earlier ones are decompressed.
+ * Finish with squashfs_read_data_end().
+ */
+int squashfs_read_data_start(struct super_block *sb, u64 index, int length,
+			     struct squashfs_bio_request *req)
+{
+	int res;
+
+	req->compressed = SQUASHFS_COMPRESSED_BLOCK(length);
+	req->length = SQUASHFS_COMPRESSED_SIZE_BLOCK(length);
+	req->index = index;
+	init_completion(&req->done);
+
+	res = squashfs_bio_alloc(sb, index, req->length, &req->bio,
+				 &req->offset);
+	if (res) {
+		req->bio = NULL;
+		ERROR("Failed to read block 0x%llx: %d\n", index, res);
+		return res;
+	}
+
+	req->bio->bi_private = &req->done;
+	req->bio->bi_end_io = squashfs_bio_end_io;
+	submit_bio(req->bio);
+	return 0;
+}
+
+/*
+ * Wait for a datablock started by squashfs_read_data_start() and
+ * decompress it into @output, or just release it if @output is NULL.
+ * Returns the same as squashfs_read_data().
+ */
+int squashfs_read_data_end(struct super_block *sb,
+			   struct squashfs_bio_request *req,
+			   struct squashfs_page_actor *output)
+{
+	struct bio *bio = req->bio;
+	int res;
+
+	if (!bio)
+		return -EIO;
+
+	wait_for_completion_io(&req->done);
+	res = blk_status_to_errno(bio->bi_status);
+	if (!res && output)
+		res = squashfs_bio_decode(sb->s_fs_info, bio, req->compressed,
+					  req->offset, req->length, output);
+
+	bio_free_pages(bio);
+	bio_put(bio);
+	req->bio = NULL;
+
+	if (res < 0)
+		ERROR("Failed to read block 0x%llx: %d\n", req->index, res);
+
+	return res;
+}
@@ -34,11 +34,14 @@
 #include <linux/string.h>
 #include <linux/pagemap.h>
 #include <linux/mutex.h>
+#include <linux/moduleparam.h>
+#include <linux/workqueue.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
 #include "squashfs_fs_i.h"
 #include "squashfs.h"
+#include "page_actor.h"
 
 /*
  * Locate cache slot in range [offset, index] for specified inode.  If
@@ -319,9 +322,234 @@ static int fill_meta_index(struct inode *inode, int index,
 }
 
 
+/*
+ * Free up to nr block indexes, least recently used first.  If room is
+ * non-zero stop as soon as that many bytes fit under the per-filesystem
+ * bound.  Indexes in use are off the LRU list, so they are never seen
+ * here.
+ */
+static unsigned long block_index_evict(struct squashfs_sb_info *msblk,
+		unsigned long nr, size_t room)
+{
+	struct squashfs_inode_info *victim;
+	struct squashfs_block_index *bi;
+	unsigned long freed = 0;
+
+	while (freed < nr) {
+		spin_lock(&msblk->block_index_lock);
+		if ((room && msblk->block_index_bytes + room <=
+				SQUASHFS_BLOCK_INDEX_BYTES) ||
+				list_empty(&msblk->block_index_lru)) {
+			spin_unlock(&msblk->block_index_lock);
+			break;
+		}
+
+		victim = list_last_entry(&msblk->block_index_lru,
+				struct squashfs_inode_info, block_index_lru);
+		bi = victim->block_index;
+		victim->block_index = NULL;
+		list_del_init(&victim->block_index_lru);
+		msblk->block_index_bytes -= bi->size;
+		msblk->block_index_nr--;
+		spin_unlock(&msblk->block_index_lock);
+
+		kvfree(bi);
+		freed++;
+	}
+
+	return freed;
+}
+
+
+/*
+ * Allocate the block index of inode, with entry 0 pointing at the start
+ * of its block list.  Returns NULL if the file is too small to need one,
+ * too large to fit, or memory is short.  The bytes are reserved against
+ * SQUASHFS_BLOCK_INDEX_BYTES before the allocation, so the bound holds
+ * even if indexes in use could not be evicted.  Called with the inode
+ * block index mutex held.
+ */
+static struct squashfs_block_index *block_index_alloc(struct inode *inode)
+{
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	struct squashfs_inode_info *si = squashfs_i(inode);
+	struct squashfs_block_index *bi;
+	long long blocks = (i_size_read(inode) + msblk->block_size - 1) >>
+				msblk->block_log;
+	int max_entries;
+	size_t size;
+
+	if (blocks < 2 * SQUASHFS_BLOCK_INDEX_STRIDE)
+		return NULL;
+
+	max_entries = blocks / SQUASHFS_BLOCK_INDEX_STRIDE + 1;
+	size = struct_size(bi, entry, max_entries);
+	if (size > SQUASHFS_BLOCK_INDEX_BYTES)
+		return NULL;
+
+	block_index_evict(msblk, ULONG_MAX, size);
+
+	spin_lock(&msblk->block_index_lock);
+	if (msblk->block_index_bytes + size > SQUASHFS_BLOCK_INDEX_BYTES) {
+		spin_unlock(&msblk->block_index_lock);
+		return NULL;
+	}
+	msblk->block_index_bytes += size;
+	msblk->block_index_nr++;
+	spin_unlock(&msblk->block_index_lock);
+
+	bi = kvmalloc(size, GFP_KERNEL);
+	if (bi == NULL) {
+		spin_lock(&msblk->block_index_lock);
+		msblk->block_index_bytes -= size;
+		msblk->block_index_nr--;
+		spin_unlock(&msblk->block_index_lock);
+		return NULL;
+	}
+
+	bi->size = size;
+	bi->entries = 1;
+	bi->max_entries = max_entries;
+	bi->entry[0].index_block = si->block_list_start - msblk->inode_table;
+	bi->entry[0].offset = si->offset;
+	bi->entry[0].data_block = si->start;
+
+	spin_lock(&msblk->block_index_lock);
+	si->block_index = bi;
+	spin_unlock(&msblk->block_index_lock);
+
+	return bi;
+}
+
+
+/*
+ * Look up index in the block index of the inode, growing it as far as
+ * necessary.  Unlike the meta_index slots, which are shared by all
+ * inodes, the block index stays with the inode until it is evicted or the
+ * shrinker frees it, so once built any datablock is found by reading
+ * fewer than SQUASHFS_BLOCK_INDEX_STRIDE block list entries.  Returns
+ * -ENOENT if the inode has no block index, otherwise as fill_meta_index().
+ *
+ * The inode mutex serialises users of the index, and while it is in use
+ * the index is taken off the LRU list so that the shrinker cannot free it.
+ */
+static int block_index_find(struct inode *inode, int index,
+		u64 *index_block, int *index_offset, u64 *data_block)
+{
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	struct squashfs_inode_info *si = squashfs_i(inode);
+	struct squashfs_block_index *bi;
+	struct meta_entry *entry;
+	int want = index / SQUASHFS_BLOCK_INDEX_STRIDE;
+	u64 cur_index_block, cur_data_block;
+	int cur_offset, err = 0;
+
+	if (want == 0)
+		return -ENOENT;
+
+	mutex_lock(&si->block_index_mutex);
+	spin_lock(&msblk->block_index_lock);
+	bi = si->block_index;
+	if (bi)
+		list_del_init(&si->block_index_lru);
+	spin_unlock(&msblk->block_index_lock);
+
+	if (bi == NULL) {
+		bi = block_index_alloc(inode);
+		if (bi == NULL) {
+			mutex_unlock(&si->block_index_mutex);
+			return -ENOENT;
+		}
+	}
+
+	if (want >= bi->max_entries) {
+		err = -EIO;
+		goto out;
+	}
+
+	entry = &bi->entry[bi->entries - 1];
+	cur_index_block = entry->index_block + msblk->inode_table;
+	cur_offset = entry->offset;
+	cur_data_block = entry->data_block;
+
+	while (bi->entries <= want) {
+		long long res = read_indexes(inode->i_sb,
+				SQUASHFS_BLOCK_INDEX_STRIDE, &cur_index_block,
+				&cur_offset);
+
+		if (res < 0) {
+			err = res;
+			goto out;
+		}
+
+		cur_data_block += res;
+		entry = &bi->entry[bi->entries++];
+		entry->index_block = cur_index_block - msblk->inode_table;
+		entry->offset = cur_offset;
+		entry->data_block = cur_data_block;
+	}
+
+	entry = &bi->entry[want];
+	*index_block = entry->index_block + msblk->inode_table;
+	*index_offset = entry->offset;
+	*data_block = entry->data_block;
+
+out:
+	spin_lock(&msblk->block_index_lock);
+	list_add(&si->block_index_lru, &msblk->block_index_lru);
+	spin_unlock(&msblk->block_index_lock);
+	mutex_unlock(&si->block_index_mutex);
+	return err ? err : want * SQUASHFS_BLOCK_INDEX_STRIDE;
+}
+
+
+/* Called when the inode is evicted, so the index is no longer in use */
+void squashfs_block_index_free(struct inode *inode)
+{
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	struct squashfs_inode_info *si = squashfs_i(inode);
+	struct squashfs_block_index *bi;
+
+	spin_lock(&msblk->block_index_lock);
+	bi = si->block_index;
+	if (bi) {
+		si->block_index = NULL;
+		list_del_init(&si->block_index_lru);
+		msblk->block_index_bytes -= bi->size;
+		msblk->block_index_nr--;
+	}
+	spin_unlock(&msblk->block_index_lock);
+
+	kvfree(bi);
+}
+
+
+unsigned long squashfs_block_index_count(struct shrinker *shrink,
+		struct shrink_control *sc)
+{
+	struct squashfs_sb_info *msblk = container_of(shrink,
+			struct squashfs_sb_info, block_index_shrinker);
+	unsigned long nr = READ_ONCE(msblk->block_index_nr);
+
+	return nr ? nr : SHRINK_EMPTY;
+}
+
+
+unsigned long squashfs_block_index_scan(struct shrinker *shrink,
+		struct shrink_control *sc)
+{
+	struct squashfs_sb_info *msblk = container_of(shrink,
+			struct squashfs_sb_info, block_index_shrinker);
+	unsigned long freed = block_index_evict(msblk, sc->nr_to_scan, 0);
+
+	return freed ? freed : SHRINK_STOP;
+}
+
+
 /*
  * Get the on-disk location and compressed size of the datablock
- * specified by index.  Fill_meta_index() does most of the work.
+ * specified by index.  Block_index_find() or fill_meta_index() does most
+ * of the work.
  */
 static int read_blocklist(struct inode *inode, int index, u64 *block)
 {
@@ -329,7 +557,10 @@ static int read_blocklist(struct inode *inode, int index, u64 *block)
 	long long blks;
 	int offset;
 	__le32 size;
-	int res = fill_meta_index(inode, index, &start, &offset, block);
+	int res = block_index_find(inode, index, &start, &offset, block);
+
+	if (res == -ENOENT)
+		res = fill_meta_index(inode, index, &start, &offset, block);
 
 	TRACE("read_blocklist: res %d, index %d, start 0x%llx, offset"
 		       " 0x%x, block 0x%llx\n", res, index, start, offset,
@@ -339,9 +570,9 @@ static int read_blocklist(struct inode *inode, int index, u64 *block)
 		return res;
 
 	/*
-	 * res contains the index of the mapping returned by fill_meta_index(),
-	 * this will likely be less than the desired index (because the
-	 * meta_index cache works at a higher granularity).  Read any
+	 * res contains the index of the mapping returned by block_index_find()
+	 * or fill_meta_index(), this will likely be less than the desired
+	 * index (because both caches work at a higher granularity).  Read any
 	 * extra block indexes needed.
 	 */
 	if (res < index) {
@@ -494,7 +725,288 @@ static int squashfs_readpage(struct file *file, struct page *page)
 	return 0;
 }
 
+#ifdef CONFIG_SQUASHFS_FILE_DIRECT
+/* Datablocks a readahead request keeps in flight at once */
+#define SQUASHFS_RA_BLOCKS	8
+
+struct squashfs_ra_block {
+	struct squashfs_bio_request	req;
+	struct squashfs_page_actor	*actor;
+	struct page			**page;
+	int				pages;
+	int				expected;
+};
+
+static void squashfs_ra_release(struct page **page, int pages)
+{
+	int i;
+
+	for (i = 0; i < pages; i++) {
+		unlock_page(page[i]);
+		put_page(page[i]);
+	}
+}
+
+/*
+ * Fill readahead pages which cover only part of a datablock, a sparse
+ * block or the tail end fragment.  Going through the cache leaves the
+ * decompressed block there for the pages of the same block that the
+ * next readahead window or squashfs_readpage() asks for.
+ */
+static void squashfs_ra_fill_cached(struct inode *inode, struct page **page,
+				    int pages, bool fragment, u64 block,
+				    int bsize, int expected)
+{
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	int mask = (1 << (msblk->block_log - PAGE_SHIFT)) - 1;
+	struct squashfs_cache_entry *buffer = NULL;
+	int i, base = 0;
+
+	if (fragment) {
+		buffer = squashfs_get_fragment(inode->i_sb,
+					       squashfs_i(inode)->fragment_block,
+					       squashfs_i(inode)->fragment_size);
+		base = squashfs_i(inode)->fragment_offset;
+	} else if (bsize) {
+		buffer = squashfs_get_datablock(inode->i_sb, block, bsize);
+	}
+
+	/* Leave the pages to squashfs_readpage() to report the error */
+	if (buffer && buffer->error)
+		goto out;
+
+	for (i = 0; i < pages; i++) {
+		int offset = (page[i]->index & mask) << PAGE_SHIFT;
+		int avail = buffer ? clamp(expected - offset, 0, (int)PAGE_SIZE) : 0;
+
+		squashfs_fill_page(page[i], buffer, base + offset, avail);
+	}
+
+out:
+	squashfs_ra_release(page, pages);
+	if (buffer)
+		squashfs_cache_put(buffer);
+}
+
+static void squashfs_ra_finish(struct super_block *sb,
+			       struct squashfs_ra_block *b)
+{
+	int i, bytes, res;
+
+	res = squashfs_read_data_end(sb, &b->req, b->actor);
+	if (res == b->expected) {
+		/* Last page may have trailing bytes not filled */
+		bytes = res % PAGE_SIZE;
+		if (bytes) {
+			void *pageaddr = kmap_atomic(b->page[b->pages - 1]);
+
+			memset(pageaddr + bytes, 0, PAGE_SIZE - bytes);
+			kunmap_atomic(pageaddr);
+		}
+
+		for (i = 0; i < b->pages; i++) {
+			flush_dcache_page(b->page[i]);
+			SetPageUptodate(b->page[i]);
+		}
+	}
+
+	squashfs_ra_release(b->page, b->pages);
+	kfree(b->actor);
+}
+
+/*
+ * With more than one decompressor, the datablocks of a readahead batch can
+ * be decompressed on several CPUs.  The reader and up to one helper work
+ * item per other online CPU take the next block from a shared counter
+ * until none are left, so a CPU which finishes early takes more.
+ */
+static bool decompress_fanout;
+module_param(decompress_fanout, bool, 0644);
+MODULE_PARM_DESC(decompress_fanout,
+		 "Decompress readahead datablocks on several CPUs");
+
+struct squashfs_ra_batch {
+	struct super_block		*sb;
+	struct squashfs_ra_block	*ra;
+	int				nr;
+	atomic_t			next;
+};
+
+struct squashfs_ra_helper {
+	struct work_struct		work;
+	struct squashfs_ra_batch	*batch;
+};
+
+static void squashfs_ra_drain(struct squashfs_ra_batch *batch)
+{
+	int i;
+
+	while ((i = atomic_inc_return(&batch->next) - 1) < batch->nr)
+		squashfs_ra_finish(batch->sb, &batch->ra[i]);
+}
+
+static void squashfs_ra_helper_fn(struct work_struct *work)
+{
+	struct squashfs_ra_helper *helper =
+		container_of(work, struct squashfs_ra_helper, work);
+
+	squashfs_ra_drain(helper->batch);
+}
+
+static struct squashfs_ra_helper *squashfs_ra_helpers_alloc(void)
+{
+	struct squashfs_ra_helper *helpers;
+	int i;
+
+	if (!READ_ONCE(decompress_fanout) || num_online_cpus() < 2 ||
+	    squashfs_max_decompressors() < 2)
+		return NULL;
+
+	helpers = kcalloc(SQUASHFS_RA_BLOCKS - 1, sizeof(*helpers), GFP_KERNEL);
+	if (helpers)
+		for (i = 0; i < SQUASHFS_RA_BLOCKS - 1; i++)
+			INIT_WORK(&helpers[i].work, squashfs_ra_helper_fn);
+	return helpers;
+}
+
+static void squashfs_ra_finish_all(struct super_block *sb,
+				   struct squashfs_ra_block *ra, int nr,
+				   struct squashfs_ra_helper *helpers)
+{
+	struct squashfs_ra_batch batch;
+	int i, nr_helpers;
+
+	nr_helpers = min3(nr - 1, (int)num_online_cpus() - 1,
+			  squashfs_max_decompressors() - 1);
+	if (!helpers || nr_helpers < 1) {
+		for (i = 0; i < nr; i++)
+			squashfs_ra_finish(sb, &ra[i]);
+		return;
+	}
+
+	batch.sb = sb;
+	batch.ra = ra;
+	batch.nr = nr;
+	atomic_set(&batch.next, 0);
+
+	for (i = 0; i < nr_helpers; i++) {
+		helpers[i].batch = &batch;
+		queue_work(system_unbound_wq, &helpers[i].work);
+	}
+
+	squashfs_ra_drain(&batch);
+
+	/*
+	 * Helpers which have not started yet find nothing left to do and
+	 * are cancelled, so the reader never waits for a worker to be
+	 * created, only for blocks already being decompressed.
+	 */
+	for (i = 0; i < nr_helpers; i++)
+		cancel_work_sync(&helpers[i].work);
+}
+
+/*
+ * Read ahead whole datablocks straight into the page cache.  The reads
+ * of up to SQUASHFS_RA_BLOCKS datablocks are started before the first one
+ * is decompressed, so the device works on the next blocks while the CPU
+ * decompresses.  Pages which are not uptodate afterwards are read again
+ * by squashfs_readpage().
+ */
+static void squashfs_readahead(struct readahead_control *rac)
+{
+	struct inode *inode = rac->mapping->host;
+	struct super_block *sb = inode->i_sb;
+	struct squashfs_sb_info *msblk = sb->s_fs_info;
+	int shift = msblk->block_log - PAGE_SHIFT;
+	pgoff_t mask = (1 << shift) - 1;
+	loff_t isize = i_size_read(inode);
+	int file_end = isize >> msblk->block_log;
+	pgoff_t last_page = (isize - 1) >> PAGE_SHIFT;
+	struct squashfs_ra_helper *helpers;
+	struct squashfs_ra_block *ra;
+	struct page **pages;
+	int nr;
+
+	if (!isize)
+		return;
+
+	pages = kmalloc_array(readahead_count(rac), sizeof(*pages), GFP_KERNEL);
+	ra = kcalloc(SQUASHFS_RA_BLOCKS, sizeof(*ra), GFP_KERNEL);
+	if (!pages || !ra)
+		goto out;
+	helpers = squashfs_ra_helpers_alloc();
+
+	while (readahead_count(rac)) {
+		struct page **page = pages;
+
+		for (nr = 0; nr < SQUASHFS_RA_BLOCKS && readahead_count(rac);) {
+			struct squashfs_ra_block *b = &ra[nr];
+			pgoff_t start = readahead_index(rac);
+			int index = start >> shift;
+			pgoff_t first = (pgoff_t)index << shift;
+			pgoff_t last = min(first | mask, last_page);
+			int expected = index == file_end ?
+					(isize & (msblk->block_size - 1)) :
+					 msblk->block_size;
+			bool fragment = index == file_end &&
+					squashfs_i(inode)->fragment_block !=
+					SQUASHFS_INVALID_BLK;
+			int n, bsize = 0;
+			u64 block = 0;
+
+			/* At most the pages of this datablock */
+			n = __readahead_batch(rac, page, (first | mask) - start + 1);
+			if (!n)
+				break;
+
+			if (start > last_page) {
+				squashfs_ra_release(page, n);
+				continue;
+			}
+
+			if (!fragment) {
+				bsize = read_blocklist(inode, index, &block);
+				if (bsize < 0) {
+					squashfs_ra_release(page, n);
+					continue;
+				}
+			}
+
+			if (fragment || !bsize || start != first ||
+			    page[n - 1]->index != last) {
+				squashfs_ra_fill_cached(inode, page, n, fragment,
+							block, bsize, expected);
+				continue;
+			}
+
+			b->actor = squashfs_page_actor_init_special(page, n, 0);
+			if (!b->actor ||
+			    squashfs_read_data_start(sb, block, bsize, &b->req)) {
+				kfree(b->actor);
+				squashfs_ra_release(page, n);
+				continue;
+			}
+
+			b->page = page;
+			b->pages = n;
+			b->expected = expected;
+			page += n;
+			nr++;
+		}
+
+		squashfs_ra_finish_all(sb, ra, nr, helpers);
+	}
+
+	kfree(helpers);
+out:
+	kfree(ra);
+	kfree(pages);
+}
+#endif
 
 const struct address_space_operations squashfs_aops = {
-	.readpage = squashfs_readpage
+	.readpage = squashfs_readpage,
+#ifdef CONFIG_SQUASHFS_FILE_DIRECT
+	.readahead = squashfs_readahead,
+#endif
 };
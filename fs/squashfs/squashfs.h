@@ -8,6 +8,8 @@
  * squashfs.h
  */
 
+#include <linux/completion.h>
+
 #define TRACE(s, args...)	pr_debug("SQUASHFS: "s, ## args)
 
 #define ERROR(s, args...)	pr_err("SQUASHFS error: "s, ## args)
@@ -15,8 +17,22 @@
 #define WARNING(s, args...)	pr_warn("SQUASHFS: "s, ## args)
 
 /* block.c */
+struct squashfs_bio_request {
+	struct bio		*bio;
+	struct completion	done;
+	u64			index;
+	int			length;
+	int			offset;
+	int			compressed;
+};
+
 extern int squashfs_read_data(struct super_block *, u64, int, u64 *,
 				struct squashfs_page_actor *);
+extern int squashfs_read_data_start(struct super_block *, u64, int,
+				struct squashfs_bio_request *);
+extern int squashfs_read_data_end(struct super_block *,
+				struct squashfs_bio_request *,
+				struct squashfs_page_actor *);
 
 /* cache.c */
 extern struct squashfs_cache *squashfs_cache_init(char *, int, int);
@@ -57,6 +73,11 @@ extern __le64 *squashfs_read_fragment_index_table(struct super_block *,
 void squashfs_fill_page(struct page *, struct squashfs_cache_entry *, int, int);
 void squashfs_copy_cache(struct page *, struct squashfs_cache_entry *, int,
 				int);
+extern void squashfs_block_index_free(struct inode *);
+extern unsigned long squashfs_block_index_count(struct shrinker *,
+				struct shrink_control *);
+extern unsigned long squashfs_block_index_scan(struct shrinker *,
+				struct shrink_control *);
 
 /* file_xxx.c */
 extern int squashfs_readpage_block(struct page *, u64, int, int);
@@ -215,6 +215,20 @@ struct meta_entry {
 	unsigned short		pad;
 };
 
+/*
+ * per-inode block index, one entry every SQUASHFS_BLOCK_INDEX_STRIDE
+ * datablocks, bounded to SQUASHFS_BLOCK_INDEX_BYTES per filesystem
+ */
+#define SQUASHFS_BLOCK_INDEX_STRIDE	32
+#define SQUASHFS_BLOCK_INDEX_BYTES	(1 << 20)
+
+struct squashfs_block_index {
+	size_t			size;
+	int			entries;
+	int			max_entries;
+	struct meta_entry	entry[];
+};
+
 struct meta_index {
 	unsigned int		inode_number;
 	unsigned int		offset;
@@ -30,6 +30,9 @@ struct squashfs_inode_info {
 			int		parent;
 		};
 	};
+	struct mutex	block_index_mutex;
+	struct squashfs_block_index *block_index;
+	struct list_head block_index_lru;
 	struct inode	vfs_inode;
 };
 
@@ -53,6 +53,11 @@ struct squashfs_sb_info {
 	__le64					*xattr_id_table;
 	struct mutex				meta_index_mutex;
 	struct meta_index			*meta_index;
+	spinlock_t				block_index_lock;
+	struct list_head			block_index_lru;
+	size_t					block_index_bytes;
+	unsigned long				block_index_nr;
+	struct shrinker				block_index_shrinker;
 	struct squashfs_stream			*stream;
 	__le64					*inode_lookup_table;
 	u64					inode_table;
@@ -89,6 +89,8 @@ static int squashfs_fill_super(struct super_block *sb, struct fs_context *fc)
 	msblk->devblksize_log2 = ffz(~msblk->devblksize);
 
 	mutex_init(&msblk->meta_index_mutex);
+	spin_lock_init(&msblk->block_index_lock);
+	INIT_LIST_HEAD(&msblk->block_index_lru);
 
 	/*
 	 * msblk->bytes_used is checked in squashfs_read_table to ensure reads
@@ -300,6 +302,13 @@ static int squashfs_fill_super(struct super_block *sb, struct fs_context *fc)
 		goto insanity;
 	}
 
+	msblk->block_index_shrinker.count_objects = squashfs_block_index_count;
+	msblk->block_index_shrinker.scan_objects = squashfs_block_index_scan;
+	msblk->block_index_shrinker.seeks = DEFAULT_SEEKS;
+	err = register_shrinker(&msblk->block_index_shrinker);
+	if (err)
+		goto failed_mount;
+
 	/* allocate root */
 	root = new_inode(sb);
 	if (!root) {
@@ -329,6 +338,7 @@ static int squashfs_fill_super(struct super_block *sb, struct fs_context *fc)
 insanity:
 	errorf(fc, "squashfs image failed sanity check");
 failed_mount:
+	unregister_shrinker(&msblk->block_index_shrinker);
 	squashfs_cache_delete(msblk->block_cache);
 	squashfs_cache_delete(msblk->fragment_cache);
 	squashfs_cache_delete(msblk->read_page);
@@ -391,6 +401,7 @@ static void squashfs_put_super(struct super_block *sb)
 {
 	if (sb->s_fs_info) {
 		struct squashfs_sb_info *sbi = sb->s_fs_info;
+		unregister_shrinker(&sbi->block_index_shrinker);
 		squashfs_cache_delete(sbi->block_cache);
 		squashfs_cache_delete(sbi->fragment_cache);
 		squashfs_cache_delete(sbi->read_page);
@@ -412,6 +423,7 @@ static void init_once(void *foo)
 {
 	struct squashfs_inode_info *ei = foo;
 
+	mutex_init(&ei->block_index_mutex);
 	inode_init_once(&ei->vfs_inode);
 }
 
@@ -469,7 +481,20 @@ static struct inode *squashfs_alloc_inode(struct super_block *sb)
 	struct squashfs_inode_info *ei =
 		kmem_cache_alloc(squashfs_inode_cachep, GFP_KERNEL);
 
-	return ei ? &ei->vfs_inode : NULL;
+	if (ei == NULL)
+		return NULL;
+
+	ei->block_index = NULL;
+	INIT_LIST_HEAD(&ei->block_index_lru);
+	return &ei->vfs_inode;
+}
+
+
+static void squashfs_evict_inode(struct inode *inode)
+{
+	truncate_inode_pages_final(&inode->i_data);
+	clear_inode(inode);
+	squashfs_block_index_free(inode);
 }
 
 
@@ -490,6 +515,7 @@ MODULE_ALIAS_FS("squashfs");
 static const struct super_operations squashfs_super_ops = {
 	.alloc_inode = squashfs_alloc_inode,
 	.free_inode = squashfs_free_inode,
+	.evict_inode = squashfs_evict_inode,
 	.statfs = squashfs_statfs,
 	.put_super = squashfs_put_super,
 };
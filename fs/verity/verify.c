@@ -66,6 +66,28 @@ static inline int cmp_hashes(const struct fsverity_info *vi,
 	return -EBADMSG;
 }
 
+/*
+ * The level 0 hash page last used while verifying a bio.  Consecutive data
+ * pages of a bio almost always share it, so holding it across the pages
+ * spares a Merkle tree page lookup for each of them.
+ */
+struct verify_hash_cache {
+	struct page *hpage;
+	pgoff_t hindex;
+};
+
+static void verify_hash_cache_set(struct verify_hash_cache *cache,
+				  struct page *hpage, pgoff_t hindex)
+{
+	if (cache->hpage == hpage)
+		return;
+	if (cache->hpage)
+		put_page(cache->hpage);
+	get_page(hpage);
+	cache->hpage = hpage;
+	cache->hindex = hindex;
+}
+
 /*
  * Verify a single data page against the file's Merkle tree.
  *
@@ -81,11 +103,15 @@ static inline int cmp_hashes(const struct fsverity_info *vi,
  * Note that multiple processes may race to verify a hash page and mark it
  * Checked, but it doesn't matter; the result will be the same either way.
  *
+ * If @cache is given, the level 0 hash page is taken from it when it is the
+ * one needed, and the one used is left in it for the next data page.
+ *
  * Return: true if the page is valid, else false.
  */
 static bool verify_page(struct inode *inode, const struct fsverity_info *vi,
 			struct ahash_request *req, struct page *data_page,
-			unsigned long level0_ra_pages)
+			unsigned long level0_ra_pages,
+			struct verify_hash_cache *cache)
 {
 	const struct merkle_tree_params *params = &vi->tree_params;
 	const unsigned int hsize = params->digest_size;
@@ -118,14 +144,22 @@ static bool verify_page(struct inode *inode, const struct fsverity_info *vi,
 		pr_debug_ratelimited("Level %d: hindex=%lu, hoffset=%u\n",
 				     level, hindex, hoffset);
 
-		hpage = inode->i_sb->s_vop->read_merkle_tree_page(inode, hindex,
-				level == 0 ? level0_ra_pages : 0);
-		if (IS_ERR(hpage)) {
-			err = PTR_ERR(hpage);
-			fsverity_err(inode,
-				     "Error %d reading Merkle tree page %lu",
-				     err, hindex);
-			goto out;
+		if (level == 0 && cache && cache->hpage &&
+		    cache->hindex == hindex) {
+			hpage = cache->hpage;
+			get_page(hpage);
+		} else {
+			hpage = inode->i_sb->s_vop->read_merkle_tree_page(inode,
+					hindex, level == 0 ? level0_ra_pages : 0);
+			if (IS_ERR(hpage)) {
+				err = PTR_ERR(hpage);
+				fsverity_err(inode,
+					     "Error %d reading Merkle tree page %lu",
+					     err, hindex);
+				goto out;
+			}
+			if (level == 0 && cache)
+				verify_hash_cache_set(cache, hpage, hindex);
 		}
 
 		if (PageChecked(hpage)) {
@@ -196,7 +230,7 @@ bool fsverity_verify_page(struct page *page)
 	/* This allocation never fails, since it's mempool-backed. */
 	req = fsverity_alloc_hash_request(vi->tree_params.hash_alg, GFP_NOFS);
 
-	valid = verify_page(inode, vi, req, page, 0);
+	valid = verify_page(inode, vi, req, page, 0, NULL);
 
 	fsverity_free_hash_request(vi->tree_params.hash_alg, req);
 
@@ -228,6 +262,7 @@ void fsverity_verify_bio(struct bio *bio)
 	struct ahash_request *req;
 	struct bio_vec *bv;
 	struct bvec_iter_all iter_all;
+	struct verify_hash_cache cache = { .hpage = NULL };
 	unsigned long max_ra_pages = 0;
 
 	/* This allocation never fails, since it's mempool-backed. */
@@ -255,10 +290,13 @@ void fsverity_verify_bio(struct bio *bio)
 			min(max_ra_pages, params->level0_blocks - level0_index);
 
 		if (!PageError(page) &&
-		    !verify_page(inode, vi, req, page, level0_ra_pages))
+		    !verify_page(inode, vi, req, page, level0_ra_pages, &cache))
 			SetPageError(page);
 	}
 
+	if (cache.hpage)
+		put_page(cache.hpage);
+
 	fsverity_free_hash_request(params->hash_alg, req);
 }
 EXPORT_SYMBOL_GPL(fsverity_verify_bio);
@@ -586,6 +586,14 @@ static int zonefs_file_write_dio_end_io(struct kiocb *iocb, ssize_t size,
 			zonefs_update_stats(inode, iocb->ki_pos + size);
 			i_size_write(inode, iocb->ki_pos + size);
 		}
+		/*
+		 * An IO error on another zone append resyncs the write pointer
+		 * offset with the zone, which does not cover the appends still
+		 * in flight.  Keep it from falling behind the inode size as
+		 * these complete.
+		 */
+		if (zi->i_wpoffset < iocb->ki_pos + size)
+			zi->i_wpoffset = iocb->ki_pos + size;
 		mutex_unlock(&zi->i_truncate_mutex);
 	}
 
@@ -596,6 +604,16 @@ static const struct iomap_dio_ops zonefs_write_dio_ops = {
 	.end_io			= zonefs_file_write_dio_end_io,
 };
 
+/*
+ * Synchronous direct write to a sequential zone file, issued as a zone append.
+ * Called with the inode locked, returns with it unlocked.  The space for the
+ * write is reserved by advancing the write pointer offset before the bio is
+ * issued, so the inode lock is dropped while waiting for the completion and
+ * several writers can keep zone append commands queued at the same time.
+ * The device places each append at its own write pointer, so the file
+ * position is set from the sector the device reports on completion: a writer
+ * can learn where its data landed from the file position after the write.
+ */
 static ssize_t zonefs_file_dio_append(struct kiocb *iocb, struct iov_iter *from)
 {
 	struct inode *inode = file_inode(iocb->ki_filp);
@@ -612,12 +630,16 @@ static ssize_t zonefs_file_dio_append(struct kiocb *iocb, struct iov_iter *from)
 	iov_iter_truncate(from, max);
 
 	nr_pages = iov_iter_npages(from, BIO_MAX_PAGES);
-	if (!nr_pages)
+	if (!nr_pages) {
+		inode_unlock(inode);
 		return 0;
+	}
 
 	bio = bio_alloc_bioset(GFP_NOFS, nr_pages, &fs_bio_set);
-	if (!bio)
+	if (!bio) {
+		inode_unlock(inode);
 		return -ENOMEM;
+	}
 
 	bio_set_dev(bio, bdev);
 	bio->bi_iter.bi_sector = zi->i_zsector;
@@ -629,6 +651,7 @@ static ssize_t zonefs_file_dio_append(struct kiocb *iocb, struct iov_iter *from)
 
 	ret = bio_iov_iter_get_pages(bio, from);
 	if (unlikely(ret)) {
+		inode_unlock(inode);
 		bio_io_error(bio);
 		return ret;
 	}
@@ -638,11 +661,29 @@ static ssize_t zonefs_file_dio_append(struct kiocb *iocb, struct iov_iter *from)
 	if (iocb->ki_flags & IOCB_HIPRI)
 		bio_set_polled(bio, iocb);
 
+	mutex_lock(&zi->i_truncate_mutex);
+	zi->i_wpoffset += size;
+	mutex_unlock(&zi->i_truncate_mutex);
+
+	/* Let truncate wait for the append like for any other direct IO */
+	inode_dio_begin(inode);
+	inode_unlock(inode);
+
 	ret = submit_bio_wait(bio);
+	if (!ret)
+		iocb->ki_pos = (bio->bi_iter.bi_sector - zi->i_zsector) <<
+			       SECTOR_SHIFT;
 
 	bio_put(bio);
 
+	/*
+	 * Appends may complete in any order, so an i_size covering a
+	 * completed append does not mean that all the appends below it have
+	 * completed.  A failure resyncs the write pointer offset and the
+	 * inode size with the zone.
+	 */
 	zonefs_file_write_dio_end_io(iocb, size, ret, 0);
+	inode_dio_end(inode);
 	if (ret >= 0) {
 		iocb->ki_pos += size;
 		return size;
@@ -691,6 +732,22 @@ static ssize_t zonefs_file_dio_write(struct kiocb *iocb, struct iov_iter *from)
 	if (ret <= 0)
 		goto inode_unlock;
 
+	/*
+	 * The inode size of a sequential zone file only covers completed
+	 * writes, so O_APPEND writes are appended at the write pointer offset,
+	 * which also covers the writes still in flight.
+	 */
+	if (zi->i_ztype == ZONEFS_ZTYPE_SEQ &&
+	    (iocb->ki_flags & IOCB_APPEND)) {
+		mutex_lock(&zi->i_truncate_mutex);
+		iocb->ki_pos = zi->i_wpoffset;
+		mutex_unlock(&zi->i_truncate_mutex);
+		if (iocb->ki_pos >= zi->i_max_size) {
+			ret = -EFBIG;
+			goto inode_unlock;
+		}
+	}
+
 	iov_iter_truncate(from, zi->i_max_size - iocb->ki_pos);
 	count = iov_iter_count(from);
 
@@ -711,11 +768,12 @@ static ssize_t zonefs_file_dio_write(struct kiocb *iocb, struct iov_iter *from)
 		append = sync;
 	}
 
+	/* Zone appends reserve their space and unlock the inode themselves */
 	if (append)
-		ret = zonefs_file_dio_append(iocb, from);
-	else
-		ret = iomap_dio_rw(iocb, from, &zonefs_iomap_ops,
-				   &zonefs_write_dio_ops, sync);
+		return zonefs_file_dio_append(iocb, from);
+
+	ret = iomap_dio_rw(iocb, from, &zonefs_iomap_ops,
+			   &zonefs_write_dio_ops, sync);
 	if (zi->i_ztype == ZONEFS_ZTYPE_SEQ &&
 	    (ret > 0 || ret == -EIOCBQUEUED)) {
 		if (ret > 0)
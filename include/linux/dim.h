@@ -333,4 +333,35 @@ void net_dim(struct dim *dim, struct dim_sample end_sample);
  */
 void rdma_dim(struct dim *dim, u64 completions);
 
+/* Block DIM */
+
+/*
+ * Block DIM profile:
+ * profile size must be of BLK_DIM_PARAMS_NUM_PROFILES.
+ */
+#define BLK_DIM_PARAMS_NUM_PROFILES 6
+#define BLK_DIM_START_PROFILE 0
+
+/**
+ * blk_dim_get_moderation - Get the moderation values of a block DIM profile.
+ * @ix: Profile index, as left in &dim.profile_ix by blk_dim().
+ *
+ * @usec is the completion coalescing time and @comps the completion count
+ * threshold; profile 0 asks for no moderation.
+ */
+struct dim_cq_moder blk_dim_get_moderation(u8 ix);
+
+/**
+ * blk_dim - Runs the adaptive moderation for a block device queue.
+ * @dim: The moderation struct.
+ * @completions: The number of requests completed by this interrupt.
+ * @bytes: The number of bytes those requests transferred.
+ *
+ * Called from the completion interrupt of a hardware queue.  Once enough
+ * interrupts have been seen a new profile may be chosen, in which case
+ * @dim->work is scheduled to apply blk_dim_get_moderation(@dim->profile_ix)
+ * and must set @dim->state back to DIM_START_MEASURE.
+ */
+void blk_dim(struct dim *dim, u64 completions, u64 bytes);
+
 #endif /* DIM_H */
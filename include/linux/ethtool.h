@@ -15,6 +15,8 @@
 
 #include <linux/bitmap.h>
 #include <linux/compat.h>
+#include <linux/math64.h>
+#include <linux/sched/clock.h>
 #include <uapi/linux/ethtool.h>
 
 #ifdef CONFIG_COMPAT
@@ -241,6 +243,53 @@ bool ethtool_convert_link_mode_to_legacy_u32(u32 *legacy_u32,
 	 ETHTOOL_COALESCE_PKT_RATE_LOW | ETHTOOL_COALESCE_PKT_RATE_HIGH | \
 	 ETHTOOL_COALESCE_RATE_SAMPLE_INTERVAL)
 
+/**
+ * struct ethtool_queue_stats - per queue counters
+ * @packets: packets received or transmitted on the queue
+ * @bytes: bytes received or transmitted on the queue
+ * @drops: packets dropped by the queue
+ */
+struct ethtool_queue_stats {
+	u64	packets;
+	u64	bytes;
+	u64	drops;
+};
+
+#define ETHTOOL_LAT_HIST_BUCKETS	16
+
+/**
+ * struct ethtool_lat_hist - interrupt to NAPI poll latency histogram
+ * @stamp: local_clock() when the interrupt scheduled NAPI, 0 if none
+ * @buckets: bucket n counts polls which started less than 2^n us after
+ *	the interrupt, the last bucket counts all slower ones
+ *
+ * Drivers call ethtool_lat_hist_irq() when their interrupt handler
+ * schedules NAPI and ethtool_lat_hist_poll() at the start of the poll
+ * routine, and report @buckets through the get_napi_lat_hist op.
+ */
+struct ethtool_lat_hist {
+	u64	stamp;
+	u64	buckets[ETHTOOL_LAT_HIST_BUCKETS];
+};
+
+static inline void ethtool_lat_hist_irq(struct ethtool_lat_hist *hist)
+{
+	if (!hist->stamp)
+		hist->stamp = local_clock() | 1;
+}
+
+static inline void ethtool_lat_hist_poll(struct ethtool_lat_hist *hist)
+{
+	u64 stamp = hist->stamp;
+	unsigned int n;
+
+	if (!stamp)
+		return;
+	hist->stamp = 0;
+	n = fls64(div_u64(local_clock() - stamp, NSEC_PER_USEC));
+	hist->buckets[min_t(unsigned int, n, ETHTOOL_LAT_HIST_BUCKETS - 1)]++;
+}
+
 /**
  * struct ethtool_ops - optional netdev operations
  * @supported_coalesce_params: supported types of interrupt coalescing.
@@ -381,6 +430,12 @@ bool ethtool_convert_link_mode_to_legacy_u32(u32 *legacy_u32,
  * @get_ethtool_phy_stats: Return extended statistics about the PHY device.
  *	This is only useful if the device maintains PHY statistics and
  *	cannot use the standard PHY library helpers.
+ * @get_queue_stats: Report packet, byte and drop counters of one RX queue
+ *	(@tx false) or TX queue (@tx true).  Called for each real queue.
+ * @get_napi_lat_hist: Copy the interrupt to NAPI poll latency histogram
+ *	of RX queue @queue, %ETHTOOL_LAT_HIST_BUCKETS entries, see
+ *	&struct ethtool_lat_hist.  Returns a negative error code or zero;
+ *	-EOPNOTSUPP leaves the histogram out for that queue.
  *
  * All operations are optional (i.e. the function pointer may be set
  * to %NULL) and callers must take this into account.  Callers must
@@ -479,6 +534,11 @@ struct ethtool_ops {
 				      struct ethtool_fecparam *);
 	void	(*get_ethtool_phy_stats)(struct net_device *,
 					 struct ethtool_stats *, u64 *);
+	void	(*get_queue_stats)(struct net_device *, bool tx,
+				   unsigned int queue,
+				   struct ethtool_queue_stats *);
+	int	(*get_napi_lat_hist)(struct net_device *, unsigned int queue,
+				     u64 *buckets);
 };
 
 int ethtool_check_ops(const struct ethtool_ops *ops);
@@ -1492,6 +1492,9 @@ struct super_block {
 	/* Pending fsnotify inode refs */
 	atomic_long_t s_fsnotify_inode_refs;
 
+	/* Mark connectors attached to this sb, its mounts and its inodes */
+	atomic_long_t s_fsnotify_connectors;
+
 	/* Being remounted read-only */
 	int s_readonly_remount;
 
@@ -53,6 +53,10 @@ static inline int fsnotify_parent(struct dentry *dentry, __u32 mask,
 {
 	struct inode *inode = d_inode(dentry);
 
+	/* Nobody watches anything on this filesystem, not even the parent */
+	if (!fsnotify_sb_has_watchers(inode->i_sb))
+		return 0;
+
 	if (S_ISDIR(inode->i_mode)) {
 		mask |= FS_ISDIR;
 
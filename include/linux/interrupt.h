@@ -248,6 +248,19 @@ extern void enable_percpu_nmi(unsigned int irq, unsigned int type);
 extern int prepare_percpu_nmi(unsigned int irq);
 extern void teardown_percpu_nmi(unsigned int irq);
 
+#ifdef CONFIG_IRQ_MODERATION
+extern int irq_moderation_enable(unsigned int irq, unsigned int max_rate,
+				 unsigned int poll_us);
+extern void irq_moderation_disable(unsigned int irq);
+#else
+static inline int irq_moderation_enable(unsigned int irq, unsigned int max_rate,
+					unsigned int poll_us)
+{
+	return -EOPNOTSUPP;
+}
+static inline void irq_moderation_disable(unsigned int irq) { }
+#endif
+
 extern int irq_inject_interrupt(unsigned int irq);
 
 /* The following three functions are for the core kernel use only. */
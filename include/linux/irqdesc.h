@@ -15,6 +15,7 @@ struct proc_dir_entry;
 struct module;
 struct irq_desc;
 struct irq_domain;
+struct irq_moderation;
 struct pt_regs;
 
 /**
@@ -50,6 +51,10 @@ struct pt_regs;
  * @request_mutex:	mutex to protect request/free before locking desc->lock
  * @dir:		/proc/irq/ procfs entry
  * @debugfs_file:	dentry for the debugfs file
+ * @moderation:		software interrupt moderation state, if enabled
+ * @balance_last:	tot_count at the last interrupt rebalancing round
+ * @balance_delta:	interrupts charged in the last rebalancing round
+ * @balance_owned:	affinity was last set by the interrupt rebalancer
  * @name:		flow handler name for /proc/interrupts output
  */
 struct irq_desc {
@@ -94,6 +99,14 @@ struct irq_desc {
 	struct dentry		*debugfs_file;
 	const char		*dev_name;
 #endif
+#ifdef CONFIG_IRQ_MODERATION
+	struct irq_moderation	*moderation;
+#endif
+#ifdef CONFIG_IRQ_REBALANCE
+	unsigned int		balance_last;
+	unsigned int		balance_delta;
+	bool			balance_owned;
+#endif
 #ifdef CONFIG_SPARSE_IRQ
 	struct rcu_head		rcu;
 	struct kobject		kobj;
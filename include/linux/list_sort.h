@@ -10,4 +10,9 @@ __attribute__((nonnull(2,3)))
 void list_sort(void *priv, struct list_head *head,
 	       int (*cmp)(void *priv, struct list_head *a,
 			  struct list_head *b));
+
+__attribute__((nonnull(2,3)))
+void list_sort_runs(void *priv, struct list_head *head,
+		    int (*cmp)(void *priv, struct list_head *a,
+			       struct list_head *b));
 #endif
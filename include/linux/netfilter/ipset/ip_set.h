@@ -170,6 +170,8 @@ struct ip_set_type_variant {
 
 	/* When adding entries and set is full, try to resize the set */
 	int (*resize)(struct ip_set *set, bool retried);
+	/* Make room for adding n entries from userspace in one go */
+	int (*reserve)(struct ip_set *set, u32 n);
 	/* Destroy the set */
 	void (*destroy)(struct ip_set *set);
 	/* Flush the elements */
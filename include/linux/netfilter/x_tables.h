@@ -264,6 +264,9 @@ struct xt_table_info {
 	unsigned int stacksize;
 	void ***jumpstack;
 
+	/* Rule index of the protocol, built and freed by it */
+	void *fastpath;
+
 	unsigned char entries[] __aligned(8);
 };
 
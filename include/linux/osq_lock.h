@@ -38,4 +38,19 @@ static inline bool osq_is_locked(struct optimistic_spin_queue *lock)
 	return atomic_read(&lock->tail) != OSQ_UNLOCKED_VAL;
 }
 
+#ifdef CONFIG_OSQ_ADAPTIVE_SPIN
+extern bool osq_spin_worthwhile(struct optimistic_spin_queue *lock);
+extern void osq_spin_result(struct optimistic_spin_queue *lock, bool taken);
+#else
+static inline bool osq_spin_worthwhile(struct optimistic_spin_queue *lock)
+{
+	return true;
+}
+
+static inline void osq_spin_result(struct optimistic_spin_queue *lock,
+				   bool taken)
+{
+}
+#endif
+
 #endif
@@ -17,6 +17,8 @@
 
 #ifdef CONFIG_SMP
 
+struct percpu_counter_node;
+
 struct percpu_counter {
 	raw_spinlock_t lock;
 	s64 count;
@@ -24,6 +26,10 @@ struct percpu_counter {
 	struct list_head list;	/* All percpu_counters are on a list */
 #endif
 	s32 __percpu *counters;
+#ifdef CONFIG_NUMA
+	/* Per node spill level between the CPUs and count, may be NULL */
+	struct percpu_counter_node *nodes;
+#endif
 };
 
 extern int percpu_counter_batch;
@@ -61,6 +61,10 @@ struct pm_qos_constraints {
 struct pm_qos_request {
 	struct plist_node node;
 	struct pm_qos_constraints *qos;
+#ifdef CONFIG_DEBUG_FS
+	unsigned long caller;	/* return address of the add call */
+	unsigned long added;	/* jiffies when the request was added */
+#endif
 };
 
 struct pm_qos_flags_request {
@@ -149,6 +153,8 @@ bool cpu_latency_qos_request_active(struct pm_qos_request *req);
 void cpu_latency_qos_add_request(struct pm_qos_request *req, s32 value);
 void cpu_latency_qos_update_request(struct pm_qos_request *req, s32 new_value);
 void cpu_latency_qos_remove_request(struct pm_qos_request *req);
+int cpu_latency_qos_add_notifier(struct notifier_block *nb);
+int cpu_latency_qos_remove_notifier(struct notifier_block *nb);
 #else
 static inline s32 cpu_latency_qos_limit(void) { return INT_MAX; }
 static inline bool cpu_latency_qos_request_active(struct pm_qos_request *req)
@@ -160,6 +166,14 @@ static inline void cpu_latency_qos_add_request(struct pm_qos_request *req,
 static inline void cpu_latency_qos_update_request(struct pm_qos_request *req,
 						  s32 new_value) {}
 static inline void cpu_latency_qos_remove_request(struct pm_qos_request *req) {}
+static inline int cpu_latency_qos_add_notifier(struct notifier_block *nb)
+{
+	return 0;
+}
+static inline int cpu_latency_qos_remove_notifier(struct notifier_block *nb)
+{
+	return 0;
+}
 #endif
 
 #ifdef CONFIG_PM
@@ -414,6 +414,22 @@ int __sbitmap_queue_get(struct sbitmap_queue *sbq);
 int __sbitmap_queue_get_shallow(struct sbitmap_queue *sbq,
 				unsigned int shallow_depth);
 
+/**
+ * __sbitmap_queue_get_batch() - Try to allocate a batch of free bits from a
+ * single word of a &struct sbitmap_queue with preemption already disabled.
+ * @sbq: Bitmap queue to allocate from.
+ * @nr_tags: Number of bits wanted, less than BITS_PER_LONG.
+ * @offset: Output parameter; bit number of the lowest bit in the mask.
+ *
+ * The bits are grabbed with a single atomic operation on one word, so fewer
+ * than @nr_tags may be returned. Not supported for round-robin queues.
+ *
+ * Return: Mask of the allocated bits relative to @offset, 0 if none could be
+ * allocated.
+ */
+unsigned long __sbitmap_queue_get_batch(struct sbitmap_queue *sbq, int nr_tags,
+					unsigned int *offset);
+
 /**
  * sbitmap_queue_get() - Try to allocate a free bit from a &struct
  * sbitmap_queue.
@@ -487,6 +503,20 @@ void sbitmap_queue_min_shallow_depth(struct sbitmap_queue *sbq,
 void sbitmap_queue_clear(struct sbitmap_queue *sbq, unsigned int nr,
 			 unsigned int cpu);
 
+/**
+ * sbitmap_queue_clear_batch() - Free a batch of allocated bits and wake up
+ * waiters on a &struct sbitmap_queue.
+ * @sbq: Bitmap to free from.
+ * @offset: Value subtracted from each entry of @tags to get its bit number.
+ * @tags: Bits to free, preferably sorted so that bits of one word are adjacent.
+ * @nr_tags: Number of entries in @tags.
+ *
+ * Bits of the same word are released with a single atomic operation, and the
+ * wait queues are credited with all @nr_tags bits at once.
+ */
+void sbitmap_queue_clear_batch(struct sbitmap_queue *sbq, int offset,
+			       int *tags, int nr_tags);
+
 static inline int sbq_index_inc(int index)
 {
 	return (index + 1) & (SBQ_WAIT_QUEUES - 1);
@@ -13,4 +13,7 @@ void sort(void *base, size_t num, size_t size,
 	  cmp_func_t cmp_func,
 	  swap_func_t swap_func);
 
+int sort_by_key(void *base, size_t num, size_t size,
+		u64 (*key_func)(const void *elem), gfp_t gfp);
+
 #endif
@@ -188,6 +188,40 @@ srcu_read_unlock_notrace(struct srcu_struct *ssp, int idx) __releases(ssp)
 	__srcu_read_unlock(ssp, idx);
 }
 
+/**
+ * srcu_read_lock_lite - register a new reader, barrier-free flavor
+ * @ssp: srcu_struct in which to register the new reader.
+ *
+ * Like srcu_read_lock(), but without the full memory barrier on the
+ * read side: once any reader of @ssp has used this flavor, the update
+ * side substitutes synchronize_rcu() for its own barriers instead.
+ * That makes grace periods of @ssp considerably slower, so this is
+ * only a win for read-mostly srcu_structs.  Readers must run where RCU
+ * is watching, so not from the idle loop or from an offline CPU, and
+ * must be paired with srcu_read_unlock_lite().
+ */
+static inline int srcu_read_lock_lite(struct srcu_struct *ssp) __acquires(ssp)
+{
+	int retval;
+
+	retval = __srcu_read_lock_lite(ssp);
+	rcu_lock_acquire(&(ssp)->dep_map);
+	return retval;
+}
+
+/**
+ * srcu_read_unlock_lite - unregister a reader, barrier-free flavor
+ * @ssp: srcu_struct in which to unregister the old reader.
+ * @idx: return value from corresponding srcu_read_lock_lite().
+ */
+static inline void srcu_read_unlock_lite(struct srcu_struct *ssp, int idx)
+	__releases(ssp)
+{
+	WARN_ON_ONCE(idx & ~0x1);
+	rcu_lock_release(&(ssp)->dep_map);
+	__srcu_read_unlock_lite(ssp, idx);
+}
+
 /**
  * smp_mb__after_srcu_read_unlock - ensure full ordering after srcu_read_unlock
  *
@@ -64,6 +64,10 @@ static inline int __srcu_read_lock(struct srcu_struct *ssp)
 	return idx;
 }
 
+/* Tiny SRCU readers never execute memory barriers. */
+#define __srcu_read_lock_lite(ssp)		__srcu_read_lock(ssp)
+#define __srcu_read_unlock_lite(ssp, idx)	__srcu_read_unlock(ssp, idx)
+
 static inline void synchronize_srcu_expedited(struct srcu_struct *ssp)
 {
 	synchronize_srcu(ssp);
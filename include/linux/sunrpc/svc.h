@@ -13,6 +13,8 @@
 
 #include <linux/in.h>
 #include <linux/in6.h>
+#include <linux/llist.h>
+#include <linux/workqueue.h>
 #include <linux/sunrpc/types.h>
 #include <linux/sunrpc/xdr.h>
 #include <linux/sunrpc/auth.h>
@@ -23,7 +25,7 @@
 /* statistics for svc_pool structures */
 struct svc_pool_stats {
 	atomic_long_t	packets;
-	unsigned long	sockets_queued;
+	atomic_long_t	sockets_queued;
 	atomic_long_t	threads_woken;
 	atomic_long_t	threads_timedout;
 };
@@ -41,14 +43,19 @@ struct svc_pool_stats {
 struct svc_pool {
 	unsigned int		sp_id;	    	/* pool id; also node id on NUMA */
 	spinlock_t		sp_lock;	/* protects all fields */
-	struct list_head	sp_sockets;	/* pending sockets */
+	struct llist_head	sp_xprts;	/* newly pending sockets, lockless */
+	struct llist_node *	sp_ready;	/* pending sockets, oldest first */
 	unsigned int		sp_nrthreads;	/* # of threads in pool */
 	struct list_head	sp_all_threads;	/* all server threads */
 	struct svc_pool_stats	sp_stats;	/* statistics on pool operation */
 #define	SP_TASK_PENDING		(0)		/* still work to do even if no
 						 * xprt is queued. */
 #define SP_CONGESTED		(1)
+#define SP_AUTO_BUSY		(2)		/* congested since the last
+						 * autoscale round */
 	unsigned long		sp_flags;
+	unsigned long		sp_congested;	/* jiffies SP_CONGESTED was set */
+	unsigned int		sp_auto_calm;	/* autoscale rounds not congested */
 } ____cacheline_aligned_in_smp;
 
 struct svc_serv;
@@ -68,6 +75,9 @@ struct svc_serv_ops {
 
 	/* optional module to count when adding threads (pooled svcs only) */
 	struct module	*svo_module;
+
+	/* the "service mutex", needed for svc_set_auto_threads() */
+	struct mutex	*svo_mutex;
 };
 
 /*
@@ -102,6 +112,10 @@ struct svc_serv {
 	unsigned int		sv_nrpools;	/* number of thread pools */
 	struct svc_pool *	sv_pools;	/* array of thread pools */
 	const struct svc_serv_ops *sv_ops;	/* server operations */
+
+	unsigned int		sv_auto_min;	/* autoscaled thread range, */
+	unsigned int		sv_auto_max;	/* disabled while max is 0 */
+	struct delayed_work	sv_auto_work;	/* autoscaling rounds */
 #if defined(CONFIG_SUNRPC_BACKCHANNEL)
 	struct list_head	sv_cb_list;	/* queue for callback requests
 						 * that arrive over the same
@@ -506,6 +520,8 @@ struct svc_serv *  svc_create_pooled(struct svc_program *, unsigned int,
 			const struct svc_serv_ops *);
 int		   svc_set_num_threads(struct svc_serv *, struct svc_pool *, int);
 int		   svc_set_num_threads_sync(struct svc_serv *, struct svc_pool *, int);
+int		   svc_set_auto_threads(struct svc_serv *, unsigned int,
+					unsigned int);
 int		   svc_pool_stats_open(struct svc_serv *serv, struct file *file);
 void		   svc_destroy(struct svc_serv *);
 void		   svc_shutdown_net(struct svc_serv *, struct net *);
@@ -49,6 +49,7 @@ struct virtio_vsock_pkt {
 	u32 off;
 	bool reply;
 	bool tap_delivered;
+	bool page_buf;		/* buf is a whole page, not kmalloc()ed */
 };
 
 struct virtio_vsock_pkt_info {
@@ -256,6 +256,62 @@ ZSTD_CCtx *ZSTD_initCCtx(void *workspace, size_t workspaceSize);
 size_t ZSTD_compressCCtx(ZSTD_CCtx *ctx, void *dst, size_t dstCapacity,
 	const void *src, size_t srcSize, ZSTD_parameters params);
 
+/*-*************************************
+ * Parallel API
+ **************************************/
+
+/**
+ * ZSTD_parallelWorkspaceBound() - memory needed for ZSTD_compressParallel()
+ * @cParams:   The compression parameters to be used for compression.
+ * @nbWorkers: The number of workers.
+ *
+ * Return:     A lower bound on the size of the workspace that is passed to
+ *             ZSTD_compressParallel(). It holds the state of the workers as
+ *             well as their compression contexts.
+ */
+size_t ZSTD_parallelWorkspaceBound(ZSTD_compressionParameters cParams,
+	unsigned int nbWorkers);
+
+/**
+ * ZSTD_compressParallelBound() - destination size for ZSTD_compressParallel()
+ * @srcSize:   The size of the data to compress.
+ * @chunkSize: The size of the chunks the data is split into.
+ *
+ * Return:     The dstCapacity ZSTD_compressParallel() requires. It is larger
+ *             than ZSTD_compressBound(srcSize) because every chunk is given
+ *             room to be compressed in place.
+ */
+size_t ZSTD_compressParallelBound(size_t srcSize, size_t chunkSize);
+
+/**
+ * ZSTD_compressParallel() - compress src into dst on several CPUs
+ * @workspace:     The workspace for the compression contexts of the workers.
+ * @workspaceSize: The size of workspace, at least
+ *                 ZSTD_parallelWorkspaceBound(params.cParams, nbWorkers).
+ * @nbWorkers:     The number of workers, the caller counts as one of them.
+ * @dst:           The buffer to compress src into.
+ * @dstCapacity:   The size of the destination buffer, at least
+ *                 ZSTD_compressParallelBound(srcSize, chunkSize).
+ * @src:           The data to compress.
+ * @srcSize:       The size of the data to compress.
+ * @chunkSize:     The size of the independent frames src is split into.
+ * @params:        The parameters to use for compression. See ZSTD_getParams().
+ *
+ * src is compressed as a sequence of independent frames of chunkSize bytes
+ * each, the last one possibly shorter, spread over the workers on the
+ * unbound workqueue. ZSTD_decompressDCtx() decompresses the concatenated
+ * frames in one call. Matches do not cross chunks, so chunks much smaller
+ * than the window cost compression ratio. Must be called from process
+ * context.
+ *
+ * Return:         The compressed size or an error, which can be checked using
+ *                 ZSTD_isError().
+ */
+size_t ZSTD_compressParallel(void *workspace, size_t workspaceSize,
+	unsigned int nbWorkers, void *dst, size_t dstCapacity,
+	const void *src, size_t srcSize, size_t chunkSize,
+	ZSTD_parameters params);
+
 /**
  * ZSTD_DCtxWorkspaceBound() - amount of memory needed to initialize a ZSTD_DCtx
  *
@@ -0,0 +1,87 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM dma_pool
+
+#if !defined(_TRACE_DMA_POOL_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_DMA_POOL_H
+
+#include <linux/device.h>
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(dma_atomic_pool_alloc,
+
+	TP_PROTO(struct device *dev, const char *pool, size_t size,
+		 u64 latency_ns),
+
+	TP_ARGS(dev, pool, size, latency_ns),
+
+	TP_STRUCT__entry(
+		__string(	dev_name,	dev_name(dev)	)
+		__string(	pool,		pool		)
+		__field(	size_t,		size		)
+		__field(	u64,		latency_ns	)
+	),
+
+	TP_fast_assign(
+		__assign_str(dev_name, dev_name(dev));
+		__assign_str(pool, pool);
+		__entry->size = size;
+		__entry->latency_ns = latency_ns;
+	),
+
+	TP_printk("dev_name=%s pool=%s size=%zu latency_ns=%llu",
+		  __get_str(dev_name), __get_str(pool), __entry->size,
+		  __entry->latency_ns)
+);
+
+TRACE_EVENT(dma_atomic_pool_fail,
+
+	TP_PROTO(struct device *dev, size_t size, u64 latency_ns),
+
+	TP_ARGS(dev, size, latency_ns),
+
+	TP_STRUCT__entry(
+		__string(	dev_name,	dev_name(dev)	)
+		__field(	size_t,		size		)
+		__field(	u64,		latency_ns	)
+	),
+
+	TP_fast_assign(
+		__assign_str(dev_name, dev_name(dev));
+		__entry->size = size;
+		__entry->latency_ns = latency_ns;
+	),
+
+	TP_printk("dev_name=%s size=%zu latency_ns=%llu",
+		  __get_str(dev_name), __entry->size, __entry->latency_ns)
+);
+
+TRACE_EVENT(dma_atomic_pool_expand,
+
+	TP_PROTO(const char *pool, size_t added, size_t total, size_t wmark),
+
+	TP_ARGS(pool, added, total, wmark),
+
+	TP_STRUCT__entry(
+		__string(	pool,		pool		)
+		__field(	size_t,		added		)
+		__field(	size_t,		total		)
+		__field(	size_t,		wmark		)
+	),
+
+	TP_fast_assign(
+		__assign_str(pool, pool);
+		__entry->added = added;
+		__entry->total = total;
+		__entry->wmark = wmark;
+	),
+
+	TP_printk("pool=%s added=%zu total=%zu wmark=%zu",
+		  __get_str(pool), __entry->added, __entry->total,
+		  __entry->wmark)
+);
+
+#endif /* _TRACE_DMA_POOL_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
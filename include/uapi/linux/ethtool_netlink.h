@@ -42,6 +42,7 @@ enum {
 	ETHTOOL_MSG_CABLE_TEST_ACT,
 	ETHTOOL_MSG_CABLE_TEST_TDR_ACT,
 	ETHTOOL_MSG_TUNNEL_INFO_GET,
+	ETHTOOL_MSG_QSTATS_GET,
 
 	/* add new constants above here */
 	__ETHTOOL_MSG_USER_CNT,
@@ -79,6 +80,7 @@ enum {
 	ETHTOOL_MSG_TSINFO_GET_REPLY,
 	ETHTOOL_MSG_CABLE_TEST_NTF,
 	ETHTOOL_MSG_CABLE_TEST_TDR_NTF,
+	ETHTOOL_MSG_QSTATS_GET_REPLY,
 
 	/* add new constants above here */
 	__ETHTOOL_MSG_KERNEL_CNT,
@@ -611,6 +613,48 @@ enum {
 	ETHTOOL_A_TUNNEL_INFO_MAX = (__ETHTOOL_A_TUNNEL_INFO_CNT - 1)
 };
 
+/* QUEUE STATS */
+
+enum {
+	ETHTOOL_QSTATS_QUEUE_RX,
+	ETHTOOL_QSTATS_QUEUE_TX,
+};
+
+enum {
+	ETHTOOL_A_QSTATS_HIST_UNSPEC,
+	ETHTOOL_A_QSTATS_HIST_PAD,
+	ETHTOOL_A_QSTATS_HIST_BUCKET,			/* u64 (multi) */
+
+	/* add new constants above here */
+	__ETHTOOL_A_QSTATS_HIST_CNT,
+	ETHTOOL_A_QSTATS_HIST_MAX = (__ETHTOOL_A_QSTATS_HIST_CNT - 1)
+};
+
+enum {
+	ETHTOOL_A_QSTATS_QUEUE_UNSPEC,
+	ETHTOOL_A_QSTATS_QUEUE_PAD,
+	ETHTOOL_A_QSTATS_QUEUE_TYPE,			/* u8 */
+	ETHTOOL_A_QSTATS_QUEUE_INDEX,			/* u32 */
+	ETHTOOL_A_QSTATS_QUEUE_PACKETS,			/* u64 */
+	ETHTOOL_A_QSTATS_QUEUE_BYTES,			/* u64 */
+	ETHTOOL_A_QSTATS_QUEUE_DROPS,			/* u64 */
+	ETHTOOL_A_QSTATS_QUEUE_NAPI_LAT,		/* nest - _A_QSTATS_HIST_* */
+
+	/* add new constants above here */
+	__ETHTOOL_A_QSTATS_QUEUE_CNT,
+	ETHTOOL_A_QSTATS_QUEUE_MAX = (__ETHTOOL_A_QSTATS_QUEUE_CNT - 1)
+};
+
+enum {
+	ETHTOOL_A_QSTATS_UNSPEC,
+	ETHTOOL_A_QSTATS_HEADER,			/* nest - _A_HEADER_* */
+	ETHTOOL_A_QSTATS_QUEUE,				/* nest - _A_QSTATS_QUEUE_* */
+
+	/* add new constants above here */
+	__ETHTOOL_A_QSTATS_CNT,
+	ETHTOOL_A_QSTATS_MAX = (__ETHTOOL_A_QSTATS_CNT - 1)
+};
+
 /* generic netlink info */
 #define ETHTOOL_GENL_NAME "ethtool"
 #define ETHTOOL_GENL_VERSION 1
@@ -304,4 +304,38 @@ typedef int __bitwise __kernel_rwf_t;
 #define RWF_SUPPORTED	(RWF_HIPRI | RWF_DSYNC | RWF_SYNC | RWF_NOWAIT |\
 			 RWF_APPEND)
 
+/*
+ * /proc/<pid>/smaps_rollup ioctl: the rollup totals in binary, split by
+ * the kind of mapping.  All sizes are in bytes.
+ */
+#define SMAPS_ROLLUP_ANON	0	/* anonymous, including stack and heap */
+#define SMAPS_ROLLUP_FILE	1	/* file backed, other than shmem */
+#define SMAPS_ROLLUP_SHMEM	2	/* shmem, tmpfs and SysV shm */
+#define SMAPS_ROLLUP_NR_CLASSES	3
+
+struct smaps_rollup_stats {
+	__u64 vmas;		/* number of mappings of this kind */
+	__u64 size;		/* total virtual size */
+	__u64 rss;
+	__u64 pss;
+	__u64 shared_clean;
+	__u64 shared_dirty;
+	__u64 private_clean;
+	__u64 private_dirty;
+	__u64 referenced;
+	__u64 anonymous;
+	__u64 lazyfree;
+	__u64 swap;
+	__u64 swap_pss;
+	__u64 locked;		/* pss of mlocked mappings */
+};
+
+struct smaps_rollup_query {
+	__u64 size;		/* in: sizeof(struct smaps_rollup_query) */
+	__u64 reserved;		/* in: must be 0 */
+	struct smaps_rollup_stats stats[SMAPS_ROLLUP_NR_CLASSES];
+};
+
+#define SMAPS_ROLLUP_QUERY	_IOWR('f', 32, struct smaps_rollup_query)
+
 #endif /* _UAPI_LINUX_FS_H */
@@ -870,6 +870,39 @@ struct fuse_notify_retrieve_in {
 
 /* Device ioctls: */
 #define FUSE_DEV_IOC_CLONE	_IOR(229, 0, uint32_t)
+#define FUSE_DEV_IOC_RING_SETUP	_IOWR(229, 1, struct fuse_ring_setup)
+#define FUSE_DEV_IOC_RING_ENTER	_IO(229, 2)
+#define FUSE_DEV_IOC_BIND_CPU	_IOW(229, 3, uint32_t)
+
+/*
+ * Shared request ring, mapped by mmap() of the device at offset 0.
+ *
+ * FUSE_DEV_IOC_RING_SETUP creates @entries slots of @entry_size bytes.
+ * FUSE_DEV_IOC_RING_ENTER first takes back the slots the daemon queued on
+ * the completion ring, each holding a reply starting with a
+ * fuse_out_header (len == 0 for requests without a reply), then reads as
+ * many pending requests as there are free slots and queues their slot
+ * numbers on the request ring.  It returns the number of requests queued
+ * and, with FUSE_RING_ENTER_WAIT, waits for one if none is pending.
+ */
+#define FUSE_RING_ENTER_WAIT	(1 << 0)
+
+struct fuse_ring_setup {
+	uint32_t	entries;
+	uint32_t	entry_size;
+	uint32_t	req_off;
+	uint32_t	cmp_off;
+	uint32_t	slots_off;
+	uint32_t	slot_stride;
+	uint64_t	size;
+};
+
+struct fuse_ring_hdr {
+	uint32_t	req_head;
+	uint32_t	req_tail;
+	uint32_t	cmp_head;
+	uint32_t	cmp_tail;
+};
 
 struct fuse_lseek_in {
 	uint64_t	fh;
@@ -25,6 +25,11 @@
  * application.
  */
 #define XDP_USE_NEED_WAKEUP (1 << 3)
+/* Copy mode only: packets larger than a chunk are split over several
+ * descriptors, all but the last one carrying XDP_PKT_CONTD in their
+ * options, on both the Rx and the Tx ring.
+ */
+#define XDP_USE_SG	(1 << 4)
 
 /* Flags for xsk_umem_config flags */
 #define XDP_UMEM_UNALIGNED_CHUNK_FLAG (1 << 0)
@@ -106,6 +111,9 @@ struct xdp_desc {
 	__u32 options;
 };
 
+/* Flags for the options field of struct xdp_desc */
+#define XDP_PKT_CONTD	(1 << 0) /* Packet continues in the next descriptor */
+
 /* UMEM descriptor is __u64 */
 
 #endif /* _LINUX_IF_XDP_H */
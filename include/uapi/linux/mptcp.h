@@ -28,6 +28,8 @@ enum {
 	MPTCP_SUBFLOW_ATTR_ID_REM,
 	MPTCP_SUBFLOW_ATTR_ID_LOC,
 	MPTCP_SUBFLOW_ATTR_PAD,
+	MPTCP_SUBFLOW_ATTR_BYTES_SENT,
+	MPTCP_SUBFLOW_ATTR_BYTES_RETRANS,
 	__MPTCP_SUBFLOW_ATTR_MAX
 };
 
@@ -225,6 +225,9 @@ struct rds_info_tcp_socket {
 	__u32           last_expected_una;
 	__u32           last_seen_una;
 	__u8		tos;
+	__u64		xmit_batches;
+	__u64		xmit_batch_msgs;
+	__u64		xmit_copied_msgs;
 } __attribute__((packed));
 
 struct rds6_info_tcp_socket {
@@ -237,6 +240,9 @@ struct rds6_info_tcp_socket {
 	__u32		last_sent_nxt;
 	__u32		last_expected_una;
 	__u32		last_seen_una;
+	__u64		xmit_batches;
+	__u64		xmit_batch_msgs;
+	__u64		xmit_copied_msgs;
 } __attribute__((packed));
 
 #define RDS_IB_GID_LEN	16
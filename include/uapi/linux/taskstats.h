@@ -179,6 +179,9 @@ struct taskstats {
  * Commands sent from userspace
  * Not versioned. New commands should only be inserted at the enum's end
  * prior to __TASKSTATS_CMD_MAX
+ *
+ * TASKSTATS_CMD_GET with NLM_F_DUMP returns one TASKSTATS_TYPE_AGGR_PID
+ * record for every task in the caller's pid namespace, in pid order.
  */
 
 enum {
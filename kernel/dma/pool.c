@@ -8,10 +8,14 @@
 #include <linux/dma-noncoherent.h>
 #include <linux/init.h>
 #include <linux/genalloc.h>
+#include <linux/sched/clock.h>
 #include <linux/set_memory.h>
 #include <linux/slab.h>
 #include <linux/workqueue.h>
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/dma_pool.h>
+
 static struct gen_pool *atomic_pool_dma __ro_after_init;
 static unsigned long pool_size_dma;
 static struct gen_pool *atomic_pool_dma32 __ro_after_init;
@@ -19,6 +23,17 @@ static unsigned long pool_size_dma32;
 static struct gen_pool *atomic_pool_kernel __ro_after_init;
 static unsigned long pool_size_kernel;
 
+/*
+ * Free space the background expansion keeps in each pool.  Starts at
+ * atomic_pool_size and doubles, up to 1 << POOL_WMARK_MAX_SHIFT times
+ * that, whenever an allocation finds the pool exhausted, so that the
+ * reserve follows the largest bursts seen.
+ */
+#define POOL_WMARK_MAX_SHIFT	4
+static unsigned long pool_wmark_dma;
+static unsigned long pool_wmark_dma32;
+static unsigned long pool_wmark_kernel;
+
 /* Size can be defined by the coherent_pool command line */
 static size_t atomic_pool_size;
 
@@ -43,6 +58,43 @@ static void __init dma_atomic_pool_debugfs_init(void)
 	debugfs_create_ulong("pool_size_dma", 0400, root, &pool_size_dma);
 	debugfs_create_ulong("pool_size_dma32", 0400, root, &pool_size_dma32);
 	debugfs_create_ulong("pool_size_kernel", 0400, root, &pool_size_kernel);
+	debugfs_create_ulong("pool_wmark_dma", 0400, root, &pool_wmark_dma);
+	debugfs_create_ulong("pool_wmark_dma32", 0400, root, &pool_wmark_dma32);
+	debugfs_create_ulong("pool_wmark_kernel", 0400, root, &pool_wmark_kernel);
+}
+
+static unsigned long *dma_atomic_pool_wmark(struct gen_pool *pool)
+{
+	if (pool == atomic_pool_dma)
+		return &pool_wmark_dma;
+	if (pool == atomic_pool_dma32)
+		return &pool_wmark_dma32;
+	return &pool_wmark_kernel;
+}
+
+static const char *dma_atomic_pool_name(struct gen_pool *pool)
+{
+	if (pool == atomic_pool_dma)
+		return "dma";
+	if (pool == atomic_pool_dma32)
+		return "dma32";
+	return "kernel";
+}
+
+static bool dma_atomic_pool_low(struct gen_pool *pool)
+{
+	return gen_pool_avail(pool) < READ_ONCE(*dma_atomic_pool_wmark(pool));
+}
+
+/* The pool ran dry: reserve more for the next burst and refill it */
+static void dma_atomic_pool_exhausted(struct gen_pool *pool)
+{
+	unsigned long *wmark = dma_atomic_pool_wmark(pool);
+	unsigned long max = (unsigned long)atomic_pool_size << POOL_WMARK_MAX_SHIFT;
+
+	/* Once per refill, not for every allocation of the same burst */
+	if (schedule_work(&atomic_pool_work))
+		WRITE_ONCE(*wmark, min(READ_ONCE(*wmark) * 2, max));
 }
 
 static void dma_atomic_pool_size_add(gfp_t gfp, size_t size)
@@ -119,8 +171,20 @@ free_page: __maybe_unused
 
 static void atomic_pool_resize(struct gen_pool *pool, gfp_t gfp)
 {
-	if (pool && gen_pool_avail(pool) < atomic_pool_size)
-		atomic_pool_expand(pool, gen_pool_size(pool), gfp);
+	size_t size;
+
+	if (!pool)
+		return;
+
+	while (dma_atomic_pool_low(pool)) {
+		size = gen_pool_size(pool);
+		if (atomic_pool_expand(pool, size, gfp))
+			break;
+		trace_dma_atomic_pool_expand(dma_atomic_pool_name(pool),
+					     gen_pool_size(pool) - size,
+					     gen_pool_size(pool),
+					     READ_ONCE(*dma_atomic_pool_wmark(pool)));
+	}
 }
 
 static void atomic_pool_work_fn(struct work_struct *work)
@@ -173,6 +237,7 @@ static int __init dma_atomic_pool_init(void)
 		atomic_pool_size = max_t(size_t, pages << PAGE_SHIFT, SZ_128K);
 	}
 	INIT_WORK(&atomic_pool_work, atomic_pool_work_fn);
+	pool_wmark_dma = pool_wmark_dma32 = pool_wmark_kernel = atomic_pool_size;
 
 	atomic_pool_kernel = __dma_atomic_pool_init(atomic_pool_size,
 						    GFP_KERNEL);
@@ -237,6 +302,11 @@ void *dma_alloc_from_pool(struct device *dev, size_t size,
 	unsigned long val = 0;
 	void *ptr = NULL;
 	phys_addr_t phys;
+	u64 start = 0;
+
+	if (trace_dma_atomic_pool_alloc_enabled() ||
+	    trace_dma_atomic_pool_fail_enabled())
+		start = local_clock();
 
 	while (1) {
 		pool = dma_guess_pool(dev, pool);
@@ -247,8 +317,10 @@ void *dma_alloc_from_pool(struct device *dev, size_t size,
 		}
 
 		val = gen_pool_alloc(pool, size);
-		if (!val)
+		if (!val) {
+			dma_atomic_pool_exhausted(pool);
 			continue;
+		}
 
 		phys = gen_pool_virt_to_phys(pool, val);
 		if (dma_coherent_ok(dev, phys, size))
@@ -264,8 +336,14 @@ void *dma_alloc_from_pool(struct device *dev, size_t size,
 		ptr = (void *)val;
 		memset(ptr, 0, size);
 
-		if (gen_pool_avail(pool) < atomic_pool_size)
+		if (dma_atomic_pool_low(pool))
 			schedule_work(&atomic_pool_work);
+
+		trace_dma_atomic_pool_alloc(dev, dma_atomic_pool_name(pool),
+					    size, start ? local_clock() - start : 0);
+	} else {
+		trace_dma_atomic_pool_fail(dev, size,
+					   start ? local_clock() - start : 0);
 	}
 
 	return ptr;
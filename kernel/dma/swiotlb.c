@@ -34,10 +34,12 @@
 #include <linux/highmem.h>
 #include <linux/gfp.h>
 #include <linux/scatterlist.h>
+#include <linux/percpu.h>
 #include <linux/mem_encrypt.h>
 #include <linux/set_memory.h>
 #ifdef CONFIG_DEBUG_FS
 #include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #endif
 
 #include <asm/io.h>
@@ -107,6 +109,42 @@ static phys_addr_t *io_tlb_orig_addr;
  */
 static DEFINE_SPINLOCK(io_tlb_lock);
 
+/*
+ * Recently unmapped buffers of up to a page are kept allocated in a small
+ * per-CPU cache and handed out again to the next mapping of the same size,
+ * without taking io_tlb_lock or searching the free list.  Cached slots
+ * still count as used; a mapping which finds no free slots drains the
+ * cache of the local CPU and searches again.
+ */
+#define IO_TLB_CACHE_SIZE	8
+#define IO_TLB_CACHE_MAX_SLOTS	SLABS_PER_PAGE
+#define IO_TLB_CACHE_MISS	UINT_MAX
+
+struct io_tlb_cache {
+	unsigned int nr;
+	unsigned int index[IO_TLB_CACHE_SIZE];
+	unsigned int nslots[IO_TLB_CACHE_SIZE];
+};
+static DEFINE_PER_CPU(struct io_tlb_cache, io_tlb_cache);
+
+struct io_tlb_stats {
+	unsigned long maps;
+	unsigned long cache_hits;
+	unsigned long bounce_bytes;
+	unsigned long contended;
+};
+static DEFINE_PER_CPU(struct io_tlb_stats, io_tlb_stats);
+
+/* spin_lock_irqsave() on io_tlb_lock, counting contended acquisitions */
+#define io_tlb_lock_irqsave(flags)					\
+	do {								\
+		local_irq_save(flags);					\
+		if (!spin_trylock(&io_tlb_lock)) {			\
+			this_cpu_inc(io_tlb_stats.contended);		\
+			spin_lock(&io_tlb_lock);			\
+		}							\
+	} while (0)
+
 static int late_alloc;
 
 static int __init
@@ -320,6 +358,11 @@ swiotlb_late_init_with_default_size(size_t default_size)
 
 static void swiotlb_cleanup(void)
 {
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		per_cpu_ptr(&io_tlb_cache, cpu)->nr = 0;
+
 	io_tlb_end = 0;
 	io_tlb_start = 0;
 	io_tlb_nslabs = 0;
@@ -412,6 +455,8 @@ static void swiotlb_bounce(phys_addr_t orig_addr, phys_addr_t tlb_addr,
 	unsigned long pfn = PFN_DOWN(orig_addr);
 	unsigned char *vaddr = phys_to_virt(tlb_addr);
 
+	this_cpu_add(io_tlb_stats.bounce_bytes, size);
+
 	if (PageHighMem(pfn_to_page(pfn))) {
 		/* The buffer does not have a mapping.  Map it in and copy */
 		unsigned int offset = orig_addr & ~PAGE_MASK;
@@ -443,6 +488,112 @@ static void swiotlb_bounce(phys_addr_t orig_addr, phys_addr_t tlb_addr,
 	}
 }
 
+/*
+ * Return the slots [index, index + nslots) to the free list, merging them
+ * with the free slots above and below.  Called with io_tlb_lock held.
+ */
+static void swiotlb_release_slots(int index, int nslots)
+{
+	int i, count;
+
+	count = ((index + nslots) < ALIGN(index + 1, IO_TLB_SEGSIZE) ?
+		 io_tlb_list[index + nslots] : 0);
+	/*
+	 * Step 1: return the slots to the free list, merging the
+	 * slots with superceeding slots
+	 */
+	for (i = index + nslots - 1; i >= index; i--) {
+		io_tlb_list[i] = ++count;
+		io_tlb_orig_addr[i] = INVALID_PHYS_ADDR;
+	}
+	/*
+	 * Step 2: merge the returned slots with the preceding slots,
+	 * if available (non zero)
+	 */
+	for (i = index - 1; (OFFSET(i, IO_TLB_SEGSIZE) != IO_TLB_SEGSIZE -1) && io_tlb_list[i]; i--)
+		io_tlb_list[i] = ++count;
+
+	io_tlb_used -= nslots;
+}
+
+/*
+ * Take a cached buffer of @nslots slots which satisfies the alignment and
+ * boundary constraints of the mapping, or return IO_TLB_CACHE_MISS.
+ */
+static unsigned int swiotlb_cache_get(unsigned int nslots, unsigned int stride,
+				      unsigned long offset_slots,
+				      unsigned long max_slots)
+{
+	struct io_tlb_cache *cache;
+	unsigned int i, index = IO_TLB_CACHE_MISS;
+	unsigned long flags;
+
+	if (nslots > IO_TLB_CACHE_MAX_SLOTS)
+		return IO_TLB_CACHE_MISS;
+
+	local_irq_save(flags);
+	cache = this_cpu_ptr(&io_tlb_cache);
+	/* Most recently freed first, its slots are likely still cache hot */
+	for (i = cache->nr; i-- > 0; ) {
+		if (cache->nslots[i] != nslots ||
+		    (cache->index[i] & (stride - 1)) ||
+		    iommu_is_span_boundary(cache->index[i], nslots,
+					   offset_slots, max_slots))
+			continue;
+
+		index = cache->index[i];
+		cache->nr--;
+		cache->index[i] = cache->index[cache->nr];
+		cache->nslots[i] = cache->nslots[cache->nr];
+		__this_cpu_inc(io_tlb_stats.cache_hits);
+		break;
+	}
+	local_irq_restore(flags);
+
+	return index;
+}
+
+static bool swiotlb_cache_put(unsigned int index, unsigned int nslots)
+{
+	struct io_tlb_cache *cache;
+	unsigned long flags;
+	bool ret = false;
+
+	if (nslots > IO_TLB_CACHE_MAX_SLOTS)
+		return false;
+
+	local_irq_save(flags);
+	cache = this_cpu_ptr(&io_tlb_cache);
+	if (cache->nr < IO_TLB_CACHE_SIZE) {
+		cache->index[cache->nr] = index;
+		cache->nslots[cache->nr] = nslots;
+		cache->nr++;
+		ret = true;
+	}
+	local_irq_restore(flags);
+
+	return ret;
+}
+
+/*
+ * Release the buffers cached on this CPU.  Called with io_tlb_lock held
+ * and interrupts disabled.
+ */
+static bool swiotlb_cache_drain(void)
+{
+	struct io_tlb_cache *cache = this_cpu_ptr(&io_tlb_cache);
+
+	if (!cache->nr)
+		return false;
+
+	while (cache->nr) {
+		cache->nr--;
+		swiotlb_release_slots(cache->index[cache->nr],
+				      cache->nslots[cache->nr]);
+	}
+	return true;
+}
+
 phys_addr_t swiotlb_tbl_map_single(struct device *hwdev,
 				   dma_addr_t tbl_dma_addr,
 				   phys_addr_t orig_addr,
@@ -497,12 +648,21 @@ phys_addr_t swiotlb_tbl_map_single(struct device *hwdev,
 
 	BUG_ON(!nslots);
 
+	this_cpu_inc(io_tlb_stats.maps);
+
+	index = swiotlb_cache_get(nslots, stride, offset_slots, max_slots);
+	if (index != IO_TLB_CACHE_MISS) {
+		tlb_addr = io_tlb_start + (index << IO_TLB_SHIFT);
+		goto mapped;
+	}
+
 	/*
 	 * Find suitable number of IO TLB entries size that will fit this
 	 * request and allocate a buffer from that IO TLB pool.
 	 */
-	spin_lock_irqsave(&io_tlb_lock, flags);
+	io_tlb_lock_irqsave(flags);
 
+retry:
 	if (unlikely(nslots > io_tlb_nslabs - io_tlb_used))
 		goto not_found;
 
@@ -550,6 +710,8 @@ phys_addr_t swiotlb_tbl_map_single(struct device *hwdev,
 	} while (index != wrap);
 
 not_found:
+	if (swiotlb_cache_drain())
+		goto retry;
 	tmp_io_tlb_used = io_tlb_used;
 
 	spin_unlock_irqrestore(&io_tlb_lock, flags);
@@ -561,6 +723,7 @@ phys_addr_t swiotlb_tbl_map_single(struct device *hwdev,
 	io_tlb_used += nslots;
 	spin_unlock_irqrestore(&io_tlb_lock, flags);
 
+mapped:
 	/*
 	 * Save away the mapping from the original address to the DMA address.
 	 * This is needed when we sync the memory.  Then we sync the buffer if
@@ -583,7 +746,7 @@ void swiotlb_tbl_unmap_single(struct device *hwdev, phys_addr_t tlb_addr,
 			      enum dma_data_direction dir, unsigned long attrs)
 {
 	unsigned long flags;
-	int i, count, nslots = ALIGN(alloc_size, 1 << IO_TLB_SHIFT) >> IO_TLB_SHIFT;
+	int i, nslots = ALIGN(alloc_size, 1 << IO_TLB_SHIFT) >> IO_TLB_SHIFT;
 	int index = (tlb_addr - io_tlb_start) >> IO_TLB_SHIFT;
 	phys_addr_t orig_addr = io_tlb_orig_addr[index];
 
@@ -595,33 +758,23 @@ void swiotlb_tbl_unmap_single(struct device *hwdev, phys_addr_t tlb_addr,
 	    ((dir == DMA_FROM_DEVICE) || (dir == DMA_BIDIRECTIONAL)))
 		swiotlb_bounce(orig_addr, tlb_addr, mapping_size, DMA_FROM_DEVICE);
 
+	/*
+	 * Keep small buffers around for the next mapping of the same size.
+	 * They may be handed out again as soon as they are in the cache.
+	 */
+	for (i = index; i < index + nslots; i++)
+		io_tlb_orig_addr[i] = INVALID_PHYS_ADDR;
+	if (swiotlb_cache_put(index, nslots))
+		return;
+
 	/*
 	 * Return the buffer to the free list by setting the corresponding
 	 * entries to indicate the number of contiguous entries available.
 	 * While returning the entries to the free list, we merge the entries
 	 * with slots below and above the pool being returned.
 	 */
-	spin_lock_irqsave(&io_tlb_lock, flags);
-	{
-		count = ((index + nslots) < ALIGN(index + 1, IO_TLB_SEGSIZE) ?
-			 io_tlb_list[index + nslots] : 0);
-		/*
-		 * Step 1: return the slots to the free list, merging the
-		 * slots with superceeding slots
-		 */
-		for (i = index + nslots - 1; i >= index; i--) {
-			io_tlb_list[i] = ++count;
-			io_tlb_orig_addr[i] = INVALID_PHYS_ADDR;
-		}
-		/*
-		 * Step 2: merge the returned slots with the preceding slots,
-		 * if available (non zero)
-		 */
-		for (i = index - 1; (OFFSET(i, IO_TLB_SEGSIZE) != IO_TLB_SEGSIZE -1) && io_tlb_list[i]; i--)
-			io_tlb_list[i] = ++count;
-
-		io_tlb_used -= nslots;
-	}
+	io_tlb_lock_irqsave(flags);
+	swiotlb_release_slots(index, nslots);
 	spin_unlock_irqrestore(&io_tlb_lock, flags);
 }
 
@@ -707,6 +860,34 @@ bool is_swiotlb_active(void)
 
 #ifdef CONFIG_DEBUG_FS
 
+static int swiotlb_stats_show(struct seq_file *m, void *v)
+{
+	struct io_tlb_stats sum = { };
+	unsigned long cached = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct io_tlb_stats *stats = per_cpu_ptr(&io_tlb_stats, cpu);
+		struct io_tlb_cache *cache = per_cpu_ptr(&io_tlb_cache, cpu);
+		unsigned int i, nr = READ_ONCE(cache->nr);
+
+		sum.maps += stats->maps;
+		sum.cache_hits += stats->cache_hits;
+		sum.bounce_bytes += stats->bounce_bytes;
+		sum.contended += stats->contended;
+		for (i = 0; i < min_t(unsigned int, nr, IO_TLB_CACHE_SIZE); i++)
+			cached += READ_ONCE(cache->nslots[i]);
+	}
+
+	seq_printf(m, "maps:          %lu\n", sum.maps);
+	seq_printf(m, "cache_hits:    %lu\n", sum.cache_hits);
+	seq_printf(m, "cached_slots:  %lu\n", cached);
+	seq_printf(m, "bounce_bytes:  %lu\n", sum.bounce_bytes);
+	seq_printf(m, "lock_contended: %lu\n", sum.contended);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(swiotlb_stats);
+
 static int __init swiotlb_create_debugfs(void)
 {
 	struct dentry *root;
@@ -714,6 +895,7 @@ static int __init swiotlb_create_debugfs(void)
 	root = debugfs_create_dir("swiotlb", NULL);
 	debugfs_create_ulong("io_tlb_nslabs", 0400, root, &io_tlb_nslabs);
 	debugfs_create_ulong("io_tlb_used", 0400, root, &io_tlb_used);
+	debugfs_create_file("stats", 0400, root, NULL, &swiotlb_stats_fops);
 	return 0;
 }
 
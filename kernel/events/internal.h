@@ -15,9 +15,9 @@ struct perf_buffer {
 	struct rcu_head			rcu_head;
 #ifdef CONFIG_PERF_USE_VMALLOC
 	struct work_struct		work;
-	int				page_order;	/* allocation order  */
 #endif
-	int				nr_pages;	/* nr of data pages  */
+	int				page_order;	/* allocation order  */
+	int				nr_pages;	/* nr of data chunks */
 	int				overwrite;	/* can overwrite itself */
 	int				paused;		/* can write into ring buffer */
 
@@ -96,25 +96,21 @@ void perf_event_aux_event(struct perf_event *event, unsigned long head,
 extern struct page *
 perf_mmap_to_page(struct perf_buffer *rb, unsigned long pgoff);
 
-#ifdef CONFIG_PERF_USE_VMALLOC
 /*
- * Back perf_mmap() with vmalloc memory.
- *
- * Required for architectures that have d-cache aliasing issues.
+ * The data area is @nr_pages chunks of 1 << @page_order pages each: one
+ * vmalloc area with CONFIG_PERF_USE_VMALLOC, physically contiguous high
+ * order allocations when they can be had otherwise.
  */
-
 static inline int page_order(struct perf_buffer *rb)
 {
 	return rb->page_order;
 }
 
-#else
-
-static inline int page_order(struct perf_buffer *rb)
+/* Number of PAGE_SIZE pages in the data area */
+static inline int data_page_nr(struct perf_buffer *rb)
 {
-	return 0;
+	return rb->nr_pages << page_order(rb);
 }
-#endif
 
 static inline unsigned long perf_data_size(struct perf_buffer *rb)
 {
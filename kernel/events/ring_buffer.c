@@ -762,47 +762,89 @@ void rb_free_aux(struct perf_buffer *rb)
 #ifndef CONFIG_PERF_USE_VMALLOC
 
 /*
- * Back perf_mmap() with regular GFP_KERNEL-0 pages.
+ * Back perf_mmap() with regular GFP_KERNEL pages.
+ *
+ * The data area is allocated in the largest equally sized physically
+ * contiguous chunks available, so the output code crosses fewer chunk
+ * boundaries and a record rarely straddles two of them.  Chunks are
+ * split so that every page can be mapped to user space on its own.
  */
 
 static struct page *
 __perf_mmap_to_page(struct perf_buffer *rb, unsigned long pgoff)
 {
-	if (pgoff > rb->nr_pages)
+	unsigned long mask = (1UL << page_order(rb)) - 1;
+
+	/* The '>' counts in the user page. */
+	if (pgoff > data_page_nr(rb))
 		return NULL;
 
 	if (pgoff == 0)
 		return virt_to_page(rb->user_page);
 
-	return virt_to_page(rb->data_pages[pgoff - 1]);
+	pgoff--;
+	return virt_to_page(rb->data_pages[pgoff >> page_order(rb)]) +
+	       (pgoff & mask);
 }
 
-static void *perf_mmap_alloc_page(int cpu)
+static void *perf_mmap_alloc_page(int cpu, int order)
 {
+	gfp_t gfp = GFP_KERNEL | __GFP_ZERO;
 	struct page *page;
 	int node;
 
+	if (order)
+		gfp |= __GFP_NOWARN | __GFP_NORETRY;
+
 	node = (cpu == -1) ? cpu : cpu_to_node(cpu);
-	page = alloc_pages_node(node, GFP_KERNEL | __GFP_ZERO, 0);
+	page = alloc_pages_node(node, gfp, order);
 	if (!page)
 		return NULL;
 
+	if (order)
+		split_page(page, order);
+
 	return page_address(page);
 }
 
-static void perf_mmap_free_page(void *addr)
+static void perf_mmap_free_page(void *addr, int order)
 {
 	struct page *page = virt_to_page(addr);
+	int i;
 
-	page->mapping = NULL;
-	__free_page(page);
+	for (i = 0; i < (1 << order); i++, page++) {
+		page->mapping = NULL;
+		__free_page(page);
+	}
+}
+
+/* Allocate @nr_pages of data in chunks of @order, false on failure */
+static bool rb_alloc_data_pages(struct perf_buffer *rb, int nr_pages,
+				int cpu, int order)
+{
+	int i, nr = nr_pages >> order;
+
+	for (i = 0; i < nr; i++) {
+		rb->data_pages[i] = perf_mmap_alloc_page(cpu, order);
+		if (!rb->data_pages[i])
+			goto fail;
+	}
+
+	rb->nr_pages = nr;
+	rb->page_order = order;
+	return true;
+
+fail:
+	for (i--; i >= 0; i--)
+		perf_mmap_free_page(rb->data_pages[i], order);
+	return false;
 }
 
 struct perf_buffer *rb_alloc(int nr_pages, long watermark, int cpu, int flags)
 {
 	struct perf_buffer *rb;
 	unsigned long size;
-	int i;
+	int order;
 
 	size = sizeof(struct perf_buffer);
 	size += nr_pages * sizeof(void *);
@@ -814,27 +856,23 @@ struct perf_buffer *rb_alloc(int nr_pages, long watermark, int cpu, int flags)
 	if (!rb)
 		goto fail;
 
-	rb->user_page = perf_mmap_alloc_page(cpu);
+	rb->user_page = perf_mmap_alloc_page(cpu, 0);
 	if (!rb->user_page)
 		goto fail_user_page;
 
-	for (i = 0; i < nr_pages; i++) {
-		rb->data_pages[i] = perf_mmap_alloc_page(cpu);
-		if (!rb->data_pages[i])
+	/* nr_pages is a power of two, see perf_mmap() */
+	order = nr_pages ? min(ilog2(nr_pages), MAX_ORDER - 1) : 0;
+	while (!rb_alloc_data_pages(rb, nr_pages, cpu, order)) {
+		if (!order--)
 			goto fail_data_pages;
 	}
 
-	rb->nr_pages = nr_pages;
-
 	ring_buffer_init(rb, watermark, flags);
 
 	return rb;
 
 fail_data_pages:
-	for (i--; i >= 0; i--)
-		perf_mmap_free_page(rb->data_pages[i]);
-
-	perf_mmap_free_page(rb->user_page);
+	perf_mmap_free_page(rb->user_page, 0);
 
 fail_user_page:
 	kfree(rb);
@@ -847,17 +885,18 @@ void rb_free(struct perf_buffer *rb)
 {
 	int i;
 
-	perf_mmap_free_page(rb->user_page);
+	perf_mmap_free_page(rb->user_page, 0);
 	for (i = 0; i < rb->nr_pages; i++)
-		perf_mmap_free_page(rb->data_pages[i]);
+		perf_mmap_free_page(rb->data_pages[i], page_order(rb));
 	kfree(rb);
 }
 
 #else
-static int data_page_nr(struct perf_buffer *rb)
-{
-	return rb->nr_pages << page_order(rb);
-}
+/*
+ * Back perf_mmap() with vmalloc memory.
+ *
+ * Required for architectures that have d-cache aliasing issues.
+ */
 
 static struct page *
 __perf_mmap_to_page(struct perf_buffer *rb, unsigned long pgoff)
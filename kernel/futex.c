@@ -2727,6 +2727,117 @@ static int futex_wait(u32 __user *uaddr, unsigned int flags, u32 val,
 	return ret;
 }
 
+/**
+ * futex_wait_multiple() - wait on any of several futexes
+ * @uwb:	userspace array of futex_wait_block
+ * @flags:	futex flags (FLAGS_SHARED, etc.)
+ * @count:	number of entries in @uwb
+ * @abs_time:	absolute timeout, or NULL
+ *
+ * Each futex is set up and queued in turn, exactly as futex_wait() would,
+ * so a wakeup on one that is already queued is never lost while the later
+ * ones are being set up.  The task state is only set once all of them are
+ * queued; a wakeup that came in before that is caught by checking whether
+ * any futex_q has been unqueued.
+ *
+ * Return: the index of a woken futex, or -EWOULDBLOCK if one of the values
+ * did not match, -ETIMEDOUT, or an error.  A signal with a timeout pending
+ * returns -EINTR rather than restarting, so the timeout is not extended.
+ */
+static int futex_wait_multiple(struct futex_wait_block __user *uwb,
+			       unsigned int flags, u32 count,
+			       ktime_t *abs_time)
+{
+	struct hrtimer_sleeper timeout, *to;
+	struct futex_wait_block *wb;
+	struct futex_hash_bucket *hb;
+	struct futex_q *qs;
+	bool woken;
+	int ret, i;
+
+	if (!count || count > FUTEX_MULTIPLE_MAX_COUNT)
+		return -EINVAL;
+
+	wb = kmalloc_array(count, sizeof(*wb), GFP_KERNEL);
+	qs = kmalloc_array(count, sizeof(*qs), GFP_KERNEL);
+	if (!wb || !qs) {
+		ret = -ENOMEM;
+		goto out_free;
+	}
+
+	if (copy_from_user(wb, uwb, count * sizeof(*wb))) {
+		ret = -EFAULT;
+		goto out_free;
+	}
+
+	for (i = 0; i < count; i++) {
+		if (!wb[i].bitset) {
+			ret = -EINVAL;
+			goto out_free;
+		}
+	}
+
+	to = futex_setup_timer(abs_time, &timeout, flags,
+			       current->timer_slack_ns);
+retry:
+	for (i = 0; i < count; i++) {
+		qs[i] = futex_q_init;
+		qs[i].bitset = wb[i].bitset;
+
+		ret = futex_wait_setup(u64_to_user_ptr(wb[i].uaddr),
+				       wb[i].val, flags, &qs[i], &hb);
+		if (ret) {
+			/* A wakeup on an earlier futex still counts. */
+			while (i--) {
+				if (!unqueue_me(&qs[i]))
+					ret = i;
+			}
+			goto out;
+		}
+		queue_me(&qs[i], hb);
+	}
+
+	set_current_state(TASK_INTERRUPTIBLE);
+	if (to)
+		hrtimer_sleeper_start_expires(to, HRTIMER_MODE_ABS);
+
+	woken = false;
+	for (i = 0; i < count; i++)
+		woken |= plist_node_empty(&qs[i].list);
+	/* Only schedule if nothing woke us and the timer has not expired. */
+	if (!woken && (!to || to->task))
+		freezable_schedule();
+	__set_current_state(TASK_RUNNING);
+
+	ret = -ETIMEDOUT;
+	for (i = count - 1; i >= 0; i--) {
+		if (!unqueue_me(&qs[i]))
+			ret = i;
+	}
+	if (ret >= 0)
+		goto out;
+	if (to && !to->task)
+		goto out;
+
+	/*
+	 * We expect signal_pending(current), but we might be the
+	 * victim of a spurious wakeup as well.
+	 */
+	if (!signal_pending(current))
+		goto retry;
+
+	ret = abs_time ? -EINTR : -ERESTARTSYS;
+
+out:
+	if (to) {
+		hrtimer_cancel(&to->timer);
+		destroy_hrtimer_on_stack(&to->timer);
+	}
+out_free:
+	kfree(qs);
+	kfree(wb);
+	return ret;
+}
 
 static long futex_wait_restart(struct restart_block *restart)
 {
@@ -3770,6 +3881,9 @@ long do_futex(u32 __user *uaddr, int op, u32 val, ktime_t *timeout,
 					     uaddr2);
 	case FUTEX_CMP_REQUEUE_PI:
 		return futex_requeue(uaddr, flags, uaddr2, val, val2, &val3, 1);
+	case FUTEX_WAIT_MULTIPLE:
+		return futex_wait_multiple((void __user *)uaddr, flags, val,
+					   timeout);
 	}
 	return -ENOSYS;
 }
@@ -3786,7 +3900,8 @@ SYSCALL_DEFINE6(futex, u32 __user *, uaddr, int, op, u32, val,
 
 	if (utime && (cmd == FUTEX_WAIT || cmd == FUTEX_LOCK_PI ||
 		      cmd == FUTEX_WAIT_BITSET ||
-		      cmd == FUTEX_WAIT_REQUEUE_PI)) {
+		      cmd == FUTEX_WAIT_REQUEUE_PI ||
+		      cmd == FUTEX_WAIT_MULTIPLE)) {
 		if (unlikely(should_fail_futex(!(op & FUTEX_PRIVATE_FLAG))))
 			return -EFAULT;
 		if (get_timespec64(&ts, utime))
@@ -3795,7 +3910,7 @@ SYSCALL_DEFINE6(futex, u32 __user *, uaddr, int, op, u32, val,
 			return -EINVAL;
 
 		t = timespec64_to_ktime(ts);
-		if (cmd == FUTEX_WAIT)
+		if (cmd == FUTEX_WAIT || cmd == FUTEX_WAIT_MULTIPLE)
 			t = ktime_add_safe(ktime_get(), t);
 		tp = &t;
 	}
@@ -3980,14 +4095,15 @@ SYSCALL_DEFINE6(futex_time32, u32 __user *, uaddr, int, op, u32, val,
 
 	if (utime && (cmd == FUTEX_WAIT || cmd == FUTEX_LOCK_PI ||
 		      cmd == FUTEX_WAIT_BITSET ||
-		      cmd == FUTEX_WAIT_REQUEUE_PI)) {
+		      cmd == FUTEX_WAIT_REQUEUE_PI ||
+		      cmd == FUTEX_WAIT_MULTIPLE)) {
 		if (get_old_timespec32(&ts, utime))
 			return -EFAULT;
 		if (!timespec64_valid(&ts))
 			return -EINVAL;
 
 		t = timespec64_to_ktime(ts);
-		if (cmd == FUTEX_WAIT)
+		if (cmd == FUTEX_WAIT || cmd == FUTEX_WAIT_MULTIPLE)
 			t = ktime_add_safe(ktime_get(), t);
 		tp = &t;
 	}
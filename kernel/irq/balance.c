@@ -0,0 +1,192 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * In kernel interrupt rebalancing.
+ *
+ * Every interval the interrupts each balanceable line raised since the
+ * previous round are charged to the CPU the line is targeted at.  When the
+ * busiest and the least busy CPU differ by more than a quarter of the
+ * busiest load, the line on the busiest CPU which best evens out the
+ * difference is moved over, one line per round.
+ *
+ * The move goes through irq_set_affinity(), so the chip reprograms the
+ * line (on x86 the vector matrix hands out a vector on the new CPU) and
+ * the handler thread, if any, migrates at its next activation.
+ *
+ * Only lines delivered to a single CPU are balanced.  Lines whose affinity
+ * was set from user space are left alone until it is reset to the default
+ * mask.
+ */
+
+#include <linux/cpu.h>
+#include <linux/interrupt.h>
+#include <linux/irq.h>
+#include <linux/moduleparam.h>
+#include <linux/slab.h>
+#include <linux/workqueue.h>
+
+#include "internals.h"
+
+#ifdef MODULE_PARAM_PREFIX
+#undef MODULE_PARAM_PREFIX
+#endif
+#define MODULE_PARAM_PREFIX "irq_balance."
+
+/* Interrupts per second a CPU must see before it is worth unloading */
+#define IRQ_BALANCE_MIN_RATE	100
+
+static unsigned int irq_balance_interval_ms = 2000;
+static unsigned long *irq_balance_load;
+
+static void irq_balance_fn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(irq_balance_work, irq_balance_fn);
+
+static void irq_balance_queue(void)
+{
+	unsigned int ms = READ_ONCE(irq_balance_interval_ms);
+
+	if (ms)
+		mod_delayed_work(system_unbound_wq, &irq_balance_work,
+				 msecs_to_jiffies(ms));
+}
+
+static int irq_balance_set_interval(const char *val,
+				    const struct kernel_param *kp)
+{
+	int ret = param_set_uint(val, kp);
+
+	if (!ret && irq_balance_load) {
+		if (irq_balance_interval_ms)
+			irq_balance_queue();
+		else
+			cancel_delayed_work(&irq_balance_work);
+	}
+	return ret;
+}
+
+static const struct kernel_param_ops irq_balance_interval_ops = {
+	.set	= irq_balance_set_interval,
+	.get	= param_get_uint,
+};
+module_param_cb(interval_ms, &irq_balance_interval_ops,
+		&irq_balance_interval_ms, 0644);
+MODULE_PARM_DESC(interval_ms, "Interrupt rebalancing interval in ms, 0 to disable");
+
+/*
+ * Return the CPU @desc is delivered to, or nr_cpu_ids if the line is not
+ * one the balancer may move.  Called with desc->lock held.
+ */
+static unsigned int irq_balance_target(struct irq_desc *desc)
+{
+	struct irq_data *d = &desc->irq_data;
+	const struct cpumask *eff;
+
+	if (!desc->action || !d->chip || !d->chip->irq_set_affinity ||
+	    irq_settings_is_per_cpu(desc) || irq_settings_is_per_cpu_devid(desc) ||
+	    (desc->istate & IRQS_NMI) || !irqd_can_balance(d) ||
+	    irqd_affinity_is_managed(d))
+		return nr_cpu_ids;
+
+	if (!desc->balance_owned &&
+	    !cpumask_equal(irq_data_get_affinity_mask(d), irq_default_affinity))
+		return nr_cpu_ids;
+
+	eff = irq_data_get_effective_affinity_mask(d);
+	if (cpumask_weight(eff) != 1)
+		return nr_cpu_ids;
+	return cpumask_first_and(eff, cpu_online_mask);
+}
+
+static void irq_balance_fn(struct work_struct *work)
+{
+	unsigned int irq, cpu, busiest, idlest, move = 0;
+	unsigned long diff, best = 0;
+	struct irq_desc *desc;
+
+	memset(irq_balance_load, 0, nr_cpu_ids * sizeof(*irq_balance_load));
+
+	cpus_read_lock();
+	irq_lock_sparse();
+
+	/* Charge the interrupts since the last round to their target */
+	for_each_irq_desc(irq, desc) {
+		raw_spin_lock_irq(&desc->lock);
+		cpu = irq_balance_target(desc);
+		desc->balance_delta = desc->tot_count - desc->balance_last;
+		desc->balance_last = desc->tot_count;
+		if (cpu < nr_cpu_ids)
+			irq_balance_load[cpu] += desc->balance_delta;
+		else
+			desc->balance_delta = 0;
+		raw_spin_unlock_irq(&desc->lock);
+	}
+
+	busiest = idlest = nr_cpu_ids;
+	for_each_cpu_and(cpu, irq_default_affinity, cpu_online_mask) {
+		if (busiest >= nr_cpu_ids ||
+		    irq_balance_load[cpu] > irq_balance_load[busiest])
+			busiest = cpu;
+		if (idlest >= nr_cpu_ids ||
+		    irq_balance_load[cpu] < irq_balance_load[idlest])
+			idlest = cpu;
+	}
+	if (busiest == idlest)
+		goto out;
+
+	diff = irq_balance_load[busiest] - irq_balance_load[idlest];
+	if (irq_balance_load[busiest] < IRQ_BALANCE_MIN_RATE *
+	    irq_balance_interval_ms / MSEC_PER_SEC ||
+	    diff < irq_balance_load[busiest] / 4)
+		goto out;
+
+	/*
+	 * Moving a line with rate r changes the difference by 2r, so the
+	 * largest line below half the difference reduces it the most
+	 * without turning the idlest CPU into the busiest.
+	 */
+	for_each_irq_desc(irq, desc) {
+		unsigned int delta = desc->balance_delta;
+
+		if (delta <= best || delta > diff / 2)
+			continue;
+
+		raw_spin_lock_irq(&desc->lock);
+		if (irq_balance_target(desc) == busiest) {
+			best = delta;
+			move = irq;
+		}
+		raw_spin_unlock_irq(&desc->lock);
+	}
+
+	if (move && !irq_set_affinity(move, cpumask_of(idlest))) {
+		desc = irq_to_desc(move);
+		raw_spin_lock_irq(&desc->lock);
+		desc->balance_owned = true;
+		raw_spin_unlock_irq(&desc->lock);
+	}
+out:
+	irq_unlock_sparse();
+	cpus_read_unlock();
+	irq_balance_queue();
+}
+
+/* Called when user space sets the affinity of @desc */
+void irq_balance_release(struct irq_desc *desc)
+{
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(&desc->lock, flags);
+	desc->balance_owned = false;
+	raw_spin_unlock_irqrestore(&desc->lock, flags);
+}
+
+static int __init irq_balance_init(void)
+{
+	irq_balance_load = kcalloc(nr_cpu_ids, sizeof(*irq_balance_load),
+				   GFP_KERNEL);
+	if (!irq_balance_load)
+		return -ENOMEM;
+
+	irq_balance_queue();
+	return 0;
+}
+late_initcall(irq_balance_init);
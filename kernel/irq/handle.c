@@ -199,6 +199,7 @@ irqreturn_t handle_irq_event_percpu(struct irq_desc *desc)
 
 	if (!noirqdebug)
 		note_interrupt(desc, retval);
+	irq_moderation_note(desc, retval);
 	return retval;
 }
 
@@ -390,6 +390,30 @@ static inline void irq_setup_timings(struct irq_desc *desc,
 static inline void record_irq_time(struct irq_desc *desc) {}
 #endif /* CONFIG_IRQ_TIMINGS */
 
+#ifdef CONFIG_IRQ_MODERATION
+extern void __irq_moderation_note(struct irq_desc *desc, irqreturn_t ret);
+extern int irq_moderation_show(struct seq_file *m, struct irq_desc *desc);
+extern void irq_remove_moderation(struct irq_desc *desc);
+
+/* Called for every handled hard interrupt, polls are not accounted */
+static inline void irq_moderation_note(struct irq_desc *desc, irqreturn_t ret)
+{
+	if (unlikely(READ_ONCE(desc->moderation)) &&
+	    !(desc->istate & IRQS_POLL_INPROGRESS))
+		__irq_moderation_note(desc, ret);
+}
+#else
+static inline void irq_moderation_note(struct irq_desc *desc,
+				       irqreturn_t ret) { }
+static inline void irq_remove_moderation(struct irq_desc *desc) { }
+#endif /* CONFIG_IRQ_MODERATION */
+
+#ifdef CONFIG_IRQ_REBALANCE
+extern void irq_balance_release(struct irq_desc *desc);
+#else
+static inline void irq_balance_release(struct irq_desc *desc) { }
+#endif
+
 
 #ifdef CONFIG_GENERIC_IRQ_CHIP
 void irq_init_generic_chip(struct irq_chip_generic *gc, const char *name,
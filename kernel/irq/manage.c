@@ -1144,6 +1144,9 @@ static void irq_wake_secondary(struct irq_desc *desc, struct irqaction *action)
 	raw_spin_unlock_irq(&desc->lock);
 }
 
+/* Activations an irq thread handles before rechecking for kthread_stop() */
+#define IRQ_THREAD_BATCH	16
+
 /*
  * Interrupt handler thread
  */
@@ -1168,14 +1171,24 @@ static int irq_thread(void *data)
 
 	while (!irq_wait_for_interrupt(action)) {
 		irqreturn_t action_ret;
+		unsigned int batch = 0;
 
 		irq_thread_check_affinity(desc, action);
 
-		action_ret = handler_fn(desc, action);
-		if (action_ret == IRQ_WAKE_THREAD)
-			irq_wake_secondary(desc, action);
+		/*
+		 * Drain activations which arrived while the handler ran
+		 * without going through the wait and affinity checks for
+		 * each of them. Every activation still drops its
+		 * threads_active reference.
+		 */
+		do {
+			action_ret = handler_fn(desc, action);
+			if (action_ret == IRQ_WAKE_THREAD)
+				irq_wake_secondary(desc, action);
 
-		wake_threads_waitq(desc);
+			wake_threads_waitq(desc);
+		} while (++batch < IRQ_THREAD_BATCH &&
+			 test_and_clear_bit(IRQTF_RUNTHREAD, &action->thread_flags));
 	}
 
 	/*
@@ -1853,6 +1866,7 @@ static struct irqaction *__free_irq(struct irq_desc *desc, void *dev_id)
 		irq_release_resources(desc);
 		chip_bus_sync_unlock(desc);
 		irq_remove_timings(desc);
+		irq_remove_moderation(desc);
 	}
 
 	mutex_unlock(&desc->request_mutex);
@@ -0,0 +1,285 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Software interrupt moderation for devices without hardware coalescing.
+ *
+ * The average interval between interrupts of a moderated line is tracked
+ * in the hard interrupt path.  When it drops below the threshold given by
+ * the driver, the line is disabled and its handlers are run from an
+ * hrtimer once per poll period instead.  After a few consecutive polls
+ * find no work, the line is enabled again and interrupt driven operation
+ * resumes.
+ */
+
+#include <linux/hrtimer.h>
+#include <linux/interrupt.h>
+#include <linux/irq.h>
+#include <linux/sched/clock.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+
+#include "internals.h"
+
+/* Consecutive empty polls before the line is enabled again */
+#define IRQ_MOD_IDLE_POLLS	4
+/* Samples needed after (re)arming before switching to polling */
+#define IRQ_MOD_MIN_SAMPLES	8
+/* Weight of a new sample in the interval average, 1/8 */
+#define IRQ_MOD_EMA_SHIFT	3
+
+/**
+ * struct irq_moderation - moderation state of one interrupt line
+ * @timer:		poll timer, runs while the line is disabled
+ * @desc:		the moderated interrupt descriptor
+ * @threshold_ns:	switch to polling below this average interval
+ * @period:		poll period
+ * @last_ts:		time of the last handled hard interrupt
+ * @avg_ns:		moving average of the interval between interrupts
+ * @samples:		intervals accumulated in @avg_ns since arming
+ * @idle_polls:		consecutive polls which found no work
+ * @polling:		line is disabled and served by @timer
+ * @stopping:		irq_moderation_disable() is tearing this down
+ * @nr_switches:	number of switches to polling
+ * @nr_polls:		number of polls
+ * @nr_polls_handled:	number of polls which found work
+ *
+ * The fields are written either by the hard interrupt handler of the
+ * line or by @timer with desc->lock held, never both at the same time
+ * because the line is disabled while polling.
+ */
+struct irq_moderation {
+	struct hrtimer		timer;
+	struct irq_desc		*desc;
+	u64			threshold_ns;
+	ktime_t			period;
+	u64			last_ts;
+	u64			avg_ns;
+	unsigned int		samples;
+	unsigned int		idle_polls;
+	bool			polling;
+	bool			stopping;
+	unsigned long		nr_switches;
+	unsigned long		nr_polls;
+	unsigned long		nr_polls_handled;
+};
+
+void __irq_moderation_note(struct irq_desc *desc, irqreturn_t ret)
+{
+	struct irq_moderation *mod = READ_ONCE(desc->moderation);
+	u64 now, delta;
+
+	if (!mod || mod->polling || ret == IRQ_NONE)
+		return;
+
+	now = local_clock();
+	if (mod->last_ts) {
+		delta = now - mod->last_ts;
+		if (mod->samples++)
+			mod->avg_ns += (delta >> IRQ_MOD_EMA_SHIFT) -
+				       (mod->avg_ns >> IRQ_MOD_EMA_SHIFT);
+		else
+			mod->avg_ns = delta;
+	}
+	mod->last_ts = now;
+
+	if (mod->samples < IRQ_MOD_MIN_SAMPLES ||
+	    mod->avg_ns >= mod->threshold_ns)
+		return;
+
+	mod->polling = true;
+	mod->idle_polls = 0;
+	mod->nr_switches++;
+	disable_irq_nosync(irq_desc_get_irq(desc));
+	hrtimer_start(&mod->timer, mod->period, HRTIMER_MODE_REL_PINNED_HARD);
+}
+
+static enum hrtimer_restart irq_moderation_poll(struct hrtimer *timer)
+{
+	struct irq_moderation *mod = container_of(timer, struct irq_moderation,
+						  timer);
+	struct irq_desc *desc = mod->desc;
+	irqreturn_t ret = IRQ_NONE;
+	bool resume = false;
+
+	raw_spin_lock(&desc->lock);
+
+	/* irq_moderation_disable() enables the line itself */
+	if (mod->stopping || !desc->action) {
+		raw_spin_unlock(&desc->lock);
+		return HRTIMER_NORESTART;
+	}
+
+	if (!irqd_irq_inprogress(&desc->irq_data)) {
+		desc->istate |= IRQS_POLL_INPROGRESS;
+		ret = handle_irq_event(desc);
+		desc->istate &= ~IRQS_POLL_INPROGRESS;
+	}
+
+	mod->nr_polls++;
+	if (ret != IRQ_NONE) {
+		mod->nr_polls_handled++;
+		mod->idle_polls = 0;
+	} else if (++mod->idle_polls >= IRQ_MOD_IDLE_POLLS) {
+		/* Traffic dropped, rearm the rate estimate from scratch */
+		mod->polling = false;
+		mod->last_ts = 0;
+		mod->samples = 0;
+		resume = true;
+	}
+
+	raw_spin_unlock(&desc->lock);
+
+	if (resume) {
+		enable_irq(irq_desc_get_irq(desc));
+		return HRTIMER_NORESTART;
+	}
+
+	hrtimer_forward_now(timer, mod->period);
+	return HRTIMER_RESTART;
+}
+
+/**
+ * irq_moderation_enable - moderate an interrupt line in software
+ * @irq:	Interrupt line to moderate
+ * @max_rate:	Interrupts per second above which the line is polled
+ * @poll_us:	Poll period in microseconds
+ *
+ * Meant for devices which cannot coalesce interrupts themselves.  When the
+ * rate of handled interrupts exceeds @max_rate, the line is disabled and
+ * its handlers are called every @poll_us microseconds until they stop
+ * finding work.  The handlers must cope with being called when the device
+ * has nothing pending, as for shared interrupts.
+ *
+ * Undone with irq_moderation_disable(), or when the last action of the
+ * line is freed.
+ *
+ * Return: 0 on success, -EINVAL if the line cannot be moderated, -EBUSY
+ * if it already is, -ENOMEM on allocation failure.
+ */
+int irq_moderation_enable(unsigned int irq, unsigned int max_rate,
+			  unsigned int poll_us)
+{
+	struct irq_desc *desc = irq_to_desc(irq);
+	struct irq_moderation *mod;
+	unsigned long flags;
+	int ret = 0;
+
+	if (!desc || !max_rate || !poll_us)
+		return -EINVAL;
+
+	/*
+	 * The line is disabled and enabled from hard interrupt context,
+	 * which rules out slow bus chips.  Per CPU, nested and already
+	 * polled interrupts cannot be polled from a timer.
+	 */
+	if (desc->irq_data.chip->irq_bus_lock ||
+	    irq_settings_is_per_cpu(desc) ||
+	    irq_settings_is_nested_thread(desc) ||
+	    irq_settings_is_polled(desc))
+		return -EINVAL;
+
+	mod = kzalloc(sizeof(*mod), GFP_KERNEL);
+	if (!mod)
+		return -ENOMEM;
+
+	hrtimer_init(&mod->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL_HARD);
+	mod->timer.function = irq_moderation_poll;
+	mod->desc = desc;
+	mod->threshold_ns = div_u64(NSEC_PER_SEC, max_rate);
+	mod->period = us_to_ktime(poll_us);
+
+	raw_spin_lock_irqsave(&desc->lock, flags);
+	if (desc->moderation)
+		ret = -EBUSY;
+	else
+		WRITE_ONCE(desc->moderation, mod);
+	raw_spin_unlock_irqrestore(&desc->lock, flags);
+
+	if (ret)
+		kfree(mod);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(irq_moderation_enable);
+
+/**
+ * irq_moderation_disable - stop moderating an interrupt line
+ * @irq:	Interrupt line
+ *
+ * Stops polling and leaves the line enabled.  May sleep.
+ */
+static struct irq_moderation *irq_moderation_detach(struct irq_desc *desc)
+{
+	struct irq_moderation *mod;
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(&desc->lock, flags);
+	mod = desc->moderation;
+	if (mod) {
+		WRITE_ONCE(desc->moderation, NULL);
+		mod->stopping = true;
+	}
+	raw_spin_unlock_irqrestore(&desc->lock, flags);
+
+	return mod;
+}
+
+void irq_moderation_disable(unsigned int irq)
+{
+	struct irq_desc *desc = irq_to_desc(irq);
+	struct irq_moderation *mod;
+
+	if (!desc)
+		return;
+
+	mod = irq_moderation_detach(desc);
+	if (!mod)
+		return;
+
+	/* A handler which still saw @mod may just have started polling */
+	synchronize_hardirq(irq);
+	hrtimer_cancel(&mod->timer);
+
+	if (mod->polling)
+		enable_irq(irq);
+	kfree(mod);
+}
+EXPORT_SYMBOL_GPL(irq_moderation_disable);
+
+/*
+ * Called by __free_irq() once the last action is gone.  The line has been
+ * shut down, which also resets its disable depth, and no handler runs any
+ * more, so only the poll timer is left to stop.
+ */
+void irq_remove_moderation(struct irq_desc *desc)
+{
+	struct irq_moderation *mod = irq_moderation_detach(desc);
+
+	if (mod) {
+		hrtimer_cancel(&mod->timer);
+		kfree(mod);
+	}
+}
+
+#ifdef CONFIG_PROC_FS
+int irq_moderation_show(struct seq_file *m, struct irq_desc *desc)
+{
+	struct irq_moderation *mod;
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(&desc->lock, flags);
+	mod = desc->moderation;
+	if (!mod) {
+		seq_puts(m, "enabled 0\n");
+	} else {
+		seq_printf(m, "enabled 1\n" "polling %d\n"
+			   "threshold %llu ns\n" "period %lld us\n"
+			   "avg_interval %llu ns\n" "switches %lu\n"
+			   "polls %lu\n" "polls_handled %lu\n",
+			   mod->polling, mod->threshold_ns,
+			   ktime_to_us(mod->period), mod->avg_ns,
+			   mod->nr_switches, mod->nr_polls,
+			   mod->nr_polls_handled);
+	}
+	raw_spin_unlock_irqrestore(&desc->lock, flags);
+	return 0;
+}
+#endif
@@ -167,8 +167,10 @@ static ssize_t write_irq_affinity(int type, struct file *file,
 		err = irq_select_affinity_usr(irq) ? -EINVAL : count;
 	} else {
 		err = irq_set_affinity(irq, new_value);
-		if (!err)
+		if (!err) {
+			irq_balance_release(irq_to_desc(irq));
 			err = count;
+		}
 	}
 
 free_cpumask:
@@ -295,6 +297,13 @@ static int irq_spurious_proc_show(struct seq_file *m, void *v)
 	return 0;
 }
 
+#ifdef CONFIG_IRQ_MODERATION
+static int irq_moderation_proc_show(struct seq_file *m, void *v)
+{
+	return irq_moderation_show(m, irq_to_desc((long) m->private));
+}
+#endif
+
 #define MAX_NAMELEN 128
 
 static int name_unique(unsigned int irq, struct irqaction *new_action)
@@ -385,6 +394,10 @@ void register_irq_proc(unsigned int irq, struct irq_desc *desc)
 #endif
 	proc_create_single_data("spurious", 0444, desc->dir,
 			irq_spurious_proc_show, (void *)(long)irq);
+#ifdef CONFIG_IRQ_MODERATION
+	proc_create_single_data("moderation", 0444, desc->dir,
+			irq_moderation_proc_show, (void *)(long)irq);
+#endif
 
 out_unlock:
 	mutex_unlock(&register_lock);
@@ -407,6 +420,9 @@ void unregister_irq_proc(unsigned int irq, struct irq_desc *desc)
 # endif
 #endif
 	remove_proc_entry("spurious", desc->dir);
+#ifdef CONFIG_IRQ_MODERATION
+	remove_proc_entry("moderation", desc->dir);
+#endif
 
 	sprintf(name, "%u", irq);
 	remove_proc_entry(name, root_irq_dir);
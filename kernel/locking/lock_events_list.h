@@ -49,6 +49,16 @@ LOCK_EVENT(lock_use_node4)	/* # of locking ops that use 4th percpu node */
 LOCK_EVENT(lock_no_node)	/* # of locking ops w/o using percpu node    */
 #endif /* CONFIG_QUEUED_SPINLOCKS */
 
+#ifdef CONFIG_OSQ_ADAPTIVE_SPIN
+/*
+ * Locking events for adaptive optimistic spinning
+ */
+LOCK_EVENT(osq_spin_hit)	/* # of spins that acquired the lock	*/
+LOCK_EVENT(osq_spin_miss)	/* # of spins that ended up sleeping	*/
+LOCK_EVENT(osq_spin_skip)	/* # of spins skipped by history	*/
+LOCK_EVENT(osq_spin_probe)	/* # of spins allowed to re-learn	*/
+#endif /* CONFIG_OSQ_ADAPTIVE_SPIN */
+
 /*
  * Locking events for rwsem
  */
@@ -3063,7 +3063,6 @@ static inline int add_chain_cache(struct task_struct *curr,
 		dump_stack();
 		return 0;
 	}
-	chain->chain_key = chain_key;
 	chain->irq_context = hlock->irq_context;
 	i = get_first_held_lock(curr, hlock);
 	chain->depth = curr->lockdep_depth + 1 - i;
@@ -3089,6 +3088,12 @@ static inline int add_chain_cache(struct task_struct *curr,
 		chain_hlocks[chain->base + j] = lock_id;
 	}
 	chain_hlocks[chain->base + j] = class - lock_classes;
+	/*
+	 * The slot may be a reused one that a per-CPU chain cache still
+	 * points at, publish the key only once the chain is complete.
+	 * Pairs with smp_load_acquire() in lookup_chain_cache_cpu().
+	 */
+	smp_store_release(&chain->chain_key, chain_key);
 	hlist_add_head_rcu(&chain->entry, hash_head);
 	debug_atomic_inc(chain_lookup_misses);
 	inc_chains(chain->irq_context);
@@ -3114,6 +3119,44 @@ static inline struct lock_chain *lookup_chain_cache(u64 chain_key)
 	return NULL;
 }
 
+/*
+ * Per-CPU direct mapped cache of recently seen chains, consulted before
+ * chainhash_table so that the common case of re-taking a known chain stays
+ * on CPU local cache lines.  Entries are only hints: a chain that is freed
+ * gets its chain_key overwritten and lock_chains[] itself is never freed,
+ * so a stale entry misses; a reused slot only gets its new chain_key once
+ * the rest of the chain is filled in.  Accessed with interrupts disabled.
+ */
+#define CHAIN_CACHE_BITS	6
+#define CHAIN_CACHE_SIZE	(1UL << CHAIN_CACHE_BITS)
+
+static DEFINE_PER_CPU(struct lock_chain *, chain_cache[CHAIN_CACHE_SIZE]);
+
+static inline struct lock_chain *lookup_chain_cache_cpu(u64 chain_key)
+{
+	unsigned long idx = hash_long(chain_key, CHAIN_CACHE_BITS);
+	struct lock_chain *chain = __this_cpu_read(chain_cache[idx]);
+
+	if (chain && smp_load_acquire(&chain->chain_key) == chain_key) {
+		debug_atomic_inc(chain_cache_hits);
+		return chain;
+	}
+
+	chain = lookup_chain_cache(chain_key);
+	if (chain)
+		__this_cpu_write(chain_cache[idx], chain);
+	return chain;
+}
+
+/* Forget every cached chain, for lockdep_reset() */
+static void chain_cache_flush(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		memset(per_cpu_ptr(&chain_cache, cpu), 0, sizeof(chain_cache));
+}
+
 /*
  * If the key is not present yet in dependency chain cache then
  * add it and return 1 - in this case the new dependency chain is
@@ -3125,7 +3168,7 @@ static inline int lookup_chain_cache_add(struct task_struct *curr,
 					 u64 chain_key)
 {
 	struct lock_class *class = hlock_class(hlock);
-	struct lock_chain *chain = lookup_chain_cache(chain_key);
+	struct lock_chain *chain = lookup_chain_cache_cpu(chain_key);
 
 	if (chain) {
 cache_hit:
@@ -5280,6 +5323,9 @@ void lockdep_reset(void)
 	debug_locks = 1;
 	for (i = 0; i < CHAINHASH_SIZE; i++)
 		INIT_HLIST_HEAD(chainhash_table + i);
+#ifdef CONFIG_PROVE_LOCKING
+	chain_cache_flush();
+#endif
 	raw_local_irq_restore(flags);
 }
 
@@ -177,6 +177,7 @@ lockdep_count_backward_deps(struct lock_class *class)
  */
 struct lockdep_stats {
 	unsigned long  chain_lookup_hits;
+	unsigned long  chain_cache_hits;
 	unsigned int   chain_lookup_misses;
 	unsigned long  hardirqs_on_events;
 	unsigned long  hardirqs_off_events;
@@ -646,7 +646,8 @@ mutex_optimistic_spin(struct mutex *lock, struct ww_acquire_ctx *ww_ctx,
 		 * is not going to take OSQ lock anyway, there is no need
 		 * to call mutex_can_spin_on_owner().
 		 */
-		if (!mutex_can_spin_on_owner(lock))
+		if (!mutex_can_spin_on_owner(lock) ||
+		    !osq_spin_worthwhile(&lock->osq))
 			goto fail;
 
 		/*
@@ -682,15 +683,19 @@ mutex_optimistic_spin(struct mutex *lock, struct ww_acquire_ctx *ww_ctx,
 		cpu_relax();
 	}
 
-	if (!waiter)
+	if (!waiter) {
+		osq_spin_result(&lock->osq, true);
 		osq_unlock(&lock->osq);
+	}
 
 	return true;
 
 
 fail_unlock:
-	if (!waiter)
+	if (!waiter) {
+		osq_spin_result(&lock->osq, false);
 		osq_unlock(&lock->osq);
+	}
 
 fail:
 	/*
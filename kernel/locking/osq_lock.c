@@ -2,6 +2,9 @@
 #include <linux/percpu.h>
 #include <linux/sched.h>
 #include <linux/osq_lock.h>
+#include <linux/hash.h>
+
+#include "lock_events.h"
 
 /*
  * An MCS like lock especially tailored for optimistic spinning for sleeping
@@ -230,3 +233,67 @@ void osq_unlock(struct optimistic_spin_queue *lock)
 	if (next)
 		WRITE_ONCE(next->locked, 1);
 }
+
+#ifdef CONFIG_OSQ_ADAPTIVE_SPIN
+/*
+ * Spinning history is kept per hash bucket of the lock address rather
+ * than in the lock itself, so that struct optimistic_spin_queue stays a
+ * single word in every mutex and rwsem.  Each bucket is a saturating
+ * score: a spin that ends with the lock taken adds OSQ_SPIN_HIT, a spin
+ * that gives up and sleeps subtracts OSQ_SPIN_MISS.  Once a bucket
+ * drops below OSQ_SPIN_MISS, only one attempt in OSQ_SPIN_PROBE is
+ * allowed to spin, so a lock whose behaviour changes can earn spinning
+ * back.  Updates are racy on purpose; a lost update only makes the
+ * estimate noisier.
+ */
+#define OSQ_SPIN_HASH_BITS	8
+#define OSQ_SPIN_MAX		64
+#define OSQ_SPIN_HIT		4
+#define OSQ_SPIN_MISS		16
+#define OSQ_SPIN_PROBE		16
+
+static u8 osq_spin_score[1 << OSQ_SPIN_HASH_BITS] = {
+	[0 ... (1 << OSQ_SPIN_HASH_BITS) - 1] = OSQ_SPIN_MAX,
+};
+static DEFINE_PER_CPU(unsigned int, osq_spin_probe);
+
+static inline u8 *osq_spin_bucket(struct optimistic_spin_queue *lock)
+{
+	return &osq_spin_score[hash_ptr(lock, OSQ_SPIN_HASH_BITS)];
+}
+
+/*
+ * Called with preemption disabled, before queueing on @lock.
+ */
+bool osq_spin_worthwhile(struct optimistic_spin_queue *lock)
+{
+	if (READ_ONCE(*osq_spin_bucket(lock)) >= OSQ_SPIN_MISS)
+		return true;
+
+	if (!(__this_cpu_inc_return(osq_spin_probe) % OSQ_SPIN_PROBE)) {
+		lockevent_inc(osq_spin_probe);
+		return true;
+	}
+
+	lockevent_inc(osq_spin_skip);
+	return false;
+}
+
+void osq_spin_result(struct optimistic_spin_queue *lock, bool taken)
+{
+	u8 *score = osq_spin_bucket(lock);
+	unsigned int old = READ_ONCE(*score);
+
+	if (taken) {
+		lockevent_inc(osq_spin_hit);
+		if (old < OSQ_SPIN_MAX)
+			WRITE_ONCE(*score, min_t(unsigned int, old + OSQ_SPIN_HIT,
+						   OSQ_SPIN_MAX));
+	} else {
+		lockevent_inc(osq_spin_miss);
+		if (old)
+			WRITE_ONCE(*score, old > OSQ_SPIN_MISS ?
+					   old - OSQ_SPIN_MISS : 0);
+	}
+}
+#endif /* CONFIG_OSQ_ADAPTIVE_SPIN */
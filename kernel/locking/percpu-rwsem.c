@@ -20,6 +20,7 @@ int __percpu_init_rwsem(struct percpu_rw_semaphore *sem,
 	rcuwait_init(&sem->writer);
 	init_waitqueue_head(&sem->waiters);
 	atomic_set(&sem->block, 0);
+	sem->write_batch = 0;
 #ifdef CONFIG_DEBUG_LOCK_ALLOC
 	debug_check_no_locks_freed((void *)sem, sizeof(*sem));
 	lockdep_init_map(&sem->dep_map, name, key, 0);
@@ -239,10 +240,61 @@ void percpu_down_write(struct percpu_rw_semaphore *sem)
 }
 EXPORT_SYMBOL_GPL(percpu_down_write);
 
+/*
+ * Writers that queue up behind each other are let through back-to-back,
+ * up to this many, before the waiting readers get their turn.
+ */
+#define PERCPU_RWSEM_WRITE_BATCH	8
+
+/*
+ * Pass sem->block straight to the first queued writer, skipping any
+ * readers queued ahead of it, so that a burst of writers runs under the
+ * single rcu_sync grace period it already shares.  Readers never lose
+ * their slow path in between, and the next writer finds no readers to
+ * wait for.  Returns false when there is no writer to hand over to or
+ * the batch limit has been reached; sem->write_batch is only touched by
+ * the write owner.
+ */
+static bool percpu_rwsem_handoff_writer(struct percpu_rw_semaphore *sem)
+{
+	struct wait_queue_entry *wq_entry;
+	struct task_struct *p;
+	bool handoff = false;
+
+	if (sem->write_batch >= PERCPU_RWSEM_WRITE_BATCH)
+		goto out;
+
+	spin_lock_irq(&sem->waiters.lock);
+	list_for_each_entry(wq_entry, &sem->waiters.head, entry) {
+		if (wq_entry->flags & WQ_FLAG_CUSTOM)
+			continue;
+
+		sem->write_batch++;
+		p = get_task_struct(wq_entry->private);
+		list_del_init(&wq_entry->entry);
+		smp_store_release(&wq_entry->private, NULL);
+		wake_up_process(p);
+		put_task_struct(p);
+		handoff = true;
+		break;
+	}
+	spin_unlock_irq(&sem->waiters.lock);
+
+out:
+	if (!handoff)
+		sem->write_batch = 0;
+	return handoff;
+}
+
 void percpu_up_write(struct percpu_rw_semaphore *sem)
 {
 	rwsem_release(&sem->dep_map, _RET_IP_);
 
+	if (percpu_rwsem_handoff_writer(sem)) {
+		rcu_sync_exit(&sem->rss);
+		return;
+	}
+
 	/*
 	 * Signal the writer is done, no fast path yet.
 	 *
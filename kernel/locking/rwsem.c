@@ -794,7 +794,7 @@ static bool rwsem_optimistic_spin(struct rw_semaphore *sem, bool wlock)
 	preempt_disable();
 
 	/* sem->wait_lock should not be held when doing optimistic spinning */
-	if (!osq_lock(&sem->osq))
+	if (!osq_spin_worthwhile(&sem->osq) || !osq_lock(&sem->osq))
 		goto done;
 
 	/*
@@ -899,6 +899,7 @@ static bool rwsem_optimistic_spin(struct rw_semaphore *sem, bool wlock)
 		 */
 		cpu_relax();
 	}
+	osq_spin_result(&sem->osq, taken);
 	osq_unlock(&sem->osq);
 done:
 	preempt_enable();
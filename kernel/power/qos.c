@@ -212,12 +212,15 @@ bool pm_qos_update_flags(struct pm_qos_flags *pqf,
 #ifdef CONFIG_CPU_IDLE
 /* Definitions related to the CPU latency QoS. */
 
+static BLOCKING_NOTIFIER_HEAD(cpu_latency_notifiers);
+
 static struct pm_qos_constraints cpu_latency_constraints = {
 	.list = PLIST_HEAD_INIT(cpu_latency_constraints.list),
 	.target_value = PM_QOS_CPU_LATENCY_DEFAULT_VALUE,
 	.default_value = PM_QOS_CPU_LATENCY_DEFAULT_VALUE,
 	.no_constraint_value = PM_QOS_CPU_LATENCY_DEFAULT_VALUE,
 	.type = PM_QOS_MIN,
+	.notifiers = &cpu_latency_notifiers,
 };
 
 /**
@@ -273,6 +276,10 @@ void cpu_latency_qos_add_request(struct pm_qos_request *req, s32 value)
 
 	trace_pm_qos_add_request(value);
 
+#ifdef CONFIG_DEBUG_FS
+	req->caller = _RET_IP_;
+	req->added = jiffies;
+#endif
 	req->qos = &cpu_latency_constraints;
 	cpu_latency_qos_apply(req, PM_QOS_ADD_REQ, value);
 }
@@ -330,6 +337,29 @@ void cpu_latency_qos_remove_request(struct pm_qos_request *req)
 }
 EXPORT_SYMBOL_GPL(cpu_latency_qos_remove_request);
 
+/**
+ * cpu_latency_qos_add_notifier - Add CPU latency QoS change notifier.
+ * @nb: Notifier block to add.
+ *
+ * @nb is called with the new effective constraint, in process context, every
+ * time it changes.  Requests must not be updated from within @nb.
+ */
+int cpu_latency_qos_add_notifier(struct notifier_block *nb)
+{
+	return blocking_notifier_chain_register(&cpu_latency_notifiers, nb);
+}
+EXPORT_SYMBOL_GPL(cpu_latency_qos_add_notifier);
+
+/**
+ * cpu_latency_qos_remove_notifier - Remove CPU latency QoS change notifier.
+ * @nb: Notifier block to remove.
+ */
+int cpu_latency_qos_remove_notifier(struct notifier_block *nb)
+{
+	return blocking_notifier_chain_unregister(&cpu_latency_notifiers, nb);
+}
+EXPORT_SYMBOL_GPL(cpu_latency_qos_remove_notifier);
+
 /* User space interface to the CPU latency QoS via misc device. */
 
 static int cpu_latency_qos_open(struct inode *inode, struct file *filp)
@@ -410,6 +440,30 @@ static struct miscdevice cpu_latency_qos_miscdev = {
 	.fops = &cpu_latency_qos_fops,
 };
 
+#ifdef CONFIG_DEBUG_FS
+/*
+ * One line per active request: its value, how long it has been active and
+ * who added it.  The first line is the request setting the effective limit.
+ */
+static int cpu_latency_qos_debug_show(struct seq_file *s, void *unused)
+{
+	struct pm_qos_constraints *c = &cpu_latency_constraints;
+	struct pm_qos_request *req;
+	unsigned long flags;
+
+	spin_lock_irqsave(&pm_qos_lock, flags);
+	seq_printf(s, "effective: %d us\n", pm_qos_get_value(c));
+	plist_for_each_entry(req, &c->list, node)
+		seq_printf(s, "%10d us %10u ms %pS\n", req->node.prio,
+			   jiffies_to_msecs(jiffies - req->added),
+			   (void *)req->caller);
+	spin_unlock_irqrestore(&pm_qos_lock, flags);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(cpu_latency_qos_debug);
+#endif
+
 static int __init cpu_latency_qos_init(void)
 {
 	int ret;
@@ -419,6 +473,11 @@ static int __init cpu_latency_qos_init(void)
 		pr_err("%s: %s setup failed\n", __func__,
 		       cpu_latency_qos_miscdev.name);
 
+#ifdef CONFIG_DEBUG_FS
+	debugfs_create_file("cpu_latency_qos", 0444, NULL, NULL,
+			    &cpu_latency_qos_debug_fops);
+#endif
+
 	return ret;
 }
 late_initcall(cpu_latency_qos_init);
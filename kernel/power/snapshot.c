@@ -1406,9 +1406,23 @@ static inline void copy_data_page(unsigned long dst_pfn, unsigned long src_pfn)
 }
 #endif /* CONFIG_HIGHMEM */
 
-static void copy_data_pages(struct memory_bitmap *copy_bm,
-			    struct memory_bitmap *orig_bm)
+/**
+ * mark_saveable_pages - Mark the pages to put into the hibernation image.
+ * @orig_bm: Memory bitmap to mark the saveable pages in.
+ * @nr_highmem: Where to store the number of saveable highmem pages.
+ *
+ * Walk every zone once, setting the bits of the saveable pages in @orig_bm,
+ * and return the number of saveable non-highmem pages.  This is the same set
+ * count_data_pages() and count_highmem_pages() would count, but it only has
+ * to be computed once in the atomic section.
+ *
+ * The pages allocated for the image afterwards are free at this point, so
+ * they are not marked and the set stays valid until the copy is done.
+ */
+static unsigned int mark_saveable_pages(struct memory_bitmap *orig_bm,
+					unsigned int *nr_highmem)
 {
+	unsigned int n = 0, n_highmem = 0;
 	struct zone *zone;
 	unsigned long pfn;
 
@@ -1417,10 +1431,26 @@ static void copy_data_pages(struct memory_bitmap *copy_bm,
 
 		mark_free_pages(zone);
 		max_zone_pfn = zone_end_pfn(zone);
-		for (pfn = zone->zone_start_pfn; pfn < max_zone_pfn; pfn++)
-			if (page_is_saveable(zone, pfn))
-				memory_bm_set_bit(orig_bm, pfn);
+		for (pfn = zone->zone_start_pfn; pfn < max_zone_pfn; pfn++) {
+			if (!page_is_saveable(zone, pfn))
+				continue;
+
+			memory_bm_set_bit(orig_bm, pfn);
+			if (is_highmem(zone))
+				n_highmem++;
+			else
+				n++;
+		}
 	}
+	*nr_highmem = n_highmem;
+	return n;
+}
+
+static void copy_data_pages(struct memory_bitmap *copy_bm,
+			    struct memory_bitmap *orig_bm)
+{
+	unsigned long pfn;
+
 	memory_bm_position_reset(orig_bm);
 	memory_bm_position_reset(copy_bm);
 	for(;;) {
@@ -1979,8 +2009,7 @@ asmlinkage __visible int swsusp_save(void)
 	pr_info("Creating image:\n");
 
 	drain_local_pages(NULL);
-	nr_pages = count_data_pages();
-	nr_highmem = count_highmem_pages();
+	nr_pages = mark_saveable_pages(&orig_bm, &nr_highmem);
 	pr_info("Need to copy %u pages\n", nr_pages + nr_highmem);
 
 	if (!enough_free_mem(nr_pages, nr_highmem)) {
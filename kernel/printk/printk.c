@@ -42,6 +42,7 @@
 #include <linux/rculist.h>
 #include <linux/poll.h>
 #include <linux/irq_work.h>
+#include <linux/kthread.h>
 #include <linux/ctype.h>
 #include <linux/uio.h>
 #include <linux/sched/clock.h>
@@ -1984,6 +1985,98 @@ int vprintk_store(int facility, int level,
 			  dict, dictlen, text, text_len);
 }
 
+/*
+ * Once the printk kthread is running, console output is normally handed
+ * to it instead of being done by the printing CPU.  console_unlock()
+ * can spend milliseconds per line on a slow serial console, and this
+ * keeps that out of whatever context called printk().  Messages are
+ * still stored synchronously.  Output stays synchronous when requested
+ * with printk.synchronous, for emergency messages, during an oops or
+ * panic, and outside normal runtime (early boot, shutdown), when the
+ * kthread may never get to run.  It is an ordinary task, so it may also
+ * be starved: once a wakeup has gone unserved for PRINTK_KTHREAD_STALL,
+ * the printing CPUs flush the consoles themselves again.
+ */
+#define PRINTK_KTHREAD_STALL	HZ
+
+static bool printk_synchronous;
+module_param_named(synchronous, printk_synchronous, bool, 0644);
+MODULE_PARM_DESC(synchronous, "print to consoles from the printk() caller");
+
+static struct task_struct *printk_kthread __read_mostly;
+static bool printk_kthread_pending;
+static unsigned long printk_kthread_woken;	/* jiffies of the pending wakeup */
+
+static bool printk_kthread_stalled(void)
+{
+	return READ_ONCE(printk_kthread_pending) &&
+	       time_after(jiffies, READ_ONCE(printk_kthread_woken) +
+				   PRINTK_KTHREAD_STALL);
+}
+
+static bool printk_offload(int level)
+{
+	return READ_ONCE(printk_kthread) && !READ_ONCE(printk_synchronous) &&
+	       level != LOGLEVEL_EMERG && !oops_in_progress &&
+	       system_state == SYSTEM_RUNNING && !printk_kthread_stalled();
+}
+
+/*
+ * printk() passes LOGLEVEL_DEFAULT and leaves the level in the KERN_*
+ * prefix of the format, which vprintk_store() only parses for itself.
+ */
+static int printk_offload_level(int facility, int level, const char *fmt)
+{
+	int kern_level;
+
+	if (facility || level != LOGLEVEL_DEFAULT)
+		return level;
+
+	while ((kern_level = printk_get_level(fmt)) != 0) {
+		if (kern_level >= '0' && kern_level <= '7')
+			return kern_level - '0';
+		fmt = printk_skip_level(fmt);
+	}
+
+	return level;
+}
+
+static void wake_up_printk_kthread(void)
+{
+	if (!xchg(&printk_kthread_pending, true))
+		WRITE_ONCE(printk_kthread_woken, jiffies);
+	wake_up_process(printk_kthread);
+}
+
+static int printk_kthread_func(void *data)
+{
+	for (;;) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (!xchg(&printk_kthread_pending, false)) {
+			schedule();
+			continue;
+		}
+		__set_current_state(TASK_RUNNING);
+
+		console_lock();
+		console_unlock();
+	}
+
+	return 0;
+}
+
+static void start_printk_kthread(void)
+{
+	struct task_struct *tsk;
+
+	tsk = kthread_run(printk_kthread_func, NULL, "printk");
+	if (IS_ERR(tsk)) {
+		pr_err("printk: unable to create printing thread\n");
+		return;
+	}
+	WRITE_ONCE(printk_kthread, tsk);
+}
+
 asmlinkage int vprintk_emit(int facility, int level,
 			    const char *dict, size_t dictlen,
 			    const char *fmt, va_list args)
@@ -2012,8 +2105,15 @@ asmlinkage int vprintk_emit(int facility, int level,
 	pending_output = (curr_log_seq != log_next_seq);
 	logbuf_unlock_irqrestore(flags);
 
-	/* If called from the scheduler, we can not call up(). */
-	if (!in_sched && pending_output) {
+	/*
+	 * If called from the scheduler, we can not call up().  When
+	 * offloading, the printk kthread is woken from irq_work, which keeps
+	 * this safe in any context.
+	 */
+	if (!in_sched && pending_output &&
+	    printk_offload(printk_offload_level(facility, level, fmt))) {
+		defer_console_output();
+	} else if (!in_sched && pending_output) {
 		/*
 		 * Disable preemption to avoid being preempted while holding
 		 * console_sem which would prevent anyone from printing to
@@ -2113,6 +2213,7 @@ static void call_console_drivers(const char *ext_text, size_t ext_len,
 static size_t msg_print_text(const struct printk_log *msg, bool syslog,
 			     bool time, char *buf, size_t size) { return 0; }
 static bool suppress_message_printing(int level) { return false; }
+static void start_printk_kthread(void) { }
 
 #endif /* CONFIG_PRINTK */
 
@@ -3002,6 +3103,7 @@ static int __init printk_late_init(void)
 	ret = cpuhp_setup_state_nocalls(CPUHP_AP_ONLINE_DYN, "printk:online",
 					console_cpu_notify, NULL);
 	WARN_ON(ret < 0);
+	start_printk_kthread();
 	return 0;
 }
 late_initcall(printk_late_init);
@@ -3020,9 +3122,12 @@ static void wake_up_klogd_work_func(struct irq_work *irq_work)
 	int pending = __this_cpu_xchg(printk_pending, 0);
 
 	if (pending & PRINTK_PENDING_OUTPUT) {
-		/* If trylock fails, someone else is doing the printing */
-		if (console_trylock())
+		if (printk_offload(LOGLEVEL_DEFAULT)) {
+			wake_up_printk_kthread();
+		} else if (console_trylock()) {
+			/* If trylock fails, someone else is doing the printing */
 			console_unlock();
+		}
 	}
 
 	if (pending & PRINTK_PENDING_WAKEUP)
@@ -595,6 +595,7 @@ rcu_perf_shutdown(void *arg)
 torture_param(int, kfree_nthreads, -1, "Number of threads running loops of kfree_rcu().");
 torture_param(int, kfree_alloc_num, 8000, "Number of allocations and frees done in an iteration.");
 torture_param(int, kfree_loops, 10, "Number of loops doing kfree_alloc_num allocations and frees.");
+torture_param(bool, kfree_by_call_rcu, 0, "Use call_rcu() to emulate kfree_rcu()?");
 
 static struct task_struct **kfree_reader_tasks;
 static int kfree_nrealthreads;
@@ -606,6 +607,14 @@ struct kfree_obj {
 	struct rcu_head rh;
 };
 
+/* Used if doing RCU-kfree'ing via call_rcu(). */
+static void kfree_call_rcu_cb(struct rcu_head *rh)
+{
+	struct kfree_obj *obj = container_of(rh, struct kfree_obj, rh);
+
+	kfree(obj);
+}
+
 static int
 kfree_perf_thread(void *arg)
 {
@@ -640,7 +649,12 @@ kfree_perf_thread(void *arg)
 			if (!alloc_ptr)
 				return -ENOMEM;
 
-			kfree_rcu(alloc_ptr, rh);
+			if (kfree_by_call_rcu) {
+				/* Baseline: one callback and one kfree() per object. */
+				call_rcu(&(alloc_ptr->rh), kfree_call_rcu_cb);
+			} else {
+				kfree_rcu(alloc_ptr, rh);
+			}
 		}
 
 		cond_resched();
@@ -654,7 +668,8 @@ kfree_perf_thread(void *arg)
 		else
 			b_rcu_gp_test_finished = cur_ops->get_gp_seq();
 
-		pr_alert("Total time taken by all kfree'ers: %llu ns, loops: %d, batches: %ld, memory footprint: %lldMB\n",
+		pr_alert("Total time taken by all kfree'ers (%s): %llu ns, loops: %d, batches: %ld, memory footprint: %lldMB\n",
+		       kfree_by_call_rcu ? "call_rcu" : "kfree_rcu",
 		       (unsigned long long)(end_time - start_time), kfree_loops,
 		       rcuperf_seq_diff(b_rcu_gp_test_finished, b_rcu_gp_test_started),
 		       (mem_begin - mem_during) >> (20 - PAGE_SHIFT));
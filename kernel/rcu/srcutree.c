@@ -274,7 +274,8 @@ static unsigned long srcu_readers_lock_idx(struct srcu_struct *ssp, int idx)
  * Returns approximate total of the readers' ->srcu_unlock_count[] values
  * for the rank of per-CPU counters specified by idx.
  */
-static unsigned long srcu_readers_unlock_idx(struct srcu_struct *ssp, int idx)
+static unsigned long srcu_readers_unlock_idx(struct srcu_struct *ssp, int idx,
+					     bool *lite)
 {
 	int cpu;
 	unsigned long sum = 0;
@@ -283,6 +284,7 @@ static unsigned long srcu_readers_unlock_idx(struct srcu_struct *ssp, int idx)
 		struct srcu_data *cpuc = per_cpu_ptr(ssp->sda, cpu);
 
 		sum += READ_ONCE(cpuc->srcu_unlock_count[idx]);
+		*lite |= READ_ONCE(cpuc->srcu_lite_used);
 	}
 	return sum;
 }
@@ -294,8 +296,9 @@ static unsigned long srcu_readers_unlock_idx(struct srcu_struct *ssp, int idx)
 static bool srcu_readers_active_idx_check(struct srcu_struct *ssp, int idx)
 {
 	unsigned long unlocks;
+	bool lite = false;
 
-	unlocks = srcu_readers_unlock_idx(ssp, idx);
+	unlocks = srcu_readers_unlock_idx(ssp, idx, &lite);
 
 	/*
 	 * Make sure that a lock is always counted if the corresponding
@@ -307,8 +310,15 @@ static bool srcu_readers_active_idx_check(struct srcu_struct *ssp, int idx)
 	 * This smp_mb() also pairs with smp_mb() C to prevent accesses
 	 * after the synchronize_srcu() from being executed before the
 	 * grace period ends.
+	 *
+	 * Readers using srcu_read_lock_lite() have no B or C, so the RCU
+	 * grace period stands in for them: it forces a full barrier on
+	 * every CPU that RCU is watching.
 	 */
-	smp_mb(); /* A */
+	if (lite)
+		synchronize_rcu(); /* A, and B and C for lite readers */
+	else
+		smp_mb(); /* A */
 
 	/*
 	 * If the locks are the same as the unlocks, then there must have
@@ -436,6 +446,45 @@ void __srcu_read_unlock(struct srcu_struct *ssp, int idx)
 }
 EXPORT_SYMBOL_GPL(__srcu_read_unlock);
 
+/*
+ * Mark this CPU as having seen a lite reader.  The flag is only ever
+ * set, and the first time round a full barrier orders it against the
+ * counter update that follows, so that an updater either sees the flag
+ * or is seen by the reader like with B.
+ */
+static inline void srcu_note_lite_reader(struct srcu_struct *ssp)
+{
+	struct srcu_data *sdp = raw_cpu_ptr(ssp->sda);
+
+	if (likely(READ_ONCE(sdp->srcu_lite_used)))
+		return;
+	WRITE_ONCE(sdp->srcu_lite_used, true);
+	smp_mb(); /* Order the flag before the first lite increment. */
+}
+
+/*
+ * Counts the new reader like __srcu_read_lock(), but leaves the memory
+ * ordering to the synchronize_rcu() in srcu_readers_active_idx_check().
+ */
+int __srcu_read_lock_lite(struct srcu_struct *ssp)
+{
+	int idx;
+
+	srcu_note_lite_reader(ssp);
+	idx = READ_ONCE(ssp->srcu_idx) & 0x1;
+	this_cpu_inc(ssp->sda->srcu_lock_count[idx]);
+	barrier(); /* Avoid leaking the critical section. */
+	return idx;
+}
+EXPORT_SYMBOL_GPL(__srcu_read_lock_lite);
+
+void __srcu_read_unlock_lite(struct srcu_struct *ssp, int idx)
+{
+	barrier(); /* Avoid leaking the critical section. */
+	this_cpu_inc(ssp->sda->srcu_unlock_count[idx]);
+}
+EXPORT_SYMBOL_GPL(__srcu_read_unlock_lite);
+
 /*
  * We use an adaptive strategy for synchronize_srcu() and especially for
  * synchronize_srcu_expedited().  We spin for a fixed time period
@@ -7490,6 +7490,7 @@ void sched_online_group(struct task_group *tg, struct task_group *parent)
 	spin_unlock_irqrestore(&task_group_lock, flags);
 
 	online_fair_sched_group(tg);
+	calc_tg_load_start();
 }
 
 /* rcu callback to free various structures associated with a task group */
@@ -8187,6 +8188,38 @@ static u64 cpu_rt_period_read_uint(struct cgroup_subsys_state *css,
 }
 #endif /* CONFIG_RT_GROUP_SCHED */
 
+#ifdef CONFIG_FAIR_GROUP_SCHED
+static int cpu_loadavg_show(struct seq_file *sf, void *v)
+{
+	struct task_group *tg = css_tg(seq_css(sf));
+	unsigned long avnrun[3];
+	int i;
+
+	for (i = 0; i < 3; i++)
+		avnrun[i] = READ_ONCE(tg->avenrun[i]) + FIXED_1/200;
+
+	seq_printf(sf, "%lu.%02lu %lu.%02lu %lu.%02lu\n",
+		   LOAD_INT(avnrun[0]), LOAD_FRAC(avnrun[0]),
+		   LOAD_INT(avnrun[1]), LOAD_FRAC(avnrun[1]),
+		   LOAD_INT(avnrun[2]), LOAD_FRAC(avnrun[2]));
+	return 0;
+}
+
+static int cpu_rq_depth_show(struct seq_file *sf, void *v)
+{
+	static const char * const labels[TG_RQ_DEPTH_BUCKETS] = {
+		"0", "1", "2", "4", "8", "16", "32", "inf",
+	};
+	struct task_group *tg = css_tg(seq_css(sf));
+	int i;
+
+	for (i = 0; i < TG_RQ_DEPTH_BUCKETS; i++)
+		seq_printf(sf, "le_%s %lu\n", labels[i],
+			   READ_ONCE(tg->rq_depth_hist[i]));
+	return 0;
+}
+#endif
+
 static struct cftype cpu_legacy_files[] = {
 #ifdef CONFIG_FAIR_GROUP_SCHED
 	{
@@ -8194,6 +8227,16 @@ static struct cftype cpu_legacy_files[] = {
 		.read_u64 = cpu_shares_read_u64,
 		.write_u64 = cpu_shares_write_u64,
 	},
+	{
+		.name = "loadavg",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.seq_show = cpu_loadavg_show,
+	},
+	{
+		.name = "rq_depth",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.seq_show = cpu_rq_depth_show,
+	},
 #endif
 #ifdef CONFIG_CFS_BANDWIDTH
 	{
@@ -8395,6 +8438,16 @@ static struct cftype cpu_files[] = {
 		.read_s64 = cpu_weight_nice_read_s64,
 		.write_s64 = cpu_weight_nice_write_s64,
 	},
+	{
+		.name = "loadavg",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.seq_show = cpu_loadavg_show,
+	},
+	{
+		.name = "rq_depth",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.seq_show = cpu_rq_depth_show,
+	},
 #endif
 #ifdef CONFIG_CFS_BANDWIDTH
 	{
@@ -7059,6 +7059,23 @@ pick_next_task_fair(struct rq *rq, struct task_struct *prev, struct rq_flags *rf
 
 	goto done;
 simple:
+#else
+	/*
+	 * The flat equivalent of the above: if prev is still runnable and
+	 * remains the entity to run (a tick, or a wakeup that did not
+	 * preempt), keep it without the rb-tree insert and erase that
+	 * put_prev_entity() and set_next_entity() would do.
+	 */
+	if (prev && prev->sched_class == &fair_sched_class &&
+	    prev->se.on_rq && cfs_rq->curr == &prev->se) {
+		update_curr(cfs_rq);
+
+		se = pick_next_entity(cfs_rq, &prev->se);
+		if (se == &prev->se) {
+			p = prev;
+			goto done;
+		}
+	}
 #endif
 	if (prev)
 		put_prev_task(rq, prev);
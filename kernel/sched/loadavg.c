@@ -341,6 +341,66 @@ static inline void calc_global_nohz(void) { }
 
 #endif /* CONFIG_NO_HZ_COMMON */
 
+#ifdef CONFIG_FAIR_GROUP_SCHED
+static inline unsigned int tg_rq_depth_bucket(unsigned int nr)
+{
+	return nr ? min_t(unsigned int, fls(nr - 1) + 1,
+			  TG_RQ_DEPTH_BUCKETS - 1) : 0;
+}
+
+/*
+ * Per task group averages, sampled from the group's CFS runqueues at
+ * the same LOAD_FREQ cadence as avenrun[].  Unlike the global figure
+ * these only count runnable tasks: nr_uninterruptible is not tracked
+ * per group.  Every sample also lands each CPU's depth in the group's
+ * histogram.
+ *
+ * The walk is O(groups * CPUs), so it runs from a workqueue rather than
+ * from calc_global_load(), which is called from the tick with
+ * jiffies_lock held.  The work is only armed while there are groups
+ * other than the root one, sched_online_group() starts it again.
+ */
+static void calc_tg_load_workfn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(calc_tg_load_work, calc_tg_load_workfn);
+
+static void calc_tg_load_workfn(struct work_struct *work)
+{
+	struct task_group *tg;
+	unsigned long active;
+	bool groups = false;
+	unsigned int nr;
+	int cpu;
+
+	rcu_read_lock();
+	list_for_each_entry_rcu(tg, &task_groups, list) {
+		if (tg == &root_task_group)
+			continue;
+
+		groups = true;
+		active = 0;
+		for_each_online_cpu(cpu) {
+			nr = READ_ONCE(tg->cfs_rq[cpu]->h_nr_running);
+			tg->rq_depth_hist[tg_rq_depth_bucket(nr)]++;
+			active += nr;
+		}
+		active *= FIXED_1;
+
+		tg->avenrun[0] = calc_load(tg->avenrun[0], EXP_1, active);
+		tg->avenrun[1] = calc_load(tg->avenrun[1], EXP_5, active);
+		tg->avenrun[2] = calc_load(tg->avenrun[2], EXP_15, active);
+	}
+	rcu_read_unlock();
+
+	if (groups)
+		calc_tg_load_start();
+}
+
+void calc_tg_load_start(void)
+{
+	queue_delayed_work(system_unbound_wq, &calc_tg_load_work, LOAD_FREQ);
+}
+#endif
+
 /*
  * calc_load - update the avenrun load estimates 10 ticks after the
  * CPUs have updated calc_load_tasks.
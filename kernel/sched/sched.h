@@ -99,6 +99,12 @@ extern atomic_long_t calc_load_tasks;
 extern void calc_global_load_tick(struct rq *this_rq);
 extern long calc_load_fold_active(struct rq *this_rq, long adjust);
 
+#ifdef CONFIG_FAIR_GROUP_SCHED
+extern void calc_tg_load_start(void);
+#else
+static inline void calc_tg_load_start(void) { }
+#endif
+
 extern void call_trace_sched_update_nr_running(struct rq *rq, int count);
 /*
  * Helpers for converting nanosecond timing to jiffy resolution
@@ -381,6 +387,9 @@ struct cfs_bandwidth {
 };
 
 /* Task group related information */
+/* runqueue depth buckets: 0, 1, 2, <=4, <=8, <=16, <=32, more */
+#define TG_RQ_DEPTH_BUCKETS	8
+
 struct task_group {
 	struct cgroup_subsys_state css;
 
@@ -391,6 +400,10 @@ struct task_group {
 	struct cfs_rq		**cfs_rq;
 	unsigned long		shares;
 
+	/* runnable load average and per-CPU runqueue depth samples */
+	unsigned long		avenrun[3];
+	unsigned long		rq_depth_hist[TG_RQ_DEPTH_BUCKETS];
+
 #ifdef	CONFIG_SMP
 	/*
 	 * load_avg can be heavily contended at clock tick time, so put
@@ -1085,20 +1085,64 @@ hrtimer_update_softirq_timer(struct hrtimer_cpu_base *cpu_base, bool reprogram)
 	hrtimer_reprogram(cpu_base->softirq_next_timer, reprogram);
 }
 
+/*
+ * Re-arm a timer that is queued on this CPU without taking it out of
+ * the timerqueue, when the new expiry leaves it between the same two
+ * neighbours.  The leftmost timer of a clock base is excluded: moving
+ * it would change the next event, which needs the full path.  As the
+ * timer stays where it is, it is also not considered for migration.
+ */
+static bool hrtimer_rearm_inplace(struct hrtimer *timer, ktime_t tim,
+				  u64 delta_ns, const enum hrtimer_mode mode,
+				  struct hrtimer_clock_base *base)
+{
+	struct hrtimer_cpu_base *cpu_base = base->cpu_base;
+	struct rb_node *prev, *next;
+	ktime_t expires;
+
+	if (!(timer->state & HRTIMER_STATE_ENQUEUED) ||
+	    cpu_base != this_cpu_ptr(&hrtimer_bases))
+		return false;
+
+	cpu_base->nr_rearms++;
+
+	if (&timer->node == timerqueue_getnext(&base->active))
+		return false;
+
+	expires = ktime_add_safe(tim, ns_to_ktime(delta_ns));
+
+	/* Equal expiry times queue FIFO, so keep strictly before @next. */
+	prev = rb_prev(&timer->node.node);
+	if (prev && rb_entry(prev, struct timerqueue_node, node)->expires > expires)
+		return false;
+	next = rb_next(&timer->node.node);
+	if (next && rb_entry(next, struct timerqueue_node, node)->expires <= expires)
+		return false;
+
+	debug_deactivate(timer);
+	hrtimer_set_expires_range_ns(timer, tim, delta_ns);
+	debug_activate(timer, mode);
+	cpu_base->nr_rearms_inplace++;
+	return true;
+}
+
 static int __hrtimer_start_range_ns(struct hrtimer *timer, ktime_t tim,
 				    u64 delta_ns, const enum hrtimer_mode mode,
 				    struct hrtimer_clock_base *base)
 {
 	struct hrtimer_clock_base *new_base;
 
-	/* Remove an active timer from the queue: */
-	remove_hrtimer(timer, base, true);
-
 	if (mode & HRTIMER_MODE_REL)
 		tim = ktime_add_safe(tim, base->get_time());
 
 	tim = hrtimer_update_lowres(timer, tim, mode);
 
+	if (hrtimer_rearm_inplace(timer, tim, delta_ns, mode, base))
+		return 0;
+
+	/* Remove an active timer from the queue: */
+	remove_hrtimer(timer, base, true);
+
 	hrtimer_set_expires_range_ns(timer, tim, delta_ns);
 
 	/* Switch the timer base, if necessary: */
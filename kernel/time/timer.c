@@ -223,8 +223,10 @@ static DECLARE_WORK(timer_update_work, timer_update_keys);
 
 #ifdef CONFIG_SMP
 unsigned int sysctl_timer_migration = 1;
+unsigned int sysctl_timer_coalesce;
 
 DEFINE_STATIC_KEY_FALSE(timers_migration_enabled);
+static DEFINE_STATIC_KEY_FALSE(timers_coalesce_enabled);
 
 static void timers_update_migration(void)
 {
@@ -232,6 +234,11 @@ static void timers_update_migration(void)
 		static_branch_enable(&timers_migration_enabled);
 	else
 		static_branch_disable(&timers_migration_enabled);
+
+	if (sysctl_timer_migration && sysctl_timer_coalesce && tick_nohz_active)
+		static_branch_enable(&timers_coalesce_enabled);
+	else
+		static_branch_disable(&timers_coalesce_enabled);
 }
 #else
 static inline void timers_update_migration(void) { }
@@ -879,13 +886,37 @@ static inline struct timer_base *get_timer_base(u32 tflags)
 	return get_timer_cpu_base(tflags, tflags & TIMER_CPUMASK);
 }
 
+#if defined(CONFIG_SMP) && defined(CONFIG_NO_HZ_COMMON)
+/*
+ * With kernel.timer_coalesce set, unpinned deferrable timers are all
+ * queued on the CPU currently doing the jiffies update.  That CPU has
+ * to take ticks anyway, so the timers run whenever it is awake instead
+ * of piling up on, and being run late by, idle CPUs, and the other
+ * CPUs get longer idle periods.  Fall back to the usual choice when no
+ * CPU owns the tick.
+ */
+static int get_deferrable_timer_target(void)
+{
+	int cpu = READ_ONCE(tick_do_timer_cpu);
+
+	if (cpu < 0 || !cpu_online(cpu))
+		return get_nohz_timer_target();
+	return cpu;
+}
+#endif
+
 static inline struct timer_base *
 get_target_base(struct timer_base *base, unsigned tflags)
 {
 #if defined(CONFIG_SMP) && defined(CONFIG_NO_HZ_COMMON)
 	if (static_branch_likely(&timers_migration_enabled) &&
-	    !(tflags & TIMER_PINNED))
+	    !(tflags & TIMER_PINNED)) {
+		if (static_branch_unlikely(&timers_coalesce_enabled) &&
+		    (tflags & TIMER_DEFERRABLE))
+			return get_timer_cpu_base(tflags,
+						  get_deferrable_timer_target());
 		return get_timer_cpu_base(tflags, get_nohz_timer_target());
+	}
 #endif
 	return get_timer_this_cpu_base(tflags);
 }
@@ -0,0 +1,150 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Adaptive completion moderation for block devices.
+ *
+ * Same measure/decide loop as rdma_dim(), with each call being one
+ * interrupt, but the decision is made on byte throughput first and a
+ * moderated queue that sees fewer than two completions per interrupt is
+ * taken straight back to the unmoderated profile: at such depths every
+ * microsecond of coalescing delay is added to the latency of the single
+ * request in flight.  It then parks there for a few windows before probing
+ * to the right again; the unmoderated profile always sees one completion
+ * per interrupt, so the ratio says nothing about the depth there.
+ */
+
+#include <linux/dim.h>
+
+/* below this many completions per interrupt (x100) moderation only hurts */
+#define BLK_DIM_LOW_CPE_RATIO	200
+/* measurement windows to stay unmoderated after such a reset */
+#define BLK_DIM_LOW_CPE_PARK	(BLK_DIM_PARAMS_NUM_PROFILES * 2)
+
+static const struct dim_cq_moder blk_profile[BLK_DIM_PARAMS_NUM_PROFILES] = {
+	{ .usec = 0,	.comps = 1 },
+	{ .usec = 8,	.comps = 4 },
+	{ .usec = 16,	.comps = 8 },
+	{ .usec = 32,	.comps = 16 },
+	{ .usec = 64,	.comps = 32 },
+	{ .usec = 128,	.comps = 64 },
+};
+
+struct dim_cq_moder blk_dim_get_moderation(u8 ix)
+{
+	return blk_profile[min_t(u8, ix, BLK_DIM_PARAMS_NUM_PROFILES - 1)];
+}
+
+static int blk_dim_step(struct dim *dim)
+{
+	if (dim->tune_state == DIM_GOING_RIGHT) {
+		if (dim->profile_ix == (BLK_DIM_PARAMS_NUM_PROFILES - 1))
+			return DIM_ON_EDGE;
+		dim->profile_ix++;
+		dim->steps_right++;
+	}
+	if (dim->tune_state == DIM_GOING_LEFT) {
+		if (dim->profile_ix == 0)
+			return DIM_ON_EDGE;
+		dim->profile_ix--;
+		dim->steps_left++;
+	}
+
+	return DIM_STEPPED;
+}
+
+static int blk_dim_stats_compare(struct dim_stats *curr,
+				 struct dim_stats *prev)
+{
+	/* first stat */
+	if (!prev->bpms)
+		return DIM_STATS_SAME;
+
+	if (IS_SIGNIFICANT_DIFF(curr->bpms, prev->bpms))
+		return (curr->bpms > prev->bpms) ? DIM_STATS_BETTER :
+						   DIM_STATS_WORSE;
+
+	if (!prev->cpms)
+		return DIM_STATS_SAME;
+
+	if (IS_SIGNIFICANT_DIFF(curr->cpms, prev->cpms))
+		return (curr->cpms > prev->cpms) ? DIM_STATS_BETTER :
+						   DIM_STATS_WORSE;
+
+	if (IS_SIGNIFICANT_DIFF(curr->cpe_ratio, prev->cpe_ratio))
+		return (curr->cpe_ratio > prev->cpe_ratio) ? DIM_STATS_BETTER :
+							     DIM_STATS_WORSE;
+
+	return DIM_STATS_SAME;
+}
+
+static bool blk_dim_decision(struct dim_stats *curr_stats, struct dim *dim)
+{
+	int prev_ix = dim->profile_ix;
+	u8 state = dim->tune_state;
+	int stats_res;
+	int step_res;
+
+	if (state == DIM_PARKING_TIRED) {
+		if (!--dim->tired)
+			dim->tune_state = DIM_GOING_RIGHT;
+	} else if (dim->profile_ix &&
+		   curr_stats->cpe_ratio < BLK_DIM_LOW_CPE_RATIO) {
+		dim->profile_ix = 0;
+		dim_park_tired(dim);
+		dim->tired = BLK_DIM_LOW_CPE_PARK;
+	} else {
+		stats_res = blk_dim_stats_compare(curr_stats,
+						  &dim->prev_stats);
+
+		switch (stats_res) {
+		case DIM_STATS_SAME:
+			break;
+		case DIM_STATS_WORSE:
+			dim_turn(dim);
+			/* fall through */
+		case DIM_STATS_BETTER:
+			step_res = blk_dim_step(dim);
+			if (step_res == DIM_ON_EDGE)
+				dim_turn(dim);
+			break;
+		}
+	}
+
+	dim->prev_stats = *curr_stats;
+
+	return dim->profile_ix != prev_ix;
+}
+
+void blk_dim(struct dim *dim, u64 completions, u64 bytes)
+{
+	struct dim_sample *curr_sample = &dim->measuring_sample;
+	struct dim_stats curr_stats;
+	u32 nevents;
+
+	dim_update_sample_with_comps(curr_sample->event_ctr + 1, 0,
+				     curr_sample->byte_ctr + bytes,
+				     curr_sample->comp_ctr + completions,
+				     &dim->measuring_sample);
+
+	switch (dim->state) {
+	case DIM_MEASURE_IN_PROGRESS:
+		nevents = curr_sample->event_ctr - dim->start_sample.event_ctr;
+		if (nevents < DIM_NEVENTS)
+			break;
+		dim_calc_stats(&dim->start_sample, curr_sample, &curr_stats);
+		if (blk_dim_decision(&curr_stats, dim)) {
+			dim->state = DIM_APPLY_NEW_PROFILE;
+			schedule_work(&dim->work);
+			break;
+		}
+		/* fall through */
+	case DIM_START_MEASURE:
+		dim->state = DIM_MEASURE_IN_PROGRESS;
+		dim_update_sample_with_comps(curr_sample->event_ctr, 0,
+					     curr_sample->byte_ctr,
+					     curr_sample->comp_ctr,
+					     &dim->start_sample);
+		break;
+	case DIM_APPLY_NEW_PROFILE:
+		break;
+	}
+}
@@ -146,6 +146,45 @@ static int copyout(void __user *to, const void *from, size_t n)
 	return n;
 }
 
+/*
+ * Reads at least this large copy out with non-temporal stores where the
+ * architecture has them, so that streaming a big file through read() does
+ * not push everything else out of the cache.
+ */
+#define COPYOUT_NOCACHE_MIN	(1UL << 20)
+
+#ifdef raw_copy_to_user_nocache
+static int copyout_nocache(void __user *to, const void *from, size_t n)
+{
+	if (access_ok(to, n)) {
+		instrument_copy_to_user(to, from, n);
+		n = raw_copy_to_user_nocache(to, from, n);
+	}
+	return n;
+}
+
+static inline bool iov_iter_copyout_nocache(const struct iov_iter *i)
+{
+	return i->count >= COPYOUT_NOCACHE_MIN;
+}
+#else
+static inline int copyout_nocache(void __user *to, const void *from, size_t n)
+{
+	return copyout(to, from, n);
+}
+
+static inline bool iov_iter_copyout_nocache(const struct iov_iter *i)
+{
+	return false;
+}
+#endif
+
+static __always_inline int copyout_hint(void __user *to, const void *from,
+					size_t n, bool nocache)
+{
+	return nocache ? copyout_nocache(to, from, n) : copyout(to, from, n);
+}
+
 static int copyin(void *to, const void __user *from, size_t n)
 {
 	if (access_ok(from, n)) {
@@ -162,6 +201,7 @@ static size_t copy_page_to_iter_iovec(struct page *page, size_t offset, size_t b
 	const struct iovec *iov;
 	char __user *buf;
 	void *kaddr, *from;
+	bool nocache;
 
 	if (unlikely(bytes > i->count))
 		bytes = i->count;
@@ -170,6 +210,7 @@ static size_t copy_page_to_iter_iovec(struct page *page, size_t offset, size_t b
 		return 0;
 
 	might_fault();
+	nocache = iov_iter_copyout_nocache(i);
 	wanted = bytes;
 	iov = i->iov;
 	skip = i->iov_offset;
@@ -181,7 +222,7 @@ static size_t copy_page_to_iter_iovec(struct page *page, size_t offset, size_t b
 		from = kaddr + offset;
 
 		/* first chunk, usually the only one */
-		left = copyout(buf, from, copy);
+		left = copyout_hint(buf, from, copy, nocache);
 		copy -= left;
 		skip += copy;
 		from += copy;
@@ -191,7 +232,7 @@ static size_t copy_page_to_iter_iovec(struct page *page, size_t offset, size_t b
 			iov++;
 			buf = iov->iov_base;
 			copy = min(bytes, iov->iov_len);
-			left = copyout(buf, from, copy);
+			left = copyout_hint(buf, from, copy, nocache);
 			copy -= left;
 			skip = copy;
 			from += copy;
@@ -210,7 +251,7 @@ static size_t copy_page_to_iter_iovec(struct page *page, size_t offset, size_t b
 
 	kaddr = kmap(page);
 	from = kaddr + offset;
-	left = copyout(buf, from, copy);
+	left = copyout_hint(buf, from, copy, nocache);
 	copy -= left;
 	skip += copy;
 	from += copy;
@@ -219,7 +260,7 @@ static size_t copy_page_to_iter_iovec(struct page *page, size_t offset, size_t b
 		iov++;
 		buf = iov->iov_base;
 		copy = min(bytes, iov->iov_len);
-		left = copyout(buf, from, copy);
+		left = copyout_hint(buf, from, copy, nocache);
 		copy -= left;
 		skip = copy;
 		from += copy;
@@ -622,12 +663,17 @@ static size_t csum_and_copy_to_pipe_iter(const void *addr, size_t bytes,
 size_t _copy_to_iter(const void *addr, size_t bytes, struct iov_iter *i)
 {
 	const char *from = addr;
+	bool nocache = false;
+
 	if (unlikely(iov_iter_is_pipe(i)))
 		return copy_pipe_to_iter(addr, bytes, i);
-	if (iter_is_iovec(i))
+	if (iter_is_iovec(i)) {
 		might_fault();
+		nocache = iov_iter_copyout_nocache(i);
+	}
 	iterate_and_advance(i, bytes, v,
-		copyout(v.iov_base, (from += v.iov_len) - v.iov_len, v.iov_len),
+		copyout_hint(v.iov_base, (from += v.iov_len) - v.iov_len,
+			     v.iov_len, nocache),
 		memcpy_to_page(v.bv_page, v.bv_offset,
 			       (from += v.bv_len) - v.bv_len, v.bv_len),
 		memcpy(v.iov_base, (from += v.iov_len) - v.iov_len, v.iov_len)
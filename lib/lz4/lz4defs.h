@@ -137,6 +137,33 @@ static FORCE_INLINE void LZ4_writeLE16(void *memPtr, U16 value)
 	return put_unaligned_le16(value, memPtr);
 }
 
+#if defined(CONFIG_MIPS) && LZ4_ARCH64 && !defined(CONFIG_CPU_MIPSR6)
+/*
+ * Pre-R6 MIPS traps on unaligned doubleword accesses, copy with the
+ * ldl/ldr and sdl/sdr pairs which handle any alignment without the trap.
+ */
+#if LZ4_LITTLE_ENDIAN
+#define LZ4_MIPS_LEFT	"7"
+#define LZ4_MIPS_RIGHT	"0"
+#else
+#define LZ4_MIPS_LEFT	"0"
+#define LZ4_MIPS_RIGHT	"7"
+#endif
+
+static FORCE_INLINE void LZ4_copy8(void *dst, const void *src)
+{
+	U64 a;
+
+	__asm__ ("ldl	%0, " LZ4_MIPS_LEFT "(%1)\n\t"
+		 "ldr	%0, " LZ4_MIPS_RIGHT "(%1)"
+		 : "=&r" (a)
+		 : "r" (src), "m" (*(const BYTE (*)[8])src));
+	__asm__ ("sdl	%2, " LZ4_MIPS_LEFT "(%1)\n\t"
+		 "sdr	%2, " LZ4_MIPS_RIGHT "(%1)"
+		 : "=m" (*(BYTE (*)[8])dst)
+		 : "r" (dst), "r" (a));
+}
+#else
 static FORCE_INLINE void LZ4_copy8(void *dst, const void *src)
 {
 #if LZ4_ARCH64
@@ -151,6 +178,7 @@ static FORCE_INLINE void LZ4_copy8(void *dst, const void *src)
 	put_unaligned(b, (U32 *)dst + 1);
 #endif
 }
+#endif
 
 /*
  * customized variant of memcpy,
@@ -9,12 +9,154 @@
 #include <linux/cpu.h>
 #include <linux/module.h>
 #include <linux/debugobjects.h>
+#include <linux/nodemask.h>
+#include <linux/slab.h>
 
 #ifdef CONFIG_HOTPLUG_CPU
 static LIST_HEAD(percpu_counters);
 static DEFINE_SPINLOCK(percpu_counters_lock);
 #endif
 
+#ifdef CONFIG_NUMA
+/*
+ * On NUMA machines a CPU spills its local count into the counter of its
+ * node, and only a node whose count exceeds the batch times its number of
+ * CPUs takes fbc->lock to spill into fbc->count.  That keeps the cacheline
+ * of fbc->count from bouncing between nodes on every spill.
+ *
+ * Each level then holds up to half the batch per CPU, so that what
+ * percpu_counter_read() misses stays within the batch per online CPU, as
+ * without the node level.  A CPU spills under its node's lock, which the
+ * sum and set take, with fbc->lock held, around the node and its CPUs.
+ */
+struct percpu_counter_node {
+	raw_spinlock_t lock;
+	s64 count;
+} ____cacheline_aligned_in_smp;
+
+/* Online CPUs per online node, rounded up */
+static int percpu_counter_node_cpus __read_mostly = 1;
+
+static void percpu_counter_nodes_init(struct percpu_counter *fbc, gfp_t gfp)
+{
+	int nid;
+
+	fbc->nodes = NULL;
+	if (nr_node_ids > 1)
+		fbc->nodes = kcalloc(nr_node_ids, sizeof(*fbc->nodes), gfp);
+	if (fbc->nodes)
+		for (nid = 0; nid < nr_node_ids; nid++)
+			raw_spin_lock_init(&fbc->nodes[nid].lock);
+}
+
+static void percpu_counter_nodes_free(struct percpu_counter *fbc)
+{
+	kfree(fbc->nodes);
+	fbc->nodes = NULL;
+}
+
+static inline s32 percpu_counter_cpu_batch(struct percpu_counter *fbc,
+					   s32 batch)
+{
+	return fbc->nodes ? max(batch / 2, 1) : batch;
+}
+
+/*
+ * Called with fbc->lock held: add up, or with @reset clear, the node
+ * counts and the counts of @cpus, node by node under the node's lock.
+ * Returns false if there is no node level.
+ */
+static bool percpu_counter_nodes_sum(struct percpu_counter *fbc,
+				     const struct cpumask *cpus, bool reset,
+				     s64 *sum)
+{
+	struct percpu_counter_node *node;
+	int nid, cpu;
+
+	if (!fbc->nodes)
+		return false;
+
+	for (nid = 0; nid < nr_node_ids; nid++) {
+		node = &fbc->nodes[nid];
+		raw_spin_lock(&node->lock);
+		for_each_cpu(cpu, cpus) {
+			s32 *pcount = per_cpu_ptr(fbc->counters, cpu);
+
+			if (cpu_to_node(cpu) != nid)
+				continue;
+			if (reset)
+				*pcount = 0;
+			else
+				*sum += *pcount;
+		}
+		if (reset)
+			node->count = 0;
+		else
+			*sum += node->count;
+		raw_spin_unlock(&node->lock);
+	}
+	return true;
+}
+
+/* Called with preemption disabled, returns false if there is no node level */
+static bool percpu_counter_node_spill(struct percpu_counter *fbc, s64 count,
+				      s64 amount, s32 batch)
+{
+	struct percpu_counter_node *node;
+	unsigned long flags;
+	bool full;
+
+	if (!fbc->nodes)
+		return false;
+
+	node = &fbc->nodes[cpu_to_node(smp_processor_id())];
+	raw_spin_lock_irqsave(&node->lock, flags);
+	node->count += count;
+	__this_cpu_sub(*fbc->counters, count - amount);
+	full = abs(node->count) >=
+	       (s64)batch * READ_ONCE(percpu_counter_node_cpus);
+	raw_spin_unlock_irqrestore(&node->lock, flags);
+
+	if (full) {
+		raw_spin_lock_irqsave(&fbc->lock, flags);
+		raw_spin_lock(&node->lock);
+		fbc->count += node->count;
+		node->count = 0;
+		raw_spin_unlock(&node->lock);
+		raw_spin_unlock_irqrestore(&fbc->lock, flags);
+	}
+	return true;
+}
+#else
+static inline void percpu_counter_nodes_init(struct percpu_counter *fbc,
+					     gfp_t gfp)
+{
+}
+
+static inline void percpu_counter_nodes_free(struct percpu_counter *fbc)
+{
+}
+
+static inline s32 percpu_counter_cpu_batch(struct percpu_counter *fbc,
+					   s32 batch)
+{
+	return batch;
+}
+
+static inline bool percpu_counter_nodes_sum(struct percpu_counter *fbc,
+					    const struct cpumask *cpus,
+					    bool reset, s64 *sum)
+{
+	return false;
+}
+
+static inline bool percpu_counter_node_spill(struct percpu_counter *fbc,
+					     s64 count, s64 amount, s32 batch)
+{
+	return false;
+}
+#endif
+
 #ifdef CONFIG_DEBUG_OBJECTS_PERCPU_COUNTER
 
 static struct debug_obj_descr percpu_counter_debug_descr;
@@ -63,9 +205,11 @@ void percpu_counter_set(struct percpu_counter *fbc, s64 amount)
 	unsigned long flags;
 
 	raw_spin_lock_irqsave(&fbc->lock, flags);
-	for_each_possible_cpu(cpu) {
-		s32 *pcount = per_cpu_ptr(fbc->counters, cpu);
-		*pcount = 0;
+	if (!percpu_counter_nodes_sum(fbc, cpu_possible_mask, true, NULL)) {
+		for_each_possible_cpu(cpu) {
+			s32 *pcount = per_cpu_ptr(fbc->counters, cpu);
+			*pcount = 0;
+		}
 	}
 	fbc->count = amount;
 	raw_spin_unlock_irqrestore(&fbc->lock, flags);
@@ -81,11 +225,13 @@ EXPORT_SYMBOL(percpu_counter_set);
  */
 void percpu_counter_add_batch(struct percpu_counter *fbc, s64 amount, s32 batch)
 {
+	s32 cpu_batch = percpu_counter_cpu_batch(fbc, batch);
 	s64 count;
 
 	preempt_disable();
 	count = __this_cpu_read(*fbc->counters) + amount;
-	if (count >= batch || count <= -batch) {
+	if ((count >= cpu_batch || count <= -cpu_batch) &&
+	    !percpu_counter_node_spill(fbc, count, amount, cpu_batch)) {
 		unsigned long flags;
 		raw_spin_lock_irqsave(&fbc->lock, flags);
 		fbc->count += count;
@@ -129,9 +275,11 @@ s64 __percpu_counter_sum(struct percpu_counter *fbc)
 
 	raw_spin_lock_irqsave(&fbc->lock, flags);
 	ret = fbc->count;
-	for_each_online_cpu(cpu) {
-		s32 *pcount = per_cpu_ptr(fbc->counters, cpu);
-		ret += *pcount;
+	if (!percpu_counter_nodes_sum(fbc, cpu_online_mask, false, &ret)) {
+		for_each_online_cpu(cpu) {
+			s32 *pcount = per_cpu_ptr(fbc->counters, cpu);
+			ret += *pcount;
+		}
 	}
 	raw_spin_unlock_irqrestore(&fbc->lock, flags);
 	return ret;
@@ -149,6 +297,8 @@ int __percpu_counter_init(struct percpu_counter *fbc, s64 amount, gfp_t gfp,
 	fbc->counters = alloc_percpu_gfp(s32, gfp);
 	if (!fbc->counters)
 		return -ENOMEM;
+	/* Without the node level the counter just spills to count directly */
+	percpu_counter_nodes_init(fbc, gfp);
 
 	debug_percpu_counter_activate(fbc);
 
@@ -178,6 +328,7 @@ void percpu_counter_destroy(struct percpu_counter *fbc)
 #endif
 	free_percpu(fbc->counters);
 	fbc->counters = NULL;
+	percpu_counter_nodes_free(fbc);
 }
 EXPORT_SYMBOL(percpu_counter_destroy);
 
@@ -189,6 +340,10 @@ static int compute_batch_value(unsigned int cpu)
 	int nr = num_online_cpus();
 
 	percpu_counter_batch = max(32, nr*2);
+#ifdef CONFIG_NUMA
+	WRITE_ONCE(percpu_counter_node_cpus,
+		   DIV_ROUND_UP(nr, max(1U, num_online_nodes())));
+#endif
 	return 0;
 }
 
@@ -75,6 +75,10 @@ const struct raid6_calls * const raid6_algos[] = {
 	&raid6_neonx2,
 	&raid6_neonx1,
 #endif
+#ifdef CONFIG_CPU_LOONGSON2EF
+	&raid6_mmix2,
+	&raid6_mmix1,
+#endif
 #if defined(__ia64__)
 	&raid6_intx32,
 	&raid6_intx16,
@@ -105,6 +109,9 @@ const struct raid6_recov_calls *const raid6_recov_algos[] = {
 #endif
 #if defined(CONFIG_KERNEL_MODE_NEON)
 	&raid6_recov_neon,
+#endif
+#ifdef CONFIG_CPU_LOONGSON2EF
+	&raid6_recov_mmi,
 #endif
 	&raid6_recov_intx1,
 	NULL
@@ -0,0 +1,221 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * raid6/loongson_mmi.c
+ *
+ * RAID-6 syndrome calculation using the Loongson-2F multimedia
+ * instructions, modelled on the MMX code.  Each unrolled lane handles
+ * eight bytes in a 64-bit FPU register:
+ *
+ *	$f0	0x1d1d1d1d1d1d1d1d
+ *	$f6	zero
+ *	$f2/$f12	P
+ *	$f4/$f14	Q
+ *	$f8/$f16	data
+ *	$f10/$f18	temporary
+ */
+
+#include <linux/raid/pq.h>
+#include "loongson_mmi.h"
+
+const u64 raid6_mmi_x1d = 0x1d1d1d1d1d1d1d1dULL;
+
+static inline void raid6_mmi_setup(void)
+{
+	asm volatile(MMI("ldc1	$f0, %0\n\t"
+			 "dmtc1	$0, $f6")
+		     : : "m" (raid6_mmi_x1d));
+}
+
+/*
+ * Unrolled by 1
+ */
+static void raid6_mmi1_gen_syndrome(int disks, size_t bytes, void **ptrs)
+{
+	u8 **dptr = (u8 **)ptrs;
+	u8 *p, *q;
+	int d, z, z0;
+
+	z0 = disks - 3;		/* Highest data disk */
+	p = dptr[z0+1];		/* XOR parity */
+	q = dptr[z0+2];		/* RS syndrome */
+
+	kernel_mmi_begin();
+	raid6_mmi_setup();
+
+	for (d = 0; d < bytes; d += 8) {
+		asm volatile(MMI("ldc1	$f2, %0\n\t"
+				 "mov.d	$f4, $f2")
+			     : : "m" (dptr[z0][d]));
+		for (z = z0-1; z >= 0; z--) {
+			asm volatile(MMI("ldc1	$f8, %0\n\t"
+					 MMI_MUL2("$f4", "$f10") "\n\t"
+					 "xor	$f2, $f2, $f8\n\t"
+					 "xor	$f4, $f4, $f8")
+				     : : "m" (dptr[z][d]));
+		}
+		asm volatile(MMI("sdc1	$f2, %0\n\t"
+				 "sdc1	$f4, %1")
+			     : "=m" (p[d]), "=m" (q[d]));
+	}
+
+	kernel_mmi_end();
+}
+
+static void raid6_mmi1_xor_syndrome(int disks, int start, int stop,
+				    size_t bytes, void **ptrs)
+{
+	u8 **dptr = (u8 **)ptrs;
+	u8 *p, *q;
+	int d, z, z0;
+
+	z0 = stop;		/* P/Q right side optimization */
+	p = dptr[disks-2];	/* XOR parity */
+	q = dptr[disks-1];	/* RS syndrome */
+
+	kernel_mmi_begin();
+	raid6_mmi_setup();
+
+	for (d = 0; d < bytes; d += 8) {
+		asm volatile(MMI("ldc1	$f2, %0\n\t"
+				 "mov.d	$f4, $f2")
+			     : : "m" (dptr[z0][d]));
+		/* P/Q data pages */
+		for (z = z0-1; z >= start; z--) {
+			asm volatile(MMI("ldc1	$f8, %0\n\t"
+					 MMI_MUL2("$f4", "$f10") "\n\t"
+					 "xor	$f2, $f2, $f8\n\t"
+					 "xor	$f4, $f4, $f8")
+				     : : "m" (dptr[z][d]));
+		}
+		/* P/Q left side optimization */
+		for (z = start-1; z >= 0; z--)
+			asm volatile(MMI(MMI_MUL2("$f4", "$f10")));
+		asm volatile(MMI("ldc1	$f8, %2\n\t"
+				 "ldc1	$f10, %3\n\t"
+				 "xor	$f2, $f2, $f8\n\t"
+				 "xor	$f4, $f4, $f10\n\t"
+				 "sdc1	$f2, %0\n\t"
+				 "sdc1	$f4, %1")
+			     : "=m" (p[d]), "=m" (q[d])
+			     : "m" (p[d]), "m" (q[d]));
+	}
+
+	kernel_mmi_end();
+}
+
+const struct raid6_calls raid6_mmix1 = {
+	raid6_mmi1_gen_syndrome,
+	raid6_mmi1_xor_syndrome,
+	raid6_have_mmi,
+	"mmix1",
+	0
+};
+
+/*
+ * Unrolled by 2
+ */
+static void raid6_mmi2_gen_syndrome(int disks, size_t bytes, void **ptrs)
+{
+	u8 **dptr = (u8 **)ptrs;
+	u8 *p, *q;
+	int d, z, z0;
+
+	z0 = disks - 3;		/* Highest data disk */
+	p = dptr[z0+1];		/* XOR parity */
+	q = dptr[z0+2];		/* RS syndrome */
+
+	kernel_mmi_begin();
+	raid6_mmi_setup();
+
+	for (d = 0; d < bytes; d += 16) {
+		asm volatile(MMI("ldc1	$f2, %0\n\t"
+				 "ldc1	$f12, %1\n\t"
+				 "mov.d	$f4, $f2\n\t"
+				 "mov.d	$f14, $f12")
+			     : : "m" (dptr[z0][d]), "m" (dptr[z0][d+8]));
+		for (z = z0-1; z >= 0; z--) {
+			asm volatile(MMI("ldc1	$f8, %0\n\t"
+					 "ldc1	$f16, %1\n\t"
+					 MMI_MUL2("$f4", "$f10") "\n\t"
+					 MMI_MUL2("$f14", "$f18") "\n\t"
+					 "xor	$f2, $f2, $f8\n\t"
+					 "xor	$f12, $f12, $f16\n\t"
+					 "xor	$f4, $f4, $f8\n\t"
+					 "xor	$f14, $f14, $f16")
+				     : : "m" (dptr[z][d]), "m" (dptr[z][d+8]));
+		}
+		asm volatile(MMI("sdc1	$f2, %0\n\t"
+				 "sdc1	$f12, %1\n\t"
+				 "sdc1	$f4, %2\n\t"
+				 "sdc1	$f14, %3")
+			     : "=m" (p[d]), "=m" (p[d+8]),
+			       "=m" (q[d]), "=m" (q[d+8]));
+	}
+
+	kernel_mmi_end();
+}
+
+static void raid6_mmi2_xor_syndrome(int disks, int start, int stop,
+				    size_t bytes, void **ptrs)
+{
+	u8 **dptr = (u8 **)ptrs;
+	u8 *p, *q;
+	int d, z, z0;
+
+	z0 = stop;		/* P/Q right side optimization */
+	p = dptr[disks-2];	/* XOR parity */
+	q = dptr[disks-1];	/* RS syndrome */
+
+	kernel_mmi_begin();
+	raid6_mmi_setup();
+
+	for (d = 0; d < bytes; d += 16) {
+		asm volatile(MMI("ldc1	$f2, %0\n\t"
+				 "ldc1	$f12, %1\n\t"
+				 "mov.d	$f4, $f2\n\t"
+				 "mov.d	$f14, $f12")
+			     : : "m" (dptr[z0][d]), "m" (dptr[z0][d+8]));
+		/* P/Q data pages */
+		for (z = z0-1; z >= start; z--) {
+			asm volatile(MMI("ldc1	$f8, %0\n\t"
+					 "ldc1	$f16, %1\n\t"
+					 MMI_MUL2("$f4", "$f10") "\n\t"
+					 MMI_MUL2("$f14", "$f18") "\n\t"
+					 "xor	$f2, $f2, $f8\n\t"
+					 "xor	$f12, $f12, $f16\n\t"
+					 "xor	$f4, $f4, $f8\n\t"
+					 "xor	$f14, $f14, $f16")
+				     : : "m" (dptr[z][d]), "m" (dptr[z][d+8]));
+		}
+		/* P/Q left side optimization */
+		for (z = start-1; z >= 0; z--)
+			asm volatile(MMI(MMI_MUL2("$f4", "$f10") "\n\t"
+					 MMI_MUL2("$f14", "$f18")));
+		asm volatile(MMI("ldc1	$f8, %4\n\t"
+				 "ldc1	$f16, %5\n\t"
+				 "ldc1	$f10, %6\n\t"
+				 "ldc1	$f18, %7\n\t"
+				 "xor	$f2, $f2, $f8\n\t"
+				 "xor	$f12, $f12, $f16\n\t"
+				 "xor	$f4, $f4, $f10\n\t"
+				 "xor	$f14, $f14, $f18\n\t"
+				 "sdc1	$f2, %0\n\t"
+				 "sdc1	$f12, %1\n\t"
+				 "sdc1	$f4, %2\n\t"
+				 "sdc1	$f14, %3")
+			     : "=m" (p[d]), "=m" (p[d+8]),
+			       "=m" (q[d]), "=m" (q[d+8])
+			     : "m" (p[d]), "m" (p[d+8]),
+			       "m" (q[d]), "m" (q[d+8]));
+	}
+
+	kernel_mmi_end();
+}
+
+const struct raid6_calls raid6_mmix2 = {
+	raid6_mmi2_gen_syndrome,
+	raid6_mmi2_xor_syndrome,
+	raid6_have_mmi,
+	"mmix2",
+	0
+};
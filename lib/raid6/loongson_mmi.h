@@ -0,0 +1,71 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * raid6/loongson_mmi.h
+ *
+ * Definitions common to the Loongson-2F multimedia (MMI) RAID-6 code
+ *
+ * The MMI instructions operate on the 64-bit FPU registers.  The kernel
+ * builds with -msoft-float and never touches them, so any live user FP
+ * context is saved with lose_fpu() and the FPU is enabled for the duration
+ * of the routine with preemption disabled; the task reloads its context
+ * lazily on its next FP instruction.  Only even registers are used so the
+ * code works with either setting of Status.FR.
+ */
+
+#ifndef LINUX_RAID_RAID6LOONGSON_MMI_H
+#define LINUX_RAID_RAID6LOONGSON_MMI_H
+
+#ifdef __KERNEL__
+
+#include <linux/preempt.h>
+#include <asm/cpu-type.h>
+#include <asm/fpu.h>
+#include <asm/hazards.h>
+#include <asm/mipsregs.h>
+
+static inline void kernel_mmi_begin(void)
+{
+	preempt_disable();
+	lose_fpu(1);
+	set_c0_status(ST0_CU1);
+	enable_fpu_hazard();
+}
+
+static inline void kernel_mmi_end(void)
+{
+	clear_c0_status(ST0_CU1);
+	disable_fpu_hazard();
+	preempt_enable();
+}
+
+static inline int raid6_have_mmi(void)
+{
+	return current_cpu_type() == CPU_LOONGSON2EF && cpu_has_fpu;
+}
+
+#else /* Dummy code for user space testing */
+
+#define kernel_mmi_begin()
+#define kernel_mmi_end()
+#define raid6_have_mmi()	(1)
+
+#endif
+
+/* Wrap MMI instructions for the soft-float kernel build */
+#define MMI(insn)						\
+	".set	push\n\t"					\
+	".set	hardfloat\n\t"					\
+	".set	arch=loongson2f\n\t"				\
+	insn "\n\t"						\
+	".set	pop\n\t"
+
+/* Multiply each byte of Q by {02} in GF(2^8): $f0 = 0x1d.., $f6 = 0 */
+#define MMI_MUL2(q, t)						\
+	"pcmpgtb " t ", $f6, " q "\n\t"				\
+	"paddb	" q ", " q ", " q "\n\t"			\
+	"and	" t ", " t ", $f0\n\t"				\
+	"xor	" q ", " q ", " t
+
+extern const u64 raid6_mmi_x1d;
+
+#endif /* LINUX_RAID_RAID6LOONGSON_MMI_H */
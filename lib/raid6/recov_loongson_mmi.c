@@ -0,0 +1,149 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * RAID-6 data recovery using the Loongson-2F multimedia instructions
+ *
+ * There is no byte shuffle in the 2F MMI set, so the multiplier tables
+ * used by the SSSE3 and NEON code cannot be applied eight bytes at a
+ * time.  Multiplication by the (constant) recovery coefficient is done
+ * by shift-and-add instead: the data is repeatedly doubled in GF(2^8)
+ * and accumulated for every set bit of the coefficient.
+ */
+
+#include <linux/raid/pq.h>
+#include "loongson_mmi.h"
+
+/* $f2 = c * $f8, clobbers $f8 and $f10 */
+static inline void raid6_mmi_gfmul(u8 c)
+{
+	asm volatile(MMI("dmtc1	$0, $f2"));
+	for (;;) {
+		if (c & 1)
+			asm volatile(MMI("xor	$f2, $f2, $f8"));
+		c >>= 1;
+		if (!c)
+			break;
+		asm volatile(MMI(MMI_MUL2("$f8", "$f10")));
+	}
+}
+
+static void raid6_2data_recov_mmi(int disks, size_t bytes, int faila,
+		int failb, void **ptrs)
+{
+	u8 *p, *q, *dp, *dq;
+	u8 pbc, qc;		/* P coefficient for B data, Q coefficient */
+	size_t d;
+
+	p = (u8 *)ptrs[disks - 2];
+	q = (u8 *)ptrs[disks - 1];
+
+	/*
+	 * Compute syndrome with zero for the missing data pages
+	 * Use the dead data pages as temporary storage for
+	 * delta p and delta q
+	 */
+	dp = (u8 *)ptrs[faila];
+	ptrs[faila] = (void *)raid6_empty_zero_page;
+	ptrs[disks - 2] = dp;
+	dq = (u8 *)ptrs[failb];
+	ptrs[failb] = (void *)raid6_empty_zero_page;
+	ptrs[disks - 1] = dq;
+
+	raid6_call.gen_syndrome(disks, bytes, ptrs);
+
+	/* Restore pointer table */
+	ptrs[faila]     = dp;
+	ptrs[failb]     = dq;
+	ptrs[disks - 2] = p;
+	ptrs[disks - 1] = q;
+
+	/* Now, pick the proper coefficients */
+	pbc = raid6_gfexi[failb - faila];
+	qc  = raid6_gfinv[raid6_gfexp[faila] ^ raid6_gfexp[failb]];
+
+	kernel_mmi_begin();
+	asm volatile(MMI("ldc1	$f0, %0\n\t"
+			 "dmtc1	$0, $f6")
+		     : : "m" (raid6_mmi_x1d));
+
+	for (d = 0; d < bytes; d += 8) {
+		/* $f12 = px, $f8 = q ^ dq */
+		asm volatile(MMI("ldc1	$f12, %0\n\t"
+				 "ldc1	$f8, %1\n\t"
+				 "xor	$f12, $f12, $f8\n\t"
+				 "ldc1	$f8, %2\n\t"
+				 "ldc1	$f10, %3\n\t"
+				 "xor	$f8, $f8, $f10")
+			     : : "m" (p[d]), "m" (dp[d]),
+				 "m" (q[d]), "m" (dq[d]));
+		/* $f14 = qx */
+		raid6_mmi_gfmul(qc);
+		asm volatile(MMI("mov.d	$f14, $f2\n\t"
+				 "mov.d	$f8, $f12"));
+		/* db = pbmul[px] ^ qx, da = db ^ px */
+		raid6_mmi_gfmul(pbc);
+		asm volatile(MMI("xor	$f2, $f2, $f14\n\t"
+				 "xor	$f12, $f12, $f2\n\t"
+				 "sdc1	$f2, %0\n\t"
+				 "sdc1	$f12, %1")
+			     : "=m" (dq[d]), "=m" (dp[d]));
+	}
+
+	kernel_mmi_end();
+}
+
+static void raid6_datap_recov_mmi(int disks, size_t bytes, int faila,
+		void **ptrs)
+{
+	u8 *p, *q, *dq;
+	u8 qc;			/* Q coefficient */
+	size_t d;
+
+	p = (u8 *)ptrs[disks - 2];
+	q = (u8 *)ptrs[disks - 1];
+
+	/*
+	 * Compute syndrome with zero for the missing data page
+	 * Use the dead data page as temporary storage for delta q
+	 */
+	dq = (u8 *)ptrs[faila];
+	ptrs[faila] = (void *)raid6_empty_zero_page;
+	ptrs[disks - 1] = dq;
+
+	raid6_call.gen_syndrome(disks, bytes, ptrs);
+
+	/* Restore pointer table */
+	ptrs[faila]     = dq;
+	ptrs[disks - 1] = q;
+
+	/* Now, pick the proper coefficient */
+	qc = raid6_gfinv[raid6_gfexp[faila]];
+
+	kernel_mmi_begin();
+	asm volatile(MMI("ldc1	$f0, %0\n\t"
+			 "dmtc1	$0, $f6")
+		     : : "m" (raid6_mmi_x1d));
+
+	for (d = 0; d < bytes; d += 8) {
+		asm volatile(MMI("ldc1	$f8, %0\n\t"
+				 "ldc1	$f10, %1\n\t"
+				 "xor	$f8, $f8, $f10")
+			     : : "m" (q[d]), "m" (dq[d]));
+		raid6_mmi_gfmul(qc);
+		asm volatile(MMI("ldc1	$f12, %2\n\t"
+				 "xor	$f12, $f12, $f2\n\t"
+				 "sdc1	$f2, %0\n\t"
+				 "sdc1	$f12, %1")
+			     : "=m" (dq[d]), "=m" (p[d])
+			     : "m" (p[d]));
+	}
+
+	kernel_mmi_end();
+}
+
+const struct raid6_recov_calls raid6_recov_mmi = {
+	.data2		= raid6_2data_recov_mmi,
+	.datap		= raid6_datap_recov_mmi,
+	.valid		= raid6_have_mmi,
+	.name		= "mmi",
+	.priority	= 1,
+};
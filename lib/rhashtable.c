@@ -25,10 +25,15 @@
 #include <linux/rhashtable.h>
 #include <linux/err.h>
 #include <linux/export.h>
+#include <linux/workqueue.h>
 
 #define HASH_DEFAULT_SIZE	64UL
 #define HASH_MIN_SIZE		4U
 
+/* Tables with at least this many buckets per worker are rehashed in parallel */
+#define REHASH_PARALLEL_MIN	(1U << 16)
+#define REHASH_MAX_WORKERS	16U
+
 union nested_table {
 	union nested_table __rcu *table;
 	struct rhash_lock_head __rcu *bucket;
@@ -222,10 +227,10 @@ static struct bucket_table *rhashtable_last_table(struct rhashtable *ht,
 }
 
 static int rhashtable_rehash_one(struct rhashtable *ht,
+				 struct bucket_table *old_tbl,
 				 struct rhash_lock_head __rcu **bkt,
 				 unsigned int old_hash)
 {
-	struct bucket_table *old_tbl = rht_dereference(ht->tbl, ht);
 	struct bucket_table *new_tbl = rhashtable_last_table(ht, old_tbl);
 	int err = -EAGAIN;
 	struct rhash_head *head, *next, *entry;
@@ -272,9 +277,9 @@ static int rhashtable_rehash_one(struct rhashtable *ht,
 }
 
 static int rhashtable_rehash_chain(struct rhashtable *ht,
-				    unsigned int old_hash)
+				   struct bucket_table *old_tbl,
+				   unsigned int old_hash)
 {
-	struct bucket_table *old_tbl = rht_dereference(ht->tbl, ht);
 	struct rhash_lock_head __rcu **bkt = rht_bucket_var(old_tbl, old_hash);
 	int err;
 
@@ -282,7 +287,7 @@ static int rhashtable_rehash_chain(struct rhashtable *ht,
 		return 0;
 	rht_lock(old_tbl, bkt);
 
-	while (!(err = rhashtable_rehash_one(ht, bkt, old_hash)))
+	while (!(err = rhashtable_rehash_one(ht, old_tbl, bkt, old_hash)))
 		;
 
 	if (err == -ENOENT)
@@ -292,6 +297,80 @@ static int rhashtable_rehash_chain(struct rhashtable *ht,
 	return err;
 }
 
+struct rhashtable_rehash_work {
+	struct work_struct work;
+	struct rhashtable *ht;
+	struct bucket_table *old_tbl;
+	unsigned int start;
+	unsigned int end;
+	int err;
+};
+
+static void rhashtable_rehash_range(struct work_struct *work)
+{
+	struct rhashtable_rehash_work *rw =
+		container_of(work, struct rhashtable_rehash_work, work);
+	unsigned int old_hash;
+
+	for (old_hash = rw->start; old_hash < rw->end; old_hash++) {
+		/*
+		 * ht->mutex is held by the deferred worker waiting for us,
+		 * so lockdep needs RCU to accept the future_tbl walk.
+		 */
+		rcu_read_lock();
+		rw->err = rhashtable_rehash_chain(rw->ht, rw->old_tbl, old_hash);
+		rcu_read_unlock();
+		if (rw->err)
+			return;
+		cond_resched();
+	}
+}
+
+/*
+ * Chains are moved under their own bucket locks, so disjoint bucket ranges
+ * of a large table can be moved by several workers at once.
+ */
+static int rhashtable_rehash_buckets(struct rhashtable *ht,
+				     struct bucket_table *old_tbl)
+{
+	struct rhashtable_rehash_work *rw;
+	unsigned int nr, i, chunk;
+	int err = 0;
+
+	nr = min3(num_online_cpus(), old_tbl->size / REHASH_PARALLEL_MIN,
+		  REHASH_MAX_WORKERS);
+	rw = nr > 1 ? kmalloc_array(nr, sizeof(*rw), GFP_KERNEL) : NULL;
+	if (!rw) {
+		struct rhashtable_rehash_work one = {
+			.ht = ht,
+			.old_tbl = old_tbl,
+			.end = old_tbl->size,
+		};
+
+		rhashtable_rehash_range(&one.work);
+		return one.err;
+	}
+
+	chunk = DIV_ROUND_UP(old_tbl->size, nr);
+	for (i = 0; i < nr; i++) {
+		INIT_WORK(&rw[i].work, rhashtable_rehash_range);
+		rw[i].ht = ht;
+		rw[i].old_tbl = old_tbl;
+		rw[i].start = i * chunk;
+		rw[i].end = min(old_tbl->size, (i + 1) * chunk);
+		rw[i].err = 0;
+		queue_work(system_unbound_wq, &rw[i].work);
+	}
+
+	for (i = 0; i < nr; i++) {
+		flush_work(&rw[i].work);
+		err = err ?: rw[i].err;
+	}
+	kfree(rw);
+
+	return err;
+}
+
 static int rhashtable_rehash_attach(struct rhashtable *ht,
 				    struct bucket_table *old_tbl,
 				    struct bucket_table *new_tbl)
@@ -314,19 +393,15 @@ static int rhashtable_rehash_table(struct rhashtable *ht)
 	struct bucket_table *old_tbl = rht_dereference(ht->tbl, ht);
 	struct bucket_table *new_tbl;
 	struct rhashtable_walker *walker;
-	unsigned int old_hash;
 	int err;
 
 	new_tbl = rht_dereference(old_tbl->future_tbl, ht);
 	if (!new_tbl)
 		return 0;
 
-	for (old_hash = 0; old_hash < old_tbl->size; old_hash++) {
-		err = rhashtable_rehash_chain(ht, old_hash);
-		if (err)
-			return err;
-		cond_resched();
-	}
+	err = rhashtable_rehash_buckets(ht, old_tbl);
+	if (err)
+		return err;
 
 	/* Publish the new table pointer. */
 	rcu_assign_pointer(ht->tbl, new_tbl);
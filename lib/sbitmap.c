@@ -480,6 +480,58 @@ int __sbitmap_queue_get_shallow(struct sbitmap_queue *sbq,
 }
 EXPORT_SYMBOL_GPL(__sbitmap_queue_get_shallow);
 
+unsigned long __sbitmap_queue_get_batch(struct sbitmap_queue *sbq, int nr_tags,
+					unsigned int *offset)
+{
+	struct sbitmap *sb = &sbq->sb;
+	unsigned int hint, depth, index, i;
+
+	if (unlikely(sbq->round_robin || nr_tags <= 0))
+		return 0;
+	nr_tags = min(nr_tags, BITS_PER_LONG - 1);
+
+	hint = this_cpu_read(*sbq->alloc_hint);
+	depth = READ_ONCE(sb->depth);
+	if (unlikely(hint >= depth)) {
+		hint = depth ? prandom_u32() % depth : 0;
+		this_cpu_write(*sbq->alloc_hint, hint);
+	}
+	index = SB_NR_TO_INDEX(sb, hint);
+
+	for (i = 0; i < sb->map_nr; i++) {
+		struct sbitmap_word *map = &sb->map[index];
+		unsigned long nr, mask, val, ret;
+
+		sbitmap_deferred_clear(sb, index);
+		nr = find_first_zero_bit(&map->word, map->depth);
+		if (nr + nr_tags <= map->depth) {
+			mask = ((1UL << nr_tags) - 1) << nr;
+			do {
+				val = READ_ONCE(map->word);
+				ret = cmpxchg(&map->word, val, val | mask);
+			} while (ret != val);
+
+			/* Keep only the bits nobody else got to first */
+			mask = (mask & ~val) >> nr;
+			if (mask) {
+				*offset = nr + (index << sb->shift);
+				hint = *offset + fls_long(mask);
+				if (hint >= depth - 1)
+					hint = 0;
+				this_cpu_write(*sbq->alloc_hint, hint);
+				return mask;
+			}
+		}
+
+		/* Jump to next index. */
+		if (++index >= sb->map_nr)
+			index = 0;
+	}
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(__sbitmap_queue_get_batch);
+
 void sbitmap_queue_min_shallow_depth(struct sbitmap_queue *sbq,
 				     unsigned int min_shallow_depth)
 {
@@ -511,17 +563,25 @@ static struct sbq_wait_state *sbq_wake_ptr(struct sbitmap_queue *sbq)
 	return NULL;
 }
 
-static bool __sbq_wake_up(struct sbitmap_queue *sbq)
+/*
+ * Credit up to *nr freed bits to the next active wait queue, waking a batch
+ * of waiters once its count runs out. Returns true if the caller should call
+ * again, either to retry a lost race or to hand the credit that was left over
+ * after a wakeup to the next wait queue, so a batch of frees doesn't leave
+ * waiters sleeping.
+ */
+static bool __sbq_wake_up(struct sbitmap_queue *sbq, int *nr)
 {
 	struct sbq_wait_state *ws;
 	unsigned int wake_batch;
-	int wait_cnt;
+	int wait_cnt, sub;
 
 	ws = sbq_wake_ptr(sbq);
 	if (!ws)
 		return false;
 
-	wait_cnt = atomic_dec_return(&ws->wait_cnt);
+	sub = min_t(int, *nr, READ_ONCE(sbq->wake_batch));
+	wait_cnt = atomic_sub_return(sub, &ws->wait_cnt);
 	if (wait_cnt <= 0) {
 		int ret;
 
@@ -543,20 +603,28 @@ static bool __sbq_wake_up(struct sbitmap_queue *sbq)
 		if (ret == wait_cnt) {
 			sbq_index_atomic_inc(&sbq->wake_index);
 			wake_up_nr(&ws->wait, wake_batch);
-			return false;
+			/* The bits past the end of this batch go to the next */
+			*nr -= max(sub + wait_cnt, 1);
+			return *nr > 0;
 		}
 
 		return true;
 	}
 
-	return false;
+	*nr -= sub;
+	return *nr > 0;
 }
 
-void sbitmap_queue_wake_up(struct sbitmap_queue *sbq)
+static void __sbitmap_queue_wake_up(struct sbitmap_queue *sbq, int nr)
 {
-	while (__sbq_wake_up(sbq))
+	while (__sbq_wake_up(sbq, &nr))
 		;
 }
+
+void sbitmap_queue_wake_up(struct sbitmap_queue *sbq)
+{
+	__sbitmap_queue_wake_up(sbq, 1);
+}
 EXPORT_SYMBOL_GPL(sbitmap_queue_wake_up);
 
 void sbitmap_queue_clear(struct sbitmap_queue *sbq, unsigned int nr,
@@ -589,6 +657,44 @@ void sbitmap_queue_clear(struct sbitmap_queue *sbq, unsigned int nr,
 }
 EXPORT_SYMBOL_GPL(sbitmap_queue_clear);
 
+void sbitmap_queue_clear_batch(struct sbitmap_queue *sbq, int offset,
+			       int *tags, int nr_tags)
+{
+	struct sbitmap *sb = &sbq->sb;
+	unsigned long *addr = NULL;
+	unsigned long mask = 0;
+	int i;
+
+	/* Pairs with the barrier in __sbitmap_get_word(), see above */
+	smp_mb__before_atomic();
+	for (i = 0; i < nr_tags; i++) {
+		const int tag = tags[i] - offset;
+		unsigned long *this_addr;
+
+		/* The batch is freed directly, skipping the deferred word */
+		this_addr = &sb->map[SB_NR_TO_INDEX(sb, tag)].word;
+		if (addr && addr != this_addr) {
+			atomic_long_andnot(mask, (atomic_long_t *)addr);
+			mask = 0;
+		}
+		addr = this_addr;
+		mask |= 1UL << SB_NR_TO_BIT(sb, tag);
+	}
+
+	if (mask)
+		atomic_long_andnot(mask, (atomic_long_t *)addr);
+
+	/* Pairs with set_current_state() in the waiter, see above */
+	smp_mb__after_atomic();
+	__sbitmap_queue_wake_up(sbq, nr_tags);
+
+	if (likely(!sbq->round_robin && nr_tags &&
+		   tags[nr_tags - 1] - offset < sb->depth))
+		*per_cpu_ptr(sbq->alloc_hint, raw_smp_processor_id()) =
+			tags[nr_tags - 1] - offset;
+}
+EXPORT_SYMBOL_GPL(sbitmap_queue_clear_batch);
+
 void sbitmap_queue_wake_all(struct sbitmap_queue *sbq)
 {
 	int i, wake_index;
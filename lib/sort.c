@@ -14,6 +14,9 @@
 
 #include <linux/types.h>
 #include <linux/export.h>
+#include <linux/errno.h>
+#include <linux/mm.h>
+#include <linux/slab.h>
 #include <linux/sort.h>
 
 /**
@@ -270,3 +273,89 @@ void sort(void *base, size_t num, size_t size,
 	return sort_r(base, num, size, _CMP_WRAPPER, swap_func, cmp_func);
 }
 EXPORT_SYMBOL(sort);
+
+/**
+ * sort_by_key - sort an array of elements by an integer key
+ * @base: pointer to data to sort
+ * @num: number of elements
+ * @size: size of each element
+ * @key_func: returns the unsigned sort key of an element
+ * @gfp: allocation flags for the scratch space
+ *
+ * This function does a stable LSD radix sort, one byte of the key per
+ * pass, so it runs in O(n) and never calls a comparison function.  Key
+ * bytes that are the same for every element are skipped, so small keys
+ * only cost as many passes as they have significant bytes.  Elements are
+ * moved with memcpy(), so they must not need fixing up when moved.
+ *
+ * Scratch space for a copy of the array and its keys is allocated with
+ * @gfp.  Returns 0 on success, or -ENOMEM if it could not be allocated,
+ * in which case the array is left untouched.
+ */
+int sort_by_key(void *base, size_t num, size_t size,
+		u64 (*key_func)(const void *elem), gfp_t gfp)
+{
+	u64 *keys, *src_keys, *dst_keys, diff = 0;
+	void *tmp, *src, *dst;
+	unsigned int shift;
+	size_t *count;
+	size_t i;
+
+	if (num < 2 || !size)
+		return 0;
+
+	keys = kvmalloc_array(2 * num, sizeof(*keys), gfp);
+	tmp = kvmalloc_array(num, size, gfp);
+	count = kmalloc_array(256, sizeof(*count), gfp);
+	if (!keys || !tmp || !count) {
+		kvfree(keys);
+		kvfree(tmp);
+		kfree(count);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < num; i++) {
+		keys[i] = key_func(base + i * size);
+		diff |= keys[i] ^ keys[0];
+	}
+
+	src = base;
+	dst = tmp;
+	src_keys = keys;
+	dst_keys = keys + num;
+	for (shift = 0; shift < 64 && (diff >> shift); shift += 8) {
+		size_t pos = 0;
+
+		/* All keys share this byte, the pass would not move anything */
+		if (!((diff >> shift) & 0xff))
+			continue;
+
+		memset(count, 0, 256 * sizeof(*count));
+		for (i = 0; i < num; i++)
+			count[(src_keys[i] >> shift) & 0xff]++;
+		for (i = 0; i < 256; i++) {
+			size_t c = count[i];
+
+			count[i] = pos;
+			pos += c;
+		}
+		for (i = 0; i < num; i++) {
+			size_t j = count[(src_keys[i] >> shift) & 0xff]++;
+
+			dst_keys[j] = src_keys[i];
+			memcpy(dst + j * size, src + i * size, size);
+		}
+
+		swap(src, dst);
+		swap(src_keys, dst_keys);
+	}
+
+	if (src != base)
+		memcpy(base, src, num * size);
+
+	kvfree(keys);
+	kvfree(tmp);
+	kfree(count);
+	return 0;
+}
+EXPORT_SYMBOL(sort_by_key);
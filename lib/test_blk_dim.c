@@ -0,0 +1,89 @@
+// SPDX-License-Identifier: GPL-2.0-only
+#define pr_fmt(fmt) "blk_dim_test: " fmt
+
+/*
+ * Test cases for the low queue depth handling of blk_dim(): a moderated
+ * queue seeing a single completion per interrupt must go back to the
+ * unmoderated profile and park there for a while, and the unmoderated
+ * profile must not keep itself parked.
+ */
+
+#include <linux/delay.h>
+#include <linux/dim.h>
+#include <linux/init.h>
+#include <linux/printk.h>
+
+static void test_blk_dim_work(struct work_struct *work)
+{
+}
+
+/* Feed interrupts of @comps completions until blk_dim() takes a decision */
+static void __init run_window(struct dim *dim, u64 comps)
+{
+	u16 start;
+	int i;
+
+	if (dim->state == DIM_START_MEASURE)
+		blk_dim(dim, comps, comps * 4096);
+
+	start = dim->start_sample.event_ctr;
+	for (i = 0; i < 2 * DIM_NEVENTS; i++) {
+		/* dim_calc_stats() needs time to pass */
+		udelay(1);
+		blk_dim(dim, comps, comps * 4096);
+		if (dim->state == DIM_APPLY_NEW_PROFILE ||
+		    dim->start_sample.event_ctr != start)
+			return;
+	}
+}
+
+static int __init test_blk_dim_init(void)
+{
+	struct dim dim = {};
+	unsigned int park, i;
+	int err = -EINVAL;
+
+	INIT_WORK_ONSTACK(&dim.work, test_blk_dim_work);
+
+	/* low depth on a moderated queue: straight back to profile 0 */
+	dim.profile_ix = 3;
+	dim.tune_state = DIM_GOING_RIGHT;
+	run_window(&dim, 1);
+	flush_work(&dim.work);
+	if (dim.state != DIM_APPLY_NEW_PROFILE || dim.profile_ix != 0 ||
+	    dim.tune_state != DIM_PARKING_TIRED || !dim.tired) {
+		pr_err("no reset to profile 0 at low depth\n");
+		goto out;
+	}
+
+	/* parked: deep queues don't move it until the parking is over */
+	park = dim.tired;
+	dim.state = DIM_START_MEASURE;
+	for (i = 0; i < park; i++) {
+		run_window(&dim, 16);
+		if (dim.state == DIM_APPLY_NEW_PROFILE || dim.profile_ix != 0) {
+			pr_err("moved while parked after %u windows\n", i);
+			goto out;
+		}
+	}
+	if (dim.tune_state != DIM_GOING_RIGHT) {
+		pr_err("still parked after %u windows\n", park);
+		goto out;
+	}
+
+	/* profile 0 always sees low depth, which must not park it again */
+	run_window(&dim, 1);
+	flush_work(&dim.work);
+	if (dim.tune_state == DIM_PARKING_TIRED) {
+		pr_err("profile 0 parked itself\n");
+		goto out;
+	}
+
+	pr_info("test passed\n");
+	err = 0;
+out:
+	flush_work(&dim.work);
+	destroy_work_on_stack(&dim.work);
+	return err;
+}
+late_initcall(test_blk_dim_init);
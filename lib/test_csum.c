@@ -0,0 +1,184 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Test and microbenchmark for csum_partial() and csum_partial_copy_nocheck()
+ *
+ * The architecture routines are checked against a byte-wise reference
+ * over a range of lengths and alignments, then timed on cache-hot
+ * buffers.  The fused copy+checksum is compared with a memcpy() followed
+ * by csum_partial(), which is what a driver falls back to otherwise.
+ */
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/module.h>
+#include <linux/random.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+
+#include <asm/byteorder.h>
+#include <asm/checksum.h>
+
+#define TEST_CSUM_BUF	(64 * 1024 + 16)
+#define TEST_CSUM_LOOPS	256
+
+static unsigned int bench_loops = TEST_CSUM_LOOPS;
+module_param(bench_loops, uint, 0444);
+MODULE_PARM_DESC(bench_loops, "iterations per benchmark size");
+
+static const unsigned int bench_sizes[] = { 20, 64, 576, 1500, 4096, 65536 };
+
+static u16 ref_csum(const u8 *buf, unsigned int len)
+{
+	u64 sum = 0;
+	unsigned int i;
+
+	for (i = 0; i + 1 < len; i += 2) {
+#ifdef __BIG_ENDIAN
+		sum += (buf[i] << 8) | buf[i + 1];
+#else
+		sum += buf[i] | (buf[i + 1] << 8);
+#endif
+	}
+	if (len & 1) {
+#ifdef __BIG_ENDIAN
+		sum += buf[len - 1] << 8;
+#else
+		sum += buf[len - 1];
+#endif
+	}
+
+	while (sum >> 16)
+		sum = (sum & 0xffff) + (sum >> 16);
+
+	return sum;
+}
+
+static u16 arch_csum(__wsum csum)
+{
+	return (__force u16)~csum_fold(csum);
+}
+
+static int __init test_csum_correctness(u8 *src, u8 *dst)
+{
+	unsigned int len, align, failed = 0;
+	u16 ref;
+
+	for (align = 0; align < 8; align++) {
+		for (len = 0; len < 1600; len += (len < 300) ? 1 : 37) {
+			ref = ref_csum(src + align, len);
+
+			if (arch_csum(csum_partial(src + align, len, 0)) != ref) {
+				pr_err("csum_partial len %u align %u\n",
+				       len, align);
+				failed++;
+			}
+
+			memset(dst, 0, len + 16);
+			if (arch_csum(csum_partial_copy_nocheck(src + align,
+						dst + (align ^ 3), len, 0)) != ref ||
+			    memcmp(src + align, dst + (align ^ 3), len)) {
+				pr_err("csum_partial_copy_nocheck len %u align %u\n",
+				       len, align);
+				failed++;
+			}
+		}
+	}
+
+	return failed;
+}
+
+static u64 __init bench_csum(const u8 *src, unsigned int len)
+{
+	__wsum sum = 0;
+	u64 t;
+	int i;
+
+	t = ktime_get_ns();
+	for (i = 0; i < bench_loops; i++)
+		sum = csum_partial(src, len, sum);
+	t = ktime_get_ns() - t;
+
+	/* keep the compiler from dropping the loop */
+	WRITE_ONCE(sum, sum);
+	return t;
+}
+
+static u64 __init bench_copy_csum(const u8 *src, u8 *dst, unsigned int len,
+				  bool fused)
+{
+	__wsum sum = 0;
+	u64 t;
+	int i;
+
+	t = ktime_get_ns();
+	for (i = 0; i < bench_loops; i++) {
+		if (fused) {
+			sum = csum_partial_copy_nocheck(src, dst, len, sum);
+		} else {
+			memcpy(dst, src, len);
+			sum = csum_partial(dst, len, sum);
+		}
+	}
+	t = ktime_get_ns() - t;
+
+	WRITE_ONCE(sum, sum);
+	return t;
+}
+
+static unsigned int mbps(unsigned int len, u64 ns)
+{
+	return div64_u64((u64)len * bench_loops * 1000, max_t(u64, ns, 1));
+}
+
+static int __init test_csum_init(void)
+{
+	u8 *src, *dst;
+	unsigned int i, len;
+	int failed;
+
+	src = kmalloc(TEST_CSUM_BUF, GFP_KERNEL);
+	dst = kmalloc(TEST_CSUM_BUF, GFP_KERNEL);
+	if (!src || !dst) {
+		kfree(src);
+		kfree(dst);
+		return -ENOMEM;
+	}
+
+	prandom_bytes(src, TEST_CSUM_BUF);
+
+	failed = test_csum_correctness(src, dst);
+	if (failed) {
+		pr_err("%d checksum mismatches\n", failed);
+		goto out;
+	}
+	pr_info("csum_partial and csum_partial_copy_nocheck match reference\n");
+
+	if (!bench_loops)
+		goto out;
+
+	for (i = 0; i < ARRAY_SIZE(bench_sizes); i++) {
+		len = bench_sizes[i];
+		pr_info("%6u bytes: csum %u MB/s, copy+csum %u MB/s, memcpy+csum %u MB/s\n",
+			len, mbps(len, bench_csum(src, len)),
+			mbps(len, bench_copy_csum(src, dst, len, true)),
+			mbps(len, bench_copy_csum(src, dst, len, false)));
+	}
+
+out:
+	kfree(src);
+	kfree(dst);
+
+	return failed ? -EINVAL : 0;
+}
+
+static void __exit test_csum_exit(void)
+{
+}
+
+module_init(test_csum_init);
+module_exit(test_csum_exit);
+
+MODULE_DESCRIPTION("IP checksum routine test and benchmark");
+MODULE_LICENSE("GPL");
@@ -29,6 +29,9 @@ struct debug_el {
 /* Array, containing pointers to all elements in the test list */
 static struct debug_el **elts __initdata;
 
+/* Number of calls to cmp() */
+static unsigned long cmp_count __initdata;
+
 static int __init check(struct debug_el *ela, struct debug_el *elb)
 {
 	if (ela->serial >= TEST_LIST_LEN) {
@@ -64,40 +67,17 @@ static int __init cmp(void *priv, struct list_head *a, struct list_head *b)
 	elb = container_of(b, struct debug_el, list);
 
 	check(ela, elb);
+	cmp_count++;
 	return ela->value - elb->value;
 }
 
-static int __init list_sort_test(void)
+static int __init list_sort_verify(struct list_head *head)
 {
-	int i, count = 1, err = -ENOMEM;
+	int count = 1, err = -EINVAL;
 	struct debug_el *el;
 	struct list_head *cur;
-	LIST_HEAD(head);
-
-	pr_debug("start testing list_sort()\n");
 
-	elts = kcalloc(TEST_LIST_LEN, sizeof(*elts), GFP_KERNEL);
-	if (!elts)
-		return err;
-
-	for (i = 0; i < TEST_LIST_LEN; i++) {
-		el = kmalloc(sizeof(*el), GFP_KERNEL);
-		if (!el)
-			goto exit;
-
-		 /* force some equivalencies */
-		el->value = prandom_u32() % (TEST_LIST_LEN / 3);
-		el->serial = i;
-		el->poison1 = TEST_POISON1;
-		el->poison2 = TEST_POISON2;
-		elts[i] = el;
-		list_add_tail(&el->list, &head);
-	}
-
-	list_sort(NULL, &head, cmp);
-
-	err = -EINVAL;
-	for (cur = head.next; cur->next != &head; cur = cur->next) {
+	for (cur = head->next; cur->next != head; cur = cur->next) {
 		struct debug_el *el1;
 		int cmp_result;
 
@@ -126,7 +106,7 @@ static int __init list_sort_test(void)
 		}
 		count++;
 	}
-	if (head.prev != cur) {
+	if (head->prev != cur) {
 		pr_err("error: list is corrupted\n");
 		goto exit;
 	}
@@ -138,6 +118,89 @@ static int __init list_sort_test(void)
 	}
 
 	err = 0;
+exit:
+	return err;
+}
+
+/* Relink the elements in serial order, as they were first added */
+static void __init list_sort_reset(struct list_head *head)
+{
+	int i;
+
+	INIT_LIST_HEAD(head);
+	for (i = 0; i < TEST_LIST_LEN; i++)
+		list_add_tail(&elts[i]->list, head);
+}
+
+static int __init list_sort_runs_test(struct list_head *head)
+{
+	unsigned long plain, runs;
+	int i, err;
+
+	/* Sorted input with every 64th element out of place */
+	for (i = 0; i < TEST_LIST_LEN; i++)
+		elts[i]->value = i % 64 ? i : prandom_u32() % TEST_LIST_LEN;
+
+	list_sort_reset(head);
+	cmp_count = 0;
+	list_sort(NULL, head, cmp);
+	plain = cmp_count;
+	err = list_sort_verify(head);
+	if (err)
+		return err;
+
+	list_sort_reset(head);
+	cmp_count = 0;
+	list_sort_runs(NULL, head, cmp);
+	runs = cmp_count;
+	err = list_sort_verify(head);
+	if (err)
+		return err;
+
+	pr_info("nearly sorted list: %lu compares, %lu with list_sort_runs()\n",
+		plain, runs);
+	return 0;
+}
+
+static int __init list_sort_test(void)
+{
+	int i, err = -ENOMEM;
+	struct debug_el *el;
+	LIST_HEAD(head);
+
+	pr_debug("start testing list_sort()\n");
+
+	elts = kcalloc(TEST_LIST_LEN, sizeof(*elts), GFP_KERNEL);
+	if (!elts)
+		return err;
+
+	for (i = 0; i < TEST_LIST_LEN; i++) {
+		el = kmalloc(sizeof(*el), GFP_KERNEL);
+		if (!el)
+			goto exit;
+
+		 /* force some equivalencies */
+		el->value = prandom_u32() % (TEST_LIST_LEN / 3);
+		el->serial = i;
+		el->poison1 = TEST_POISON1;
+		el->poison2 = TEST_POISON2;
+		elts[i] = el;
+		list_add_tail(&el->list, &head);
+	}
+
+	list_sort(NULL, &head, cmp);
+	err = list_sort_verify(&head);
+	if (err)
+		goto exit;
+
+	/* The same random input again, consumed in runs */
+	list_sort_reset(&head);
+	list_sort_runs(NULL, &head, cmp);
+	err = list_sort_verify(&head);
+	if (err)
+		goto exit;
+
+	err = list_sort_runs_test(&head);
 exit:
 	for (i = 0; i < TEST_LIST_LEN; i++)
 		kfree(elts[i]);
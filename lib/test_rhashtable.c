@@ -205,13 +205,28 @@ static void test_bucket_stats(struct rhashtable *ht, unsigned int entries)
 		pr_warn("Test failed: Total count mismatch ^^^");
 }
 
+/* Is a rehash to a new bucket table in progress? */
+static bool __init test_rht_resizing(struct rhashtable *ht)
+{
+	struct bucket_table *tbl;
+	bool ret;
+
+	rcu_read_lock();
+	tbl = rcu_dereference(ht->tbl);
+	ret = rcu_access_pointer(tbl->future_tbl) != NULL;
+	rcu_read_unlock();
+
+	return ret;
+}
+
 static s64 __init test_rhashtable(struct rhashtable *ht, struct test_obj *array,
 				  unsigned int entries)
 {
 	struct test_obj *obj;
 	int err;
-	unsigned int i, insert_retries = 0;
-	s64 start, end;
+	unsigned int i, insert_retries = 0, resize_inserts = 0;
+	s64 start, end, t, lat, total_lat = 0, max_lat = 0;
+	s64 resize_lat = 0, resize_max_lat = 0;
 
 	/*
 	 * Insertion Test:
@@ -223,17 +238,34 @@ static s64 __init test_rhashtable(struct rhashtable *ht, struct test_obj *array,
 		struct test_obj *obj = &array[i];
 
 		obj->value.id = i * 2;
+		t = ktime_get_ns();
 		err = insert_retry(ht, obj, test_rht_params);
+		lat = ktime_get_ns() - t;
 		if (err > 0)
 			insert_retries += err;
 		else if (err)
 			return err;
+
+		total_lat += lat;
+		max_lat = max(max_lat, lat);
+		if (test_rht_resizing(ht)) {
+			resize_inserts++;
+			resize_lat += lat;
+			resize_max_lat = max(resize_max_lat, lat);
+		}
 	}
 
 	if (insert_retries)
 		pr_info("  %u insertions retried due to memory pressure\n",
 			insert_retries);
 
+	pr_info("  Insert latency: avg %lld ns, max %lld ns\n",
+		div_s64(total_lat, entries ?: 1), max_lat);
+	if (resize_inserts)
+		pr_info("  Insert latency during resize: %u inserts, avg %lld ns, max %lld ns\n",
+			resize_inserts, div_s64(resize_lat, resize_inserts),
+			resize_max_lat);
+
 	test_bucket_stats(ht, entries);
 	rcu_read_lock();
 	test_rht_lookup(ht, array, entries);
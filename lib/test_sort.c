@@ -2,16 +2,79 @@
 #include <linux/sort.h>
 #include <linux/slab.h>
 #include <linux/module.h>
+#include <linux/ktime.h>
 
 /* a simple boot-time regression test */
 
 #define TEST_LEN 1000
 
+struct test_rec {
+	u32 key;
+	u32 serial;
+};
+
 static int __init cmpint(const void *a, const void *b)
 {
 	return *(int *)a - *(int *)b;
 }
 
+static int __init cmprec(const void *a, const void *b)
+{
+	const struct test_rec *ra = a, *rb = b;
+
+	return ra->key < rb->key ? -1 : ra->key > rb->key;
+}
+
+static u64 __init keyrec(const void *a)
+{
+	return ((const struct test_rec *)a)->key;
+}
+
+/* sort_by_key() must sort stably: equal keys keep their input order */
+static int __init test_sort_by_key(void)
+{
+	struct test_rec *a, *b;
+	int i, r = 1, err = -ENOMEM;
+	u64 t_heap, t_radix;
+
+	a = kmalloc_array(TEST_LEN, sizeof(*a), GFP_KERNEL);
+	b = kmalloc_array(TEST_LEN, sizeof(*b), GFP_KERNEL);
+	if (!a || !b)
+		goto exit;
+
+	for (i = 0; i < TEST_LEN; i++) {
+		r = (r * 725861) % 6599;
+		a[i].key = r % (TEST_LEN / 4);
+		a[i].serial = i;
+	}
+	memcpy(b, a, TEST_LEN * sizeof(*a));
+
+	t_radix = ktime_get_ns();
+	err = sort_by_key(a, TEST_LEN, sizeof(*a), keyrec, GFP_KERNEL);
+	t_radix = ktime_get_ns() - t_radix;
+	if (err)
+		goto exit;
+
+	t_heap = ktime_get_ns();
+	sort(b, TEST_LEN, sizeof(*b), cmprec, NULL);
+	t_heap = ktime_get_ns() - t_heap;
+
+	err = -EINVAL;
+	for (i = 0; i < TEST_LEN-1; i++)
+		if (a[i].key > a[i+1].key ||
+		    (a[i].key == a[i+1].key && a[i].serial > a[i+1].serial)) {
+			pr_err("sort_by_key test has failed\n");
+			goto exit;
+		}
+	err = 0;
+	pr_info("sort_by_key test passed, %llu ns vs %llu ns for sort\n",
+		t_radix, t_heap);
+exit:
+	kfree(a);
+	kfree(b);
+	return err;
+}
+
 static int __init test_sort_init(void)
 {
 	int *a, i, r = 1, err = -ENOMEM;
@@ -37,7 +100,7 @@ static int __init test_sort_init(void)
 	pr_info("test passed\n");
 exit:
 	kfree(a);
-	return err;
+	return err ?: test_sort_by_key();
 }
 
 static void __exit test_sort_exit(void)
@@ -1544,6 +1544,74 @@ static void check_align_2(struct xarray *xa, char *name)
 	XA_BUG_ON(xa, !xa_empty(xa));
 }
 
+#ifdef CONFIG_XARRAY_MULTI
+static void check_split_1(struct xarray *xa, unsigned long index,
+				unsigned int order)
+{
+	XA_STATE(xas, xa, index);
+	void *entry;
+	unsigned int i = 0;
+
+	xa_store_order(xa, index, order, xa, GFP_KERNEL);
+	xa_set_mark(xa, index, XA_MARK_1);
+	XA_BUG_ON(xa, xa_get_order(xa, index) != order);
+
+	xas_split_alloc(&xas, xa, order, GFP_KERNEL);
+	xas_lock(&xas);
+	xas_split(&xas, xa, order);
+	xas_unlock(&xas);
+
+	xa_for_each(xa, index, entry) {
+		XA_BUG_ON(xa, entry != xa);
+		XA_BUG_ON(xa, xa_get_order(xa, index) != 0);
+		XA_BUG_ON(xa, !xa_get_mark(xa, index, XA_MARK_1));
+		i++;
+	}
+	XA_BUG_ON(xa, i != 1 << order);
+
+	xa_set_mark(xa, index, XA_MARK_0);
+	XA_BUG_ON(xa, !xa_get_mark(xa, index, XA_MARK_0));
+
+	xa_destroy(xa);
+}
+
+/* Too large a split fails without touching the entry */
+static void check_split_large(struct xarray *xa, unsigned int order)
+{
+	XA_STATE(xas, xa, 0);
+
+	xa_store_order(xa, 0, order, xa, GFP_KERNEL);
+
+	xas_split_alloc(&xas, xa, order, GFP_KERNEL);
+	XA_BUG_ON(xa, xas_error(&xas) != -EINVAL);
+	xas_lock(&xas);
+	xas_split(&xas, xa, order);
+	xas_unlock(&xas);
+	XA_BUG_ON(xa, xas_error(&xas) != -EINVAL);
+
+	XA_BUG_ON(xa, xa_get_order(xa, 0) != order);
+	XA_BUG_ON(xa, xa_load(xa, (1UL << order) - 1) != xa);
+
+	xa_destroy(xa);
+}
+
+static noinline void check_split(struct xarray *xa)
+{
+	unsigned int order;
+
+	XA_BUG_ON(xa, !xa_empty(xa));
+
+	for (order = 1; order < 2 * XA_CHUNK_SHIFT; order++) {
+		check_split_1(xa, 0, order);
+		check_split_1(xa, 1UL << order, order);
+		check_split_1(xa, 3UL << order, order);
+	}
+	check_split_large(xa, 2 * XA_CHUNK_SHIFT);
+}
+#else
+static void check_split(struct xarray *xa) { }
+#endif
+
 static noinline void check_align(struct xarray *xa)
 {
 	char name[] = "Motorola 68000";
@@ -1706,6 +1774,7 @@ static int xarray_checks(void)
 	check_move(&array);
 	check_create_range(&array);
 	check_store_range(&array);
+	check_split(&array);
 	check_store_iter(&array);
 	check_align(&xa0);
 
@@ -0,0 +1,118 @@
+// SPDX-License-Identifier: GPL-2.0-only
+#define pr_fmt(fmt) "zstd_parallel_test: " fmt
+
+/*
+ * Test cases for ZSTD_compressParallel(): the output of any number of
+ * workers must decompress back to the input in a single call, and must
+ * not depend on the number of workers.
+ */
+
+#include <linux/module.h>
+#include <linux/printk.h>
+#include <linux/random.h>
+#include <linux/string.h>
+#include <linux/vmalloc.h>
+#include <linux/zstd.h>
+
+#define SRC_SIZE	(1024 * 1024 + 1000)	/* the last chunk is short */
+#define CHUNK_SIZE	(128 * 1024)
+#define LEVEL		3
+
+/* Runs of repeated words with random ones in between compress, but not away */
+static void __init fill_src(u8 *src, size_t size)
+{
+	size_t i;
+	u32 word = 0;
+
+	for (i = 0; i < size; i++) {
+		if (!(i % 64))
+			word = (prandom_u32() % 4) ? word : prandom_u32();
+		src[i] = word >> (8 * (i % 4));
+	}
+}
+
+static int __init test_workers(const u8 *src, u8 *dst, size_t dst_size,
+			       u8 *out, unsigned int nb_workers,
+			       const u8 *ref, size_t ref_size, size_t *c_size)
+{
+	ZSTD_parameters params = ZSTD_getParams(LEVEL, CHUNK_SIZE, 0);
+	size_t wksp_size, d_size;
+	ZSTD_DCtx *dctx;
+	void *wksp;
+	int err = 0;
+
+	wksp_size = max(ZSTD_parallelWorkspaceBound(params.cParams, nb_workers),
+			ZSTD_DCtxWorkspaceBound());
+	wksp = vmalloc(wksp_size);
+	if (!wksp)
+		return -ENOMEM;
+
+	*c_size = ZSTD_compressParallel(wksp, wksp_size, nb_workers, dst,
+					dst_size, src, SRC_SIZE, CHUNK_SIZE,
+					params);
+	if (ZSTD_isError(*c_size)) {
+		pr_err("%u workers: compression failed with %d\n", nb_workers,
+		       ZSTD_getErrorCode(*c_size));
+		err = -EINVAL;
+		goto out;
+	}
+
+	if (ref && (*c_size != ref_size || memcmp(dst, ref, ref_size))) {
+		pr_err("%u workers: output differs from a single worker's\n",
+		       nb_workers);
+		err = -EINVAL;
+		goto out;
+	}
+
+	dctx = ZSTD_initDCtx(wksp, ZSTD_DCtxWorkspaceBound());
+	d_size = ZSTD_decompressDCtx(dctx, out, SRC_SIZE, dst, *c_size);
+	if (ZSTD_isError(d_size) || d_size != SRC_SIZE ||
+	    memcmp(out, src, SRC_SIZE)) {
+		pr_err("%u workers: round trip failed\n", nb_workers);
+		err = -EINVAL;
+	}
+out:
+	vfree(wksp);
+	return err;
+}
+
+static int __init test_zstd_parallel_init(void)
+{
+	static const unsigned int nb_workers[] = { 2, 3, 8, 16 };
+	size_t dst_size = ZSTD_compressParallelBound(SRC_SIZE, CHUNK_SIZE);
+	u8 *src, *dst, *ref, *out;
+	size_t ref_size, c_size;
+	int i, err = -ENOMEM;
+
+	src = vmalloc(SRC_SIZE);
+	out = vmalloc(SRC_SIZE);
+	dst = vmalloc(dst_size);
+	ref = vmalloc(dst_size);
+	if (!src || !out || !dst || !ref)
+		goto out;
+
+	fill_src(src, SRC_SIZE);
+
+	err = test_workers(src, ref, dst_size, out, 1, NULL, 0, &ref_size);
+	for (i = 0; !err && i < ARRAY_SIZE(nb_workers); i++)
+		err = test_workers(src, dst, dst_size, out, nb_workers[i],
+				   ref, ref_size, &c_size);
+	if (!err)
+		pr_info("test passed, %u bytes compressed to %zu\n", SRC_SIZE,
+			ref_size);
+out:
+	vfree(ref);
+	vfree(dst);
+	vfree(out);
+	vfree(src);
+	return err;
+}
+module_init(test_zstd_parallel_init);
+
+static void __exit test_zstd_parallel_exit(void)
+{
+	/* do nothing */
+}
+module_exit(test_zstd_parallel_exit);
+
+MODULE_LICENSE("GPL");
@@ -24,6 +24,7 @@
 #include <linux/kernel.h>
 #include <linux/module.h>
 #include <linux/string.h> /* memset */
+#include <linux/workqueue.h>
 
 /*-*************************************
 *  Constants
@@ -2833,6 +2834,117 @@ size_t ZSTD_compressCCtx(ZSTD_CCtx *ctx, void *dst, size_t dstCapacity, const vo
 	return ZSTD_compress_internal(ctx, dst, dstCapacity, src, srcSize, NULL, 0, params);
 }
 
+/* =====  Parallel API  ===== */
+
+typedef struct {
+	struct work_struct work;
+	ZSTD_CCtx *cctx;
+	void *dst;
+	size_t dstCapacity;
+	const void *src;
+	size_t srcSize;
+	size_t chunkSize;
+	ZSTD_parameters params;
+	size_t result;
+} ZSTD_parallelJob;
+
+/* The job array heads the workspace, the contexts of the workers follow */
+size_t ZSTD_parallelWorkspaceBound(ZSTD_compressionParameters cParams, unsigned int nbWorkers)
+{
+	return ZSTD_ALIGN(nbWorkers * sizeof(ZSTD_parallelJob)) + nbWorkers * ZSTD_ALIGN(ZSTD_CCtxWorkspaceBound(cParams));
+}
+
+size_t ZSTD_compressParallelBound(size_t srcSize, size_t chunkSize)
+{
+	size_t const nbChunks = srcSize ? DIV_ROUND_UP(srcSize, chunkSize) : 1;
+	return nbChunks * ZSTD_compressBound(chunkSize);
+}
+
+/* Compresses job->src one chunk per frame, the frames packed in job->dst */
+static void ZSTD_parallelJob_run(ZSTD_parallelJob *job)
+{
+	const BYTE *ip = (const BYTE *)job->src;
+	const BYTE *const iend = ip + job->srcSize;
+	BYTE *const ostart = (BYTE *)job->dst;
+	BYTE *op = ostart;
+
+	do {
+		size_t const srcChunk = MIN(job->chunkSize, (size_t)(iend - ip));
+		size_t const cSize = ZSTD_compressCCtx(job->cctx, op, job->dstCapacity - (op - ostart), ip, srcChunk, job->params);
+		if (ZSTD_isError(cSize)) {
+			job->result = cSize;
+			return;
+		}
+		ip += srcChunk;
+		op += cSize;
+	} while (ip < iend);
+
+	job->result = op - ostart;
+}
+
+static void ZSTD_parallelJob_work(struct work_struct *work)
+{
+	ZSTD_parallelJob_run(container_of(work, ZSTD_parallelJob, work));
+}
+
+size_t ZSTD_compressParallel(void *workspace, size_t workspaceSize, unsigned int nbWorkers, void *dst, size_t dstCapacity, const void *src, size_t srcSize,
+			     size_t chunkSize, ZSTD_parameters params)
+{
+	ZSTD_parallelJob *const jobs = (ZSTD_parallelJob *)workspace;
+	size_t const wkspSize = ZSTD_ALIGN(ZSTD_CCtxWorkspaceBound(params.cParams));
+	BYTE *wksp;
+	size_t nbChunks, chunksPerJob, cSize = 0;
+	unsigned int nbJobs, n;
+
+	if (!nbWorkers || !chunkSize)
+		return ERROR(parameter_unknown);
+	if (!workspace || workspace != ZSTD_PTR_ALIGN(workspace) ||
+	    workspaceSize < ZSTD_parallelWorkspaceBound(params.cParams, nbWorkers))
+		return ERROR(memory_allocation);
+	if (dstCapacity < ZSTD_compressParallelBound(srcSize, chunkSize))
+		return ERROR(dstSize_tooSmall);
+
+	/* Each job takes a run of consecutive chunks, none is left empty */
+	nbChunks = srcSize ? DIV_ROUND_UP(srcSize, chunkSize) : 1;
+	chunksPerJob = DIV_ROUND_UP(nbChunks, MIN(nbWorkers, nbChunks));
+	nbJobs = DIV_ROUND_UP(nbChunks, chunksPerJob);
+	wksp = (BYTE *)workspace + ZSTD_ALIGN(nbWorkers * sizeof(ZSTD_parallelJob));
+
+	for (n = 0; n < nbJobs; n++) {
+		ZSTD_parallelJob *const job = &jobs[n];
+		size_t const srcStart = n * chunksPerJob * chunkSize;
+		size_t const dstStart = n * chunksPerJob * ZSTD_compressBound(chunkSize);
+
+		job->cctx = ZSTD_initCCtx(wksp + n * wkspSize, wkspSize);
+		if (!job->cctx)
+			return ERROR(memory_allocation);
+		job->src = (const BYTE *)src + srcStart;
+		job->srcSize = MIN(chunksPerJob * chunkSize, srcSize - srcStart);
+		job->dst = (BYTE *)dst + dstStart;
+		job->dstCapacity = (n == nbJobs - 1) ? dstCapacity - dstStart : chunksPerJob * ZSTD_compressBound(chunkSize);
+		job->chunkSize = chunkSize;
+		job->params = params;
+	}
+
+	/* The caller compresses the first run while the workers do the rest */
+	for (n = 1; n < nbJobs; n++) {
+		INIT_WORK(&jobs[n].work, ZSTD_parallelJob_work);
+		queue_work(system_unbound_wq, &jobs[n].work);
+	}
+	ZSTD_parallelJob_run(&jobs[0]);
+	for (n = 1; n < nbJobs; n++)
+		flush_work(&jobs[n].work);
+
+	/* Pack the runs of frames behind each other */
+	for (n = 0; n < nbJobs; n++) {
+		if (ZSTD_isError(jobs[n].result))
+			return jobs[n].result;
+		memmove((BYTE *)dst + cSize, jobs[n].dst, jobs[n].result);
+		cSize += jobs[n].result;
+	}
+	return cSize;
+}
+
 /* =====  Dictionary API  ===== */
 
 struct ZSTD_CDict_s {
@@ -3451,6 +3563,10 @@ EXPORT_SYMBOL(ZSTD_initCCtx);
 EXPORT_SYMBOL(ZSTD_compressCCtx);
 EXPORT_SYMBOL(ZSTD_compress_usingDict);
 
+EXPORT_SYMBOL(ZSTD_parallelWorkspaceBound);
+EXPORT_SYMBOL(ZSTD_compressParallelBound);
+EXPORT_SYMBOL(ZSTD_compressParallel);
+
 EXPORT_SYMBOL(ZSTD_CDictWorkspaceBound);
 EXPORT_SYMBOL(ZSTD_initCDict);
 EXPORT_SYMBOL(ZSTD_compress_usingCDict);
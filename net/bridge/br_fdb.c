@@ -592,7 +592,12 @@ void br_fdb_update(struct net_bridge *br, struct net_bridge_port *source,
 			unsigned long now = jiffies;
 			bool fdb_modified = false;
 
-			if (now != fdb->updated) {
+			/* Refresh the ageing time only every 1/256 of it, so
+			 * that frames from a busy source received on several
+			 * CPUs do not keep bouncing the entry around.
+			 */
+			if (time_after(now, fdb->updated +
+					    (hold_time(br) >> 8))) {
 				fdb->updated = now;
 				fdb_modified = __fdb_mark_active(fdb);
 			}
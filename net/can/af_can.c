@@ -54,6 +54,7 @@
 #include <linux/socket.h>
 #include <linux/if_ether.h>
 #include <linux/if_arp.h>
+#include <linux/hash.h>
 #include <linux/skbuff.h>
 #include <linux/can.h>
 #include <linux/can/core.h>
@@ -408,6 +409,66 @@ static struct hlist_head *can_rcv_list_find(canid_t *can_id, canid_t *mask,
 	return &dev_rcv_lists->rx[RX_FIL];
 }
 
+/*
+ * The can_id/mask filters of the RX_FIL list are additionally grouped by
+ * their mask.  As the masked can_id of a receiver has to be equal to the
+ * masked can_id of a matching frame, each group can be looked up with a
+ * single hash probe, so the receive cost depends on the number of distinct
+ * masks instead of on the number of filters.  The RX_FIL list itself is
+ * kept for procfs.  All changes are done under rcvlists_lock.
+ */
+static struct can_fil_group *can_fil_group_find(struct can_dev_rcv_lists *dev_rcv_lists,
+						canid_t mask)
+{
+	struct can_fil_group *grp;
+
+	hlist_for_each_entry(grp, &dev_rcv_lists->rx_fil_groups, list) {
+		if (grp->mask == mask)
+			return grp;
+	}
+
+	return NULL;
+}
+
+static int can_fil_group_add(struct can_dev_rcv_lists *dev_rcv_lists,
+			     struct receiver *rcv)
+{
+	struct can_fil_group *grp;
+
+	grp = can_fil_group_find(dev_rcv_lists, rcv->mask);
+	if (!grp) {
+		grp = kzalloc(sizeof(*grp), GFP_ATOMIC);
+		if (!grp)
+			return -ENOMEM;
+
+		grp->mask = rcv->mask;
+		hlist_add_head_rcu(&grp->list, &dev_rcv_lists->rx_fil_groups);
+	}
+
+	hlist_add_head_rcu(&rcv->fil_list,
+			   &grp->hash[hash_32(rcv->can_id, CAN_FIL_HASH_BITS)]);
+	grp->entries++;
+
+	return 0;
+}
+
+static void can_fil_group_del(struct can_dev_rcv_lists *dev_rcv_lists,
+			      struct receiver *rcv)
+{
+	struct can_fil_group *grp;
+
+	grp = can_fil_group_find(dev_rcv_lists, rcv->mask);
+	if (WARN_ON(!grp))
+		return;
+
+	hlist_del_rcu(&rcv->fil_list);
+	if (--grp->entries)
+		return;
+
+	hlist_del_rcu(&grp->list);
+	kfree_rcu(grp, rcu);
+}
+
 /**
  * can_rx_register - subscribe CAN frames from a specific interface
  * @net: the applicable net namespace
@@ -474,6 +535,15 @@ int can_rx_register(struct net *net, struct net_device *dev, canid_t can_id,
 	rcv->ident = ident;
 	rcv->sk = sk;
 
+	if (rcv_list == &dev_rcv_lists->rx[RX_FIL]) {
+		err = can_fil_group_add(dev_rcv_lists, rcv);
+		if (err) {
+			spin_unlock_bh(&net->can.rcvlists_lock);
+			kmem_cache_free(rcv_cache, rcv);
+			return err;
+		}
+	}
+
 	hlist_add_head_rcu(&rcv->list, rcv_list);
 	dev_rcv_lists->entries++;
 
@@ -549,6 +619,8 @@ void can_rx_unregister(struct net *net, struct net_device *dev, canid_t can_id,
 	}
 
 	hlist_del_rcu(&rcv->list);
+	if (rcv_list == &dev_rcv_lists->rx[RX_FIL])
+		can_fil_group_del(dev_rcv_lists, rcv);
 	dev_rcv_lists->entries--;
 
 	if (rcv_lists_stats->rcv_entries > 0)
@@ -574,6 +646,7 @@ static inline void deliver(struct sk_buff *skb, struct receiver *rcv)
 
 static int can_rcv_filter(struct can_dev_rcv_lists *dev_rcv_lists, struct sk_buff *skb)
 {
+	struct can_fil_group *grp;
 	struct receiver *rcv;
 	int matches = 0;
 	struct can_frame *cf = (struct can_frame *)skb->data;
@@ -599,11 +672,16 @@ static int can_rcv_filter(struct can_dev_rcv_lists *dev_rcv_lists, struct sk_buf
 		matches++;
 	}
 
-	/* check for can_id/mask entries */
-	hlist_for_each_entry_rcu(rcv, &dev_rcv_lists->rx[RX_FIL], list) {
-		if ((can_id & rcv->mask) == rcv->can_id) {
-			deliver(skb, rcv);
-			matches++;
+	/* check for can_id/mask entries, one hash probe per distinct mask */
+	hlist_for_each_entry_rcu(grp, &dev_rcv_lists->rx_fil_groups, list) {
+		canid_t key = can_id & grp->mask;
+
+		hlist_for_each_entry_rcu(rcv, &grp->hash[hash_32(key, CAN_FIL_HASH_BITS)],
+					 fil_list) {
+			if (rcv->can_id == key) {
+				deliver(skb, rcv);
+				matches++;
+			}
 		}
 	}
 
@@ -50,6 +50,7 @@
 
 struct receiver {
 	struct hlist_node list;
+	struct hlist_node fil_list;
 	canid_t can_id;
 	canid_t mask;
 	unsigned long matches;
@@ -60,6 +61,19 @@ struct receiver {
 	struct rcu_head rcu;
 };
 
+/* RX_FIL receivers sharing one mask, hashed by their (masked) can_id */
+
+#define CAN_FIL_HASH_BITS 8
+#define CAN_FIL_HASH_SZ (1 << CAN_FIL_HASH_BITS)
+
+struct can_fil_group {
+	struct hlist_node list;
+	canid_t mask;
+	int entries;
+	struct rcu_head rcu;
+	struct hlist_head hash[CAN_FIL_HASH_SZ];
+};
+
 /* statistic structures */
 
 /* can be reset e.g. by can_init_stats() */
@@ -0,0 +1,214 @@
+// SPDX-License-Identifier: GPL-2.0-only
+
+#include "netlink.h"
+#include "common.h"
+
+struct qstats_req_info {
+	struct ethnl_req_info		base;
+};
+
+struct qstats_reply_data {
+	struct ethnl_reply_data		base;
+	unsigned int			n_rx;
+	unsigned int			n_tx;
+	struct ethtool_queue_stats	*rx;
+	struct ethtool_queue_stats	*tx;
+	/* n_rx histograms, NULL if the device does not keep them */
+	u64				*rx_lat;
+	unsigned long			*rx_lat_valid;
+};
+
+#define QSTATS_REPDATA(__reply_base) \
+	container_of(__reply_base, struct qstats_reply_data, base)
+
+static const struct nla_policy
+qstats_get_policy[ETHTOOL_A_QSTATS_MAX + 1] = {
+	[ETHTOOL_A_QSTATS_UNSPEC]		= { .type = NLA_REJECT },
+	[ETHTOOL_A_QSTATS_HEADER]		= { .type = NLA_NESTED },
+	[ETHTOOL_A_QSTATS_QUEUE]		= { .type = NLA_REJECT },
+};
+
+static void qstats_cleanup_data(struct ethnl_reply_data *reply_base)
+{
+	struct qstats_reply_data *data = QSTATS_REPDATA(reply_base);
+
+	kfree(data->rx);
+	kfree(data->tx);
+	kfree(data->rx_lat);
+	bitmap_free(data->rx_lat_valid);
+	data->rx = NULL;
+	data->tx = NULL;
+	data->rx_lat = NULL;
+	data->rx_lat_valid = NULL;
+}
+
+static int qstats_prepare_data(const struct ethnl_req_info *req_base,
+			       struct ethnl_reply_data *reply_base,
+			       struct genl_info *info)
+{
+	struct qstats_reply_data *data = QSTATS_REPDATA(reply_base);
+	struct net_device *dev = reply_base->dev;
+	const struct ethtool_ops *ops = dev->ethtool_ops;
+	unsigned int i;
+	int ret;
+
+	if (!ops->get_queue_stats)
+		return -EOPNOTSUPP;
+
+	data->n_rx = dev->real_num_rx_queues;
+	data->n_tx = dev->real_num_tx_queues;
+	data->rx = kcalloc(data->n_rx, sizeof(*data->rx), GFP_KERNEL);
+	data->tx = kcalloc(data->n_tx, sizeof(*data->tx), GFP_KERNEL);
+	if ((data->n_rx && !data->rx) || (data->n_tx && !data->tx)) {
+		ret = -ENOMEM;
+		goto err_free;
+	}
+	if (ops->get_napi_lat_hist && data->n_rx) {
+		data->rx_lat = kcalloc(array_size(data->n_rx,
+						  ETHTOOL_LAT_HIST_BUCKETS),
+				       sizeof(u64), GFP_KERNEL);
+		data->rx_lat_valid = bitmap_zalloc(data->n_rx, GFP_KERNEL);
+		if (!data->rx_lat || !data->rx_lat_valid) {
+			ret = -ENOMEM;
+			goto err_free;
+		}
+	}
+
+	ret = ethnl_ops_begin(dev);
+	if (ret < 0)
+		goto err_free;
+	for (i = 0; i < data->n_rx; i++) {
+		ops->get_queue_stats(dev, false, i, &data->rx[i]);
+		if (data->rx_lat &&
+		    !ops->get_napi_lat_hist(dev, i, data->rx_lat +
+					    i * ETHTOOL_LAT_HIST_BUCKETS))
+			__set_bit(i, data->rx_lat_valid);
+	}
+	for (i = 0; i < data->n_tx; i++)
+		ops->get_queue_stats(dev, true, i, &data->tx[i]);
+	ethnl_ops_complete(dev);
+
+	return 0;
+
+err_free:
+	qstats_cleanup_data(reply_base);
+	return ret;
+}
+
+static int qstats_queue_size(bool lat_hist)
+{
+	int len;
+
+	len = nla_total_size(sizeof(u8)) +		/* _QUEUE_TYPE */
+	      nla_total_size(sizeof(u32)) +		/* _QUEUE_INDEX */
+	      nla_total_size_64bit(sizeof(u64)) +	/* _QUEUE_PACKETS */
+	      nla_total_size_64bit(sizeof(u64)) +	/* _QUEUE_BYTES */
+	      nla_total_size_64bit(sizeof(u64));	/* _QUEUE_DROPS */
+	if (lat_hist)
+		len += nla_total_size(ETHTOOL_LAT_HIST_BUCKETS *
+				      nla_total_size_64bit(sizeof(u64)));
+	return nla_total_size(len);			/* _QSTATS_QUEUE */
+}
+
+static int qstats_reply_size(const struct ethnl_req_info *req_base,
+			     const struct ethnl_reply_data *reply_base)
+{
+	const struct qstats_reply_data *data = QSTATS_REPDATA(reply_base);
+	unsigned int n_lat = 0;
+
+	if (data->rx_lat_valid)
+		n_lat = bitmap_weight(data->rx_lat_valid, data->n_rx);
+
+	return (data->n_rx + data->n_tx - n_lat) * qstats_queue_size(false) +
+	       n_lat * qstats_queue_size(true);
+}
+
+static int qstats_put_hist(struct sk_buff *skb, const u64 *buckets)
+{
+	struct nlattr *nest;
+	unsigned int i;
+
+	nest = nla_nest_start(skb, ETHTOOL_A_QSTATS_QUEUE_NAPI_LAT);
+	if (!nest)
+		return -EMSGSIZE;
+	for (i = 0; i < ETHTOOL_LAT_HIST_BUCKETS; i++)
+		if (nla_put_u64_64bit(skb, ETHTOOL_A_QSTATS_HIST_BUCKET,
+				      buckets[i], ETHTOOL_A_QSTATS_HIST_PAD))
+			goto err_cancel;
+	nla_nest_end(skb, nest);
+	return 0;
+
+err_cancel:
+	nla_nest_cancel(skb, nest);
+	return -EMSGSIZE;
+}
+
+static int qstats_put_queue(struct sk_buff *skb, u8 type, unsigned int index,
+			    const struct ethtool_queue_stats *stats,
+			    const u64 *lat)
+{
+	struct nlattr *nest;
+
+	nest = nla_nest_start(skb, ETHTOOL_A_QSTATS_QUEUE);
+	if (!nest)
+		return -EMSGSIZE;
+	if (nla_put_u8(skb, ETHTOOL_A_QSTATS_QUEUE_TYPE, type) ||
+	    nla_put_u32(skb, ETHTOOL_A_QSTATS_QUEUE_INDEX, index) ||
+	    nla_put_u64_64bit(skb, ETHTOOL_A_QSTATS_QUEUE_PACKETS,
+			      stats->packets, ETHTOOL_A_QSTATS_QUEUE_PAD) ||
+	    nla_put_u64_64bit(skb, ETHTOOL_A_QSTATS_QUEUE_BYTES,
+			      stats->bytes, ETHTOOL_A_QSTATS_QUEUE_PAD) ||
+	    nla_put_u64_64bit(skb, ETHTOOL_A_QSTATS_QUEUE_DROPS,
+			      stats->drops, ETHTOOL_A_QSTATS_QUEUE_PAD) ||
+	    (lat && qstats_put_hist(skb, lat)))
+		goto err_cancel;
+	nla_nest_end(skb, nest);
+	return 0;
+
+err_cancel:
+	nla_nest_cancel(skb, nest);
+	return -EMSGSIZE;
+}
+
+static int qstats_fill_reply(struct sk_buff *skb,
+			     const struct ethnl_req_info *req_base,
+			     const struct ethnl_reply_data *reply_base)
+{
+	const struct qstats_reply_data *data = QSTATS_REPDATA(reply_base);
+	unsigned int i;
+	int ret;
+
+	for (i = 0; i < data->n_rx; i++) {
+		const u64 *lat = NULL;
+
+		if (data->rx_lat_valid && test_bit(i, data->rx_lat_valid))
+			lat = data->rx_lat + i * ETHTOOL_LAT_HIST_BUCKETS;
+		ret = qstats_put_queue(skb, ETHTOOL_QSTATS_QUEUE_RX, i,
+				       &data->rx[i], lat);
+		if (ret < 0)
+			return ret;
+	}
+	for (i = 0; i < data->n_tx; i++) {
+		ret = qstats_put_queue(skb, ETHTOOL_QSTATS_QUEUE_TX, i,
+				       &data->tx[i], NULL);
+		if (ret < 0)
+			return ret;
+	}
+
+	return 0;
+}
+
+const struct ethnl_request_ops ethnl_qstats_request_ops = {
+	.request_cmd		= ETHTOOL_MSG_QSTATS_GET,
+	.reply_cmd		= ETHTOOL_MSG_QSTATS_GET_REPLY,
+	.hdr_attr		= ETHTOOL_A_QSTATS_HEADER,
+	.max_attr		= ETHTOOL_A_QSTATS_MAX,
+	.req_info_size		= sizeof(struct qstats_req_info),
+	.reply_data_size	= sizeof(struct qstats_reply_data),
+	.request_policy		= qstats_get_policy,
+
+	.prepare_data		= qstats_prepare_data,
+	.reply_size		= qstats_reply_size,
+	.fill_reply		= qstats_fill_reply,
+	.cleanup_data		= qstats_cleanup_data,
+};
@@ -22,6 +22,7 @@
 #include <linux/proc_fs.h>
 #include <linux/err.h>
 #include <linux/cpumask.h>
+#include <linux/sort.h>
 
 #include <linux/netfilter/x_tables.h>
 #include <linux/netfilter_ipv4/ip_tables.h>
@@ -220,6 +221,216 @@ struct ipt_entry *ipt_next_entry(const struct ipt_entry *entry)
 	return (void *)entry + entry->next_offset;
 }
 
+/*
+ * Rules which can only match a single source or destination address are
+ * indexed by it when the table is loaded.  For a run of at least
+ * IPT_FAST_MIN_RUN consecutive such rules, ipt_do_table() looks up the
+ * rules of the run keyed by the address of the packet and evaluates only
+ * those, in rule order, then carries on after the run if none matched.
+ * Rules never hit are never evaluated nor counted, so this gives the
+ * same verdicts and counters as walking the run.
+ */
+#define IPT_FAST_MIN_RUN	8
+
+#define IPT_FAST_DST		0x1
+#define IPT_FAST_SRC		0x2
+
+struct ipt_fast_key {
+	__be32			addr;
+	unsigned int		offset;
+};
+
+struct ipt_fast_run {
+	unsigned int		head;	/* offset of the first rule */
+	unsigned int		end;	/* offset of the rule after the run */
+	bool			src;	/* keyed by source address */
+	unsigned int		nkeys;
+	struct ipt_fast_key	*keys;	/* sorted by address, then offset */
+};
+
+struct ipt_fast {
+	unsigned long		*heads;	/* run heads, by offset/alignment */
+	unsigned int		nruns;
+	struct ipt_fast_run	runs[];	/* sorted by head */
+};
+
+static inline unsigned int ipt_fast_bit(unsigned int offset)
+{
+	return offset / __alignof__(struct ipt_entry);
+}
+
+static unsigned int ipt_fast_kind(const struct ipt_entry *e)
+{
+	unsigned int kind = 0;
+
+	if (e->ip.dmsk.s_addr == htonl(0xFFFFFFFF) &&
+	    !(e->ip.invflags & IPT_INV_DSTIP))
+		kind |= IPT_FAST_DST;
+	if (e->ip.smsk.s_addr == htonl(0xFFFFFFFF) &&
+	    !(e->ip.invflags & IPT_INV_SRCIP))
+		kind |= IPT_FAST_SRC;
+	return kind;
+}
+
+static int ipt_fast_key_cmp(const void *a, const void *b)
+{
+	const struct ipt_fast_key *ka = a, *kb = b;
+	u32 aa = ntohl(ka->addr), ab = ntohl(kb->addr);
+
+	if (aa != ab)
+		return aa < ab ? -1 : 1;
+	return ka->offset < kb->offset ? -1 : ka->offset > kb->offset;
+}
+
+static void ipt_fast_add_run(struct ipt_fast *fast, struct ipt_fast_key *keys,
+			     void *entry0, struct ipt_entry *head,
+			     struct ipt_entry *end, unsigned int kind,
+			     unsigned int len)
+{
+	struct ipt_fast_run *run = &fast->runs[fast->nruns++];
+	struct ipt_entry *iter;
+	unsigned int i = 0;
+
+	run->head = (void *)head - entry0;
+	run->end = (void *)end - entry0;
+	run->src = !(kind & IPT_FAST_DST);
+	run->nkeys = len;
+	run->keys = keys;
+
+	for (iter = head; iter != end; iter = ipt_next_entry(iter), i++) {
+		keys[i].addr = run->src ? iter->ip.src.s_addr :
+					  iter->ip.dst.s_addr;
+		keys[i].offset = (void *)iter - entry0;
+	}
+	sort(keys, len, sizeof(*keys), ipt_fast_key_cmp, NULL);
+	__set_bit(ipt_fast_bit(run->head), fast->heads);
+}
+
+/*
+ * Walk the runs of @entry0, adding them to @fast if it is set.  Returns
+ * the number of rules in runs, @nruns is set to the number of runs.
+ */
+static unsigned int ipt_fast_scan(struct ipt_fast *fast,
+				  struct ipt_fast_key *keys, void *entry0,
+				  unsigned int size, unsigned int *nruns)
+{
+	struct ipt_entry *iter, *head = NULL;
+	unsigned int kind = 0, len = 0, nkeys = 0;
+
+	*nruns = 0;
+	xt_entry_foreach(iter, entry0, size) {
+		unsigned int k = ipt_fast_kind(iter);
+
+		if (head && (k & kind)) {
+			kind &= k;
+			len++;
+			continue;
+		}
+		if (head && len >= IPT_FAST_MIN_RUN) {
+			if (fast)
+				ipt_fast_add_run(fast, keys + nkeys, entry0,
+						 head, iter, kind, len);
+			nkeys += len;
+			(*nruns)++;
+		}
+		head = k ? iter : NULL;
+		kind = k;
+		len = 1;
+	}
+	if (head && len >= IPT_FAST_MIN_RUN) {
+		if (fast)
+			ipt_fast_add_run(fast, keys + nkeys, entry0, head,
+					 entry0 + size, kind, len);
+		nkeys += len;
+		(*nruns)++;
+	}
+	return nkeys;
+}
+
+/* The index is optional, NULL is returned if it is not worth having. */
+static struct ipt_fast *ipt_fast_build(const struct xt_table_info *info,
+				       void *entry0)
+{
+	unsigned int nruns, nkeys, heads_size;
+	struct ipt_fast_key *keys;
+	struct ipt_fast *fast;
+
+	nkeys = ipt_fast_scan(NULL, NULL, entry0, info->size, &nruns);
+	if (!nruns)
+		return NULL;
+
+	heads_size = BITS_TO_LONGS(ipt_fast_bit(info->size)) *
+		     sizeof(unsigned long);
+	fast = kvzalloc(struct_size(fast, runs, nruns) + heads_size +
+			nkeys * sizeof(*keys), GFP_KERNEL_ACCOUNT);
+	if (!fast)
+		return NULL;
+
+	fast->heads = (unsigned long *)&fast->runs[nruns];
+	keys = (void *)fast->heads + heads_size;
+	ipt_fast_scan(fast, keys, entry0, info->size, &nruns);
+	return fast;
+}
+
+/*
+ * Find the rules of the run starting at @e which can match @ip.  Sets
+ * *runp to the run and [*cand, *cand_end) to the keys of those rules and
+ * returns the first of them, or returns the rule after the run with
+ * *cand set to NULL.
+ */
+static struct ipt_entry *
+ipt_fast_lookup(const struct ipt_fast *fast, const void *table_base,
+		struct ipt_entry *e, const struct iphdr *ip,
+		const struct ipt_fast_run **runp,
+		const struct ipt_fast_key **cand,
+		const struct ipt_fast_key **cand_end)
+{
+	unsigned int off = (void *)e - table_base;
+	const struct ipt_fast_run *run;
+	unsigned int lo = 0, hi = fast->nruns;
+	u32 addr;
+
+	while (lo < hi) {
+		unsigned int mid = (lo + hi) / 2;
+
+		if (fast->runs[mid].head < off)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	run = &fast->runs[lo];
+	*runp = run;
+
+	addr = ntohl(run->src ? ip->saddr : ip->daddr);
+	lo = 0;
+	hi = run->nkeys;
+	while (lo < hi) {
+		unsigned int mid = (lo + hi) / 2;
+
+		if (ntohl(run->keys[mid].addr) < addr)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if (lo == run->nkeys || ntohl(run->keys[lo].addr) != addr) {
+		*cand = NULL;
+		return get_entry(table_base, run->end);
+	}
+
+	*cand = &run->keys[lo];
+	while (lo < run->nkeys && ntohl(run->keys[lo].addr) == addr)
+		lo++;
+	*cand_end = &run->keys[lo];
+	return get_entry(table_base, (*cand)->offset);
+}
+
+static void ipt_free_table_info(struct xt_table_info *info)
+{
+	kvfree(info->fastpath);
+	xt_free_table_info(info);
+}
+
 /* Returns one of the generic firewall policies, like NF_ACCEPT. */
 unsigned int
 ipt_do_table(struct sk_buff *skb,
@@ -236,6 +447,9 @@ ipt_do_table(struct sk_buff *skb,
 	struct ipt_entry *e, **jumpstack;
 	unsigned int stackidx, cpu;
 	const struct xt_table_info *private;
+	const struct ipt_fast_key *cand = NULL, *cand_end = NULL;
+	const struct ipt_fast_run *run = NULL;
+	const struct ipt_fast *fast;
 	struct xt_action_param acpar;
 	unsigned int addend;
 
@@ -261,6 +475,7 @@ ipt_do_table(struct sk_buff *skb,
 	private = READ_ONCE(table->private); /* Address dependency. */
 	cpu        = smp_processor_id();
 	table_base = private->entries;
+	fast       = private->fastpath;
 	jumpstack  = (struct ipt_entry **)private->jumpstack[cpu];
 
 	/* Switch to alternate jumpstack if we're being invoked via TEE.
@@ -281,10 +496,24 @@ ipt_do_table(struct sk_buff *skb,
 		struct xt_counters *counter;
 
 		WARN_ON(!e);
+		while (fast && !cand &&
+		       test_bit(ipt_fast_bit((void *)e - table_base),
+				fast->heads))
+			e = ipt_fast_lookup(fast, table_base, e, ip, &run,
+					    &cand, &cand_end);
+
 		if (!ip_packet_match(ip, indev, outdev,
 		    &e->ip, acpar.fragoff)) {
  no_match:
-			e = ipt_next_entry(e);
+			if (!cand) {
+				e = ipt_next_entry(e);
+			} else if (++cand < cand_end) {
+				e = get_entry(table_base, cand->offset);
+			} else {
+				/* No rule of the run matched */
+				cand = NULL;
+				e = get_entry(table_base, run->end);
+			}
 			continue;
 		}
 
@@ -295,6 +524,9 @@ ipt_do_table(struct sk_buff *skb,
 				goto no_match;
 		}
 
+		/* Matched, the rest of the run is walked as usual */
+		cand = NULL;
+
 		counter = xt_get_this_cpu_counter(&e->counters);
 		ADD_COUNTER(*counter, skb->len, 1);
 
@@ -730,6 +962,7 @@ translate_table(struct net *net, struct xt_table_info *newinfo, void *entry0,
 		return ret;
 	}
 
+	newinfo->fastpath = ipt_fast_build(newinfo, entry0);
 	return ret;
  out_free:
 	kvfree(offsets);
@@ -1083,7 +1316,7 @@ __do_replace(struct net *net, const char *name, unsigned int valid_hooks,
 	xt_entry_foreach(iter, oldinfo->entries, oldinfo->size)
 		cleanup_entry(iter, net);
 
-	xt_free_table_info(oldinfo);
+	ipt_free_table_info(oldinfo);
 	if (copy_to_user(counters_ptr, counters,
 			 sizeof(struct xt_counters) * num_counters) != 0) {
 		/* Silent error, can't fail, new table is already in place */
@@ -1146,7 +1379,7 @@ do_replace(struct net *net, sockptr_t arg, unsigned int len)
 	xt_entry_foreach(iter, loc_cpu_entry, newinfo->size)
 		cleanup_entry(iter, net);
  free_newinfo:
-	xt_free_table_info(newinfo);
+	ipt_free_table_info(newinfo);
 	return ret;
 }
 
@@ -1466,11 +1699,11 @@ translate_compat_table(struct net *net,
 
 	*pinfo = newinfo;
 	*pentry0 = entry1;
-	xt_free_table_info(info);
+	ipt_free_table_info(info);
 	return 0;
 
 free_newinfo:
-	xt_free_table_info(newinfo);
+	ipt_free_table_info(newinfo);
 	return ret;
 out_unlock:
 	xt_compat_flush_offsets(AF_INET);
@@ -1528,7 +1761,7 @@ compat_do_replace(struct net *net, sockptr_t arg, unsigned int len)
 	xt_entry_foreach(iter, loc_cpu_entry, newinfo->size)
 		cleanup_entry(iter, net);
  free_newinfo:
-	xt_free_table_info(newinfo);
+	ipt_free_table_info(newinfo);
 	return ret;
 }
 
@@ -1709,7 +1942,7 @@ static void __ipt_unregister_table(struct net *net, struct xt_table *table)
 		cleanup_entry(iter, net);
 	if (private->number > private->initial_entries)
 		module_put(table_owner);
-	xt_free_table_info(private);
+	ipt_free_table_info(private);
 }
 
 int ipt_register_table(struct net *net, const struct xt_table *table,
@@ -1753,7 +1986,7 @@ int ipt_register_table(struct net *net, const struct xt_table *table,
 	return ret;
 
 out_free:
-	xt_free_table_info(newinfo);
+	ipt_free_table_info(newinfo);
 	return ret;
 }
 
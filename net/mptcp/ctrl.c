@@ -14,10 +14,14 @@
 #define MPTCP_SYSCTL_PATH "net/mptcp"
 
 static int mptcp_pernet_id;
+/* serialises the scheduler sysctl against sockets copying the name */
+static DEFINE_SPINLOCK(mptcp_sched_name_lock);
+
 struct mptcp_pernet {
 	struct ctl_table_header *ctl_table_hdr;
 
 	int mptcp_enabled;
+	char scheduler[MPTCP_SCHED_NAME_MAX];
 };
 
 static struct mptcp_pernet *mptcp_get_pernet(struct net *net)
@@ -30,6 +34,40 @@ int mptcp_is_enabled(struct net *net)
 	return mptcp_get_pernet(net)->mptcp_enabled;
 }
 
+void mptcp_get_scheduler(struct net *net, char *name)
+{
+	spin_lock_bh(&mptcp_sched_name_lock);
+	strscpy(name, mptcp_get_pernet(net)->scheduler, MPTCP_SCHED_NAME_MAX);
+	spin_unlock_bh(&mptcp_sched_name_lock);
+}
+
+static int proc_scheduler(struct ctl_table *ctl, int write,
+			  void *buffer, size_t *lenp, loff_t *ppos)
+{
+	char val[MPTCP_SCHED_NAME_MAX];
+	struct ctl_table tbl = {
+		.data = val,
+		.maxlen = MPTCP_SCHED_NAME_MAX,
+	};
+	int ret;
+
+	spin_lock_bh(&mptcp_sched_name_lock);
+	strscpy(val, ctl->data, MPTCP_SCHED_NAME_MAX);
+	spin_unlock_bh(&mptcp_sched_name_lock);
+
+	ret = proc_dostring(&tbl, write, buffer, lenp, ppos);
+	if (write && ret == 0) {
+		if (mptcp_sched_exists(val)) {
+			spin_lock_bh(&mptcp_sched_name_lock);
+			strscpy(ctl->data, val, MPTCP_SCHED_NAME_MAX);
+			spin_unlock_bh(&mptcp_sched_name_lock);
+		} else {
+			ret = -ENOENT;
+		}
+	}
+	return ret;
+}
+
 static struct ctl_table mptcp_sysctl_table[] = {
 	{
 		.procname = "enabled",
@@ -40,12 +78,19 @@ static struct ctl_table mptcp_sysctl_table[] = {
 		 */
 		.proc_handler = proc_dointvec,
 	},
+	{
+		.procname = "scheduler",
+		.maxlen	= MPTCP_SCHED_NAME_MAX,
+		.mode = 0644,
+		.proc_handler = proc_scheduler,
+	},
 	{}
 };
 
 static void mptcp_pernet_set_defaults(struct mptcp_pernet *pernet)
 {
 	pernet->mptcp_enabled = 1;
+	strscpy(pernet->scheduler, "default", sizeof(pernet->scheduler));
 }
 
 static int mptcp_pernet_new_table(struct net *net, struct mptcp_pernet *pernet)
@@ -61,6 +106,7 @@ static int mptcp_pernet_new_table(struct net *net, struct mptcp_pernet *pernet)
 	}
 
 	table[0].data = &pernet->mptcp_enabled;
+	table[1].data = pernet->scheduler;
 
 	hdr = register_net_sysctl(net, MPTCP_SYSCTL_PATH, table);
 	if (!hdr)
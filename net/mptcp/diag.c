@@ -63,7 +63,13 @@ static int subflow_get_info(const struct sock *sk, struct sk_buff *skb)
 			sf->map_data_len) ||
 	    nla_put_u32(skb, MPTCP_SUBFLOW_ATTR_FLAGS, flags) ||
 	    nla_put_u8(skb, MPTCP_SUBFLOW_ATTR_ID_REM, sf->remote_id) ||
-	    nla_put_u8(skb, MPTCP_SUBFLOW_ATTR_ID_LOC, sf->local_id)) {
+	    nla_put_u8(skb, MPTCP_SUBFLOW_ATTR_ID_LOC, sf->local_id) ||
+	    nla_put_u64_64bit(skb, MPTCP_SUBFLOW_ATTR_BYTES_SENT,
+			      READ_ONCE(sf->bytes_sent),
+			      MPTCP_SUBFLOW_ATTR_PAD) ||
+	    nla_put_u64_64bit(skb, MPTCP_SUBFLOW_ATTR_BYTES_RETRANS,
+			      READ_ONCE(sf->bytes_retrans),
+			      MPTCP_SUBFLOW_ATTR_PAD)) {
 		err = -EMSGSIZE;
 		goto nla_failure;
 	}
@@ -93,6 +99,8 @@ static size_t subflow_get_info_size(const struct sock *sk)
 		nla_total_size(4) +	/* MPTCP_SUBFLOW_ATTR_FLAGS */
 		nla_total_size(1) +	/* MPTCP_SUBFLOW_ATTR_ID_REM */
 		nla_total_size(1) +	/* MPTCP_SUBFLOW_ATTR_ID_LOC */
+		nla_total_size_64bit(8) +	/* MPTCP_SUBFLOW_ATTR_BYTES_SENT */
+		nla_total_size_64bit(8) +	/* MPTCP_SUBFLOW_ATTR_BYTES_RETRANS */
 		0;
 	return size;
 }
@@ -795,6 +795,9 @@ static int mptcp_sendmsg_frag(struct sock *sk, struct sock *ssk,
 		pfrag->offset += frag_truesize;
 	WRITE_ONCE(*write_seq, *write_seq + ret);
 	mptcp_subflow_ctx(ssk)->rel_write_seq += ret;
+	mptcp_subflow_ctx(ssk)->bytes_sent += ret;
+	if (retransmission)
+		mptcp_subflow_ctx(ssk)->bytes_retrans += ret;
 
 	return ret;
 }
@@ -811,36 +814,27 @@ static void mptcp_nospace(struct mptcp_sock *msk, struct socket *sock)
 static struct sock *mptcp_subflow_get_send(struct mptcp_sock *msk)
 {
 	struct mptcp_subflow_context *subflow;
-	struct sock *backup = NULL;
+	struct sock *ssk;
 
 	sock_owned_by_me((const struct sock *)msk);
 
 	if (!mptcp_ext_cache_refill(msk))
 		return NULL;
 
-	mptcp_for_each_subflow(msk, subflow) {
-		struct sock *ssk = mptcp_subflow_tcp_sock(subflow);
-
-		if (!sk_stream_memory_free(ssk)) {
-			struct socket *sock = ssk->sk_socket;
-
-			if (sock)
-				mptcp_nospace(msk, sock);
-
-			return NULL;
-		}
-
-		if (subflow->backup) {
-			if (!backup)
-				backup = ssk;
+	ssk = msk->sched->get_subflow(msk);
+	if (ssk)
+		return ssk;
 
-			continue;
-		}
+	/* Nothing to send on: get woken up when a full subflow drains */
+	mptcp_for_each_subflow(msk, subflow) {
+		struct socket *sock;
 
-		return ssk;
+		ssk = mptcp_subflow_tcp_sock(subflow);
+		sock = ssk->sk_socket;
+		if (sock && !sk_stream_memory_free(ssk))
+			mptcp_nospace(msk, sock);
 	}
-
-	return backup;
+	return NULL;
 }
 
 static void ssk_check_wmem(struct mptcp_sock *msk, struct sock *ssk)
@@ -1475,6 +1469,7 @@ static int __mptcp_init_sock(struct sock *sk)
 	inet_csk(sk)->icsk_sync_mss = mptcp_sync_mss;
 
 	mptcp_pm_data_init(msk);
+	mptcp_sched_init(msk);
 
 	/* re-use the csk retrans timer for MPTCP-level retrans */
 	timer_setup(&msk->sk.icsk_retransmit_timer, mptcp_retransmit_timer, 0);
@@ -1812,6 +1807,7 @@ static void mptcp_destroy(struct sock *sk)
 	mptcp_token_destroy(msk);
 	if (msk->cached_ext)
 		__skb_ext_put(msk->cached_ext);
+	mptcp_sched_release(msk);
 
 	sk_sockets_allocated_dec(sk);
 }
@@ -2399,6 +2395,7 @@ void __init mptcp_proto_init(void)
 	mptcp_subflow_init();
 	mptcp_pm_init();
 	mptcp_token_init();
+	mptcp_sched_init_builtin();
 
 	if (proto_register(&mptcp_prot, 1) != 0)
 		panic("Failed to register MPTCP proto.\n");
@@ -211,6 +211,7 @@ struct mptcp_sock {
 	struct socket	*subflow; /* outgoing connect/listener/!mp_capable */
 	struct sock	*first;
 	struct mptcp_pm_data	pm;
+	struct mptcp_sched_ops	*sched;
 	struct {
 		u32	space;	/* bytes copied in last measurement window */
 		u32	copied; /* bytes copied in this measurement window */
@@ -281,6 +282,8 @@ struct mptcp_subflow_context {
 	u32	map_subflow_seq;
 	u32	ssn_offset;
 	u32	map_data_len;
+	u64	bytes_sent;	    /* data queued on this subflow */
+	u64	bytes_retrans;	    /* of which MPTCP-level retransmissions */
 	u32	request_mptcp : 1,  /* send MP_CAPABLE */
 		request_join : 1,   /* send MP_JOIN */
 		request_bkup : 1,
@@ -344,6 +347,7 @@ mptcp_subflow_get_mapped_dsn(const struct mptcp_subflow_context *subflow)
 }
 
 int mptcp_is_enabled(struct net *net);
+void mptcp_get_scheduler(struct net *net, char *name);
 void mptcp_subflow_fully_established(struct mptcp_subflow_context *subflow,
 				     struct mptcp_options_received *mp_opt);
 bool mptcp_subflow_data_available(struct sock *sk);
@@ -366,6 +370,29 @@ static inline void mptcp_subflow_tcp_fallback(struct sock *sk,
 }
 
 void __init mptcp_proto_init(void);
+
+#define MPTCP_SCHED_NAME_MAX	16
+
+struct mptcp_sched_ops {
+	/* return the subflow to send on, NULL to wait for write space;
+	 * called with the msk socket lock held, must not change msk state
+	 */
+	struct sock *	(*get_subflow)(struct mptcp_sock *msk);
+
+	char			name[MPTCP_SCHED_NAME_MAX];
+	struct module		*owner;
+	struct list_head	list;
+};
+
+extern struct mptcp_sched_ops mptcp_sched_default;
+
+int mptcp_register_scheduler(struct mptcp_sched_ops *sched);
+void mptcp_unregister_scheduler(struct mptcp_sched_ops *sched);
+bool mptcp_sched_exists(const char *name);
+void mptcp_sched_init(struct mptcp_sock *msk);
+void mptcp_sched_release(struct mptcp_sock *msk);
+void __init mptcp_sched_init_builtin(void);
+
 #if IS_ENABLED(CONFIG_MPTCP_IPV6)
 int __init mptcp_proto_v6_init(void);
 #endif
@@ -0,0 +1,177 @@
+// SPDX-License-Identifier: GPL-2.0
+/* Multipath TCP
+ *
+ * Packet scheduler: picks the subflow the next chunk of data is sent on.
+ */
+#define pr_fmt(fmt) "MPTCP: " fmt
+
+#include <linux/kernel.h>
+#include <linux/list.h>
+#include <linux/module.h>
+#include <linux/rculist.h>
+#include <linux/spinlock.h>
+#include <net/tcp.h>
+#include "protocol.h"
+
+static DEFINE_SPINLOCK(mptcp_sched_list_lock);
+static LIST_HEAD(mptcp_sched_list);
+
+/* must be called with rcu lock held */
+static struct mptcp_sched_ops *mptcp_sched_find(const char *name)
+{
+	struct mptcp_sched_ops *sched;
+
+	list_for_each_entry_rcu(sched, &mptcp_sched_list, list) {
+		if (!strcmp(sched->name, name))
+			return sched;
+	}
+	return NULL;
+}
+
+bool mptcp_sched_exists(const char *name)
+{
+	bool ret;
+
+	rcu_read_lock();
+	ret = !!mptcp_sched_find(name);
+	rcu_read_unlock();
+	return ret;
+}
+
+int mptcp_register_scheduler(struct mptcp_sched_ops *sched)
+{
+	int ret = 0;
+
+	if (!sched->get_subflow) {
+		pr_err("%s does not implement required ops\n", sched->name);
+		return -EINVAL;
+	}
+
+	spin_lock(&mptcp_sched_list_lock);
+	if (mptcp_sched_find(sched->name)) {
+		pr_notice("%s already registered\n", sched->name);
+		ret = -EEXIST;
+	} else {
+		list_add_tail_rcu(&sched->list, &mptcp_sched_list);
+		pr_debug("%s registered\n", sched->name);
+	}
+	spin_unlock(&mptcp_sched_list_lock);
+
+	return ret;
+}
+
+void mptcp_unregister_scheduler(struct mptcp_sched_ops *sched)
+{
+	spin_lock(&mptcp_sched_list_lock);
+	list_del_rcu(&sched->list);
+	spin_unlock(&mptcp_sched_list_lock);
+
+	/* Wait for sockets still looking it up, the module reference
+	 * keeps it alive for the sockets using it.
+	 */
+	synchronize_rcu();
+}
+
+void mptcp_sched_init(struct mptcp_sock *msk)
+{
+	char name[MPTCP_SCHED_NAME_MAX];
+	struct mptcp_sched_ops *sched;
+
+	mptcp_get_scheduler(sock_net((struct sock *)msk), name);
+
+	rcu_read_lock();
+	sched = mptcp_sched_find(name);
+	if (!sched || !try_module_get(sched->owner))
+		sched = &mptcp_sched_default;
+	rcu_read_unlock();
+
+	msk->sched = sched;
+}
+
+void mptcp_sched_release(struct mptcp_sock *msk)
+{
+	if (msk->sched)
+		module_put(msk->sched->owner);
+	msk->sched = NULL;
+}
+
+/* The first subflow, unless it is a backup one, as long as it has space */
+static struct sock *mptcp_sched_default_get(struct mptcp_sock *msk)
+{
+	struct mptcp_subflow_context *subflow;
+	struct sock *backup = NULL;
+
+	mptcp_for_each_subflow(msk, subflow) {
+		struct sock *ssk = mptcp_subflow_tcp_sock(subflow);
+
+		if (!sk_stream_memory_free(ssk))
+			return NULL;
+
+		if (subflow->backup) {
+			if (!backup)
+				backup = ssk;
+
+			continue;
+		}
+
+		return ssk;
+	}
+
+	return backup;
+}
+
+struct mptcp_sched_ops mptcp_sched_default = {
+	.get_subflow	= mptcp_sched_default_get,
+	.name		= "default",
+	.owner		= THIS_MODULE,
+};
+
+/* The subflow with the lowest smoothed RTT among those with space, backup
+ * subflows are used only when no other subflow is established.
+ */
+static struct sock *mptcp_sched_lowrtt_get(struct mptcp_sock *msk)
+{
+	struct sock *best = NULL, *backup = NULL;
+	struct mptcp_subflow_context *subflow;
+	u32 best_rtt = U32_MAX, backup_rtt = U32_MAX;
+	bool active = false;
+
+	mptcp_for_each_subflow(msk, subflow) {
+		struct sock *ssk = mptcp_subflow_tcp_sock(subflow);
+		u32 srtt = READ_ONCE(tcp_sk(ssk)->srtt_us);
+
+		if (!subflow->backup)
+			active = true;
+
+		if (!sk_stream_memory_free(ssk))
+			continue;
+
+		if (subflow->backup) {
+			if (srtt < backup_rtt || !backup) {
+				backup = ssk;
+				backup_rtt = srtt;
+			}
+		} else if (srtt < best_rtt || !best) {
+			best = ssk;
+			best_rtt = srtt;
+		}
+	}
+
+	/* Wait for space on the active subflows rather than spilling over */
+	if (!best && active)
+		return NULL;
+
+	return best ? : backup;
+}
+
+static struct mptcp_sched_ops mptcp_sched_lowrtt = {
+	.get_subflow	= mptcp_sched_lowrtt_get,
+	.name		= "lowrtt",
+	.owner		= THIS_MODULE,
+};
+
+void __init mptcp_sched_init_builtin(void)
+{
+	mptcp_register_scheduler(&mptcp_sched_default);
+	mptcp_register_scheduler(&mptcp_sched_lowrtt);
+}
@@ -1822,7 +1822,17 @@ static int ip_set_ad(struct net *net, struct sock *ctnl,
 		ret = call_ad(ctnl, skb, set, tb, adt, flags,
 			      use_lineno);
 	} else {
-		int nla_rem;
+		int nla_rem, n = 0;
+
+		/* Grow the set once for the whole batch instead of at every
+		 * doubling on the way.  Failing here is not fatal, the adds
+		 * below still resize the set when needed.
+		 */
+		if (adt == IPSET_ADD && set->variant->reserve) {
+			nla_for_each_nested(nla, attr[IPSET_ATTR_ADT], nla_rem)
+				n++;
+			set->variant->reserve(set, n);
+		}
 
 		nla_for_each_nested(nla, attr[IPSET_ATTR_ADT], nla_rem) {
 			if (nla_type(nla) != IPSET_ATTR_DATA ||
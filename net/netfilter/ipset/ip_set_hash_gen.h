@@ -242,6 +242,8 @@ htable_bits(u32 hashsize)
 #undef mtype_test
 #undef mtype_uref
 #undef mtype_resize
+#undef mtype_resize_from
+#undef mtype_reserve
 #undef mtype_ext_size
 #undef mtype_resize_ad
 #undef mtype_head
@@ -286,6 +288,8 @@ htable_bits(u32 hashsize)
 #define mtype_test		IPSET_TOKEN(MTYPE, _test)
 #define mtype_uref		IPSET_TOKEN(MTYPE, _uref)
 #define mtype_resize		IPSET_TOKEN(MTYPE, _resize)
+#define mtype_resize_from	IPSET_TOKEN(MTYPE, _resize_from)
+#define mtype_reserve		IPSET_TOKEN(MTYPE, _reserve)
 #define mtype_ext_size		IPSET_TOKEN(MTYPE, _ext_size)
 #define mtype_resize_ad		IPSET_TOKEN(MTYPE, _resize_ad)
 #define mtype_head		IPSET_TOKEN(MTYPE, _head)
@@ -634,16 +638,15 @@ static int
 mtype_del(struct ip_set *set, void *value, const struct ip_set_ext *ext,
 	  struct ip_set_ext *mext, u32 flags);
 
-/* Resize a hash: create a new hash table with doubling the hashsize
- * and inserting the elements to it. Repeat until we succeed or
- * fail due to memory pressures.
+/* Resize a hash: create a new hash table bigger than 2^htable_bits
+ * and inserting the elements to it. Repeat with doubling the hashsize
+ * until we succeed or fail due to memory pressures.
  */
 static int
-mtype_resize(struct ip_set *set, bool retried)
+mtype_resize_from(struct ip_set *set, u8 htable_bits)
 {
 	struct htype *h = set->data;
 	struct htable *t, *orig;
-	u8 htable_bits;
 	size_t dsize = set->dsize;
 #ifdef IP_SET_HASH_WITH_NETS
 	u8 flags;
@@ -662,8 +665,6 @@ mtype_resize(struct ip_set *set, bool retried)
 	if (!tmp)
 		return -ENOMEM;
 #endif
-	orig = ipset_dereference_bh_nfnl(h->table);
-	htable_bits = orig->htable_bits;
 
 retry:
 	ret = 0;
@@ -819,6 +820,43 @@ mtype_resize(struct ip_set *set, bool retried)
 	goto out;
 }
 
+static int
+mtype_resize(struct ip_set *set, bool retried)
+{
+	struct htype *h = set->data;
+
+	return mtype_resize_from(set,
+				 ipset_dereference_bh_nfnl(h->table)->htable_bits);
+}
+
+/* Grow the hash ahead of adding n elements from userspace, so that a
+ * large batch does not go through a resize at every doubling.
+ */
+static int
+mtype_reserve(struct ip_set *set, u32 n)
+{
+	struct htype *h = set->data;
+	struct htable *t = ipset_dereference_bh_nfnl(h->table);
+	u32 r, elements = 0;
+	u8 htable_bits;
+
+	for (r = 0; r < ahash_numof_locks(t->htable_bits); r++)
+		elements += t->hregion[r].elements;
+	elements = min_t(u64, (u64)elements + n, h->maxelem);
+
+	/* Aim at two elements per bucket in average, well below
+	 * AHASH_MAX_SIZE in the longest bucket.
+	 */
+	htable_bits = t->htable_bits;
+	while (htable_bits < 31 &&
+	       jhash_size(htable_bits) * (AHASH_INIT_SIZE / 2) < elements)
+		htable_bits++;
+	if (htable_bits == t->htable_bits)
+		return 0;
+
+	return mtype_resize_from(set, htable_bits - 1);
+}
+
 /* Get the current number of elements and ext_size in the set  */
 static void
 mtype_ext_size(struct ip_set *set, u32 *elements, size_t *ext_size)
@@ -1442,6 +1480,7 @@ static const struct ip_set_type_variant mtype_variant = {
 	.list	= mtype_list,
 	.uref	= mtype_uref,
 	.resize	= mtype_resize,
+	.reserve = mtype_reserve,
 	.same_set = mtype_same_set,
 	.region_lock = true,
 };
@@ -32,6 +32,8 @@
 #include <linux/seq_file.h>
 #include <linux/jhash.h>
 #include <linux/random.h>
+#include <linux/seqlock.h>
+#include <linux/workqueue.h>
 
 #include <net/net_namespace.h>
 #include <net/ip_vs.h>
@@ -41,21 +43,49 @@
 #define CONFIG_IP_VS_TAB_BITS	12
 #endif
 
+#define IP_VS_CONN_TAB_MAX_BITS	24
+
 /*
  * Connection hash size. Default is what was selected at compile time.
+ * The table grows up to conn_tab_max_bits when busy and shrinks back to
+ * conn_tab_bits when idle.
 */
 static int ip_vs_conn_tab_bits = CONFIG_IP_VS_TAB_BITS;
 module_param_named(conn_tab_bits, ip_vs_conn_tab_bits, int, 0444);
-MODULE_PARM_DESC(conn_tab_bits, "Set connections' hash size");
+MODULE_PARM_DESC(conn_tab_bits, "Set connections' initial hash size");
+
+static int ip_vs_conn_tab_max_bits = 20;
+module_param_named(conn_tab_max_bits, ip_vs_conn_tab_max_bits, int, 0444);
+MODULE_PARM_DESC(conn_tab_max_bits, "Set connections' maximal hash size");
 
-/* size and mask values */
+/* current size */
 int ip_vs_conn_tab_size __read_mostly;
-static int ip_vs_conn_tab_mask __read_mostly;
+
+struct ip_vs_conn_tab {
+	unsigned int		mask;
+	struct hlist_head	buckets[];
+};
 
 /*
  *  Connection hash table: for input and output packets lookups of IPVS
  */
-static struct hlist_head *ip_vs_conn_tab __read_mostly;
+static struct ip_vs_conn_tab __rcu *ip_vs_conn_tab;
+
+/*
+ *  While resizing, the connections in the buckets of the old table below
+ *  ip_vs_conn_resize_pos have been moved to ip_vs_conn_tab, the others are
+ *  still in ip_vs_conn_tab_old.
+ */
+static struct ip_vs_conn_tab __rcu *ip_vs_conn_tab_old;
+static unsigned int ip_vs_conn_resize_pos;
+
+/* Serializes resizing with the walkers of the whole table */
+static DEFINE_MUTEX(ip_vs_conn_resize_mutex);
+static void ip_vs_conn_resize(struct work_struct *work);
+static DECLARE_WORK(ip_vs_conn_resize_work, ip_vs_conn_resize);
+
+/* number of hashed connections, for all netns */
+static atomic_t ip_vs_conn_hashed = ATOMIC_INIT(0);
 
 /*  SLAB cache for IPVS connections */
 static struct kmem_cache *ip_vs_conn_cachep __read_mostly;
@@ -80,9 +110,15 @@ static unsigned int ip_vs_conn_rnd __read_mostly;
 #define IP_VS_ADDRSTRLEN (8+1)
 #endif
 
+/*
+ *  The table never gets smaller than CT_LOCKARRAY_SIZE buckets, so all the
+ *  buckets a connection hashes to in any table size share the same lock.
+ *  seq is bumped when the resizer moves connections of these buckets.
+ */
 struct ip_vs_aligned_lock
 {
 	spinlock_t	l;
+	seqcount_t	seq;
 } __attribute__((__aligned__(SMP_CACHE_BYTES)));
 
 /* lock array for conn table */
@@ -99,8 +135,59 @@ static inline void ct_write_unlock_bh(unsigned int key)
 	spin_unlock_bh(&__ip_vs_conntbl_lock_array[key&CT_LOCKARRAY_MASK].l);
 }
 
+static inline seqcount_t *ct_seq(unsigned int key)
+{
+	return &__ip_vs_conntbl_lock_array[key&CT_LOCKARRAY_MASK].seq;
+}
+
 static void ip_vs_conn_expire(struct timer_list *t);
 
+/*
+ *	Get the current table and, while a resize is in progress, the table
+ *	connections are being moved out of.  Called under RCU or with BH
+ *	disabled.
+ */
+static inline void ip_vs_conn_tabs(struct ip_vs_conn_tab **cur,
+				   struct ip_vs_conn_tab **old)
+{
+	*cur = rcu_dereference_check(ip_vs_conn_tab, rcu_read_lock_bh_held());
+	/* Pairs with the publishing order in ip_vs_conn_resize() */
+	smp_rmb();
+	*old = rcu_dereference_check(ip_vs_conn_tab_old,
+				     rcu_read_lock_bh_held());
+}
+
+static inline struct hlist_head *
+ip_vs_conn_head(struct ip_vs_conn_tab *t, unsigned int hash)
+{
+	return &t->buckets[hash & t->mask];
+}
+
+/*
+ *	Bucket where a connection with this hash lives, the caller holds
+ *	the lock for the hash
+ */
+static struct hlist_head *ip_vs_conn_bucket(unsigned int hash)
+{
+	struct ip_vs_conn_tab *cur, *old;
+
+	ip_vs_conn_tabs(&cur, &old);
+	if (old && (hash & old->mask) >= READ_ONCE(ip_vs_conn_resize_pos))
+		return ip_vs_conn_head(old, hash);
+	return ip_vs_conn_head(cur, hash);
+}
+
+/* Schedule a resize when the load factor leaves the [1/8, 2] range */
+static void ip_vs_conn_check_size(void)
+{
+	unsigned int n = atomic_read(&ip_vs_conn_hashed);
+	unsigned int size = READ_ONCE(ip_vs_conn_tab_size);
+
+	if ((n > size * 2 && size < (1U << ip_vs_conn_tab_max_bits)) ||
+	    (n < size / 8 && size > (1U << ip_vs_conn_tab_bits)))
+		queue_work(system_unbound_wq, &ip_vs_conn_resize_work);
+}
+
 /*
  *	Returns hash value for IPVS connection entry
  */
@@ -112,11 +199,11 @@ static unsigned int ip_vs_conn_hashkey(struct netns_ipvs *ipvs, int af, unsigned
 	if (af == AF_INET6)
 		return (jhash_3words(jhash(addr, 16, ip_vs_conn_rnd),
 				    (__force u32)port, proto, ip_vs_conn_rnd) ^
-			((size_t)ipvs>>8)) & ip_vs_conn_tab_mask;
+			((size_t)ipvs>>8));
 #endif
 	return (jhash_3words((__force u32)addr->ip, (__force u32)port, proto,
 			    ip_vs_conn_rnd) ^
-		((size_t)ipvs>>8)) & ip_vs_conn_tab_mask;
+		((size_t)ipvs>>8));
 }
 
 static unsigned int ip_vs_conn_hashkey_param(const struct ip_vs_conn_param *p,
@@ -126,8 +213,7 @@ static unsigned int ip_vs_conn_hashkey_param(const struct ip_vs_conn_param *p,
 	__be16 port;
 
 	if (p->pe_data && p->pe->hashkey_raw)
-		return p->pe->hashkey_raw(p, ip_vs_conn_rnd, inverse) &
-			ip_vs_conn_tab_mask;
+		return p->pe->hashkey_raw(p, ip_vs_conn_rnd, inverse);
 
 	if (likely(!inverse)) {
 		addr = p->caddr;
@@ -177,7 +263,8 @@ static inline int ip_vs_conn_hash(struct ip_vs_conn *cp)
 	if (!(cp->flags & IP_VS_CONN_F_HASHED)) {
 		cp->flags |= IP_VS_CONN_F_HASHED;
 		refcount_inc(&cp->refcnt);
-		hlist_add_head_rcu(&cp->c_list, &ip_vs_conn_tab[hash]);
+		hlist_add_head_rcu(&cp->c_list, ip_vs_conn_bucket(hash));
+		atomic_inc(&ip_vs_conn_hashed);
 		ret = 1;
 	} else {
 		pr_err("%s(): request for already hashed, called from %pS\n",
@@ -188,6 +275,8 @@ static inline int ip_vs_conn_hash(struct ip_vs_conn *cp)
 	spin_unlock(&cp->lock);
 	ct_write_unlock_bh(hash);
 
+	if (ret)
+		ip_vs_conn_check_size();
 	return ret;
 }
 
@@ -209,6 +298,7 @@ static inline int ip_vs_conn_unhash(struct ip_vs_conn *cp)
 
 	if (cp->flags & IP_VS_CONN_F_HASHED) {
 		hlist_del_rcu(&cp->c_list);
+		atomic_dec(&ip_vs_conn_hashed);
 		cp->flags &= ~IP_VS_CONN_F_HASHED;
 		refcount_dec(&cp->refcnt);
 		ret = 1;
@@ -218,6 +308,8 @@ static inline int ip_vs_conn_unhash(struct ip_vs_conn *cp)
 	spin_unlock(&cp->lock);
 	ct_write_unlock_bh(hash);
 
+	if (ret)
+		ip_vs_conn_check_size();
 	return ret;
 }
 
@@ -241,6 +333,7 @@ static inline bool ip_vs_conn_unlink(struct ip_vs_conn *cp)
 		/* Decrease refcnt and unlink conn only if we are last user */
 		if (refcount_dec_if_one(&cp->refcnt)) {
 			hlist_del_rcu(&cp->c_list);
+			atomic_dec(&ip_vs_conn_hashed);
 			cp->flags &= ~IP_VS_CONN_F_HASHED;
 			ret = true;
 		}
@@ -249,9 +342,92 @@ static inline bool ip_vs_conn_unlink(struct ip_vs_conn *cp)
 	spin_unlock(&cp->lock);
 	ct_write_unlock_bh(hash);
 
+	if (ret)
+		ip_vs_conn_check_size();
 	return ret;
 }
 
+static struct ip_vs_conn_tab *ip_vs_conn_tab_alloc(unsigned int size)
+{
+	struct ip_vs_conn_tab *t;
+	unsigned int idx;
+
+	t = kvmalloc(struct_size(t, buckets, size), GFP_KERNEL);
+	if (!t)
+		return NULL;
+
+	t->mask = size - 1;
+	for (idx = 0; idx < size; idx++)
+		INIT_HLIST_HEAD(&t->buckets[idx]);
+	return t;
+}
+
+/*
+ *	Resize the table to keep the load factor between 1/8 and 2.
+ *	The connections are moved one old bucket at a time under its lock,
+ *	lookups racing with a move see the seqcount of the lock change and
+ *	search again.  Connections are hashed into whichever table holds
+ *	their bucket at that moment, see ip_vs_conn_bucket().
+ */
+static void ip_vs_conn_resize(struct work_struct *work)
+{
+	unsigned int n, idx, size, new_size, hash;
+	struct ip_vs_conn_tab *t, *nt;
+	struct ip_vs_aligned_lock *l;
+	struct hlist_node *next;
+	struct ip_vs_conn *cp;
+
+	mutex_lock(&ip_vs_conn_resize_mutex);
+	t = rcu_dereference_protected(ip_vs_conn_tab,
+				lockdep_is_held(&ip_vs_conn_resize_mutex));
+	size = t->mask + 1;
+	n = atomic_read(&ip_vs_conn_hashed);
+
+	new_size = size;
+	while (n > new_size * 2 && new_size < (1U << ip_vs_conn_tab_max_bits))
+		new_size <<= 1;
+	while (n < new_size / 8 && new_size > (1U << ip_vs_conn_tab_bits))
+		new_size >>= 1;
+	if (new_size == size)
+		goto out;
+
+	nt = ip_vs_conn_tab_alloc(new_size);
+	if (!nt)
+		goto out;
+
+	/* Lookups load ip_vs_conn_tab first, so they see the old table too */
+	WRITE_ONCE(ip_vs_conn_resize_pos, 0);
+	rcu_assign_pointer(ip_vs_conn_tab_old, t);
+	rcu_assign_pointer(ip_vs_conn_tab, nt);
+
+	for (idx = 0; idx < size; idx++) {
+		l = &__ip_vs_conntbl_lock_array[idx & CT_LOCKARRAY_MASK];
+
+		spin_lock_bh(&l->l);
+		write_seqcount_begin(&l->seq);
+		hlist_for_each_entry_safe(cp, next, &t->buckets[idx], c_list) {
+			hash = ip_vs_conn_hashkey_conn(cp);
+			hlist_del_rcu(&cp->c_list);
+			hlist_add_head_rcu(&cp->c_list, ip_vs_conn_head(nt, hash));
+		}
+		WRITE_ONCE(ip_vs_conn_resize_pos, idx + 1);
+		write_seqcount_end(&l->seq);
+		spin_unlock_bh(&l->l);
+
+		cond_resched();
+	}
+
+	rcu_assign_pointer(ip_vs_conn_tab_old, NULL);
+	WRITE_ONCE(ip_vs_conn_tab_size, new_size);
+	synchronize_rcu();
+	kvfree(t);
+
+	IP_VS_DBG(2, "Connection hash table resized to %u buckets "
+		  "for %u connections\n", new_size, n);
+out:
+	mutex_unlock(&ip_vs_conn_resize_mutex);
+}
+
 
 /*
  *  Gets ip_vs_conn associated with supplied parameters in the ip_vs_conn_tab.
@@ -262,28 +438,40 @@ static inline bool ip_vs_conn_unlink(struct ip_vs_conn *cp)
 static inline struct ip_vs_conn *
 __ip_vs_conn_in_get(const struct ip_vs_conn_param *p)
 {
-	unsigned int hash;
+	struct ip_vs_conn_tab *t[2];
+	unsigned int hash, seq;
 	struct ip_vs_conn *cp;
+	int i;
 
 	hash = ip_vs_conn_hashkey_param(p, false);
 
 	rcu_read_lock();
 
-	hlist_for_each_entry_rcu(cp, &ip_vs_conn_tab[hash], c_list) {
-		if (p->cport == cp->cport && p->vport == cp->vport &&
-		    cp->af == p->af &&
-		    ip_vs_addr_equal(p->af, p->caddr, &cp->caddr) &&
-		    ip_vs_addr_equal(p->af, p->vaddr, &cp->vaddr) &&
-		    ((!p->cport) ^ (!(cp->flags & IP_VS_CONN_F_NO_CPORT))) &&
-		    p->protocol == cp->protocol &&
-		    cp->ipvs == p->ipvs) {
-			if (!__ip_vs_conn_get(cp))
-				continue;
-			/* HIT */
-			rcu_read_unlock();
-			return cp;
+	/* A miss is retried when the resizer moved entries under us */
+	do {
+		seq = read_seqcount_begin(ct_seq(hash));
+		ip_vs_conn_tabs(&t[0], &t[1]);
+		for (i = 0; i < 2 && t[i]; i++) {
+			hlist_for_each_entry_rcu(cp, ip_vs_conn_head(t[i], hash),
+						 c_list) {
+				if (p->cport == cp->cport &&
+				    p->vport == cp->vport &&
+				    cp->af == p->af &&
+				    ip_vs_addr_equal(p->af, p->caddr, &cp->caddr) &&
+				    ip_vs_addr_equal(p->af, p->vaddr, &cp->vaddr) &&
+				    ((!p->cport) ^
+				     (!(cp->flags & IP_VS_CONN_F_NO_CPORT))) &&
+				    p->protocol == cp->protocol &&
+				    cp->ipvs == p->ipvs) {
+					if (!__ip_vs_conn_get(cp))
+						continue;
+					/* HIT */
+					rcu_read_unlock();
+					return cp;
+				}
+			}
 		}
-	}
+	} while (read_seqcount_retry(ct_seq(hash), seq));
 
 	rcu_read_unlock();
 
@@ -348,38 +536,50 @@ EXPORT_SYMBOL_GPL(ip_vs_conn_in_get_proto);
 /* Get reference to connection template */
 struct ip_vs_conn *ip_vs_ct_in_get(const struct ip_vs_conn_param *p)
 {
-	unsigned int hash;
+	struct ip_vs_conn_tab *t[2];
+	unsigned int hash, seq;
 	struct ip_vs_conn *cp;
+	int i;
 
 	hash = ip_vs_conn_hashkey_param(p, false);
 
 	rcu_read_lock();
 
-	hlist_for_each_entry_rcu(cp, &ip_vs_conn_tab[hash], c_list) {
-		if (unlikely(p->pe_data && p->pe->ct_match)) {
-			if (cp->ipvs != p->ipvs)
-				continue;
-			if (p->pe == cp->pe && p->pe->ct_match(p, cp)) {
-				if (__ip_vs_conn_get(cp))
-					goto out;
-			}
-			continue;
-		}
+	do {
+		seq = read_seqcount_begin(ct_seq(hash));
+		ip_vs_conn_tabs(&t[0], &t[1]);
+		for (i = 0; i < 2 && t[i]; i++) {
+			hlist_for_each_entry_rcu(cp, ip_vs_conn_head(t[i], hash),
+						 c_list) {
+				if (unlikely(p->pe_data && p->pe->ct_match)) {
+					if (cp->ipvs != p->ipvs)
+						continue;
+					if (p->pe == cp->pe &&
+					    p->pe->ct_match(p, cp)) {
+						if (__ip_vs_conn_get(cp))
+							goto out;
+					}
+					continue;
+				}
 
-		if (cp->af == p->af &&
-		    ip_vs_addr_equal(p->af, p->caddr, &cp->caddr) &&
-		    /* protocol should only be IPPROTO_IP if
-		     * p->vaddr is a fwmark */
-		    ip_vs_addr_equal(p->protocol == IPPROTO_IP ? AF_UNSPEC :
-				     p->af, p->vaddr, &cp->vaddr) &&
-		    p->vport == cp->vport && p->cport == cp->cport &&
-		    cp->flags & IP_VS_CONN_F_TEMPLATE &&
-		    p->protocol == cp->protocol &&
-		    cp->ipvs == p->ipvs) {
-			if (__ip_vs_conn_get(cp))
-				goto out;
+				if (cp->af == p->af &&
+				    ip_vs_addr_equal(p->af, p->caddr, &cp->caddr) &&
+				    /* protocol should only be IPPROTO_IP if
+				     * p->vaddr is a fwmark */
+				    ip_vs_addr_equal(p->protocol == IPPROTO_IP ?
+						     AF_UNSPEC : p->af,
+						     p->vaddr, &cp->vaddr) &&
+				    p->vport == cp->vport &&
+				    p->cport == cp->cport &&
+				    cp->flags & IP_VS_CONN_F_TEMPLATE &&
+				    p->protocol == cp->protocol &&
+				    cp->ipvs == p->ipvs) {
+					if (__ip_vs_conn_get(cp))
+						goto out;
+				}
+			}
 		}
-	}
+	} while (read_seqcount_retry(ct_seq(hash), seq));
 	cp = NULL;
 
   out:
@@ -400,8 +600,10 @@ struct ip_vs_conn *ip_vs_ct_in_get(const struct ip_vs_conn_param *p)
  *	p->vaddr, p->vport: pkt dest address (foreign host) */
 struct ip_vs_conn *ip_vs_conn_out_get(const struct ip_vs_conn_param *p)
 {
-	unsigned int hash;
 	struct ip_vs_conn *cp, *ret=NULL;
+	struct ip_vs_conn_tab *t[2];
+	unsigned int hash, seq;
+	int i;
 
 	/*
 	 *	Check for "full" addressed entries
@@ -410,21 +612,30 @@ struct ip_vs_conn *ip_vs_conn_out_get(const struct ip_vs_conn_param *p)
 
 	rcu_read_lock();
 
-	hlist_for_each_entry_rcu(cp, &ip_vs_conn_tab[hash], c_list) {
-		if (p->vport == cp->cport && p->cport == cp->dport &&
-		    cp->af == p->af &&
-		    ip_vs_addr_equal(p->af, p->vaddr, &cp->caddr) &&
-		    ip_vs_addr_equal(p->af, p->caddr, &cp->daddr) &&
-		    p->protocol == cp->protocol &&
-		    cp->ipvs == p->ipvs) {
-			if (!__ip_vs_conn_get(cp))
-				continue;
-			/* HIT */
-			ret = cp;
-			break;
+	do {
+		seq = read_seqcount_begin(ct_seq(hash));
+		ip_vs_conn_tabs(&t[0], &t[1]);
+		for (i = 0; i < 2 && t[i]; i++) {
+			hlist_for_each_entry_rcu(cp, ip_vs_conn_head(t[i], hash),
+						 c_list) {
+				if (p->vport == cp->cport &&
+				    p->cport == cp->dport &&
+				    cp->af == p->af &&
+				    ip_vs_addr_equal(p->af, p->vaddr, &cp->caddr) &&
+				    ip_vs_addr_equal(p->af, p->caddr, &cp->daddr) &&
+				    p->protocol == cp->protocol &&
+				    cp->ipvs == p->ipvs) {
+					if (!__ip_vs_conn_get(cp))
+						continue;
+					/* HIT */
+					ret = cp;
+					goto out;
+				}
+			}
 		}
-	}
+	} while (read_seqcount_retry(ct_seq(hash), seq));
 
+out:
 	rcu_read_unlock();
 
 	IP_VS_DBG_BUF(9, "lookup/out %s %s:%d->%s:%d %s\n",
@@ -457,7 +668,15 @@ static void __ip_vs_conn_put_timer(struct ip_vs_conn *cp)
 {
 	unsigned long t = (cp->flags & IP_VS_CONN_F_ONE_PACKET) ?
 		0 : cp->timeout;
-	mod_timer(&cp->timer, jiffies+t);
+	unsigned long expires = jiffies + t, slack = t >> 6;
+
+	/* The timer is armed 1/64 of the timeout late, so that busy
+	 * connections do not have to rearm it for every packet.
+	 */
+	if (!t || !timer_pending(&cp->timer) ||
+	    !time_in_range(READ_ONCE(cp->timer.expires), expires,
+			   expires + slack))
+		mod_timer(&cp->timer, expires + slack);
 
 	__ip_vs_conn_put(cp);
 }
@@ -1037,19 +1256,27 @@ struct ip_vs_iter_state {
 	struct hlist_head	*l;
 };
 
+/* Table for the walkers, which hold ip_vs_conn_resize_mutex */
+static inline struct ip_vs_conn_tab *ip_vs_conn_tab_walk(void)
+{
+	return rcu_dereference_protected(ip_vs_conn_tab,
+				lockdep_is_held(&ip_vs_conn_resize_mutex));
+}
+
 static void *ip_vs_conn_array(struct seq_file *seq, loff_t pos)
 {
-	int idx;
-	struct ip_vs_conn *cp;
+	struct ip_vs_conn_tab *t = ip_vs_conn_tab_walk();
 	struct ip_vs_iter_state *iter = seq->private;
+	struct ip_vs_conn *cp;
+	unsigned int idx;
 
-	for (idx = 0; idx < ip_vs_conn_tab_size; idx++) {
-		hlist_for_each_entry_rcu(cp, &ip_vs_conn_tab[idx], c_list) {
+	for (idx = 0; idx <= t->mask; idx++) {
+		hlist_for_each_entry_rcu(cp, &t->buckets[idx], c_list) {
 			/* __ip_vs_conn_get() is not needed by
 			 * ip_vs_conn_seq_show and ip_vs_conn_sync_seq_show
 			 */
 			if (pos-- == 0) {
-				iter->l = &ip_vs_conn_tab[idx];
+				iter->l = &t->buckets[idx];
 				return cp;
 			}
 		}
@@ -1065,6 +1292,7 @@ static void *ip_vs_conn_seq_start(struct seq_file *seq, loff_t *pos)
 	struct ip_vs_iter_state *iter = seq->private;
 
 	iter->l = NULL;
+	mutex_lock(&ip_vs_conn_resize_mutex);
 	rcu_read_lock();
 	return *pos ? ip_vs_conn_array(seq, *pos - 1) :SEQ_START_TOKEN;
 }
@@ -1073,9 +1301,10 @@ static void *ip_vs_conn_seq_next(struct seq_file *seq, void *v, loff_t *pos)
 {
 	struct ip_vs_conn *cp = v;
 	struct ip_vs_iter_state *iter = seq->private;
+	struct ip_vs_conn_tab *t = ip_vs_conn_tab_walk();
 	struct hlist_node *e;
 	struct hlist_head *l = iter->l;
-	int idx;
+	unsigned int idx;
 
 	++*pos;
 	if (v == SEQ_START_TOKEN)
@@ -1086,10 +1315,10 @@ static void *ip_vs_conn_seq_next(struct seq_file *seq, void *v, loff_t *pos)
 	if (e)
 		return hlist_entry(e, struct ip_vs_conn, c_list);
 
-	idx = l - ip_vs_conn_tab;
-	while (++idx < ip_vs_conn_tab_size) {
-		hlist_for_each_entry_rcu(cp, &ip_vs_conn_tab[idx], c_list) {
-			iter->l = &ip_vs_conn_tab[idx];
+	idx = l - t->buckets;
+	while (++idx <= t->mask) {
+		hlist_for_each_entry_rcu(cp, &t->buckets[idx], c_list) {
+			iter->l = &t->buckets[idx];
 			return cp;
 		}
 		cond_resched_rcu();
@@ -1102,6 +1331,7 @@ static void ip_vs_conn_seq_stop(struct seq_file *seq, void *v)
 	__releases(RCU)
 {
 	rcu_read_unlock();
+	mutex_unlock(&ip_vs_conn_resize_mutex);
 }
 
 static int ip_vs_conn_seq_show(struct seq_file *seq, void *v)
@@ -1288,17 +1518,23 @@ static inline bool ip_vs_conn_ops_mode(struct ip_vs_conn *cp)
 /* Called from keventd and must protect itself from softirqs */
 void ip_vs_random_dropentry(struct netns_ipvs *ipvs)
 {
-	int idx;
+	struct ip_vs_conn_tab *t;
 	struct ip_vs_conn *cp;
+	unsigned int idx;
+
+	/* Leave it for the next round while the table is resized */
+	if (!mutex_trylock(&ip_vs_conn_resize_mutex))
+		return;
+	t = ip_vs_conn_tab_walk();
 
 	rcu_read_lock();
 	/*
 	 * Randomly scan 1/32 of the whole table every second
 	 */
-	for (idx = 0; idx < (ip_vs_conn_tab_size>>5); idx++) {
-		unsigned int hash = prandom_u32() & ip_vs_conn_tab_mask;
+	for (idx = 0; idx < ((t->mask + 1) >> 5); idx++) {
+		unsigned int hash = prandom_u32() & t->mask;
 
-		hlist_for_each_entry_rcu(cp, &ip_vs_conn_tab[hash], c_list) {
+		hlist_for_each_entry_rcu(cp, &t->buckets[hash], c_list) {
 			if (cp->ipvs != ipvs)
 				continue;
 			if (atomic_read(&cp->n_control))
@@ -1350,6 +1586,7 @@ void ip_vs_random_dropentry(struct netns_ipvs *ipvs)
 		cond_resched_rcu();
 	}
 	rcu_read_unlock();
+	mutex_unlock(&ip_vs_conn_resize_mutex);
 }
 
 
@@ -1358,14 +1595,17 @@ void ip_vs_random_dropentry(struct netns_ipvs *ipvs)
  */
 static void ip_vs_conn_flush(struct netns_ipvs *ipvs)
 {
-	int idx;
 	struct ip_vs_conn *cp, *cp_c;
+	struct ip_vs_conn_tab *t;
+	unsigned int idx;
 
 flush_again:
+	mutex_lock(&ip_vs_conn_resize_mutex);
+	t = ip_vs_conn_tab_walk();
 	rcu_read_lock();
-	for (idx = 0; idx < ip_vs_conn_tab_size; idx++) {
+	for (idx = 0; idx <= t->mask; idx++) {
 
-		hlist_for_each_entry_rcu(cp, &ip_vs_conn_tab[idx], c_list) {
+		hlist_for_each_entry_rcu(cp, &t->buckets[idx], c_list) {
 			if (cp->ipvs != ipvs)
 				continue;
 			if (atomic_read(&cp->n_control))
@@ -1381,6 +1621,7 @@ static void ip_vs_conn_flush(struct netns_ipvs *ipvs)
 		cond_resched_rcu();
 	}
 	rcu_read_unlock();
+	mutex_unlock(&ip_vs_conn_resize_mutex);
 
 	/* the counter may be not NULL, because maybe some conn entries
 	   are run by slow timer handler or unhashed but still referred */
@@ -1393,13 +1634,16 @@ static void ip_vs_conn_flush(struct netns_ipvs *ipvs)
 #ifdef CONFIG_SYSCTL
 void ip_vs_expire_nodest_conn_flush(struct netns_ipvs *ipvs)
 {
-	int idx;
 	struct ip_vs_conn *cp, *cp_c;
+	struct ip_vs_conn_tab *t;
 	struct ip_vs_dest *dest;
+	unsigned int idx;
 
+	mutex_lock(&ip_vs_conn_resize_mutex);
+	t = ip_vs_conn_tab_walk();
 	rcu_read_lock();
-	for (idx = 0; idx < ip_vs_conn_tab_size; idx++) {
-		hlist_for_each_entry_rcu(cp, &ip_vs_conn_tab[idx], c_list) {
+	for (idx = 0; idx <= t->mask; idx++) {
+		hlist_for_each_entry_rcu(cp, &t->buckets[idx], c_list) {
 			if (cp->ipvs != ipvs)
 				continue;
 
@@ -1425,6 +1669,7 @@ void ip_vs_expire_nodest_conn_flush(struct netns_ipvs *ipvs)
 			break;
 	}
 	rcu_read_unlock();
+	mutex_unlock(&ip_vs_conn_resize_mutex);
 }
 #endif
 
@@ -1453,41 +1698,46 @@ void __net_exit ip_vs_conn_net_cleanup(struct netns_ipvs *ipvs)
 
 int __init ip_vs_conn_init(void)
 {
+	struct ip_vs_conn_tab *t;
 	int idx;
 
-	/* Compute size and mask */
+	/* All sizes of the table must share the lock of a bucket */
+	ip_vs_conn_tab_bits = clamp(ip_vs_conn_tab_bits, CT_LOCKARRAY_BITS,
+				    IP_VS_CONN_TAB_MAX_BITS);
+	ip_vs_conn_tab_max_bits = clamp(ip_vs_conn_tab_max_bits,
+					ip_vs_conn_tab_bits,
+					IP_VS_CONN_TAB_MAX_BITS);
+
+	/* Compute size */
 	ip_vs_conn_tab_size = 1 << ip_vs_conn_tab_bits;
-	ip_vs_conn_tab_mask = ip_vs_conn_tab_size - 1;
 
 	/*
 	 * Allocate the connection hash table and initialize its list heads
 	 */
-	ip_vs_conn_tab = vmalloc(array_size(ip_vs_conn_tab_size,
-					    sizeof(*ip_vs_conn_tab)));
-	if (!ip_vs_conn_tab)
+	t = ip_vs_conn_tab_alloc(ip_vs_conn_tab_size);
+	if (!t)
 		return -ENOMEM;
+	RCU_INIT_POINTER(ip_vs_conn_tab, t);
 
 	/* Allocate ip_vs_conn slab cache */
 	ip_vs_conn_cachep = kmem_cache_create("ip_vs_conn",
 					      sizeof(struct ip_vs_conn), 0,
 					      SLAB_HWCACHE_ALIGN, NULL);
 	if (!ip_vs_conn_cachep) {
-		vfree(ip_vs_conn_tab);
+		kvfree(t);
 		return -ENOMEM;
 	}
 
 	pr_info("Connection hash table configured "
-		"(size=%d, memory=%ldKbytes)\n",
-		ip_vs_conn_tab_size,
-		(long)(ip_vs_conn_tab_size*sizeof(struct list_head))/1024);
+		"(size=%d, max=%d, memory=%ldKbytes)\n",
+		ip_vs_conn_tab_size, 1 << ip_vs_conn_tab_max_bits,
+		(long)(ip_vs_conn_tab_size*sizeof(struct hlist_head))/1024);
 	IP_VS_DBG(0, "Each connection entry needs %zd bytes at least\n",
 		  sizeof(struct ip_vs_conn));
 
-	for (idx = 0; idx < ip_vs_conn_tab_size; idx++)
-		INIT_HLIST_HEAD(&ip_vs_conn_tab[idx]);
-
 	for (idx = 0; idx < CT_LOCKARRAY_SIZE; idx++)  {
 		spin_lock_init(&__ip_vs_conntbl_lock_array[idx].l);
+		seqcount_init(&__ip_vs_conntbl_lock_array[idx].seq);
 	}
 
 	/* calculate the random value for connection hash */
@@ -1498,9 +1748,10 @@ int __init ip_vs_conn_init(void)
 
 void ip_vs_conn_cleanup(void)
 {
+	cancel_work_sync(&ip_vs_conn_resize_work);
 	/* Wait all ip_vs_conn_rcu_free() callbacks to complete */
 	rcu_barrier();
 	/* Release the empty cache */
 	kmem_cache_destroy(ip_vs_conn_cachep);
-	vfree(ip_vs_conn_tab);
+	kvfree(rcu_dereference_protected(ip_vs_conn_tab, 1));
 }
@@ -21,6 +21,8 @@
 #include <linux/interrupt.h>
 #include <linux/sysctl.h>
 #include <linux/list.h>
+#include <linux/slab.h>
+#include <linux/workqueue.h>
 
 #include <net/ip_vs.h>
 
@@ -30,8 +32,9 @@
   long interval, it is easy to implement a user level daemon which
   periodically reads those statistical counters and measure rate.
 
-  Currently, the measurement is activated by slow timer handler. Hope
-  this measurement will not introduce too much load.
+  The measurement runs from a delayed work per netns, which releases the
+  estimator list and the CPU every IP_VS_EST_CHUNK estimators, so that a
+  large number of real servers does not keep softirqs disabled for long.
 
   We measure rate during the last 8 seconds every 2 seconds:
 
@@ -50,6 +53,20 @@
  */
 
 
+/* Estimators updated before the lock and the CPU are released */
+#define IP_VS_EST_CHUNK		64
+
+struct ip_vs_est_work {
+	struct list_head	list;
+	struct netns_ipvs	*ipvs;
+	struct delayed_work	work;
+	unsigned long		next;
+};
+
+/* ip_vs_est_work of each netns, protected by ip_vs_est_mutex */
+static LIST_HEAD(ip_vs_est_works);
+static DEFINE_MUTEX(ip_vs_est_mutex);
+
 /*
  * Make a summary from each cpu
  */
@@ -93,45 +110,71 @@ static void ip_vs_read_cpu_stats(struct ip_vs_kstats *sum,
 }
 
 
-static void estimation_timer(struct timer_list *t)
+static void ip_vs_estimate(struct ip_vs_estimator *e)
 {
-	struct ip_vs_estimator *e;
-	struct ip_vs_stats *s;
+	struct ip_vs_stats *s = container_of(e, struct ip_vs_stats, est);
 	u64 rate;
-	struct netns_ipvs *ipvs = from_timer(ipvs, t, est_timer);
 
-	spin_lock(&ipvs->est_lock);
-	list_for_each_entry(e, &ipvs->est_list, list) {
-		s = container_of(e, struct ip_vs_stats, est);
+	spin_lock(&s->lock);
+	ip_vs_read_cpu_stats(&s->kstats, s->cpustats);
 
-		spin_lock(&s->lock);
-		ip_vs_read_cpu_stats(&s->kstats, s->cpustats);
+	/* scaled by 2^10, but divided 2 seconds */
+	rate = (s->kstats.conns - e->last_conns) << 9;
+	e->last_conns = s->kstats.conns;
+	e->cps += ((s64)rate - (s64)e->cps) >> 2;
 
-		/* scaled by 2^10, but divided 2 seconds */
-		rate = (s->kstats.conns - e->last_conns) << 9;
-		e->last_conns = s->kstats.conns;
-		e->cps += ((s64)rate - (s64)e->cps) >> 2;
+	rate = (s->kstats.inpkts - e->last_inpkts) << 9;
+	e->last_inpkts = s->kstats.inpkts;
+	e->inpps += ((s64)rate - (s64)e->inpps) >> 2;
 
-		rate = (s->kstats.inpkts - e->last_inpkts) << 9;
-		e->last_inpkts = s->kstats.inpkts;
-		e->inpps += ((s64)rate - (s64)e->inpps) >> 2;
+	rate = (s->kstats.outpkts - e->last_outpkts) << 9;
+	e->last_outpkts = s->kstats.outpkts;
+	e->outpps += ((s64)rate - (s64)e->outpps) >> 2;
 
-		rate = (s->kstats.outpkts - e->last_outpkts) << 9;
-		e->last_outpkts = s->kstats.outpkts;
-		e->outpps += ((s64)rate - (s64)e->outpps) >> 2;
+	/* scaled by 2^5, but divided 2 seconds */
+	rate = (s->kstats.inbytes - e->last_inbytes) << 4;
+	e->last_inbytes = s->kstats.inbytes;
+	e->inbps += ((s64)rate - (s64)e->inbps) >> 2;
 
-		/* scaled by 2^5, but divided 2 seconds */
-		rate = (s->kstats.inbytes - e->last_inbytes) << 4;
-		e->last_inbytes = s->kstats.inbytes;
-		e->inbps += ((s64)rate - (s64)e->inbps) >> 2;
+	rate = (s->kstats.outbytes - e->last_outbytes) << 4;
+	e->last_outbytes = s->kstats.outbytes;
+	e->outbps += ((s64)rate - (s64)e->outbps) >> 2;
+	spin_unlock(&s->lock);
+}
 
-		rate = (s->kstats.outbytes - e->last_outbytes) << 4;
-		e->last_outbytes = s->kstats.outbytes;
-		e->outbps += ((s64)rate - (s64)e->outbps) >> 2;
-		spin_unlock(&s->lock);
+static void estimation_work(struct work_struct *work)
+{
+	struct ip_vs_est_work *ew = container_of(to_delayed_work(work),
+						 struct ip_vs_est_work, work);
+	struct netns_ipvs *ipvs = ew->ipvs;
+	struct ip_vs_estimator *e;
+	struct list_head cursor;
+	unsigned int n = 0;
+
+	/* The cursor keeps our place while est_lock is released, estimators
+	 * may come and go meanwhile.
+	 */
+	spin_lock_bh(&ipvs->est_lock);
+	list_add(&cursor, &ipvs->est_list);
+	while (cursor.next != &ipvs->est_list) {
+		e = list_entry(cursor.next, struct ip_vs_estimator, list);
+		list_move(&cursor, &e->list);
+		ip_vs_estimate(e);
+
+		if (!(++n % IP_VS_EST_CHUNK)) {
+			spin_unlock_bh(&ipvs->est_lock);
+			cond_resched();
+			spin_lock_bh(&ipvs->est_lock);
+		}
 	}
-	spin_unlock(&ipvs->est_lock);
-	mod_timer(&ipvs->est_timer, jiffies + 2*HZ);
+	list_del(&cursor);
+	spin_unlock_bh(&ipvs->est_lock);
+
+	/* Keep the 2 seconds period the rates are computed for */
+	ew->next += 2 * HZ;
+	if (time_before(ew->next, jiffies))
+		ew->next = jiffies;
+	queue_delayed_work(system_unbound_wq, &ew->work, ew->next - jiffies);
 }
 
 void ip_vs_start_estimator(struct netns_ipvs *ipvs, struct ip_vs_stats *stats)
@@ -186,14 +229,41 @@ void ip_vs_read_estimator(struct ip_vs_kstats *dst, struct ip_vs_stats *stats)
 
 int __net_init ip_vs_estimator_net_init(struct netns_ipvs *ipvs)
 {
+	struct ip_vs_est_work *ew;
+
+	ew = kzalloc(sizeof(*ew), GFP_KERNEL);
+	if (!ew)
+		return -ENOMEM;
+
 	INIT_LIST_HEAD(&ipvs->est_list);
 	spin_lock_init(&ipvs->est_lock);
-	timer_setup(&ipvs->est_timer, estimation_timer, 0);
-	mod_timer(&ipvs->est_timer, jiffies + 2 * HZ);
+
+	ew->ipvs = ipvs;
+	ew->next = jiffies + 2 * HZ;
+	INIT_DELAYED_WORK(&ew->work, estimation_work);
+
+	mutex_lock(&ip_vs_est_mutex);
+	list_add(&ew->list, &ip_vs_est_works);
+	mutex_unlock(&ip_vs_est_mutex);
+
+	queue_delayed_work(system_unbound_wq, &ew->work, 2 * HZ);
 	return 0;
 }
 
 void __net_exit ip_vs_estimator_net_cleanup(struct netns_ipvs *ipvs)
 {
-	del_timer_sync(&ipvs->est_timer);
+	struct ip_vs_est_work *ew;
+
+	mutex_lock(&ip_vs_est_mutex);
+	list_for_each_entry(ew, &ip_vs_est_works, list) {
+		if (ew->ipvs == ipvs) {
+			list_del(&ew->list);
+			mutex_unlock(&ip_vs_est_mutex);
+
+			cancel_delayed_work_sync(&ew->work);
+			kfree(ew);
+			return;
+		}
+	}
+	mutex_unlock(&ip_vs_est_mutex);
 }
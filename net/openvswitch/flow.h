@@ -166,11 +166,15 @@ struct sw_flow_key_range {
 	unsigned short int end;
 };
 
+#define SW_FLOW_KEY_LONGS	(sizeof(struct sw_flow_key) / sizeof(long))
+
 struct sw_flow_mask {
 	int ref_count;
 	struct rcu_head rcu;
 	struct sw_flow_key_range range;
 	struct sw_flow_key key;
+	/* Words of 'key' within 'range' which are not zero. */
+	DECLARE_BITMAP(words, SW_FLOW_KEY_LONGS);
 };
 
 struct sw_flow_match {
@@ -13,6 +13,7 @@
 #include <linux/if_vlan.h>
 #include <net/llc_pdu.h>
 #include <linux/kernel.h>
+#include <linux/bitmap.h>
 #include <linux/jhash.h>
 #include <linux/jiffies.h>
 #include <linux/llc.h>
@@ -649,15 +650,26 @@ int ovs_flow_tbl_flush(struct flow_table *flow_table)
 	return -ENOMEM;
 }
 
-static u32 flow_hash(const struct sw_flow_key *key,
-		     const struct sw_flow_key_range *range)
+/* Masks usually select a few fields spread over a large part of the key.
+ * Lookups only mask, hash and compare the words 'mask' has bits set in,
+ * packed into 'buf'.  Returns the number of words in 'buf'.
+ */
+static int flow_mask_gather(long *buf, const struct sw_flow_key *key,
+			    const struct sw_flow_mask *mask)
 {
-	const u32 *hash_key = (const u32 *)((const u8 *)key + range->start);
+	const long *k = (const long *)key;
+	const long *m = (const long *)&mask->key;
+	int i, n = 0;
+
+	for_each_set_bit(i, mask->words, SW_FLOW_KEY_LONGS)
+		buf[n++] = k[i] & m[i];
 
-	/* Make sure number of hash bytes are multiple of u32. */
-	int hash_u32s = range_n_bytes(range) >> 2;
+	return n;
+}
 
-	return jhash2(hash_key, hash_u32s, 0);
+static u32 flow_hash(const long *buf, int n)
+{
+	return jhash2((const u32 *)buf, n * (sizeof(long) / sizeof(u32)), 0);
 }
 
 static int flow_key_start(const struct sw_flow_key *key)
@@ -684,11 +696,18 @@ static bool cmp_key(const struct sw_flow_key *key1,
 	return diffs == 0;
 }
 
-static bool flow_cmp_masked_key(const struct sw_flow *flow,
-				const struct sw_flow_key *key,
-				const struct sw_flow_key_range *range)
+/* The words of flow->key outside of mask->words are zero. */
+static bool flow_cmp_masked_key(const struct sw_flow *flow, const long *buf,
+				const struct sw_flow_mask *mask)
 {
-	return cmp_key(&flow->key, key, range->start, range->end);
+	const long *k = (const long *)&flow->key;
+	long diffs = 0;
+	int i, n = 0;
+
+	for_each_set_bit(i, mask->words, SW_FLOW_KEY_LONGS)
+		diffs |= k[i] ^ buf[n++];
+
+	return diffs == 0;
 }
 
 static bool ovs_flow_cmp_unmasked_key(const struct sw_flow *flow,
@@ -710,17 +729,18 @@ static struct sw_flow *masked_flow_lookup(struct table_instance *ti,
 	struct sw_flow *flow;
 	struct hlist_head *head;
 	u32 hash;
-	struct sw_flow_key masked_key;
+	long buf[SW_FLOW_KEY_LONGS];
+	int n;
 
-	ovs_flow_mask_key(&masked_key, unmasked, false, mask);
-	hash = flow_hash(&masked_key, &mask->range);
+	n = flow_mask_gather(buf, unmasked, mask);
+	hash = flow_hash(buf, n);
 	head = find_bucket(ti, hash);
 	(*n_mask_hit)++;
 
 	hlist_for_each_entry_rcu(flow, head, flow_table.node[ti->node_ver],
 				lockdep_ovsl_is_held()) {
 		if (flow->mask == mask && flow->flow_table.hash == hash &&
-		    flow_cmp_masked_key(flow, &masked_key, &mask->range))
+		    flow_cmp_masked_key(flow, buf, mask))
 			return flow;
 	}
 	return NULL;
@@ -905,7 +925,8 @@ static bool ovs_flow_cmp_ufid(const struct sw_flow *flow,
 bool ovs_flow_cmp(const struct sw_flow *flow, const struct sw_flow_match *match)
 {
 	if (ovs_identifier_is_ufid(&flow->id))
-		return flow_cmp_masked_key(flow, match->key, &match->range);
+		return cmp_key(&flow->key, match->key, match->range.start,
+			       match->range.end);
 
 	return ovs_flow_cmp_unmasked_key(flow, match);
 }
@@ -998,6 +1019,18 @@ static struct sw_flow_mask *flow_mask_find(const struct flow_table *tbl,
 	return NULL;
 }
 
+static void flow_mask_set_words(struct sw_flow_mask *mask)
+{
+	const long *m = (const long *)&mask->key;
+	int i;
+
+	bitmap_zero(mask->words, SW_FLOW_KEY_LONGS);
+	for (i = mask->range.start / sizeof(long);
+	     i < DIV_ROUND_UP(mask->range.end, sizeof(long)); i++)
+		if (m[i])
+			__set_bit(i, mask->words);
+}
+
 /* Add 'mask' into the mask list, if it is not already there. */
 static int flow_mask_insert(struct flow_table *tbl, struct sw_flow *flow,
 			    const struct sw_flow_mask *new)
@@ -1012,6 +1045,7 @@ static int flow_mask_insert(struct flow_table *tbl, struct sw_flow *flow,
 			return -ENOMEM;
 		mask->key = new->key;
 		mask->range = new->range;
+		flow_mask_set_words(mask);
 
 		/* Add mask to mask-list. */
 		if (tbl_mask_array_add_mask(tbl, mask)) {
@@ -1032,8 +1066,10 @@ static void flow_key_insert(struct flow_table *table, struct sw_flow *flow)
 {
 	struct table_instance *new_ti = NULL;
 	struct table_instance *ti;
+	long buf[SW_FLOW_KEY_LONGS];
 
-	flow->flow_table.hash = flow_hash(&flow->key, &flow->mask->range);
+	flow->flow_table.hash = flow_hash(buf, flow_mask_gather(buf, &flow->key,
+								flow->mask));
 	ti = ovsl_dereference(table->ti);
 	table_instance_insert(ti, flow);
 	table->count++;
@@ -195,7 +195,7 @@ static void prb_retire_current_block(struct tpacket_kbdq_core *,
 static int prb_queue_frozen(struct tpacket_kbdq_core *);
 static void prb_open_block(struct tpacket_kbdq_core *,
 		struct tpacket_block_desc *);
-static void prb_retire_rx_blk_timer_expired(struct timer_list *);
+static enum hrtimer_restart prb_retire_rx_blk_timer_expired(struct hrtimer *);
 static void _prb_refresh_rx_retire_blk_timer(struct tpacket_kbdq_core *);
 static void prb_fill_rxhash(struct tpacket_kbdq_core *, struct tpacket3_hdr *);
 static void prb_clear_rxhash(struct tpacket_kbdq_core *,
@@ -496,7 +496,7 @@ static void *packet_current_frame(struct packet_sock *po,
 
 static void prb_del_retire_blk_timer(struct tpacket_kbdq_core *pkc)
 {
-	del_timer_sync(&pkc->retire_blk_timer);
+	hrtimer_cancel(&pkc->retire_blk_timer);
 }
 
 static void prb_shutdown_retire_blk_timer(struct packet_sock *po,
@@ -518,9 +518,9 @@ static void prb_setup_retire_blk_timer(struct packet_sock *po)
 	struct tpacket_kbdq_core *pkc;
 
 	pkc = GET_PBDQC_FROM_RB(&po->rx_ring);
-	timer_setup(&pkc->retire_blk_timer, prb_retire_rx_blk_timer_expired,
-		    0);
-	pkc->retire_blk_timer.expires = jiffies;
+	hrtimer_init(&pkc->retire_blk_timer, CLOCK_MONOTONIC,
+		     HRTIMER_MODE_REL_SOFT);
+	pkc->retire_blk_timer.function = prb_retire_rx_blk_timer_expired;
 }
 
 static int prb_calc_retire_blk_tmo(struct packet_sock *po,
@@ -586,12 +586,22 @@ static void init_prb_bdqc(struct packet_sock *po,
 	p1->version = po->tp_version;
 	p1->last_kactive_blk_num = 0;
 	po->stats.stats3.tp_freeze_q_cnt = 0;
-	if (req_u->req3.tp_retire_blk_tov)
+	if (req_u->req3.tp_retire_blk_tov) {
 		p1->retire_blk_tov = req_u->req3.tp_retire_blk_tov;
-	else
+		if (req_u->req3.tp_feature_req_word &
+		    TP_FT_REQ_RETIRE_BLK_USEC) {
+			p1->retire_blk_tov = max_t(unsigned int,
+						   p1->retire_blk_tov,
+						   MIN_PRB_RETIRE_TOV_USEC);
+			p1->interval_ktime = us_to_ktime(p1->retire_blk_tov);
+		} else {
+			p1->interval_ktime = ms_to_ktime(p1->retire_blk_tov);
+		}
+	} else {
 		p1->retire_blk_tov = prb_calc_retire_blk_tmo(po,
 						req_u->req3.tp_block_size);
-	p1->tov_in_jiffies = msecs_to_jiffies(p1->retire_blk_tov);
+		p1->interval_ktime = ms_to_ktime(p1->retire_blk_tov);
+	}
 	p1->blk_sizeof_priv = req_u->req3.tp_sizeof_priv;
 	rwlock_init(&p1->blk_fill_in_prog_lock);
 
@@ -606,8 +616,8 @@ static void init_prb_bdqc(struct packet_sock *po,
  */
 static void _prb_refresh_rx_retire_blk_timer(struct tpacket_kbdq_core *pkc)
 {
-	mod_timer(&pkc->retire_blk_timer,
-			jiffies + pkc->tov_in_jiffies);
+	hrtimer_start(&pkc->retire_blk_timer, pkc->interval_ktime,
+		      HRTIMER_MODE_REL_SOFT);
 	pkc->last_kactive_blk_num = pkc->kactive_blk_num;
 }
 
@@ -633,11 +643,16 @@ static void _prb_refresh_rx_retire_blk_timer(struct tpacket_kbdq_core *pkc)
  * a) line-speed and b) block-size.
  * prb_calc_retire_blk_tmo() calculates the tmo.
  *
+ * The timer is an hrtimer, so with TP_FT_REQ_RETIRE_BLK_USEC the 'tmo'
+ * can be set in usecs for low rate traffic that must not wait for a
+ * jiffy based timeout, down to MIN_PRB_RETIRE_TOV_USEC. It is rearmed by
+ * _prb_refresh_rx_retire_blk_timer() whenever it has to keep running,
+ * hence it never restarts itself.
  */
-static void prb_retire_rx_blk_timer_expired(struct timer_list *t)
+static enum hrtimer_restart prb_retire_rx_blk_timer_expired(struct hrtimer *t)
 {
-	struct packet_sock *po =
-		from_timer(po, t, rx_ring.prb_bdqc.retire_blk_timer);
+	struct packet_sock *po = container_of(t, struct packet_sock,
+					rx_ring.prb_bdqc.retire_blk_timer);
 	struct tpacket_kbdq_core *pkc = GET_PBDQC_FROM_RB(&po->rx_ring);
 	unsigned int frozen;
 	struct tpacket_block_desc *pbd;
@@ -705,6 +720,7 @@ static void prb_retire_rx_blk_timer_expired(struct timer_list *t)
 
 out:
 	spin_unlock(&po->sk.sk_receive_queue.lock);
+	return HRTIMER_NORESTART;
 }
 
 static void prb_flush_block(struct tpacket_kbdq_core *pkc1,
@@ -947,6 +963,28 @@ static void prb_clear_blk_fill_status(struct packet_ring_buffer *rb)
 	read_unlock(&pkc->blk_fill_in_prog_lock);
 }
 
+/* PACKET_RETIRE_BLK_PKTS: hand the current block to user-space as soon as
+ * it holds that many packets, instead of waiting for it to fill up or for
+ * the retire timer. Called once the packet has been copied.
+ */
+static void prb_retire_rx_blk_by_count(struct packet_sock *po)
+{
+	unsigned int pkts = READ_ONCE(po->tp_retire_blk_pkts);
+	struct tpacket_kbdq_core *pkc = GET_PBDQC_FROM_RB(&po->rx_ring);
+	struct tpacket_block_desc *pbd;
+
+	if (!pkts)
+		return;
+
+	spin_lock(&po->sk.sk_receive_queue.lock);
+	pbd = GET_CURR_PBLOCK_DESC_FROM_CORE(pkc);
+	if (!prb_queue_frozen(pkc) && BLOCK_NUM_PKTS(pbd) >= pkts) {
+		prb_retire_current_block(pkc, po, 0);
+		prb_dispatch_next_block(pkc, po);
+	}
+	spin_unlock(&po->sk.sk_receive_queue.lock);
+}
+
 static void prb_fill_rxhash(struct tpacket_kbdq_core *pkc,
 			struct tpacket3_hdr *ppd)
 {
@@ -1338,6 +1376,21 @@ static unsigned int fanout_demux_cpu(struct packet_fanout *f,
 	return smp_processor_id() % num;
 }
 
+/* Members are pinned to a CPU with SO_INCOMING_CPU before they join, so
+ * each CPU writes into a ring of its own and, with RSS steering a flow to
+ * one CPU, a flow always lands in the same ring. CPUs without a member of
+ * their own fall back to PACKET_FANOUT_CPU behaviour.
+ */
+static unsigned int fanout_demux_cpu_pinned(struct packet_fanout *f,
+					    struct sk_buff *skb,
+					    unsigned int num)
+{
+	unsigned int cpu = smp_processor_id();
+	unsigned int idx = READ_ONCE(f->cpu_map[cpu]);
+
+	return idx < num ? idx : cpu % num;
+}
+
 static unsigned int fanout_demux_rnd(struct packet_fanout *f,
 				     struct sk_buff *skb,
 				     unsigned int num)
@@ -1442,6 +1495,9 @@ static int packet_rcv_fanout(struct sk_buff *skb, struct net_device *dev,
 	case PACKET_FANOUT_CPU:
 		idx = fanout_demux_cpu(f, skb, num);
 		break;
+	case PACKET_FANOUT_CPU_PINNED:
+		idx = fanout_demux_cpu_pinned(f, skb, num);
+		break;
 	case PACKET_FANOUT_RND:
 		idx = fanout_demux_rnd(f, skb, num);
 		break;
@@ -1469,6 +1525,24 @@ EXPORT_SYMBOL_GPL(fanout_mutex);
 static LIST_HEAD(fanout_list);
 static u16 fanout_next_id;
 
+/* Rebuild the CPU to member map after the member array changed */
+static void fanout_update_cpu_map(struct packet_fanout *f)
+{
+	unsigned int i;
+	int cpu;
+
+	if (f->type != PACKET_FANOUT_CPU_PINNED)
+		return;
+
+	for_each_possible_cpu(cpu)
+		WRITE_ONCE(f->cpu_map[cpu], U16_MAX);
+	for (i = 0; i < f->num_members; i++) {
+		cpu = READ_ONCE(f->arr[i]->sk_incoming_cpu);
+		if (cpu >= 0 && cpu < nr_cpu_ids)
+			WRITE_ONCE(f->cpu_map[cpu], i);
+	}
+}
+
 static void __fanout_link(struct sock *sk, struct packet_sock *po)
 {
 	struct packet_fanout *f = po->fanout;
@@ -1477,6 +1551,7 @@ static void __fanout_link(struct sock *sk, struct packet_sock *po)
 	f->arr[f->num_members] = sk;
 	smp_wmb();
 	f->num_members++;
+	fanout_update_cpu_map(f);
 	if (f->num_members == 1)
 		dev_add_pack(&f->prot_hook);
 	spin_unlock(&f->lock);
@@ -1495,6 +1570,7 @@ static void __fanout_unlink(struct sock *sk, struct packet_sock *po)
 	BUG_ON(i >= f->num_members);
 	f->arr[i] = f->arr[f->num_members - 1];
 	f->num_members--;
+	fanout_update_cpu_map(f);
 	if (f->num_members == 0)
 		__dev_remove_pack(&f->prot_hook);
 	spin_unlock(&f->lock);
@@ -1508,7 +1584,7 @@ static bool match_fanout_group(struct packet_type *ptype, struct sock *sk)
 	return ptype->af_packet_priv == pkt_sk(sk)->fanout;
 }
 
-static void fanout_init_data(struct packet_fanout *f)
+static int fanout_init_data(struct packet_fanout *f)
 {
 	switch (f->type) {
 	case PACKET_FANOUT_LB:
@@ -1518,7 +1594,15 @@ static void fanout_init_data(struct packet_fanout *f)
 	case PACKET_FANOUT_EBPF:
 		RCU_INIT_POINTER(f->bpf_prog, NULL);
 		break;
+	case PACKET_FANOUT_CPU_PINNED:
+		f->cpu_map = kmalloc_array(nr_cpu_ids, sizeof(*f->cpu_map),
+					   GFP_KERNEL);
+		if (!f->cpu_map)
+			return -ENOMEM;
+		memset(f->cpu_map, 0xff, nr_cpu_ids * sizeof(*f->cpu_map));
+		break;
 	}
+	return 0;
 }
 
 static void __fanout_set_data_bpf(struct packet_fanout *f, struct bpf_prog *new)
@@ -1598,6 +1682,10 @@ static void fanout_release_data(struct packet_fanout *f)
 	case PACKET_FANOUT_CBPF:
 	case PACKET_FANOUT_EBPF:
 		__fanout_set_data_bpf(f, NULL);
+		break;
+	case PACKET_FANOUT_CPU_PINNED:
+		kfree(f->cpu_map);
+		break;
 	}
 }
 
@@ -1647,6 +1735,7 @@ static int fanout_add(struct sock *sk, u16 id, u16 type_flags)
 	case PACKET_FANOUT_HASH:
 	case PACKET_FANOUT_LB:
 	case PACKET_FANOUT_CPU:
+	case PACKET_FANOUT_CPU_PINNED:
 	case PACKET_FANOUT_RND:
 	case PACKET_FANOUT_QM:
 	case PACKET_FANOUT_CBPF:
@@ -1709,7 +1798,10 @@ static int fanout_add(struct sock *sk, u16 id, u16 type_flags)
 		INIT_LIST_HEAD(&match->list);
 		spin_lock_init(&match->lock);
 		refcount_set(&match->sk_ref, 0);
-		fanout_init_data(match);
+		if (fanout_init_data(match)) {
+			kfree(match);
+			goto out;
+		}
 		match->prot_hook.type = po->prot_hook.type;
 		match->prot_hook.dev = po->prot_hook.dev;
 		match->prot_hook.func = packet_rcv_fanout;
@@ -1739,6 +1831,7 @@ static int fanout_add(struct sock *sk, u16 id, u16 type_flags)
 
 	if (err && !refcount_read(&match->sk_ref)) {
 		list_del(&match->list);
+		fanout_release_data(match);
 		kfree(match);
 	}
 
@@ -2395,6 +2488,7 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,
 		sk->sk_data_ready(sk);
 	} else {
 		prb_clear_blk_fill_status(&po->rx_ring);
+		prb_retire_rx_blk_by_count(po);
 	}
 
 drop_n_restore:
@@ -3883,6 +3977,18 @@ packet_setsockopt(struct socket *sock, int level, int optname, sockptr_t optval,
 		po->prot_hook.ignore_outgoing = !!val;
 		return 0;
 	}
+	case PACKET_RETIRE_BLK_PKTS:
+	{
+		unsigned int val;
+
+		if (optlen != sizeof(val))
+			return -EINVAL;
+		if (copy_from_sockptr(&val, optval, sizeof(val)))
+			return -EFAULT;
+
+		WRITE_ONCE(po->tp_retire_blk_pkts, val);
+		return 0;
+	}
 	case PACKET_TX_HAS_OFF:
 	{
 		unsigned int val;
@@ -4025,6 +4131,9 @@ static int packet_getsockopt(struct socket *sock, int level, int optname,
 	case PACKET_TX_HAS_OFF:
 		val = po->tp_tx_has_off;
 		break;
+	case PACKET_RETIRE_BLK_PKTS:
+		val = po->tp_retire_blk_pkts;
+		break;
 	case PACKET_QDISC_BYPASS:
 		val = packet_use_direct_xmit(po);
 		break;
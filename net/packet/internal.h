@@ -2,6 +2,7 @@
 #ifndef __PACKET_INTERNAL_H__
 #define __PACKET_INTERNAL_H__
 
+#include <linux/hrtimer.h>
 #include <linux/refcount.h>
 
 struct packet_mclist {
@@ -43,13 +44,15 @@ struct tpacket_kbdq_core {
 
 	/* Default is set to 8ms */
 #define DEFAULT_PRB_RETIRE_TOV	(8)
+/* Floor of a TP_FT_REQ_RETIRE_BLK_USEC timeout, keeps the hrtimer sane */
+#define MIN_PRB_RETIRE_TOV_USEC	(50)
 
-	unsigned short  retire_blk_tov;
+	unsigned int	retire_blk_tov;
 	unsigned short  version;
-	unsigned long	tov_in_jiffies;
+	ktime_t		interval_ktime;
 
 	/* timer to retire an outstanding block */
-	struct timer_list retire_blk_timer;
+	struct hrtimer	retire_blk_timer;
 };
 
 struct pgv {
@@ -88,6 +91,7 @@ struct packet_fanout {
 	union {
 		atomic_t		rr_cur;
 		struct bpf_prog __rcu	*bpf_prog;
+		u16			*cpu_map;	/* CPU_PINNED: cpu -> arr[] */
 	};
 	struct list_head	list;
 	struct sock		*arr[PACKET_FANOUT_MAX];
@@ -131,6 +135,7 @@ struct packet_sock {
 	unsigned int		tp_hdrlen;
 	unsigned int		tp_reserve;
 	unsigned int		tp_tstamp;
+	unsigned int		tp_retire_blk_pkts;
 	struct completion	skb_completion;
 	struct net_device __rcu	*cached_dev;
 	int			(*xmit)(struct sk_buff *skb);
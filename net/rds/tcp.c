@@ -258,6 +258,9 @@ static void rds_tcp_tc_info(struct socket *rds_sock, unsigned int len,
 		tsinfo.last_expected_una = tc->t_last_expected_una;
 		tsinfo.last_seen_una = tc->t_last_seen_una;
 		tsinfo.tos = tc->t_cpath->cp_conn->c_tos;
+		tsinfo.xmit_batches = tc->t_xmit_batches;
+		tsinfo.xmit_batch_msgs = tc->t_xmit_batch_msgs;
+		tsinfo.xmit_copied_msgs = tc->t_xmit_copied_msgs;
 
 		rds_info_copy(iter, &tsinfo, sizeof(tsinfo));
 	}
@@ -301,6 +304,9 @@ static void rds6_tcp_tc_info(struct socket *sock, unsigned int len,
 		tsinfo6.last_sent_nxt = tc->t_last_sent_nxt;
 		tsinfo6.last_expected_una = tc->t_last_expected_una;
 		tsinfo6.last_seen_una = tc->t_last_seen_una;
+		tsinfo6.xmit_batches = tc->t_xmit_batches;
+		tsinfo6.xmit_batch_msgs = tc->t_xmit_batch_msgs;
+		tsinfo6.xmit_copied_msgs = tc->t_xmit_copied_msgs;
 
 		rds_info_copy(iter, &tsinfo6, sizeof(tsinfo6));
 	}
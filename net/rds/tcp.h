@@ -38,6 +38,10 @@ struct rds_tcp_connection {
 	u32			t_last_sent_nxt;
 	u32			t_last_expected_una;
 	u32			t_last_seen_una;
+	u64			t_xmit_batches;	/* corked xmit rounds */
+	u64			t_xmit_batch_msgs; /* messages sent in them */
+	u64			t_xmit_copied_msgs; /* sent in one copy */
+	unsigned int		t_xmit_cur_msgs;
 };
 
 struct rds_tcp_statistics {
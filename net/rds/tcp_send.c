@@ -38,6 +38,17 @@
 #include "rds.h"
 #include "tcp.h"
 
+/*
+ * Messages carrying at most this much data are copied into the socket
+ * together with their header in a single sendmsg, instead of a header
+ * sendmsg followed by a sendpage for each fragment.  Within a corked
+ * batch, small messages then fill the socket's segments back to back
+ * rather than adding a page fragment each and running skbs out of
+ * frags well before a full segment.
+ */
+#define RDS_TCP_COPY_MAX	2048
+#define RDS_TCP_COPY_VECS	4
+
 void rds_tcp_xmit_path_prepare(struct rds_conn_path *cp)
 {
 	struct rds_tcp_connection *tc = cp->cp_transport_data;
@@ -45,11 +56,21 @@ void rds_tcp_xmit_path_prepare(struct rds_conn_path *cp)
 	tcp_sock_set_cork(tc->t_sock->sk, true);
 }
 
+/*
+ * Uncorking at the end of each round of rds_send_xmit() is what bounds
+ * the latency of the coalescing: any partial segment goes out now.
+ */
 void rds_tcp_xmit_path_complete(struct rds_conn_path *cp)
 {
 	struct rds_tcp_connection *tc = cp->cp_transport_data;
 
 	tcp_sock_set_cork(tc->t_sock->sk, false);
+
+	if (tc->t_xmit_cur_msgs) {
+		tc->t_xmit_batches++;
+		tc->t_xmit_batch_msgs += tc->t_xmit_cur_msgs;
+		tc->t_xmit_cur_msgs = 0;
+	}
 }
 
 /* the core send_sem serializes this with other xmit and shutdown */
@@ -66,6 +87,47 @@ static int rds_tcp_sendmsg(struct socket *sock, void *data, unsigned int len)
 	return kernel_sendmsg(sock, &msg, &vec, 1, vec.iov_len);
 }
 
+static bool rds_tcp_can_copy(struct rds_message *rm, unsigned int sg)
+{
+	if (be32_to_cpu(rm->m_inc.i_hdr.h_len) > RDS_TCP_COPY_MAX ||
+	    rm->data.op_nents - sg > RDS_TCP_COPY_VECS - 1)
+		return false;
+
+	for (; sg < rm->data.op_nents; sg++) {
+		if (PageHighMem(sg_page(&rm->data.op_sg[sg])))
+			return false;
+	}
+	return true;
+}
+
+/* what is left of the header and the data, in one sendmsg */
+static int rds_tcp_xmit_copy(struct rds_tcp_connection *tc,
+			     struct rds_message *rm, unsigned int hdr_off,
+			     unsigned int sg, unsigned int off)
+{
+	struct kvec vec[RDS_TCP_COPY_VECS];
+	struct msghdr msg = {
+		.msg_flags = MSG_DONTWAIT | MSG_NOSIGNAL,
+	};
+	size_t len = 0;
+	int n = 0;
+
+	if (hdr_off < sizeof(struct rds_header)) {
+		vec[n].iov_base = (void *)&rm->m_inc.i_hdr + hdr_off;
+		vec[n].iov_len = sizeof(struct rds_header) - hdr_off;
+		len += vec[n++].iov_len;
+	}
+	for (; sg < rm->data.op_nents; sg++, off = 0) {
+		struct scatterlist *sgl = &rm->data.op_sg[sg];
+
+		vec[n].iov_base = sg_virt(sgl) + off;
+		vec[n].iov_len = sgl->length - off;
+		len += vec[n++].iov_len;
+	}
+
+	return kernel_sendmsg(tc->t_sock, &msg, vec, n, len);
+}
+
 /* the core send_sem serializes this with other xmit and shutdown */
 int rds_tcp_xmit(struct rds_connection *conn, struct rds_message *rm,
 		 unsigned int hdr_off, unsigned int sg, unsigned int off)
@@ -95,6 +157,21 @@ int rds_tcp_xmit(struct rds_connection *conn, struct rds_message *rm,
 		rdsdebug("rm %p tcp nxt %u ack_seq %llu\n",
 			 rm, rds_tcp_write_seq(tc),
 			 (unsigned long long)rm->m_ack_seq);
+
+		tc->t_xmit_cur_msgs++;
+	}
+
+	if (rds_tcp_can_copy(rm, sg)) {
+		if (hdr_off == 0)
+			tc->t_xmit_copied_msgs++;
+
+		/* see rds_tcp_write_space() */
+		set_bit(SOCK_NOSPACE, &tc->t_sock->sk->sk_socket->flags);
+
+		ret = rds_tcp_xmit_copy(tc, rm, hdr_off, sg, off);
+		if (ret > 0)
+			done = ret;
+		goto out;
 	}
 
 	if (hdr_off < sizeof(struct rds_header)) {
@@ -34,6 +34,12 @@
 #define RPCDBG_FACILITY	RPCDBG_SVCDSP
 
 static void svc_unregister(const struct svc_serv *serv, struct net *net);
+static void svc_auto_threads_work(struct work_struct *work);
+static void svc_auto_threads_stop(struct svc_serv *serv);
+
+/* Autoscaling round, and rounds without congestion before a thread goes */
+#define SVC_AUTO_PERIOD		(HZ / 10)
+#define SVC_AUTO_CALM_ROUNDS	100
 
 #define svc_serv_is_pooled(serv)    ((serv)->sv_ops->svo_function)
 
@@ -458,6 +464,7 @@ __svc_create(struct svc_program *prog, unsigned int bufsize, int npools,
 	INIT_LIST_HEAD(&serv->sv_permsocks);
 	timer_setup(&serv->sv_temptimer, NULL, 0);
 	spin_lock_init(&serv->sv_lock);
+	INIT_DELAYED_WORK(&serv->sv_auto_work, svc_auto_threads_work);
 
 	__svc_init_bc(serv);
 
@@ -477,7 +484,7 @@ __svc_create(struct svc_program *prog, unsigned int bufsize, int npools,
 				i, serv->sv_name);
 
 		pool->sp_id = i;
-		INIT_LIST_HEAD(&pool->sp_sockets);
+		init_llist_head(&pool->sp_xprts);
 		INIT_LIST_HEAD(&pool->sp_all_threads);
 		spin_lock_init(&pool->sp_lock);
 	}
@@ -539,6 +546,7 @@ svc_destroy(struct svc_serv *serv)
 		printk("svc_destroy: no threads for serv=%p!\n", serv);
 
 	del_timer_sync(&serv->sv_temptimer);
+	cancel_delayed_work_sync(&serv->sv_auto_work);
 
 	/*
 	 * The last user is gone and thus all sockets have to be destroyed to
@@ -779,6 +787,8 @@ svc_signal_kthreads(struct svc_serv *serv, struct svc_pool *pool, int nrservs)
 int
 svc_set_num_threads(struct svc_serv *serv, struct svc_pool *pool, int nrservs)
 {
+	svc_auto_threads_stop(serv);
+
 	if (pool == NULL) {
 		/* The -1 assumes caller has done a svc_get() */
 		nrservs -= (serv->sv_nrthreads-1);
@@ -817,6 +827,8 @@ svc_stop_kthreads(struct svc_serv *serv, struct svc_pool *pool, int nrservs)
 int
 svc_set_num_threads_sync(struct svc_serv *serv, struct svc_pool *pool, int nrservs)
 {
+	svc_auto_threads_stop(serv);
+
 	if (pool == NULL) {
 		/* The -1 assumes caller has done a svc_get() */
 		nrservs -= (serv->sv_nrthreads-1);
@@ -834,6 +846,113 @@ svc_set_num_threads_sync(struct svc_serv *serv, struct svc_pool *pool, int nrser
 }
 EXPORT_SYMBOL_GPL(svc_set_num_threads_sync);
 
+static unsigned int svc_auto_nrthreads(struct svc_serv *serv)
+{
+	unsigned int i, n = 0;
+
+	for (i = 0; i < serv->sv_nrpools; i++)
+		n += READ_ONCE(serv->sv_pools[i].sp_nrthreads);
+	return n;
+}
+
+/*
+ * One autoscaling round.  A pool whose transports have been waiting for
+ * a thread for longer than a round gets one more thread, a pool which
+ * has not run out of threads for SVC_AUTO_CALM_ROUNDS rounds gives one
+ * back, within the range set by svc_set_auto_threads().
+ */
+static void svc_auto_threads_work(struct work_struct *work)
+{
+	struct svc_serv *serv = container_of(to_delayed_work(work),
+					     struct svc_serv, sv_auto_work);
+	unsigned int i, nrthreads;
+
+	/* Callers of svc_set_num_threads() may be cancelling this work */
+	if (!mutex_trylock(serv->sv_ops->svo_mutex)) {
+		schedule_delayed_work(&serv->sv_auto_work, SVC_AUTO_PERIOD);
+		return;
+	}
+	if (!serv->sv_auto_max)
+		goto out_unlock;
+
+	nrthreads = svc_auto_nrthreads(serv);
+	for (i = 0; i < serv->sv_nrpools; i++) {
+		struct svc_pool *pool = &serv->sv_pools[i];
+
+		if (test_and_clear_bit(SP_AUTO_BUSY, &pool->sp_flags) ||
+		    test_bit(SP_CONGESTED, &pool->sp_flags)) {
+			pool->sp_auto_calm = 0;
+			if (test_bit(SP_CONGESTED, &pool->sp_flags) &&
+			    time_after(jiffies, READ_ONCE(pool->sp_congested) +
+						SVC_AUTO_PERIOD) &&
+			    nrthreads < serv->sv_auto_max &&
+			    !svc_start_kthreads(serv, pool, 1))
+				nrthreads++;
+		} else if (++pool->sp_auto_calm >= SVC_AUTO_CALM_ROUNDS) {
+			pool->sp_auto_calm = 0;
+			if (nrthreads > serv->sv_auto_min &&
+			    pool->sp_nrthreads > 1) {
+				svc_signal_kthreads(serv, pool, -1);
+				nrthreads--;
+			}
+		}
+	}
+	schedule_delayed_work(&serv->sv_auto_work, SVC_AUTO_PERIOD);
+out_unlock:
+	mutex_unlock(serv->sv_ops->svo_mutex);
+}
+
+static void svc_auto_threads_stop(struct svc_serv *serv)
+{
+	if (!serv->sv_auto_max)
+		return;
+	serv->sv_auto_max = 0;
+	cancel_delayed_work_sync(&serv->sv_auto_work);
+}
+
+/**
+ * svc_set_auto_threads - let the number of threads follow the load
+ * @serv: RPC service, created with svc_create_pooled()
+ * @min: fewest threads to keep running
+ * @max: most threads to run, 0 to stop autoscaling
+ *
+ * Starts or stops threads to bring their number within [@min, @max],
+ * then adds threads to pools where transports wait for one and removes
+ * them from pools which stay idle.  Setting a fixed number of threads
+ * with svc_set_num_threads() stops autoscaling.
+ *
+ * The caller must hold the service mutex named in the svc_serv_ops.
+ */
+int svc_set_auto_threads(struct svc_serv *serv, unsigned int min,
+			 unsigned int max)
+{
+	unsigned int nrthreads;
+	int ret = 0;
+
+	if (!serv->sv_ops->svo_mutex || !serv->sv_ops->svo_function ||
+	    min > max)
+		return -EINVAL;
+	lockdep_assert_held(serv->sv_ops->svo_mutex);
+
+	svc_auto_threads_stop(serv);
+	if (!max)
+		return 0;
+
+	nrthreads = svc_auto_nrthreads(serv);
+	if (nrthreads < min)
+		ret = svc_start_kthreads(serv, NULL, min - nrthreads);
+	else if (nrthreads > max)
+		ret = svc_signal_kthreads(serv, NULL, max - nrthreads);
+	if (ret)
+		return ret;
+
+	serv->sv_auto_min = min;
+	serv->sv_auto_max = max;
+	schedule_delayed_work(&serv->sv_auto_work, SVC_AUTO_PERIOD);
+	return 0;
+}
+EXPORT_SYMBOL_GPL(svc_set_auto_threads);
+
 /*
  * Called from a server thread as it's exiting. Caller must hold the "service
  * mutex" for the service.
@@ -46,6 +46,8 @@ static LIST_HEAD(svc_xprt_class_list);
 /* SMP locking strategy:
  *
  *	svc_pool->sp_lock protects most of the fields of that pool.
+ *	Transports are queued on svc_pool->sp_xprts without it, only
+ *	threads taking them off the queue serialize on sp_lock.
  *	svc_serv->sv_lock protects sv_tempsocks, sv_permsocks, sv_tmpcnt.
  *	when both need to be taken (rare), svc_serv->sv_lock is first.
  *	The "service mutex" protects svc_serv->sv_nrthread.
@@ -177,7 +179,6 @@ void svc_xprt_init(struct net *net, struct svc_xprt_class *xcl,
 	kref_init(&xprt->xpt_ref);
 	xprt->xpt_server = serv;
 	INIT_LIST_HEAD(&xprt->xpt_list);
-	INIT_LIST_HEAD(&xprt->xpt_ready);
 	INIT_LIST_HEAD(&xprt->xpt_deferred);
 	INIT_LIST_HEAD(&xprt->xpt_users);
 	mutex_init(&xprt->xpt_mutex);
@@ -427,10 +428,8 @@ void svc_xprt_do_enqueue(struct svc_xprt *xprt)
 
 	atomic_long_inc(&pool->sp_stats.packets);
 
-	spin_lock_bh(&pool->sp_lock);
-	list_add_tail(&xprt->xpt_ready, &pool->sp_sockets);
-	pool->sp_stats.sockets_queued++;
-	spin_unlock_bh(&pool->sp_lock);
+	llist_add(&xprt->xpt_ready, &pool->sp_xprts);
+	atomic_long_inc(&pool->sp_stats.sockets_queued);
 
 	/* find a thread for this xprt */
 	rcu_read_lock();
@@ -442,7 +441,9 @@ void svc_xprt_do_enqueue(struct svc_xprt *xprt)
 		wake_up_process(rqstp->rq_task);
 		goto out_unlock;
 	}
-	set_bit(SP_CONGESTED, &pool->sp_flags);
+	if (!test_and_set_bit(SP_CONGESTED, &pool->sp_flags))
+		WRITE_ONCE(pool->sp_congested, jiffies);
+	set_bit(SP_AUTO_BUSY, &pool->sp_flags);
 	rqstp = NULL;
 out_unlock:
 	rcu_read_unlock();
@@ -464,21 +465,32 @@ void svc_xprt_enqueue(struct svc_xprt *xprt)
 }
 EXPORT_SYMBOL_GPL(svc_xprt_enqueue);
 
+static bool svc_pool_has_xprts(struct svc_pool *pool)
+{
+	return READ_ONCE(pool->sp_ready) || !llist_empty(&pool->sp_xprts);
+}
+
 /*
  * Dequeue the first transport, if there is one.
+ *
+ * sp_xprts is in LIFO order, so when sp_ready runs out the whole of
+ * it is taken over and reversed, leaving sp_ready oldest first.
  */
 static struct svc_xprt *svc_xprt_dequeue(struct svc_pool *pool)
 {
 	struct svc_xprt	*xprt = NULL;
+	struct llist_node *node;
 
-	if (list_empty(&pool->sp_sockets))
+	if (!svc_pool_has_xprts(pool))
 		goto out;
 
 	spin_lock_bh(&pool->sp_lock);
-	if (likely(!list_empty(&pool->sp_sockets))) {
-		xprt = list_first_entry(&pool->sp_sockets,
-					struct svc_xprt, xpt_ready);
-		list_del_init(&xprt->xpt_ready);
+	node = pool->sp_ready;
+	if (!node)
+		node = llist_reverse_order(llist_del_all(&pool->sp_xprts));
+	if (likely(node)) {
+		WRITE_ONCE(pool->sp_ready, node->next);
+		xprt = llist_entry(node, struct svc_xprt, xpt_ready);
 		svc_xprt_get(xprt);
 	}
 	spin_unlock_bh(&pool->sp_lock);
@@ -693,7 +705,7 @@ rqst_should_sleep(struct svc_rqst *rqstp)
 		return false;
 
 	/* was a socket queued? */
-	if (!list_empty(&pool->sp_sockets))
+	if (svc_pool_has_xprts(pool))
 		return false;
 
 	/* are we shutting down? */
@@ -1028,7 +1040,6 @@ static void svc_delete_xprt(struct svc_xprt *xprt)
 
 	spin_lock_bh(&serv->sv_lock);
 	list_del_init(&xprt->xpt_list);
-	WARN_ON_ONCE(!list_empty(&xprt->xpt_ready));
 	if (test_bit(XPT_TEMP, &xprt->xpt_flags))
 		serv->sv_tmpcnt--;
 	spin_unlock_bh(&serv->sv_lock);
@@ -1076,19 +1087,26 @@ static int svc_close_list(struct svc_serv *serv, struct list_head *xprt_list, st
 
 static struct svc_xprt *svc_dequeue_net(struct svc_serv *serv, struct net *net)
 {
+	struct llist_node **pos;
 	struct svc_pool *pool;
 	struct svc_xprt *xprt;
-	struct svc_xprt *tmp;
 	int i;
 
 	for (i = 0; i < serv->sv_nrpools; i++) {
 		pool = &serv->sv_pools[i];
 
 		spin_lock_bh(&pool->sp_lock);
-		list_for_each_entry_safe(xprt, tmp, &pool->sp_sockets, xpt_ready) {
+		/* Append the lockless queue so that all of it can be searched */
+		for (pos = &pool->sp_ready; *pos; pos = &(*pos)->next)
+			;
+		WRITE_ONCE(*pos,
+			   llist_reverse_order(llist_del_all(&pool->sp_xprts)));
+
+		for (pos = &pool->sp_ready; *pos; pos = &(*pos)->next) {
+			xprt = llist_entry(*pos, struct svc_xprt, xpt_ready);
 			if (xprt->xpt_net != net)
 				continue;
-			list_del_init(&xprt->xpt_ready);
+			WRITE_ONCE(*pos, xprt->xpt_ready.next);
 			spin_unlock_bh(&pool->sp_lock);
 			return xprt;
 		}
@@ -1407,7 +1425,7 @@ static int svc_pool_stats_show(struct seq_file *m, void *p)
 	seq_printf(m, "%u %lu %lu %lu %lu\n",
 		pool->sp_id,
 		(unsigned long)atomic_long_read(&pool->sp_stats.packets),
-		pool->sp_stats.sockets_queued,
+		(unsigned long)atomic_long_read(&pool->sp_stats.sockets_queued),
 		(unsigned long)atomic_long_read(&pool->sp_stats.threads_woken),
 		(unsigned long)atomic_long_read(&pool->sp_stats.threads_timedout));
 
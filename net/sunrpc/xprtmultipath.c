@@ -10,9 +10,11 @@
 #include <linux/types.h>
 #include <linux/kref.h>
 #include <linux/list.h>
+#include <linux/moduleparam.h>
 #include <linux/rcupdate.h>
 #include <linux/rculist.h>
 #include <linux/slab.h>
+#include <linux/smp.h>
 #include <asm/cmpxchg.h>
 #include <linux/spinlock.h>
 #include <linux/sunrpc/xprt.h>
@@ -25,6 +27,11 @@ typedef struct rpc_xprt *(*xprt_switch_find_xprt_t)(struct rpc_xprt_switch *xps,
 static const struct rpc_xprt_iter_ops rpc_xprt_iter_singular;
 static const struct rpc_xprt_iter_ops rpc_xprt_iter_roundrobin;
 static const struct rpc_xprt_iter_ops rpc_xprt_iter_listall;
+static const struct rpc_xprt_iter_ops rpc_xprt_iter_cpuaffine;
+
+static bool xprt_cpu_affine = true;
+module_param(xprt_cpu_affine, bool, 0644);
+MODULE_PARM_DESC(xprt_cpu_affine, "Prefer the same transport for requests from the same CPU when a client has several");
 
 static void xprt_switch_add_xprt_locked(struct rpc_xprt_switch *xps,
 		struct rpc_xprt *xprt)
@@ -176,6 +183,35 @@ void rpc_xprt_switch_set_roundrobin(struct rpc_xprt_switch *xps)
 		WRITE_ONCE(xps->xps_iter_ops, &rpc_xprt_iter_roundrobin);
 }
 
+/**
+ * rpc_xprt_switch_set_cpuaffine - Set a CPU affine policy on rpc_xprt_switch
+ * @xps: pointer to struct rpc_xprt_switch
+ *
+ * Sets a default policy for iterators acting on xps where each CPU
+ * sticks to one of the transports, spilling over round-robin when that
+ * transport is carrying much more than its share of the requests.
+ */
+void rpc_xprt_switch_set_cpuaffine(struct rpc_xprt_switch *xps)
+{
+	if (READ_ONCE(xps->xps_iter_ops) != &rpc_xprt_iter_cpuaffine)
+		WRITE_ONCE(xps->xps_iter_ops, &rpc_xprt_iter_cpuaffine);
+}
+
+/**
+ * rpc_xprt_switch_set_multipath - Set the multipath policy on rpc_xprt_switch
+ * @xps: pointer to struct rpc_xprt_switch
+ *
+ * Sets the default policy for a switch with more than one transport,
+ * CPU affine unless disabled with the xprt_cpu_affine parameter.
+ */
+void rpc_xprt_switch_set_multipath(struct rpc_xprt_switch *xps)
+{
+	if (READ_ONCE(xprt_cpu_affine))
+		rpc_xprt_switch_set_cpuaffine(xps);
+	else
+		rpc_xprt_switch_set_roundrobin(xps);
+}
+
 static
 const struct rpc_xprt_iter_ops *xprt_iter_ops(const struct rpc_xprt_iter *xpi)
 {
@@ -358,6 +394,51 @@ struct rpc_xprt *xprt_iter_next_entry_roundrobin(struct rpc_xprt_iter *xpi)
 			xprt_switch_find_next_entry_roundrobin);
 }
 
+static
+struct rpc_xprt *xprt_switch_find_nth_entry(struct list_head *head,
+		unsigned int n)
+{
+	struct rpc_xprt *pos;
+
+	list_for_each_entry_rcu(pos, head, xprt_switch) {
+		if (xprt_is_active(pos) && n-- == 0)
+			return pos;
+	}
+	return NULL;
+}
+
+static
+struct rpc_xprt *xprt_iter_next_entry_cpuaffine(struct rpc_xprt_iter *xpi)
+{
+	struct rpc_xprt_switch *xps = rcu_dereference(xpi->xpi_xpswitch);
+	unsigned long xprt_queuelen, xps_queuelen;
+	struct rpc_xprt *xprt;
+	unsigned int nactive;
+
+	if (xps == NULL)
+		return NULL;
+	nactive = READ_ONCE(xps->xps_nactive);
+	if (nactive == 0)
+		return NULL;
+
+	/*
+	 * Keeping each CPU on one transport spreads the callers contending
+	 * for a transport_lock over all of them, and leaves the shared
+	 * cursor alone.  Only move on when this transport has more than
+	 * twice the average queue length, so that a few busy CPUs still
+	 * get to use every connection.
+	 */
+	xprt = xprt_switch_find_nth_entry(&xps->xps_xprt_list,
+			raw_smp_processor_id() % nactive);
+	if (xprt != NULL) {
+		xprt_queuelen = atomic_long_read(&xprt->queuelen);
+		xps_queuelen = atomic_long_read(&xps->xps_queuelen);
+		if (xprt_queuelen * nactive <= 2 * xps_queuelen)
+			return xprt;
+	}
+	return xprt_iter_next_entry_roundrobin(xpi);
+}
+
 static
 struct rpc_xprt *xprt_switch_find_next_entry_all(struct rpc_xprt_switch *xps,
 		const struct rpc_xprt *cur)
@@ -532,6 +613,14 @@ const struct rpc_xprt_iter_ops rpc_xprt_iter_roundrobin = {
 	.xpi_next = xprt_iter_next_entry_roundrobin,
 };
 
+/* Policy for per-CPU iteration of entries in the rpc_xprt_switch */
+static
+const struct rpc_xprt_iter_ops rpc_xprt_iter_cpuaffine = {
+	.xpi_rewind = xprt_iter_default_rewind,
+	.xpi_xprt = xprt_iter_current_entry,
+	.xpi_next = xprt_iter_next_entry_cpuaffine,
+};
+
 /* Policy for once-through iteration of entries in the rpc_xprt_switch */
 static
 const struct rpc_xprt_iter_ops rpc_xprt_iter_listall = {
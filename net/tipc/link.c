@@ -118,6 +118,9 @@ struct tipc_stats {
  * @wakeupq: linked list of wakeup msgs waiting for link congestion to abate
  * @long_msg_seq_no: next identifier to use for outbound fragmented messages
  * @reasm_buf: head of partially reassembled inbound message fragments
+ * @nagle_start: # of small msgs sent back to back before they are held back
+ * @nagle_cnt: # of small msgs sent back to back while data was unacked
+ * @nagle_held: # of small msgs held in backlog queue waiting for an ack
  * @bc_rcvr: marks that this is a broadcast receiver link
  * @stats: collects statistics regarding link activity
  */
@@ -185,6 +188,11 @@ struct tipc_link {
 	struct sk_buff *reasm_buf;
 	struct sk_buff *reasm_tnlmsg;
 
+	/* Link level Nagle */
+	u16 nagle_start;
+	u16 nagle_cnt;
+	u16 nagle_held;
+
 	/* Broadcast */
 	u16 ackers;
 	u16 acked;
@@ -213,6 +221,13 @@ enum {
 	BC_NACK_SND_SUPPRESS,
 };
 
+/* Small msgs on a busy link needed before holding them back for bundling
+ */
+#define TIPC_NAGLE_START_INIT	4
+#define TIPC_NAGLE_START_MAX	1024
+
+int sysctl_tipc_link_nagle __read_mostly = 1;
+
 #define TIPC_BC_RETR_LIM  (jiffies + msecs_to_jiffies(10))
 #define TIPC_UC_RETR_TIME (jiffies + msecs_to_jiffies(1))
 
@@ -261,6 +276,8 @@ static int tipc_link_advance_transmq(struct tipc_link *l, struct tipc_link *r,
 				     bool *retransmitted, int *rc);
 static void tipc_link_update_cwin(struct tipc_link *l, int released,
 				  bool retransmitted);
+static void tipc_link_advance_backlog(struct tipc_link *l,
+				      struct sk_buff_head *xmitq);
 /*
  *  Simple non-static link routines (i.e. referenced outside this file)
  */
@@ -513,6 +530,7 @@ bool tipc_link_create(struct net *net, char *if_name, int bearer_id,
 	l->mtu = mtu;
 	l->priority = priority;
 	tipc_link_set_queue_limits(l, min_win, max_win);
+	l->nagle_start = TIPC_NAGLE_START_INIT;
 	l->ackers = 1;
 	l->bc_sndlink = bc_sndlink;
 	l->bc_rcvlink = bc_rcvlink;
@@ -823,6 +841,9 @@ int tipc_link_timeout(struct tipc_link *l, struct sk_buff_head *xmitq)
 		tipc_mon_get_state(l->net, l->addr, mstate, l->bearer_id);
 		if (mstate->reset || (l->silent_intv_cnt > l->abort_limit))
 			return tipc_link_fsm_evt(l, LINK_FAILURE_EVT);
+		/* Don't wait any longer for the ack releasing a held bundle */
+		if (unlikely(l->nagle_held))
+			tipc_link_advance_backlog(l, xmitq);
 		state = bc_acked != bc_snt;
 		state |= l->bc_rcvlink->rcv_unacked;
 		state |= l->rcv_unacked;
@@ -982,11 +1003,89 @@ void tipc_link_reset(struct tipc_link *l)
 	l->last_ga = NULL;
 	l->silent_intv_cnt = 0;
 	l->rst_cnt = 0;
+	l->nagle_start = TIPC_NAGLE_START_INIT;
+	l->nagle_cnt = 0;
+	l->nagle_held = 0;
 	l->bc_peer_is_up = false;
 	memset(&l->mon_state, 0, sizeof(l->mon_state));
 	tipc_link_reset_stats(l);
 }
 
+/* tipc_link_nagle_adapt - the held msgs have been released to the peer
+ * If only one msg was held, the probe soliciting the ack was not paid for
+ * by bundling, so wait for a longer run of small msgs next time.
+ */
+static void tipc_link_nagle_adapt(struct tipc_link *l)
+{
+	if (l->nagle_held > 1)
+		l->nagle_start = TIPC_NAGLE_START_INIT;
+	else if (l->nagle_start < TIPC_NAGLE_START_MAX)
+		l->nagle_start *= 2;
+	l->nagle_held = 0;
+	l->nagle_cnt = 0;
+}
+
+/**
+ * tipc_link_nagle(): hold back a small msg for bundling while data is unacked
+ * @l: link to use
+ * @skb: pointer to the single buffer msg to be sent
+ * @imp: importance of the msg
+ * @mss: max message size (header inclusive)
+ * @xmitq: returned list of packets to be sent by caller
+ *
+ * After a run of small msgs sent while the link has data in flight, further
+ * small msgs are bundled in the backlog queue instead of being sent one by
+ * one.  A probe is sent when the first one is held, so the peer acks at once
+ * and the bundle is released within one round trip.  A single buffer msg
+ * that cannot be held releases the bundle here, and tipc_link_xmit() does
+ * so before a fragmented msg, so order is kept.  Should the ack be lost,
+ * tipc_link_timeout() releases the bundle.
+ *
+ * Returns true if the msg was held (and possibly consumed), otherwise false
+ */
+static bool tipc_link_nagle(struct tipc_link *l, struct sk_buff **skb,
+			    int imp, unsigned int mss,
+			    struct sk_buff_head *xmitq)
+{
+	bool new_bundle;
+
+	if (!sysctl_tipc_link_nagle || link_is_bc_sndlink(l) ||
+	    skb_queue_empty(&l->transmq) ||
+	    msg_size(buf_msg(*skb)) > mss / 2) {
+		l->nagle_cnt = 0;
+		goto release;
+	}
+	if (!l->nagle_held && ++l->nagle_cnt < l->nagle_start)
+		return false;
+	if (!tipc_msg_try_bundle(l->backlog[imp].target_bskb, skb, mss,
+				 l->addr, &new_bundle))
+		goto release;
+
+	if (*skb) {
+		/* Hold one bundle at a time */
+		if (l->nagle_held)
+			goto release;
+		l->backlog[imp].target_bskb = *skb;
+		l->backlog[imp].len++;
+		__skb_queue_tail(&l->backlogq, *skb);
+		tipc_link_build_proto_msg(l, STATE_MSG, true, 0, 0, 0, 0,
+					  xmitq);
+	} else {
+		if (new_bundle) {
+			l->stats.sent_bundles++;
+			l->stats.sent_bundled++;
+		}
+		l->stats.sent_bundled++;
+	}
+	l->nagle_held++;
+	return true;
+
+release:
+	if (l->nagle_held)
+		tipc_link_advance_backlog(l, xmitq);
+	return false;
+}
+
 /**
  * tipc_link_xmit(): enqueue buffer list according to queue situation
  * @l: link to use
@@ -1012,7 +1111,7 @@ int tipc_link_xmit(struct tipc_link *l, struct sk_buff_head *list,
 	unsigned int mss = tipc_link_mss(l);
 	unsigned int cwin = l->window;
 	unsigned int mtu = l->mtu;
-	bool new_bundle;
+	bool new_bundle, held;
 	int rc = 0;
 
 	if (unlikely(msg_size(hdr) > mtu)) {
@@ -1035,10 +1134,22 @@ int tipc_link_xmit(struct tipc_link *l, struct sk_buff_head *list,
 	if (pkt_cnt > 1) {
 		l->stats.sent_fragmented++;
 		l->stats.sent_fragments += pkt_cnt;
+		/* Fragments must not overtake a held bundle */
+		if (unlikely(l->nagle_held)) {
+			tipc_link_advance_backlog(l, xmitq);
+			seqno = l->snd_nxt;
+		}
 	}
 
 	/* Prepare each packet for sending, and add to relevant queue: */
 	while ((skb = __skb_dequeue(list))) {
+		if (pkt_cnt == 1 && skb_queue_len(transmq) < cwin) {
+			l->snd_nxt = seqno;
+			held = tipc_link_nagle(l, &skb, imp, mss, xmitq);
+			seqno = l->snd_nxt;
+			if (held)
+				continue;
+		}
 		if (likely(skb_queue_len(transmq) < cwin)) {
 			hdr = buf_msg(skb);
 			msg_set_seqno(hdr, seqno);
@@ -1164,6 +1275,8 @@ static void tipc_link_advance_backlog(struct tipc_link *l,
 		seqno++;
 	}
 	l->snd_nxt = seqno;
+	if (unlikely(l->nagle_held))
+		tipc_link_nagle_adapt(l);
 }
 
 /**
@@ -45,6 +45,8 @@
 */
 #define ELINKCONG EAGAIN	/* link congestion <=> resource unavailable */
 
+extern int sysctl_tipc_link_nagle __read_mostly;
+
 /* Link FSM events:
  */
 enum {
@@ -37,6 +37,7 @@
 #include "trace.h"
 #include "crypto.h"
 #include "bcast.h"
+#include "link.h"
 #include <linux/sysctl.h>
 
 static struct ctl_table_header *tipc_ctl_hdr;
@@ -82,6 +83,15 @@ static struct ctl_table tipc_table[] = {
 		.mode		= 0644,
 		.proc_handler	= proc_doulongvec_minmax,
 	},
+	{
+		.procname	= "link_nagle",
+		.data		= &sysctl_tipc_link_nagle,
+		.maxlen		= sizeof(sysctl_tipc_link_nagle),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= SYSCTL_ZERO,
+		.extra2		= SYSCTL_ONE,
+	},
 	{}
 };
 
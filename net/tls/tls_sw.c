@@ -42,6 +42,16 @@
 #include <net/strparser.h>
 #include <net/tls.h>
 
+static bool tls_sw_parallel_tx;
+module_param_named(sw_parallel_tx, tls_sw_parallel_tx, bool, 0644);
+MODULE_PARM_DESC(sw_parallel_tx,
+		 "Spread software record encryption over CPUs with pcrypt");
+
+static bool tls_sw_parallel_rx;
+module_param_named(sw_parallel_rx, tls_sw_parallel_rx, bool, 0644);
+MODULE_PARM_DESC(sw_parallel_rx,
+		 "Spread software record decryption over CPUs with pcrypt");
+
 static int __skb_nsg(struct sk_buff *skb, int offset, int len,
                      unsigned int recursion_level)
 {
@@ -2440,6 +2450,24 @@ int tls_set_sw_offload(struct sock *sk, struct tls_context *ctx, int tx)
 		goto free_iv;
 	}
 
+	/* pcrypt handles records on several CPUs through padata and
+	 * completes them in submission order.  On TX the async path keeps
+	 * them queued on tx_list until tls_tx_records() can send them, on
+	 * RX it makes the aead async so tls_sw_recvmsg() submits every
+	 * queued record, decrypting into the user pages where it can,
+	 * before waiting for the first one.
+	 */
+	if (!*aead && (tx ? READ_ONCE(tls_sw_parallel_tx) :
+			    READ_ONCE(tls_sw_parallel_rx))) {
+		char pcrypt_name[CRYPTO_MAX_ALG_NAME];
+
+		snprintf(pcrypt_name, sizeof(pcrypt_name), "pcrypt(%s)",
+			 cipher_name);
+		*aead = crypto_alloc_aead(pcrypt_name, 0, 0);
+		if (IS_ERR(*aead))
+			*aead = NULL;
+	}
+
 	if (!*aead) {
 		*aead = crypto_alloc_aead(cipher_name, 0, 0);
 		if (IS_ERR(*aead)) {
@@ -1822,6 +1822,77 @@ static int unix_dgram_sendmsg(struct socket *sock, struct msghdr *msg,
  */
 #define UNIX_SKB_FRAGS_SZ (PAGE_SIZE << get_order(32768))
 
+/* Small writes get at least this much linear room, so that the writes
+ * following them can be appended to the same skb.
+ */
+#define UNIX_SKB_COALESCE_SZ 512
+
+/*
+ * Append a small write to the tail skb of the peer's receive queue if
+ * it has room and carries no fds or credentials.  The peer's iolock
+ * keeps readers from consuming the tail while the data is copied in, so
+ * only try it when the lock is free.  Returns the bytes appended, 0 if
+ * the write needs an skb of its own, or a negative error.
+ */
+static int unix_stream_coalesce(struct socket *sock, struct sock *other,
+				struct msghdr *msg, size_t size,
+				struct scm_cookie *scm)
+{
+	struct unix_sock *u = unix_sk(other);
+	struct sk_buff *skb;
+	int err = 0;
+
+	if (scm->fp || !mutex_trylock(&u->iolock))
+		return 0;
+
+	unix_state_lock(other);
+	if (sock_flag(other, SOCK_DEAD) ||
+	    (other->sk_shutdown & RCV_SHUTDOWN)) {
+		err = -EPIPE;
+		goto out_unlock;
+	}
+
+	/* Data in frags comes after the linear part, so only append to a
+	 * linear tail.
+	 */
+	skb = skb_peek_tail(&other->sk_receive_queue);
+	if (!skb || skb_is_nonlinear(skb) || UNIXCB(skb).fp ||
+	    skb_tailroom(skb) < size ||
+	    unix_passcred_enabled(sock, other) || !unix_skb_scm_eq(skb, scm))
+		goto out_unlock;
+
+	/* Release may purge the queue once the state lock is dropped */
+	skb_get(skb);
+	unix_state_unlock(other);
+
+	if (!copy_from_iter_full(skb_tail_pointer(skb), size,
+				 &msg->msg_iter)) {
+		err = -EFAULT;
+		goto out_put;
+	}
+
+	unix_state_lock(other);
+	if (sock_flag(other, SOCK_DEAD) ||
+	    (other->sk_shutdown & RCV_SHUTDOWN)) {
+		err = -EPIPE;
+	} else {
+		spin_lock(&other->sk_receive_queue.lock);
+		skb_put(skb, size);
+		spin_unlock(&other->sk_receive_queue.lock);
+		err = size;
+	}
+	unix_state_unlock(other);
+out_put:
+	kfree_skb(skb);
+	mutex_unlock(&u->iolock);
+	return err;
+
+out_unlock:
+	unix_state_unlock(other);
+	mutex_unlock(&u->iolock);
+	return err;
+}
+
 static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 			       size_t len)
 {
@@ -1856,6 +1927,18 @@ static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 	if (sk->sk_shutdown & SEND_SHUTDOWN)
 		goto pipe_err;
 
+	if (len > 0 && len <= UNIX_SKB_COALESCE_SZ) {
+		err = unix_stream_coalesce(sock, other, msg, len, &scm);
+		if (err == -EPIPE)
+			goto pipe_err;
+		if (err < 0)
+			goto out_err;
+		if (err) {
+			other->sk_data_ready(other);
+			sent = err;
+		}
+	}
+
 	while (sent < len) {
 		size = len - sent;
 
@@ -1869,7 +1952,9 @@ static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 
 		data_len = min_t(size_t, size, PAGE_ALIGN(data_len));
 
-		skb = sock_alloc_send_pskb(sk, size - data_len, data_len,
+		skb = sock_alloc_send_pskb(sk, max_t(int, size - data_len,
+						     UNIX_SKB_COALESCE_SZ),
+					   data_len,
 					   msg->msg_flags & MSG_DONTWAIT, &err,
 					   get_order(UNIX_SKB_FRAGS_SZ));
 		if (!skb)
@@ -242,10 +242,16 @@ virtio_transport_cancel_pkt(struct vsock_sock *vsk)
 	return ret;
 }
 
+/*
+ * Receive buffers are whole pages: on systems with pages larger than
+ * the default buffer size each packet can carry more data, and page
+ * backed payload can be handed to a pipe by reference on splice().
+ */
 static void virtio_vsock_rx_fill(struct virtio_vsock *vsock)
 {
-	int buf_len = VIRTIO_VSOCK_DEFAULT_RX_BUF_SIZE;
+	int buf_len = max_t(int, VIRTIO_VSOCK_DEFAULT_RX_BUF_SIZE, PAGE_SIZE);
 	struct virtio_vsock_pkt *pkt;
+	struct page *page;
 	struct scatterlist hdr, buf, *sgs[2];
 	struct virtqueue *vq;
 	int ret;
@@ -257,10 +263,22 @@ static void virtio_vsock_rx_fill(struct virtio_vsock *vsock)
 		if (!pkt)
 			break;
 
-		pkt->buf = kmalloc(buf_len, GFP_KERNEL);
-		if (!pkt->buf) {
-			virtio_transport_free_pkt(pkt);
-			break;
+		if (buf_len == PAGE_SIZE) {
+			page = alloc_page(GFP_KERNEL);
+			if (!page) {
+				virtio_transport_free_pkt(pkt);
+				break;
+			}
+			/* Pipe buffers are confirmed by their uptodate bit */
+			SetPageUptodate(page);
+			pkt->buf = page_address(page);
+			pkt->page_buf = true;
+		} else {
+			pkt->buf = kmalloc(buf_len, GFP_KERNEL);
+			if (!pkt->buf) {
+				virtio_transport_free_pkt(pkt);
+				break;
+			}
 		}
 
 		pkt->buf_len = buf_len;
@@ -26,6 +26,9 @@
 /* Threshold for detecting small packets to copy */
 #define GOOD_COPY_LEN  128
 
+/* Page backed packets up to this size are queued in a kmalloc()ed copy */
+#define GOOD_COPY_PAGE_LEN  (PAGE_SIZE / 4)
+
 static const struct virtio_transport *
 virtio_transport_get_ops(struct vsock_sock *vsk)
 {
@@ -356,7 +359,13 @@ virtio_transport_stream_do_dequeue(struct vsock_sock *vsk,
 		 */
 		spin_unlock_bh(&vvs->rx_lock);
 
-		err = memcpy_to_msg(msg, pkt->buf + pkt->off, bytes);
+		/* For a pipe, copy_page_to_iter() only takes a page reference */
+		if (pkt->page_buf)
+			err = copy_page_to_iter(virt_to_page(pkt->buf), pkt->off,
+						bytes, &msg->msg_iter) == bytes ?
+			      0 : -EFAULT;
+		else
+			err = memcpy_to_msg(msg, pkt->buf + pkt->off, bytes);
 		if (err)
 			goto out;
 
@@ -922,6 +931,18 @@ virtio_transport_recv_enqueue(struct vsock_sock *vsk,
 		}
 	}
 
+	/* Don't keep a whole page pinned in the queue for a small payload */
+	if (pkt->page_buf && pkt->len <= GOOD_COPY_PAGE_LEN) {
+		void *buf = kmemdup(pkt->buf, pkt->len, GFP_ATOMIC);
+
+		if (buf) {
+			put_page(virt_to_page(pkt->buf));
+			pkt->buf = buf;
+			pkt->buf_len = pkt->len;
+			pkt->page_buf = false;
+		}
+	}
+
 	list_add_tail(&pkt->list, &vvs->rx_queue);
 
 out:
@@ -1183,7 +1204,11 @@ EXPORT_SYMBOL_GPL(virtio_transport_recv_pkt);
 
 void virtio_transport_free_pkt(struct virtio_vsock_pkt *pkt)
 {
-	kfree(pkt->buf);
+	/* The page may live on in a pipe the payload was spliced to */
+	if (pkt->page_buf)
+		put_page(virt_to_page(pkt->buf));
+	else
+		kfree(pkt->buf);
 	kfree(pkt);
 }
 EXPORT_SYMBOL_GPL(virtio_transport_free_pkt);
@@ -30,6 +30,8 @@
 #include "xsk.h"
 
 #define TX_BATCH_SIZE 16
+/* Descriptors a multi-buffer packet may span */
+#define XSK_MAX_DESCS (MAX_SKB_FRAGS + 1)
 
 static DEFINE_PER_CPU(struct list_head, xskmap_flush_list);
 
@@ -114,14 +116,15 @@ static u64 xp_get_handle(struct xdp_buff_xsk *xskb)
 	return xskb->orig_addr + (offset << XSK_UNALIGNED_BUF_OFFSET_SHIFT);
 }
 
-static int __xsk_rcv_zc(struct xdp_sock *xs, struct xdp_buff *xdp, u32 len)
+static int __xsk_rcv_zc(struct xdp_sock *xs, struct xdp_buff *xdp, u32 len,
+			u32 options)
 {
 	struct xdp_buff_xsk *xskb = container_of(xdp, struct xdp_buff_xsk, xdp);
 	u64 addr;
 	int err;
 
 	addr = xp_get_handle(xskb);
-	err = xskq_prod_reserve_desc(xs->rx, addr, len);
+	err = xskq_prod_reserve_desc(xs->rx, addr, len, options);
 	if (err) {
 		xs->rx_queue_full++;
 		return err;
@@ -149,6 +152,54 @@ static void xsk_copy_xdp(struct xdp_buff *to, struct xdp_buff *from, u32 len)
 	memcpy(to_buf, from_buf, len + metalen);
 }
 
+/* Copy a frame larger than a chunk into as many chunks as it takes and
+ * post them as one packet, every descriptor but the last one carrying
+ * XDP_PKT_CONTD.
+ */
+static int __xsk_rcv_sg(struct xdp_sock *xs, struct xdp_buff *xdp, u32 len,
+			bool explicit_free)
+{
+	u32 frame_size = xsk_umem_get_rx_frame_size(xs->umem);
+	u32 nr = DIV_ROUND_UP(len, frame_size), i, off, seg;
+	struct xdp_buff *bufs[XSK_MAX_DESCS];
+
+	if (nr > XSK_MAX_DESCS) {
+		xs->rx_dropped++;
+		return -ENOSPC;
+	}
+
+	if (xskq_prod_nb_free(xs->rx, nr) < nr) {
+		xs->rx_queue_full++;
+		return -ENOSPC;
+	}
+
+	for (i = 0; i < nr; i++) {
+		bufs[i] = xsk_buff_alloc(xs->umem);
+		if (!bufs[i]) {
+			while (i--)
+				xsk_buff_free(bufs[i]);
+			xs->rx_dropped++;
+			return -ENOSPC;
+		}
+	}
+
+	/* The metadata, if any, goes in front of the first chunk */
+	xsk_copy_xdp(bufs[0], xdp, frame_size);
+	for (i = 1, off = frame_size; i < nr; i++, off += frame_size)
+		memcpy(bufs[i]->data, xdp->data + off,
+		       min(len - off, frame_size));
+
+	/* Cannot fail, room was checked above */
+	for (i = 0, off = 0; i < nr; i++, off += frame_size) {
+		seg = min(len - off, frame_size);
+		__xsk_rcv_zc(xs, bufs[i], seg, i + 1 < nr ? XDP_PKT_CONTD : 0);
+	}
+
+	if (explicit_free)
+		xdp_return_buff(xdp);
+	return 0;
+}
+
 static int __xsk_rcv(struct xdp_sock *xs, struct xdp_buff *xdp, u32 len,
 		     bool explicit_free)
 {
@@ -156,6 +207,8 @@ static int __xsk_rcv(struct xdp_sock *xs, struct xdp_buff *xdp, u32 len,
 	int err;
 
 	if (len > xsk_umem_get_rx_frame_size(xs->umem)) {
+		if (xs->rx->sg)
+			return __xsk_rcv_sg(xs, xdp, len, explicit_free);
 		xs->rx_dropped++;
 		return -ENOSPC;
 	}
@@ -167,7 +220,7 @@ static int __xsk_rcv(struct xdp_sock *xs, struct xdp_buff *xdp, u32 len,
 	}
 
 	xsk_copy_xdp(xsk_xdp, xdp, len);
-	err = __xsk_rcv_zc(xs, xsk_xdp, len);
+	err = __xsk_rcv_zc(xs, xsk_xdp, len, 0);
 	if (err) {
 		xsk_buff_free(xsk_xdp);
 		return err;
@@ -201,7 +254,7 @@ static int xsk_rcv(struct xdp_sock *xs, struct xdp_buff *xdp,
 	len = xdp->data_end - xdp->data;
 
 	return xdp->rxq->mem.type == MEM_TYPE_XSK_BUFF_POOL ?
-		__xsk_rcv_zc(xs, xdp, len) :
+		__xsk_rcv_zc(xs, xdp, len, 0) :
 		__xsk_rcv(xs, xdp, len, explicit_free);
 }
 
@@ -328,73 +381,248 @@ static void xsk_destruct_skb(struct sk_buff *skb)
 	sock_wfree(skb);
 }
 
+/* Completion addresses of a packet spanning several descriptors */
+struct xsk_tx_addrs {
+	u32 nr;
+	u64 addr[XSK_MAX_DESCS];
+};
+
+static void xsk_destruct_skb_sg(struct sk_buff *skb)
+{
+	struct xsk_tx_addrs *addrs = skb_shinfo(skb)->destructor_arg;
+	struct xdp_sock *xs = xdp_sk(skb->sk);
+	unsigned long flags;
+	u32 i;
+
+	spin_lock_irqsave(&xs->tx_completion_lock, flags);
+	for (i = 0; i < addrs->nr; i++)
+		xskq_prod_submit_addr(xs->umem->cq, addrs->addr[i]);
+	spin_unlock_irqrestore(&xs->tx_completion_lock, flags);
+
+	kfree(addrs);
+	sock_wfree(skb);
+}
+
+/* Append the data of an XDP_PKT_CONTD continuation descriptor to @skb as a
+ * page fragment.
+ */
+static int xsk_append_desc(struct xdp_sock *xs, struct sk_buff *skb,
+			   struct xdp_desc *desc)
+{
+	int nr_frags = skb_shinfo(skb)->nr_frags;
+	struct sock *sk = &xs->sk;
+	struct xsk_tx_addrs *addrs;
+	struct page *page;
+
+	if (nr_frags >= MAX_SKB_FRAGS)
+		return -EMSGSIZE;
+
+	if (skb->destructor != xsk_destruct_skb_sg) {
+		addrs = kmalloc(sizeof(*addrs), sk->sk_allocation);
+		if (!addrs)
+			return -ENOMEM;
+		addrs->nr = 1;
+		addrs->addr[0] = (u64)(long)skb_shinfo(skb)->destructor_arg;
+		skb_shinfo(skb)->destructor_arg = addrs;
+		skb->destructor = xsk_destruct_skb_sg;
+	}
+	addrs = skb_shinfo(skb)->destructor_arg;
+
+	page = alloc_page(sk->sk_allocation);
+	if (!page)
+		return -ENOMEM;
+
+	memcpy(page_address(page), xsk_buff_raw_get_data(xs->umem, desc->addr),
+	       desc->len);
+	skb_add_rx_frag(skb, nr_frags, page, 0, desc->len, PAGE_SIZE);
+	/* sock_wfree() releases the whole truesize */
+	refcount_add(PAGE_SIZE, &sk->sk_wmem_alloc);
+	addrs->addr[addrs->nr++] = desc->addr;
+	return 0;
+}
+
+static struct sk_buff *xsk_build_skb(struct xdp_sock *xs,
+				     struct xdp_desc *desc, int *err)
+{
+	struct sock *sk = &xs->sk;
+	struct sk_buff *skb;
+	char *buffer;
+
+	skb = sock_alloc_send_skb(sk, desc->len, 1, err);
+	if (unlikely(!skb))
+		return NULL;
+
+	skb_put(skb, desc->len);
+	buffer = xsk_buff_raw_get_data(xs->umem, desc->addr);
+	*err = skb_store_bits(skb, 0, buffer, desc->len);
+	if (unlikely(*err)) {
+		kfree_skb(skb);
+		return NULL;
+	}
+
+	skb->dev = xs->dev;
+	skb->priority = sk->sk_priority;
+	skb->mark = sk->sk_mark;
+	skb_set_queue_mapping(skb, xs->queue_id);
+	skb_shinfo(skb)->destructor_arg = (void *)(long)desc->addr;
+	return skb;
+}
+
+/* Hand @nr skbs to the driver under a single acquisition of the Tx queue
+ * lock, telling it through xmit_more that more frames follow, so that it
+ * only has to kick the hardware once per batch. Frames that cannot be sent
+ * are freed, which completes them to the completion ring.
+ */
+static int xsk_xmit_batch(struct xdp_sock *xs, struct sk_buff **skbs, u32 nr)
+{
+	struct net_device *dev = xs->dev;
+	struct netdev_queue *txq = netdev_get_tx_queue(dev, xs->queue_id);
+	u32 i, next, sent = 0;
+	bool again = false;
+	int ret;
+
+	if (unlikely(!netif_running(dev) || !netif_carrier_ok(dev))) {
+		atomic_long_add(nr, &dev->tx_dropped);
+		goto out;
+	}
+
+	for (i = 0; i < nr; i++) {
+		struct sk_buff *skb;
+
+		skb = validate_xmit_skb_list(skbs[i], dev, &again);
+		if (unlikely(skb != skbs[i])) {
+			atomic_long_inc(&dev->tx_dropped);
+			kfree_skb_list(skb);
+			skbs[i] = NULL;
+		}
+	}
+
+	local_bh_disable();
+	/* Same dead loop check as __dev_queue_xmit() */
+	if (unlikely(dev_xmit_recursion())) {
+		local_bh_enable();
+		net_crit_ratelimited("Dead loop on virtual device %s, fix it urgently!\n",
+				     dev->name);
+		for (i = 0; i < nr; i++)
+			if (skbs[i])
+				atomic_long_inc(&dev->tx_dropped);
+		goto out;
+	}
+
+	HARD_TX_LOCK(dev, txq, smp_processor_id());
+	dev_xmit_recursion_inc();
+	for (i = 0; i < nr; i = next) {
+		for (next = i + 1; next < nr && !skbs[next]; next++)
+			;
+		if (!skbs[i])
+			continue;
+		if (netif_xmit_frozen_or_drv_stopped(txq))
+			break;
+
+		ret = netdev_start_xmit(skbs[i], dev, txq, next < nr);
+		if (!dev_xmit_complete(ret))
+			break;
+		skbs[i] = NULL;
+		/* Ignore NET_XMIT_CN as packet might have been sent */
+		if (ret == NET_XMIT_DROP)
+			break;
+		sent++;
+	}
+	dev_xmit_recursion_dec();
+	HARD_TX_UNLOCK(dev, txq);
+	local_bh_enable();
+
+out:
+	if (sent == nr)
+		return 0;
+
+	/* SKBs completed but not sent */
+	for (i = 0; i < nr; i++)
+		kfree_skb(skbs[i]);
+	return -EBUSY;
+}
+
 static int xsk_generic_xmit(struct sock *sk)
 {
+	struct sk_buff *skbs[TX_BATCH_SIZE];
 	struct xdp_sock *xs = xdp_sk(sk);
-	u32 max_batch = TX_BATCH_SIZE;
-	bool sent_frame = false;
+	bool ring_empty = false;
 	struct xdp_desc desc;
 	struct sk_buff *skb;
 	int err = 0;
+	u32 nr = 0;
 
 	mutex_lock(&xs->mutex);
 
 	if (xs->queue_id >= xs->dev->real_num_tx_queues)
 		goto out;
 
-	while (xskq_cons_peek_desc(xs->tx, &desc, xs->umem)) {
-		char *buffer;
-		u64 addr;
-		u32 len;
-
-		if (max_batch-- == 0) {
-			err = -EAGAIN;
-			goto out;
+	while (nr < TX_BATCH_SIZE) {
+		if (!xskq_cons_peek_desc(xs->tx, &desc, xs->umem)) {
+			ring_empty = true;
+			break;
 		}
 
-		len = desc.len;
-		skb = sock_alloc_send_skb(sk, len, 1, &err);
-		if (unlikely(!skb))
-			goto out;
-
-		skb_put(skb, len);
-		addr = desc.addr;
-		buffer = xsk_buff_raw_get_data(xs->umem, addr);
-		err = skb_store_bits(skb, 0, buffer, len);
 		/* This is the backpressure mechanism for the Tx path.
 		 * Reserve space in the completion queue and only proceed
 		 * if there is space in it. This avoids having to implement
 		 * any buffering in the Tx path.
 		 */
-		if (unlikely(err) || xskq_prod_reserve(xs->umem->cq)) {
-			kfree_skb(skb);
-			goto out;
+		if (xskq_prod_reserve(xs->umem->cq))
+			break;
+
+		skb = xs->tx->skb;
+		if (!skb) {
+			skb = xsk_build_skb(xs, &desc, &err);
+			if (unlikely(!skb)) {
+				xskq_prod_cancel(xs->umem->cq);
+				break;
+			}
+			skb->destructor = xsk_destruct_skb;
+		} else {
+			err = xsk_append_desc(xs, skb, &desc);
+			if (err == -EMSGSIZE) {
+				/* Drop the packet, it spans too many descs */
+				xs->tx->skb = NULL;
+				xs->tx->invalid_descs++;
+				kfree_skb(skb);
+				spin_lock_irq(&xs->tx_completion_lock);
+				xskq_prod_submit_addr(xs->umem->cq, desc.addr);
+				spin_unlock_irq(&xs->tx_completion_lock);
+				xskq_cons_release(xs->tx);
+				err = 0;
+				continue;
+			}
+			if (unlikely(err)) {
+				xskq_prod_cancel(xs->umem->cq);
+				break;
+			}
 		}
 
-		skb->dev = xs->dev;
-		skb->priority = sk->sk_priority;
-		skb->mark = sk->sk_mark;
-		skb_shinfo(skb)->destructor_arg = (void *)(long)desc.addr;
-		skb->destructor = xsk_destruct_skb;
-
-		err = dev_direct_xmit(skb, xs->queue_id);
 		xskq_cons_release(xs->tx);
-		/* Ignore NET_XMIT_CN as packet might have been sent */
-		if (err == NET_XMIT_DROP || err == NETDEV_TX_BUSY) {
-			/* SKB completed but not sent */
-			err = -EBUSY;
-			goto out;
+		if (desc.options & XDP_PKT_CONTD) {
+			xs->tx->skb = skb;
+			continue;
 		}
-
-		sent_frame = true;
+		xs->tx->skb = NULL;
+		skbs[nr++] = skb;
 	}
 
-	xs->tx->queue_empty_descs++;
+	if (nr == TX_BATCH_SIZE && !err &&
+	    xskq_cons_peek_desc(xs->tx, &desc, xs->umem))
+		err = -EAGAIN;
+	if (ring_empty)
+		xs->tx->queue_empty_descs++;
 
-out:
-	if (sent_frame)
+	if (nr) {
+		int ret = xsk_xmit_batch(xs, skbs, nr);
+
+		if (ret)
+			err = ret;
 		sk->sk_write_space(sk);
+	}
 
+out:
 	mutex_unlock(&xs->mutex);
 	return err;
 }
@@ -555,6 +783,11 @@ static int xsk_release(struct socket *sock)
 	xsk_delete_from_maps(xs);
 	mutex_lock(&xs->mutex);
 	xsk_unbind_dev(xs);
+	if (xs->tx) {
+		/* Completes the descriptors of a partial packet */
+		kfree_skb(xs->tx->skb);
+		xs->tx->skb = NULL;
+	}
 	mutex_unlock(&xs->mutex);
 
 	xskq_destroy(xs->rx);
@@ -602,9 +835,13 @@ static int xsk_bind(struct socket *sock, struct sockaddr *addr, int addr_len)
 
 	flags = sxdp->sxdp_flags;
 	if (flags & ~(XDP_SHARED_UMEM | XDP_COPY | XDP_ZEROCOPY |
-		      XDP_USE_NEED_WAKEUP))
+		      XDP_USE_NEED_WAKEUP | XDP_USE_SG))
 		return -EINVAL;
 
+	/* Multi-buffer packets are only assembled in copy mode */
+	if ((flags & XDP_USE_SG) && (flags & XDP_ZEROCOPY))
+		return -EOPNOTSUPP;
+
 	rtnl_lock();
 	mutex_lock(&xs->mutex);
 	if (xs->state != XSK_READY) {
@@ -659,6 +896,11 @@ static int xsk_bind(struct socket *sock, struct sockaddr *addr, int addr_len)
 			sockfd_put(sock);
 			goto out_unlock;
 		}
+		if ((flags & XDP_USE_SG) && umem_xs->umem->zc) {
+			err = -EOPNOTSUPP;
+			sockfd_put(sock);
+			goto out_unlock;
+		}
 
 		xdp_get_umem(umem_xs->umem);
 		WRITE_ONCE(xs->umem, umem_xs->umem);
@@ -668,11 +910,18 @@ static int xsk_bind(struct socket *sock, struct sockaddr *addr, int addr_len)
 		goto out_unlock;
 	} else {
 		/* This xsk has its own umem. */
+		if (flags & XDP_USE_SG)
+			flags |= XDP_COPY;
 		err = xdp_umem_assign_dev(xs->umem, dev, qid, flags);
 		if (err)
 			goto out_unlock;
 	}
 
+	if (xs->rx)
+		xs->rx->sg = flags & XDP_USE_SG;
+	if (xs->tx)
+		xs->tx->sg = flags & XDP_USE_SG;
+
 	xs->dev = dev;
 	xs->zc = xs->umem->zc;
 	xs->queue_id = qid;
@@ -39,6 +39,10 @@ struct xsk_queue {
 	struct xdp_ring *ring;
 	u64 invalid_descs;
 	u64 queue_empty_descs;
+	/* Descriptors may carry XDP_PKT_CONTD (bound with XDP_USE_SG) */
+	bool sg;
+	/* Tx: packet being assembled from XDP_PKT_CONTD descriptors */
+	struct sk_buff *skb;
 };
 
 /* The structure of the shared state of the rings are the same as the
@@ -131,9 +135,6 @@ static inline bool xp_aligned_validate_desc(struct xsk_buff_pool *pool,
 
 	if (chunk >= pool->addrs_cnt)
 		return false;
-
-	if (desc->options)
-		return false;
 	return true;
 }
 
@@ -151,9 +152,6 @@ static inline bool xp_unaligned_validate_desc(struct xsk_buff_pool *pool,
 	if (base_addr >= pool->addrs_cnt || addr >= pool->addrs_cnt ||
 	    xp_desc_crosses_non_contig_pg(pool, addr, desc->len))
 		return false;
-
-	if (desc->options)
-		return false;
 	return true;
 }
 
@@ -168,7 +166,9 @@ static inline bool xskq_cons_is_valid_desc(struct xsk_queue *q,
 					   struct xdp_desc *d,
 					   struct xdp_umem *umem)
 {
-	if (!xp_validate_desc(umem->pool, d)) {
+	u32 options = q->sg ? XDP_PKT_CONTD : 0;
+
+	if (!xp_validate_desc(umem->pool, d) || (d->options & ~options)) {
 		q->invalid_descs++;
 		return false;
 	}
@@ -286,6 +286,11 @@ static inline int xskq_prod_reserve(struct xsk_queue *q)
 	return 0;
 }
 
+static inline void xskq_prod_cancel(struct xsk_queue *q)
+{
+	q->cached_prod--;
+}
+
 static inline int xskq_prod_reserve_addr(struct xsk_queue *q, u64 addr)
 {
 	struct xdp_umem_ring *ring = (struct xdp_umem_ring *)q->ring;
@@ -298,8 +303,22 @@ static inline int xskq_prod_reserve_addr(struct xsk_queue *q, u64 addr)
 	return 0;
 }
 
+static inline u32 xskq_prod_nb_free(struct xsk_queue *q, u32 max)
+{
+	u32 free_entries = q->nentries - (q->cached_prod - q->cached_cons);
+
+	if (free_entries >= max)
+		return max;
+
+	/* Refresh the local tail pointer */
+	q->cached_cons = READ_ONCE(q->ring->consumer);
+	free_entries = q->nentries - (q->cached_prod - q->cached_cons);
+
+	return min(free_entries, max);
+}
+
 static inline int xskq_prod_reserve_desc(struct xsk_queue *q,
-					 u64 addr, u32 len)
+					 u64 addr, u32 len, u32 options)
 {
 	struct xdp_rxtx_ring *ring = (struct xdp_rxtx_ring *)q->ring;
 	u32 idx;
@@ -311,6 +330,7 @@ static inline int xskq_prod_reserve_desc(struct xsk_queue *q,
 	idx = q->cached_prod++ & q->ring_mask;
 	ring->desc[idx].addr = addr;
 	ring->desc[idx].len = len;
+	ring->desc[idx].options = options;
 
 	return 0;
 }
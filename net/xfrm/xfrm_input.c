@@ -22,6 +22,7 @@
 #include <net/ip6_tunnel.h>
 
 #include "xfrm_inout.h"
+#include "xfrm_parallel.h"
 
 struct xfrm_trans_tasklet {
 	struct tasklet_struct tasklet;
@@ -638,6 +639,8 @@ int xfrm_input(struct sk_buff *skb, int nexthdr, __be32 spi, int encap_type)
 
 		if (crypto_done)
 			nexthdr = x->type_offload->input_tail(x, skb);
+		else if (xfrm_is_parallel(x))
+			nexthdr = xfrm_parallel_input(x, skb);
 		else
 			nexthdr = x->type->input(x, skb);
 
@@ -756,6 +759,11 @@ EXPORT_SYMBOL(xfrm_input);
 
 int xfrm_input_resume(struct sk_buff *skb, int nexthdr)
 {
+	struct xfrm_state *x = xfrm_input_state(skb);
+
+	if (xfrm_is_parallel(x) && xfrm_parallel_resume(x, skb, nexthdr))
+		return 0;
+
 	return xfrm_input(skb, nexthdr, 0, -1);
 }
 EXPORT_SYMBOL(xfrm_input_resume);
@@ -23,6 +23,7 @@
 #endif
 
 #include "xfrm_inout.h"
+#include "xfrm_parallel.h"
 
 static int xfrm_output2(struct net *net, struct sock *sk, struct sk_buff *skb);
 static int xfrm_inner_extract_output(struct xfrm_state *x, struct sk_buff *skb);
@@ -472,7 +473,10 @@ static int xfrm_output_one(struct sk_buff *skb, int err)
 			/* Inner headers are invalid now. */
 			skb->encapsulation = 0;
 
-			err = x->type->output(x, skb);
+			if (xfrm_is_parallel(x))
+				err = xfrm_parallel_output(x, skb);
+			else
+				err = x->type->output(x, skb);
 			if (err == -EINPROGRESS)
 				goto out;
 		}
@@ -507,6 +511,10 @@ int xfrm_output_resume(struct sk_buff *skb, int err)
 {
 	struct net *net = xs_net(skb_dst(skb)->xfrm);
 
+	if (xfrm_is_parallel(skb_dst(skb)->xfrm) &&
+	    xfrm_parallel_resume(skb_dst(skb)->xfrm, skb, err))
+		return 0;
+
 	while (likely((err = xfrm_output_one(skb, err)) == 0)) {
 		nf_reset_ct(skb);
 
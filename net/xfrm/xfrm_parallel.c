@@ -0,0 +1,382 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * xfrm_parallel.c - spread the transforms of a single SA over all CPUs
+ *
+ * Without help, the input and output transforms of a state run on the
+ * CPU its packets arrive or leave on, so a single tunnel is limited to
+ * what one CPU can encrypt.  For states with XFRM_SA_XFLAG_PARALLEL set
+ * the transform is handed to padata instead: it runs on any CPU, and
+ * the packets are passed back to xfrm in the order they were
+ * submitted.  They come back on the submitting CPU when it is in the
+ * serial cpumask of the instance, otherwise padata picks one that is.
+ *
+ * Output sequence numbers are assigned before the transform and the
+ * input replay window is only advanced after it, so because of the
+ * reordering xfrm_replay sees the same order as without parallelism.
+ */
+
+#include <linux/hash.h>
+#include <linux/list.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/padata.h>
+#include <linux/rculist.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <net/xfrm.h>
+
+#include "xfrm_parallel.h"
+
+#define XFRM_PARALLEL_HASH_BITS	6
+
+/* per state context, found from the state through xfrm_parallel_hash */
+struct xfrm_parallel {
+	struct hlist_node	node;
+	struct rcu_head		rcu;
+	struct xfrm_state	*x;
+	struct padata_shell	*ps;
+	spinlock_t		submit_lock; /* keeps padata's order */
+	spinlock_t		lock;
+	struct list_head	async;	/* jobs waiting for async crypto */
+	struct list_head	backlog; /* jobs padata had no room for */
+	unsigned int		inflight; /* jobs handed to padata */
+};
+
+struct xfrm_parallel_job {
+	struct padata_priv	padata;
+	struct list_head	list;
+	struct xfrm_parallel	*xp;
+	struct sk_buff		*skb;
+	int			err;
+	int			cpu;
+	bool			input;
+};
+
+static struct padata_instance *xfrm_padata;
+static DEFINE_MUTEX(xfrm_parallel_mutex);
+static struct hlist_head xfrm_parallel_hash[1 << XFRM_PARALLEL_HASH_BITS];
+
+static struct hlist_head *xfrm_parallel_bucket(const struct xfrm_state *x)
+{
+	return &xfrm_parallel_hash[hash_ptr(x, XFRM_PARALLEL_HASH_BITS)];
+}
+
+/* must be called with rcu lock held */
+static struct xfrm_parallel *xfrm_parallel_find(const struct xfrm_state *x)
+{
+	struct xfrm_parallel *xp;
+
+	hlist_for_each_entry_rcu(xp, xfrm_parallel_bucket(x), node) {
+		if (xp->x == x)
+			return xp;
+	}
+	return NULL;
+}
+
+int xfrm_parallel_init_state(struct xfrm_state *x)
+{
+	struct xfrm_parallel *xp;
+	int err = -ENOMEM;
+
+	if (!xfrm_is_parallel(x))
+		return 0;
+
+	xp = kzalloc(sizeof(*xp), GFP_KERNEL);
+	if (!xp)
+		return -ENOMEM;
+	xp->x = x;
+	spin_lock_init(&xp->submit_lock);
+	spin_lock_init(&xp->lock);
+	INIT_LIST_HEAD(&xp->async);
+	INIT_LIST_HEAD(&xp->backlog);
+
+	mutex_lock(&xfrm_parallel_mutex);
+	if (!xfrm_padata) {
+		xfrm_padata = padata_alloc("xfrm");
+		if (!xfrm_padata)
+			goto out_unlock;
+	}
+	xp->ps = padata_alloc_shell(xfrm_padata);
+	if (!xp->ps)
+		goto out_unlock;
+
+	hlist_add_head_rcu(&xp->node, xfrm_parallel_bucket(x));
+	err = 0;
+out_unlock:
+	mutex_unlock(&xfrm_parallel_mutex);
+	if (err)
+		kfree(xp);
+	return err;
+}
+
+/* Called once no packet holds a reference on @x any more */
+void xfrm_parallel_destroy_state(struct xfrm_state *x)
+{
+	struct xfrm_parallel *xp;
+
+	if (!xfrm_is_parallel(x))
+		return;
+
+	mutex_lock(&xfrm_parallel_mutex);
+	xp = xfrm_parallel_find(x);
+	if (xp)
+		hlist_del_rcu(&xp->node);
+	mutex_unlock(&xfrm_parallel_mutex);
+
+	if (xp) {
+		WARN_ON_ONCE(!list_empty(&xp->async) ||
+			     !list_empty(&xp->backlog));
+		padata_free_shell(xp->ps);
+		kfree_rcu(xp, rcu);
+	}
+}
+
+/*
+ * Hand @job to padata, called with xp->submit_lock held, so that the jobs
+ * reach padata in the order they were taken, and BHs disabled.  xp->lock
+ * must not be held: when padata is out of works it runs the transform
+ * inline, and that takes xp->lock.  The slot is taken first, because the
+ * job may complete before padata_do_parallel() returns.
+ */
+static int xfrm_parallel_queue(struct xfrm_parallel *xp,
+			       struct xfrm_parallel_job *job)
+{
+	int err;
+
+	spin_lock(&xp->lock);
+	xp->inflight++;
+	spin_unlock(&xp->lock);
+
+	err = padata_do_parallel(xp->ps, &job->padata, &job->cpu);
+	if (err) {
+		spin_lock(&xp->lock);
+		xp->inflight--;
+		spin_unlock(&xp->lock);
+	}
+	return err;
+}
+
+/* Pass the packet of @job back to xfrm and free the job */
+static void xfrm_parallel_finish(struct xfrm_parallel_job *job, int err)
+{
+	struct sk_buff *skb = job->skb;
+	bool input = job->input;
+
+	kfree(job);
+
+	if (input)
+		xfrm_input_resume(skb, err);
+	else
+		xfrm_output_resume(skb, err);
+}
+
+/*
+ * Queue the jobs padata had no room for, oldest first, as far as it takes
+ * them.  If it takes none while nothing is in flight, no completion is
+ * left to retry from, so the jobs still waiting are moved to @failed.
+ * Called with xp->submit_lock held and BHs disabled.
+ */
+static void xfrm_parallel_drain_backlog(struct xfrm_parallel *xp,
+					struct list_head *failed)
+{
+	struct xfrm_parallel_job *job;
+
+	for (;;) {
+		spin_lock(&xp->lock);
+		job = list_first_entry_or_null(&xp->backlog,
+					       struct xfrm_parallel_job, list);
+		if (job)
+			list_del(&job->list);
+		spin_unlock(&xp->lock);
+		if (!job)
+			break;
+
+		if (xfrm_parallel_queue(xp, job)) {
+			spin_lock(&xp->lock);
+			list_add(&job->list, &xp->backlog);
+			spin_unlock(&xp->lock);
+			break;
+		}
+	}
+
+	spin_lock(&xp->lock);
+	if (!xp->inflight)
+		list_splice_init(&xp->backlog, failed);
+	spin_unlock(&xp->lock);
+}
+
+static void xfrm_parallel_serial(struct padata_priv *padata)
+{
+	struct xfrm_parallel_job *job = container_of(padata,
+						     struct xfrm_parallel_job,
+						     padata);
+	struct xfrm_parallel *xp = job->xp;
+	struct xfrm_parallel_job *tmp;
+	LIST_HEAD(failed);
+
+	/* This job's slot is free now, the backlog can go after it */
+	spin_lock_bh(&xp->lock);
+	xp->inflight--;
+	spin_unlock_bh(&xp->lock);
+
+	spin_lock_bh(&xp->submit_lock);
+	xfrm_parallel_drain_backlog(xp, &failed);
+	spin_unlock_bh(&xp->submit_lock);
+
+	xfrm_parallel_finish(job, job->err);
+	list_for_each_entry_safe(job, tmp, &failed, list)
+		xfrm_parallel_finish(job, -EBUSY);
+}
+
+static void xfrm_parallel_complete(struct xfrm_parallel_job *job, int err)
+{
+	job->err = err;
+	local_bh_disable();
+	padata_do_serial(&job->padata);
+	local_bh_enable();
+}
+
+static void xfrm_parallel_transform(struct padata_priv *padata)
+{
+	struct xfrm_parallel_job *job = container_of(padata,
+						     struct xfrm_parallel_job,
+						     padata);
+	struct xfrm_parallel *xp = job->xp;
+	struct xfrm_state *x = xp->x;
+	int err;
+
+	/*
+	 * Asynchronous crypto completes through xfrm_{input,output}_resume(),
+	 * which have to find the job to put the packet back in order.  The
+	 * completion may run before the transform returns.
+	 */
+	spin_lock_bh(&xp->lock);
+	list_add_tail(&job->list, &xp->async);
+	spin_unlock_bh(&xp->lock);
+
+	if (job->input)
+		err = x->type->input(x, job->skb);
+	else
+		err = x->type->output(x, job->skb);
+	if (err == -EINPROGRESS)
+		return;
+
+	spin_lock_bh(&xp->lock);
+	list_del(&job->list);
+	spin_unlock_bh(&xp->lock);
+
+	xfrm_parallel_complete(job, err);
+}
+
+/*
+ * Packets of a state must come out in the order they went in.  As long
+ * as earlier packets are with padata or in the backlog, a packet that
+ * padata has no room for joins the backlog, which is drained as the
+ * earlier ones complete.  Only with nothing outstanding may a packet be
+ * transformed inline, and without a job to queue it behind the others
+ * it is dropped.
+ */
+static int xfrm_parallel_submit(struct xfrm_state *x, struct sk_buff *skb,
+				bool input)
+{
+	struct xfrm_parallel_job *job;
+	struct xfrm_parallel *xp;
+	bool idle, busy;
+	int err;
+
+	rcu_read_lock();
+	xp = xfrm_parallel_find(x);
+	rcu_read_unlock();
+	if (!xp)
+		goto inline_transform;
+
+	job = kmalloc(sizeof(*job), GFP_ATOMIC);
+	if (!job) {
+		spin_lock_bh(&xp->lock);
+		idle = !xp->inflight && list_empty(&xp->backlog);
+		spin_unlock_bh(&xp->lock);
+		if (idle)
+			goto inline_transform;
+		return -ENOMEM;
+	}
+
+	job->padata.parallel = xfrm_parallel_transform;
+	job->padata.serial = xfrm_parallel_serial;
+	job->xp = xp;
+	job->skb = skb;
+	job->input = input;
+
+	/* Complete on this CPU if it is in the serial cpumask */
+	spin_lock_bh(&xp->submit_lock);
+	job->cpu = smp_processor_id();
+
+	spin_lock(&xp->lock);
+	busy = !list_empty(&xp->backlog);
+	if (busy)
+		list_add_tail(&job->list, &xp->backlog);
+	spin_unlock(&xp->lock);
+
+	err = busy ? 0 : xfrm_parallel_queue(xp, job);
+	idle = false;
+	if (err) {
+		spin_lock(&xp->lock);
+		idle = !xp->inflight && list_empty(&xp->backlog);
+		if (err == -EBUSY && !idle) {
+			list_add_tail(&job->list, &xp->backlog);
+			err = 0;
+		}
+		spin_unlock(&xp->lock);
+	}
+	spin_unlock_bh(&xp->submit_lock);
+	if (!err)
+		return -EINPROGRESS;
+	kfree(job);
+	if (!idle)
+		return err;
+
+inline_transform:
+	return input ? x->type->input(x, skb) : x->type->output(x, skb);
+}
+
+int xfrm_parallel_output(struct xfrm_state *x, struct sk_buff *skb)
+{
+	return xfrm_parallel_submit(x, skb, false);
+}
+
+int xfrm_parallel_input(struct xfrm_state *x, struct sk_buff *skb)
+{
+	return xfrm_parallel_submit(x, skb, true);
+}
+
+/*
+ * Called from xfrm_{input,output}_resume(): returns true if @skb is the
+ * asynchronous completion of a parallel transform, which is then passed
+ * on once the packets submitted before it are done.
+ */
+bool xfrm_parallel_resume(struct xfrm_state *x, struct sk_buff *skb, int err)
+{
+	struct xfrm_parallel_job *job, *found = NULL;
+	struct xfrm_parallel *xp;
+
+	rcu_read_lock();
+	xp = xfrm_parallel_find(x);
+	rcu_read_unlock();
+	if (!xp)
+		return false;
+
+	spin_lock_bh(&xp->lock);
+	list_for_each_entry(job, &xp->async, list) {
+		if (job->skb == skb) {
+			list_del(&job->list);
+			found = job;
+			break;
+		}
+	}
+	spin_unlock_bh(&xp->lock);
+
+	if (!found)
+		return false;
+
+	xfrm_parallel_complete(found, err);
+	return true;
+}
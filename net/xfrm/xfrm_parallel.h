@@ -0,0 +1,54 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef XFRM_PARALLEL_H
+#define XFRM_PARALLEL_H 1
+
+#include <net/xfrm.h>
+
+#ifdef CONFIG_XFRM_PARALLEL
+static inline bool xfrm_is_parallel(const struct xfrm_state *x)
+{
+	return x->props.extra_flags & XFRM_SA_XFLAG_PARALLEL;
+}
+
+int xfrm_parallel_init_state(struct xfrm_state *x);
+void xfrm_parallel_destroy_state(struct xfrm_state *x);
+int xfrm_parallel_output(struct xfrm_state *x, struct sk_buff *skb);
+int xfrm_parallel_input(struct xfrm_state *x, struct sk_buff *skb);
+bool xfrm_parallel_resume(struct xfrm_state *x, struct sk_buff *skb, int err);
+#else
+static inline bool xfrm_is_parallel(const struct xfrm_state *x)
+{
+	return false;
+}
+
+static inline int xfrm_parallel_init_state(struct xfrm_state *x)
+{
+	if (x->props.extra_flags & XFRM_SA_XFLAG_PARALLEL)
+		return -EOPNOTSUPP;
+	return 0;
+}
+
+static inline void xfrm_parallel_destroy_state(struct xfrm_state *x)
+{
+}
+
+static inline int xfrm_parallel_output(struct xfrm_state *x,
+				       struct sk_buff *skb)
+{
+	return x->type->output(x, skb);
+}
+
+static inline int xfrm_parallel_input(struct xfrm_state *x,
+				      struct sk_buff *skb)
+{
+	return x->type->input(x, skb);
+}
+
+static inline bool xfrm_parallel_resume(struct xfrm_state *x,
+					struct sk_buff *skb, int err)
+{
+	return false;
+}
+#endif
+
+#endif
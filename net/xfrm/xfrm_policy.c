@@ -54,6 +54,43 @@ struct xfrm_flo {
 	u8 flags;
 };
 
+/*
+ * Per CPU, direct mapped cache of policy lookup results, including the
+ * lack of a policy.  Entries are only valid for the xfrm_pol_cache_genid
+ * they were filled under, which moves on whenever a policy is linked
+ * or unlinked.
+ */
+#define XFRM_POL_CACHE_BITS	7
+
+struct xfrm_pol_cache_key {
+	xfrm_address_t		daddr;
+	xfrm_address_t		saddr;
+	possible_net_t		net;
+	u32			mark;
+	u32			if_id;
+	int			oif;
+	__be16			dport;
+	__be16			sport;
+	u16			family;
+	u8			dir;
+	u8			proto;
+} __aligned(sizeof(u32));
+
+struct xfrm_pol_cache_entry {
+	struct xfrm_pol_cache_key	key;
+	struct xfrm_policy		*pol;
+	unsigned int			genid;
+};
+
+struct xfrm_pol_cache {
+	struct xfrm_pol_cache_entry	entries[1 << XFRM_POL_CACHE_BITS];
+};
+
+static struct xfrm_pol_cache __percpu *xfrm_pol_cache __read_mostly;
+static atomic_t xfrm_pol_cache_genid = ATOMIC_INIT(1);
+/* linked policies with a security context, their match asks the LSM */
+static atomic_t xfrm_pol_cache_labeled = ATOMIC_INIT(0);
+
 /* prefixes smaller than this are stored in lists, not trees. */
 #define INEXACT_PREFIXLEN_IPV4	16
 #define INEXACT_PREFIXLEN_IPV6	48
@@ -2129,9 +2166,95 @@ static struct xfrm_policy *xfrm_policy_lookup_bytype(struct net *net, u8 type,
 	return ret;
 }
 
-static struct xfrm_policy *xfrm_policy_lookup(struct net *net,
-					      const struct flowi *fl,
-					      u16 family, u8 dir, u32 if_id)
+static void xfrm_pol_cache_bump(void)
+{
+	smp_mb__before_atomic();
+	atomic_inc(&xfrm_pol_cache_genid);
+}
+
+static bool xfrm_pol_cache_key_init(struct xfrm_pol_cache_key *key,
+				    struct net *net, const struct flowi *fl,
+				    u16 family, u8 dir, u32 if_id)
+{
+	const union flowi_uli *uli;
+
+	/*
+	 * Once a labeled policy exists, any match may depend on the LSM
+	 * policy and the secid of the flow, neither of which the key covers.
+	 */
+	if (!xfrm_pol_cache || fl->flowi_secid ||
+	    atomic_read(&xfrm_pol_cache_labeled))
+		return false;
+
+	memset(key, 0, sizeof(*key));
+	switch (family) {
+	case AF_INET:
+		key->daddr.a4 = fl->u.ip4.daddr;
+		key->saddr.a4 = fl->u.ip4.saddr;
+		uli = &fl->u.ip4.uli;
+		break;
+	case AF_INET6:
+		key->daddr.in6 = fl->u.ip6.daddr;
+		key->saddr.in6 = fl->u.ip6.saddr;
+		uli = &fl->u.ip6.uli;
+		break;
+	default:
+		return false;
+	}
+	write_pnet(&key->net, net);
+	key->mark = fl->flowi_mark;
+	key->if_id = if_id;
+	key->oif = fl->flowi_oif;
+	key->dport = xfrm_flowi_dport(fl, uli);
+	key->sport = xfrm_flowi_sport(fl, uli);
+	key->family = family;
+	key->dir = dir;
+	key->proto = fl->flowi_proto;
+	return true;
+}
+
+static struct xfrm_pol_cache_entry *
+xfrm_pol_cache_entry(const struct xfrm_pol_cache_key *key)
+{
+	u32 hash = jhash2((const u32 *)key, sizeof(*key) / sizeof(u32), 0);
+
+	return &this_cpu_ptr(xfrm_pol_cache)->entries[hash &
+					((1 << XFRM_POL_CACHE_BITS) - 1)];
+}
+
+/* Returns true on a hit, with a reference on *polp if it is not NULL */
+static bool xfrm_pol_cache_get(const struct xfrm_pol_cache_key *key,
+			       unsigned int genid, struct xfrm_policy **polp)
+{
+	struct xfrm_pol_cache_entry *e;
+	bool hit = false;
+
+	local_bh_disable();
+	e = xfrm_pol_cache_entry(key);
+	if (e->genid == genid && !memcmp(&e->key, key, sizeof(*key))) {
+		*polp = e->pol;
+		hit = !e->pol || xfrm_pol_hold_rcu(e->pol);
+	}
+	local_bh_enable();
+	return hit;
+}
+
+static void xfrm_pol_cache_put(const struct xfrm_pol_cache_key *key,
+			       unsigned int genid, struct xfrm_policy *pol)
+{
+	struct xfrm_pol_cache_entry *e;
+
+	local_bh_disable();
+	e = xfrm_pol_cache_entry(key);
+	e->key = *key;
+	e->pol = pol;
+	e->genid = genid;
+	local_bh_enable();
+}
+
+static struct xfrm_policy *__xfrm_policy_lookup(struct net *net,
+						const struct flowi *fl,
+						u16 family, u8 dir, u32 if_id)
 {
 #ifdef CONFIG_XFRM_SUB_POLICY
 	struct xfrm_policy *pol;
@@ -2145,6 +2268,39 @@ static struct xfrm_policy *xfrm_policy_lookup(struct net *net,
 					 dir, if_id);
 }
 
+static struct xfrm_policy *xfrm_policy_lookup(struct net *net,
+					      const struct flowi *fl,
+					      u16 family, u8 dir, u32 if_id)
+{
+	struct xfrm_pol_cache_key key;
+	struct xfrm_policy *pol;
+	unsigned int genid;
+
+	if (!xfrm_pol_cache_key_init(&key, net, fl, family, dir, if_id))
+		return __xfrm_policy_lookup(net, fl, family, dir, if_id);
+
+	/*
+	 * Entries must not be filled from tables older than their genid.
+	 * The genid is read under RCU, so that a policy unlinked after an
+	 * entry with this genid was filled is not freed before the hit
+	 * takes its reference.
+	 */
+	rcu_read_lock();
+	genid = atomic_read(&xfrm_pol_cache_genid);
+	smp_rmb();
+
+	if (xfrm_pol_cache_get(&key, genid, &pol)) {
+		rcu_read_unlock();
+		return pol;
+	}
+	rcu_read_unlock();
+
+	pol = __xfrm_policy_lookup(net, fl, family, dir, if_id);
+	if (!IS_ERR(pol))
+		xfrm_pol_cache_put(&key, genid, pol);
+	return pol;
+}
+
 static struct xfrm_policy *xfrm_sk_policy_lookup(const struct sock *sk, int dir,
 						 const struct flowi *fl,
 						 u16 family, u32 if_id)
@@ -2196,6 +2352,9 @@ static void __xfrm_policy_link(struct xfrm_policy *pol, int dir)
 	list_add(&pol->walk.all, &net->xfrm.policy_all);
 	net->xfrm.policy_count[dir]++;
 	xfrm_pol_hold(pol);
+	if (pol->security)
+		atomic_inc(&xfrm_pol_cache_labeled);
+	xfrm_pol_cache_bump();
 }
 
 static struct xfrm_policy *__xfrm_policy_unlink(struct xfrm_policy *pol,
@@ -2215,6 +2374,9 @@ static struct xfrm_policy *__xfrm_policy_unlink(struct xfrm_policy *pol,
 
 	list_del_init(&pol->walk.all);
 	net->xfrm.policy_count[dir]--;
+	if (pol->security)
+		atomic_dec(&xfrm_pol_cache_labeled);
+	xfrm_pol_cache_bump();
 
 	return pol;
 }
@@ -4160,6 +4322,9 @@ void __init xfrm_init(void)
 	seqcount_mutex_init(&xfrm_policy_hash_generation, &hash_resize_mutex);
 	xfrm_input_init();
 
+	/* Lookups simply go uncached if this fails */
+	xfrm_pol_cache = alloc_percpu(struct xfrm_pol_cache);
+
 #ifdef CONFIG_XFRM_ESPINTCP
 	espintcp_init();
 #endif
@@ -30,6 +30,7 @@
 #include <crypto/aead.h>
 
 #include "xfrm_hash.h"
+#include "xfrm_parallel.h"
 
 #define xfrm_state_deref_prot(table, net) \
 	rcu_dereference_protected((table), lockdep_is_held(&(net)->xfrm.xfrm_state_lock))
@@ -491,6 +492,7 @@ static void ___xfrm_state_destroy(struct xfrm_state *x)
 	kfree(x->preplay_esn);
 	if (x->type_offload)
 		xfrm_put_type_offload(x->type_offload);
+	xfrm_parallel_destroy_state(x);
 	if (x->type) {
 		x->type->destructor(x);
 		xfrm_put_type(x->type);
@@ -2512,6 +2514,8 @@ int __xfrm_init_state(struct xfrm_state *x, bool init_replay, bool offload)
 			goto error;
 	}
 
+	err = xfrm_parallel_init_state(x);
+
 error:
 	return err;
 }
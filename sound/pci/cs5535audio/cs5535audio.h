@@ -8,7 +8,7 @@
 #define cs_readw(cs5535au, reg)		inw((cs5535au)->port + reg)
 #define cs_readb(cs5535au, reg)		inb((cs5535au)->port + reg)
 
-#define CS5535AUDIO_MAX_DESCRIPTORS	128
+#define CS5535AUDIO_MAX_DESCRIPTORS	256
 
 /* acc_codec bar0 reg addrs */
 #define ACC_GPIO_STATUS			0x00
@@ -78,6 +78,7 @@ struct cs5535audio_dma {
 	struct snd_pcm_substream *substream;
 	unsigned int buf_addr, buf_bytes;
 	unsigned int period_bytes, periods;
+	int no_period_wakeup;
 	u32 saved_prd;
 	int pcm_open_flag;
 };
@@ -28,7 +28,8 @@ static const struct snd_pcm_hardware snd_cs5535audio_playback =
 		 		SNDRV_PCM_INFO_BLOCK_TRANSFER |
 		 		SNDRV_PCM_INFO_MMAP_VALID |
 		 		SNDRV_PCM_INFO_PAUSE |
-				SNDRV_PCM_INFO_RESUME
+				SNDRV_PCM_INFO_RESUME |
+				SNDRV_PCM_INFO_NO_PERIOD_WAKEUP
 				),
 	.formats =		(
 				SNDRV_PCM_FMTBIT_S16_LE
@@ -55,7 +56,8 @@ static const struct snd_pcm_hardware snd_cs5535audio_capture =
 				SNDRV_PCM_INFO_MMAP |
 				SNDRV_PCM_INFO_INTERLEAVED |
 		 		SNDRV_PCM_INFO_BLOCK_TRANSFER |
-		 		SNDRV_PCM_INFO_MMAP_VALID
+		 		SNDRV_PCM_INFO_MMAP_VALID |
+				SNDRV_PCM_INFO_NO_PERIOD_WAKEUP
 				),
 	.formats =		(
 				SNDRV_PCM_FMTBIT_S16_LE
@@ -106,11 +108,13 @@ static int cs5535audio_build_dma_packets(struct cs5535audio *cs5535au,
 					 struct cs5535audio_dma *dma,
 					 struct snd_pcm_substream *substream,
 					 unsigned int periods,
-					 unsigned int period_bytes)
+					 unsigned int period_bytes,
+					 int no_period_wakeup)
 {
 	unsigned int i;
 	u32 addr, desc_addr, jmpprd_addr;
 	struct cs5535audio_dma_desc *lastdesc;
+	u16 ctl;
 
 	if (periods > CS5535AUDIO_MAX_DESCRIPTORS)
 		return -ENOMEM;
@@ -124,9 +128,13 @@ static int cs5535audio_build_dma_packets(struct cs5535audio *cs5535au,
 		dma->period_bytes = dma->periods = 0;
 	}
 
-	if (dma->periods == periods && dma->period_bytes == period_bytes)
+	if (dma->periods == periods && dma->period_bytes == period_bytes &&
+	    dma->no_period_wakeup == no_period_wakeup)
 		return 0;
 
+	/* without period wakeups the position is only read from BMx_PNTR */
+	ctl = no_period_wakeup ? 0 : PRD_EOP;
+
 	/* the u32 cast is okay because in snd*create we successfully told
    	   pci alloc that we're only 32 bit capable so the uppper will be 0 */
 	addr = (u32) substream->runtime->dma_addr;
@@ -136,7 +144,7 @@ static int cs5535audio_build_dma_packets(struct cs5535audio *cs5535au,
 			&((struct cs5535audio_dma_desc *) dma->desc_buf.area)[i];
 		desc->addr = cpu_to_le32(addr);
 		desc->size = cpu_to_le16(period_bytes);
-		desc->ctlreserved = cpu_to_le16(PRD_EOP);
+		desc->ctlreserved = cpu_to_le16(ctl);
 		desc_addr += sizeof(struct cs5535audio_dma_desc);
 		addr += period_bytes;
 	}
@@ -151,6 +159,7 @@ static int cs5535audio_build_dma_packets(struct cs5535audio *cs5535au,
 	dma->substream = substream;
 	dma->period_bytes = period_bytes;
 	dma->periods = periods;
+	dma->no_period_wakeup = no_period_wakeup;
 	spin_lock_irq(&cs5535au->reg_lock);
 	dma->ops->disable_dma(cs5535au);
 	dma->ops->setup_prd(cs5535au, jmpprd_addr);
@@ -241,7 +250,9 @@ static int snd_cs5535audio_hw_params(struct snd_pcm_substream *substream,
 
 	err = cs5535audio_build_dma_packets(cs5535au, dma, substream,
 					    params_periods(hw_params),
-					    params_period_bytes(hw_params));
+					    params_period_bytes(hw_params),
+					    !!(hw_params->flags &
+					       SNDRV_PCM_HW_PARAMS_NO_PERIOD_WAKEUP));
 	if (!err)
 		dma->pcm_open_flag = 1;
 
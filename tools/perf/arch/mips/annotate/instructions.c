@@ -0,0 +1,39 @@
+// SPDX-License-Identifier: GPL-2.0
+
+static struct ins_ops *mips__associate_ins_ops(struct arch *arch,
+					       const char *name)
+{
+	struct ins_ops *ops = NULL;
+
+	/* catch function calls: the linking jumps and branches */
+	if (!strcmp(name, "jal") ||
+	    !strcmp(name, "jalr") ||
+	    !strcmp(name, "jalr.hb") ||
+	    !strcmp(name, "jialc") ||
+	    !strcmp(name, "bal") ||
+	    !strcmp(name, "balc") ||
+	    !strncmp(name, "bgezal", 6) ||
+	    !strncmp(name, "bltzal", 6))
+		ops = &call_ops;
+	/* catch function return, register jumps are mostly jr $ra */
+	else if (!strcmp(name, "jr") ||
+		 !strcmp(name, "jr.hb") ||
+		 !strcmp(name, "jrc"))
+		ops = &ret_ops;
+	/* catch all kind of jumps */
+	else if (name[0] == 'j' || name[0] == 'b')
+		ops = &jump_ops;
+
+	if (ops)
+		arch__associate_ins_ops(arch, name, ops);
+	return ops;
+}
+
+static int mips__annotate_init(struct arch *arch, char *cpuid __maybe_unused)
+{
+	arch->initialized = true;
+	arch->objdump.comment_char = '#';
+	arch->associate_instruction_ops = mips__associate_ins_ops;
+
+	return 0;
+}
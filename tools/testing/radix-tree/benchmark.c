@@ -134,6 +134,65 @@ static void benchmark_size(unsigned long size, unsigned long step)
 	rcu_barrier();
 }
 
+static long long benchmark_nsec(struct timespec *start)
+{
+	struct timespec finish;
+
+	clock_gettime(CLOCK_MONOTONIC, &finish);
+	return (finish.tv_sec - start->tv_sec) * NSEC_PER_SEC +
+	       (finish.tv_nsec - start->tv_nsec);
+}
+
+/*
+ * Cover @size indices with entries of @order, look every index up and
+ * split the entries back into single index ones.
+ */
+static void benchmark_multi(unsigned long size, unsigned int order)
+{
+	DEFINE_XARRAY(xa);
+	struct timespec start;
+	unsigned long index;
+	long long store, load, split = 0;
+	volatile unsigned long sink = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (index = 0; index < size; index += 1UL << order) {
+		XA_STATE_ORDER(xas, &xa, index, order);
+
+		do {
+			xas_lock(&xas);
+			xas_store(&xas, xa_mk_value(index));
+			xas_unlock(&xas);
+		} while (xas_nomem(&xas, GFP_KERNEL));
+	}
+	store = benchmark_nsec(&start);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (index = 0; index < size; index++)
+		sink ^= xa_to_value(xa_load(&xa, index));
+	load = benchmark_nsec(&start);
+
+	if (order) {
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (index = 0; index < size; index += 1UL << order) {
+			XA_STATE(xas, &xa, index);
+
+			xas_split_alloc(&xas, xa_mk_value(index), order,
+					GFP_KERNEL);
+			xas_lock(&xas);
+			xas_split(&xas, xa_mk_value(index), order);
+			xas_unlock(&xas);
+		}
+		split = benchmark_nsec(&start);
+	}
+
+	printv(2, "Size: %8ld, order: %2u, store: %12lld ns, load: %12lld ns, split: %12lld ns\n",
+		size, order, store, load, split);
+
+	xa_destroy(&xa);
+	rcu_barrier();
+}
+
 void benchmark(void)
 {
 	unsigned long size[] = {1 << 10, 1 << 20, 0};
@@ -147,4 +206,10 @@ void benchmark(void)
 	for (c = 0; size[c]; c++)
 		for (s = 0; step[s]; s++)
 			benchmark_size(size[c], step[s]);
+
+	for (c = 0; size[c]; c++) {
+		benchmark_multi(size[c], 0);
+		benchmark_multi(size[c], 6);
+		benchmark_multi(size[c], 9);
+	}
 }
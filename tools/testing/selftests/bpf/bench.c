@@ -131,9 +131,11 @@ static const struct argp_option opts[] = {
 };
 
 extern struct argp bench_ringbufs_argp;
+extern struct argp bench_xsk_argp;
 
 static const struct argp_child bench_parsers[] = {
 	{ &bench_ringbufs_argp, 0, "Ring buffers benchmark", 0 },
+	{ &bench_xsk_argp, 0, "AF_XDP transmit benchmark", 0 },
 	{},
 };
 
@@ -322,6 +324,7 @@ extern const struct bench bench_rb_libbpf;
 extern const struct bench bench_rb_custom;
 extern const struct bench bench_pb_libbpf;
 extern const struct bench bench_pb_custom;
+extern const struct bench bench_xsk_tx;
 
 static const struct bench *benchs[] = {
 	&bench_count_global,
@@ -343,6 +346,7 @@ static const struct bench *benchs[] = {
 	&bench_rb_custom,
 	&bench_pb_libbpf,
 	&bench_pb_custom,
+	&bench_xsk_tx,
 };
 
 static void setup_benchmark()
@@ -0,0 +1,212 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <argp.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <linux/if_ether.h>
+#include <linux/if_xdp.h>
+#include <bpf/xsk.h>
+#include "bench.h"
+
+/* AF_XDP copy mode transmit benchmark */
+static struct {
+	const char *ifname;
+	int frame_len;
+	int batch_cnt;
+} args = {
+	.ifname = "lo",
+	.frame_len = 64,
+	.batch_cnt = 64,
+};
+
+enum {
+	ARG_XSK_IFNAME = 3000,
+	ARG_XSK_FRAME_LEN = 3001,
+	ARG_XSK_BATCH_CNT = 3002,
+};
+
+static const struct argp_option opts[] = {
+	{ "xsk-ifname", ARG_XSK_IFNAME, "IFNAME", 0, "Interface to transmit on"},
+	{ "xsk-frame-len", ARG_XSK_FRAME_LEN, "LEN", 0, "Length of each frame"},
+	{ "xsk-batch-cnt", ARG_XSK_BATCH_CNT, "CNT", 0, "Descriptors queued per sendto()"},
+	{},
+};
+
+static error_t parse_arg(int key, char *arg, struct argp_state *state)
+{
+	switch (key) {
+	case ARG_XSK_IFNAME:
+		args.ifname = arg;
+		break;
+	case ARG_XSK_FRAME_LEN:
+		args.frame_len = strtol(arg, NULL, 10);
+		if (args.frame_len < ETH_ZLEN ||
+		    args.frame_len > XSK_UMEM__DEFAULT_FRAME_SIZE) {
+			fprintf(stderr, "Invalid frame length.");
+			argp_usage(state);
+		}
+		break;
+	case ARG_XSK_BATCH_CNT:
+		args.batch_cnt = strtol(arg, NULL, 10);
+		if (args.batch_cnt <= 0 ||
+		    args.batch_cnt > XSK_RING_PROD__DEFAULT_NUM_DESCS) {
+			fprintf(stderr, "Invalid batch count.");
+			argp_usage(state);
+		}
+		break;
+	default:
+		return ARGP_ERR_UNKNOWN;
+	}
+	return 0;
+}
+
+/* exported into benchmark runner */
+const struct argp bench_xsk_argp = {
+	.options = opts,
+	.parser = parse_arg,
+};
+
+#define NUM_FRAMES	(2 * XSK_RING_PROD__DEFAULT_NUM_DESCS)
+
+static struct ctx {
+	struct xsk_umem *umem;
+	struct xsk_socket *xsk;
+	struct xsk_ring_prod fq;
+	struct xsk_ring_cons cq;
+	struct xsk_ring_prod tx;
+	void *area;
+	struct counter hits;
+} ctx;
+
+static void validate()
+{
+	if (env.producer_cnt != 1) {
+		fprintf(stderr, "benchmark doesn't support multi-producer!\n");
+		exit(1);
+	}
+	if (env.consumer_cnt != 1) {
+		fprintf(stderr, "benchmark doesn't support multi-consumer!\n");
+		exit(1);
+	}
+}
+
+static void setup()
+{
+	struct xsk_socket_config cfg = {
+		.rx_size = XSK_RING_CONS__DEFAULT_NUM_DESCS,
+		.tx_size = XSK_RING_PROD__DEFAULT_NUM_DESCS,
+		.libbpf_flags = XSK_LIBBPF_FLAGS__INHIBIT_PROG_LOAD,
+		.bind_flags = XDP_COPY,
+	};
+	size_t size = (size_t)NUM_FRAMES * XSK_UMEM__DEFAULT_FRAME_SIZE;
+	struct ethhdr *eth;
+	int i, err;
+
+	setup_libbpf();
+
+	ctx.area = mmap(NULL, size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (ctx.area == MAP_FAILED) {
+		fprintf(stderr, "failed to allocate umem: %d\n", -errno);
+		exit(1);
+	}
+
+	/* Broadcast frames with a local experimental ethertype */
+	for (i = 0; i < NUM_FRAMES; i++) {
+		eth = ctx.area + (size_t)i * XSK_UMEM__DEFAULT_FRAME_SIZE;
+		memset(eth->h_dest, 0xff, ETH_ALEN);
+		memset(eth->h_source, 0x02, ETH_ALEN);
+		eth->h_proto = htons(ETH_P_802_EX1);
+	}
+
+	err = xsk_umem__create(&ctx.umem, ctx.area, size, &ctx.fq, &ctx.cq,
+			       NULL);
+	if (err) {
+		fprintf(stderr, "failed to create umem: %d\n", err);
+		exit(1);
+	}
+
+	err = xsk_socket__create(&ctx.xsk, args.ifname, 0, ctx.umem, NULL,
+				 &ctx.tx, &cfg);
+	if (err) {
+		fprintf(stderr, "failed to bind AF_XDP socket to %s: %d\n",
+			args.ifname, err);
+		exit(1);
+	}
+}
+
+static unsigned int reap_completions(void)
+{
+	unsigned int done;
+	__u32 idx;
+
+	done = xsk_ring_cons__peek(&ctx.cq, XSK_RING_CONS__DEFAULT_NUM_DESCS,
+				   &idx);
+	if (done)
+		xsk_ring_cons__release(&ctx.cq, done);
+	return done;
+}
+
+static void *producer(void *input)
+{
+	unsigned int i;
+	__u64 frame = 0;
+	__u32 idx;
+
+	while (true) {
+		if (xsk_ring_prod__reserve(&ctx.tx, args.batch_cnt, &idx) ==
+		    args.batch_cnt) {
+			for (i = 0; i < args.batch_cnt; i++) {
+				struct xdp_desc *desc;
+
+				desc = xsk_ring_prod__tx_desc(&ctx.tx, idx + i);
+				desc->addr = frame * XSK_UMEM__DEFAULT_FRAME_SIZE;
+				desc->len = args.frame_len;
+				frame = (frame + 1) % NUM_FRAMES;
+			}
+			xsk_ring_prod__submit(&ctx.tx, args.batch_cnt);
+		}
+
+		if (sendto(xsk_socket__fd(ctx.xsk), NULL, 0, MSG_DONTWAIT,
+			   NULL, 0) < 0 &&
+		    errno != EAGAIN && errno != EBUSY && errno != ENOBUFS) {
+			fprintf(stderr, "sendto failed: %d\n", -errno);
+			exit(1);
+		}
+
+		atomic_add(&ctx.hits.value, reap_completions());
+	}
+	return NULL;
+}
+
+static void *consumer(void *input)
+{
+	return NULL;
+}
+
+static void measure(struct bench_res *res)
+{
+	struct xdp_statistics stats;
+	socklen_t optlen = sizeof(stats);
+	static __u64 last_invalid;
+
+	res->hits = atomic_swap(&ctx.hits.value, 0);
+
+	if (!getsockopt(xsk_socket__fd(ctx.xsk), SOL_XDP, XDP_STATISTICS,
+			&stats, &optlen)) {
+		res->drops = stats.tx_invalid_descs - last_invalid;
+		last_invalid = stats.tx_invalid_descs;
+	}
+}
+
+const struct bench bench_xsk_tx = {
+	.name = "xsk-tx",
+	.validate = validate,
+	.setup = setup,
+	.producer_thread = producer,
+	.consumer_thread = consumer,
+	.measure = measure,
+	.report_progress = hits_drops_report_progress,
+	.report_final = hits_drops_report_final,
+};
@@ -0,0 +1,12 @@
+#!/bin/bash
+
+set -eufo pipefail
+
+RUN_BENCH="sudo ./bench -w2 -d5 -a"
+IFNAME=${1:-lo}
+
+for len in 64 256 1024 1500
+do
+	summary=$($RUN_BENCH --xsk-ifname $IFNAME --xsk-frame-len $len xsk-tx | tail -n1 | cut -d'(' -f1 | cut -d' ' -f3-)
+	printf "%-6s: %s\n" $len "$summary"
+done
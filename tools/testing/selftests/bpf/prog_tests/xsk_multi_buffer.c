@@ -0,0 +1,241 @@
+// SPDX-License-Identifier: GPL-2.0
+#define _GNU_SOURCE
+#include <sched.h>
+#include <sys/mman.h>
+#include <net/if.h>
+#include <linux/if_ether.h>
+#include <linux/if_link.h>
+#include <linux/if_xdp.h>
+#include <bpf/xsk.h>
+#include <test_progs.h>
+
+/*
+ * Multi-buffer AF_XDP in copy mode, over loopback in a private netns: a
+ * packet sent as three XDP_PKT_CONTD chained Tx descriptors must come back
+ * through generic XDP as a chain of Rx descriptors holding the same bytes.
+ */
+
+#define FRAME_SIZE	XSK_UMEM__DEFAULT_FRAME_SIZE
+#define NUM_FRAMES	64
+#define FILL_FRAMES	32	/* frames 0..31 go to the fill ring */
+#define TX_FRAME	FILL_FRAMES
+
+static const __u32 seg_len[] = { 3000, 3000, 1000 };
+
+struct xsk_ctx {
+	struct xsk_umem *umem;
+	struct xsk_socket *xsk;
+	struct xsk_ring_prod fq;
+	struct xsk_ring_cons cq;
+	struct xsk_ring_prod tx;
+	struct xsk_ring_cons rx;
+	void *area;
+};
+
+static int xsk_ctx_create(struct xsk_ctx *ctx, __u16 bind_flags)
+{
+	struct xsk_socket_config cfg = {
+		.rx_size = XSK_RING_CONS__DEFAULT_NUM_DESCS,
+		.tx_size = XSK_RING_PROD__DEFAULT_NUM_DESCS,
+		.xdp_flags = XDP_FLAGS_SKB_MODE,
+		.bind_flags = XDP_COPY | bind_flags,
+	};
+	size_t size = (size_t)NUM_FRAMES * FRAME_SIZE;
+	__u32 duration = 0, idx, i;
+	int err;
+
+	ctx->area = mmap(NULL, size, PROT_READ | PROT_WRITE,
+			 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (CHECK(ctx->area == MAP_FAILED, "mmap", "errno=%d\n", errno))
+		return -1;
+
+	err = xsk_umem__create(&ctx->umem, ctx->area, size, &ctx->fq,
+			       &ctx->cq, NULL);
+	if (CHECK(err, "umem_create", "err=%d\n", err))
+		return -1;
+
+	err = xsk_socket__create(&ctx->xsk, "lo", 0, ctx->umem, &ctx->rx,
+				 &ctx->tx, &cfg);
+	if (CHECK(err, "socket_create", "err=%d\n", err))
+		return -1;
+
+	if (CHECK(xsk_ring_prod__reserve(&ctx->fq, FILL_FRAMES, &idx) !=
+		  FILL_FRAMES, "fill_reserve", "fill ring too small\n"))
+		return -1;
+	for (i = 0; i < FILL_FRAMES; i++)
+		*xsk_ring_prod__fill_addr(&ctx->fq, idx + i) =
+			(__u64)i * FRAME_SIZE;
+	xsk_ring_prod__submit(&ctx->fq, FILL_FRAMES);
+
+	return 0;
+}
+
+static void xsk_ctx_destroy(struct xsk_ctx *ctx)
+{
+	if (ctx->xsk)
+		xsk_socket__delete(ctx->xsk);
+	if (ctx->umem)
+		xsk_umem__delete(ctx->umem);
+	if (ctx->area && ctx->area != MAP_FAILED)
+		munmap(ctx->area, (size_t)NUM_FRAMES * FRAME_SIZE);
+}
+
+/* Queue the segments of one packet, starting at TX_FRAME, and kick Tx */
+static int xsk_send_packet(struct xsk_ctx *ctx, unsigned int nr)
+{
+	struct xdp_desc *desc;
+	unsigned int i;
+	__u32 idx;
+
+	if (xsk_ring_prod__reserve(&ctx->tx, nr, &idx) != nr)
+		return -ENOSPC;
+
+	for (i = 0; i < nr; i++) {
+		desc = xsk_ring_prod__tx_desc(&ctx->tx, idx + i);
+		desc->addr = (__u64)(TX_FRAME + i) * FRAME_SIZE;
+		desc->len = seg_len[i];
+		desc->options = i + 1 < nr ? XDP_PKT_CONTD : 0;
+	}
+	xsk_ring_prod__submit(&ctx->tx, nr);
+
+	if (sendto(xsk_socket__fd(ctx->xsk), NULL, 0, MSG_DONTWAIT, NULL,
+		   0) < 0 && errno != EAGAIN && errno != EBUSY)
+		return -errno;
+	return 0;
+}
+
+static void fill_tx_frames(struct xsk_ctx *ctx)
+{
+	unsigned char *frame;
+	struct ethhdr *eth;
+	unsigned int i, j;
+
+	for (i = 0; i < ARRAY_SIZE(seg_len); i++) {
+		frame = ctx->area + (size_t)(TX_FRAME + i) * FRAME_SIZE;
+		for (j = 0; j < seg_len[i]; j++)
+			frame[j] = i * 64 + j;
+	}
+
+	/* Broadcast frame with a local experimental ethertype */
+	eth = ctx->area + (size_t)TX_FRAME * FRAME_SIZE;
+	memset(eth->h_dest, 0xff, ETH_ALEN);
+	memset(eth->h_source, 0x02, ETH_ALEN);
+	eth->h_proto = htons(ETH_P_802_EX1);
+}
+
+/* Byte @off of the packet built by fill_tx_frames() */
+static unsigned char tx_byte(struct xsk_ctx *ctx, __u32 off)
+{
+	unsigned int i;
+
+	for (i = 0; off >= seg_len[i]; i++)
+		off -= seg_len[i];
+	return *((unsigned char *)ctx->area +
+		 (size_t)(TX_FRAME + i) * FRAME_SIZE + off);
+}
+
+static void test_xsk_sg_loopback(void)
+{
+	__u32 duration = 0, idx, total = 0, want = 0, nr_rx = 0, off, i;
+	const struct xdp_desc *desc;
+	struct xsk_ctx ctx = {};
+	bool last = false;
+	unsigned char *p;
+	int err, tries;
+
+	if (xsk_ctx_create(&ctx, XDP_USE_SG))
+		goto out;
+
+	fill_tx_frames(&ctx);
+	for (i = 0; i < ARRAY_SIZE(seg_len); i++)
+		want += seg_len[i];
+
+	err = xsk_send_packet(&ctx, ARRAY_SIZE(seg_len));
+	if (CHECK(err, "send", "err=%d\n", err))
+		goto out;
+
+	/* Generic Tx and loopback Rx complete synchronously, but be lenient */
+	for (tries = 0; !last && tries < 100; tries++) {
+		if (!xsk_ring_cons__peek(&ctx.rx, 1, &idx)) {
+			usleep(1000);
+			continue;
+		}
+
+		desc = xsk_ring_cons__rx_desc(&ctx.rx, idx);
+		p = xsk_umem__get_data(ctx.area, desc->addr);
+		for (off = 0; off < desc->len; off++)
+			if (p[off] != tx_byte(&ctx, total + off))
+				break;
+		if (CHECK(off != desc->len, "rx_data",
+			  "mismatch at byte %u\n", total + off)) {
+			xsk_ring_cons__release(&ctx.rx, 1);
+			goto out;
+		}
+
+		total += desc->len;
+		last = !(desc->options & XDP_PKT_CONTD);
+		nr_rx++;
+		xsk_ring_cons__release(&ctx.rx, 1);
+	}
+
+	CHECK(!last, "rx_last", "no end of packet after %u descs\n", nr_rx);
+	CHECK(nr_rx < 2, "rx_descs", "packet of %u bytes in %u desc\n",
+	      want, nr_rx);
+	CHECK(total != want, "rx_len", "got %u bytes, want %u\n", total, want);
+out:
+	xsk_ctx_destroy(&ctx);
+}
+
+/* Without XDP_USE_SG the Tx ring must reject XDP_PKT_CONTD */
+static void test_xsk_sg_unbound(void)
+{
+	struct xdp_statistics stats = {};
+	socklen_t optlen = sizeof(stats);
+	struct xsk_ctx ctx = {};
+	__u32 duration = 0;
+	int err;
+
+	if (xsk_ctx_create(&ctx, 0))
+		goto out;
+
+	fill_tx_frames(&ctx);
+	err = xsk_send_packet(&ctx, ARRAY_SIZE(seg_len));
+	if (CHECK(err, "send", "err=%d\n", err))
+		goto out;
+
+	err = getsockopt(xsk_socket__fd(ctx.xsk), SOL_XDP, XDP_STATISTICS,
+			 &stats, &optlen);
+	if (CHECK(err, "statistics", "errno=%d\n", errno))
+		goto out;
+	CHECK(!stats.tx_invalid_descs, "tx_invalid",
+	      "XDP_PKT_CONTD accepted without XDP_USE_SG\n");
+out:
+	xsk_ctx_destroy(&ctx);
+}
+
+void test_xsk_multi_buffer(void)
+{
+	int old_net, err;
+	__u32 duration = 0;
+
+	old_net = open("/proc/self/ns/net", O_RDONLY);
+	if (CHECK(old_net < 0, "open_netns", "errno=%d\n", errno))
+		return;
+
+	err = unshare(CLONE_NEWNET);
+	if (CHECK(err, "unshare", "errno=%d\n", errno))
+		goto out_close;
+
+	if (CHECK(system("ip link set dev lo up"), "lo_up", "failed\n"))
+		goto out_restore;
+
+	if (test__start_subtest("loopback"))
+		test_xsk_sg_loopback();
+	if (test__start_subtest("contd_without_sg"))
+		test_xsk_sg_unbound();
+
+out_restore:
+	setns(old_net, CLONE_NEWNET);
+out_close:
+	close(old_net);
+}
@@ -0,0 +1,132 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/******************************************************************************
+ *
+ * DESCRIPTION
+ *      Test FUTEX_WAIT_MULTIPLE: a value mismatch on any futex returns
+ *      -EWOULDBLOCK, the timeout is honoured, and a wakeup on one of the
+ *      futexes returns its index.
+ *
+ *****************************************************************************/
+
+#include <errno.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "futextest.h"
+#include "logging.h"
+
+#define TEST_NAME "futex-wait-multiple"
+#define timeout_ns 100000
+#define NR_FUTEXES 3
+
+static futex_t futexes[NR_FUTEXES];
+static struct futex_wait_block wb[NR_FUTEXES];
+static int waiter_ret, waiter_errno;
+
+void usage(char *prog)
+{
+	printf("Usage: %s\n", prog);
+	printf("  -c	Use color\n");
+	printf("  -h	Display this help message\n");
+	printf("  -v L	Verbosity level: %d=QUIET %d=CRITICAL %d=INFO\n",
+	       VQUIET, VCRITICAL, VINFO);
+}
+
+static void setup_wait_blocks(void)
+{
+	int i;
+
+	for (i = 0; i < NR_FUTEXES; i++) {
+		futexes[i] = FUTEX_INITIALIZER;
+		wb[i].uaddr = (uintptr_t)&futexes[i];
+		wb[i].val = futexes[i];
+		wb[i].bitset = FUTEX_BITSET_MATCH_ANY;
+	}
+}
+
+static void *waiter(void *arg)
+{
+	waiter_ret = futex_wait_multiple(wb, NR_FUTEXES, NULL,
+					 FUTEX_PRIVATE_FLAG);
+	waiter_errno = errno;
+	return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+	struct timespec to = {.tv_sec = 0, .tv_nsec = timeout_ns};
+	int res, ret = RET_PASS;
+	pthread_t thread;
+	int c, i;
+
+	while ((c = getopt(argc, argv, "cht:v:")) != -1) {
+		switch (c) {
+		case 'c':
+			log_color(1);
+			break;
+		case 'h':
+			usage(basename(argv[0]));
+			exit(0);
+		case 'v':
+			log_verbosity(atoi(optarg));
+			break;
+		default:
+			usage(basename(argv[0]));
+			exit(1);
+		}
+	}
+
+	ksft_print_header();
+	ksft_set_plan(1);
+	ksft_print_msg("%s: Test FUTEX_WAIT_MULTIPLE\n", basename(argv[0]));
+
+	setup_wait_blocks();
+	wb[2].val++;
+	info("Calling futex_wait_multiple with a mismatched value\n");
+	res = futex_wait_multiple(wb, NR_FUTEXES, &to, FUTEX_PRIVATE_FLAG);
+	if (!res || errno != EWOULDBLOCK) {
+		fail("futex_wait_multiple returned: %d %s\n",
+		     res ? errno : res, res ? strerror(errno) : "");
+		ret = RET_FAIL;
+	}
+
+	setup_wait_blocks();
+	info("Calling futex_wait_multiple with a %dns timeout\n", timeout_ns);
+	res = futex_wait_multiple(wb, NR_FUTEXES, &to, FUTEX_PRIVATE_FLAG);
+	if (!res || errno != ETIMEDOUT) {
+		fail("futex_wait_multiple returned: %d %s\n",
+		     res ? errno : res, res ? strerror(errno) : "");
+		ret = RET_FAIL;
+	}
+
+	setup_wait_blocks();
+	info("Waking futex 1 of %d\n", NR_FUTEXES);
+	if (pthread_create(&thread, NULL, waiter, NULL)) {
+		error("pthread_create failed\n", errno);
+		ret = RET_ERROR;
+		goto out;
+	}
+	/* Retry until the waiter is queued on the futex. */
+	for (i = 0; i < 1000; i++) {
+		if (futex_wake(&futexes[1], 1, FUTEX_PRIVATE_FLAG) > 0)
+			break;
+		usleep(1000);
+	}
+	if (i == 1000)
+		futex_wake(&futexes[0], NR_FUTEXES, FUTEX_PRIVATE_FLAG);
+	pthread_join(thread, NULL);
+	if (waiter_ret != 1) {
+		fail("futex_wait_multiple returned: %d %s\n", waiter_ret,
+		     waiter_ret < 0 ? strerror(waiter_errno) : "");
+		ret = RET_FAIL;
+	}
+
+out:
+	print_result(TEST_NAME, ret);
+	return ret;
+}
@@ -70,6 +70,9 @@ echo
 echo
 ./futex_wait_wouldblock $COLOR
 
+echo
+./futex_wait_multiple $COLOR
+
 echo
 ./futex_wait_uninitialized_heap $COLOR
 ./futex_wait_private_mapped_file $COLOR
@@ -0,0 +1,58 @@
+#!/bin/sh
+# SPDX-License-Identifier: GPL-2.0
+#
+# Lock acquisition rate of the queued spinlock and rwlock, measured with
+# locktorture.  Each lock type runs for $DURATION seconds (10 by default)
+# and the total number of acquisitions per second is printed; compare the
+# figures of two kernels on the same machine.
+
+# Kselftest framework requirement - SKIP code is 4.
+ksft_skip=4
+duration=${DURATION:-10}
+
+if ! /sbin/modprobe -q -n locktorture; then
+	echo "locktorture: module not found [SKIP]"
+	exit $ksft_skip
+fi
+
+# Print the total of the last "$1:  Total:" line of the run's log
+last_total()
+{
+	echo "$log" | grep "$1:  Total:" | tail -n 1 |
+		sed -e 's/.*Total: \([0-9]*\).*/\1/'
+}
+
+rc=0
+for type in spin_lock rw_lock; do
+	# Only look at the kernel log from this run's marker on
+	marker="locktorture_bench: $type start $$"
+	if ! echo "$marker" > /dev/kmsg; then
+		echo "locktorture: cannot write to /dev/kmsg [SKIP]"
+		exit $ksft_skip
+	fi
+
+	if ! /sbin/modprobe locktorture torture_type=$type; then
+		echo "locktorture: $type failed to load [FAIL]"
+		rc=1
+		continue
+	fi
+	sleep "$duration"
+	/sbin/modprobe -q -r locktorture
+
+	log=$(dmesg | sed -n "\|$marker|,\$p")
+	if ! echo "$log" | grep -q "End of test: SUCCESS" ||
+	   echo "$log" | grep -q "Fail: [1-9]"; then
+		echo "locktorture: $type reported a failure [FAIL]"
+		rc=1
+		continue
+	fi
+
+	writes=$(last_total "Writes")
+	echo "$type: $((writes / duration)) write acquisitions/s"
+	if [ "$type" = rw_lock ]; then
+		reads=$(last_total "Reads ")
+		echo "$type: $((reads / duration)) read acquisitions/s"
+	fi
+done
+
+exit $rc
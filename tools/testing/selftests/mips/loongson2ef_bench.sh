@@ -0,0 +1,47 @@
+#!/bin/sh
+# SPDX-License-Identifier: GPL-2.0
+#
+# Runs the Loongson-2F platform micro benchmarks and prints their cycles
+# per operation, one benchmark per line.  Keep the output of a known good
+# kernel around and compare it to catch regressions.
+
+# Kselftest framework requirement - SKIP code is 4.
+ksft_skip=4
+module=loongson2ef_bench
+
+if ! grep -q "Loongson-2" /proc/cpuinfo; then
+	echo "$module: not a Loongson-2 machine [SKIP]"
+	exit $ksft_skip
+fi
+
+if ! /sbin/modprobe -q -n $module; then
+	echo "$module: module not found [SKIP]"
+	exit $ksft_skip
+fi
+
+# Only look at the kernel log from our own marker on
+marker="$module: selftest start $$"
+if ! echo "$marker" > /dev/kmsg; then
+	echo "$module: cannot write to /dev/kmsg [SKIP]"
+	exit $ksft_skip
+fi
+
+if ! /sbin/modprobe $module "$@"; then
+	echo "$module: module failed to load [FAIL]"
+	exit 1
+fi
+/sbin/modprobe -q -r $module
+
+log=$(dmesg | sed -n "\|$marker|,\$p" | grep "$module: " | grep -v "$marker" |
+	sed -e "s/^.*$module: //")
+echo "$log"
+
+if echo "$log" | grep -q "failed"; then
+	echo "$module: a benchmark failed [FAIL]"
+	exit 1
+fi
+if ! echo "$log" | grep -q "^done"; then
+	echo "$module: benchmarks did not complete [FAIL]"
+	exit 1
+fi
+echo "$module: [PASS]"
@@ -0,0 +1,126 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Syscall entry cost for the ABI this binary was built for.
+ *
+ * getppid() is the cheapest syscall there is and measures the bare
+ * entry/exit path; sendto() on a bad descriptor fails right after the
+ * arguments are fetched, so on o32 it also includes copying arguments
+ * 5 and 6 from the user stack.  Build with -mabi=32, -mabi=n32 and
+ * -mabi=64 and compare.
+ *
+ * Before timing anything, check that arguments still arrive intact on
+ * both paths: write() and read() only use registers, while the o32
+ * pread64() takes its offset from arguments 5 and 6.
+ */
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "kselftest.h"
+
+#define LOOPS	1000000
+#define FILE_SIZE	8192
+#define READ_OFFSET	4099
+
+#if _MIPS_SIM == _ABIO32
+#define ABI	"o32"
+#elif _MIPS_SIM == _ABIN32
+#define ABI	"n32"
+#else
+#define ABI	"n64"
+#endif
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static double bench_getppid(void)
+{
+	unsigned long long t;
+	int i;
+
+	t = now_ns();
+	for (i = 0; i < LOOPS; i++)
+		syscall(SYS_getppid);
+	return (double)(now_ns() - t) / LOOPS;
+}
+
+static double bench_sendto(void)
+{
+	unsigned long long t;
+	int i;
+
+	t = now_ns();
+	for (i = 0; i < LOOPS; i++)
+		syscall(SYS_sendto, -1, NULL, 0, 0, NULL, 0);
+	return (double)(now_ns() - t) / LOOPS;
+}
+
+static int check_regargs(void)
+{
+	char buf[8] = {};
+	int fds[2], ret = -1;
+
+	if (pipe(fds))
+		return -1;
+
+	if (syscall(SYS_write, fds[1], "mips", 4) == 4 &&
+	    syscall(SYS_read, fds[0], buf, sizeof(buf)) == 4 &&
+	    !memcmp(buf, "mips", 4))
+		ret = 0;
+
+	close(fds[0]);
+	close(fds[1]);
+	return ret;
+}
+
+static int check_stackargs(void)
+{
+	unsigned char data[FILE_SIZE], buf[16];
+	FILE *f;
+	int i, ret = -1;
+
+	f = tmpfile();
+	if (!f)
+		return -1;
+
+	for (i = 0; i < FILE_SIZE; i++)
+		data[i] = i * 7;
+
+	if (fwrite(data, 1, FILE_SIZE, f) == FILE_SIZE && !fflush(f) &&
+	    pread(fileno(f), buf, sizeof(buf), READ_OFFSET) == sizeof(buf) &&
+	    !memcmp(buf, data + READ_OFFSET, sizeof(buf)))
+		ret = 0;
+
+	fclose(f);
+	return ret;
+}
+
+int main(void)
+{
+	ksft_print_header();
+	ksft_set_plan(5);
+
+	ksft_test_result(!check_regargs(), "%s register arguments\n", ABI);
+	ksft_test_result(!check_stackargs(), "%s stack arguments\n", ABI);
+	ksft_test_result(syscall(SYS_sendto, -1, NULL, 0, 0, NULL, 0) == -1 &&
+			 errno == EBADF, "%s sendto(-1) fails with EBADF\n",
+			 ABI);
+
+	ksft_test_result_pass("%s getppid: %.1f ns/call\n", ABI,
+			      bench_getppid());
+	ksft_test_result_pass("%s sendto (6 args): %.1f ns/call\n", ABI,
+			      bench_sendto());
+
+	if (ksft_get_fail_cnt())
+		ksft_exit_fail();
+	ksft_exit_pass();
+}
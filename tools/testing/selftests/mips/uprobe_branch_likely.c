@@ -0,0 +1,203 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Put a uprobe on a beql and on a bnel and check that the delay slot
+ * still runs exactly when the branch is taken.  The kernel emulates the
+ * branch and its addiu delay slot instead of stepping them out of line,
+ * so this exercises arch_uprobe_skip_sstep().
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "kselftest.h"
+
+#if defined(__mips__) && __mips_isa_rev < 6
+/*
+ * Both return 1 when the branch is taken, as the delay slot adds 1, and
+ * 16 when it is not, as the slot is nullified and the fall through adds
+ * 16.
+ */
+asm(
+"	.text\n"
+"	.set	push\n"
+"	.set	noreorder\n"
+"	.set	mips2\n"
+"	.globl	beql_slot\n"
+"	.type	beql_slot, @function\n"
+"beql_slot:\n"
+"	move	$2, $0\n"
+"	.globl	beql_probe\n"
+"beql_probe:\n"
+"	beql	$4, $5, 1f\n"
+"	 addiu	$2, $2, 1\n"
+"	addiu	$2, $2, 16\n"
+"1:	jr	$31\n"
+"	 nop\n"
+"	.size	beql_slot, . - beql_slot\n"
+"	.globl	bnel_slot\n"
+"	.type	bnel_slot, @function\n"
+"bnel_slot:\n"
+"	move	$2, $0\n"
+"	.globl	bnel_probe\n"
+"bnel_probe:\n"
+"	bnel	$4, $5, 1f\n"
+"	 addiu	$2, $2, 1\n"
+"	addiu	$2, $2, 16\n"
+"1:	jr	$31\n"
+"	 nop\n"
+"	.size	bnel_slot, . - bnel_slot\n"
+"	.set	pop\n"
+);
+
+long beql_slot(long a, long b);
+long bnel_slot(long a, long b);
+extern char beql_probe[], bnel_probe[];
+
+static const char *tracefs;
+
+static int write_file(const char *name, const char *str, int flags)
+{
+	char path[PATH_MAX];
+	int fd, ret;
+
+	snprintf(path, sizeof(path), "%s/%s", tracefs, name);
+	fd = open(path, O_WRONLY | flags);
+	if (fd < 0)
+		return -1;
+	ret = write(fd, str, strlen(str)) == strlen(str) ? 0 : -1;
+	close(fd);
+	return ret;
+}
+
+/* File offset of @addr in the executable, for uprobe_events */
+static long file_offset(void *addr)
+{
+	unsigned long start, end, off;
+	char line[512], perm[8];
+	long ret = -1;
+	FILE *f;
+
+	f = fopen("/proc/self/maps", "r");
+	if (!f)
+		return -1;
+
+	while (fgets(line, sizeof(line), f)) {
+		if (sscanf(line, "%lx-%lx %7s %lx", &start, &end, perm,
+			   &off) != 4)
+			continue;
+		if ((unsigned long)addr >= start && (unsigned long)addr < end &&
+		    perm[2] == 'x') {
+			ret = (unsigned long)addr - start + off;
+			break;
+		}
+	}
+
+	fclose(f);
+	return ret;
+}
+
+/* Hit count of probe @event from uprobe_profile, -1 if not found */
+static long probe_hits(const char *event)
+{
+	char path[PATH_MAX], line[PATH_MAX + 128], name[128], file[PATH_MAX];
+	long hits, ret = -1;
+	FILE *f;
+
+	snprintf(path, sizeof(path), "%s/uprobe_profile", tracefs);
+	f = fopen(path, "r");
+	if (!f)
+		return -1;
+
+	while (fgets(line, sizeof(line), f)) {
+		if (sscanf(line, "%s %127s %ld", file, name, &hits) == 3 &&
+		    !strcmp(name, event)) {
+			ret = hits;
+			break;
+		}
+	}
+
+	fclose(f);
+	return ret;
+}
+
+static int add_probe(const char *exe, const char *event, void *addr)
+{
+	char cmd[PATH_MAX + 64];
+	long off = file_offset(addr);
+
+	if (off < 0)
+		return -1;
+
+	snprintf(cmd, sizeof(cmd), "p:mips_bl/%s %s:0x%lx\n", event, exe, off);
+	return write_file("uprobe_events", cmd, O_APPEND);
+}
+
+static void check(const char *event, long (*fn)(long, long), long a, long b,
+		  long expect)
+{
+	long before = probe_hits(event);
+	long ret = fn(a, b);
+	long after = probe_hits(event);
+
+	ksft_test_result(ret == expect && after == before + 1,
+			 "%s(%ld, %ld) = %ld (expected %ld), %ld probe hit(s)\n",
+			 event, a, b, ret, expect, after - before);
+}
+
+int main(void)
+{
+	char exe[PATH_MAX];
+	ssize_t len;
+
+	ksft_print_header();
+
+	if (geteuid())
+		ksft_exit_skip("must be run as root\n");
+
+	if (!access("/sys/kernel/tracing/uprobe_events", W_OK))
+		tracefs = "/sys/kernel/tracing";
+	else if (!access("/sys/kernel/debug/tracing/uprobe_events", W_OK))
+		tracefs = "/sys/kernel/debug/tracing";
+	else
+		ksft_exit_skip("uprobe_events not available\n");
+
+	len = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+	if (len < 0)
+		ksft_exit_fail_msg("readlink: %s\n", strerror(errno));
+	exe[len] = '\0';
+
+	/* the expected results without any probe */
+	if (beql_slot(1, 1) != 1 || beql_slot(1, 2) != 16 ||
+	    bnel_slot(1, 2) != 1 || bnel_slot(1, 1) != 16)
+		ksft_exit_fail_msg("unprobed results are wrong\n");
+
+	if (add_probe(exe, "beql", beql_probe) ||
+	    add_probe(exe, "bnel", bnel_probe) ||
+	    write_file("events/mips_bl/enable", "1", 0))
+		ksft_exit_skip("cannot set up the uprobes\n");
+
+	ksft_set_plan(4);
+	check("beql", beql_slot, 1, 1, 1);
+	check("beql", beql_slot, 1, 2, 16);
+	check("bnel", bnel_slot, 1, 2, 1);
+	check("bnel", bnel_slot, 1, 1, 16);
+
+	write_file("events/mips_bl/enable", "0", 0);
+	write_file("uprobe_events", "-:mips_bl/beql\n", O_APPEND);
+	write_file("uprobe_events", "-:mips_bl/bnel\n", O_APPEND);
+
+	if (ksft_get_fail_cnt())
+		ksft_exit_fail();
+	ksft_exit_pass();
+}
+#else
+int main(void)
+{
+	ksft_print_header();
+	ksft_exit_skip("needs branch-likely instructions (pre-R6 MIPS)\n");
+}
+#endif
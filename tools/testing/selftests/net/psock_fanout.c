@@ -19,6 +19,7 @@
  *   - PACKET_FANOUT_HASH with PACKET_FANOUT_FLAG_ROLLOVER
  *   - PACKET_FANOUT_LB
  *   - PACKET_FANOUT_CPU
+ *   - PACKET_FANOUT_CPU_PINNED
  *   - PACKET_FANOUT_ROLLOVER
  *   - PACKET_FANOUT_CBPF
  *   - PACKET_FANOUT_EBPF
@@ -58,7 +59,8 @@
 
 /* Open a socket in a given fanout mode.
  * @return -1 if mode is bad, a valid socket otherwise */
-static int sock_fanout_open(uint16_t typeflags, uint16_t group_id)
+static int sock_fanout_open_pinned(uint16_t typeflags, uint16_t group_id,
+				   int cpu)
 {
 	struct sockaddr_ll addr = {0};
 	int fd, val;
@@ -69,6 +71,12 @@ static int sock_fanout_open(uint16_t typeflags, uint16_t group_id)
 		exit(1);
 	}
 
+	if (cpu >= 0 &&
+	    setsockopt(fd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, sizeof(cpu))) {
+		perror("setsockopt SO_INCOMING_CPU");
+		exit(1);
+	}
+
 	pair_udp_setfilter(fd);
 
 	addr.sll_family = AF_PACKET;
@@ -95,6 +103,11 @@ static int sock_fanout_open(uint16_t typeflags, uint16_t group_id)
 	return fd;
 }
 
+static int sock_fanout_open(uint16_t typeflags, uint16_t group_id)
+{
+	return sock_fanout_open_pinned(typeflags, group_id, -1);
+}
+
 static void sock_fanout_set_cbpf(int fd)
 {
 	struct sock_filter bpf_filter[] = {
@@ -353,8 +366,14 @@ static int test_datapath(uint16_t typeflags, int port_off,
 		typeflags, (uint16_t)PORT_BASE,
 		(uint16_t)(PORT_BASE + port_off));
 
-	fds[0] = sock_fanout_open(typeflags, 0);
-	fds[1] = sock_fanout_open(typeflags, 0);
+	if (type == PACKET_FANOUT_CPU_PINNED) {
+		/* pin in reverse order, to differ from PACKET_FANOUT_CPU */
+		fds[0] = sock_fanout_open_pinned(typeflags, 0, 1);
+		fds[1] = sock_fanout_open_pinned(typeflags, 0, 0);
+	} else {
+		fds[0] = sock_fanout_open(typeflags, 0);
+		fds[1] = sock_fanout_open(typeflags, 0);
+	}
 	if (fds[0] == -1 || fds[1] == -1) {
 		fprintf(stderr, "ERROR: failed open\n");
 		exit(1);
@@ -461,6 +480,13 @@ int main(int argc, char **argv)
 		ret |= test_datapath(PACKET_FANOUT_CPU, port_off,
 				     expect_cpu1[0], expect_cpu1[1]);
 
+	set_cpuaffinity(0);
+	ret |= test_datapath(PACKET_FANOUT_CPU_PINNED, port_off,
+			     expect_cpu1[0], expect_cpu1[1]);
+	if (!set_cpuaffinity(1))
+		ret |= test_datapath(PACKET_FANOUT_CPU_PINNED, port_off,
+				     expect_cpu0[0], expect_cpu0[1]);
+
 	ret |= test_datapath(PACKET_FANOUT_FLAG_UNIQUEID, port_off,
 			     expect_uniqueid[0], expect_uniqueid[1]);
 
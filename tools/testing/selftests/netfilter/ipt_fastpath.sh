@@ -0,0 +1,118 @@
+#!/bin/bash
+# SPDX-License-Identifier: GPL-2.0
+#
+# ip_tables indexes runs of rules matching a single address.  Check that
+# such a ruleset gives the same verdicts and rule counters as the same
+# rules with the runs broken up by rules that are never hit, which are
+# walked one by one.
+
+# Kselftest framework requirement - SKIP code is 4.
+ksft_skip=4
+sfx=$(mktemp -u "XXXXXXXX")
+ns0="ns0-$sfx"
+nr=32
+ret=0
+
+# The nft based iptables would not exercise ip_tables at all.
+iptables=iptables-legacy
+
+$iptables --version > /dev/null 2>&1
+if [ $? -ne 0 ];then
+	echo "SKIP: Could not run test without $iptables tool"
+	exit $ksft_skip
+fi
+
+cleanup()
+{
+	ip netns del "$ns0"
+}
+
+ip netns add "$ns0" || exit $ksft_skip
+trap cleanup EXIT
+
+ip -net "$ns0" link set lo up
+for i in $(seq 1 $nr); do
+	ip -net "$ns0" addr add 10.0.1.$i/32 dev lo
+done
+
+# Destination i is dropped if i % 3 == 0, dropped by a later rule of the
+# run for 4, and accepted otherwise.
+load_rules()
+{
+	local spacer="$1"
+	local i
+
+	ip netns exec "$ns0" $iptables -F OUTPUT
+	for i in $(seq 1 $nr); do
+		case $((i % 3)) in
+		0) ip netns exec "$ns0" $iptables -A OUTPUT -d 10.0.1.$i -p icmp -j DROP ;;
+		1) ip netns exec "$ns0" $iptables -A OUTPUT -d 10.0.1.$i -p tcp -j DROP ;;
+		2) ip netns exec "$ns0" $iptables -A OUTPUT -d 10.0.1.$i -j ACCEPT ;;
+		esac
+		if $spacer; then
+			ip netns exec "$ns0" $iptables -A OUTPUT -d 0.0.0.0/31 -j DROP
+		fi
+	done
+	ip netns exec "$ns0" $iptables -A OUTPUT -d 10.0.1.4 -p icmp -j DROP
+}
+
+run_pings()
+{
+	local i
+
+	for i in $(seq 1 $nr); do
+		if ip netns exec "$ns0" ping -q -c 1 -W 1 10.0.1.$i > /dev/null 2>&1; then
+			echo -n "1"
+		else
+			echo -n "0"
+		fi
+	done
+	echo
+}
+
+rule_counters()
+{
+	ip netns exec "$ns0" $iptables -v -x -n -L OUTPUT | \
+		awk '$NF != "0.0.0.0/31" && NR > 2 { print $1, $NF }'
+}
+
+load_rules false
+if [ $? -ne 0 ]; then
+	echo "SKIP: Could not add test ruleset"
+	exit $ksft_skip
+fi
+fast_verdicts=$(run_pings)
+fast_counters=$(rule_counters)
+
+load_rules true
+slow_verdicts=$(run_pings)
+slow_counters=$(rule_counters)
+
+want=""
+for i in $(seq 1 $nr); do
+	if [ $((i % 3)) -eq 0 ] || [ $i -eq 4 ]; then
+		want="${want}0"
+	else
+		want="${want}1"
+	fi
+done
+
+if [ "$fast_verdicts" != "$want" ]; then
+	echo "FAIL: indexed verdicts $fast_verdicts, want $want"
+	ret=1
+fi
+if [ "$fast_verdicts" != "$slow_verdicts" ]; then
+	echo "FAIL: indexed verdicts $fast_verdicts, linear $slow_verdicts"
+	ret=1
+fi
+if [ "$fast_counters" != "$slow_counters" ]; then
+	echo "FAIL: rule counters differ between indexed and linear rules"
+	diff <(echo "$fast_counters") <(echo "$slow_counters")
+	ret=1
+fi
+
+if [ $ret -eq 0 ];then
+	echo "OK: ip_tables indexed rules give the same verdicts as linear rules"
+fi
+
+exit $ret
@@ -0,0 +1,50 @@
+// SPDX-License-Identifier: GPL-2.0
+// Test SMAPS_ROLLUP_QUERY on /proc/self/smaps_rollup: touched anonymous
+// memory shows up in the anonymous class, the executable in the file one.
+#undef NDEBUG
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <linux/fs.h>
+
+#define LEN	(4UL << 20)
+
+int main(void)
+{
+	struct smaps_rollup_query q;
+	char *p;
+	int fd;
+
+	fd = open("/proc/self/smaps_rollup", O_RDONLY);
+	if (fd == -1 && errno == ENOENT)
+		return 4;
+	assert(fd >= 0);
+
+	p = mmap(NULL, LEN, PROT_READ | PROT_WRITE,
+		 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	assert(p != MAP_FAILED);
+	memset(p, 1, LEN);
+
+	memset(&q, 0, sizeof(q));
+	q.size = sizeof(q) - 1;
+	assert(ioctl(fd, SMAPS_ROLLUP_QUERY, &q) == -1 && errno == EINVAL);
+
+	memset(&q, 0, sizeof(q));
+	q.size = sizeof(q);
+	if (ioctl(fd, SMAPS_ROLLUP_QUERY, &q) == -1 && errno == ENOTTY)
+		return 4;
+
+	assert(q.size == sizeof(q));
+	assert(q.stats[SMAPS_ROLLUP_ANON].vmas > 0);
+	assert(q.stats[SMAPS_ROLLUP_ANON].rss >= LEN);
+	assert(q.stats[SMAPS_ROLLUP_ANON].anonymous >= LEN);
+	assert(q.stats[SMAPS_ROLLUP_ANON].private_dirty >= LEN);
+	assert(q.stats[SMAPS_ROLLUP_FILE].vmas > 0);
+	assert(q.stats[SMAPS_ROLLUP_FILE].pss <= q.stats[SMAPS_ROLLUP_FILE].rss);
+
+	return 0;
+}